@@ -70,6 +70,8 @@ struct opcode_desc {
 extern const struct opcode_desc opcode_descs[128];
 
 int brw_disasm (FILE *file, struct brw_instruction *inst, int gen);
+int brw_disasm_to_string (char *buf, size_t size,
+			  struct brw_instruction *inst, int gen);
 
 #ifdef __cplusplus
 } /* end of extern "C" */
@@ -392,11 +392,27 @@ static const char * const sampler_target_format[4] = {
 };
 
 
-static int column;
+/*
+ * All output funnels through string()/newline(), so instead of one
+ * stdio call per operand -- which makes disassembling large captures
+ * I/O-call bound -- the helpers append to this per-instruction buffer
+ * and brw_disasm() writes the finished line out in a single call.
+ * brw_disasm_to_string() hands out the rendered buffer directly so
+ * programmatic consumers can skip the FILE altogether.  The state is
+ * per-thread so independent instructions can be rendered in parallel.
+ */
+static __thread int column;
+static __thread char disasm_buf[4096];
+static __thread size_t disasm_len;
 
 static int string (FILE *file, const char *string)
 {
-    fputs (string, file);
+    size_t len = strlen (string);
+
+    if (len > sizeof (disasm_buf) - 1 - disasm_len)
+	len = sizeof (disasm_buf) - 1 - disasm_len;
+    memcpy (disasm_buf + disasm_len, string, len);
+    disasm_len += len;
     column += strlen (string);
     return 0;
 }
@@ -416,7 +432,7 @@ static int format (FILE *f, const char *format, ...)
 
 static int newline (FILE *f)
 {
-    putc ('\n', f);
+    string (f, "\n");
     column = 0;
     return 0;
 }
@@ -433,8 +449,8 @@ static int control (FILE *file, const char *name, const char * const ctrl[],
                     unsigned id, int *space)
 {
     if (!ctrl[id]) {
-	fprintf (file, "*** invalid %s value %d ",
-		 name, id);
+	format (file, "*** invalid %s value %d ",
+		name, id);
 	return 1;
     }
     if (ctrl[id][0])
@@ -1040,11 +1056,14 @@ static int qtr_ctrl(FILE *file, struct brw_instruction *inst)
     return 0;
 }
 
-int brw_disasm (FILE *file, struct brw_instruction *inst, int gen)
+static int do_disasm (FILE *file, struct brw_instruction *inst, int gen)
 {
     int	err = 0;
     int space = 0;
 
+    disasm_len = 0;
+    column = 0;
+
     if (inst->header.predicate_control) {
 	string (file, "(");
 	err |= control (file, "predicate inverse", pred_inv, inst->header.predicate_inverse, NULL);
@@ -1346,3 +1365,22 @@ int brw_disasm (FILE *file, struct brw_instruction *inst, int gen)
     newline (file);
     return err;
 }
+
+int brw_disasm (FILE *file, struct brw_instruction *inst, int gen)
+{
+    int err = do_disasm (file, inst, gen);
+
+    fwrite (disasm_buf, 1, disasm_len, file);
+    return err;
+}
+
+int brw_disasm_to_string (char *buf, size_t size,
+			  struct brw_instruction *inst, int gen)
+{
+    int err = do_disasm (NULL, inst, gen);
+    size_t len = disasm_len < size - 1 ? disasm_len : size - 1;
+
+    memcpy (buf, disasm_buf, len);
+    buf[len] = '\0';
+    return err;
+}
@@ -328,6 +328,76 @@ static const uint32_t *datatype_table;
 static const uint32_t *subreg_table;
 static const uint32_t *src_index_table;
 
+/*
+ * Compaction has to map an uncompacted field value back to its table
+ * index for every instruction, and scanning the 32-entry tables
+ * linearly for each field dominates when compacting whole kernels.
+ * The values are sparse (up to 19 bits), so a direct-index inverse is
+ * out; instead each table gets an open-addressed hash built once in
+ * brw_init_compaction_tables(), making the per-instruction lookups
+ * O(1).  Decompaction already indexes the tables directly.
+ */
+#define COMPACTION_HASH_SIZE 64 /* 32 entries, so at most half full */
+
+struct compaction_hash_entry {
+   uint32_t key;
+   uint8_t index;
+   bool valid;
+};
+
+typedef struct compaction_hash_entry compaction_hash[COMPACTION_HASH_SIZE];
+
+static compaction_hash control_index_hash;
+static compaction_hash datatype_hash;
+static compaction_hash subreg_hash;
+static compaction_hash src_index_hash;
+
+static unsigned
+compaction_hash_func(uint32_t key)
+{
+   return (key * 0x9e3779b9) >> (32 - 6);
+}
+
+static void
+compaction_hash_build(compaction_hash hash, const uint32_t *table)
+{
+   memset(hash, 0, sizeof(compaction_hash));
+
+   for (int i = 0; i < 32; i++) {
+      unsigned slot = compaction_hash_func(table[i]);
+
+      while (hash[slot].valid) {
+         /* Some tables repeat a value (gen6 datatypes); keep the first
+          * index like the old linear search did.
+          */
+         if (hash[slot].key == table[i])
+            goto next;
+         slot = (slot + 1) % COMPACTION_HASH_SIZE;
+      }
+      hash[slot].key = table[i];
+      hash[slot].index = i;
+      hash[slot].valid = true;
+   next:;
+   }
+}
+
+static bool
+compaction_hash_lookup(const compaction_hash hash, uint32_t key,
+                       uint32_t *index)
+{
+   unsigned slot = compaction_hash_func(key);
+
+   while (hash[slot].valid) {
+      if (hash[slot].key == key) {
+         *index = hash[slot].index;
+         return true;
+      }
+      slot = (slot + 1) % COMPACTION_HASH_SIZE;
+   }
+
+   return false;
+}
+
 static bool
 set_control_index(struct intel_context *intel,
                   struct brw_compact_instruction *dst,
@@ -335,6 +405,7 @@ set_control_index(struct intel_context *intel,
 {
    uint32_t *src_u32 = (uint32_t *)src;
    uint32_t uncompacted = 0;
+   uint32_t index;
 
    uncompacted |= ((src_u32[0] >> 8) & 0xffff) << 0;
    uncompacted |= ((src_u32[0] >> 31) & 0x1) << 16;
@@ -344,11 +415,9 @@ set_control_index(struct intel_context *intel,
    if (intel->gen >= 7)
       uncompacted |= ((src_u32[2] >> 25) & 0x3) << 17;
 
-   for (int i = 0; i < 32; i++) {
-      if (control_index_table[i] == uncompacted) {
-	 dst->dw0.control_index = i;
-	 return true;
-      }
+   if (compaction_hash_lookup(control_index_hash, uncompacted, &index)) {
+      dst->dw0.control_index = index;
+      return true;
    }
 
    return false;
@@ -359,15 +428,14 @@ set_datatype_index(struct brw_compact_instruction *dst,
                    struct brw_instruction *src)
 {
    uint32_t uncompacted = 0;
+   uint32_t index;
 
    uncompacted |= src->bits1.ud & 0x7fff;
    uncompacted |= (src->bits1.ud >> 29) << 15;
 
-   for (int i = 0; i < 32; i++) {
-      if (datatype_table[i] == uncompacted) {
-	 dst->dw0.data_type_index = i;
-	 return true;
-      }
+   if (compaction_hash_lookup(datatype_hash, uncompacted, &index)) {
+      dst->dw0.data_type_index = index;
+      return true;
    }
 
    return false;
@@ -378,16 +446,15 @@ set_subreg_index(struct brw_compact_instruction *dst,
                  struct brw_instruction *src)
 {
    uint32_t uncompacted = 0;
+   uint32_t index;
 
    uncompacted |= src->bits1.da1.dest_subreg_nr << 0;
    uncompacted |= src->bits2.da1.src0_subreg_nr << 5;
    uncompacted |= src->bits3.da1.src1_subreg_nr << 10;
 
-   for (int i = 0; i < 32; i++) {
-      if (subreg_table[i] == uncompacted) {
-	 dst->dw0.sub_reg_index = i;
-	 return true;
-      }
+   if (compaction_hash_lookup(subreg_hash, uncompacted, &index)) {
+      dst->dw0.sub_reg_index = index;
+      return true;
    }
 
    return false;
@@ -397,14 +464,7 @@ static bool
 get_src_index(uint32_t uncompacted,
               uint32_t *compacted)
 {
-   for (int i = 0; i < 32; i++) {
-      if (src_index_table[i] == uncompacted) {
-	 *compacted = i;
-	 return true;
-      }
-   }
-
-   return false;
+   return compaction_hash_lookup(src_index_hash, uncompacted, compacted);
 }
 
 static bool
@@ -662,6 +722,11 @@ brw_init_compaction_tables(struct intel_context *intel)
    default:
       return;
    }
+
+   compaction_hash_build(control_index_hash, control_index_table);
+   compaction_hash_build(datatype_hash, datatype_table);
+   compaction_hash_build(subreg_hash, subreg_table);
+   compaction_hash_build(src_index_hash, src_index_table);
 }
 
 void
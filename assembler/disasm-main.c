@@ -25,6 +25,7 @@
 #include <string.h>
 #include <getopt.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include "gen4asm.h"
 #include "brw_eu.h"
@@ -34,6 +35,87 @@ static const struct option longopts[] = {
 	{ NULL, 0, NULL, 0 }
 };
 
+/*
+ * Instruction decode is stateless per 16-byte instruction, so a large
+ * dump can be split across a thread pool and the rendered text merged
+ * back in order.  Each worker renders its contiguous slice of the
+ * instruction array into one growing buffer; the main thread joins the
+ * workers and writes the buffers out in slice order.
+ */
+struct disasm_job {
+    pthread_t			    thread;
+    struct brw_program_instruction  **insts;
+    int				    start, end;
+    int				    gen;
+    char			    *out;
+    size_t			    out_len, out_size;
+};
+
+static void *
+disasm_worker (void *arg)
+{
+    struct disasm_job *job = arg;
+    char buf[4096];
+    int i;
+
+    for (i = job->start; i < job->end; i++) {
+	size_t len;
+
+	if (job->gen >= 8)
+	    gen8_disassemble_to_string (buf, sizeof (buf),
+					&job->insts[i]->insn.gen8, job->gen);
+	else
+	    brw_disasm_to_string (buf, sizeof (buf),
+				  &job->insts[i]->insn.gen, job->gen);
+
+	len = strlen (buf);
+	if (job->out_len + len > job->out_size) {
+	    job->out_size = (job->out_size ? job->out_size * 2 : 65536);
+	    job->out = realloc (job->out, job->out_size);
+	}
+	memcpy (job->out + job->out_len, buf, len);
+	job->out_len += len;
+    }
+    return NULL;
+}
+
+static void
+disasm_parallel (FILE *output, struct brw_program *program, int gen, int jobs)
+{
+    struct brw_program_instruction  *inst, **insts;
+    struct disasm_job		    *job;
+    int				    nr_insn = 0, i;
+
+    for (inst = program->first; inst; inst = inst->next)
+	nr_insn++;
+
+    insts = malloc (nr_insn * sizeof (*insts));
+    nr_insn = 0;
+    for (inst = program->first; inst; inst = inst->next)
+	insts[nr_insn++] = inst;
+
+    if (jobs > nr_insn)
+	jobs = nr_insn ? nr_insn : 1;
+
+    job = calloc (jobs, sizeof (*job));
+    for (i = 0; i < jobs; i++) {
+	job[i].insts = insts;
+	job[i].start = nr_insn * i / jobs;
+	job[i].end = nr_insn * (i + 1) / jobs;
+	job[i].gen = gen;
+	pthread_create (&job[i].thread, NULL, disasm_worker, &job[i]);
+    }
+
+    for (i = 0; i < jobs; i++) {
+	pthread_join (job[i].thread, NULL);
+	fwrite (job[i].out, 1, job[i].out_len, output);
+	free (job[i].out);
+    }
+
+    free (job);
+    free (insts);
+}
+
 static struct brw_program *
 read_program (FILE *input)
 {
@@ -101,6 +183,7 @@ static void usage(void)
     fprintf(stderr, "\t-b, --binary                         C style binary output\n");
     fprintf(stderr, "\t-o, --output {outputfile}            Specify output file\n");
     fprintf(stderr, "\t-g, --gen <4|5|6|7|8|9>              Specify GPU generation\n");
+    fprintf(stderr, "\t-j, --jobs {threads}                 Disassemble on a thread pool\n");
 }
 
 int main(int argc, char **argv)
@@ -113,9 +196,10 @@ int main(int argc, char **argv)
     int			byte_array_input = 0;
     int			o;
     int			gen = 4;
+    int			jobs = 1;
     struct brw_program_instruction  *inst;
 
-    while ((o = getopt_long(argc, argv, "o:bg:", longopts, NULL)) != -1) {
+    while ((o = getopt_long(argc, argv, "o:bg:j:", longopts, NULL)) != -1) {
 	switch (o) {
 	case 'o':
 	    if (strcmp(optarg, "-") != 0)
@@ -132,6 +216,15 @@ int main(int argc, char **argv)
 		    exit(1);
 	    }
 
+	    break;
+	case 'j':
+	    jobs = strtol(optarg, NULL, 10);
+
+	    if (jobs < 1) {
+		    usage();
+		    exit(1);
+	    }
+
 	    break;
 	default:
 	    usage();
@@ -167,11 +260,14 @@ int main(int argc, char **argv)
 	}
     }
 
-    for (inst = program->first; inst; inst = inst->next)
-	if (gen >= 8)
-	    gen8_disassemble(output, &inst->insn.gen8, gen);
-	else
-	    brw_disasm (output, &inst->insn.gen, gen);
+    if (jobs > 1)
+	disasm_parallel (output, program, gen, jobs);
+    else
+	for (inst = program->first; inst; inst = inst->next)
+	    if (gen >= 8)
+		gen8_disassemble(output, &inst->insn.gen8, gen);
+	    else
+		brw_disasm (output, &inst->insn.gen, gen);
 
     exit (0);
 }
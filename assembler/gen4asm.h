@@ -31,6 +31,7 @@
 
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <assert.h>
 
 #include "brw_reg.h"
@@ -221,6 +222,9 @@ struct declared_register {
 struct declared_register *find_register(char *name);
 void insert_register(struct declared_register *reg);
 
+/* Assemble one input in-process; may be called repeatedly (main.c). */
+int gen4asm_assemble(char *input_file, FILE *output);
+
 int yyparse(void);
 int yylex(void);
 int yylex_destroy(void);
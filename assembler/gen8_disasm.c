@@ -261,12 +261,29 @@ static const char *const m_urb_opcode[16] = {
 
 static const char *const m_urb_interleave[2] = { "", "interleaved" };
 
-static int column;
+/*
+ * All output funnels through string()/newline(), so instead of one
+ * stdio call per operand -- which makes disassembling large captures
+ * I/O-call bound -- the helpers append to this per-instruction buffer
+ * and gen8_disassemble() writes the finished line out in a single
+ * call.  gen8_disassemble_to_string() hands out the rendered buffer
+ * directly so programmatic consumers can skip the FILE altogether.
+ * The state is per-thread so independent instructions can be rendered
+ * in parallel.
+ */
+static __thread int column;
+static __thread char disasm_buf[4096];
+static __thread size_t disasm_len;
 
 static int
 string(FILE *file, const char *string)
 {
-   fputs(string, file);
+   size_t len = strlen(string);
+
+   if (len > sizeof(disasm_buf) - 1 - disasm_len)
+      len = sizeof(disasm_buf) - 1 - disasm_len;
+   memcpy(disasm_buf + disasm_len, string, len);
+   disasm_len += len;
    column += strlen(string);
    return 0;
 }
@@ -287,7 +304,7 @@ format(FILE *f, const char *format, ...)
 static int
 newline(FILE *f)
 {
-   putc('\n', f);
+   string(f, "\n");
    column = 0;
    return 0;
 }
@@ -306,7 +323,7 @@ control(FILE *file, const char *name, const char *const ctrl[],
         unsigned id, int *space)
 {
    if (!ctrl[id]) {
-      fprintf(file, "*** invalid %s value %d ", name, id);
+      format(file, "*** invalid %s value %d ", name, id);
       return 1;
    }
    if (ctrl[id][0])
@@ -828,14 +845,17 @@ qtr_ctrl(FILE *file, struct gen8_instruction *inst)
    return 0;
 }
 
-int
-gen8_disassemble(FILE *file, struct gen8_instruction *insn, int gen)
+static int
+do_disassemble(FILE *file, struct gen8_instruction *insn, int gen)
 {
    int err = 0;
    int space = 0;
 
    const int opcode = gen8_opcode(insn);
 
+   disasm_len = 0;
+   column = 0;
+
    if (gen8_pred_control(insn)) {
       string(file, "(");
       err |= control(file, "predicate inverse", m_pred_inv, gen8_pred_inv(insn), NULL);
@@ -986,3 +1006,24 @@ gen8_disassemble(FILE *file, struct gen8_instruction *insn, int gen)
    newline(file);
    return err;
 }
+
+int
+gen8_disassemble(FILE *file, struct gen8_instruction *insn, int gen)
+{
+   int err = do_disassemble(file, insn, gen);
+
+   fwrite(disasm_buf, 1, disasm_len, file);
+   return err;
+}
+
+int
+gen8_disassemble_to_string(char *buf, size_t size,
+                           struct gen8_instruction *insn, int gen)
+{
+   int err = do_disassemble(NULL, insn, gen);
+   size_t len = disasm_len < size - 1 ? disasm_len : size - 1;
+
+   memcpy(buf, disasm_buf, len);
+   buf[len] = '\0';
+   return err;
+}
@@ -314,6 +314,10 @@ void gen8_set_dp_message(struct gen8_instruction *insn,
 /** Disassemble the instruction. */
 int gen8_disassemble(FILE *file, struct gen8_instruction *insn, int gen);
 
+/** Disassemble into a caller-provided buffer, without touching a FILE. */
+int gen8_disassemble_to_string(char *buf, size_t size,
+			       struct gen8_instruction *insn, int gen);
+
 
 /**
  * Fetch a set of contiguous bits from the instruction.
@@ -38,6 +38,7 @@
 #include "brw_eu.h"
 
 extern FILE *yyin;
+extern int yylineno;
 extern void set_branch_two_offsets(struct brw_program_instruction *insn, int jip_offset, int uip_offset);
 extern void set_branch_one_offset(struct brw_program_instruction *insn, int jip_offset);
 
@@ -71,17 +72,25 @@ typedef struct hash_item *hash_table[HASH_SIZE];
 
 static hash_table declared_register_table;
 
+/*
+ * Labels are resolved once per branch operand, so keeping them in a flat
+ * list makes relocation quadratic in program size and dominates assembly
+ * time for large media kernels.  Bucket them with the same hash used for
+ * declared registers; within a bucket, entries stay in program order so
+ * the duplicate-label search below keeps its semantics.
+ */
 struct label_item {
 	char *name;
 	int addr;
 	struct label_item *next;
 };
-static struct label_item *label_table;
+static struct label_item *label_table[HASH_SIZE];
 
 static const struct option longopts[] = {
 	{"advanced", no_argument, 0, 'a'},
 	{"binary", no_argument, 0, 'b'},
 	{"export", required_argument, 0, 'e'},
+	{"filelist", required_argument, 0, 'f'},
 	{"input_list", required_argument, 0, 'l'},
 	{"output", required_argument, 0, 'o'},
 	{"gen", required_argument, 0, 'g'},
@@ -95,6 +104,7 @@ static void usage(void)
 	fprintf(stderr, "\t-a, --advanced                       Set advanced flag\n");
 	fprintf(stderr, "\t-b, --binary                         C style binary output\n");
 	fprintf(stderr, "\t-e, --export {exportfile}            Export label file\n");
+	fprintf(stderr, "\t-f, --filelist {filelistfile}        Assemble every \"input output\" pair listed in the file\n");
 	fprintf(stderr, "\t-l, --input_list {entrytablefile}    Input entry_table_list file\n");
 	fprintf(stderr, "\t-o, --output {outputfile}            Specify output file\n");
 	fprintf(stderr, "\t-g, --gen <4|5|6|7|8|9>              Specify GPU generation\n");
@@ -155,7 +165,7 @@ void insert_register(struct declared_register *reg)
 
 static void add_label(struct brw_program_instruction *i)
 {
-    struct label_item **p = &label_table;
+    struct label_item **p = &label_table[hash(label_name(i))];
 
     assert(is_label(i));
 
@@ -173,7 +183,7 @@ static int label_to_addr(char *name, int start_addr)
     /* return the first label just after start_addr, or the first label from the head */
     struct label_item *p;
     int r = -1;
-    for(p = label_table; p; p = p->next) {
+    for(p = label_table[hash(name)]; p; p = p->next) {
         if(strcmp(p->name, name) == 0) {
             if(p->addr >= start_addr) // the first label just after start_addr
                 return p->addr;
@@ -275,91 +285,54 @@ print_instruction(FILE *output, struct brw_instruction *instruction)
 			((int *)instruction)[3]);
 	}
 }
-int main(int argc, char **argv)
+/*
+ * Reset the parser and program state so another input can be assembled
+ * in the same process.  The flex/yacc pipeline keeps its state in
+ * globals, so this supports serial reuse only; concurrent assembly
+ * would need a pure-parser rewrite.
+ */
+static void reset_assembler_state(void)
 {
-	char *output_file = NULL;
-	char *entry_table_file = NULL;
-	FILE *output = stdout;
-	FILE *export_file;
-	struct brw_program_instruction *entry, *entry1, *tmp_entry;
-	int err, inst_offset;
-	char o;
-	void *mem_ctx;
+	int i;
 
-	while ((o = getopt_long(argc, argv, "e:l:o:g:abW", longopts, NULL)) != -1) {
-		switch (o) {
-		case 'o':
-			if (strcmp(optarg, "-") != 0)
-				output_file = optarg;
-
-			break;
-
-		case 'g': {
-			char *dec_ptr, *end_ptr;
-			unsigned long decimal;
-
-			gen_level = strtol(optarg, &dec_ptr, 10) * 10;
-
-			if (*dec_ptr == '.') {
-				decimal = strtoul(++dec_ptr, &end_ptr, 10);
-				if (end_ptr != dec_ptr && *end_ptr == '\0') {
-					if (decimal > 10) {
-						fprintf(stderr, "Invalid Gen X decimal version\n");
-						exit(1);
-					}
-					gen_level += decimal;
-				}
-			}
-
-			if (gen_level < 40 || gen_level > 90) {
-				usage();
-				exit(1);
-			}
-
-			break;
-		}
-
-		case 'a':
-			advanced_flag = 1;
-			break;
-		case 'b':
-			binary_like_output = 1;
-			break;
+	free_hash_table(declared_register_table);
+	memset(declared_register_table, 0, sizeof(declared_register_table));
 
-		case 'e':
-			need_export = 1;
-			if (strcmp(optarg, "-") != 0)
-				export_filename = optarg;
-			break;
+	for (i = 0; i < HASH_SIZE; i++) {
+		free_label_table(label_table[i]);
+		label_table[i] = NULL;
+	}
 
-		case 'l':
-			if (strcmp(optarg, "-") != 0)
-				entry_table_file = optarg;
-			break;
+	compiled_program.first = NULL;
+	compiled_program.last = NULL;
 
-		case 'W':
-			warning_flags |= WARN_ALL;
-			break;
+	program_defaults.register_type = BRW_REGISTER_TYPE_F;
+	errors = 0;
+	yylineno = 1;
+}
 
-		default:
-			usage();
-			exit(1);
-		}
-	}
-	argc -= optind;
-	argv += optind;
-	if (argc != 1) {
-		usage();
-		exit(1);
-	}
+/*
+ * Assemble a single input file into output.  Callers may invoke this
+ * repeatedly (the filelist mode below does), which saves a fork/exec
+ * per kernel when building large shader corpora.
+ */
+int gen4asm_assemble(char *input_file, FILE *output)
+{
+	FILE *export_file;
+	struct brw_program_instruction *entry, *entry1, *tmp_entry;
+	int err, inst_offset;
+	void *mem_ctx;
 
-	if (strcmp(argv[0], "-") != 0) {
-		input_filename = argv[0];
+	if (strcmp(input_file, "-") != 0) {
+		input_filename = input_file;
 		yyin = fopen(input_filename, "r");
 		if (yyin == NULL) {
 			perror("Couldn't open input file");
-			exit(1);
+			return 1;
 		}
+	} else {
+		input_filename = "<stdin>";
+		yyin = stdin;
 	}
 
 	brw_init_context(&genasm_brw_context, gen_level);
@@ -368,27 +341,17 @@ int main(int argc, char **argv)
 
 	err = yyparse();
 
-	if (strcmp(argv[0], "-"))
+	if (yyin != stdin)
 		fclose(yyin);
 
 	yylex_destroy();
 
-	if (err || errors)
-		exit (1);
-
-	if (output_file) {
-		output = fopen(output_file, "w");
-		if (output == NULL) {
-			perror("Couldn't open output file");
-			exit(1);
-		}
-
+	if (err || errors) {
+		ralloc_free(mem_ctx);
+		reset_assembler_state();
+		return 1;
 	}
 
-	if (read_entry_file(entry_table_file)) {
-		fprintf(stderr, "Read entry file error\n");
-		exit(1);
-	}
 	inst_offset = 0 ;
 	for (entry = compiled_program.first;
 		entry != NULL; entry = entry->next) {
@@ -463,16 +426,185 @@ int main(int argc, char **argv)
 	if (binary_like_output)
 		fprintf(output, "};");
 
+	ralloc_free(mem_ctx);
+	reset_assembler_state();
+
+	return 0;
+}
+
+/*
+ * Assemble every "input output" pair listed in fn, one per line ('#'
+ * starts a comment), reusing this process for the whole batch.
+ */
+static int assemble_filelist(char *fn)
+{
+	FILE *list, *output;
+	char buf[2048];
+	char *input_file, *output_file, *saveptr;
+	int err = 0;
+
+	if ((list = fopen(fn, "r")) == NULL) {
+		perror("Couldn't open filelist");
+		return 1;
+	}
+
+	while (fgets(buf, sizeof(buf)-1, list) != NULL) {
+		char *comment = strchr(buf, '#');
+
+		if (comment)
+			*comment = 0;
+
+		input_file = strtok_r(buf, " \t\n", &saveptr);
+		if (!input_file)
+			continue;
+		output_file = strtok_r(NULL, " \t\n", &saveptr);
+		if (!output_file) {
+			fprintf(stderr, "filelist line needs input and output: %s\n",
+				input_file);
+			err = 1;
+			break;
+		}
+
+		output = fopen(output_file, "w");
+		if (output == NULL) {
+			perror("Couldn't open output file");
+			err = 1;
+			break;
+		}
+
+		err = gen4asm_assemble(input_file, output);
+
+		fflush(output);
+		if (ferror(output)) {
+			perror("Could not flush output file");
+			unlink(output_file);
+			err = 1;
+		}
+		fclose(output);
+
+		if (err)
+			break;
+	}
+
+	fclose(list);
+	return err;
+}
+
+int main(int argc, char **argv)
+{
+	char *output_file = NULL;
+	char *entry_table_file = NULL;
+	char *filelist_file = NULL;
+	FILE *output = stdout;
+	int err;
+	char o;
+
+	while ((o = getopt_long(argc, argv, "e:f:l:o:g:abW", longopts, NULL)) != -1) {
+		switch (o) {
+		case 'o':
+			if (strcmp(optarg, "-") != 0)
+				output_file = optarg;
+
+			break;
+
+		case 'g': {
+			char *dec_ptr, *end_ptr;
+			unsigned long decimal;
+
+			gen_level = strtol(optarg, &dec_ptr, 10) * 10;
+
+			if (*dec_ptr == '.') {
+				decimal = strtoul(++dec_ptr, &end_ptr, 10);
+				if (end_ptr != dec_ptr && *end_ptr == '\0') {
+					if (decimal > 10) {
+						fprintf(stderr, "Invalid Gen X decimal version\n");
+						exit(1);
+					}
+					gen_level += decimal;
+				}
+			}
+
+			if (gen_level < 40 || gen_level > 90) {
+				usage();
+				exit(1);
+			}
+
+			break;
+		}
+
+		case 'a':
+			advanced_flag = 1;
+			break;
+		case 'b':
+			binary_like_output = 1;
+			break;
+
+		case 'e':
+			need_export = 1;
+			if (strcmp(optarg, "-") != 0)
+				export_filename = optarg;
+			break;
+
+		case 'l':
+			if (strcmp(optarg, "-") != 0)
+				entry_table_file = optarg;
+			break;
+
+		case 'f':
+			filelist_file = optarg;
+			break;
+
+		case 'W':
+			warning_flags |= WARN_ALL;
+			break;
+
+		default:
+			usage();
+			exit(1);
+		}
+	}
+	argc -= optind;
+	argv += optind;
+
+	if (read_entry_file(entry_table_file)) {
+		fprintf(stderr, "Read entry file error\n");
+		exit(1);
+	}
+
+	if (filelist_file) {
+		if (argc != 0) {
+			usage();
+			exit(1);
+		}
+		err = assemble_filelist(filelist_file);
+		free_entry_point_table(entry_point_table);
+		return err;
+	}
+
+	if (argc != 1) {
+		usage();
+		exit(1);
+	}
+
+	if (output_file) {
+		output = fopen(output_file, "w");
+		if (output == NULL) {
+			perror("Couldn't open output file");
+			exit(1);
+		}
+
+	}
+
+	err = gen4asm_assemble(argv[0], output);
+
 	free_entry_point_table(entry_point_table);
-	free_hash_table(declared_register_table);
-	free_label_table(label_table);
 
 	fflush (output);
 	if (ferror (output)) {
 	    perror ("Could not flush output file");
-	    if (output_file)
-		unlink (output_file);
 	    err = 1;
 	}
+	if (err && output_file)
+	    unlink (output_file);
 	return err;
 }
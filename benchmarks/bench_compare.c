@@ -0,0 +1,383 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Compare two sets of machine-readable benchmark results (one CSV file per
+ * run, as emitted by the benchmarks with -o csv) and report which metrics
+ * changed with statistical significance.
+ *
+ * Each run contributes one sample per metric (the mean column), the samples
+ * from the "before" and "after" sets are compared with Welch's t-test (or
+ * the Mann-Whitney U test with -m) and only differences significant at the
+ * requested confidence level are flagged, so per-release gating stops
+ * tripping over run-to-run noise. Confidence intervals on both means are
+ * printed alongside the relative change.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <dirent.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "igt_core.h"
+#include "igt_stats.h"
+
+#define MAX_RUNS 256
+
+struct metric {
+	char *benchmark;
+	char *name;
+	char *unit;
+	igt_stats_t set[2];
+};
+
+static struct metric *metrics;
+static unsigned int nr_metrics, metrics_size;
+
+static double confidence = 95.;
+static bool mann_whitney;
+static bool show_all;
+
+/*
+ * Two-sided critical values of Student's t distribution, df = 1..30, then
+ * the normal limit. Enough resolution for gating decisions; anyone needing
+ * exact p-values has R.
+ */
+static const double t_crit_95[] = {
+	12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+	2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+	2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+};
+
+static const double t_crit_99[] = {
+	63.657, 9.925, 5.841, 4.604, 4.032, 3.707, 3.499, 3.355, 3.250, 3.169,
+	3.106, 3.055, 3.012, 2.977, 2.947, 2.921, 2.898, 2.878, 2.861, 2.845,
+	2.831, 2.819, 2.807, 2.797, 2.787, 2.779, 2.771, 2.763, 2.756, 2.750,
+};
+
+static double t_critical(double df)
+{
+	const double *table;
+	double limit;
+	int i;
+
+	if (confidence >= 99.) {
+		table = t_crit_99;
+		limit = 2.576;
+	} else {
+		table = t_crit_95;
+		limit = 1.960;
+	}
+
+	i = floor(df);
+	if (i < 1)
+		i = 1;
+	if (i > 30)
+		return limit;
+
+	return table[i - 1];
+}
+
+static struct metric *find_metric(const char *benchmark, const char *name,
+				  const char *unit)
+{
+	struct metric *m;
+	unsigned int i;
+
+	for (i = 0; i < nr_metrics; i++) {
+		m = &metrics[i];
+		if (!strcmp(m->benchmark, benchmark) &&
+		    !strcmp(m->name, name))
+			return m;
+	}
+
+	if (nr_metrics == metrics_size) {
+		metrics_size = metrics_size ? 2 * metrics_size : 16;
+		metrics = realloc(metrics, metrics_size * sizeof(*metrics));
+		igt_assert(metrics);
+	}
+
+	m = &metrics[nr_metrics++];
+	m->benchmark = strdup(benchmark);
+	m->name = strdup(name);
+	m->unit = strdup(unit);
+	igt_stats_init_with_size(&m->set[0], MAX_RUNS);
+	igt_stats_init_with_size(&m->set[1], MAX_RUNS);
+
+	return m;
+}
+
+static int parse_file(const char *path, int set)
+{
+	char line[1024];
+	FILE *file;
+
+	file = fopen(path, "r");
+	if (!file) {
+		fprintf(stderr, "Cannot open '%s'!\n", path);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), file)) {
+		char benchmark[256], name[256], unit[64];
+		unsigned int schema, samples;
+		double min, max, mean;
+		struct metric *m;
+
+		if (!strncmp(line, "schema,", 7))
+			continue; /* header */
+
+		if (sscanf(line,
+			   "%u,%255[^,],%255[^,],%63[^,],%u,%lf,%lf,%lf",
+			   &schema, benchmark, name, unit,
+			   &samples, &min, &max, &mean) != 8)
+			continue;
+
+		if (schema != 1) {
+			fprintf(stderr,
+				"%s: unsupported schema version %u!\n",
+				path, schema);
+			fclose(file);
+			return -1;
+		}
+
+		m = find_metric(benchmark, name, unit);
+		igt_stats_push_float(&m->set[set], mean);
+	}
+
+	fclose(file);
+
+	return 0;
+}
+
+static int load_set(const char *path, int set)
+{
+	struct stat st;
+
+	if (stat(path, &st)) {
+		fprintf(stderr, "Cannot stat '%s'!\n", path);
+		return -1;
+	}
+
+	if (S_ISDIR(st.st_mode)) {
+		struct dirent *de;
+		int ret = 0;
+		DIR *dir;
+
+		dir = opendir(path);
+		if (!dir)
+			return -1;
+
+		while (!ret && (de = readdir(dir))) {
+			char name[PATH_MAX];
+
+			if (de->d_name[0] == '.')
+				continue;
+
+			snprintf(name, sizeof(name), "%s/%s",
+				 path, de->d_name);
+			if (stat(name, &st) == 0 && S_ISREG(st.st_mode))
+				ret = parse_file(name, set);
+		}
+
+		closedir(dir);
+		return ret;
+	}
+
+	return parse_file(path, set);
+}
+
+/*
+ * Welch's unequal variances t-test on the per-run means. Returns true when
+ * the difference is significant at the selected confidence level and fills
+ * in the half-widths of the confidence intervals on both means.
+ */
+static bool welch_significant(igt_stats_t *a, igt_stats_t *b,
+			      double *ci_a, double *ci_b)
+{
+	double va, vb, na, nb, sea, seb, se2, t, df;
+
+	na = a->n_values;
+	nb = b->n_values;
+	va = igt_stats_get_variance(a);
+	vb = igt_stats_get_variance(b);
+
+	sea = va / na;
+	seb = vb / nb;
+	se2 = sea + seb;
+
+	*ci_a = t_critical(na - 1) * sqrt(sea);
+	*ci_b = t_critical(nb - 1) * sqrt(seb);
+
+	if (se2 == 0.)
+		return igt_stats_get_mean(a) != igt_stats_get_mean(b);
+
+	t = (igt_stats_get_mean(a) - igt_stats_get_mean(b)) / sqrt(se2);
+
+	/* Welch-Satterthwaite effective degrees of freedom. */
+	df = se2 * se2 / (sea * sea / (na - 1) + seb * seb / (nb - 1));
+
+	return fabs(t) > t_critical(df);
+}
+
+/*
+ * Mann-Whitney U with the normal approximation (reasonable from ~8 runs a
+ * side); makes no assumption about the shape of the distributions, which
+ * suits multi-modal latency results better than the t-test.
+ */
+static bool mann_whitney_significant(igt_stats_t *a, igt_stats_t *b)
+{
+	double u = 0., mu, sigma, z, z_crit;
+	unsigned int i, j;
+
+	for (i = 0; i < a->n_values; i++) {
+		for (j = 0; j < b->n_values; j++) {
+			if (a->values_f[i] > b->values_f[j])
+				u += 1.;
+			else if (a->values_f[i] == b->values_f[j])
+				u += .5;
+		}
+	}
+
+	mu = a->n_values * b->n_values / 2.;
+	sigma = sqrt(a->n_values * b->n_values *
+		     (a->n_values + b->n_values + 1) / 12.);
+	if (sigma == 0.)
+		return false;
+
+	z = (u - mu) / sigma;
+	z_crit = confidence >= 99. ? 2.576 : 1.960;
+
+	return fabs(z) > z_crit;
+}
+
+static void compare(void)
+{
+	unsigned int i, flagged = 0;
+
+	for (i = 0; i < nr_metrics; i++) {
+		struct metric *m = &metrics[i];
+		double mean_a, mean_b, ci_a, ci_b, change;
+		bool significant;
+
+		if (!m->set[0].n_values || !m->set[1].n_values) {
+			fprintf(stderr,
+				"%s/%s: present in only one result set, skipping.\n",
+				m->benchmark, m->name);
+			continue;
+		}
+
+		if (m->set[0].n_values < 2 || m->set[1].n_values < 2) {
+			fprintf(stderr,
+				"%s/%s: need at least two runs per side, skipping.\n",
+				m->benchmark, m->name);
+			continue;
+		}
+
+		mean_a = igt_stats_get_mean(&m->set[0]);
+		mean_b = igt_stats_get_mean(&m->set[1]);
+		significant = welch_significant(&m->set[0], &m->set[1],
+						&ci_a, &ci_b);
+		if (mann_whitney)
+			significant = mann_whitney_significant(&m->set[0],
+							       &m->set[1]);
+
+		if (!significant && !show_all)
+			continue;
+
+		change = mean_a != 0. ?
+			 100. * (mean_b - mean_a) / mean_a : 0.;
+
+		printf("%s/%s: %.3f ±%.3f -> %.3f ±%.3f %s (%+.2f%%)%s\n",
+		       m->benchmark, m->name,
+		       mean_a, ci_a, mean_b, ci_b, m->unit, change,
+		       significant ? "" : " [not significant]");
+
+		if (significant)
+			flagged++;
+	}
+
+	if (!flagged)
+		printf("No significant changes at %g%% confidence.\n",
+		       confidence);
+}
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [OPTIONS] <before> <after>\n\n"
+	       "  <before>/<after> are CSV result files, or directories of\n"
+	       "  them, with one file per benchmark run (benchmark -o csv).\n\n"
+	       "  -c <pct>   Confidence level, 95 (default) or 99.\n"
+	       "  -m         Use the Mann-Whitney U test instead of Welch's\n"
+	       "             t-test.\n"
+	       "  -a         Also print metrics which did not change\n"
+	       "             significantly.\n",
+	       name);
+}
+
+int main(int argc, char **argv)
+{
+	int c;
+
+	while ((c = getopt(argc, argv, "hamc:")) != -1) {
+		switch (c) {
+		case 'c':
+			confidence = atof(optarg);
+			if (confidence != 95. && confidence != 99.) {
+				fprintf(stderr,
+					"Only 95%% and 99%% confidence levels are supported!\n");
+				return 1;
+			}
+			break;
+		case 'm':
+			mann_whitney = true;
+			break;
+		case 'a':
+			show_all = true;
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			return 1;
+		}
+	}
+
+	if (argc - optind != 2) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (load_set(argv[optind], 0) || load_set(argv[optind + 1], 1))
+		return 1;
+
+	compare();
+
+	return 0;
+}
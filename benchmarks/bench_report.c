@@ -0,0 +1,280 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "igt_core.h"
+#include "bench_report.h"
+
+#define BENCH_REPORT_SCHEMA 1
+
+enum bench_report_format {
+	BENCH_REPORT_NONE,
+	BENCH_REPORT_JSON,
+	BENCH_REPORT_CSV,
+};
+
+struct bench_result {
+	const char *metric;
+	const char *unit;
+	unsigned int samples;
+	double min, max, mean;
+	double p50, p90, p99, p999;
+};
+
+static enum bench_report_format format;
+static const char *benchmark_name;
+static struct bench_result *results;
+static unsigned int nr_results, results_size;
+
+int bench_report_set_format(const char *name)
+{
+	if (!strcmp(name, "json"))
+		format = BENCH_REPORT_JSON;
+	else if (!strcmp(name, "csv"))
+		format = BENCH_REPORT_CSV;
+	else
+		return -1;
+
+	return 0;
+}
+
+bool bench_report_enabled(void)
+{
+	return format != BENCH_REPORT_NONE;
+}
+
+void bench_report_begin(const char *benchmark)
+{
+	benchmark_name = benchmark;
+	nr_results = 0;
+}
+
+static struct bench_result *add_result(const char *metric, const char *unit)
+{
+	struct bench_result *r;
+
+	if (nr_results == results_size) {
+		results_size = results_size ? 2 * results_size : 8;
+		results = realloc(results, results_size * sizeof(*results));
+		igt_assert(results);
+	}
+
+	r = &results[nr_results++];
+	memset(r, 0, sizeof(*r));
+	r->metric = metric;
+	r->unit = unit;
+
+	return r;
+}
+
+void bench_report_stats_scaled(const char *metric, const char *unit,
+			       igt_stats_t *stats, double scale)
+{
+	struct bench_result *r;
+
+	if (!bench_report_enabled())
+		return;
+
+	r = add_result(metric, unit);
+	r->samples = stats->n_values;
+	r->min = igt_stats_get_percentile(stats, 0) * scale;
+	r->max = igt_stats_get_percentile(stats, 100) * scale;
+	r->mean = igt_stats_get_mean(stats) * scale;
+	r->p50 = igt_stats_get_percentile(stats, 50) * scale;
+	r->p90 = igt_stats_get_percentile(stats, 90) * scale;
+	r->p99 = igt_stats_get_percentile(stats, 99) * scale;
+	r->p999 = igt_stats_get_percentile(stats, 99.9) * scale;
+}
+
+void bench_report_stats(const char *metric, const char *unit,
+			igt_stats_t *stats)
+{
+	bench_report_stats_scaled(metric, unit, stats, 1.);
+}
+
+void bench_report_value(const char *metric, const char *unit, double value)
+{
+	struct bench_result *r;
+
+	if (!bench_report_enabled())
+		return;
+
+	r = add_result(metric, unit);
+	r->samples = 1;
+	r->min = r->max = r->mean = value;
+	r->p50 = r->p90 = r->p99 = r->p999 = value;
+}
+
+static const struct {
+	const char *name;
+	uint32_t type;
+	uint64_t config;
+} profile_events[] = {
+	{ "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ "cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+	{ "context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+};
+#define NR_PROFILE_EVENTS (sizeof(profile_events) / sizeof(profile_events[0]))
+
+static int profile_fd[NR_PROFILE_EVENTS] = { -1, -1, -1, -1 };
+static uint64_t profile_count[NR_PROFILE_EVENTS];
+static bool profile_active, profile_counted;
+
+static bool profile_enabled(void)
+{
+	static int enabled = -1;
+
+	if (enabled < 0)
+		enabled = getenv("BENCH_PROFILE") != NULL;
+
+	return enabled;
+}
+
+void bench_profile_begin(void)
+{
+	unsigned int i;
+
+	if (!profile_enabled())
+		return;
+
+	for (i = 0; i < NR_PROFILE_EVENTS; i++) {
+		struct perf_event_attr attr;
+
+		if (profile_fd[i] >= 0)
+			continue;
+
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = profile_events[i].type;
+		attr.config = profile_events[i].config;
+		attr.disabled = 1;
+		attr.inherit = 1; /* follow the forked/threaded workers */
+
+		profile_fd[i] = syscall(__NR_perf_event_open,
+					&attr, 0, -1, -1, 0);
+	}
+
+	for (i = 0; i < NR_PROFILE_EVENTS; i++) {
+		if (profile_fd[i] < 0)
+			continue;
+
+		ioctl(profile_fd[i], PERF_EVENT_IOC_RESET, 0);
+		ioctl(profile_fd[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+
+	profile_active = true;
+}
+
+void bench_profile_end(void)
+{
+	unsigned int i;
+
+	if (!profile_active)
+		return;
+
+	for (i = 0; i < NR_PROFILE_EVENTS; i++) {
+		uint64_t value;
+
+		if (profile_fd[i] < 0)
+			continue;
+
+		ioctl(profile_fd[i], PERF_EVENT_IOC_DISABLE, 0);
+		if (read(profile_fd[i], &value, sizeof(value)) == sizeof(value))
+			profile_count[i] += value;
+	}
+
+	profile_active = false;
+	profile_counted = true;
+
+	if (!bench_report_enabled()) {
+		printf("profile:");
+		for (i = 0; i < NR_PROFILE_EVENTS; i++)
+			if (profile_fd[i] >= 0)
+				printf(" %s=%" PRIu64,
+				       profile_events[i].name,
+				       profile_count[i]);
+		printf("\n");
+	}
+}
+
+void bench_report_end(void)
+{
+	unsigned int i;
+
+	if (!bench_report_enabled())
+		return;
+
+	if (profile_counted)
+		for (i = 0; i < NR_PROFILE_EVENTS; i++)
+			if (profile_fd[i] >= 0)
+				bench_report_value(profile_events[i].name,
+						   "count", profile_count[i]);
+
+	if (format == BENCH_REPORT_JSON) {
+		printf("{\n"
+		       "  \"schema\": %u,\n"
+		       "  \"benchmark\": \"%s\",\n"
+		       "  \"results\": [\n",
+		       BENCH_REPORT_SCHEMA, benchmark_name);
+
+		for (i = 0; i < nr_results; i++) {
+			const struct bench_result *r = &results[i];
+
+			printf("    { \"metric\": \"%s\", \"unit\": \"%s\", "
+			       "\"samples\": %u, "
+			       "\"min\": %f, \"max\": %f, \"mean\": %f, "
+			       "\"p50\": %f, \"p90\": %f, \"p99\": %f, "
+			       "\"p99.9\": %f }%s\n",
+			       r->metric, r->unit, r->samples,
+			       r->min, r->max, r->mean,
+			       r->p50, r->p90, r->p99, r->p999,
+			       i + 1 < nr_results ? "," : "");
+		}
+
+		printf("  ]\n}\n");
+	} else {
+		printf("schema,benchmark,metric,unit,samples,min,max,mean,p50,p90,p99,p99.9\n");
+
+		for (i = 0; i < nr_results; i++) {
+			const struct bench_result *r = &results[i];
+
+			printf("%u,%s,%s,%s,%u,%f,%f,%f,%f,%f,%f,%f\n",
+			       BENCH_REPORT_SCHEMA, benchmark_name,
+			       r->metric, r->unit, r->samples,
+			       r->min, r->max, r->mean,
+			       r->p50, r->p90, r->p99, r->p999);
+		}
+	}
+
+	fflush(stdout);
+}
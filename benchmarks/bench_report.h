@@ -0,0 +1,61 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef BENCH_REPORT_H
+#define BENCH_REPORT_H
+
+#include "igt_stats.h"
+
+/*
+ * Machine-readable results emission shared between the benchmarks.
+ *
+ * Results accumulate in memory and are written to stdout in one go, either
+ * as JSON or CSV, carrying a schema version so the ingest side can evolve
+ * without guessing. Emission is opt-in; when no format has been selected
+ * all calls are no-ops and the benchmarks print their traditional output.
+ */
+
+int bench_report_set_format(const char *name);
+bool bench_report_enabled(void);
+
+/*
+ * Self-profiling of the measured region: when the BENCH_PROFILE
+ * environment variable is set, begin/end bracket the region with
+ * perf_event counters for cycles, instructions, cache-misses and
+ * context-switches (inherited across forks and threads), and the totals
+ * are emitted next to the primary metric so a regression report carries
+ * its microarchitectural fingerprint. Without BENCH_PROFILE both calls
+ * are no-ops. Multiple begin/end pairs accumulate.
+ */
+void bench_profile_begin(void);
+void bench_profile_end(void);
+
+void bench_report_begin(const char *benchmark);
+void bench_report_stats(const char *metric, const char *unit,
+			igt_stats_t *stats);
+void bench_report_stats_scaled(const char *metric, const char *unit,
+			       igt_stats_t *stats, double scale);
+void bench_report_value(const char *metric, const char *unit, double value);
+void bench_report_end(void);
+
+#endif /* BENCH_REPORT_H */
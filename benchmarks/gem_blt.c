@@ -41,6 +41,7 @@
 #include <time.h>
 
 #include "drm.h"
+#include "bench_report.h"
 
 #define LOCAL_I915_EXEC_NO_RELOC (1<<11)
 #define LOCAL_I915_EXEC_HANDLE_LUT (1<<12)
@@ -90,8 +91,14 @@ static int gem_linear_blt(int fd,
 			  uint32_t src,
 			  uint32_t dst,
 			  uint32_t length,
+			  unsigned tiling,
 			  struct drm_i915_gem_relocation_entry *reloc)
 {
+	/* Tiled surfaces take their pitch in dwords */
+	const uint32_t dst_pitch =
+		tiling & BLT_DST_TILED ? 16*1024/4 : 16*1024;
+	const uint32_t src_pitch =
+		tiling & BLT_SRC_TILED ? 16*1024/4 : 16*1024;
 	uint32_t *b = batch + offset/4;
 	int height = length / (16 * 1024);
 
@@ -99,10 +106,10 @@ static int gem_linear_blt(int fd,
 
 	if (height) {
 		int i = 0;
-		b[i++] = COPY_BLT_CMD | BLT_WRITE_ALPHA | BLT_WRITE_RGB;
+		b[i++] = COPY_BLT_CMD | BLT_WRITE_ALPHA | BLT_WRITE_RGB | tiling;
 		if (has_64bit_reloc)
 			b[i-1]+=2;
-		b[i++] = 0xcc << 16 | 1 << 25 | 1 << 24 | (16*1024);
+		b[i++] = 0xcc << 16 | 1 << 25 | 1 << 24 | dst_pitch;
 		b[i++] = 0;
 		b[i++] = height << 16 | (4*1024);
 		b[i++] = 0;
@@ -117,7 +124,7 @@ static int gem_linear_blt(int fd,
 			b[i++] = 0; /* FIXME */
 
 		b[i++] = 0;
-		b[i++] = 16*1024;
+		b[i++] = src_pitch;
 		b[i++] = 0;
 		reloc->offset = (b-batch+7) * sizeof(uint32_t);
 		if (has_64bit_reloc)
@@ -137,10 +144,10 @@ static int gem_linear_blt(int fd,
 
 	if (length) {
 		int i = 0;
-		b[i++] = COPY_BLT_CMD | BLT_WRITE_ALPHA | BLT_WRITE_RGB;
+		b[i++] = COPY_BLT_CMD | BLT_WRITE_ALPHA | BLT_WRITE_RGB | tiling;
 		if (has_64bit_reloc)
 			b[i-1]+=2;
-		b[i++] = 0xcc << 16 | 1 << 25 | 1 << 24 | (16*1024);
+		b[i++] = 0xcc << 16 | 1 << 25 | 1 << 24 | dst_pitch;
 		b[i++] = height << 16;
 		b[i++] = (1+height) << 16 | (length / 4);
 		b[i++] = 0;
@@ -155,7 +162,7 @@ static int gem_linear_blt(int fd,
 			b[i++] = 0; /* FIXME */
 
 		b[i++] = height << 16;
-		b[i++] = 16*1024;
+		b[i++] = src_pitch;
 		b[i++] = 0;
 		reloc->offset = (b-batch+7) * sizeof(uint32_t);
 		if (has_64bit_reloc)
@@ -189,6 +196,7 @@ static int run(int object, int batch, int time, int reps, int ncpus, unsigned fl
 	uint32_t *buf, handle, src, dst;
 	int fd, len, gen, size, nreloc;
 	int ring, count;
+	igt_stats_t bandwidth;
 	double *shared;
 
 	shared = mmap(0, 4096, PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
@@ -206,7 +214,7 @@ static int run(int object, int batch, int time, int reps, int ncpus, unsigned fl
 	src = gem_create(fd, ALIGN(object, 4096));
 	dst = gem_create(fd, ALIGN(object, 4096));
 
-	len = gem_linear_blt(fd, buf, 0, 0, 1, object, reloc);
+	len = gem_linear_blt(fd, buf, 0, 0, 1, object, 0, reloc);
 	if (has_64bit_reloc)
 		nreloc = len > 56 ? 4 : 2;
 	else
@@ -233,7 +241,7 @@ static int run(int object, int batch, int time, int reps, int ncpus, unsigned fl
 
 	if (__gem_execbuf(fd, &execbuf)) {
 		gem_set_domain(fd, handle, I915_GEM_DOMAIN_CPU, I915_GEM_DOMAIN_CPU);
-		len = gem_linear_blt(fd, buf, 0, src, dst, object, reloc);
+		len = gem_linear_blt(fd, buf, 0, src, dst, object, 0, reloc);
 		igt_assert(len == execbuf.batch_len);
 		execbuf.flags = ring;
 		gem_execbuf(fd, &execbuf);
@@ -249,7 +257,7 @@ static int run(int object, int batch, int time, int reps, int ncpus, unsigned fl
 		gem_set_domain(fd, handle, I915_GEM_DOMAIN_CPU, I915_GEM_DOMAIN_CPU);
 		for (int i = 1; i < batch; i++) {
 			len = gem_linear_blt(fd, buf, len - 8,
-					     src, dst, object,
+					     src, dst, object, 0,
 					     reloc + nreloc * i);
 		}
 		exec[2].relocation_count = nreloc * batch;
@@ -280,6 +288,9 @@ static int run(int object, int batch, int time, int reps, int ncpus, unsigned fl
 		execbuf.batch_len = 0;
 	}
 
+	igt_stats_init_with_size(&bandwidth, reps);
+
+	bench_profile_begin();
 	while (reps--) {
 		memset(shared, 0, 4096);
 
@@ -307,9 +318,182 @@ static int run(int object, int batch, int time, int reps, int ncpus, unsigned fl
 
 		for (int child = 0; child < ncpus; child++)
 			shared[ncpus] += shared[child];
-		printf("%7.3f\n", shared[ncpus] / ncpus);
+		igt_stats_push_float(&bandwidth, shared[ncpus] / ncpus);
+		if (!bench_report_enabled())
+			printf("%7.3f\n", shared[ncpus] / ncpus);
 	}
 
+	bench_profile_end();
+
+	bench_report_begin("gem_blt");
+	bench_report_stats("bandwidth", "MiB/s", &bandwidth);
+	bench_report_end();
+	igt_stats_fini(&bandwidth);
+
+	close(fd);
+	return 0;
+}
+
+/*
+ * Bandwidth table crossing buffer size, tiling and cache-domain pre-state:
+ * the same copy runs 3x faster with a LLC-hot WB source than a WC-cold one
+ * and the perf sheet wants all the cells, not whichever configuration the
+ * last invocation happened to measure.
+ *
+ * The pre-state is applied with gem_set_domain before every timed copy:
+ * "gpu" leaves the buffers wherever the previous blit put them, "cpu"
+ * moves them to the (WB, snoopable) CPU domain, "gtt" to the WC GTT
+ * domain. Each cell reports the median of a handful of individually timed
+ * copies, so the small sizes include the submission+sync overhead they
+ * would also pay in real life.
+ */
+
+static const uint32_t sweep_domains[] = {
+	0,
+	I915_GEM_DOMAIN_CPU,
+	I915_GEM_DOMAIN_GTT,
+};
+static const char *sweep_domain_names[] = { "gpu", "cpu", "gtt" };
+
+static double sweep_one(int fd, struct drm_i915_gem_execbuffer2 *execbuf,
+			uint32_t src, uint32_t dst, uint32_t handle,
+			uint64_t object, uint32_t domain)
+{
+	igt_stats_t samples;
+	double gbps;
+
+	/* Warmup, and leave a well defined state for the "gpu" column */
+	gem_execbuf(fd, execbuf);
+	gem_sync(fd, handle);
+
+	igt_stats_init_with_size(&samples, 9);
+	for (int n = 0; n < 9; n++) {
+		struct timespec start, end;
+
+		if (domain) {
+			gem_set_domain(fd, src, domain, domain);
+			gem_set_domain(fd, dst, domain, domain);
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		gem_execbuf(fd, execbuf);
+		gem_sync(fd, handle);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		igt_stats_push_float(&samples,
+				     object / elapsed(&start, &end) / 1e9);
+	}
+
+	gbps = igt_stats_get_median(&samples);
+	igt_stats_fini(&samples);
+
+	return gbps;
+}
+
+static int sweep(void)
+{
+	struct drm_i915_gem_relocation_entry reloc[4];
+	struct drm_i915_gem_execbuffer2 execbuf;
+	struct drm_i915_gem_exec_object2 exec[3];
+	const uint64_t max_size = 256ull*1024*1024;
+	int fd, gen, ring;
+	char name[64];
+
+	fd = drm_open_driver(DRIVER_INTEL);
+	gen = intel_gen(intel_get_drm_devid(fd));
+	has_64bit_reloc = gen >= 8;
+
+	ring = 0;
+	if (gen >= 6)
+		ring = I915_EXEC_BLT;
+
+	if (bench_report_enabled())
+		bench_report_begin("gem_blt");
+	else
+		printf("%10s %10s %10s %10s %10s %10s %10s (GB/s)\n",
+		       "size",
+		       "lin/gpu", "lin/cpu", "lin/gtt",
+		       "x/gpu", "x/cpu", "x/gtt");
+
+	for (uint64_t object = 4096; object <= max_size; object *= 4) {
+		/* X-tiled rows are 16KiB x 8 at our pitch */
+		const bool can_tile = gen >= 4 && object % (128*1024) == 0;
+		double cell[2][ARRAY_SIZE(sweep_domains)];
+
+		for (int tiled = 0; tiled <= can_tile; tiled++) {
+			unsigned tiling =
+				tiled ? BLT_SRC_TILED | BLT_DST_TILED : 0;
+			uint32_t src, dst, handle, *buf;
+			int len;
+
+			src = gem_create(fd, object);
+			dst = gem_create(fd, object);
+			if (tiled) {
+				gem_set_tiling(fd, src, I915_TILING_X, 16*1024);
+				gem_set_tiling(fd, dst, I915_TILING_X, 16*1024);
+			}
+
+			handle = gem_create(fd, 4096);
+			buf = gem_mmap__cpu(fd, handle, 0, 4096, PROT_WRITE);
+			len = gem_linear_blt(fd, buf, 0, src, dst, object,
+					     tiling, reloc);
+
+			memset(exec, 0, sizeof(exec));
+			exec[0].handle = src;
+			exec[1].handle = dst;
+			exec[2].handle = handle;
+			exec[2].relocs_ptr = (uintptr_t)reloc;
+			exec[2].relocation_count = has_64bit_reloc ?
+				(len > 56 ? 4 : 2) : (len > 40 ? 4 : 2);
+
+			memset(&execbuf, 0, sizeof(execbuf));
+			execbuf.buffers_ptr = (uintptr_t)exec;
+			execbuf.buffer_count = 3;
+			execbuf.batch_len = len;
+			execbuf.flags = ring;
+
+			for (int d = 0; d < ARRAY_SIZE(sweep_domains); d++)
+				cell[tiled][d] = sweep_one(fd, &execbuf,
+							   src, dst, handle,
+							   object,
+							   sweep_domains[d]);
+
+			munmap(buf, 4096);
+			gem_close(fd, handle);
+			gem_close(fd, dst);
+			gem_close(fd, src);
+		}
+
+		if (bench_report_enabled()) {
+			for (int tiled = 0; tiled <= can_tile; tiled++)
+				for (int d = 0; d < ARRAY_SIZE(sweep_domains); d++) {
+					snprintf(name, sizeof(name),
+						 "copy-%"PRIu64"KiB-%s-%s",
+						 object / 1024,
+						 tiled ? "x" : "linear",
+						 sweep_domain_names[d]);
+					bench_report_value(name, "GB/s",
+							   cell[tiled][d]);
+				}
+		} else {
+			if (object < 1024*1024)
+				printf("%7"PRIu64"KiB", object / 1024);
+			else
+				printf("%7"PRIu64"MiB", object / (1024*1024));
+			for (int d = 0; d < ARRAY_SIZE(sweep_domains); d++)
+				printf(" %10.3f", cell[0][d]);
+			for (int d = 0; d < ARRAY_SIZE(sweep_domains); d++)
+				if (can_tile)
+					printf(" %10.3f", cell[1][d]);
+				else
+					printf(" %10s", "-");
+			printf("\n");
+		}
+	}
+
+	if (bench_report_enabled())
+		bench_report_end();
+
 	close(fd);
 	return 0;
 }
@@ -324,8 +508,15 @@ int main(int argc, char **argv)
 	unsigned flags = 0;
 	int c;
 
-	while ((c = getopt (argc, argv, "CSs:b:r:t:f")) != -1) {
+	bool autosweep = false;
+
+	while ((c = getopt (argc, argv, "aCSs:b:r:t:fo:")) != -1) {
 		switch (c) {
+		case 'a':
+			/* Sweep size x tiling x cache pre-state instead */
+			autosweep = true;
+			break;
+
 		case 's':
 			size = atoi(optarg);
 			size = ALIGN(size, 4);
@@ -363,10 +554,21 @@ int main(int argc, char **argv)
 			ncpus = sysconf(_SC_NPROCESSORS_ONLN);
 			break;
 
+		case 'o':
+			if (bench_report_set_format(optarg)) {
+				fprintf(stderr, "Unknown output format '%s'!\n",
+					optarg);
+				return 1;
+			}
+			break;
+
 		default:
 			break;
 		}
 	}
 
+	if (autosweep)
+		return sweep();
+
 	return run(size, batch, time, reps, ncpus, flags);
 }
@@ -77,16 +77,103 @@ static void make_busy(int fd, uint32_t handle)
 	}
 }
 
+/*
+ * The madvise(DONTNEED)/purge/re-fault cycle: create a pool of populated
+ * objects, mark them purgeable, squeeze them out with anonymous memory
+ * pressure and then time how long bringing each object back costs. Only
+ * objects the shrinker actually purged contribute to the distribution;
+ * if the pressure was insufficient we say so rather than reporting the
+ * cheap retained path.
+ */
+static int lifecycle(int fd, int size, int reps)
+{
+	const int count = 64;
+	unsigned long purged = 0, total = 0;
+	uint32_t *handles;
+	igt_stats_t stats;
+	void *scratch;
+	int n, i;
+
+	if (size == 0)
+		size = OBJECT_SIZE;
+
+	handles = malloc(count * sizeof(*handles));
+	scratch = malloc(size);
+	memset(scratch, 0xc5, size);
+
+	igt_stats_init_with_size(&stats, reps * count);
+
+	for (n = 0; n < reps; n++) {
+		void *pressure;
+		uint64_t pressure_size = (uint64_t)count * size + (64 << 20);
+
+		for (i = 0; i < count; i++) {
+			handles[i] = gem_create(fd, size);
+			gem_write(fd, handles[i], 0, scratch, size);
+		}
+
+		for (i = 0; i < count; i++)
+			gem_madvise(fd, handles[i], I915_MADV_DONTNEED);
+
+		/* Push the purgeable pool out through the shrinker */
+		pressure = malloc(pressure_size);
+		if (pressure) {
+			memset(pressure, 0x5c, pressure_size);
+			free(pressure);
+		}
+
+		for (i = 0; i < count; i++) {
+			struct timespec start, end;
+			int retained;
+
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			retained = gem_madvise(fd, handles[i],
+					       I915_MADV_WILLNEED);
+			gem_write(fd, handles[i], 0, scratch, size);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+
+			if (!retained) {
+				purged++;
+				igt_stats_push_float(&stats,
+						     1e6 * elapsed(&start, &end));
+			}
+			total++;
+
+			gem_close(fd, handles[i]);
+		}
+	}
+
+	if (!purged) {
+		fprintf(stderr,
+			"No objects were purged; not enough memory pressure?\n");
+		return 1;
+	}
+
+	printf("%lu/%lu purged, re-materialization (us): p50 %.1f, p90 %.1f, p99 %.1f, max %.1f\n",
+	       purged, total,
+	       igt_stats_get_percentile(&stats, 50),
+	       igt_stats_get_percentile(&stats, 90),
+	       igt_stats_get_percentile(&stats, 99),
+	       igt_stats_get_percentile(&stats, 100));
+	igt_stats_fini(&stats);
+
+	free(scratch);
+	free(handles);
+
+	return 0;
+}
+
 int main(int argc, char **argv)
 {
 	int fd = drm_open_driver(DRIVER_INTEL);
 	int size = 0;
 	int busy = 0;
+	int purge = 0;
 	int reps = 13;
 	int ncpus = 1;
 	int c, n, s;
 
-	while ((c = getopt (argc, argv, "bs:r:f")) != -1) {
+	while ((c = getopt (argc, argv, "bps:r:f")) != -1) {
 		switch (c) {
 		case 's':
 			size = atoi(optarg);
@@ -106,11 +193,19 @@ int main(int argc, char **argv)
 			busy = true;
 			break;
 
+		case 'p':
+			/* Time the madvise/purge/re-fault lifecycle */
+			purge = true;
+			break;
+
 		default:
 			break;
 		}
 	}
 
+	if (purge)
+		return lifecycle(fd, size, reps);
+
 	if (size == 0) {
 		for (s = 4096; s <=  OBJECT_SIZE; s <<= 1) {
 			igt_stats_t stats;
@@ -43,6 +43,7 @@
 #include "drmtest.h"
 #include "intel_io.h"
 #include "igt_stats.h"
+#include "bench_report.h"
 
 #define LOCAL_I915_EXEC_NO_RELOC (1<<11)
 #define LOCAL_I915_EXEC_HANDLE_LUT (1<<12)
@@ -70,6 +71,140 @@ static uint32_t batch(int fd)
 	return handle;
 }
 
+/*
+ * Submission scaling across drm fds. Forks 1..max_clients processes, each
+ * opening its own fd and hammering nop execbufs for a fixed interval, and
+ * reports the aggregate throughput, the per-client spread and Jain's
+ * fairness index ((sum x)^2 / (n * sum x^2), 1.0 when every client makes
+ * equal progress) for every client count, exposing where cross-fd lock
+ * contention in the kernel submit path makes scaling collapse.
+ *
+ * With "-e all" each client is pinned to a different engine (round-robin
+ * over those present) so same-engine and cross-engine contention can be
+ * told apart.
+ */
+static int sweep(unsigned ring, int reps, int max_clients)
+{
+	unsigned all_engines[16];
+	unsigned all_nengine;
+	double *shared;
+	int n, r, fd;
+
+	shared = mmap(0, 4096, PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
+
+	/* Probe the engines once; the children inherit the result. */
+	fd = drm_open_driver(DRIVER_INTEL);
+	all_nengine = 0;
+	for (unsigned eng = 1; eng < 16; eng++) {
+		struct drm_i915_gem_exec_object2 obj;
+		struct drm_i915_gem_execbuffer2 execbuf;
+
+		memset(&obj, 0, sizeof(obj));
+		obj.handle = batch(fd);
+
+		memset(&execbuf, 0, sizeof(execbuf));
+		execbuf.buffers_ptr = (uintptr_t)&obj;
+		execbuf.buffer_count = 1;
+		execbuf.flags = eng;
+		if (__gem_execbuf(fd, &execbuf) == 0)
+			all_engines[all_nengine++] = eng;
+
+		gem_close(fd, obj.handle);
+	}
+	close(fd);
+	if (all_nengine == 0)
+		return 77;
+
+	bench_report_begin("gem_exec_nop");
+
+	for (n = 1; n <= max_clients; n++) {
+		igt_stats_t aggregate, fairness;
+
+		igt_stats_init_with_size(&aggregate, reps);
+		igt_stats_init_with_size(&fairness, reps);
+
+		for (r = 0; r < reps; r++) {
+			double sum = 0., sumsq = 0.;
+
+			memset(shared, 0, 4096);
+
+			igt_fork(child, n) {
+				struct drm_i915_gem_exec_object2 obj;
+				struct drm_i915_gem_execbuffer2 execbuf;
+				struct timespec start, end;
+				unsigned count = 0;
+				int child_fd;
+
+				child_fd = drm_open_driver(DRIVER_INTEL);
+
+				memset(&obj, 0, sizeof(obj));
+				obj.handle = batch(child_fd);
+
+				memset(&execbuf, 0, sizeof(execbuf));
+				execbuf.buffers_ptr = (uintptr_t)&obj;
+				execbuf.buffer_count = 1;
+				execbuf.flags |= LOCAL_I915_EXEC_HANDLE_LUT;
+				execbuf.flags |= LOCAL_I915_EXEC_NO_RELOC;
+				if (__gem_execbuf(child_fd, &execbuf))
+					execbuf.flags = 0;
+
+				execbuf.flags &= ~ENGINE_FLAGS;
+				if (ring == -1)
+					execbuf.flags |=
+						all_engines[child % all_nengine];
+				else
+					execbuf.flags |= ring;
+				gem_execbuf(child_fd, &execbuf);
+
+				clock_gettime(CLOCK_MONOTONIC, &start);
+				do {
+					for (int inner = 0; inner < 1024; inner++)
+						gem_execbuf(child_fd, &execbuf);
+					count += 1024;
+
+					clock_gettime(CLOCK_MONOTONIC, &end);
+				} while (elapsed(&start, &end) < 2.);
+
+				gem_sync(child_fd, obj.handle);
+				clock_gettime(CLOCK_MONOTONIC, &end);
+				shared[child] = count / elapsed(&start, &end);
+			}
+			igt_waitchildren();
+
+			for (int child = 0; child < n; child++) {
+				sum += shared[child];
+				sumsq += shared[child] * shared[child];
+			}
+
+			igt_stats_push_float(&aggregate, sum);
+			igt_stats_push_float(&fairness,
+					     sum * sum / (n * sumsq));
+		}
+
+		if (bench_report_enabled()) {
+			char name[64];
+
+			snprintf(name, sizeof(name), "aggregate-%d", n);
+			bench_report_stats(name, "execs/s", &aggregate);
+			snprintf(name, sizeof(name), "fairness-%d", n);
+			bench_report_stats(name, "index", &fairness);
+		} else {
+			printf("%3d clients: %12.1f execs/s (%11.1f per client), fairness %.3f\n",
+			       n,
+			       igt_stats_get_mean(&aggregate),
+			       igt_stats_get_mean(&aggregate) / n,
+			       igt_stats_get_mean(&fairness));
+		}
+
+		igt_stats_fini(&aggregate);
+		igt_stats_fini(&fairness);
+	}
+
+	bench_report_end();
+
+	return 0;
+}
+
 static int loop(unsigned ring, int reps, int ncpus, unsigned flags)
 {
 	struct drm_i915_gem_execbuffer2 execbuf;
@@ -78,6 +213,7 @@ static int loop(unsigned ring, int reps, int ncpus, unsigned flags)
 	unsigned all_nengine;
 	unsigned engines[16];
 	unsigned nengine;
+	igt_stats_t submit;
 	double *shared;
 	int fd;
 
@@ -121,6 +257,9 @@ static int loop(unsigned ring, int reps, int ncpus, unsigned flags)
 		engines[0] = ring;
 	}
 
+	igt_stats_init_with_size(&submit, reps);
+
+	bench_profile_begin();
 	while (reps--) {
 		memset(shared, 0, 4096);
 
@@ -168,7 +307,9 @@ static int loop(unsigned ring, int reps, int ncpus, unsigned flags)
 
 		for (int child = 0; child < ncpus; child++)
 			shared[ncpus] += shared[child];
-		printf("%7.3f\n", shared[ncpus] / ncpus);
+		igt_stats_push_float(&submit, shared[ncpus] / ncpus);
+		if (!bench_report_enabled())
+			printf("%7.3f\n", shared[ncpus] / ncpus);
 
 		obj[0].flags = 0;
 		for (int n = 0; n < nengine; n++) {
@@ -179,6 +320,14 @@ static int loop(unsigned ring, int reps, int ncpus, unsigned flags)
 		if (flags & WRITE)
 			obj[0].flags = EXEC_OBJECT_WRITE;
 	}
+
+	bench_profile_end();
+
+	bench_report_begin("gem_exec_nop");
+	bench_report_stats("submit", "us", &submit);
+	bench_report_end();
+	igt_stats_fini(&submit);
+
 	return 0;
 }
 
@@ -190,7 +339,9 @@ int main(int argc, char **argv)
 	int ncpus = 1;
 	int c;
 
-	while ((c = getopt (argc, argv, "e:r:sf")) != -1) {
+	int max_clients = 0;
+
+	while ((c = getopt (argc, argv, "e:r:sfm:o:")) != -1) {
 		switch (c) {
 		case 'e':
 			if (strcmp(optarg, "rcs") == 0)
@@ -217,6 +368,13 @@ int main(int argc, char **argv)
 			ncpus = sysconf(_SC_NPROCESSORS_ONLN);
 			break;
 
+		case 'm':
+			/* Sweep 1..N processes, each on its own fd */
+			max_clients = atoi(optarg);
+			if (max_clients < 1)
+				max_clients = 1;
+			break;
+
 		case 's':
 			flags |= SYNC;
 			break;
@@ -229,10 +387,21 @@ int main(int argc, char **argv)
 			flags |= READ_ALL;
 			break;
 
+		case 'o':
+			if (bench_report_set_format(optarg)) {
+				fprintf(stderr, "Unknown output format '%s'!\n",
+					optarg);
+				return 1;
+			}
+			break;
+
 		default:
 			break;
 		}
 	}
 
+	if (max_clients)
+		return sweep(ring, reps, max_clients);
+
 	return loop(ring, reps, ncpus, flags);
 }
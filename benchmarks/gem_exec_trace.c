@@ -91,6 +91,23 @@ struct trace_wait {
 	uint32_t handle;
 } __attribute__((packed));
 
+/* Captures come from multi-process systems: one trace file per original
+ * fd, each replayed by its own forked child so that per-client identity
+ * (separate fd, separate contexts) survives into the replay. To also
+ * reproduce the original contention pattern, the children agree on the
+ * earliest timestamp across all traces and on a common start time, then
+ * pace every submission to its original offset from that origin, scaled
+ * by the speed multiplier. A client that went idle mid-capture goes
+ * idle mid-replay, instead of all streams collapsing into one dense
+ * back-to-back burst.
+ */
+struct replay_sync {
+	uint64_t origin;
+	uint64_t epoch;
+	int clients;
+	int ready;
+};
+
 static uint32_t hars_petruska_f54_1_random(void)
 {
 	static uint32_t state = 0x12345678;
@@ -112,7 +129,104 @@ static uint32_t __gem_context_create(int fd)
 	return arg.ctx_id;
 }
 
-static double replay(const char *filename, long nop, long range)
+static uint64_t monotonic(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* The first timestamped record in the stream; only EXEC and WAIT carry
+ * timestamps, and the records before the first one are all fixed-size,
+ * so this never has to walk object lists.
+ */
+static uint64_t first_timestamp(uint8_t *ptr, uint8_t *end, int version)
+{
+	uint64_t ts;
+
+	if (version < 2)
+		return 0;
+
+	while (ptr < end) switch (*ptr++) {
+	case ADD_BO:
+		ptr += sizeof(struct trace_add_bo);
+		break;
+	case DEL_BO:
+		ptr += sizeof(struct trace_del_bo);
+		break;
+	case ADD_CTX:
+		ptr += sizeof(struct trace_add_ctx);
+		break;
+	case DEL_CTX:
+		ptr += sizeof(struct trace_del_ctx);
+		break;
+	case EXEC:
+		memcpy(&ts, ptr + sizeof(struct trace_exec), sizeof(ts));
+		return ts;
+	case WAIT:
+		memcpy(&ts, ptr + sizeof(struct trace_wait), sizeof(ts));
+		return ts;
+	default:
+		return 0;
+	}
+
+	return 0;
+}
+
+/* Rendezvous: publish our earliest timestamp, and have the last client
+ * to arrive pick the common start time a little in the future so that
+ * everyone begins paced replay together.
+ */
+static void sync_clients(struct replay_sync *sync, uint64_t first_ts)
+{
+	uint64_t origin;
+
+	origin = __atomic_load_n(&sync->origin, __ATOMIC_RELAXED);
+	while (first_ts && (origin == 0 || first_ts < origin)) {
+		if (__atomic_compare_exchange_n(&sync->origin, &origin,
+						first_ts, false,
+						__ATOMIC_RELAXED,
+						__ATOMIC_RELAXED))
+			break;
+	}
+
+	if (__atomic_add_fetch(&sync->ready, 1, __ATOMIC_ACQ_REL) ==
+	    sync->clients)
+		__atomic_store_n(&sync->epoch, monotonic() + 50000000,
+				 __ATOMIC_RELEASE);
+
+	while (!__atomic_load_n(&sync->epoch, __ATOMIC_ACQUIRE))
+		usleep(1000);
+}
+
+static void pace(const struct replay_sync *sync, double speed, uint64_t ts)
+{
+	uint64_t target, now;
+
+	target = sync->epoch + (ts - sync->origin) / speed;
+	now = monotonic();
+	if (target > now) {
+		struct timespec rem = {
+			.tv_sec = (target - now) / 1000000000,
+			.tv_nsec = (target - now) % 1000000000,
+		};
+		nanosleep(&rem, NULL);
+	}
+}
+
+/* A client that cannot even parse its trace must still show up at the
+ * rendezvous, or the others would wait for it forever.
+ */
+static double replay_failed(struct replay_sync *sync, double speed)
+{
+	if (speed > 0)
+		sync_clients(sync, 0);
+	return -1;
+}
+
+static double replay(const char *filename, long nop, long range,
+		     struct replay_sync *sync, double speed)
 {
 	struct timespec t_start, t_end;
 	struct drm_i915_gem_execbuffer2 eb = {};
@@ -124,6 +238,7 @@ static double replay(const char *filename, long nop, long range)
 	struct drm_i915_gem_exec_object2 *exec_objects = NULL;
 	uint32_t *bo, *ctx;
 	int num_bo, num_ctx;
+	int version;
 	int max_objects = 0;
 	struct stat st;
 	uint8_t *ptr, *end;
@@ -131,18 +246,18 @@ static double replay(const char *filename, long nop, long range)
 
 	fd = open(filename, O_RDONLY);
 	if (fd < 0)
-		return -1;
+		return replay_failed(sync, speed);
 
 	if (fstat(fd, &st) < 0) {
 		close(fd);
-		return -1;
+		return replay_failed(sync, speed);
 	}
 
 	ptr = mmap(0, st.st_size, PROT_WRITE, MAP_PRIVATE, fd, 0);
 	close(fd);
 
 	if (ptr == MAP_FAILED)
-		return -1;
+		return replay_failed(sync, speed);
 
 	madvise(ptr, st.st_size, MADV_SEQUENTIAL);
 	end = ptr + st.st_size;
@@ -150,13 +265,14 @@ static double replay(const char *filename, long nop, long range)
 	tv = (struct trace_version *)ptr;
 	if (tv->magic != 0xdeadbeef) {
 		fprintf(stderr, "%s: invalid magic\n", filename);
-		return -1;
+		return replay_failed(sync, speed);
 	}
-	if (tv->version != 1) {
+	if (tv->version != 1 && tv->version != 2) {
 		fprintf(stderr, "%s: unhandled version %d\n",
 			filename, tv->version);
-		return -1;
+		return replay_failed(sync, speed);
 	}
+	version = tv->version;
 	ptr = (void *)(tv + 1);
 
 	ctx = calloc(1024, sizeof(*ctx));
@@ -177,6 +293,16 @@ static double replay(const char *filename, long nop, long range)
 		gem_write(fd, bo[0], 0, &bbe, sizeof(bbe));
 	}
 
+	if (speed > 0) {
+		if (version < 2)
+			fprintf(stderr,
+				"%s: version 1 trace carries no timestamps, replaying flat out\n",
+				filename);
+		sync_clients(sync, first_timestamp(ptr, end, version));
+		if (version < 2)
+			speed = 0;
+	}
+
 	clock_gettime(CLOCK_MONOTONIC, &t_start);
 	do switch (*ptr++) {
 	case ADD_BO:
@@ -234,6 +360,19 @@ static double replay(const char *filename, long nop, long range)
 			struct trace_exec *t = (void *)ptr;
 			ptr = (void *)(t + 1);
 
+			/* v2 appends a timestamp; pace to it if asked,
+			 * replay flat out otherwise.
+			 */
+			if (version > 1) {
+				if (speed > 0) {
+					uint64_t ts;
+
+					memcpy(&ts, ptr, sizeof(ts));
+					pace(sync, speed, ts);
+				}
+				ptr += sizeof(uint64_t);
+			}
+
 			eb.buffer_count = t->object_count;
 			eb.flags = t->flags;
 			eb.rsvd1 = ctx[t->context];
@@ -290,6 +429,16 @@ static double replay(const char *filename, long nop, long range)
 			struct trace_wait *t = (void *)ptr;
 			ptr = (void *)(t + 1);
 
+			if (version > 1) {
+				if (speed > 0) {
+					uint64_t ts;
+
+					memcpy(&ts, ptr, sizeof(ts));
+					pace(sync, speed, ts);
+				}
+				ptr += sizeof(uint64_t);
+			}
+
 			assert(t->handle && t->handle < num_bo && bo[t->handle]);
 			gem_wait(fd, bo[t->handle], NULL);
 			break;
@@ -365,16 +514,21 @@ static int measure_nop(long nop)
 
 int main(int argc, char **argv)
 {
+	struct replay_sync *sync;
 	int delay = 1000;
 	double *results;
+	double speed = 0;
 	long nop = 0;
 	long range = 0;
 	int i, c;
 
 	results = mmap(NULL, ALIGN(argc*sizeof(double), 4096),
 		       PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
+	sync = mmap(NULL, ALIGN(sizeof(*sync), 4096),
+		    PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
+	memset(sync, 0, sizeof(*sync));
 
-	while ((c = getopt(argc, argv, "d:n:r:")) != -1) {
+	while ((c = getopt(argc, argv, "d:n:r:x:")) != -1) {
 		switch (c) {
 		case 'd':
 			delay = atoi(optarg);
@@ -389,6 +543,13 @@ int main(int argc, char **argv)
 			if (range > 0)
 				range = ALIGN(range, 4096);
 			break;
+		case 'x':
+			/* Pace submissions to the captured timestamps,
+			 * scaled: -x 1 replays in original time, -x 2
+			 * twice as fast. Without -x, replay flat out.
+			 */
+			speed = atof(optarg);
+			break;
 		default:
 			break;
 		}
@@ -405,8 +566,10 @@ int main(int argc, char **argv)
 		       range, (int)(delay * range / nop));
 	}
 
+	sync->clients = argc - optind;
 	igt_fork(child, argc-optind)
-		results[child] = replay(argv[child + optind], nop, range);
+		results[child] = replay(argv[child + optind], nop, range,
+					sync, speed);
 	igt_waitchildren();
 
 	for (i = 0; i < argc - optind; i++) {
@@ -0,0 +1,295 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Print a gem_exec_tracer capture as text, one line per record. The
+ * tracer writes a terse binary stream so that recording stays cheap;
+ * all the formatting happens here, offline. Timestamped records (trace
+ * version 2 onwards) also show the delta to the previous timestamp,
+ * which is the inter-submission think-time a replay reproduces.
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "drm.h"
+#include "ioctl_wrappers.h"
+#include "drmtest.h"
+
+enum {
+	ADD_BO = 0,
+	DEL_BO,
+	ADD_CTX,
+	DEL_CTX,
+	EXEC,
+	WAIT,
+};
+
+struct trace_version {
+	uint32_t magic;
+	uint32_t version;
+} __attribute__((packed));
+
+struct trace_add_bo {
+	uint32_t handle;
+	uint64_t size;
+} __attribute__((packed));
+
+struct trace_del_bo {
+	uint32_t handle;
+} __attribute__((packed));
+
+struct trace_add_ctx {
+	uint32_t handle;
+} __attribute__((packed));
+
+struct trace_del_ctx {
+	uint32_t handle;
+} __attribute__((packed));
+
+struct trace_exec {
+	uint32_t object_count;
+	uint64_t flags;
+	uint32_t context;
+} __attribute__((packed));
+
+struct trace_exec_object {
+	uint32_t handle;
+	uint32_t relocation_count;
+	uint64_t alignment;
+	uint64_t offset;
+	uint64_t flags;
+	uint64_t rsvd1;
+	uint64_t rsvd2;
+} __attribute__((packed));
+
+struct trace_wait {
+	uint32_t handle;
+} __attribute__((packed));
+
+static bool print_relocs;
+
+static const char *
+ring_name(uint64_t flags)
+{
+	switch (flags & I915_EXEC_RING_MASK) {
+	case I915_EXEC_DEFAULT:
+	case I915_EXEC_RENDER:
+		return "render";
+	case I915_EXEC_BSD:
+		return "bsd";
+	case I915_EXEC_BLT:
+		return "blt";
+	case I915_EXEC_VEBOX:
+		return "vebox";
+	default:
+		return "unknown";
+	}
+}
+
+/* Returns the delta to the previous timestamped record; the absolute
+ * CLOCK_MONOTONIC value is only meaningful within one trace.
+ */
+static uint64_t
+read_timestamp(uint8_t **ptr, uint64_t *last)
+{
+	uint64_t ts, delta;
+
+	memcpy(&ts, *ptr, sizeof(ts));
+	*ptr += sizeof(ts);
+
+	delta = *last ? ts - *last : 0;
+	*last = ts;
+
+	return delta;
+}
+
+static int
+dump(const char *filename)
+{
+	const struct trace_version *tv;
+	struct stat st;
+	uint8_t *ptr, *end;
+	uint64_t last_ts = 0;
+	int version;
+	int fd;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+		return -1;
+	}
+
+	if (fstat(fd, &st) < 0) {
+		close(fd);
+		return -1;
+	}
+
+	ptr = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (ptr == MAP_FAILED)
+		return -1;
+
+	madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+	end = ptr + st.st_size;
+
+	tv = (struct trace_version *)ptr;
+	if (tv->magic != 0xdeadbeef) {
+		fprintf(stderr, "%s: invalid magic\n", filename);
+		return -1;
+	}
+	if (tv->version != 1 && tv->version != 2) {
+		fprintf(stderr, "%s: unhandled version %d\n",
+			filename, tv->version);
+		return -1;
+	}
+	version = tv->version;
+	ptr = (void *)(tv + 1);
+
+	printf("%s: version %d\n", filename, version);
+
+	do switch (*ptr++) {
+	case ADD_BO:
+		{
+			struct trace_add_bo *t = (void *)ptr;
+			ptr = (void *)(t + 1);
+
+			printf("add-bo handle=%u size=%"PRIu64"\n",
+			       t->handle, t->size);
+			break;
+		}
+	case DEL_BO:
+		{
+			struct trace_del_bo *t = (void *)ptr;
+			ptr = (void *)(t + 1);
+
+			printf("del-bo handle=%u\n", t->handle);
+			break;
+		}
+	case ADD_CTX:
+		{
+			struct trace_add_ctx *t = (void *)ptr;
+			ptr = (void *)(t + 1);
+
+			printf("add-ctx handle=%u\n", t->handle);
+			break;
+		}
+	case DEL_CTX:
+		{
+			struct trace_del_ctx *t = (void *)ptr;
+			ptr = (void *)(t + 1);
+
+			printf("del-ctx handle=%u\n", t->handle);
+			break;
+		}
+	case EXEC:
+		{
+			struct trace_exec *t = (void *)ptr;
+			uint64_t delta = 0;
+			ptr = (void *)(t + 1);
+
+			if (version > 1)
+				delta = read_timestamp(&ptr, &last_ts);
+
+			printf("exec ctx=%u ring=%s flags=0x%"PRIx64" objects=%u +%"PRIu64"ns\n",
+			       t->context, ring_name(t->flags),
+			       t->flags, t->object_count, delta);
+
+			for (uint32_t i = 0; i < t->object_count; i++) {
+				struct trace_exec_object *to = (void *)ptr;
+				ptr = (void *)(to + 1);
+
+				printf("  object handle=%u relocs=%u offset=0x%"PRIx64" flags=0x%"PRIx64"\n",
+				       to->handle, to->relocation_count,
+				       to->offset, to->flags);
+
+				for (uint32_t j = 0; j < to->relocation_count; j++) {
+					struct drm_i915_gem_relocation_entry r;
+
+					memcpy(&r, ptr, sizeof(r));
+					ptr += sizeof(r);
+
+					if (print_relocs)
+						printf("    reloc target=%u offset=0x%"PRIx64" delta=0x%x read=0x%x write=0x%x\n",
+						       r.target_handle,
+						       (uint64_t)r.offset,
+						       r.delta,
+						       r.read_domains,
+						       r.write_domain);
+				}
+			}
+			break;
+		}
+	case WAIT:
+		{
+			struct trace_wait *t = (void *)ptr;
+			uint64_t delta = 0;
+			ptr = (void *)(t + 1);
+
+			if (version > 1)
+				delta = read_timestamp(&ptr, &last_ts);
+
+			printf("wait handle=%u +%"PRIu64"ns\n",
+			       t->handle, delta);
+			break;
+		}
+	default:
+		fprintf(stderr, "%s: unknown cmd: %x\n", filename, ptr[-1]);
+		return -1;
+	} while (ptr < end);
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int ret = 0;
+	int c;
+
+	while ((c = getopt(argc, argv, "r")) != -1) {
+		switch (c) {
+		case 'r':
+			print_relocs = true;
+			break;
+		default:
+			fprintf(stderr,
+				"usage: gem_exec_tracedump [-r] trace...\n");
+			return 1;
+		}
+	}
+
+	for (int i = optind; i < argc; i++)
+		if (dump(argv[i]))
+			ret = 1;
+
+	return ret;
+}
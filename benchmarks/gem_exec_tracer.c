@@ -35,6 +35,7 @@
 #include <sys/ioctl.h>
 #include <unistd.h>
 #include <errno.h>
+#include <time.h>
 #include <sys/mman.h>
 #include <dlfcn.h>
 #include <i915_drm.h>
@@ -48,9 +49,32 @@ static int (*libc_ioctl)(int fd, unsigned long request, void *argp);
 
 static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/* The trace is appended through a fixed mmap window over the output file,
+ * with space claimed by an atomic fetch-add on the tail. That keeps the
+ * execbuffer hot path down to a reservation, a few stores and a vDSO
+ * clock read - no stdio locks, no write() - so tracing distorts the
+ * submission timing it is trying to capture as little as possible. The
+ * window is MAP_NORESERVE so the large virtual size costs nothing until
+ * the trace actually grows into it.
+ */
+#if UINTPTR_MAX > 0xffffffff
+#define TRACE_MAP_SIZE (64ull << 30)
+#else
+#define TRACE_MAP_SIZE (256ull << 20)
+#endif
+#define TRACE_FILE_CHUNK (16ull << 20)
+
+#ifndef ALIGN
+#define ALIGN(x, y) (((x) + (y) - 1) & -(y))
+#endif
+
 struct trace {
 	int fd;
-	FILE *file;
+	int file;
+	uint8_t *map;
+	uint64_t tail;
+	uint64_t committed;
+	pthread_mutex_t grow;
 	struct trace *next;
 } *traces;
 
@@ -65,12 +89,17 @@ enum {
 	WAIT,
 };
 
+/*
+ * Version 2 appends a CLOCK_MONOTONIC timestamp (in nanoseconds) to the
+ * EXEC and WAIT records so that inter-batch think-times survive into the
+ * trace and can be reproduced on replay.
+ */
 static struct trace_verion {
 	uint32_t magic;
 	uint32_t version;
 } version = {
 	.magic = 0xdeadbeef,
-	.version = 1
+	.version = 2
 };
 
 struct trace_add_bo {
@@ -97,6 +126,7 @@ struct trace_exec {
 	uint32_t object_count;
 	uint64_t flags;
 	uint32_t context;
+	uint64_t timestamp;
 }__attribute__((packed));
 
 struct trace_exec_object {
@@ -121,8 +151,18 @@ struct trace_exec_relocation {
 struct trace_wait {
 	uint8_t cmd;
 	uint32_t handle;
+	uint64_t timestamp;
 } __attribute__((packed));
 
+static uint64_t
+gettime(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
 static void __attribute__ ((format(__printf__, 2, 3)))
 fail_if(int cond, const char *format, ...)
 {
@@ -138,6 +178,37 @@ fail_if(int cond, const char *format, ...)
 	abort();
 }
 
+static void *
+trace_reserve(struct trace *trace, size_t len)
+{
+	uint64_t offset =
+		__atomic_fetch_add(&trace->tail, len, __ATOMIC_RELAXED);
+
+	fail_if(offset + len > TRACE_MAP_SIZE, "trace too large\n");
+
+	/* Touching pages beyond the end of the backing file would SIGBUS,
+	 * so grow the file ahead of the write. Each thread covers its own
+	 * reservation, no ordering against other writers is needed, and
+	 * the ftruncate drops out of the hot path for all but one record
+	 * per chunk.
+	 */
+	if (offset + len > __atomic_load_n(&trace->committed,
+					   __ATOMIC_ACQUIRE)) {
+		pthread_mutex_lock(&trace->grow);
+		if (offset + len > trace->committed) {
+			uint64_t size = ALIGN(offset + len, TRACE_FILE_CHUNK);
+
+			fail_if(ftruncate(trace->file, size) < 0,
+				"failed to grow trace file\n");
+			__atomic_store_n(&trace->committed, size,
+					 __ATOMIC_RELEASE);
+		}
+		pthread_mutex_unlock(&trace->grow);
+	}
+
+	return trace->map + offset;
+}
+
 static void
 trace_exec(struct trace *trace,
 	   const struct drm_i915_gem_execbuffer2 *execbuffer2)
@@ -145,19 +216,33 @@ trace_exec(struct trace *trace,
 #define to_ptr(T, x) ((T *)(uintptr_t)(x))
 	const struct drm_i915_gem_exec_object2 *exec_objects =
 		to_ptr(typeof(*exec_objects), execbuffer2->buffers_ptr);
+	size_t len;
+	uint8_t *out;
 
 	fail_if(execbuffer2->flags & (I915_EXEC_FENCE_IN | I915_EXEC_FENCE_OUT),
 		"fences not supported yet\n");
 
-	flockfile(trace->file);
+	/* One reservation covers the whole record, so concurrent submitters
+	 * never interleave within it and need no lock around the stores.
+	 */
+	len = sizeof(struct trace_exec);
+	for (uint32_t i = 0; i < execbuffer2->buffer_count; i++) {
+		len += sizeof(struct trace_exec_object);
+		len += exec_objects[i].relocation_count *
+			sizeof(struct trace_exec_relocation);
+	}
+	out = trace_reserve(trace, len);
+
 	{
 		struct trace_exec t = {
 			EXEC,
 			execbuffer2->buffer_count,
 			execbuffer2->flags,
 			execbuffer2->rsvd1,
+			gettime(),
 		};
-		fwrite(&t, sizeof(t), 1, trace->file);
+		memcpy(out, &t, sizeof(t));
+		out += sizeof(t);
 	}
 
 	for (uint32_t i = 0; i < execbuffer2->buffer_count; i++) {
@@ -174,50 +259,62 @@ trace_exec(struct trace *trace,
 				obj->rsvd1,
 				obj->rsvd2
 			};
-			fwrite(&t, sizeof(t), 1, trace->file);
+			memcpy(out, &t, sizeof(t));
+			out += sizeof(t);
 		}
-		fwrite(relocs, sizeof(*relocs), obj->relocation_count,
-		       trace->file);
+		memcpy(out, relocs,
+		       obj->relocation_count * sizeof(*relocs));
+		out += obj->relocation_count * sizeof(*relocs);
 	}
-
-	fflush(trace->file);
-	funlockfile(trace->file);
 #undef to_ptr
 }
 
 static void
 trace_wait(struct trace *trace, uint32_t handle)
 {
-	struct trace_wait t = { WAIT, handle };
-	fwrite(&t, sizeof(t), 1, trace->file);
+	struct trace_wait t = { WAIT, handle, gettime() };
+	memcpy(trace_reserve(trace, sizeof(t)), &t, sizeof(t));
 }
 
 static void
 trace_add(struct trace *trace, uint32_t handle, uint64_t size)
 {
 	struct trace_add_bo t = { ADD_BO, handle, size };
-	fwrite(&t, sizeof(t), 1, trace->file);
+	memcpy(trace_reserve(trace, sizeof(t)), &t, sizeof(t));
 }
 
 static void
 trace_del(struct trace *trace, uint32_t handle)
 {
 	struct trace_del_bo t = { DEL_BO, handle };
-	fwrite(&t, sizeof(t), 1, trace->file);
+	memcpy(trace_reserve(trace, sizeof(t)), &t, sizeof(t));
 }
 
 static void
 trace_add_context(struct trace *trace, uint32_t handle)
 {
 	struct trace_add_ctx t = { ADD_CTX, handle };
-	fwrite(&t, sizeof(t), 1, trace->file);
+	memcpy(trace_reserve(trace, sizeof(t)), &t, sizeof(t));
 }
 
 static void
 trace_del_context(struct trace *trace, uint32_t handle)
 {
 	struct trace_del_ctx t = { DEL_CTX, handle };
-	fwrite(&t, sizeof(t), 1, trace->file);
+	memcpy(trace_reserve(trace, sizeof(t)), &t, sizeof(t));
+}
+
+static void
+trace_fini(struct trace *trace)
+{
+	/* The mapped stores are already in the page cache; all that is left
+	 * is to trim the chunk-aligned file back to the bytes written, or
+	 * the zero padding would parse as bogus records.
+	 */
+	fail_if(ftruncate(trace->file, trace->tail) < 0,
+		"failed to finalize trace file\n");
+	munmap(trace->map, TRACE_MAP_SIZE);
+	libc_close(trace->file);
 }
 
 int
@@ -229,7 +326,7 @@ close(int fd)
 	for (p = &traces; (t = *p); p = &t->next) {
 		if (t->fd == fd) {
 			*p = t->next;
-			fclose(t->file);
+			trace_fini(t);
 			free(t);
 			break;
 		}
@@ -309,16 +406,29 @@ ioctl(int fd, unsigned long request, ...)
 		}
 
 		sprintf(filename, "/tmp/trace-%d.%d", getpid(), fd);
-		t->file = fopen(filename, "w+");
+		t->file = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
 		t->fd = fd;
-
-		if (!fwrite(&version, sizeof(version), 1, t->file)) {
+		t->tail = 0;
+		t->committed = 0;
+		pthread_mutex_init(&t->grow, NULL);
+
+		t->map = MAP_FAILED;
+		if (t->file != -1)
+			t->map = mmap(NULL, TRACE_MAP_SIZE,
+				      PROT_READ | PROT_WRITE,
+				      MAP_SHARED | MAP_NORESERVE,
+				      t->file, 0);
+		if (t->map == MAP_FAILED) {
 			pthread_mutex_unlock(&mutex);
-			fclose(t->file);
+			if (t->file != -1)
+				libc_close(t->file);
 			free(t);
 			return -ENOMEM;
 		}
 
+		memcpy(trace_reserve(t, sizeof(version)),
+		       &version, sizeof(version));
+
 		t->next = traces;
 		traces = t;
 	}
@@ -413,3 +523,13 @@ init(void)
 	fail_if(libc_close == NULL || libc_ioctl == NULL,
 		"failed to get libc ioctl or close\n");
 }
+
+/* Applications rarely bother closing the device before exiting, so trim
+ * any still-open traces here; the records themselves need no flushing.
+ */
+static void __attribute__ ((destructor))
+fini(void)
+{
+	for (struct trace *t = traces; t; t = t->next)
+		trace_fini(t);
+}
@@ -44,6 +44,7 @@
 #include <sys/poll.h>
 #include <sys/resource.h>
 #include "drm.h"
+#include "bench_report.h"
 
 #define LOCAL_I915_EXEC_FENCE_IN              (1<<16)
 #define LOCAL_I915_EXEC_FENCE_OUT             (1<<17)
@@ -52,6 +53,10 @@
 #define REALTIME	0x2
 #define CMDPARSER	0x4
 #define FENCE_OUT	0x8
+#define HISTOGRAM	0x10
+
+#define CYCLES_TO_NS(x) (80.*(x))
+#define CYCLES_TO_US(x) (CYCLES_TO_NS(x)/1000.)
 
 static int done;
 static int fd;
@@ -101,6 +106,114 @@ inline static uint32_t read_timestamp(void)
 }
 #endif
 
+/*
+ * High-dynamic-range histogram of timestamp deltas. Values below 2^HDR_SUB_BITS
+ * ticks are recorded exactly; above that each power-of-two range is split into
+ * 2^HDR_SUB_BITS linear sub-buckets, i.e. ~3% relative resolution across the
+ * full 32bit range of the timestamp (80ns ticks, so ns up to a few minutes).
+ * Unlike the running means this keeps the tail, which is where the interesting
+ * wakeup outliers live.
+ */
+#define HDR_SUB_BITS 5
+#define HDR_SUB_COUNT (1 << HDR_SUB_BITS)
+#define HDR_BUCKETS (32 - HDR_SUB_BITS + 1)
+
+struct hdr_histogram {
+	uint64_t nr_samples;
+	uint64_t bucket[HDR_BUCKETS * HDR_SUB_COUNT];
+};
+
+static struct hdr_histogram latency_hdr, dispatch_hdr;
+static bool histogram;
+static int dump_fd = -1;
+
+#define SAMPLE_DISPATCH 0
+#define SAMPLE_LATENCY 1
+
+#define DUMP_MAGIC 0x54414c47 /* GLAT */
+#define DUMP_VERSION 1
+
+struct dump_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t tick_ns; /* duration of one timestamp tick */
+	uint32_t pad;
+};
+
+struct sample_record {
+	uint32_t type; /* SAMPLE_* */
+	uint32_t value; /* timestamp ticks */
+};
+
+static void hdr_add(struct hdr_histogram *h, uint32_t value)
+{
+	unsigned int bucket, sub, index;
+
+	if (value < HDR_SUB_COUNT) {
+		index = value;
+	} else {
+		bucket = (31 - __builtin_clz(value)) - HDR_SUB_BITS + 1;
+		sub = (value >> (bucket - 1)) - HDR_SUB_COUNT;
+		index = bucket * HDR_SUB_COUNT + sub;
+	}
+
+	__sync_fetch_and_add(&h->bucket[index], 1);
+	__sync_fetch_and_add(&h->nr_samples, 1);
+}
+
+static uint64_t hdr_bucket_midpoint(unsigned int index)
+{
+	unsigned int bucket = index / HDR_SUB_COUNT;
+	unsigned int sub = index % HDR_SUB_COUNT;
+
+	if (bucket == 0)
+		return sub;
+
+	return (((uint64_t)(HDR_SUB_COUNT + sub) << (bucket - 1)) +
+		((uint64_t)(HDR_SUB_COUNT + sub + 1) << (bucket - 1))) / 2;
+}
+
+static double hdr_percentile(const struct hdr_histogram *h, double percentile)
+{
+	uint64_t count = 0, target = percentile / 100. * h->nr_samples;
+	unsigned int i;
+
+	if (target >= h->nr_samples)
+		target = h->nr_samples - 1;
+
+	for (i = 0; i < HDR_BUCKETS * HDR_SUB_COUNT; i++) {
+		count += h->bucket[i];
+		if (count > target)
+			return hdr_bucket_midpoint(i);
+	}
+
+	return 0;
+}
+
+static void hdr_print(const struct hdr_histogram *h, const char *name)
+{
+	static const double percentiles[] = { 50, 90, 95, 99, 99.9, 99.99 };
+	unsigned int i;
+
+	printf("%s: %" PRIu64 " samples, min %.2fus",
+	       name, h->nr_samples,
+	       CYCLES_TO_US(hdr_percentile(h, 0)));
+	for (i = 0; i < ARRAY_SIZE(percentiles); i++)
+		printf(", p%g %.2fus",
+		       percentiles[i],
+		       CYCLES_TO_US(hdr_percentile(h, percentiles[i])));
+	printf(", max %.2fus\n", CYCLES_TO_US(hdr_percentile(h, 100)));
+}
+
+static void dump_sample(uint32_t type, uint32_t value)
+{
+	struct sample_record record = { type, value };
+
+	/* O_APPEND keeps the 8 byte records from the threads intact. */
+	if (write(dump_fd, &record, sizeof(record)) != sizeof(record))
+		done = true;
+}
+
 struct consumer {
 	pthread_t thread;
 
@@ -150,8 +263,6 @@ struct producer {
 
 #define RCS_TIMESTAMP (0x2000 + 0x358)
 #define BCS_TIMESTAMP (0x22000 + 0x358)
-#define CYCLES_TO_NS(x) (80.*(x))
-#define CYCLES_TO_US(x) (CYCLES_TO_NS(x)/1000.)
 
 static uint32_t create_workload(int gen, int factor)
 {
@@ -312,11 +423,19 @@ static void fence_wait(int fence)
 
 static void measure_latency(struct producer *p, struct igt_mean *mean)
 {
+	uint32_t delta;
+
 	if (!(p->latency_dispatch.execbuf.flags & LOCAL_I915_EXEC_FENCE_OUT))
 		gem_sync(fd, p->latency_dispatch.exec[0].handle);
 	else
 		fence_wait(p->latency_dispatch.execbuf.rsvd2 >> 32);
-	igt_mean_add(mean, read_timestamp() - *p->last_timestamp);
+
+	delta = read_timestamp() - *p->last_timestamp;
+	igt_mean_add(mean, delta);
+	if (histogram)
+		hdr_add(&latency_hdr, delta);
+	if (dump_fd >= 0)
+		dump_sample(SAMPLE_LATENCY, delta);
 }
 
 static void *producer(void *arg)
@@ -365,6 +484,10 @@ static void *producer(void *arg)
 		 */
 		measure_latency(p, &p->latency);
 		igt_mean_add(&p->dispatch, *p->last_timestamp - start);
+		if (histogram)
+			hdr_add(&dispatch_hdr, *p->last_timestamp - start);
+		if (dump_fd >= 0)
+			dump_sample(SAMPLE_DISPATCH, *p->last_timestamp - start);
 
 		/* Tidy up all the extra threads before we submit again. */
 		pthread_mutex_lock(&p->lock);
@@ -452,6 +575,8 @@ static int run(int seconds,
 	       nproducers, nconsumers, nop, workload, flags);
 #endif
 
+	histogram = flags & HISTOGRAM;
+
 	fd = drm_open_driver(DRIVER_INTEL);
 	gen = intel_gen(intel_get_drm_devid(fd));
 	if (gen < 6)
@@ -518,6 +643,7 @@ static int run(int seconds,
 		return IGT_EXIT_SKIP;
 #endif
 	}
+	bench_profile_begin();
 	for (n = 0; n < nproducers; n++)
 		pthread_create(&p[n].thread, &attr, producer, &p[n]);
 
@@ -547,8 +673,39 @@ static int run(int seconds,
 		}
 	}
 
+	bench_profile_end();
 	getrusage(RUSAGE_SELF, &rused);
 
+	if (histogram && !bench_report_enabled()) {
+		hdr_print(&dispatch_hdr, "dispatch");
+		hdr_print(&latency_hdr, "latency");
+	}
+
+	if (bench_report_enabled()) {
+		bench_report_begin("gem_latency");
+		bench_report_stats_scaled("dispatch", "us", &dispatch,
+					  CYCLES_TO_US(1.));
+		bench_report_stats_scaled("latency", "us", &latency,
+					  CYCLES_TO_US(1.));
+		bench_report_stats_scaled("producer-latency", "us", &platency,
+					  CYCLES_TO_US(1.));
+		bench_report_value("cpu-time-per-batch", "us",
+				   cpu_time(&rused) / complete);
+		bench_report_value("completed", "batches", complete);
+		if (histogram) {
+			bench_report_value("latency-p99", "us",
+					   CYCLES_TO_US(hdr_percentile(&latency_hdr, 99)));
+			bench_report_value("latency-p99.9", "us",
+					   CYCLES_TO_US(hdr_percentile(&latency_hdr, 99.9)));
+			bench_report_value("latency-p99.99", "us",
+					   CYCLES_TO_US(hdr_percentile(&latency_hdr, 99.99)));
+			bench_report_value("latency-max", "us",
+					   CYCLES_TO_US(hdr_percentile(&latency_hdr, 100)));
+		}
+		bench_report_end();
+		return 0;
+	}
+
 	switch ((flags >> 8) & 0xf) {
 	default:
 		printf("%d/%d: %7.3fus %7.3fus %7.3fus %7.3fus\n",
@@ -588,7 +745,7 @@ int main(int argc, char **argv)
 	unsigned flags = 0;
 	int c;
 
-	while ((c = getopt(argc, argv, "Cp:c:n:w:t:f:sRF")) != -1) {
+	while ((c = getopt(argc, argv, "Cp:c:n:w:t:f:sRFHd:o:")) != -1) {
 		switch (c) {
 		case 'p':
 			/* How many threads generate work? */
@@ -656,6 +813,42 @@ int main(int argc, char **argv)
 			flags |= FENCE_OUT;
 			break;
 
+		case 'H':
+			/* Capture full latency distributions, not just means */
+			flags |= HISTOGRAM;
+			break;
+
+		case 'd': {
+			/* Dump every sample to a binary log for offline
+			 * analysis. Note the write() per sample perturbs
+			 * the measurement itself.
+			 */
+			struct dump_header header = {
+				.magic = DUMP_MAGIC,
+				.version = DUMP_VERSION,
+				.tick_ns = CYCLES_TO_NS(1),
+			};
+
+			dump_fd = open(optarg,
+				       O_WRONLY | O_CREAT | O_TRUNC | O_APPEND,
+				       0666);
+			if (dump_fd < 0 ||
+			    write(dump_fd, &header, sizeof(header)) != sizeof(header)) {
+				fprintf(stderr, "Cannot write sample dump '%s'!\n",
+					optarg);
+				return 1;
+			}
+			break;
+		}
+
+		case 'o':
+			if (bench_report_set_format(optarg)) {
+				fprintf(stderr, "Unknown output format '%s'!\n",
+					optarg);
+				return 1;
+			}
+			break;
+
 		default:
 			break;
 		}
@@ -52,10 +52,119 @@ static double elapsed(const struct timespec *start,
 	return (end->tv_sec - start->tv_sec) + 1e-9*(end->tv_nsec - start->tv_nsec);
 }
 
+enum map {CPU, GTT, WC};
+
+static const char *map_names[] = { "cpu", "gtt", "wc" };
+
+static void *map_object(int fd, uint32_t handle, enum map map, uint64_t size)
+{
+	switch (map) {
+	case CPU:
+		return __gem_mmap__cpu(fd, handle, 0, size, PROT_WRITE);
+	case GTT:
+		return __gem_mmap__gtt(fd, handle, size, PROT_WRITE);
+	case WC:
+		return __gem_mmap__wc(fd, handle, 0, size, PROT_WRITE);
+	}
+
+	return NULL;
+}
+
+/*
+ * First-touch cost matrix: the map/unmap numbers above say nothing about
+ * the faults that dominate first-touch latency in a texture streamer.
+ * For each size and mapping type, time one write per page through a fresh
+ * mapping and report the per-page cost, both cold (new object, backing
+ * pages still to be allocated and bound) and warm (object already
+ * populated, only the PTEs are missing). drm mmaps cannot take
+ * MAP_POPULATE, so the warm column is the closest available analogue of
+ * prefaulted behaviour.
+ */
+static int fault_matrix(int fd, int reps)
+{
+	static const uint64_t sizes[] = { 1 << 16, 1 << 20, OBJECT_SIZE };
+
+	printf("%8s", "size");
+	for (int m = 0; m < 3; m++)
+		printf(" %9s/cold %9s/warm", map_names[m], map_names[m]);
+	printf(" (ns/page)\n");
+
+	for (int s = 0; s < 3; s++) {
+		const uint64_t size = sizes[s];
+		const int npages = size / 4096;
+
+		printf("%7" PRIu64 "K", size >> 10);
+
+		for (int m = 0; m < 3; m++) {
+			uint32_t warm_handle = gem_create(fd, size);
+			void *ptr;
+
+			/* Populate the warm object's backing store */
+			ptr = map_object(fd, warm_handle, m, size);
+			if (ptr) {
+				gem_set_domain(fd, warm_handle,
+					       m == CPU ? I915_GEM_DOMAIN_CPU :
+							  I915_GEM_DOMAIN_GTT,
+					       m == CPU ? I915_GEM_DOMAIN_CPU :
+							  I915_GEM_DOMAIN_GTT);
+				memset(ptr, 0, size);
+				munmap(ptr, size);
+			}
+
+			for (int warm = 0; warm <= 1; warm++) {
+				igt_stats_t stats;
+
+				igt_stats_init_with_size(&stats, reps);
+
+				for (int n = 0; n < reps; n++) {
+					struct timespec start, end;
+					uint32_t handle;
+
+					handle = warm ? warm_handle :
+						gem_create(fd, size);
+					ptr = map_object(fd, handle, m, size);
+					if (!ptr) {
+						if (!warm)
+							gem_close(fd, handle);
+						break;
+					}
+
+					clock_gettime(CLOCK_MONOTONIC, &start);
+					for (uint64_t page = 0; page < size;
+					     page += 4096)
+						*(volatile uint32_t *)
+							((char *)ptr + page) = 0;
+					clock_gettime(CLOCK_MONOTONIC, &end);
+
+					munmap(ptr, size);
+					if (!warm)
+						gem_close(fd, handle);
+
+					igt_stats_push_float(&stats,
+							     1e9 * elapsed(&start, &end) / npages);
+				}
+
+				if (stats.n_values)
+					printf(" %14.1f",
+					       igt_stats_get_median(&stats));
+				else
+					printf(" %14s", "-");
+				igt_stats_fini(&stats);
+			}
+
+			gem_close(fd, warm_handle);
+		}
+
+		printf("\n");
+	}
+
+	return 0;
+}
+
 int main(int argc, char **argv)
 {
 	int fd = drm_open_driver(DRIVER_INTEL);
-	enum map {CPU, GTT, WC} map = CPU;
+	enum map map = CPU;
 	enum dir {READ, WRITE, CLEAR, FAULT} dir = READ;
 	int tiling = I915_TILING_NONE;
 	struct timespec start, end;
@@ -66,7 +175,9 @@ int main(int argc, char **argv)
 	int loops;
 	int c;
 
-	while ((c = getopt (argc, argv, "m:d:r:t:")) != -1) {
+	int faults = 0;
+
+	while ((c = getopt (argc, argv, "m:d:r:t:F")) != -1) {
 		switch (c) {
 		case 'm':
 			if (strcmp(optarg, "cpu") == 0)
@@ -109,11 +220,19 @@ int main(int argc, char **argv)
 				reps = 1;
 			break;
 
+		case 'F':
+			/* Per-page first-touch cost matrix */
+			faults = 1;
+			break;
+
 		default:
 			break;
 		}
 	}
 
+	if (faults)
+		return fault_matrix(fd, reps > 1 ? reps : 13);
+
 	handle = gem_create(fd, OBJECT_SIZE);
 	switch (map) {
 	case CPU:
@@ -52,17 +52,133 @@ static uint64_t elapsed(const struct timespec *start,
 	return 1000000000ULL*(end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec);
 }
 
+enum dir { READ, WRITE };
+
+enum method { PRW, MAP_GTT, MAP_CPU, MAP_WC, NMETHODS };
+
+/*
+ * Settle the perennial pwrite-vs-map-and-copy argument with data: time the
+ * pread/pwrite ioctl against copies through the gtt, cpu and wc mmaps for
+ * every power-of-two size and report where each mapping overtakes the
+ * ioctl, so the per-gen thresholds in userspace libraries can be chosen
+ * from measurements rather than folklore.
+ *
+ * Each mapping is set up once and the timed region is the copy alone, with
+ * the object moved to the matching domain beforehand, mirroring how a
+ * library with a cached mapping would behave.
+ */
+static int crossover(int fd, enum dir dir, int reps)
+{
+	const char *names[NMETHODS] = {
+		dir == READ ? "pread" : "pwrite", "gtt", "cpu", "wc",
+	};
+	double means[NMETHODS][32];
+	void *buf = malloc(OBJECT_SIZE);
+	void *map[NMETHODS] = {};
+	uint32_t handle;
+	int nsizes = 0;
+	int c, size, m;
+
+	handle = gem_create(fd, OBJECT_SIZE);
+	map[MAP_GTT] = __gem_mmap__gtt(fd, handle, OBJECT_SIZE,
+				       PROT_READ | PROT_WRITE);
+	map[MAP_CPU] = __gem_mmap__cpu(fd, handle, 0, OBJECT_SIZE,
+				       PROT_READ | PROT_WRITE);
+	map[MAP_WC] = __gem_mmap__wc(fd, handle, 0, OBJECT_SIZE,
+				     PROT_READ | PROT_WRITE);
+
+	printf("%8s", "size");
+	for (m = 0; m < NMETHODS; m++)
+		printf(" %9s", names[m]);
+	printf(" (us)\n");
+
+	for (size = 1; size <= OBJECT_SIZE; size <<= 1, nsizes++) {
+		for (m = 0; m < NMETHODS; m++) {
+			igt_stats_t stats;
+			int n;
+
+			means[m][nsizes] = -1;
+			if (m != PRW && !map[m])
+				continue;
+
+			igt_stats_init_with_size(&stats, reps);
+
+			for (n = 0; n < reps; n++) {
+				struct timespec start, end;
+				int domain = m == MAP_CPU ?
+					I915_GEM_DOMAIN_CPU :
+					I915_GEM_DOMAIN_GTT;
+
+				gem_set_domain(fd, handle, domain, domain);
+
+				clock_gettime(CLOCK_MONOTONIC, &start);
+				switch (m) {
+				case PRW:
+					if (dir == READ)
+						gem_read(fd, handle, 0,
+							 buf, size);
+					else
+						gem_write(fd, handle, 0,
+							  buf, size);
+					break;
+				default:
+					if (dir == READ)
+						memcpy(buf, map[m], size);
+					else
+						memcpy(map[m], buf, size);
+					break;
+				}
+				clock_gettime(CLOCK_MONOTONIC, &end);
+
+				igt_stats_push(&stats, elapsed(&start, &end));
+			}
+
+			means[m][nsizes] = igt_stats_get_trimean(&stats);
+			igt_stats_fini(&stats);
+		}
+
+		printf("%8d", size);
+		for (m = 0; m < NMETHODS; m++) {
+			if (means[m][nsizes] < 0)
+				printf(" %9s", "-");
+			else
+				printf(" %9.3f", means[m][nsizes] / 1000);
+		}
+		printf("\n");
+	}
+
+	for (m = MAP_GTT; m < NMETHODS; m++) {
+		if (!map[m])
+			continue;
+
+		for (c = 0; c < nsizes; c++)
+			if (means[m][c] < means[PRW][c])
+				break;
+
+		if (c < nsizes)
+			printf("crossover %s -> %s: %d bytes\n",
+			       names[PRW], names[m], 1 << c);
+		else
+			printf("crossover %s -> %s: never\n",
+			       names[PRW], names[m]);
+	}
+
+	free(buf);
+	return 0;
+}
+
 int main(int argc, char **argv)
 {
 	int fd = drm_open_driver(DRIVER_INTEL);
 	int domain = I915_GEM_DOMAIN_GTT;
-	enum dir { READ, WRITE } dir = READ;
+	enum dir dir = READ;
 	void *buf = malloc(OBJECT_SIZE);
 	uint32_t handle;
 	int reps = 13;
+	int xover = 0;
 	int c, size;
 
-	while ((c = getopt (argc, argv, "D:d:r:")) != -1) {
+	while ((c = getopt (argc, argv, "cD:d:r:")) != -1) {
 		switch (c) {
 		case 'd':
 			if (strcmp(optarg, "cpu") == 0)
@@ -85,11 +201,19 @@ int main(int argc, char **argv)
 				reps = 1;
 			break;
 
+		case 'c':
+			/* Compare against the mmap copy paths */
+			xover = 1;
+			break;
+
 		default:
 			break;
 		}
 	}
 
+	if (xover)
+		return crossover(fd, dir, reps);
+
 	handle = gem_create(fd, OBJECT_SIZE);
 	for (size = 1; size <= OBJECT_SIZE; size <<= 1) {
 		igt_stats_t stats;
@@ -55,6 +55,68 @@ struct gem_busyspin {
 	unsigned long count;
 };
 
+/*
+ * cyclictest-style breaktrace: when a wakeup latency sample exceeds the
+ * threshold, snapshot the i915 engine state from debugfs into a ring of
+ * incident records so the stall can be attributed to whatever the GPU was
+ * executing at that moment. The debugfs read happens in the woken RT
+ * thread and perturbs the next few samples; that is the price of catching
+ * the culprit red-handed.
+ */
+#define MAX_INCIDENTS 16
+
+struct incident {
+	struct timespec when;
+	double latency_ns;
+	char state[4096];
+};
+
+static struct incident incidents[MAX_INCIDENTS];
+static unsigned long nr_incidents;
+static pthread_mutex_t incident_lock = PTHREAD_MUTEX_INITIALIZER;
+static double breaktrace_ns;
+static const char *breaktrace_file;
+static int breaktrace_fd = -1;
+
+static void record_incident(double latency)
+{
+	struct incident *incident;
+
+	pthread_mutex_lock(&incident_lock);
+	incident = &incidents[nr_incidents++ % MAX_INCIDENTS];
+	clock_gettime(CLOCK_MONOTONIC, &incident->when);
+	incident->latency_ns = latency;
+	__igt_debugfs_read(breaktrace_fd, breaktrace_file,
+			   incident->state, sizeof(incident->state));
+	pthread_mutex_unlock(&incident_lock);
+}
+
+static void report_incidents(void)
+{
+	unsigned long first = 0, n;
+
+	if (!nr_incidents)
+		return;
+
+	if (nr_incidents > MAX_INCIDENTS)
+		first = nr_incidents - MAX_INCIDENTS;
+
+	printf("%lu incidents above breaktrace threshold, last %lu recorded:\n",
+	       nr_incidents, nr_incidents - first);
+	for (n = first; n < nr_incidents; n++) {
+		const struct incident *incident =
+			&incidents[n % MAX_INCIDENTS];
+
+		printf("incident %lu: @%ld.%03lds latency %.3fus, %s:\n%s\n",
+		       n,
+		       (long)incident->when.tv_sec,
+		       incident->when.tv_nsec / 1000000,
+		       incident->latency_ns / 1000,
+		       breaktrace_file,
+		       incident->state);
+	}
+}
+
 struct sys_wait {
 	pthread_t thread;
 	struct igt_mean mean;
@@ -174,6 +236,8 @@ static void *sys_wait(void *arg)
 		sigwait(&mask, &sigs);
 		clock_gettime(CLOCK_MONOTONIC, &now);
 		igt_mean_add(&w->mean, elapsed(&its.it_value, &now));
+		if (breaktrace_ns && elapsed(&its.it_value, &now) > breaktrace_ns)
+			record_incident(elapsed(&its.it_value, &now));
 	}
 
 	sigprocmask(SIG_UNBLOCK, &mask, NULL);
@@ -244,11 +308,17 @@ int main(int argc, char **argv)
 	int enable_gem_sysbusy = 1;
 	int n, c;
 
-	while ((c = getopt(argc, argv, "t:f:n")) != -1) {
+	while ((c = getopt(argc, argv, "t:f:b:n")) != -1) {
 		switch (c) {
 		case 'n': /* dry run, measure baseline system latency */
 			enable_gem_sysbusy = 0;
 			break;
+		case 'b':
+			/* Snapshot engine state when a sample exceeds this
+			 * threshold (us)
+			 */
+			breaktrace_ns = 1000. * atof(optarg);
+			break;
 		case 't':
 			/* How long to run the benchmark for (seconds) */
 			time = atoi(optarg);
@@ -268,6 +338,26 @@ int main(int argc, char **argv)
 	force_low_latency();
 	min = min_measurement_error();
 
+	if (breaktrace_ns) {
+		int dfd;
+
+		breaktrace_fd = drm_open_driver(DRIVER_INTEL);
+		breaktrace_file = "i915_engine_info";
+		dfd = igt_debugfs_open(breaktrace_fd, breaktrace_file,
+				       O_RDONLY);
+		if (dfd < 0) {
+			breaktrace_file = "i915_gem_request";
+			dfd = igt_debugfs_open(breaktrace_fd, breaktrace_file,
+					       O_RDONLY);
+		}
+		if (dfd < 0) {
+			fprintf(stderr,
+				"No suitable debugfs engine state file found!\n");
+			return 1;
+		}
+		close(dfd);
+	}
+
 	busy = calloc(ncpus, sizeof(*busy));
 	pthread_attr_init(&attr);
 	if (enable_gem_sysbusy) {
@@ -324,6 +414,9 @@ int main(int argc, char **argv)
 		break;
 	}
 
+	if (breaktrace_ns)
+		report_incidents();
+
 	return 0;
 
 }
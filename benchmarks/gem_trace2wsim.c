@@ -0,0 +1,442 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Convert a gem_exec_tracer capture into a gem_wsim workload descriptor.
+ *
+ * The trace records the submitted batches (engine selection, context and
+ * buffer lists) and, from trace version 2 onwards, the CPU timestamps of
+ * each submission and wait. From that we reconstruct:
+ *
+ *  - one batch step per execbuf, on the traced engine and context,
+ *  - data dependencies from last-writer tracking over the object lists,
+ *  - sync steps for explicit waits,
+ *  - think-time delay steps from the inter-submission timestamps, scaled
+ *    by an optional speed factor.
+ *
+ * Batch durations are not recoverable from the trace (only the kernel
+ * knows how long a batch ran) so a fixed duration, or random range, is
+ * substituted via -D. The emitted .wsim text then replays through gem_wsim
+ * with all of its usual knobs (-r, -c, -b, ...) available.
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "drm.h"
+#include "ioctl_wrappers.h"
+#include "drmtest.h"
+
+enum {
+	ADD_BO = 0,
+	DEL_BO,
+	ADD_CTX,
+	DEL_CTX,
+	EXEC,
+	WAIT,
+};
+
+struct trace_version {
+	uint32_t magic;
+	uint32_t version;
+} __attribute__((packed));
+
+struct trace_add_bo {
+	uint32_t handle;
+	uint64_t size;
+} __attribute__((packed));
+
+struct trace_del_bo {
+	uint32_t handle;
+} __attribute__((packed));
+
+struct trace_add_ctx {
+	uint32_t handle;
+} __attribute__((packed));
+
+struct trace_del_ctx {
+	uint32_t handle;
+} __attribute__((packed));
+
+struct trace_exec {
+	uint32_t object_count;
+	uint64_t flags;
+	uint32_t context;
+} __attribute__((packed));
+
+struct trace_exec_object {
+	uint32_t handle;
+	uint32_t relocation_count;
+	uint64_t alignment;
+	uint64_t offset;
+	uint64_t flags;
+	uint64_t rsvd1;
+	uint64_t rsvd2;
+} __attribute__((packed));
+
+struct trace_wait {
+	uint32_t handle;
+} __attribute__((packed));
+
+struct bo_state {
+	uint32_t last_write;	/* 1-based step index of the last writer */
+	uint32_t last_use;	/* 1-based step index of the last user */
+};
+
+static const char *
+engine_name(uint64_t flags)
+{
+	switch (flags & I915_EXEC_RING_MASK) {
+	case I915_EXEC_DEFAULT:
+	case I915_EXEC_RENDER:
+		return "RCS";
+	case I915_EXEC_BSD:
+		switch (flags & (3 << 13)) {
+		case I915_EXEC_BSD_RING1:
+			return "VCS1";
+		case I915_EXEC_BSD_RING2:
+			return "VCS2";
+		default:
+			return "VCS";
+		}
+	case I915_EXEC_BLT:
+		return "BCS";
+	case I915_EXEC_VEBOX:
+		return "VECS";
+	default:
+		return NULL;
+	}
+}
+
+static int
+convert(const char *filename, FILE *out, const char *duration, double speed)
+{
+	struct trace_version *tv;
+	struct bo_state *bo;
+	uint32_t *ctx;
+	uint32_t num_bo, num_ctx, next_ctx = 0;
+	uint32_t step = 0;
+	uint64_t last_ts = 0;
+	int version;
+	struct stat st;
+	uint8_t *ptr, *end;
+	int fd;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+		return -1;
+	}
+
+	if (fstat(fd, &st) < 0) {
+		close(fd);
+		return -1;
+	}
+
+	ptr = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (ptr == MAP_FAILED)
+		return -1;
+
+	madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+	end = ptr + st.st_size;
+
+	tv = (struct trace_version *)ptr;
+	if (tv->magic != 0xdeadbeef) {
+		fprintf(stderr, "%s: invalid magic\n", filename);
+		return -1;
+	}
+	if (tv->version != 1 && tv->version != 2) {
+		fprintf(stderr, "%s: unhandled version %d\n",
+			filename, tv->version);
+		return -1;
+	}
+	version = tv->version;
+	if (version < 2)
+		fprintf(stderr,
+			"%s: version 1 trace carries no timestamps, think-times will not be reproduced\n",
+			filename);
+	ptr = (void *)(tv + 1);
+
+	bo = calloc(4096, sizeof(*bo));
+	num_bo = 4096;
+
+	ctx = calloc(1024, sizeof(*ctx));
+	num_ctx = 1024;
+
+	do switch (*ptr++) {
+	case ADD_BO:
+		{
+			struct trace_add_bo *t = (void *)ptr;
+			ptr = (void *)(t + 1);
+
+			if (t->handle >= num_bo) {
+				uint32_t new_bo = ALIGN(t->handle + 1, 4096);
+				bo = realloc(bo, sizeof(*bo)*new_bo);
+				memset(bo + num_bo, 0, sizeof(*bo)*(new_bo - num_bo));
+				num_bo = new_bo;
+			}
+
+			memset(&bo[t->handle], 0, sizeof(*bo));
+			break;
+		}
+	case DEL_BO:
+		{
+			struct trace_del_bo *t = (void *)ptr;
+			ptr = (void *)(t + 1);
+
+			memset(&bo[t->handle], 0, sizeof(*bo));
+			break;
+		}
+	case ADD_CTX:
+		{
+			struct trace_add_ctx *t = (void *)ptr;
+			ptr = (void *)(t + 1);
+
+			if (t->handle >= num_ctx) {
+				uint32_t new_ctx = ALIGN(t->handle + 1, 1024);
+				ctx = realloc(ctx, sizeof(*ctx)*new_ctx);
+				memset(ctx + num_ctx, 0, sizeof(*ctx)*(new_ctx - num_ctx));
+				num_ctx = new_ctx;
+			}
+
+			ctx[t->handle] = ++next_ctx;
+			break;
+		}
+	case DEL_CTX:
+		{
+			struct trace_del_ctx *t = (void *)ptr;
+			ptr = (void *)(t + 1);
+
+			ctx[t->handle] = 0;
+			break;
+		}
+	case EXEC:
+		{
+			struct trace_exec *t = (void *)ptr;
+			const char *engine;
+			uint64_t ts = 0;
+			bool first_dep = true;
+			uint32_t i;
+
+			ptr = (void *)(t + 1);
+			if (version > 1) {
+				memcpy(&ts, ptr, sizeof(ts));
+				ptr += sizeof(ts);
+			}
+
+			engine = engine_name(t->flags);
+			if (!engine) {
+				fprintf(stderr,
+					"unknown engine selector %#" PRIx64 "\n",
+					t->flags & I915_EXEC_RING_MASK);
+				return -1;
+			}
+
+			if (last_ts && ts > last_ts) {
+				unsigned long delay =
+					(ts - last_ts) / 1000 / speed;
+
+				if (delay) {
+					fprintf(out, "d.%lu\n", delay);
+					step++;
+				}
+			}
+			if (ts)
+				last_ts = ts;
+
+			step++;
+			fprintf(out, "%u.%s.%s.",
+				t->context < num_ctx ? ctx[t->context] : 0,
+				engine, duration);
+
+			/*
+			 * A batch reading a buffer depends on the last batch
+			 * that wrote it. Writes are flagged either on the
+			 * object itself or by a reloc with a write domain.
+			 */
+			for (i = 0; i < t->object_count; i++) {
+				struct trace_exec_object *to = (void *)ptr;
+				struct drm_i915_gem_relocation_entry *relocs =
+					(void *)(to + 1);
+				uint32_t j;
+
+				ptr = (void *)(relocs + to->relocation_count);
+
+				if (to->handle >= num_bo)
+					continue;
+
+				if (bo[to->handle].last_write &&
+				    bo[to->handle].last_write != step) {
+					fprintf(out, "%s%d",
+						first_dep ? "" : "/",
+						(int)bo[to->handle].last_write -
+						(int)step);
+					first_dep = false;
+				}
+
+				bo[to->handle].last_use = step;
+				if (to->flags & EXEC_OBJECT_WRITE)
+					bo[to->handle].last_write = step;
+
+				if (t->flags & I915_EXEC_HANDLE_LUT)
+					continue;
+
+				for (j = 0; j < to->relocation_count; j++) {
+					uint32_t target = relocs[j].target_handle;
+
+					if (!relocs[j].write_domain ||
+					    target >= num_bo)
+						continue;
+
+					bo[target].last_write = step;
+					bo[target].last_use = step;
+				}
+			}
+
+			if (first_dep)
+				fprintf(out, "0");
+			fprintf(out, ".0\n");
+			break;
+		}
+	case WAIT:
+		{
+			struct trace_wait *t = (void *)ptr;
+			uint64_t ts;
+
+			ptr = (void *)(t + 1);
+			if (version > 1) {
+				memcpy(&ts, ptr, sizeof(ts));
+				ptr += sizeof(ts);
+				if (ts)
+					last_ts = ts;
+			}
+
+			if (t->handle < num_bo && bo[t->handle].last_use) {
+				step++;
+				fprintf(out, "s.%d\n",
+					(int)bo[t->handle].last_use -
+					(int)step);
+			}
+			break;
+		}
+	default:
+		fprintf(stderr, "Unknown cmd: %x\n", *(ptr - 1));
+		return -1;
+	} while (ptr < end);
+
+	free(ctx);
+	free(bo);
+
+	if (!step) {
+		fprintf(stderr, "%s: no batches found in trace\n", filename);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [options] <trace-file>\n\n", name);
+	printf("\t-o <file>\tOutput file. (default stdout)\n");
+	printf("\t-D <us>[-<us>]\tBatch duration, or random range, to substitute\n");
+	printf("\t\t\tfor the traced batches. (default 1000)\n");
+	printf("\t-x <f>\t\tSpeed factor applied to the recorded think-times.\n");
+	printf("\t\t\tLarger is faster, eg. 2 halves all delays. (default 1)\n");
+	printf("\n");
+	printf("\tThe emitted workload descriptor is replayed with gem_wsim.\n");
+}
+
+int main(int argc, char **argv)
+{
+	const char *duration = "1000";
+	const char *output = NULL;
+	double speed = 1.0;
+	FILE *out = stdout;
+	unsigned long min, max;
+	char *endp;
+	int c, ret;
+
+	while ((c = getopt(argc, argv, "o:D:x:h")) != -1) {
+		switch (c) {
+		case 'o':
+			output = optarg;
+			break;
+		case 'D':
+			min = strtoul(optarg, &endp, 0);
+			max = min;
+			if (*endp == '-')
+				max = strtoul(endp + 1, &endp, 0);
+			if (*endp || !min || max < min) {
+				fprintf(stderr, "Invalid duration '%s'!\n",
+					optarg);
+				return 1;
+			}
+			duration = optarg;
+			break;
+		case 'x':
+			speed = strtod(optarg, &endp);
+			if (*endp || speed <= 0.0) {
+				fprintf(stderr, "Invalid speed factor '%s'!\n",
+					optarg);
+				return 1;
+			}
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			return 1;
+		}
+	}
+
+	if (optind + 1 != argc) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (output) {
+		out = fopen(output, "w");
+		if (!out) {
+			fprintf(stderr, "%s: %s\n", output, strerror(errno));
+			return 1;
+		}
+	}
+
+	ret = convert(argv[optind], out, duration, speed);
+
+	if (output)
+		fclose(out);
+
+	return ret ? 1 : 0;
+}
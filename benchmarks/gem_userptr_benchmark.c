@@ -43,6 +43,7 @@
 #include <sys/time.h>
 #include <sys/mman.h>
 #include <signal.h>
+#include <time.h>
 
 #include "drm.h"
 #include "i915_drm.h"
@@ -53,6 +54,11 @@
 #include "intel_chipset.h"
 #include "ioctl_wrappers.h"
 #include "igt_aux.h"
+#include "igt_stats.h"
+
+#ifndef MADV_HUGEPAGE
+#define MADV_HUGEPAGE 14
+#endif
 
 #ifndef PAGE_SIZE
   #define PAGE_SIZE 4096
@@ -452,6 +458,94 @@ static void test_multiple(int fd, unsigned int batch, int random)
 	printf("%8lu iter/s\n", iter * batch / test_duration_sec);
 }
 
+/*
+ * Simulated zero-copy capture-process-display pipeline: frames arrive as
+ * CPU writes into a small ring of anonymous buffers, each frame is then
+ * imported as a fresh userptr object and handed to the GPU, and finally
+ * waited upon before the buffer is reused. The execbuf that first pins a
+ * new object is where get_pages lives, so its latency distribution is
+ * reported alongside the steady-state bandwidth. With hugepage backing
+ * the buffers are THP-sized and marked MADV_HUGEPAGE to show how the
+ * pipeline interacts with transparent huge pages.
+ */
+#define STREAM_BUFS 4
+#define STREAM_SIZE (2 * 1024 * 1024)
+
+static void test_streaming(int fd, int hugepage)
+{
+	const uint32_t bbe = MI_BATCH_BUFFER_END;
+	struct drm_i915_gem_exec_object2 obj[2];
+	struct drm_i915_gem_execbuffer2 execbuf;
+	char *buf[STREAM_BUFS];
+	igt_stats_t stalls;
+	unsigned long iter = 0;
+	uint32_t batch_handle;
+	int i;
+
+	for (i = 0; i < STREAM_BUFS; i++) {
+		buf[i] = mmap(NULL, STREAM_SIZE, PROT_READ | PROT_WRITE,
+			      MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+		assert(buf[i] != MAP_FAILED);
+		if (hugepage)
+			madvise(buf[i], STREAM_SIZE, MADV_HUGEPAGE);
+	}
+
+	batch_handle = gem_create(fd, 4096);
+	gem_write(fd, batch_handle, 0, &bbe, sizeof(bbe));
+
+	memset(obj, 0, sizeof(obj));
+	obj[1].handle = batch_handle;
+
+	memset(&execbuf, 0, sizeof(execbuf));
+	execbuf.buffers_ptr = (uintptr_t)obj;
+	execbuf.buffer_count = 2;
+
+	igt_stats_init(&stalls);
+	start_test(test_duration_sec);
+
+	while (run_test) {
+		for (i = 0; i < STREAM_BUFS && run_test; i++) {
+			struct timespec start, end;
+			uint32_t handle = 0;
+
+			/* capture: a new frame lands in CPU memory */
+			memset(buf[i], iter, STREAM_SIZE);
+
+			/* process: import it and hand it to the GPU */
+			gem_userptr(fd, buf[i], STREAM_SIZE, 0,
+				    userptr_flags, &handle);
+			obj[0].handle = handle;
+
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			gem_execbuf(fd, &execbuf);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+
+			igt_stats_push_float(&stalls,
+					     1e6 * (end.tv_sec - start.tv_sec) +
+					     1e-3 * (end.tv_nsec - start.tv_nsec));
+
+			/* display: wait before the buffer is recycled */
+			gem_sync(fd, handle);
+			gem_close(fd, handle);
+
+			iter++;
+		}
+	}
+
+	printf("%8.1f MiB/s, get_pages stall (us): p50 %.1f, p90 %.1f, p99 %.1f, max %.1f\n",
+	       (double)iter * STREAM_SIZE /
+	       (1024 * 1024) / test_duration_sec,
+	       igt_stats_get_percentile(&stalls, 50),
+	       igt_stats_get_percentile(&stalls, 90),
+	       igt_stats_get_percentile(&stalls, 99),
+	       igt_stats_get_percentile(&stalls, 100));
+	igt_stats_fini(&stalls);
+
+	gem_close(fd, batch_handle);
+	for (i = 0; i < STREAM_BUFS; i++)
+		munmap(buf[i], STREAM_SIZE);
+}
+
 static void test_userptr(int fd)
 {
 	printf("create-destroy                = ");
@@ -491,6 +585,12 @@ int main(int argc, char **argv)
 	igt_subtest("userptr-impact-unsync-overlap")
 		test_impact_overlap(fd, "unsync-");
 
+	igt_subtest("userptr-streaming-unsync")
+		test_streaming(fd, 0);
+
+	igt_subtest("userptr-streaming-unsync-hugepage")
+		test_streaming(fd, 1);
+
 	gem_userptr_test_synchronized();
 
 	igt_subtest("userptr-sync")
@@ -502,6 +602,12 @@ int main(int argc, char **argv)
 	igt_subtest("userptr-impact-sync-overlap")
 		test_impact_overlap(fd, "sync-");
 
+	igt_subtest("userptr-streaming-sync")
+		test_streaming(fd, 0);
+
+	igt_subtest("userptr-streaming-sync-hugepage")
+		test_streaming(fd, 1);
+
 	igt_exit();
 
 	return 0;
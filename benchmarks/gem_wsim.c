@@ -31,15 +31,21 @@
 #include <inttypes.h>
 #include <errno.h>
 #include <poll.h>
+#include <sched.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/sysinfo.h>
 #include <sys/time.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <assert.h>
+#include <ctype.h>
 #include <limits.h>
 #include <pthread.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 
 
 #include "intel_chipset.h"
@@ -50,9 +56,12 @@
 #include "intel_io.h"
 #include "igt_aux.h"
 #include "igt_rand.h"
+#include "igt_stats.h"
 #include "sw_sync.h"
 
-#include "ewma.h"
+#include "bench_report.h"
+
+#include "igt_ewma.h"
 
 #define LOCAL_I915_EXEC_FENCE_IN              (1<<16)
 #define LOCAL_I915_EXEC_FENCE_OUT             (1<<17)
@@ -80,7 +89,8 @@ enum w_type
 	THROTTLE,
 	QD_THROTTLE,
 	SW_FENCE,
-	SW_FENCE_SIGNAL
+	SW_FENCE_SIGNAL,
+	CPU_PIN
 };
 
 struct deps
@@ -112,6 +122,7 @@ struct w_step
 		int target;
 		int throttle;
 		int fence_signal;
+		int pin_cpu;
 	};
 
 	/* Implementation details */
@@ -135,6 +146,42 @@ struct w_step
 	unsigned int mapped_len;
 };
 
+/*
+ * Compiled workload container: a fixed header, one record per step and a
+ * trailing table of dependency offsets. Only the parse-time metadata is
+ * stored - everything under "implementation details" in struct w_step is
+ * rebuilt by prepare_workload() as usual. Loading is a single pass over the
+ * mapped file with the dependency lists pointing straight into it, so
+ * startup does no text parsing and no per-step allocations.
+ */
+#define WSIM_BIN_MAGIC 0x4d495357 /* "WSIM" */
+#define WSIM_BIN_VERSION 2
+
+struct wsim_bin_hdr {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t nr_steps;
+	uint32_t nr_deps;
+	/* v2 */
+	uint32_t warmup_us;
+	uint32_t measure_us;
+	uint32_t cooldown_us;
+};
+
+struct wsim_bin_step {
+	int32_t type;
+	uint32_t context;
+	uint32_t engine;
+	uint32_t duration_min;
+	uint32_t duration_max;
+	int32_t value;
+	int32_t emit_fence;
+	uint32_t data_deps_off;
+	uint32_t data_deps_nr;
+	uint32_t fence_deps_off;
+	uint32_t fence_deps_nr;
+};
+
 DECLARE_EWMA(uint64_t, rt, 4, 2)
 
 struct workload
@@ -146,10 +193,15 @@ struct workload
 	int prio;
 
 	pthread_t thread;
+	pid_t pid;
+	unsigned int prep_flags;
 	bool run;
 	bool background;
 	const struct workload_balancer *balancer;
 	unsigned int repeat;
+	unsigned int warmup_us;
+	unsigned int measure_us;
+	unsigned int cooldown_us;
 	unsigned int flags;
 	bool print_stats;
 
@@ -175,6 +227,9 @@ struct workload
 	unsigned long qd_sum[NUM_ENGINES];
 	unsigned long nr_bb[NUM_ENGINES];
 
+	igt_stats_t latency[NUM_ENGINES];
+	uint32_t latency_seqno[NUM_ENGINES];
+
 	struct igt_list requests[NUM_ENGINES];
 	unsigned int nrequest[NUM_ENGINES];
 
@@ -187,6 +242,11 @@ struct workload
 			struct ewma_rt avg[NUM_ENGINES];
 			uint32_t last[NUM_ENGINES];
 		} rt;
+		struct busy {
+			struct ewma_rt avg[NUM_ENGINES];
+			uint64_t last[NUM_ENGINES];
+			int fd[NUM_ENGINES];
+		} busy;
 	};
 };
 
@@ -197,6 +257,7 @@ static unsigned int context_vcs_rr;
 
 static int verbose = 1;
 static int fd;
+static double rcs_tick_us;
 
 #define SWAPVCS		(1<<0)
 #define SEQNO		(1<<1)
@@ -208,6 +269,9 @@ static int fd;
 #define HEARTBEAT	(1<<7)
 #define GLOBAL_BALANCE	(1<<8)
 #define DEPSYNC		(1<<9)
+#define PROCESS		(1<<10)
+#define LATENCY		(1<<11)
+#define PMU		(1<<12)
 
 #define SEQNO_IDX(engine) ((engine) * 16)
 #define SEQNO_OFFSET(engine) (SEQNO_IDX(engine) * sizeof(uint32_t))
@@ -281,6 +345,7 @@ parse_workload(struct w_arg *arg, unsigned int flags, struct workload *app_w)
 	char *_token, *token, *tctx = NULL, *tstart = desc;
 	char *field, *fctx = NULL, *fstart;
 	struct w_step step, *steps = NULL;
+	unsigned int warmup_us = 0, measure_us = 0, cooldown_us = 0;
 	bool bcs_used = false;
 	unsigned int valid;
 	int i, j, tmp;
@@ -395,6 +460,51 @@ parse_workload(struct w_arg *arg, unsigned int flags, struct workload *app_w)
 					step.target = tmp;
 					goto add_step;
 				}
+			} else if (!strcasecmp(field, "c")) {
+				if ((field = strtok_r(fstart, ".", &fctx)) !=
+				    NULL) {
+					tmp = atoi(field);
+					if (tmp < 0 || tmp >= get_nprocs()) {
+						if (verbose)
+							fprintf(stderr,
+								"Invalid cpu at step %u!\n",
+								nr_steps);
+						return NULL;
+					}
+
+					step.type = CPU_PIN;
+					step.pin_cpu = tmp;
+					goto add_step;
+				}
+			} else if (!strcasecmp(field, "w") ||
+				   !strcasecmp(field, "m") ||
+				   !strcasecmp(field, "o")) {
+				char phase = tolower(field[0]);
+
+				/* Phases apply to the whole workload and do
+				 * not add a step.
+				 */
+				if ((field = strtok_r(fstart, ".", &fctx)) !=
+				    NULL) {
+					tmp = atoi(field);
+					if (tmp <= 0) {
+						if (verbose)
+							fprintf(stderr,
+								"Invalid phase duration at step %u!\n",
+								nr_steps);
+						return NULL;
+					}
+
+					if (phase == 'w')
+						warmup_us = tmp * 1000000u;
+					else if (phase == 'm')
+						measure_us = tmp * 1000000u;
+					else
+						cooldown_us = tmp * 1000000u;
+
+					free(token);
+					continue;
+				}
 			} else if (!strcasecmp(field, "f")) {
 				step.type = SW_FENCE;
 				goto add_step;
@@ -542,6 +652,9 @@ add_step:
 	wrk->nr_steps = nr_steps;
 	wrk->steps = steps;
 	wrk->prio = arg->prio;
+	wrk->warmup_us = warmup_us;
+	wrk->measure_us = measure_us;
+	wrk->cooldown_us = cooldown_us;
 
 	free(desc);
 
@@ -586,19 +699,189 @@ add_step:
 	return wrk;
 }
 
+static void compile_workload(struct workload *wrk, const char *filename)
+{
+	struct wsim_bin_hdr hdr = {
+		.magic = WSIM_BIN_MAGIC,
+		.version = WSIM_BIN_VERSION,
+		.nr_steps = wrk->nr_steps,
+		.warmup_us = wrk->warmup_us,
+		.measure_us = wrk->measure_us,
+		.cooldown_us = wrk->cooldown_us,
+	};
+	struct w_step *w;
+	FILE *file;
+	uint32_t off = 0;
+	int i, j;
+
+	for (i = 0, w = wrk->steps; i < wrk->nr_steps; i++, w++)
+		hdr.nr_deps += w->data_deps.nr + w->fence_deps.nr;
+
+	file = fopen(filename, "wb");
+	igt_assert(file);
+
+	igt_assert(fwrite(&hdr, sizeof(hdr), 1, file) == 1);
+
+	for (i = 0, w = wrk->steps; i < wrk->nr_steps; i++, w++) {
+		struct wsim_bin_step step = {
+			.type = w->type,
+			.context = w->context,
+			.engine = w->engine,
+			.duration_min = w->duration.min,
+			.duration_max = w->duration.max,
+			.value = w->delay,
+			.emit_fence = w->emit_fence,
+			.data_deps_off = off,
+			.data_deps_nr = w->data_deps.nr,
+			.fence_deps_off = off + w->data_deps.nr,
+			.fence_deps_nr = w->fence_deps.nr,
+		};
+
+		off += w->data_deps.nr + w->fence_deps.nr;
+		igt_assert(fwrite(&step, sizeof(step), 1, file) == 1);
+	}
+
+	for (i = 0, w = wrk->steps; i < wrk->nr_steps; i++, w++) {
+		for (j = 0; j < w->data_deps.nr; j++) {
+			int32_t dep = w->data_deps.list[j];
+
+			igt_assert(fwrite(&dep, sizeof(dep), 1, file) == 1);
+		}
+		for (j = 0; j < w->fence_deps.nr; j++) {
+			int32_t dep = w->fence_deps.list[j];
+
+			igt_assert(fwrite(&dep, sizeof(dep), 1, file) == 1);
+		}
+	}
+
+	igt_assert(fclose(file) == 0);
+}
+
+static bool wsim_binary_file(const char *filename)
+{
+	uint32_t magic = 0;
+	struct stat sbuf;
+	int infd;
+
+	if (stat(filename, &sbuf) || !S_ISREG(sbuf.st_mode))
+		return false;
+
+	infd = open(filename, O_RDONLY);
+	if (infd < 0)
+		return false;
+
+	if (read(infd, &magic, sizeof(magic)) != sizeof(magic))
+		magic = 0;
+	close(infd);
+
+	return magic == WSIM_BIN_MAGIC;
+}
+
 static struct workload *
-clone_workload(struct workload *_wrk)
+load_binary_workload(struct w_arg *arg)
 {
+	struct wsim_bin_hdr *hdr;
+	struct wsim_bin_step *bin_step;
 	struct workload *wrk;
-	int i;
+	struct w_step *w;
+	int32_t *deps;
+	struct stat sbuf;
+	void *map;
+	int infd, i;
+
+	infd = open(arg->filename, O_RDONLY);
+	igt_assert(infd >= 0);
+	igt_assert(fstat(infd, &sbuf) == 0);
+
+	map = mmap(NULL, sbuf.st_size, PROT_READ, MAP_PRIVATE, infd, 0);
+	igt_assert(map != MAP_FAILED);
+	close(infd);
+
+	hdr = map;
+	igt_assert(hdr->magic == WSIM_BIN_MAGIC);
+	igt_assert(hdr->version == WSIM_BIN_VERSION);
+	igt_assert(sizeof(*hdr) + hdr->nr_steps * sizeof(*bin_step) +
+		   hdr->nr_deps * sizeof(*deps) <= sbuf.st_size);
+
+	bin_step = (struct wsim_bin_step *)(hdr + 1);
+	deps = (int32_t *)(bin_step + hdr->nr_steps);
 
 	wrk = malloc(sizeof(*wrk));
 	igt_assert(wrk);
 	memset(wrk, 0, sizeof(*wrk));
 
+	wrk->nr_steps = hdr->nr_steps;
+	wrk->steps = calloc(wrk->nr_steps, sizeof(struct w_step));
+	igt_assert(wrk->steps);
+	wrk->prio = arg->prio;
+	wrk->warmup_us = hdr->warmup_us;
+	wrk->measure_us = hdr->measure_us;
+	wrk->cooldown_us = hdr->cooldown_us;
+
+	/*
+	 * Dependency lists point straight into the mapping, which stays
+	 * alive for the lifetime of the process; nothing is allocated per
+	 * step.
+	 */
+	for (i = 0, w = wrk->steps; i < wrk->nr_steps; i++, w++, bin_step++) {
+		w->type = bin_step->type;
+		w->context = bin_step->context;
+		w->engine = bin_step->engine;
+		w->duration.min = bin_step->duration_min;
+		w->duration.max = bin_step->duration_max;
+		w->delay = bin_step->value;
+		w->emit_fence = bin_step->emit_fence;
+		w->data_deps.nr = bin_step->data_deps_nr;
+		w->data_deps.list = deps + bin_step->data_deps_off;
+		w->fence_deps.nr = bin_step->fence_deps_nr;
+		w->fence_deps.list = deps + bin_step->fence_deps_off;
+		w->idx = i;
+		w->request = -1;
+	}
+
+	return wrk;
+}
+
+static void *shared_calloc(size_t size)
+{
+	void *ptr;
+
+	ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	igt_assert(ptr != MAP_FAILED);
+
+	return ptr;
+}
+
+static struct workload *
+clone_workload(struct workload *_wrk, unsigned int flags)
+{
+	struct workload *wrk;
+	int i;
+
+	/*
+	 * In process mode the parent signals stop via wrk->run and the global
+	 * balancer state lives inside the workload, so the clones must sit in
+	 * memory shared across the fork.
+	 */
+	if (flags & PROCESS) {
+		wrk = shared_calloc(sizeof(*wrk));
+	} else {
+		wrk = malloc(sizeof(*wrk));
+		igt_assert(wrk);
+		memset(wrk, 0, sizeof(*wrk));
+	}
+
 	wrk->prio = _wrk->prio;
 	wrk->nr_steps = _wrk->nr_steps;
-	wrk->steps = calloc(wrk->nr_steps, sizeof(struct w_step));
+	wrk->warmup_us = _wrk->warmup_us;
+	wrk->measure_us = _wrk->measure_us;
+	wrk->cooldown_us = _wrk->cooldown_us;
+	if (flags & PROCESS)
+		wrk->steps = shared_calloc(wrk->nr_steps *
+					   sizeof(struct w_step));
+	else
+		wrk->steps = calloc(wrk->nr_steps, sizeof(struct w_step));
 	igt_assert(wrk->steps);
 
 	memcpy(wrk->steps, _wrk->steps, sizeof(struct w_step) * wrk->nr_steps);
@@ -825,6 +1108,23 @@ alloc_step_batch(struct workload *wrk, struct w_step *w, unsigned int flags)
 #endif
 }
 
+static void
+prepare_status_page(struct workload *wrk)
+{
+	uint32_t handle;
+
+	handle = gem_create(fd, 4096);
+	gem_set_caching(fd, handle, I915_CACHING_CACHED);
+	wrk->status_object[0].handle = handle;
+	wrk->status_page = gem_mmap__cpu(fd, handle, 0, 4096,
+					 PROT_READ);
+
+	handle = gem_create(fd, 4096);
+	wrk->status_object[1].handle = handle;
+	wrk->status_cs = gem_mmap__wc(fd, handle,
+				      0, 4096, PROT_WRITE);
+}
+
 static void
 prepare_workload(unsigned int id, struct workload *wrk, unsigned int flags)
 {
@@ -835,31 +1135,22 @@ prepare_workload(unsigned int id, struct workload *wrk, unsigned int flags)
 
 	wrk->id = id;
 	wrk->prng = rand();
-	wrk->run = true;
+	/* In process mode the parent arms wrk->run before forking. */
+	if (!(flags & PROCESS))
+		wrk->run = true;
 
 	if (flags & INITVCSRR)
 		wrk->vcs_rr = id & 1;
 
-	if (flags & GLOBAL_BALANCE) {
+	if ((flags & GLOBAL_BALANCE) && !(flags & PROCESS)) {
 		int ret = pthread_mutex_init(&wrk->mutex, NULL);
 		igt_assert(ret == 0);
 	}
 
 	if (flags & SEQNO) {
-		if (!(flags & GLOBAL_BALANCE) || id == 0) {
-			uint32_t handle;
-
-			handle = gem_create(fd, 4096);
-			gem_set_caching(fd, handle, I915_CACHING_CACHED);
-			wrk->status_object[0].handle = handle;
-			wrk->status_page = gem_mmap__cpu(fd, handle, 0, 4096,
-							 PROT_READ);
-
-			handle = gem_create(fd, 4096);
-			wrk->status_object[1].handle = handle;
-			wrk->status_cs = gem_mmap__wc(fd, handle,
-						      0, 4096, PROT_WRITE);
-		}
+		if ((!(flags & GLOBAL_BALANCE) || id == 0) &&
+		    !wrk->status_page)
+			prepare_status_page(wrk);
 	}
 
 	for (i = 0, w = wrk->steps; i < wrk->nr_steps; i++, w++) {
@@ -1141,6 +1432,26 @@ static void get_rt_depth(struct workload *wrk,
 	} while (latch != rt->seqno);
 }
 
+static void sample_latency(struct workload *wrk, enum intel_engine_id engine)
+{
+	struct rt_depth rt;
+
+	if (!(wrk->flags & LATENCY))
+		return;
+
+	get_rt_depth(wrk, engine, &rt);
+	if (rt.seqno == wrk->latency_seqno[engine])
+		return;
+
+	/* The status page only latches the timings of the most recently
+	 * completed batch on each engine, so sampling at submission rate
+	 * observes a subset of the batches. That is enough for stable
+	 * percentiles as long as the engine is kept busy.
+	 */
+	igt_stats_push(&wrk->latency[engine], rt.completed - rt.submitted);
+	wrk->latency_seqno[engine] = rt.seqno;
+}
+
 static enum intel_engine_id
 __rt_balance(const struct workload_balancer *balancer,
 	     struct workload *wrk, struct w_step *w, bool random)
@@ -1242,6 +1553,87 @@ context_balance(const struct workload_balancer *balancer,
 	return get_vcs_engine(wrk->ctx_list[w->context].static_vcs);
 }
 
+/* Busyness sampling via the i915 perf PMU. Ring order and the busy
+ * counter encoding follow overlay/gpu-top.c.
+ */
+#define I915_PERF_RING_BUSY(n) (4 * (n))
+
+static const unsigned int busy_ring_map[NUM_ENGINES] = {
+	[VCS1] = 2, /* RCS, BCS, VCS0, VCS1 */
+	[VCS2] = 3,
+};
+
+static uint64_t i915_perf_type_id(void)
+{
+	char buf[64];
+	int sysfd, n;
+
+	sysfd = open("/sys/bus/event_source/devices/i915/type", O_RDONLY);
+	if (sysfd < 0)
+		return 0;
+
+	n = read(sysfd, buf, sizeof(buf) - 1);
+	close(sysfd);
+	if (n < 0)
+		return 0;
+
+	buf[n] = '\0';
+	return strtoull(buf, NULL, 0);
+}
+
+static int perf_i915_open(unsigned int config)
+{
+	struct perf_event_attr attr = {};
+
+	attr.type = i915_perf_type_id();
+	if (attr.type == 0)
+		return -ENOENT;
+
+	attr.size = sizeof(attr);
+	attr.config = config;
+
+	return syscall(__NR_perf_event_open, &attr, -1, 0, -1, 0);
+}
+
+static enum intel_engine_id
+busy_balance(const struct workload_balancer *balancer,
+	     struct workload *wrk, struct w_step *w)
+{
+	unsigned long qd[NUM_ENGINES];
+	unsigned int engine;
+
+	igt_assert(w->engine == VCS);
+
+	for (engine = VCS1; engine <= VCS2; engine++) {
+		uint64_t val = 0;
+
+		/* Lazily opened so that forked clients sample through
+		 * their own fds. Zero doubles as the unopened marker
+		 * since the workload struct is cleared on allocation.
+		 */
+		if (!wrk->busy.fd[engine]) {
+			wrk->busy.fd[engine] =
+			    perf_i915_open(I915_PERF_RING_BUSY(busy_ring_map[engine]));
+			igt_assert(wrk->busy.fd[engine] >= 0);
+		}
+
+		igt_assert(read(wrk->busy.fd[engine], &val, sizeof(val)) ==
+			   sizeof(val));
+
+		/* Feed the busyness (in ns) accrued since the last sample
+		 * through the same EWMA the rt modes use and balance on
+		 * the smoothed value.
+		 */
+		ewma_rt_add(&wrk->busy.avg[engine],
+			    val - wrk->busy.last[engine]);
+		wrk->busy.last[engine] = val;
+
+		qd[engine] = ewma_rt_read(&wrk->busy.avg[engine]);
+	}
+
+	return __rt_select_engine(wrk, qd, false);
+}
+
 static const struct workload_balancer all_balancers[] = {
 	{
 		.id = 0,
@@ -1315,6 +1707,13 @@ static const struct workload_balancer all_balancers[] = {
 		.desc = "Static round-robin VCS assignment at context creation.",
 		.balance = context_balance,
 	},
+	{
+		.id = 9,
+		.name = "busy",
+		.desc = "Engine busyness sampled from the i915 perf PMU.",
+		.flags = PMU,
+		.balance = busy_balance,
+	},
 };
 
 static unsigned int
@@ -1588,24 +1987,55 @@ static bool sync_deps(struct workload *wrk, struct w_step *w)
 	return synced;
 }
 
+static void pin_to_cpu(struct workload *wrk, unsigned int cpu)
+{
+	cpu_set_t mask;
+
+	/* Spread cloned clients consecutively from the given CPU. */
+	cpu = (cpu + wrk->id) % get_nprocs();
+
+	CPU_ZERO(&mask);
+	CPU_SET(cpu, &mask);
+	if (sched_setaffinity(0, sizeof(mask), &mask) && verbose)
+		fprintf(stderr, "%u: failed to pin to cpu %u (%s)\n",
+			wrk->id, cpu, strerror(errno));
+}
+
 static void *run_workload(void *data)
 {
 	struct workload *wrk = (struct workload *)data;
 	struct timespec t_start, t_end;
 	struct w_step *w;
 	bool last_sync = false;
+	bool warmup = wrk->warmup_us > 0;
+	struct ewma_rt warm_avg;
+	unsigned int steady = 0;
 	int throttle = -1;
 	int qd_throttle = -1;
 	int count;
 	int i;
 
+	ewma_rt_init(&warm_avg);
+
 	clock_gettime(CLOCK_MONOTONIC, &t_start);
 
+	/* Pin before the first buffer accesses so that, with -P, client
+	 * memory is handed out node-local by first touch.
+	 */
+	for (i = 0, w = wrk->steps; i < wrk->nr_steps; i++, w++)
+		if (w->type == CPU_PIN)
+			pin_to_cpu(wrk, w->pin_cpu);
+
 	hars_petruska_f54_1_random_seed((wrk->flags & SYNCEDCLIENTS) ?
 					0 : wrk->id);
 
+	if (wrk->flags & LATENCY)
+		for (i = 0; i < NUM_ENGINES; i++)
+			igt_stats_init(&wrk->latency[i]);
+
 	init_status_page(wrk, INIT_ALL);
-	for (count = 0; wrk->run && (wrk->background || count < wrk->repeat);
+	for (count = 0; wrk->run && (wrk->background || warmup ||
+				     wrk->measure_us || count < wrk->repeat);
 	     count++) {
 		unsigned int cur_seqno = wrk->sync_seqno;
 
@@ -1660,6 +2090,9 @@ static void *run_workload(void *data)
 				inc = cur_seqno - wrk->sync_seqno;
 				sw_sync_timeline_inc(wrk->sync_timeline, inc);
 				continue;
+			} else if (w->type == CPU_PIN) {
+				/* Applied once before the first iteration. */
+				continue;
 			}
 
 			if (do_sleep || w->type == PERIOD) {
@@ -1689,6 +2122,8 @@ static void *run_workload(void *data)
 
 			do_eb(wrk, w, engine, wrk->flags);
 
+			sample_latency(wrk, engine);
+
 			if (w->request != -1) {
 				igt_list_del(&w->rq_link);
 				wrk->nrequest[w->request]--;
@@ -1738,6 +2173,59 @@ static void *run_workload(void *data)
 				w->emit_fence = -1;
 			}
 		}
+
+		if (warmup) {
+			struct timespec now;
+			uint64_t avg, round_us;
+
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			round_us = elapsed_us(&wrk->repeat_start, &now);
+
+			ewma_rt_add(&warm_avg, round_us);
+			avg = ewma_rt_read(&warm_avg);
+
+			/* Declare steady state once five consecutive rounds
+			 * stay within 2% of the smoothed round time.
+			 */
+			if (avg && round_us > avg * 49 / 50 &&
+			    round_us < avg * 51 / 50)
+				steady++;
+			else
+				steady = 0;
+
+			if (steady >= 5 ||
+			    elapsed_us(&t_start, &now) >= wrk->warmup_us) {
+				if (verbose > 1)
+					printf("%u: %s after %d warmup rounds.\n",
+					       wrk->id,
+					       steady >= 5 ?
+					       "Steady state" :
+					       "Warmup timeout",
+					       count + 1);
+
+				/* Restart measurement from a clean slate. */
+				memset(wrk->nr_bb, 0, sizeof(wrk->nr_bb));
+				memset(wrk->qd_sum, 0, sizeof(wrk->qd_sum));
+				if (wrk->flags & LATENCY) {
+					for (i = 0; i < NUM_ENGINES; i++) {
+						igt_stats_fini(&wrk->latency[i]);
+						igt_stats_init(&wrk->latency[i]);
+					}
+				}
+
+				warmup = false;
+				count = -1;
+				clock_gettime(CLOCK_MONOTONIC, &t_start);
+			}
+		} else if (wrk->measure_us) {
+			struct timespec now;
+
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			if (elapsed_us(&t_start, &now) >= wrk->measure_us) {
+				count++;
+				break;
+			}
+		}
 	}
 
 	for (i = 0; i < NUM_ENGINES; i++) {
@@ -1746,6 +2234,8 @@ static void *run_workload(void *data)
 
 		w = igt_list_last_entry(&wrk->requests[i], w, rq_link);
 		gem_sync(fd, w->obj[0].handle);
+
+		sample_latency(wrk, i);
 	}
 
 	clock_gettime(CLOCK_MONOTONIC, &t_end);
@@ -1764,15 +2254,50 @@ static void *run_workload(void *data)
 			       (double)wrk->qd_sum[VCS1] / wrk->nr_bb[VCS],
 			       (double)wrk->qd_sum[VCS2] / wrk->nr_bb[VCS]);
 		putchar('\n');
+
+		if (wrk->flags & LATENCY) {
+			for (i = 0; i < NUM_ENGINES; i++) {
+				igt_stats_t *s = &wrk->latency[i];
+
+				if (!s->n_values)
+					continue;
+
+				printf("  %s batch latency (%u samples): p50=%.1fus p90=%.1fus p99=%.1fus p99.9=%.1fus\n",
+				       ring_str_map[i], s->n_values,
+				       igt_stats_get_percentile(s, 50) *
+				       rcs_tick_us,
+				       igt_stats_get_percentile(s, 90) *
+				       rcs_tick_us,
+				       igt_stats_get_percentile(s, 99) *
+				       rcs_tick_us,
+				       igt_stats_get_percentile(s, 99.9) *
+				       rcs_tick_us);
+			}
+		}
 	}
 
+	if (wrk->flags & LATENCY)
+		for (i = 0; i < NUM_ENGINES; i++)
+			igt_stats_fini(&wrk->latency[i]);
+
+	/* Let the GPU cool off so a following invocation starts from a
+	 * comparable thermal state.
+	 */
+	if (wrk->cooldown_us && wrk->run)
+		usleep(wrk->cooldown_us);
+
 	return NULL;
 }
 
 static void fini_workload(struct workload *wrk)
 {
-	free(wrk->steps);
-	free(wrk);
+	if (wrk->flags & PROCESS) {
+		munmap(wrk->steps, wrk->nr_steps * sizeof(struct w_step));
+		munmap(wrk, sizeof(*wrk));
+	} else {
+		free(wrk->steps);
+		free(wrk);
+	}
 }
 
 static unsigned long calibrate_nop(unsigned int tolerance_pct)
@@ -1836,7 +2361,11 @@ static void print_help(void)
 "  -p <n>          Context priority to use for the following workload on the\n"
 "                  command line.\n"
 "  -w <desc|path>  Filename or a workload descriptor.\n"
-"                  Can be given multiple times.\n"
+"                  Can be given multiple times. Files can be text descriptors\n"
+"                  or workloads compiled with -C, detected automatically.\n"
+"  -C <path>       Compile the workload given with -w into a binary file and\n"
+"                  exit. Compiled workloads load without any parsing or\n"
+"                  per-step allocations.\n"
 "  -W <desc|path>  Filename or a master workload descriptor.\n"
 "                  Only one master workload can be optinally specified in which\n"
 "                  case all other workloads become background ones and run as\n"
@@ -1867,6 +2396,16 @@ static void print_help(void)
 "                  clients.\n"
 "  -G              Global load balancing - a single load balancer will be shared\n"
 "                  between all clients and there will be a single seqno domain.\n"
+"  -P              Fork one process per client instead of one thread, for\n"
+"                  measuring cross-process scheduling. Balancer state is kept\n"
+"                  in shared memory. Without -G each client opens its own drm\n"
+"                  fd; with -G the device fd stays shared since the global\n"
+"                  status page is tied to it.\n"
+"  -L              Collect per-batch completion latency from the timestamps\n"
+"                  written around each batch and report p50/p90/p99/p99.9\n"
+"                  percentiles per engine at the end of the run. Needs Gen8+.\n"
+"  -o <format>     Emit final results in a machine-readable format instead of\n"
+"                  the plain text summary. Supported formats: json, csv.\n"
 "  -d              Sync between data dependencies in userspace."
 	);
 }
@@ -1946,9 +2485,6 @@ static void init_clocks(void)
 
 	intel_register_access_init(intel_get_pci_device(), false, fd);
 
-	if (verbose <= 1)
-		return;
-
 	clock_gettime(CLOCK_MONOTONIC, &t_start);
 	for (int i = 0; i < 100; i++)
 		rcs_start = *REG(RCS_TIMESTAMP);
@@ -1968,8 +2504,12 @@ static void init_clocks(void)
 	clock_gettime(CLOCK_MONOTONIC, &t_end);
 
 	t = elapsed(&t_start, &t_end) - overhead;
-	printf("%d cycles in %.1fus, i.e. 1024 cycles takes %1.fus\n",
-	       rcs_end - rcs_start, 1e6*t, 1024e6 * t / (rcs_end - rcs_start));
+	rcs_tick_us = 1e6 * t / (rcs_end - rcs_start);
+
+	if (verbose > 1)
+		printf("%d cycles in %.1fus, i.e. 1024 cycles takes %1.fus\n",
+		       rcs_end - rcs_start, 1e6*t,
+		       1024e6 * t / (rcs_end - rcs_start));
 }
 
 int main(int argc, char **argv)
@@ -1983,6 +2523,7 @@ int main(int argc, char **argv)
 	unsigned int nr_w_args = 0;
 	int master_workload = -1;
 	char *append_workload_arg = NULL;
+	char *compile_output = NULL;
 	struct w_arg *w_args = NULL;
 	unsigned int tolerance_pct = 1;
 	const struct workload_balancer *balancer = NULL;
@@ -2002,7 +2543,7 @@ int main(int argc, char **argv)
 
 	init_clocks();
 
-	while ((c = getopt(argc, argv, "hqv2RSHxGdc:n:r:w:W:a:t:b:p:")) != -1) {
+	while ((c = getopt(argc, argv, "hqv2RSHxGdPLc:n:r:w:W:a:t:b:p:C:o:")) != -1) {
 		switch (c) {
 		case 'W':
 			if (master_workload >= 0) {
@@ -2067,6 +2608,24 @@ int main(int argc, char **argv)
 		case 'd':
 			flags |= DEPSYNC;
 			break;
+		case 'P':
+			flags |= PROCESS;
+			break;
+		case 'L':
+			flags |= LATENCY;
+			break;
+		case 'o':
+			if (bench_report_set_format(optarg)) {
+				if (verbose)
+					fprintf(stderr,
+						"Unknown output format '%s'!\n",
+						optarg);
+				return 1;
+			}
+			break;
+		case 'C':
+			compile_output = optarg;
+			break;
 		case 'b':
 			i = find_balancer_by_name(optarg);
 			if (i < 0) {
@@ -2099,13 +2658,42 @@ int main(int argc, char **argv)
 		}
 	}
 
+	if (flags & LATENCY) {
+		if (intel_gen(intel_get_drm_devid(fd)) < 8) {
+			if (verbose)
+				fprintf(stderr,
+					"Latency stats need Gen8 or newer for batch timestamping!\n");
+			return 1;
+		}
+		flags |= SEQNO | RT;
+	}
+
+	if (flags & PMU) {
+		int probe;
+
+		if ((flags & PROCESS) && (flags & GLOBAL_BALANCE)) {
+			if (verbose)
+				fprintf(stderr,
+					"PMU balancing cannot be combined with -P -G (perf fds are not shareable between processes)!\n");
+			return 1;
+		}
+
+		probe = perf_i915_open(I915_PERF_RING_BUSY(busy_ring_map[VCS1]));
+		if (probe < 0) {
+			if (verbose)
+				fprintf(stderr, "i915 PMU not available!\n");
+			return 1;
+		}
+		close(probe);
+	}
+
 	if ((flags & HEARTBEAT) && !(flags & SEQNO)) {
 		if (verbose)
 			fprintf(stderr, "Heartbeat needs a seqno based balancer!\n");
 		return 1;
 	}
 
-	if (!nop_calibration) {
+	if (!nop_calibration && !compile_output) {
 		if (verbose > 1)
 			printf("Calibrating nop delay with %u%% tolerance...\n",
 				tolerance_pct);
@@ -2162,6 +2750,18 @@ int main(int argc, char **argv)
 	igt_assert(wrk);
 
 	for (i = 0; i < nr_w_args; i++) {
+		if (wsim_binary_file(w_args[i].filename)) {
+			if (app_w) {
+				if (verbose)
+					fprintf(stderr,
+						"Appending to compiled workloads is not supported!\n");
+				return 1;
+			}
+
+			wrk[i] = load_binary_workload(&w_args[i]);
+			continue;
+		}
+
 		w_args[i].desc = load_workload_descriptor(w_args[i].filename);
 
 		if (!w_args[i].desc) {
@@ -2181,6 +2781,20 @@ int main(int argc, char **argv)
 		}
 	}
 
+	if (compile_output) {
+		if (nr_w_args != 1) {
+			if (verbose)
+				fprintf(stderr,
+					"Exactly one workload can be compiled at a time!\n");
+			return 1;
+		}
+
+		compile_workload(wrk[0], compile_output);
+		if (verbose)
+			printf("Compiled workload into %s.\n", compile_output);
+		return 0;
+	}
+
 	if (nr_w_args > 1)
 		clients = nr_w_args;
 
@@ -2206,7 +2820,7 @@ int main(int argc, char **argv)
 	for (i = 0; i < clients; i++) {
 		unsigned int flags_ = flags;
 
-		w[i] = clone_workload(wrk[nr_w_args > 1 ? i : 0]);
+		w[i] = clone_workload(wrk[nr_w_args > 1 ? i : 0], flags);
 
 		if (flags & SWAPVCS && i & 1)
 			flags_ &= ~SWAPVCS;
@@ -2225,40 +2839,98 @@ int main(int argc, char **argv)
 		w[i]->print_stats = verbose > 1 ||
 				    (verbose > 0 && master_workload == i);
 
-		prepare_workload(i, w[i], flags_);
+		if (flags & PROCESS) {
+			w[i]->prep_flags = flags_;
+			w[i]->run = true;
+		} else {
+			prepare_workload(i, w[i], flags_);
+		}
+	}
+
+	if ((flags & PROCESS) && (flags & GLOBAL_BALANCE)) {
+		/*
+		 * The children balance through w[0]: its mutex must work
+		 * across processes and the status page must be mapped before
+		 * forking so all of them inherit the mapping. The handles stay
+		 * valid in every child since the device fd is inherited too.
+		 */
+		pthread_mutexattr_t attr;
+		int ret;
+
+		ret = pthread_mutexattr_init(&attr);
+		igt_assert(ret == 0);
+		ret = pthread_mutexattr_setpshared(&attr,
+						   PTHREAD_PROCESS_SHARED);
+		igt_assert(ret == 0);
+		ret = pthread_mutex_init(&w[0]->mutex, &attr);
+		igt_assert(ret == 0);
+
+		if (flags & SEQNO)
+			prepare_status_page(w[0]);
 	}
 
 	gem_quiescent_gpu(fd);
 
+	bench_profile_begin();
 	clock_gettime(CLOCK_MONOTONIC, &t_start);
 
 	for (i = 0; i < clients; i++) {
-		int ret;
+		if (flags & PROCESS) {
+			pid_t pid = fork();
+
+			igt_assert(pid >= 0);
+			if (pid == 0) {
+				if (!(flags & GLOBAL_BALANCE)) {
+					fd = __drm_open_driver(DRIVER_INTEL);
+					igt_assert(fd >= 0);
+				}
+				prepare_workload(i, w[i], w[i]->prep_flags);
+				run_workload(w[i]);
+				exit(0);
+			}
+			w[i]->pid = pid;
+		} else {
+			int ret;
 
-		ret = pthread_create(&w[i]->thread, NULL, run_workload, w[i]);
-		igt_assert_eq(ret, 0);
+			ret = pthread_create(&w[i]->thread, NULL,
+					     run_workload, w[i]);
+			igt_assert_eq(ret, 0);
+		}
 	}
 
 	if (master_workload >= 0) {
-		int ret = pthread_join(w[master_workload]->thread, NULL);
-
-		igt_assert(ret == 0);
+		if (flags & PROCESS)
+			igt_assert(waitpid(w[master_workload]->pid,
+					   NULL, 0) ==
+				   w[master_workload]->pid);
+		else
+			igt_assert(pthread_join(w[master_workload]->thread,
+						NULL) == 0);
 
 		for (i = 0; i < clients; i++)
 			w[i]->run = false;
 	}
 
 	for (i = 0; i < clients; i++) {
-		if (master_workload != i) {
-			int ret = pthread_join(w[i]->thread, NULL);
-			igt_assert(ret == 0);
-		}
+		if (master_workload == i)
+			continue;
+
+		if (flags & PROCESS)
+			igt_assert(waitpid(w[i]->pid, NULL, 0) == w[i]->pid);
+		else
+			igt_assert(pthread_join(w[i]->thread, NULL) == 0);
 	}
 
 	clock_gettime(CLOCK_MONOTONIC, &t_end);
+	bench_profile_end();
 
 	t = elapsed(&t_start, &t_end);
-	if (verbose)
+	if (bench_report_enabled()) {
+		bench_report_begin("gem_wsim");
+		bench_report_value("elapsed", "s", t);
+		bench_report_value("throughput", "wps", clients * repeat / t);
+		bench_report_end();
+	} else if (verbose)
 		printf("%.3fs elapsed (%.3f workloads/s)\n",
 		       t, clients * repeat / t);
 
@@ -0,0 +1,477 @@
+/*
+ * Copyright © 2009 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ * Authors:
+ *    Eric Anholt <eric@anholt.net>
+ *
+ */
+
+/**
+ * Roughly simulates repeatedly uploading frames of images and blitting them
+ * to the screen, the path taken by pixmap upload for non-KMS and by texture
+ * streamers which software-render their frames.
+ *
+ * This used to be four binaries (intel_upload_blit_large{,_gtt,_map} and
+ * intel_upload_blit_small), each hardcoding one upload strategy and printing
+ * a single number after a fixed iteration count. They are unified here into
+ * one engine which runs a strategy matrix -- pwrite, gtt map, wc map and
+ * blit through a snooped staging buffer -- across a sweep of working-set
+ * sizes, so one run answers how an uploader should write on a given SKU and
+ * where the over-aperture performance cliff sits. Each cell runs in passes
+ * until the bandwidth of the trailing passes settles, rather than hoping a
+ * fixed count lands in steady state, and the results can be emitted through
+ * the shared machine-readable schema for regression tracking.
+ */
+
+#include "igt.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/mman.h>
+
+#include <drm.h>
+#include <i915_drm.h>
+
+#include "bench_report.h"
+
+#define OBJECT_WIDTH	1280
+#define OBJECT_HEIGHT	720
+
+enum upload_strategy {
+	UPLOAD_PWRITE,
+	UPLOAD_GTT,
+	UPLOAD_WC,
+	UPLOAD_BLIT,
+	NUM_STRATEGIES
+};
+
+static const char *strategy_names[NUM_STRATEGIES] = {
+	"pwrite", "gtt", "wc", "blit"
+};
+
+/* Large enough that a pass amortises the wait_rendering at its end, small
+ * enough that steady-state detection still reacts within a second. */
+#define PASS_FRAMES	64
+
+#define MIN_PASSES	8
+#define MAX_PASSES	32
+#define STEADY_WINDOW	5
+#define STEADY_TOLERANCE 0.05
+
+#define MAX_WORKING_SETS 8
+#define MAX_SRC_BOS	512
+
+static int drm_fd;
+static int width = OBJECT_WIDTH, height = OBJECT_HEIGHT;
+static bool small_uploads;
+
+static double
+get_time_in_secs(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return (double)tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/* Generate some junk.  Real workloads would be doing a lot more work to
+ * generate the junk, but the write pattern -- a streaming store of every
+ * texel -- is the part the strategies differ on.
+ */
+static void
+write_junk(uint32_t *data)
+{
+	static uint32_t seed = 1;
+	int i;
+
+	for (i = 0; i < width * height; i++)
+		data[i] = seed++;
+}
+
+/* The old _small binary existed to price tiny uploads: feed pwrite the
+ * frame in random 1-64 dword pieces, the distribution Mesa's VBO uploads
+ * used to have. */
+static void
+upload_chunked(drm_intel_bo *src_bo)
+{
+	uint32_t data[64];
+	static uint32_t seed = 1;
+	int i, j;
+
+	for (i = 0; i < width * height;) {
+		int size = random() % 64 + 1;
+
+		if (i + size > width * height)
+			size = width * height - i;
+
+		for (j = 0; j < size; j++)
+			data[j] = seed++;
+
+		drm_intel_bo_subdata(src_bo, i * 4, size * 4, data);
+
+		i += size;
+	}
+}
+
+static void
+blit_copy(struct intel_batchbuffer *batch,
+	  drm_intel_bo *dst_bo, drm_intel_bo *src_bo)
+{
+	BLIT_COPY_BATCH_START(0);
+	OUT_BATCH((3 << 24) | /* 32 bits */
+		  (0xcc << 16) | /* copy ROP */
+		  (width * 4) /* dst pitch */);
+	OUT_BATCH(0); /* dst x1,y1 */
+	OUT_BATCH((height << 16) | width); /* dst x2,y2 */
+	OUT_RELOC(dst_bo, I915_GEM_DOMAIN_RENDER, I915_GEM_DOMAIN_RENDER, 0);
+	OUT_BATCH(0); /* src x1,y1 */
+	OUT_BATCH(width * 4); /* src pitch */
+	OUT_RELOC(src_bo, I915_GEM_DOMAIN_RENDER, 0, 0);
+	ADVANCE_BATCH();
+}
+
+static bool
+do_upload(enum upload_strategy strategy, struct intel_batchbuffer *batch,
+	  drm_intel_bo *src_bo, drm_intel_bo *staging_bo, uint32_t *host_buf)
+{
+	uint32_t *ptr;
+
+	switch (strategy) {
+	case UPLOAD_PWRITE:
+		if (small_uploads) {
+			upload_chunked(src_bo);
+		} else {
+			write_junk(host_buf);
+			drm_intel_bo_subdata(src_bo, 0,
+					     width * height * 4, host_buf);
+		}
+		break;
+
+	case UPLOAD_GTT:
+		if (drm_intel_gem_bo_map_gtt(src_bo))
+			return false;
+		write_junk(src_bo->virtual);
+		drm_intel_gem_bo_unmap_gtt(src_bo);
+		break;
+
+	case UPLOAD_WC:
+		ptr = __gem_mmap__wc(drm_fd, src_bo->handle, 0,
+				     width * height * 4, PROT_WRITE);
+		if (ptr == NULL)
+			return false;
+		write_junk(ptr);
+		munmap(ptr, width * height * 4);
+		break;
+
+	case UPLOAD_BLIT:
+		/* The staging buffer stays CPU mapped (snooped on LLC
+		 * parts), so the CPU writes cacheable and the blitter pays
+		 * for the transfer into the unsnooped src instead. */
+		write_junk(staging_bo->virtual);
+		blit_copy(batch, src_bo, staging_bo);
+		break;
+
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+/* One cell of the matrix: run passes of PASS_FRAMES frames round-robin over
+ * enough src buffers to cover the working set, until the bandwidth of the
+ * trailing passes agrees to within STEADY_TOLERANCE. Returns the median of
+ * the settled window in MiB/s, or negative when the strategy is unsupported.
+ */
+static double
+run_cell(drm_intel_bufmgr *bufmgr, struct intel_batchbuffer *batch,
+	 enum upload_strategy strategy, int ws_mb, igt_stats_t *stats)
+{
+	int object_size = width * height * 4;
+	drm_intel_bo *src_bo[MAX_SRC_BOS];
+	drm_intel_bo *dst_bo, *staging_bo = NULL;
+	uint32_t *host_buf = NULL;
+	double samples[MAX_PASSES];
+	double result = -1;
+	int n_src, n_samples = 0;
+	int n, pass;
+
+	n_src = ((uint64_t)ws_mb << 20) / object_size;
+	if (n_src < 1)
+		n_src = 1;
+	if (n_src > MAX_SRC_BOS)
+		n_src = MAX_SRC_BOS;
+
+	for (n = 0; n < n_src; n++)
+		src_bo[n] = drm_intel_bo_alloc(bufmgr, "src", object_size,
+					       4096);
+	dst_bo = drm_intel_bo_alloc(bufmgr, "dst", object_size, 4096);
+
+	if (strategy == UPLOAD_PWRITE && !small_uploads)
+		host_buf = malloc(object_size);
+
+	if (strategy == UPLOAD_BLIT) {
+		staging_bo = drm_intel_bo_alloc(bufmgr, "staging",
+						object_size, 4096);
+		if (drm_intel_bo_map(staging_bo, 1))
+			goto out;
+	}
+
+	for (pass = 0; pass < MAX_PASSES; pass++) {
+		double start, elapsed;
+		int frame;
+
+		start = get_time_in_secs();
+		for (frame = 0; frame < PASS_FRAMES; frame++) {
+			drm_intel_bo *src = src_bo[frame % n_src];
+
+			if (!do_upload(strategy, batch, src,
+				       staging_bo, host_buf))
+				goto out;
+
+			blit_copy(batch, dst_bo, src);
+			intel_batchbuffer_flush(batch);
+		}
+		drm_intel_bo_wait_rendering(dst_bo);
+		elapsed = get_time_in_secs() - start;
+
+		samples[n_samples++] =
+			(double)PASS_FRAMES * object_size / (1024.*1024.) /
+			elapsed;
+
+		if (n_samples >= MIN_PASSES) {
+			double min = samples[n_samples - STEADY_WINDOW];
+			double max = min;
+
+			for (n = n_samples - STEADY_WINDOW; n < n_samples; n++) {
+				if (samples[n] < min)
+					min = samples[n];
+				if (samples[n] > max)
+					max = samples[n];
+			}
+
+			if (max - min <= STEADY_TOLERANCE * min)
+				break;
+		}
+	}
+
+	/* The warm-up passes are exactly the ones steady-state detection
+	 * rejected; only the settled window describes the sustained rate. */
+	igt_stats_init_with_size(stats, STEADY_WINDOW);
+	for (n = n_samples - STEADY_WINDOW; n < n_samples; n++)
+		igt_stats_push_float(stats, samples[n]);
+	result = igt_stats_get_median(stats);
+
+out:
+	if (staging_bo) {
+		drm_intel_bo_unmap(staging_bo);
+		drm_intel_bo_unreference(staging_bo);
+	}
+	free(host_buf);
+	drm_intel_bo_unreference(dst_bo);
+	for (n = 0; n < n_src; n++)
+		drm_intel_bo_unreference(src_bo[n]);
+
+	return result;
+}
+
+static int parse_strategies(const char *arg)
+{
+	char *dup = strdup(arg), *tok, *save = NULL;
+	int mask = 0, n;
+
+	for (tok = strtok_r(dup, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		if (strcmp(tok, "all") == 0) {
+			mask = (1 << NUM_STRATEGIES) - 1;
+			continue;
+		}
+		for (n = 0; n < NUM_STRATEGIES; n++)
+			if (strcmp(tok, strategy_names[n]) == 0)
+				break;
+		if (n == NUM_STRATEGIES) {
+			free(dup);
+			return -1;
+		}
+		mask |= 1 << n;
+	}
+
+	free(dup);
+	return mask;
+}
+
+static int parse_working_sets(const char *arg, int *ws)
+{
+	char *dup = strdup(arg), *tok, *save = NULL;
+	int count = 0;
+
+	for (tok = strtok_r(dup, ",", &save);
+	     tok && count < MAX_WORKING_SETS;
+	     tok = strtok_r(NULL, ",", &save)) {
+		ws[count] = atoi(tok);
+		if (ws[count] <= 0) {
+			free(dup);
+			return -1;
+		}
+		count++;
+	}
+
+	free(dup);
+	return count;
+}
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [OPTION]...\n"
+	       "  -u LIST   strategies to run: pwrite,gtt,wc,blit or all (default: all)\n"
+	       "  -w LIST   working-set sizes in MiB (default: 4,16,64,256)\n"
+	       "  -W WIDTH  object width in pixels (default: %d)\n"
+	       "  -H HEIGHT object height in pixels (default: %d)\n"
+	       "  -s        split pwrite uploads into 1-64 dword pieces\n"
+	       "  -f FORMAT emit machine-readable results (json or csv)\n"
+	       "  -h        show this help\n",
+	       name, OBJECT_WIDTH, OBJECT_HEIGHT);
+}
+
+int main(int argc, char **argv)
+{
+	int ws[MAX_WORKING_SETS] = { 4, 16, 64, 256 };
+	int n_ws = 4;
+	int strategies = (1 << NUM_STRATEGIES) - 1;
+	drm_intel_bufmgr *bufmgr;
+	struct intel_batchbuffer *batch;
+	int c, n, w;
+
+	while ((c = getopt(argc, argv, "u:w:W:H:sf:h")) != -1) {
+		switch (c) {
+		case 'u':
+			strategies = parse_strategies(optarg);
+			if (strategies <= 0) {
+				fprintf(stderr, "unknown strategy in '%s'\n",
+					optarg);
+				return 1;
+			}
+			break;
+		case 'w':
+			n_ws = parse_working_sets(optarg, ws);
+			if (n_ws <= 0) {
+				fprintf(stderr, "invalid working set '%s'\n",
+					optarg);
+				return 1;
+			}
+			break;
+		case 'W':
+			width = atoi(optarg);
+			break;
+		case 'H':
+			height = atoi(optarg);
+			break;
+		case 's':
+			small_uploads = true;
+			break;
+		case 'f':
+			if (bench_report_set_format(optarg)) {
+				fprintf(stderr, "unknown format '%s'\n",
+					optarg);
+				return 1;
+			}
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	drm_fd = drm_open_driver(DRIVER_INTEL);
+
+	bufmgr = drm_intel_bufmgr_gem_init(drm_fd, 4096);
+	drm_intel_bufmgr_gem_enable_reuse(bufmgr);
+
+	batch = intel_batchbuffer_alloc(bufmgr, intel_get_drm_devid(drm_fd));
+
+	if (bench_report_enabled())
+		bench_report_begin("intel_upload_blit");
+	else {
+		printf("%-8s", "MiB/s");
+		for (w = 0; w < n_ws; w++)
+			printf("%9dM", ws[w]);
+		printf("\n");
+	}
+
+	for (n = 0; n < NUM_STRATEGIES; n++) {
+		if (!(strategies & (1 << n)))
+			continue;
+
+		if (!bench_report_enabled())
+			printf("%-8s", strategy_names[n]);
+
+		for (w = 0; w < n_ws; w++) {
+			igt_stats_t stats;
+			double mbps;
+
+			mbps = run_cell(bufmgr, batch, n, ws[w], &stats);
+
+			if (bench_report_enabled()) {
+				char name[32];
+
+				if (mbps < 0)
+					continue;
+				snprintf(name, sizeof(name), "%s:ws%dM",
+					 strategy_names[n], ws[w]);
+				bench_report_stats(name, "MiB/s", &stats);
+			} else {
+				if (mbps < 0)
+					printf("%10s", "n/a");
+				else
+					printf("%10.1f", mbps);
+				fflush(stdout);
+			}
+
+			if (mbps >= 0)
+				igt_stats_fini(&stats);
+		}
+
+		if (!bench_report_enabled())
+			printf("\n");
+	}
+
+	if (bench_report_enabled())
+		bench_report_end();
+
+	intel_batchbuffer_free(batch);
+	drm_intel_bufmgr_destroy(bufmgr);
+
+	close(drm_fd);
+
+	return 0;
+}
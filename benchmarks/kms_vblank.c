@@ -41,8 +41,14 @@
 #include <drm.h>
 #include <xf86drm.h>
 #include "drmtest.h"
+#include "igt_dummyload.h"
+#include "igt_stats.h"
 #include "assert.h"
 
+#ifndef DRM_CAP_TIMESTAMP_MONOTONIC
+#define DRM_CAP_TIMESTAMP_MONOTONIC 0x6
+#endif
+
 static double elapsed(const struct timespec *start,
 		      const struct timespec *end,
 		      int loop)
@@ -129,13 +135,72 @@ static void vblank_event(int fd, int busy)
 		assert(read(fd, &event, sizeof(event)) != -1);
 }
 
+/*
+ * Wakeup latency of DRM_IOCTL_WAIT_VBLANK under GPU load: frame pacing in
+ * the compositor depends on how promptly the vblank wait returns, not on
+ * how many queries per second the ioctl sustains. The latency of each
+ * wakeup is the time between the vblank timestamp the kernel reports and
+ * our return to userspace; spinning batches supply the load, doubling the
+ * queue depth per level up to the requested maximum.
+ */
+static void vblank_latency(int fd, int max_load)
+{
+	const int spins_per_level[] = { 0, 1, 2, 4, 8, 16, 32 };
+	clockid_t clock = CLOCK_REALTIME;
+	uint64_t cap = 0;
+
+	if (drmGetCap(fd, DRM_CAP_TIMESTAMP_MONOTONIC, &cap) == 0 && cap)
+		clock = CLOCK_MONOTONIC;
+
+	for (int l = 0; l < sizeof(spins_per_level)/sizeof(int); l++) {
+		const int load = spins_per_level[l];
+		igt_spin_t *spin[32];
+		igt_stats_t stats;
+		int n;
+
+		if (load > max_load)
+			break;
+
+		for (n = 0; n < load; n++)
+			spin[n] = igt_spin_batch_new(fd, 0, 0);
+
+		igt_stats_init_with_size(&stats, 240);
+		for (n = 0; n < 240; n++) {
+			union drm_wait_vblank vbl;
+			struct timespec now;
+
+			memset(&vbl, 0, sizeof(vbl));
+			vbl.request.type = DRM_VBLANK_RELATIVE;
+			vbl.request.sequence = 1;
+			drmIoctl(fd, DRM_IOCTL_WAIT_VBLANK, &vbl);
+			clock_gettime(clock, &now);
+
+			igt_stats_push_float(&stats,
+					     1e6 * (now.tv_sec - vbl.reply.tval_sec) +
+					     (now.tv_nsec / 1000. - vbl.reply.tval_usec));
+		}
+
+		printf("load %2d: p50 %.1fus, p90 %.1fus, p99 %.1fus, max %.1fus\n",
+		       load,
+		       igt_stats_get_percentile(&stats, 50),
+		       igt_stats_get_percentile(&stats, 90),
+		       igt_stats_get_percentile(&stats, 99),
+		       igt_stats_get_percentile(&stats, 100));
+		igt_stats_fini(&stats);
+
+		for (n = 0; n < load; n++)
+			igt_spin_batch_free(fd, spin[n]);
+	}
+}
+
 int main(int argc, char **argv)
 {
 	int fd, c;
 	int busy = 0, loops = 5;
+	int latency_load = -1;
 	enum what { EVENTS, QUERIES } what = EVENTS;
 
-	while ((c = getopt (argc, argv, "b:w:r:")) != -1) {
+	while ((c = getopt (argc, argv, "b:w:r:l:")) != -1) {
 		switch (c) {
 		case 'b':
 			if (strcmp(optarg, "busy") == 0)
@@ -158,6 +223,16 @@ int main(int argc, char **argv)
 			loops = atoi(optarg);
 			if (loops < 1)
 				loops = 1;
+			break;
+
+		case 'l':
+			/* Wakeup latency percentiles up to this many spinners */
+			latency_load = atoi(optarg);
+			if (latency_load < 0)
+				latency_load = 0;
+			if (latency_load > 32)
+				latency_load = 32;
+			break;
 		}
 	}
 
@@ -167,6 +242,11 @@ int main(int argc, char **argv)
 		return 77;
 	}
 
+	if (latency_load >= 0) {
+		vblank_latency(fd, latency_load);
+		return 0;
+	}
+
 	while (loops--) {
 		switch (what) {
 		case EVENTS:
@@ -30,6 +30,7 @@
 #include <fcntl.h>
 #include <inttypes.h>
 #include <errno.h>
+#include <math.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
 #include <sys/resource.h>
@@ -124,6 +125,88 @@ static int loop(int nobj, int ndev, int nage, int ncpus, unsigned flags)
 	return 0;
 }
 
+/*
+ * Cross-process lookup scaling: the parent exports a pool of dmabufs once,
+ * then for every client count 1..N forks that many processes which all
+ * hammer FD_TO_HANDLE (plus a re-export and HANDLE_TO_FD) against the
+ * shared fds through their own device fd. The single-client run sets the
+ * baseline; scaling efficiency is aggregate / (clients * baseline), so a
+ * perfectly partitioned lookup path reads 1.00 and lock contention shows
+ * up directly as the fraction lost per added client.
+ */
+static int scaling(int nobj, int max_clients)
+{
+	struct timespec start, end;
+	double *results, baseline = 0;
+	uint32_t *handle;
+	int *prime;
+	int parent;
+	int size;
+	int n;
+
+	parent = drm_open_driver(DRIVER_INTEL);
+
+	size = (max_clients + 1) * sizeof(*results);
+	size = (size + 4095) & -4096;
+	results = mmap(0, size, PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
+
+	handle = malloc(nobj * sizeof(*handle));
+	prime = malloc(nobj * sizeof(*prime));
+	for (n = 0; n < nobj; n++) {
+		handle[n] = gem_create(parent, 4096);
+		prime[n] = prime_handle_to_fd(parent, handle[n]);
+	}
+
+	for (int nproc = 1; nproc <= max_clients; nproc++) {
+		double sum = 0, min = HUGE_VAL;
+
+		memset(results, 0, size);
+
+		igt_fork(child, nproc) {
+			unsigned long count = 0;
+			int dev;
+
+			hars_petruska_f54_1_random_perturb(child);
+			dev = drm_open_driver(DRIVER_INTEL);
+
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			do {
+				for (n = 0; n < 1024; n++) {
+					int i = hars_petruska_f54_1_random_unsafe() % nobj;
+					uint32_t h;
+					int fd;
+
+					h = prime_fd_to_handle(dev, prime[i]);
+					fd = prime_handle_to_fd(dev, h);
+					close(fd);
+					gem_close(dev, h);
+				}
+
+				count += n;
+				clock_gettime(CLOCK_MONOTONIC, &end);
+			} while (elapsed(&start, &end) < 2.);
+
+			results[child] = count / elapsed(&start, &end);
+		}
+		igt_waitchildren();
+
+		for (n = 0; n < nproc; n++) {
+			sum += results[n];
+			if (results[n] < min)
+				min = results[n];
+		}
+
+		if (nproc == 1)
+			baseline = sum;
+
+		printf("%3d clients: %12.0f lookups/s total, %11.0f per client (min %.0f), efficiency %.2f\n",
+		       nproc, sum, sum / nproc, min,
+		       sum / (nproc * baseline));
+	}
+
+	return 0;
+}
+
 static bool allow_files(unsigned min)
 {
 	struct rlimit rlim;
@@ -162,7 +245,9 @@ int main(int argc, char **argv)
 	int nage = 1024;
 	int c;
 
-	while ((c = getopt (argc, argv, "a:d:o:cf")) != -1) {
+	int max_clients = 0;
+
+	while ((c = getopt (argc, argv, "a:d:o:p:cf")) != -1) {
 		switch (c) {
 		case 'o':
 			nobj = atoi(optarg);
@@ -190,11 +275,28 @@ int main(int argc, char **argv)
 			flags |= CLOSE_DEVICE;
 			break;
 
+		case 'p':
+			/* Sweep 1..N processes over shared dmabufs */
+			max_clients = atoi(optarg);
+			if (max_clients < 1)
+				max_clients = 1;
+			break;
+
 		default:
 			break;
 		}
 	}
 
+	if (max_clients) {
+		if (nobj > 1024)
+			nobj = 1024;
+		if (!allow_files(nobj + 64)) {
+			fprintf(stderr, "Unable to relax fd limit\n");
+			exit(1);
+		}
+		return scaling(nobj, max_clients);
+	}
+
 	if (!allow_files((nage + 1)*ndev + 1)) {
 		fprintf(stderr, "Unable to relax fd limit\n");
 		exit(1);
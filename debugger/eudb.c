@@ -30,6 +30,7 @@
 #include <signal.h>
 #include <stdlib.h>
 #include <fcntl.h>
+#include <time.h>
 #include <unistd.h>
 #include <string.h>
 #include <strings.h>
@@ -88,6 +89,9 @@ int debug_fd = 0;
 const char *debug_file = "dump_debug.bin";
 int debug;
 int clear_waits;
+int batch_fd = -1;
+const char *batch_file;
+uint8_t *batch_staging;
 int shutting_down = 0;
 struct intel_debug_handshake dh;
 int force_clear = 0;
@@ -292,6 +296,64 @@ collect_data(int bit, volatile uint8_t *buf) {
 	return 0;
 }
 
+/*
+ * Batched collection: instead of locating, verifying and writing out each
+ * waiting thread's state one at a time over the (slow) debug buffer, grab
+ * the whole scratch area in a single pass and append it to one record
+ * file. That keeps the time the EUs sit at the breakpoint down to one
+ * memcpy plus one write, which is fast enough to use periodically as a
+ * sampling profiler, and leaves all the per-thread decoding to the offline
+ * -r pass.
+ */
+#define BATCH_RECORD_MAGIC 0x42554445 /* "EUDB" */
+
+struct batch_record_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t num_threads;
+	uint32_t per_thread_scratch;
+	uint64_t timestamp_ns;
+};
+
+static int
+collect_batch(volatile uint8_t *buf) {
+	size_t size = eu_info->num_threads * dh.per_thread_scratch;
+	struct batch_record_header header;
+	struct timespec ts;
+
+	if (batch_fd == -1) {
+		batch_fd = open(batch_file, O_CREAT | O_WRONLY | O_TRUNC,
+				S_IRWXO);
+		if (batch_fd == -1) {
+			perror("open batch file");
+			return -1;
+		}
+	}
+
+	if (!batch_staging) {
+		batch_staging = malloc(size);
+		if (!batch_staging)
+			return -1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	header.magic = BATCH_RECORD_MAGIC;
+	header.version = DEBUG_HANDSHAKE_VERSION;
+	header.num_threads = eu_info->num_threads;
+	header.per_thread_scratch = dh.per_thread_scratch;
+	header.timestamp_ns = ts.tv_sec * 1000000000ull + ts.tv_nsec;
+
+	memcpy(batch_staging, (void *)buf, size);
+
+	if (write(batch_fd, &header, sizeof(header)) != sizeof(header) ||
+	    write(batch_fd, batch_staging, size) != size) {
+		perror("unhandled write failure");
+		return -EBAD_WRITE;
+	}
+
+	return 0;
+}
+
 static void
 clear_attn(int bit) {
 #if 0
@@ -336,6 +398,10 @@ die(int reason) {
 	if (debug_fd)
 		close(debug_fd);
 
+	if (batch_fd != -1)
+		close(batch_fd);
+	free(batch_staging);
+
 	for (i = 0; i < eu_info->num_threads; i++) {
 		if (eu_info->debuggees[i].fd != -1)
 			close(eu_info->debuggees[i].fd);
@@ -368,6 +434,53 @@ identify_device(int devid) {
 	return 0;
 }
 
+/* Offline formatting of the records written by collect_batch(): walk each
+ * snapshot, decode which EU/thread every scratch slot belongs to from its
+ * sr0 and print the slots that carry valid state. */
+static void
+parse_batch_data(const uint8_t *data, size_t size) {
+	const struct batch_record_header *header;
+	size_t offset = 0, record_size;
+	int record = 0;
+	uint32_t i;
+
+	while (offset + sizeof(*header) <= size) {
+		header = (const struct batch_record_header *)(data + offset);
+		if (header->magic != BATCH_RECORD_MAGIC) {
+			fprintf(stderr, "Bad record magic at %zd\n", offset);
+			return;
+		}
+
+		record_size = (size_t)header->num_threads *
+			      header->per_thread_scratch;
+		if (offset + sizeof(*header) + record_size > size) {
+			fprintf(stderr, "Truncated record at %zd\n", offset);
+			return;
+		}
+
+		printf("Record %d (t=%llu ns):\n", record++,
+		       (unsigned long long)header->timestamp_ns);
+
+		for (i = 0; i < header->num_threads; i++) {
+			const struct eu_state *eu;
+
+			eu = (const struct eu_state *)
+				(data + offset + sizeof(*header) +
+				 i * header->per_thread_scratch);
+			if (memcmp(eu->state_magic, eu_msg, sizeof(grf)) &&
+			    memcmp(eu->state_magic, cpu_ack, sizeof(grf)))
+				continue;
+
+			printf("  EU %2d thread %d AIP: %x\n",
+			       (int)((eu->sr0 >> 8) & 0xf),
+			       (int)(eu->sr0 & 0x7),
+			       ((uint32_t *)eu->cr0)[2]);
+		}
+
+		offset += sizeof(*header) + record_size;
+	}
+}
+
 static void
 parse_data(const char *file_name) {
 	struct eu_state *eu_state = NULL;
@@ -399,6 +512,12 @@ parse_data(const char *file_name) {
 		goto out;
 	}
 
+	if (st.st_size >= sizeof(uint32_t) &&
+	    *(uint32_t *)eu_state == BATCH_RECORD_MAGIC) {
+		parse_batch_data((const uint8_t *)eu_state, st.st_size);
+		goto out;
+	}
+
 	for(i = 0; i < elements; i++) {
 		printf("AIP: ");
 			printf("%x\n", ((uint32_t *)eu_state[i].cr0)[2]);
@@ -508,8 +627,11 @@ int main(int argc, char* argv[]) {
 	int bits[64];
 	int devid = -1, opt;
 
-	while ((opt = getopt(argc, argv, "cdr:pf?h")) != -1) {
+	while ((opt = getopt(argc, argv, "b:cdr:pf?h")) != -1) {
 		switch (opt) {
+		case 'b':
+			batch_file = optarg;
+			break;
 		case 'c':
 			clear_waits = 1;
 			break;
@@ -587,6 +709,14 @@ int main(int argc, char* argv[]) {
 		if (num_events == 0)
 			break;
 
+		if (batch_file) {
+			/* One snapshot covers every waiting thread. */
+			if (collect_batch(scratch) == 0)
+				for (i = 0; i < num_events; i++)
+					clear_attn(bits[i]);
+			continue;
+		}
+
 		for (i = 0; i < num_events; i++) {
 			assert(bits[i] < 64 && bits[i] >= 0);
 			if (collect_data(bits[i], scratch)) {
@@ -475,8 +475,11 @@ static int prepare_sprite_surfaces(int fd, int sprite_width, int sprite_height,
 	return 0;
 }
 
+/* Number of precomputed pattern frames cycled through in benchmark mode */
+#define SPRITE_PHASES 8
+
 static void ricochet(int tiled, int sprite_w, int sprite_h,
-		     int out_w, int out_h, int dump_info)
+		     int out_w, int out_h, int dump_info, int benchmark)
 {
 	int                                 ret;
 	int                                 gfx_fd;
@@ -484,6 +487,11 @@ static void ricochet(int tiled, int sprite_w, int sprite_h,
 	const int                           num_surfaces = 3;
 	uint32_t                            sprite_handles[num_surfaces];
 	uint32_t                            sprite_fb_id[num_surfaces];
+	uint32_t                            *sprite_ptr[num_surfaces];
+	void                                *frame_pat[SPRITE_PHASES];
+	long long                           benchStartTime;
+	long                                frames,
+					    frame_no;
 	int                                 *sprite_x = NULL;
 	int                                 *sprite_y = NULL;
 	uint32_t                            sprite_stride;
@@ -625,6 +633,9 @@ static void ricochet(int tiled, int sprite_w, int sprite_h,
 			goto out;
 		}
 
+		memset(sprite_ptr, 0, sizeof(sprite_ptr));
+		memset(frame_pat, 0, sizeof(frame_pat));
+
 		// Add the sprite framebuffers
 		for (sprite_index = 0; sprite_index < num_surfaces; sprite_index++) {
 			handles[0] = sprite_handles[sprite_index];
@@ -641,6 +652,24 @@ static void ricochet(int tiled, int sprite_w, int sprite_h,
 					    DRM_FORMAT_XRGB8888,
 					    handles, pitches, offsets,
 					    &sprite_fb_id[sprite_index], plane_flags);
+
+			// Keep a persistent WC mapping around for the
+			// per-frame rewrites; the mapping outlives the handle.
+			if (benchmark) {
+				if (gem_mmap__has_wc(gfx_fd))
+					sprite_ptr[sprite_index] =
+						__gem_mmap__wc(gfx_fd,
+							sprite_handles[sprite_index],
+							0, sprite_size,
+							PROT_READ | PROT_WRITE);
+				else
+					sprite_ptr[sprite_index] =
+						__gem_mmap__gtt(gfx_fd,
+							sprite_handles[sprite_index],
+							sprite_size,
+							PROT_READ | PROT_WRITE);
+			}
+
 			gem_close(gfx_fd, sprite_handles[sprite_index]);
 
 			if (ret) {
@@ -758,6 +787,27 @@ static void ricochet(int tiled, int sprite_w, int sprite_h,
 		sprite_index = num_surfaces - 1;
 		keep_moving = 1;
 
+		if (benchmark) {
+			/* Precompute the pattern frames once: filling them
+			 * involves reads of the buffer being filled, which
+			 * would be uncached reads on the WC maps. Per frame
+			 * only a straight streaming copy hits the surface. */
+			for (i = 0; i < SPRITE_PHASES; i++) {
+				frame_pat[i] = malloc(sprite_size);
+				if (frame_pat[i])
+					fill_sprite(sprite_w, sprite_h,
+						    sprite_stride, i,
+						    frame_pat[i]);
+			}
+
+			// Flip and move on every iteration, no throttling
+			deltaFlipTime = 0;
+			deltaMoveTime = 0;
+		}
+		benchStartTime = 0;
+		frames = 0;
+		frame_no = 0;
+
 		// Bounce sprite off the walls
 		while (keep_moving) {
 			// Obtain system time in usec.
@@ -770,6 +820,14 @@ static void ricochet(int tiled, int sprite_w, int sprite_h,
 			if (currTime - prevFlipTime > deltaFlipTime) {
 				sprite_index = (sprite_index + 1) % num_surfaces;
 
+				// Rewrite the back buffer while the other two
+				// surfaces are still queued/displayed
+				if (benchmark && sprite_ptr[sprite_index] &&
+				    frame_pat[frame_no % SPRITE_PHASES])
+					memcpy(sprite_ptr[sprite_index],
+					       frame_pat[frame_no % SPRITE_PHASES],
+					       sprite_size);
+
 				prevFlipTime = currTime;
 			}
 
@@ -858,12 +916,40 @@ static void ricochet(int tiled, int sprite_w, int sprite_h,
 				tcflush(0, TCIFLUSH);
 			}
 
+			if (benchmark) {
+				frames++;
+				frame_no++;
+				if (benchStartTime == 0) {
+					benchStartTime = currTime;
+					frames = 0;
+				} else if (currTime - benchStartTime > 1000000) {
+					printf("\r%7.3f ms/frame (%6.1f FPS)   ",
+					       (currTime - benchStartTime) /
+					       (frames * 1000.0),
+					       frames * 1000000.0 /
+					       (currTime - benchStartTime));
+					fflush(stdout);
+					benchStartTime = currTime;
+					frames = 0;
+				}
+				continue;
+			}
+
 			// Wait for min of flip or move deltas
 			SleepTime = (deltaFlipTime < deltaMoveTime) ?
 				deltaFlipTime : deltaMoveTime;
 			usleep(SleepTime);
 		}
 
+		if (benchmark) {
+			printf("\n");
+			for (i = 0; i < num_surfaces; i++)
+				if (sprite_ptr[i])
+					munmap(sprite_ptr[i], sprite_size);
+			for (i = 0; i < SPRITE_PHASES; i++)
+				free(frame_pat[i]);
+		}
+
 		free(sprite_plane_id);
 		free(sprite_x);
 		free(sprite_y);
@@ -888,7 +974,9 @@ out:
 
 static void usage(char *name)
 {
-	printf("usage: %s -s <plane width>x<plane height> [-dhto]\n"
+	printf("usage: %s -s <plane width>x<plane height> [-bdhto]\n"
+		"\t-b\t[optional] benchmark mode: unthrottled flips with\n"
+		"\t\t           per-frame surface rewrites and an ms/frame readout\n"
 		"\t-d\t[optional] dump mode information\n"
 		"\t-h\t[optional] output help message\n"
 		"\t-t\t[optional] enable tiling\n"
@@ -908,16 +996,20 @@ int main(int argc, char **argv)
 	int                 c;
 	int                 test_overlay = 0,
 			    enable_tiling = 0,
-			    dump_info = 0;
+			    dump_info = 0,
+			    benchmark = 0;
 	int                 plane_width = 0,
 			    plane_height = 0,
 			    out_width = 0,
 			    out_height = 0;
-	static char         optstr[] = "ds:o:th";
+	static char         optstr[] = "bds:o:th";
 
 	opterr = 0;
 	while ((c = getopt(argc, argv, optstr)) != -1) {
 		switch (c) {
+		case 'b':               // Benchmark mode
+			benchmark = 1;
+			break;
 		case 'd':               // Dump information
 			dump_info = 1;
 			break;
@@ -949,7 +1041,8 @@ int main(int argc, char **argv)
 		if (out_height < (plane_height / 2))
 			out_height = plane_height;
 
-		ricochet(enable_tiling, plane_width, plane_height, out_width, out_height, dump_info);
+		ricochet(enable_tiling, plane_width, plane_height, out_width,
+			 out_height, dump_info, benchmark);
 	} else {
 		printf("Sprite dimensions are required:\n");
 		usage(argv[0]);
@@ -237,6 +237,84 @@ static int modprobe(const char *driver)
 	return igt_kmod_load(driver, "");
 }
 
+/*
+ * Remember which device node matched each chipset filter, so that the tens
+ * of fixtures in a typical test binary don't each re-walk /dev/dri and
+ * re-query the driver name. Only the node path is cached, every caller
+ * still gets its own file description and hence its own handle namespace;
+ * primary and render nodes are cached separately, so GEM-only users keep
+ * hitting the render node however often others open the primary.
+ */
+enum { NODE_PRIMARY, NODE_RENDER, NODE_TYPES };
+#define NODE_CACHE_SIZE 4
+
+static struct node_cache {
+	int chipset;
+	char node[80];
+} cached_nodes[NODE_TYPES][NODE_CACHE_SIZE];
+
+static struct node_cache *cached_node_find(int type, int chipset)
+{
+	for (int i = 0; i < NODE_CACHE_SIZE; i++)
+		if (cached_nodes[type][i].node[0] &&
+		    cached_nodes[type][i].chipset == chipset)
+			return &cached_nodes[type][i];
+
+	return NULL;
+}
+
+static void cached_node_store(int type, int chipset, const char *node)
+{
+	static unsigned int evict[NODE_TYPES];
+	struct node_cache *c = cached_node_find(type, chipset);
+
+	if (!c)
+		c = &cached_nodes[type][evict[type]++ % NODE_CACHE_SIZE];
+
+	c->chipset = chipset;
+	strcpy(c->node, node);
+}
+
+/**
+ * drm_forget_cached_devices:
+ *
+ * Drops the cached device node paths used to short-circuit the /dev/dri walk
+ * in drm_open_driver() and friends. Tests which unload or reload modules must
+ * call this since minor numbers may move around.
+ */
+void drm_forget_cached_devices(void)
+{
+	memset(cached_nodes, 0, sizeof(cached_nodes));
+}
+
+static bool chipset_matches(int fd, int chipset)
+{
+	if (chipset & DRIVER_INTEL && is_i915_device(fd) &&
+	    has_known_intel_chipset(fd))
+		return true;
+
+	if (chipset & DRIVER_VC4 &&
+	    is_vc4_device(fd))
+		return true;
+
+	if (chipset & DRIVER_VGEM &&
+	    is_vgem_device(fd))
+		return true;
+
+	if (chipset & DRIVER_VIRTIO &&
+	    is_virtio_device(fd))
+		return true;
+
+	if (chipset & DRIVER_AMDGPU && is_amd_device(fd))
+		return true;
+
+	/* Only VGEM-specific tests should be run on VGEM */
+	if (chipset == DRIVER_ANY && !is_vgem_device(fd))
+		return true;
+
+	return false;
+}
+
 /**
  * __drm_open_driver:
  * @chipset: OR'd flags for each chipset to search, eg. #DRIVER_INTEL
@@ -246,42 +324,35 @@ static int modprobe(const char *driver)
  * Returns:
  * An open DRM fd or -1 on error
  */
-int __drm_open_driver(int chipset)
+static int __drm_open_node(int type, int chipset)
 {
-	if (chipset & DRIVER_VGEM)
-		modprobe("vgem");
+	struct node_cache *c = cached_node_find(type, chipset);
+	int base = type == NODE_RENDER ? 128 : 0;
 
-	for (int i = 0; i < 16; i++) {
+	if (c) {
+		int fd = open(c->node, O_RDWR);
+
+		if (fd != -1)
+			return fd;
+
+		/* module reload or hotplug, fall back to a full probe */
+		c->node[0] = '\0';
+	}
+
+	for (int i = base; i < base + 16; i++) {
 		char name[80];
 		int fd;
 
-		sprintf(name, "/dev/dri/card%u", i);
+		sprintf(name, type == NODE_RENDER ?
+			"/dev/dri/renderD%u" : "/dev/dri/card%u", i);
 		fd = open(name, O_RDWR);
 		if (fd == -1)
 			continue;
 
-		if (chipset & DRIVER_INTEL && is_i915_device(fd) &&
-		    has_known_intel_chipset(fd))
-			return fd;
-
-		if (chipset & DRIVER_VC4 &&
-		    is_vc4_device(fd))
-			return fd;
-
-		if (chipset & DRIVER_VGEM &&
-		    is_vgem_device(fd))
-			return fd;
-
-		if (chipset & DRIVER_VIRTIO &&
-		    is_virtio_device(fd))
-			return fd;
-
-		if (chipset & DRIVER_AMDGPU && is_amd_device(fd))
-			return fd;
-
-		/* Only VGEM-specific tests should be run on VGEM */
-		if (chipset == DRIVER_ANY && !is_vgem_device(fd))
+		if (chipset_matches(fd, chipset)) {
+			cached_node_store(type, chipset, name);
 			return fd;
+		}
 
 		close(fd);
 	}
@@ -289,33 +360,17 @@ int __drm_open_driver(int chipset)
 	return -1;
 }
 
-static int __drm_open_driver_render(int chipset)
+int __drm_open_driver(int chipset)
 {
-	char *name;
-	int i, fd;
-
-	for (i = 128; i < (128 + 16); i++) {
-		int ret;
-
-		ret = asprintf(&name, "/dev/dri/renderD%u", i);
-		igt_assert(ret != -1);
-
-		fd = open(name, O_RDWR);
-		free(name);
-
-		if (fd == -1)
-			continue;
-
-		if (!is_i915_device(fd) || !has_known_intel_chipset(fd)) {
-			close(fd);
-			fd = -1;
-			continue;
-		}
+	if (chipset & DRIVER_VGEM)
+		modprobe("vgem");
 
-		return fd;
-	}
+	return __drm_open_node(NODE_PRIMARY, chipset);
+}
 
-	return fd;
+static int __drm_open_driver_render(int chipset)
+{
+	return __drm_open_node(NODE_RENDER, chipset);
 }
 
 static int at_exit_drm_fd = -1;
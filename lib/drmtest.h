@@ -89,6 +89,7 @@ int drm_open_driver(int chipset);
 int drm_open_driver_master(int chipset);
 int drm_open_driver_render(int chipset);
 int __drm_open_driver(int chipset);
+void drm_forget_cached_devices(void);
 
 void gem_quiescent_gpu(int fd);
 
@@ -0,0 +1,51 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef FILL_STATE_CACHE_H
+#define FILL_STATE_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Cache for the state half of a media/gpgpu fill batch.  The curbe,
+ * binding table, surface state, kernel and interface descriptor a fill
+ * function emits are identical from call to call except for the fill
+ * color and the destination surface, so each fill function builds the
+ * block once, then memcpys it into fresh batches and patches the color
+ * byte and the surface state (plus its relocation).  That cuts the
+ * per-fill CPU setup to one copy and two patches, which matters for
+ * tests that fill thousands of surfaces.
+ */
+struct fill_state_cache {
+	bool valid;
+	/* bytes of state, starting at BATCH_STATE_SPLIT in the batch */
+	uint32_t size;
+	/* batch offsets to patch (color, dst surface) and to reference */
+	uint32_t curbe_offset;
+	uint32_t surface_offset;
+	uint32_t idd_offset;
+	uint8_t state[2048];
+};
+
+#endif /* FILL_STATE_CACHE_H */
@@ -34,6 +34,17 @@
 #include "gen7_media.h"
 #include "gen8_media.h"
 #include "gpgpu_fill.h"
+#include "fill_state_cache.h"
+
+/* One cache per fill variant; the gen8 and gen9 kernels differ. */
+static struct fill_state_cache gen7_state_cache;
+static struct fill_state_cache gen8_state_cache;
+static struct fill_state_cache gen9_state_cache;
+
+/* Batch offset of the most recently emitted surface state, so the
+ * cached-state path knows what to patch on later fills.
+ */
+static uint32_t last_surface_offset;
 
 /* shaders/gpgpu/gpgpu_fill.gxa */
 static const uint32_t gen7_gpgpu_kernel[][4] = {
@@ -182,9 +193,44 @@ gen7_fill_surface_state(struct intel_batchbuffer *batch,
 	ss->ss7.shader_chanel_select_b = 6;
 	ss->ss7.shader_chanel_select_a = 7;
 
+	last_surface_offset = offset;
+
 	return offset;
 }
 
+/*
+ * Patch the destination-dependent fields of a cached surface state and
+ * re-emit its relocation for the new batch bo.
+ */
+static void
+gen7_patch_surface_state(struct intel_batchbuffer *batch,
+			 struct igt_buf *buf, uint32_t offset)
+{
+	struct gen7_surface_state *ss =
+		(struct gen7_surface_state *)&batch->buffer[offset];
+	int ret;
+
+	if (buf->tiling == I915_TILING_X)
+		ss->ss0.tiled_mode = 2;
+	else if (buf->tiling == I915_TILING_Y)
+		ss->ss0.tiled_mode = 3;
+	else
+		ss->ss0.tiled_mode = 0;
+
+	ss->ss1.base_addr = buf->bo->offset;
+	ret = drm_intel_bo_emit_reloc(batch->bo,
+				offset + 4,
+				buf->bo, 0,
+				I915_GEM_DOMAIN_RENDER,
+				I915_GEM_DOMAIN_RENDER);
+	igt_assert(ret == 0);
+
+	ss->ss2.height = igt_buf_height(buf) - 1;
+	ss->ss2.width  = igt_buf_width(buf) - 1;
+
+	ss->ss3.pitch  = buf->stride - 1;
+}
+
 static uint32_t
 gen8_fill_surface_state(struct intel_batchbuffer *batch,
 			struct igt_buf *buf,
@@ -233,10 +279,41 @@ gen8_fill_surface_state(struct intel_batchbuffer *batch,
 	ss->ss7.shader_chanel_select_b = 6;
 	ss->ss7.shader_chanel_select_a = 7;
 
+	last_surface_offset = offset;
+
 	return offset;
 
 }
 
+static void
+gen8_patch_surface_state(struct intel_batchbuffer *batch,
+			 struct igt_buf *buf, uint32_t offset)
+{
+	struct gen8_surface_state *ss =
+		(struct gen8_surface_state *)&batch->buffer[offset];
+	int ret;
+
+	if (buf->tiling == I915_TILING_X)
+		ss->ss0.tiled_mode = 2;
+	else if (buf->tiling == I915_TILING_Y)
+		ss->ss0.tiled_mode = 3;
+	else
+		ss->ss0.tiled_mode = 0;
+
+	ss->ss8.base_addr = buf->bo->offset;
+
+	ret = drm_intel_bo_emit_reloc(batch->bo,
+				offset + 8 * 4,
+				buf->bo, 0,
+				I915_GEM_DOMAIN_RENDER,
+				I915_GEM_DOMAIN_RENDER);
+	igt_assert_eq(ret, 0);
+
+	ss->ss2.height = igt_buf_height(buf) - 1;
+	ss->ss2.width  = igt_buf_width(buf) - 1;
+	ss->ss3.pitch  = buf->stride - 1;
+}
+
 static uint32_t
 gen7_fill_binding_table(struct intel_batchbuffer *batch,
 			struct igt_buf *dst)
@@ -443,6 +520,17 @@ gen9_emit_state_base_address(struct intel_batchbuffer *batch)
 	OUT_BATCH(0xfffff000);
 }
 
+/*
+ * Maximum number of in-flight threads to program in MEDIA_VFE_STATE.
+ * Each walker thread group holds exactly one SIMD16 thread, so this is
+ * what decides how many groups the hardware executes concurrently;
+ * with the old value of 1 a 256MiB fill ran essentially serialized.
+ * The values follow what mesa programs for compute shaders on each gen.
+ */
+#define GEN7_GPGPU_MAX_THREADS 64
+#define GEN8_GPGPU_MAX_THREADS 64
+#define GEN9_GPGPU_MAX_THREADS 56
+
 static void
 gen7_emit_vfe_state_gpgpu(struct intel_batchbuffer *batch)
 {
@@ -452,7 +540,7 @@ gen7_emit_vfe_state_gpgpu(struct intel_batchbuffer *batch)
 	OUT_BATCH(0);
 
 	/* number of threads & urb entries */
-	OUT_BATCH(1 << 16 | /* max num of threads */
+	OUT_BATCH((GEN7_GPGPU_MAX_THREADS - 1) << 16 | /* max num of threads */
 		  0 << 8 | /* num of URB entry */
 		  1 << 2); /* GPGPU mode */
 
@@ -469,7 +557,8 @@ gen7_emit_vfe_state_gpgpu(struct intel_batchbuffer *batch)
 }
 
 static void
-gen8_emit_vfe_state_gpgpu(struct intel_batchbuffer *batch)
+gen8_emit_vfe_state_gpgpu(struct intel_batchbuffer *batch,
+			  unsigned max_threads)
 {
 	OUT_BATCH(GEN8_MEDIA_VFE_STATE | (9 - 2));
 
@@ -478,7 +567,7 @@ gen8_emit_vfe_state_gpgpu(struct intel_batchbuffer *batch)
 	OUT_BATCH(0);
 
 	/* number of threads & urb entries */
-	OUT_BATCH(1 << 16 | 1 << 8);
+	OUT_BATCH((max_threads - 1) << 16 | 1 << 8);
 
 	OUT_BATCH(0);
 
@@ -533,7 +622,8 @@ gen7_emit_gpgpu_walk(struct intel_batchbuffer *batch,
 
 	/*
 	 * Simply do SIMD16 based dispatch, so every thread uses
-	 * SIMD16 channels.
+	 * SIMD16 channels.  The kernel is compiled for SIMD16, so a
+	 * wider or narrower execution size would need new kernels.
 	 *
 	 * Define our own thread group size, e.g 16x1 for every group, then
 	 * will have 1 thread each group in SIMD16 dispatch. So thread
@@ -541,6 +631,10 @@ gen7_emit_gpgpu_walk(struct intel_batchbuffer *batch,
 	 *
 	 * Then thread group X = width / 16 (aligned to 16)
 	 * thread group Y = height;
+	 *
+	 * The groups tile the whole surface and are independent, so the
+	 * hardware runs as many of them concurrently as the max thread
+	 * count programmed in MEDIA_VFE_STATE allows.
 	 */
 	x_dim = (width + 15) / 16;
 	y_dim = height;
@@ -590,7 +684,8 @@ gen8_emit_gpgpu_walk(struct intel_batchbuffer *batch,
 
 	/*
 	 * Simply do SIMD16 based dispatch, so every thread uses
-	 * SIMD16 channels.
+	 * SIMD16 channels.  The kernel is compiled for SIMD16, so a
+	 * wider or narrower execution size would need new kernels.
 	 *
 	 * Define our own thread group size, e.g 16x1 for every group, then
 	 * will have 1 thread each group in SIMD16 dispatch. So thread
@@ -598,6 +693,10 @@ gen8_emit_gpgpu_walk(struct intel_batchbuffer *batch,
 	 *
 	 * Then thread group X = width / 16 (aligned to 16)
 	 * thread group Y = height;
+	 *
+	 * The groups tile the whole surface and are independent, so the
+	 * hardware runs as many of them concurrently as the max thread
+	 * count programmed in MEDIA_VFE_STATE allows.
 	 */
 	x_dim = (width + 15) / 16;
 	y_dim = height;
@@ -684,12 +783,36 @@ gen7_gpgpu_fillfunc(struct intel_batchbuffer *batch,
 	 *
 	 * For each thread, just use thread group ID for buffer offset.
 	 */
-	curbe_buffer = gen7_fill_curbe_buffer_data(batch, color);
-
-	interface_descriptor = gen7_fill_interface_descriptor(batch, dst,
-							      gen7_gpgpu_kernel,
-							      sizeof(gen7_gpgpu_kernel));
-	igt_assert(batch->ptr < &batch->buffer[4095]);
+	if (!gen7_state_cache.valid) {
+		curbe_buffer = gen7_fill_curbe_buffer_data(batch, color);
+		interface_descriptor =
+			gen7_fill_interface_descriptor(batch, dst,
+						       gen7_gpgpu_kernel,
+						       sizeof(gen7_gpgpu_kernel));
+		igt_assert(batch->ptr < &batch->buffer[4095]);
+
+		gen7_state_cache.size = batch_used(batch) - BATCH_STATE_SPLIT;
+		gen7_state_cache.curbe_offset = curbe_buffer;
+		gen7_state_cache.surface_offset = last_surface_offset;
+		gen7_state_cache.idd_offset = interface_descriptor;
+		memcpy(gen7_state_cache.state, &batch->buffer[BATCH_STATE_SPLIT],
+		       gen7_state_cache.size);
+		gen7_state_cache.valid = true;
+	} else {
+		/* Reuse the pre-validated state; only the color and the
+		 * destination surface differ from the build above.
+		 */
+		memcpy(&batch->buffer[BATCH_STATE_SPLIT], gen7_state_cache.state,
+		       gen7_state_cache.size);
+		batch->ptr += gen7_state_cache.size;
+
+		batch->buffer[gen7_state_cache.curbe_offset] = color;
+		gen7_patch_surface_state(batch, dst,
+					 gen7_state_cache.surface_offset);
+
+		curbe_buffer = gen7_state_cache.curbe_offset;
+		interface_descriptor = gen7_state_cache.idd_offset;
+	}
 
 	batch->ptr = batch->buffer;
 
@@ -732,12 +855,36 @@ gen8_gpgpu_fillfunc(struct intel_batchbuffer *batch,
 	 *
 	 * For each thread, just use thread group ID for buffer offset.
 	 */
-	curbe_buffer = gen7_fill_curbe_buffer_data(batch, color);
-
-	interface_descriptor = gen8_fill_interface_descriptor(batch, dst,
-							      gen8_gpgpu_kernel,
-							      sizeof(gen8_gpgpu_kernel));
-	igt_assert(batch->ptr < &batch->buffer[4095]);
+	if (!gen8_state_cache.valid) {
+		curbe_buffer = gen7_fill_curbe_buffer_data(batch, color);
+		interface_descriptor =
+			gen8_fill_interface_descriptor(batch, dst,
+						       gen8_gpgpu_kernel,
+						       sizeof(gen8_gpgpu_kernel));
+		igt_assert(batch->ptr < &batch->buffer[4095]);
+
+		gen8_state_cache.size = batch_used(batch) - BATCH_STATE_SPLIT;
+		gen8_state_cache.curbe_offset = curbe_buffer;
+		gen8_state_cache.surface_offset = last_surface_offset;
+		gen8_state_cache.idd_offset = interface_descriptor;
+		memcpy(gen8_state_cache.state, &batch->buffer[BATCH_STATE_SPLIT],
+		       gen8_state_cache.size);
+		gen8_state_cache.valid = true;
+	} else {
+		/* Reuse the pre-validated state; only the color and the
+		 * destination surface differ from the build above.
+		 */
+		memcpy(&batch->buffer[BATCH_STATE_SPLIT], gen8_state_cache.state,
+		       gen8_state_cache.size);
+		batch->ptr += gen8_state_cache.size;
+
+		batch->buffer[gen8_state_cache.curbe_offset] = color;
+		gen8_patch_surface_state(batch, dst,
+					 gen8_state_cache.surface_offset);
+
+		curbe_buffer = gen8_state_cache.curbe_offset;
+		interface_descriptor = gen8_state_cache.idd_offset;
+	}
 
 	batch->ptr = batch->buffer;
 
@@ -745,7 +892,7 @@ gen8_gpgpu_fillfunc(struct intel_batchbuffer *batch,
 	OUT_BATCH(GEN7_PIPELINE_SELECT | PIPELINE_SELECT_GPGPU);
 
 	gen8_emit_state_base_address(batch);
-	gen8_emit_vfe_state_gpgpu(batch);
+	gen8_emit_vfe_state_gpgpu(batch, GEN8_GPGPU_MAX_THREADS);
 	gen7_emit_curbe_load(batch, curbe_buffer);
 	gen8_emit_interface_descriptor_load(batch, interface_descriptor);
 	gen8_emit_gpgpu_walk(batch, x, y, width, height);
@@ -780,12 +927,36 @@ gen9_gpgpu_fillfunc(struct intel_batchbuffer *batch,
 	 *
 	 * For each thread, just use thread group ID for buffer offset.
 	 */
-	curbe_buffer = gen7_fill_curbe_buffer_data(batch, color);
-
-	interface_descriptor = gen8_fill_interface_descriptor(batch, dst,
-							      gen9_gpgpu_kernel,
-							      sizeof(gen9_gpgpu_kernel));
-	igt_assert(batch->ptr < &batch->buffer[4095]);
+	if (!gen9_state_cache.valid) {
+		curbe_buffer = gen7_fill_curbe_buffer_data(batch, color);
+		interface_descriptor =
+			gen8_fill_interface_descriptor(batch, dst,
+						       gen9_gpgpu_kernel,
+						       sizeof(gen9_gpgpu_kernel));
+		igt_assert(batch->ptr < &batch->buffer[4095]);
+
+		gen9_state_cache.size = batch_used(batch) - BATCH_STATE_SPLIT;
+		gen9_state_cache.curbe_offset = curbe_buffer;
+		gen9_state_cache.surface_offset = last_surface_offset;
+		gen9_state_cache.idd_offset = interface_descriptor;
+		memcpy(gen9_state_cache.state, &batch->buffer[BATCH_STATE_SPLIT],
+		       gen9_state_cache.size);
+		gen9_state_cache.valid = true;
+	} else {
+		/* Reuse the pre-validated state; only the color and the
+		 * destination surface differ from the build above.
+		 */
+		memcpy(&batch->buffer[BATCH_STATE_SPLIT], gen9_state_cache.state,
+		       gen9_state_cache.size);
+		batch->ptr += gen9_state_cache.size;
+
+		batch->buffer[gen9_state_cache.curbe_offset] = color;
+		gen8_patch_surface_state(batch, dst,
+					 gen9_state_cache.surface_offset);
+
+		curbe_buffer = gen9_state_cache.curbe_offset;
+		interface_descriptor = gen9_state_cache.idd_offset;
+	}
 
 	batch->ptr = batch->buffer;
 
@@ -793,7 +964,7 @@ gen9_gpgpu_fillfunc(struct intel_batchbuffer *batch,
 	OUT_BATCH(GEN7_PIPELINE_SELECT | PIPELINE_SELECT_GPGPU);
 
 	gen9_emit_state_base_address(batch);
-	gen8_emit_vfe_state_gpgpu(batch);
+	gen8_emit_vfe_state_gpgpu(batch, GEN9_GPGPU_MAX_THREADS);
 	gen7_emit_curbe_load(batch, curbe_buffer);
 	gen7_emit_interface_descriptor_load(batch, interface_descriptor);
 	gen8_emit_gpgpu_walk(batch, x, y, width, height);
@@ -276,13 +276,54 @@ bool __igt_sigiter_continue(struct __igt_sigiter *iter, bool enable)
 
 static struct igt_helper_process signal_helper;
 long long int sig_stat;
+
+#define SIGNAL_HELPER_DEFAULT_HZ 500
+
+/* shared between the signal helper process and the test */
+struct signal_helper_shared {
+	uint64_t sent;
+	uint64_t elapsed_ns;
+};
+
+static struct signal_helper_shared *signal_helper_shared;
+static unsigned int signal_helper_hz = SIGNAL_HELPER_DEFAULT_HZ;
+
 static void __attribute__((noreturn)) signal_helper_process(pid_t pid)
 {
-	/* Interrupt the parent process at 500Hz, just to be annoying */
+	uint64_t interval_ns = NSEC_PER_SEC / signal_helper_hz;
+	uint64_t sleep_ns = interval_ns;
+	struct timespec start = {};
+	uint64_t sent = 0;
+
+	igt_nsec_elapsed(&start);
+
+	/* Interrupt the parent process at the requested rate */
 	while (1) {
-		usleep(1000 * 1000 / 500);
+		uint64_t elapsed, target;
+
+		usleep(sleep_ns / 1000);
 		if (kill(pid, SIGCONT)) /* Parent has died, so must we. */
 			exit(0);
+
+		sent++;
+		elapsed = igt_nsec_elapsed(&start);
+		if (signal_helper_shared) {
+			signal_helper_shared->sent = sent;
+			signal_helper_shared->elapsed_ns = elapsed;
+		}
+
+		/*
+		 * usleep() overshoots by the scheduler latency, which on a
+		 * loaded machine swamps the nominal interval and makes the
+		 * achieved rate machine dependent. Close the loop against the
+		 * ideal schedule and trim the next sleep accordingly.
+		 */
+		target = sent * interval_ns;
+		if (elapsed > target)
+			sleep_ns = elapsed - target >= interval_ns ?
+				0 : interval_ns - (elapsed - target);
+		else
+			sleep_ns = interval_ns + (target - elapsed);
 	}
 }
 
@@ -310,10 +351,36 @@ static void sig_handler(int i)
  * overhead, look at the #igt_while_interruptible code block macro.
  */
 void igt_fork_signal_helper(void)
+{
+	igt_fork_signal_helper_at(SIGNAL_HELPER_DEFAULT_HZ);
+}
+
+/**
+ * igt_fork_signal_helper_at:
+ * @hz: requested interruption rate in signals per second
+ *
+ * Like igt_fork_signal_helper(), but with an explicit target rate. The
+ * helper process calibrates its pacing against the wall clock, so the
+ * achieved rate tracks @hz instead of drifting with the scheduler latency of
+ * the machine; igt_signal_helper_report() tells how well it did.
+ */
+void igt_fork_signal_helper_at(unsigned int hz)
 {
 	if (igt_only_list_subtests())
 		return;
 
+	igt_assert(hz);
+	signal_helper_hz = hz;
+
+	if (!signal_helper_shared) {
+		signal_helper_shared = mmap(NULL,
+					    sizeof(*signal_helper_shared),
+					    PROT_READ | PROT_WRITE,
+					    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		igt_assert(signal_helper_shared != MAP_FAILED);
+	}
+	memset(signal_helper_shared, 0, sizeof(*signal_helper_shared));
+
 	/* We pick SIGCONT as it is a "safe" signal - if we send SIGCONT to
 	 * an unexpecting process it spuriously wakes up and does nothing.
 	 * Most other signals (e.g. SIGUSR1) cause the process to die if they
@@ -334,6 +401,36 @@ void igt_fork_signal_helper(void)
 	}
 }
 
+/**
+ * igt_signal_helper_report:
+ * @sent: storage for the number of signals sent, or NULL
+ * @received: storage for the number of signals handled by this process, or
+ * NULL
+ *
+ * Reports what the signal helper achieved so far: the number of signals it
+ * sent, how many of them this process actually handled, and the achieved
+ * rate. Comparing the achieved rate against the requested one makes
+ * interruptible test results comparable across differently loaded rigs.
+ *
+ * Returns:
+ * The achieved interruption rate in signals per second, 0 when no helper is
+ * running.
+ */
+double igt_signal_helper_report(uint64_t *sent, uint64_t *received)
+{
+	struct signal_helper_shared *shared = signal_helper_shared;
+
+	if (sent)
+		*sent = shared ? shared->sent : 0;
+	if (received)
+		*received = sig_stat;
+
+	if (!shared || !shared->elapsed_ns)
+		return 0;
+
+	return shared->sent * (double)NSEC_PER_SEC / shared->elapsed_ns;
+}
+
 /**
  * igt_stop_signal_helper:
  *
@@ -395,12 +492,27 @@ void igt_stop_shrink_helper(void)
 #include <libudev.h>
 
 static struct igt_helper_process hang_detector;
+
+#define HANG_DETECTOR_MAX_EVENTS 64
+
+/* shared between the detector process and the test, see the mmap below */
+struct hang_detector_shared {
+	uint64_t wakeups;
+	uint64_t uevents;
+	uint64_t hangs;
+	uint64_t latency_ns[HANG_DETECTOR_MAX_EVENTS];
+};
+
+static struct hang_detector_shared *hang_detector_shared;
+
 static void __attribute__((noreturn))
 hang_detector_process(pid_t pid, dev_t rdev)
 {
 	struct udev_monitor *mon =
 		udev_monitor_new_from_netlink(udev_new(), "kernel");
+	struct hang_detector_shared *shared = hang_detector_shared;
 	struct pollfd pfd;
+	int timeout = 100;
 	int ret;
 
 	udev_monitor_filter_add_match_subsystem_devtype(mon, "drm", NULL);
@@ -409,10 +521,26 @@ hang_detector_process(pid_t pid, dev_t rdev)
 	pfd.fd = udev_monitor_get_fd(mon);
 	pfd.events = POLLIN;
 
-	while ((ret = poll(&pfd, 1, 2000)) >= 0) {
+	/*
+	 * Uevents wake the poll immediately whatever the timeout; the timeout
+	 * only paces the parent-liveness check. Back it off exponentially
+	 * while nothing happens so an idle detector costs a handful of
+	 * wakeups per minute instead of one every other second, and snap back
+	 * to quick polling on activity.
+	 */
+	while ((ret = poll(&pfd, 1, timeout)) >= 0) {
+		struct timespec wakeup = {};
 		struct udev_device *dev;
 		dev_t devnum;
 
+		igt_nsec_elapsed(&wakeup);
+		shared->wakeups++;
+
+		if (ret > 0)
+			timeout = 100;
+		else if (timeout < 8000)
+			timeout *= 2;
+
 		if (kill(pid, 0)) { /* Parent has died, so must we. */
 			igt_warn("Parent died without killing its children (%s)\n",
 				 __func__);
@@ -425,13 +553,20 @@ hang_detector_process(pid_t pid, dev_t rdev)
 		if (dev == NULL)
 			continue;
 
+		shared->uevents++;
+
 		devnum = udev_device_get_devnum(dev);
 		if (memcmp(&rdev, &devnum, sizeof(dev_t)) == 0) {
 			const char *str;
 
 			str = udev_device_get_property_value(dev, "ERROR");
-			if (str && atoi(str) == 1)
+			if (str && atoi(str) == 1) {
 				kill(pid, SIGIO);
+				shared->latency_ns[shared->hangs %
+						   HANG_DETECTOR_MAX_EVENTS] =
+					igt_nsec_elapsed(&wakeup);
+				shared->hangs++;
+			}
 		}
 
 		udev_device_unref(dev);
@@ -461,6 +596,15 @@ void igt_fork_hang_detector(int fd)
 	igt_assert(igt_sysfs_set_parameter
 		   (fd, "reset", "%d", 1 /* only global reset */));
 
+	if (!hang_detector_shared) {
+		hang_detector_shared = mmap(NULL,
+					    sizeof(*hang_detector_shared),
+					    PROT_READ | PROT_WRITE,
+					    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		igt_assert(hang_detector_shared != MAP_FAILED);
+	}
+	memset(hang_detector_shared, 0, sizeof(*hang_detector_shared));
+
 	signal(SIGIO, sig_abort);
 	igt_fork_helper(&hang_detector)
 		hang_detector_process(getppid(), st.st_rdev);
@@ -470,6 +614,42 @@ void igt_stop_hang_detector(void)
 {
 	igt_stop_helper(&hang_detector);
 }
+
+/**
+ * igt_hang_detector_report:
+ * @latency: stats object to push the per-detection latencies into, or NULL
+ *
+ * Reports what the hang detector spawned with igt_fork_hang_detector() has
+ * been up to: how often its poll loop woke up, and for each detected hang the
+ * time from the wakeup to the SIGIO being delivered. The latencies are pushed
+ * into @latency, which must have been set up with igt_stats_init() by the
+ * caller. Useful to quantify how much CPU time the detector itself steals
+ * from a measured workload.
+ *
+ * Returns:
+ * The number of poll wakeups of the detector so far, 0 when no detector was
+ * forked.
+ */
+uint64_t igt_hang_detector_report(igt_stats_t *latency)
+{
+	struct hang_detector_shared *shared = hang_detector_shared;
+	uint64_t n;
+
+	if (!shared)
+		return 0;
+
+	if (latency) {
+		uint64_t hangs = shared->hangs;
+
+		if (hangs > HANG_DETECTOR_MAX_EVENTS)
+			hangs = HANG_DETECTOR_MAX_EVENTS;
+
+		for (n = 0; n < hangs; n++)
+			igt_stats_push(latency, shared->latency_ns[n]);
+	}
+
+	return shared->wakeups;
+}
 #else
 void igt_fork_hang_detector(int fd)
 {
@@ -480,6 +660,11 @@ void igt_fork_hang_detector(int fd)
 void igt_stop_hang_detector(void)
 {
 }
+
+uint64_t igt_hang_detector_report(igt_stats_t *latency)
+{
+	return 0;
+}
 #endif
 
 /**
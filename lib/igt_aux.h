@@ -33,6 +33,8 @@
 #include <stddef.h>
 #include <sys/time.h>
 
+#include "igt_stats.h"
+
 extern drm_intel_bo **trash_bos;
 extern int num_trash_bos;
 
@@ -54,6 +56,8 @@ extern int num_trash_bos;
 /* auxialiary igt helpers from igt_aux.c */
 /* generally useful helpers */
 void igt_fork_signal_helper(void);
+void igt_fork_signal_helper_at(unsigned int hz);
+double igt_signal_helper_report(uint64_t *sent, uint64_t *received);
 void igt_stop_signal_helper(void);
 
 void igt_fork_shrink_helper(int fd);
@@ -61,6 +65,7 @@ void igt_stop_shrink_helper(void);
 
 void igt_fork_hang_detector(int fd);
 void igt_stop_hang_detector(void);
+uint64_t igt_hang_detector_report(igt_stats_t *latency);
 
 struct __igt_sigiter {
 	unsigned pass;
@@ -204,6 +209,8 @@ void igt_debug_manual_check(const char *var, const char *expected);
 /* These are separate to allow easier testing when porting, see the comment at
  * the bottom of intel_os.c. */
 void intel_purge_vm_caches(int fd);
+void intel_fork_memory_pressure(uint64_t working_set, uint64_t bandwidth);
+void intel_stop_memory_pressure(void);
 uint64_t intel_get_avail_ram_mb(void);
 uint64_t intel_get_total_ram_mb(void);
 uint64_t intel_get_total_swap_mb(void);
@@ -65,6 +65,14 @@ void igt_bo_unref(igt_bo_t *bo)
 	free(bo);
 }
 
+void igt_bo_unref_array(igt_bo_t **bos, unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+		igt_bo_unref(bos[i]);
+}
+
 void *igt_bo_map(igt_bo_t *bo, int prot, int flags)
 {
 	return bo->ops->map(bo, prot, flags);
@@ -138,3 +146,247 @@ igt_bo_t *igt_dumb_new_bo(igt_dev_t *dev, int width, int height,
 
 	return bo;
 }
+
+/*
+ * Slab pool: tests that churn through thousands of tiny buffers (e.g.
+ * gem_exec_lut_handle) spend most of their setup in object creation and
+ * destruction ioctls. The pool instead carves a few large dumb objects into
+ * power-of-two slots, so after the first slab is allocated a bo costs one
+ * malloc and a freelist pop, and destroying it is just pushing the slot
+ * back. The backing objects only go away in igt_bo_slab_pool_fini().
+ */
+
+#define SLAB_SIZE	(2 * 1024 * 1024)
+
+struct igt_bo_slab {
+	struct igt_bo_slab *next;
+	igt_bo_slab_pool_t *pool;
+	uint32_t handle;
+	uint64_t map_offset;
+	bool mappable;
+};
+
+struct igt_bo_slab_slot {
+	struct igt_bo_slab_slot *next;
+	struct igt_bo_slab *slab;
+	size_t offset;
+};
+
+static int slab_size_class(size_t size)
+{
+	int class = 0;
+
+	while (((size_t)1 << (IGT_BO_SLAB_MIN_SHIFT + class)) < size)
+		class++;
+
+	return class;
+}
+
+static void *slab_bo_map(igt_bo_t *bo, int prot, int flags)
+{
+	struct igt_bo_slab_slot *slot = bo->priv;
+	struct igt_bo_slab *slab = slot->slab;
+	void *ptr;
+
+	if (!slab->mappable) {
+		struct drm_mode_map_dumb arg = { .handle = slab->handle };
+
+		do_ioctl(bo->dev->fd, DRM_IOCTL_MODE_MAP_DUMB, &arg);
+		slab->map_offset = arg.offset;
+		slab->mappable = true;
+	}
+
+	/* Slot offsets are multiples of the (page-sized or bigger) class
+	 * size, so mapping just the slot's slice is always page aligned. */
+	ptr = mmap(NULL, bo->size, prot, flags, bo->dev->fd,
+		   slab->map_offset + bo->offset);
+	igt_assert(ptr != MAP_FAILED);
+
+	return ptr;
+}
+
+static int slab_bo_unmap(igt_bo_t *bo, void *ptr)
+{
+	munmap(ptr, bo->size);
+	return 0;
+}
+
+static void slab_bo_destroy(igt_bo_t *bo)
+{
+	struct igt_bo_slab_slot *slot = bo->priv;
+	igt_bo_slab_pool_t *pool = slot->slab->pool;
+	int class = slab_size_class(bo->size);
+
+	slot->next = pool->free_slots[class];
+	pool->free_slots[class] = slot;
+}
+
+static const igt_bo_ops_t slab_bo_ops = {
+	.map = slab_bo_map,
+	.unmap = slab_bo_unmap,
+	.destroy = slab_bo_destroy,
+};
+
+static bool slab_pool_grow(igt_bo_slab_pool_t *pool, int class)
+{
+	struct drm_mode_create_dumb create = { };
+	size_t slot_size = (size_t)1 << (IGT_BO_SLAB_MIN_SHIFT + class);
+	struct igt_bo_slab *slab;
+	size_t offset;
+
+	slab = calloc(sizeof(*slab), 1);
+	if (!slab)
+		return false;
+
+	create.width = 1024;
+	create.height = SLAB_SIZE / 4096;
+	create.bpp = 32;
+	do_ioctl(pool->dev->fd, DRM_IOCTL_MODE_CREATE_DUMB, &create);
+	igt_assert(create.handle);
+	igt_assert(create.size >= SLAB_SIZE);
+
+	slab->pool = pool;
+	slab->handle = create.handle;
+	slab->next = pool->slabs;
+	pool->slabs = slab;
+
+	for (offset = 0; offset + slot_size <= SLAB_SIZE;
+	     offset += slot_size) {
+		struct igt_bo_slab_slot *slot;
+
+		slot = malloc(sizeof(*slot));
+		if (!slot)
+			break;
+
+		slot->slab = slab;
+		slot->offset = offset;
+		slot->next = pool->free_slots[class];
+		pool->free_slots[class] = slot;
+	}
+
+	return pool->free_slots[class] != NULL;
+}
+
+void igt_bo_slab_pool_init(igt_bo_slab_pool_t *pool, igt_dev_t *dev)
+{
+	memset(pool, 0, sizeof(*pool));
+	pool->dev = dev;
+}
+
+/**
+ * igt_bo_slab_pool_fini:
+ * @pool: the slab pool
+ *
+ * Releases the backing objects and the free slot bookkeeping. All bos
+ * allocated from the pool must have been unreferenced beforehand.
+ */
+void igt_bo_slab_pool_fini(igt_bo_slab_pool_t *pool)
+{
+	int class;
+
+	for (class = 0; class < IGT_BO_SLAB_CLASSES; class++) {
+		struct igt_bo_slab_slot *slot, *next;
+
+		for (slot = pool->free_slots[class]; slot; slot = next) {
+			next = slot->next;
+			free(slot);
+		}
+		pool->free_slots[class] = NULL;
+	}
+
+	while (pool->slabs) {
+		struct igt_bo_slab *slab = pool->slabs;
+		struct drm_gem_close close = { .handle = slab->handle };
+
+		pool->slabs = slab->next;
+		do_ioctl(pool->dev->fd, DRM_IOCTL_GEM_CLOSE, &close);
+		free(slab);
+	}
+}
+
+/**
+ * igt_bo_slab_new:
+ * @pool: the slab pool
+ * @size: size of the new bo in bytes
+ *
+ * Allocates a bo from the pool. Sizes up to 256KiB are served from a slab
+ * slot, sharing the backing object's handle with bo->offset pointing at the
+ * slot; bigger sizes transparently fall back to a dedicated dumb object.
+ *
+ * Returns: the new bo, or NULL on memory exhaustion.
+ */
+igt_bo_t *igt_bo_slab_new(igt_bo_slab_pool_t *pool, size_t size)
+{
+	struct igt_bo_slab_slot *slot;
+	igt_bo_t *bo;
+	int class;
+
+	if (size > ((size_t)1 << IGT_BO_SLAB_MAX_SHIFT)) {
+		struct drm_mode_create_dumb create = { };
+
+		create.width = 4096;
+		create.height = (size + 16383) / 16384;
+		create.bpp = 32;
+		do_ioctl(pool->dev->fd, DRM_IOCTL_MODE_CREATE_DUMB, &create);
+		igt_assert(create.handle);
+		igt_assert(create.size >= size);
+
+		bo = igt_bo_create(pool->dev, &dumb_bo_ops, create.handle,
+				   create.size);
+		if (!bo) {
+			struct drm_mode_destroy_dumb destroy = {
+				.handle = create.handle,
+			};
+
+			do_ioctl(pool->dev->fd, DRM_IOCTL_MODE_DESTROY_DUMB,
+				 &destroy);
+		}
+
+		return bo;
+	}
+
+	class = slab_size_class(size);
+	if (!pool->free_slots[class] && !slab_pool_grow(pool, class))
+		return NULL;
+
+	slot = pool->free_slots[class];
+
+	bo = igt_bo_create(pool->dev, &slab_bo_ops, slot->slab->handle,
+			   (size_t)1 << (IGT_BO_SLAB_MIN_SHIFT + class));
+	if (!bo)
+		return NULL;
+
+	pool->free_slots[class] = slot->next;
+	bo->offset = slot->offset;
+	bo->priv = slot;
+
+	return bo;
+}
+
+/**
+ * igt_bo_slab_new_array:
+ * @pool: the slab pool
+ * @size: size of each bo in bytes
+ * @count: how many bos to allocate
+ * @bos: array to fill with the new bos
+ *
+ * Bulk-allocates @count bos of @size bytes each, unwinding on failure so
+ * @bos is either fully populated or untouched.
+ *
+ * Returns: 0 on success, -ENOMEM on memory exhaustion.
+ */
+int igt_bo_slab_new_array(igt_bo_slab_pool_t *pool, size_t size,
+			  unsigned int count, igt_bo_t **bos)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		bos[i] = igt_bo_slab_new(pool, size);
+		if (!bos[i]) {
+			igt_bo_unref_array(bos, i);
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
@@ -42,6 +42,9 @@ typedef struct igt_bo_ops {
 struct igt_bo {
 	igt_dev_t *dev;
 	size_t size;
+	/* Sub-allocated bos share the backing object's handle and address it
+	 * at this byte offset, 0 for bos owning their whole object. */
+	size_t offset;
 	unsigned handle;
 	int refcnt;
 	const igt_bo_ops_t *ops;
@@ -52,10 +55,31 @@ igt_bo_t *igt_bo_create(igt_dev_t *dev, const igt_bo_ops_t *ops,
 			uint32_t handle, size_t size);
 igt_bo_t *igt_bo_ref(igt_bo_t *bo);
 void igt_bo_unref(igt_bo_t *bo);
+void igt_bo_unref_array(igt_bo_t **bos, unsigned int count);
 void *igt_bo_map(igt_bo_t *bo, int prot, int flags);
 int igt_bo_unmap(igt_bo_t *bo, void *ptr);
 
 igt_bo_t *igt_dumb_new_bo(igt_dev_t *dev, int width, int height,
 			  uint32_t format, int plane, uint32_t *pitch);
 
+/* Power-of-two size classes from 4KiB to 256KiB; anything bigger gets its
+ * own object instead of a slab slot. */
+#define IGT_BO_SLAB_MIN_SHIFT	12
+#define IGT_BO_SLAB_MAX_SHIFT	18
+#define IGT_BO_SLAB_CLASSES	(IGT_BO_SLAB_MAX_SHIFT - \
+				 IGT_BO_SLAB_MIN_SHIFT + 1)
+
+typedef struct igt_bo_slab_pool {
+	igt_dev_t *dev;
+	/*< private >*/
+	struct igt_bo_slab *slabs;
+	struct igt_bo_slab_slot *free_slots[IGT_BO_SLAB_CLASSES];
+} igt_bo_slab_pool_t;
+
+void igt_bo_slab_pool_init(igt_bo_slab_pool_t *pool, igt_dev_t *dev);
+void igt_bo_slab_pool_fini(igt_bo_slab_pool_t *pool);
+igt_bo_t *igt_bo_slab_new(igt_bo_slab_pool_t *pool, size_t size);
+int igt_bo_slab_new_array(igt_bo_slab_pool_t *pool, size_t size,
+			  unsigned int count, igt_bo_t **bos);
+
 #endif /* __IGT_BO_H__ */
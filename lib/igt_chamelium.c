@@ -100,6 +100,7 @@ struct chamelium {
 	xmlrpc_env env;
 	xmlrpc_client *client;
 	char *url;
+	xmlrpc_server_info *server_info;
 
 	/* Indicates the last port to have been used for capturing video */
 	struct chamelium_port *capturing_port;
@@ -519,6 +520,110 @@ void chamelium_async_hpd_pulse_finish(struct chamelium *chamelium)
 	xmlrpc_client_event_loop_finish(chamelium->client);
 }
 
+struct chamelium_async_rpc {
+	struct chamelium *chamelium;
+	chamelium_rpc_completion_fn completion;
+	void *user_data;
+};
+
+static void async_pipeline_handler(const char *server_url,
+				   const char *method_name,
+				   xmlrpc_value *param_array, void *user_data,
+				   xmlrpc_env *fault, xmlrpc_value *result)
+{
+	struct chamelium_async_rpc *rpc = user_data;
+
+	igt_assert_f(!fault->fault_occurred,
+		     "Chamelium RPC call failed: %s\n",
+		     fault->fault_string);
+
+	if (rpc->completion)
+		rpc->completion(rpc->chamelium, result, rpc->user_data);
+
+	free(rpc);
+}
+
+/**
+ * chamelium_rpc_async:
+ * @chamelium: The Chamelium instance to use
+ * @completion: Callback run with the result when the RPC completes, may be
+ * NULL if the response doesn't matter
+ * @user_data: Passed through to @completion
+ * @method_name: The RPC method to call
+ * @format_str: XML-RPC format string for the arguments
+ * @...: The RPC arguments, as described by @format_str
+ *
+ * Starts an RPC without waiting for its response, so that several
+ * independent calls can be in flight on the connection at once instead of
+ * each paying a full round trip to the chamelium. The result is handed to
+ * @completion from within chamelium_rpc_flush(); the callback must not keep
+ * a reference to it beyond its own invocation without taking one.
+ *
+ * Every sequence of calls to this function must eventually be completed
+ * with chamelium_rpc_flush(). Calls queued this way must not depend on each
+ * other, as the responses may be processed in any order.
+ */
+void chamelium_rpc_async(struct chamelium *chamelium,
+			 chamelium_rpc_completion_fn completion,
+			 void *user_data, const char *method_name,
+			 const char *format_str, ...)
+{
+	struct chamelium_async_rpc *rpc;
+	xmlrpc_value *params;
+	const char *suffix;
+	va_list va_args;
+
+	/* Cleanup the last error, if any */
+	if (chamelium->env.fault_occurred) {
+		xmlrpc_env_clean(&chamelium->env);
+		xmlrpc_env_init(&chamelium->env);
+	}
+
+	if (!chamelium->server_info) {
+		chamelium->server_info =
+			xmlrpc_server_info_new(&chamelium->env,
+					       chamelium->url);
+		igt_assert(!chamelium->env.fault_occurred);
+	}
+
+	rpc = malloc(sizeof(*rpc));
+	igt_assert(rpc);
+	rpc->chamelium = chamelium;
+	rpc->completion = completion;
+	rpc->user_data = user_data;
+
+	va_start(va_args, format_str);
+	xmlrpc_build_value_va(&chamelium->env, format_str, va_args,
+			      &params, &suffix);
+	va_end(va_args);
+
+	igt_assert_f(!chamelium->env.fault_occurred,
+		     "Invalid RPC arguments for %s: %s\n",
+		     method_name, chamelium->env.fault_string);
+
+	xmlrpc_client_start_rpc(&chamelium->env, chamelium->client,
+				chamelium->server_info, method_name, params,
+				async_pipeline_handler, rpc);
+	xmlrpc_DECREF(params);
+
+	igt_assert_f(!chamelium->env.fault_occurred,
+		     "Failed to start RPC %s: %s\n",
+		     method_name, chamelium->env.fault_string);
+}
+
+/**
+ * chamelium_rpc_flush:
+ * @chamelium: The Chamelium instance to use
+ *
+ * Waits for every RPC started with chamelium_rpc_async() to complete,
+ * running the completion callbacks as the responses arrive. Returns
+ * immediately if nothing is in flight.
+ */
+void chamelium_rpc_flush(struct chamelium *chamelium)
+{
+	xmlrpc_client_event_loop_finish(chamelium->client);
+}
+
 /**
  * chamelium_new_edid:
  * @chamelium: The Chamelium instance to use
@@ -915,6 +1020,109 @@ igt_crc_t *chamelium_read_captured_crcs(struct chamelium *chamelium,
 	return ret;
 }
 
+/**
+ * chamelium_read_captured_crc_window:
+ * @chamelium: The Chamelium instance to use
+ * @first: The index of the first captured frame of the window
+ * @count: How many consecutive frame CRCs to read
+ *
+ * Reads the CRCs for a window of the current capture in a single RPC,
+ * rather than one round trip per frame. Combined with
+ * #chamelium_match_crc_sequence this lets long stability checks compare
+ * hundreds of frames against an expected sequence at the cost of one
+ * network round trip.
+ *
+ * Returns: An array of @count CRCs, to be freed by the caller
+ */
+igt_crc_t *chamelium_read_captured_crc_window(struct chamelium *chamelium,
+					      int first, int count)
+{
+	igt_crc_t *ret;
+	xmlrpc_value *res, *elem;
+	int i;
+
+	res = chamelium_rpc(chamelium, NULL, "GetCapturedChecksums", "(ii)",
+			    first, first + count);
+
+	igt_assert_eq(xmlrpc_array_size(&chamelium->env, res), count);
+	ret = calloc(sizeof(igt_crc_t), count);
+
+	for (i = 0; i < count; i++) {
+		xmlrpc_array_read_item(&chamelium->env, res, i, &elem);
+
+		crc_from_xml(chamelium, elem, &ret[i]);
+		ret[i].frame = first + i;
+
+		xmlrpc_DECREF(elem);
+	}
+
+	xmlrpc_DECREF(res);
+
+	return ret;
+}
+
+static bool chamelium_crc_equal(const igt_crc_t *a, const igt_crc_t *b)
+{
+	int i;
+
+	if (a->n_words != b->n_words)
+		return false;
+
+	for (i = 0; i < a->n_words; i++)
+		if (a->crc[i] != b->crc[i])
+			return false;
+
+	return true;
+}
+
+/**
+ * chamelium_match_crc_sequence:
+ * @captured: CRCs read back from the chamelium, e.g. with
+ * #chamelium_read_captured_crc_window
+ * @captured_count: Length of @captured
+ * @expected: The expected CRC sequence
+ * @expected_count: Length of @expected
+ * @max_slip: How many captured frames the start of the sequence may slip by
+ *
+ * Checks whether @expected occurs in @captured, tolerating the two kinds of
+ * frame slip video capture is prone to: the sequence starting up to
+ * @max_slip frames late (the capture raced the first flip), and individual
+ * frames being scanned out - and therefore captured - more than once when
+ * the source is slower than the sink.
+ *
+ * Returns: the offset into @captured at which the sequence begins, or -1 if
+ * it doesn't match within the allowed slip
+ */
+int chamelium_match_crc_sequence(const igt_crc_t *captured, int captured_count,
+				 const igt_crc_t *expected, int expected_count,
+				 int max_slip)
+{
+	int offset;
+
+	for (offset = 0; offset <= max_slip; offset++) {
+		int c = offset, e = 0;
+
+		while (e < expected_count && c < captured_count) {
+			if (chamelium_crc_equal(&captured[c], &expected[e])) {
+				c++;
+				e++;
+			} else if (e > 0 &&
+				   chamelium_crc_equal(&captured[c],
+						       &expected[e - 1])) {
+				/* Repeated scanout of the previous frame */
+				c++;
+			} else {
+				break;
+			}
+		}
+
+		if (e == expected_count)
+			return offset;
+	}
+
+	return -1;
+}
+
 /**
  * chamelium_port_read_captured_frame:
  *
@@ -960,6 +1168,254 @@ int chamelium_get_captured_frame_count(struct chamelium *chamelium)
 	return ret;
 }
 
+struct chamelium_frame_stream {
+	struct chamelium *chamelium;
+
+	/* The fetch thread gets a private client: xmlrpc clients must not
+	 * be used from two threads at once, and the test thread keeps using
+	 * the main one while we stream.
+	 */
+	xmlrpc_env env;
+	xmlrpc_client *client;
+	pthread_t thread;
+
+	int first;
+	int count;
+	int width;
+	int height;
+	struct chamelium_port *port;
+
+	pthread_mutex_t lock;
+	pthread_cond_t event;
+	/* Recycled dumps the fetch thread may fill next */
+	struct chamelium_frame_dump **spare;
+	int spare_count;
+	/* Fetched frames waiting for the consumer, oldest first */
+	struct chamelium_frame_dump **ready;
+	int ready_head;
+	int ready_count;
+	int depth;
+	bool eof;
+	bool stopped;
+};
+
+static xmlrpc_value *stream_rpc(struct chamelium_frame_stream *stream,
+				const char *method_name,
+				const char *format_str, ...)
+{
+	xmlrpc_value *res;
+	va_list va_args;
+
+	va_start(va_args, format_str);
+	xmlrpc_client_call2f_va(&stream->env, stream->client,
+				stream->chamelium->url, method_name,
+				format_str, &res, va_args);
+	va_end(va_args);
+
+	igt_assert_f(!stream->env.fault_occurred,
+		     "Chamelium RPC call failed: %s\n",
+		     stream->env.fault_string);
+
+	return res;
+}
+
+static void *stream_fetch_thread(void *data)
+{
+	struct chamelium_frame_stream *stream = data;
+	int index;
+
+	for (index = stream->first;
+	     index < stream->first + stream->count;
+	     index++) {
+		struct chamelium_frame_dump *dump;
+		xmlrpc_value *res;
+
+		pthread_mutex_lock(&stream->lock);
+		while (!stream->spare_count && !stream->stopped)
+			pthread_cond_wait(&stream->event, &stream->lock);
+		if (stream->stopped) {
+			pthread_mutex_unlock(&stream->lock);
+			break;
+		}
+		dump = stream->spare[--stream->spare_count];
+		pthread_mutex_unlock(&stream->lock);
+
+		res = stream_rpc(stream, "ReadCapturedFrame", "(i)", index);
+		free(dump->bgr);
+		xmlrpc_read_base64(&stream->env, res, &dump->size,
+				   (void*)&dump->bgr);
+		xmlrpc_DECREF(res);
+		dump->width = stream->width;
+		dump->height = stream->height;
+		dump->port = stream->port;
+
+		pthread_mutex_lock(&stream->lock);
+		stream->ready[(stream->ready_head + stream->ready_count++) %
+			      stream->depth] = dump;
+		pthread_cond_broadcast(&stream->event);
+		pthread_mutex_unlock(&stream->lock);
+	}
+
+	pthread_mutex_lock(&stream->lock);
+	stream->eof = true;
+	pthread_cond_broadcast(&stream->event);
+	pthread_mutex_unlock(&stream->lock);
+
+	return NULL;
+}
+
+/**
+ * chamelium_stream_captured_frames:
+ * @chamelium: The Chamelium instance to use
+ * @first: The index of the first captured frame to fetch
+ * @count: How many consecutive frames to fetch
+ * @depth: How many frames may be held on the host at once, or %0 for a
+ * sensible default
+ *
+ * Fetching captured frames one blocking #chamelium_read_captured_frame at
+ * a time serializes the network transfer with whatever the test does with
+ * each frame, and repeats the capture-resolution RPC for every single
+ * frame. For multi-frame comparisons this makes the transfer time the
+ * bottleneck.
+ *
+ * This starts a background thread which reads the requested frames ahead
+ * into a pool of at most @depth frame dumps, so the transfer of frame N+1
+ * overlaps the comparison of frame N and the resolution is only queried
+ * once. Frames are consumed in capture order with
+ * #chamelium_stream_get_frame and recycled into the pool with
+ * #chamelium_stream_put_frame; the pool bounds host memory use to @depth
+ * frames no matter how long the capture is.
+ *
+ * Returns: the new frame stream, to be released with #chamelium_stream_end
+ */
+struct chamelium_frame_stream *
+chamelium_stream_captured_frames(struct chamelium *chamelium,
+				 int first, int count, int depth)
+{
+	struct chamelium_frame_stream *stream = calloc(1, sizeof(*stream));
+	int i;
+
+	igt_assert(stream);
+	if (depth <= 0)
+		depth = 4;
+
+	stream->chamelium = chamelium;
+	stream->first = first;
+	stream->count = count;
+	stream->depth = depth;
+	stream->port = chamelium->capturing_port;
+	chamelium_get_captured_resolution(chamelium,
+					  &stream->width, &stream->height);
+
+	stream->spare = calloc(depth, sizeof(*stream->spare));
+	stream->ready = calloc(depth, sizeof(*stream->ready));
+	igt_assert(stream->spare && stream->ready);
+	for (i = 0; i < depth; i++) {
+		stream->spare[i] = calloc(1, sizeof(**stream->spare));
+		igt_assert(stream->spare[i]);
+	}
+	stream->spare_count = depth;
+
+	pthread_mutex_init(&stream->lock, NULL);
+	pthread_cond_init(&stream->event, NULL);
+
+	xmlrpc_env_init(&stream->env);
+	xmlrpc_client_create(&stream->env, XMLRPC_CLIENT_NO_FLAGS, PACKAGE,
+			     PACKAGE_VERSION, NULL, 0, &stream->client);
+	igt_assert(!stream->env.fault_occurred);
+
+	pthread_create(&stream->thread, NULL, stream_fetch_thread, stream);
+
+	return stream;
+}
+
+/**
+ * chamelium_stream_get_frame:
+ * @stream: The frame stream to read from
+ *
+ * Returns the next captured frame in order, blocking until the fetch
+ * thread has transferred it. Hand the dump back with
+ * #chamelium_stream_put_frame when done with it; do not use
+ * #chamelium_destroy_frame_dump on streamed frames.
+ *
+ * Returns: the next frame dump, or %NULL once every requested frame has
+ * been consumed
+ */
+struct chamelium_frame_dump *
+chamelium_stream_get_frame(struct chamelium_frame_stream *stream)
+{
+	struct chamelium_frame_dump *dump = NULL;
+
+	pthread_mutex_lock(&stream->lock);
+	while (!stream->ready_count && !stream->eof)
+		pthread_cond_wait(&stream->event, &stream->lock);
+	if (stream->ready_count) {
+		dump = stream->ready[stream->ready_head];
+		stream->ready_head = (stream->ready_head + 1) % stream->depth;
+		stream->ready_count--;
+	}
+	pthread_mutex_unlock(&stream->lock);
+
+	return dump;
+}
+
+/**
+ * chamelium_stream_put_frame:
+ * @stream: The frame stream the dump came from
+ * @dump: A dump returned by #chamelium_stream_get_frame
+ *
+ * Recycles a consumed frame dump into the pool so the fetch thread can
+ * reuse it for an upcoming frame.
+ */
+void chamelium_stream_put_frame(struct chamelium_frame_stream *stream,
+				struct chamelium_frame_dump *dump)
+{
+	pthread_mutex_lock(&stream->lock);
+	stream->spare[stream->spare_count++] = dump;
+	pthread_cond_broadcast(&stream->event);
+	pthread_mutex_unlock(&stream->lock);
+}
+
+/**
+ * chamelium_stream_end:
+ * @stream: The frame stream to tear down
+ *
+ * Stops the fetch thread and releases the stream and its frame pool. Any
+ * frames not yet consumed are discarded; dumps still held by the caller
+ * must be returned with #chamelium_stream_put_frame first.
+ */
+void chamelium_stream_end(struct chamelium_frame_stream *stream)
+{
+	int i;
+
+	pthread_mutex_lock(&stream->lock);
+	stream->stopped = true;
+	pthread_cond_broadcast(&stream->event);
+	pthread_mutex_unlock(&stream->lock);
+
+	pthread_join(stream->thread, NULL);
+
+	while (stream->ready_count) {
+		stream->spare[stream->spare_count++] =
+			stream->ready[stream->ready_head];
+		stream->ready_head = (stream->ready_head + 1) % stream->depth;
+		stream->ready_count--;
+	}
+	igt_assert_eq(stream->spare_count, stream->depth);
+	for (i = 0; i < stream->depth; i++) {
+		free(stream->spare[i]->bgr);
+		free(stream->spare[i]);
+	}
+	free(stream->spare);
+	free(stream->ready);
+
+	pthread_mutex_destroy(&stream->lock);
+	pthread_cond_destroy(&stream->event);
+	xmlrpc_client_destroy(stream->client);
+	xmlrpc_env_clean(&stream->env);
+	free(stream);
+}
+
 static pixman_image_t *convert_frame_format(pixman_image_t *src,
 					    int format)
 {
@@ -1326,6 +1782,8 @@ void chamelium_deinit(struct chamelium *chamelium)
 		free(pos);
 	}
 
+	if (chamelium->server_info)
+		xmlrpc_server_info_free(chamelium->server_info);
 	xmlrpc_client_destroy(chamelium->client);
 	xmlrpc_env_clean(&chamelium->env);
 
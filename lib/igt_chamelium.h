@@ -32,10 +32,16 @@
 
 #include "igt.h"
 #include <stdbool.h>
+#include <xmlrpc-c/base.h>
 
 struct chamelium;
 struct chamelium_port;
 struct chamelium_frame_dump;
+struct chamelium_frame_stream;
+
+typedef void (*chamelium_rpc_completion_fn)(struct chamelium *chamelium,
+					    xmlrpc_value *result,
+					    void *user_data);
 
 struct chamelium *chamelium_init(int drm_fd);
 void chamelium_deinit(struct chamelium *chamelium);
@@ -65,6 +71,11 @@ void chamelium_async_hpd_pulse_start(struct chamelium *chamelium,
 				     struct chamelium_port *port,
 				     bool high, int delay_secs);
 void chamelium_async_hpd_pulse_finish(struct chamelium *chamelium);
+void chamelium_rpc_async(struct chamelium *chamelium,
+			 chamelium_rpc_completion_fn completion,
+			 void *user_data, const char *method_name,
+			 const char *format_str, ...);
+void chamelium_rpc_flush(struct chamelium *chamelium);
 int chamelium_new_edid(struct chamelium *chamelium, const unsigned char *edid);
 void chamelium_port_set_edid(struct chamelium *chamelium,
 			     struct chamelium_port *port, int edid_id);
@@ -87,6 +98,11 @@ void chamelium_capture(struct chamelium *chamelium, struct chamelium_port *port,
 		       int x, int y, int w, int h, int frame_count);
 igt_crc_t *chamelium_read_captured_crcs(struct chamelium *chamelium,
 					int *frame_count);
+igt_crc_t *chamelium_read_captured_crc_window(struct chamelium *chamelium,
+					      int first, int count);
+int chamelium_match_crc_sequence(const igt_crc_t *captured, int captured_count,
+				 const igt_crc_t *expected, int expected_count,
+				 int max_slip);
 struct chamelium_frame_dump *chamelium_read_captured_frame(struct chamelium *chamelium,
 							   unsigned int index);
 struct chamelium_frame_dump *chamelium_port_dump_pixels(struct chamelium *chamelium,
@@ -94,6 +110,14 @@ struct chamelium_frame_dump *chamelium_port_dump_pixels(struct chamelium *chamel
 							int x, int y,
 							int w, int h);
 int chamelium_get_captured_frame_count(struct chamelium *chamelium);
+struct chamelium_frame_stream *
+chamelium_stream_captured_frames(struct chamelium *chamelium,
+				 int first, int count, int depth);
+struct chamelium_frame_dump *
+chamelium_stream_get_frame(struct chamelium_frame_stream *stream);
+void chamelium_stream_put_frame(struct chamelium_frame_stream *stream,
+				struct chamelium_frame_dump *dump);
+void chamelium_stream_end(struct chamelium_frame_stream *stream);
 int chamelium_get_frame_limit(struct chamelium *chamelium,
 			      struct chamelium_port *port,
 			      int w, int h);
@@ -47,7 +47,10 @@
 #include <sys/types.h>
 #ifdef __linux__
 #include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <sys/epoll.h>
 #endif
+#include <poll.h>
 #include <pthread.h>
 #include <sys/utsname.h>
 #include <termios.h>
@@ -62,6 +65,7 @@
 #include "intel_chipset.h"
 #include "intel_io.h"
 #include "igt_debugfs.h"
+#include "igt_matcher.h"
 #include "version.h"
 #include "config.h"
 
@@ -225,6 +229,13 @@
  * - 'basic*,advanced*' match any subtest starting basic or advanced
  * - '*,!basic*' match any subtest not starting basic
  * - 'basic*,!basic-render*' match any subtest starting basic but not starting basic-render
+ *
+ * When a test binary is run directly, independent subtests can be executed
+ * concurrently with "--parallel &lt;workers&gt;". Each subtest is forked into
+ * one of the worker slots and the results are collected by the parent process,
+ * cutting the wall time of binaries with hundreds of subtests. Subtests which
+ * rely on exclusive ownership of the GPU or display state should not be run
+ * this way.
  */
 
 static unsigned int exit_handler_count;
@@ -252,39 +263,468 @@ int num_test_children;
 int test_children_sz;
 bool test_child;
 
+/*
+ * Shared-memory log ring between an igt_fork() child and the parent.
+ *
+ * Children append formatted log lines to their own single-producer ring and
+ * the parent renders them in batch when the child is reaped, so log-heavy
+ * stress tests no longer serialize otherwise-parallel workers on the stdio
+ * locks. @head is only advanced by the child, @tail only by the parent. When
+ * a ring fills up before the parent drains it the child falls back to the
+ * direct (serializing) write path instead of dropping messages.
+ */
+#define CHILD_LOG_RING_BYTES (512 << 10)
+
+struct child_log_ring {
+	uint64_t head;
+	uint64_t tail;
+	char data[CHILD_LOG_RING_BYTES];
+};
+
+static struct child_log_ring **child_log_rings;
+static struct child_log_ring *my_log_ring;
+
+static void child_ring_write(struct child_log_ring *ring, uint64_t pos,
+			     const void *src, size_t len)
+{
+	size_t off = pos % CHILD_LOG_RING_BYTES;
+	size_t first = CHILD_LOG_RING_BYTES - off < len ?
+		CHILD_LOG_RING_BYTES - off : len;
+
+	memcpy(ring->data + off, src, first);
+	memcpy(ring->data, (const char *)src + first, len - first);
+}
+
+static void child_ring_read(struct child_log_ring *ring, uint64_t pos,
+			    void *dst, size_t len)
+{
+	size_t off = pos % CHILD_LOG_RING_BYTES;
+	size_t first = CHILD_LOG_RING_BYTES - off < len ?
+		CHILD_LOG_RING_BYTES - off : len;
+
+	memcpy(dst, ring->data + off, first);
+	memcpy((char *)dst + first, ring->data, len - first);
+}
+
+static bool child_ring_put(struct child_log_ring *ring,
+			   enum igt_log_level level, const char *str)
+{
+	uint32_t len = strlen(str);
+	uint8_t lvl = level;
+	uint64_t head = ring->head;
+	uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	uint64_t need = sizeof(len) + sizeof(lvl) + len;
+
+	if (CHILD_LOG_RING_BYTES - (head - tail) < need)
+		return false;
+
+	child_ring_write(ring, head, &len, sizeof(len));
+	child_ring_write(ring, head + sizeof(len), &lvl, sizeof(lvl));
+	child_ring_write(ring, head + sizeof(len) + sizeof(lvl), str, len);
+	__atomic_store_n(&ring->head, head + need, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+static void child_ring_flush(struct child_log_ring *ring)
+{
+	uint64_t tail = ring->tail;
+	uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+	while (tail != head) {
+		uint32_t len;
+		uint8_t lvl;
+		char *buf;
+		FILE *file;
+
+		child_ring_read(ring, tail, &len, sizeof(len));
+		child_ring_read(ring, tail + sizeof(len), &lvl, sizeof(lvl));
+
+		buf = malloc(len);
+		igt_assert(buf);
+		child_ring_read(ring, tail + sizeof(len) + sizeof(lvl),
+				buf, len);
+
+		if (lvl >= IGT_LOG_WARN) {
+			file = stderr;
+			fflush(stdout);
+		} else {
+			file = stdout;
+		}
+
+		fwrite(buf, sizeof(char), len, file);
+		free(buf);
+
+		tail += sizeof(len) + sizeof(lvl) + len;
+	}
+
+	__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+}
+
+static void child_ring_reap(int child)
+{
+	if (!child_log_rings || !child_log_rings[child])
+		return;
+
+	child_ring_flush(child_log_rings[child]);
+	munmap(child_log_rings[child], sizeof(struct child_log_ring));
+	child_log_rings[child] = NULL;
+}
+
 enum {
  OPT_LIST_SUBTESTS,
  OPT_RUN_SUBTEST,
  OPT_DESCRIPTION,
  OPT_DEBUG,
  OPT_INTERACTIVE_DEBUG,
+ OPT_PARALLEL,
  OPT_HELP = 'h'
 };
 
 static int igt_exitcode = IGT_EXIT_SUCCESS;
 static const char *command_str;
 
+/* parallel subtest scheduler state */
+static int parallel_workers = 0;
+static struct parallel_subtest {
+	pid_t pid;
+	char *name;
+} *parallel_subtests;
+static int num_parallel_subtests;
+static int parallel_subtests_sz;
+static bool in_parallel_child = false;
+
+static void reset_helper_process_list(void);
+static void oom_adjust_for_doom(void);
+static void common_env_prepare(void);
+
+/*
+ * Subtest index cache for --list-subtests.
+ *
+ * Enumerating subtests is needed by every external test runner and happens
+ * for all ~270 binaries on each run, so the result of the first enumeration
+ * is stored in a per-binary index file and replayed on subsequent calls
+ * without executing any of the test binary's setup paths. The index is keyed
+ * on the executable's mtime and size and hence survives until the binary is
+ * rebuilt. Set IGT_SUBTEST_INDEX=0 to disable the cache.
+ */
+static FILE *subtest_index_file;
+static char subtest_index_final[PATH_MAX];
+static char subtest_index_tmp[PATH_MAX];
+
+static bool subtest_index_stamp(char *stamp, size_t len)
+{
+	struct stat st;
+
+	if (stat("/proc/self/exe", &st))
+		return false;
+
+	snprintf(stamp, len, "%llu %llu",
+		 (unsigned long long)st.st_mtime,
+		 (unsigned long long)st.st_size);
+	return true;
+}
+
+static bool subtest_index_build_path(void)
+{
+	const char *env, *dir;
+	char buf[PATH_MAX];
+	int ret;
+
+	env = getenv("IGT_SUBTEST_INDEX");
+	if (env && atoi(env) == 0)
+		return false;
+
+	dir = getenv("XDG_CACHE_HOME");
+	if (dir && dir[0]) {
+		snprintf(buf, sizeof(buf), "%s/igt-subtest-index", dir);
+	} else {
+		dir = getenv("HOME");
+		if (!dir || !dir[0])
+			return false;
+		snprintf(buf, sizeof(buf), "%s/.cache/igt-subtest-index", dir);
+	}
+
+	if (mkdir(buf, 0755) && errno != EEXIST)
+		return false;
+
+	ret = snprintf(subtest_index_final, sizeof(subtest_index_final),
+		       "%s/%s", buf, command_str);
+	if (ret < 0 || ret >= sizeof(subtest_index_final))
+		return false;
+
+	ret = snprintf(subtest_index_tmp, sizeof(subtest_index_tmp),
+		       "%s.%d.tmp", subtest_index_final, getpid());
+
+	return ret >= 0 && ret < sizeof(subtest_index_tmp);
+}
+
+static bool subtest_index_replay(void)
+{
+	char stamp[64], line[512];
+	FILE *f;
+
+	if (!subtest_index_stamp(stamp, sizeof(stamp)))
+		return false;
+
+	f = fopen(subtest_index_final, "r");
+	if (!f)
+		return false;
+
+	if (!fgets(line, sizeof(line), f) ||
+	    strlen(line) < 1 ||
+	    line[strlen(line) - 1] != '\n') {
+		fclose(f);
+		return false;
+	}
+
+	line[strlen(line) - 1] = '\0';
+	if (strcmp(line, stamp)) {
+		/* binary was rebuilt, the index is stale */
+		fclose(f);
+		unlink(subtest_index_final);
+		return false;
+	}
+
+	while (fgets(line, sizeof(line), f))
+		fputs(line, stdout);
+
+	fclose(f);
+	return true;
+}
+
+static void subtest_index_record(void)
+{
+	char stamp[64];
+
+	if (!subtest_index_stamp(stamp, sizeof(stamp)))
+		return;
+
+	subtest_index_file = fopen(subtest_index_tmp, "w");
+	if (!subtest_index_file)
+		return;
+
+	fprintf(subtest_index_file, "%s\n", stamp);
+}
+
+static void subtest_index_commit(void)
+{
+	if (!subtest_index_file)
+		return;
+
+	if (fclose(subtest_index_file) == 0)
+		rename(subtest_index_tmp, subtest_index_final);
+	else
+		unlink(subtest_index_tmp);
+
+	subtest_index_file = NULL;
+}
+
+/*
+ * Crash-safe result journal.
+ *
+ * When IGT_JOURNAL points to a file, every subtest outcome is appended to a
+ * memory-mapped journal and synced to stable storage the moment it is known.
+ * If a test wedges the GPU hard enough to take the machine down, a
+ * post-reboot collector can recover all completed results from the journal
+ * instead of re-running hours of tests. The file is grown in fixed-size
+ * chunks so recording one result costs a memcpy plus an msync of one page.
+ */
+#define JOURNAL_CHUNK (64 << 10)
+
+static int journal_fd = -1;
+static char *journal_map;
+static size_t journal_size;
+static size_t journal_offset;
+
+static void journal_open(void)
+{
+	const char *path = getenv("IGT_JOURNAL");
+	off_t end;
+
+	if (!path || !path[0])
+		return;
+
+	journal_fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (journal_fd == -1) {
+		igt_warn("Could not open journal %s: %s\n",
+			 path, strerror(errno));
+		return;
+	}
+
+	/* append to whatever a previous (crashed) run left behind */
+	end = lseek(journal_fd, 0, SEEK_END);
+	journal_offset = end;
+	journal_size = (journal_offset / JOURNAL_CHUNK + 1) * JOURNAL_CHUNK;
+
+	if (ftruncate(journal_fd, journal_size))
+		goto err;
+
+	journal_map = mmap(NULL, journal_size, PROT_READ | PROT_WRITE,
+			   MAP_SHARED, journal_fd, 0);
+	if (journal_map == MAP_FAILED)
+		goto err;
+
+	return;
+
+err:
+	igt_warn("Could not map journal %s: %s\n", path, strerror(errno));
+	close(journal_fd);
+	journal_fd = -1;
+	journal_map = NULL;
+}
+
+static void journal_record(const char *name, const char *result)
+{
+	char rec[512];
+	size_t start, len;
+	int ret;
+
+	if (!journal_map)
+		return;
+
+	ret = snprintf(rec, sizeof(rec), "%s %s\n", name, result);
+	if (ret < 0)
+		return;
+	len = ret < sizeof(rec) ? ret : sizeof(rec) - 1;
+
+	if (journal_offset + len > journal_size) {
+		munmap(journal_map, journal_size);
+		journal_size += JOURNAL_CHUNK;
+		if (ftruncate(journal_fd, journal_size) ||
+		    (journal_map = mmap(NULL, journal_size,
+					PROT_READ | PROT_WRITE,
+					MAP_SHARED, journal_fd, 0)) ==
+		    MAP_FAILED) {
+			journal_map = NULL;
+			close(journal_fd);
+			journal_fd = -1;
+			return;
+		}
+	}
+
+	memcpy(journal_map + journal_offset, rec, len);
+
+	/* only sync the page(s) the record landed in */
+	start = journal_offset & ~(size_t)(sysconf(_SC_PAGESIZE) - 1);
+	msync(journal_map + start, journal_offset + len - start, MS_SYNC);
+
+	journal_offset += len;
+}
+
+static void journal_close(void)
+{
+	if (!journal_map)
+		return;
+
+	munmap(journal_map, journal_size);
+	journal_map = NULL;
+
+	/* drop the preallocated tail */
+	if (ftruncate(journal_fd, journal_offset))
+		igt_debug("Could not trim journal: %s\n", strerror(errno));
+	close(journal_fd);
+	journal_fd = -1;
+}
+
 static char* igt_log_domain_filter;
+
+/*
+ * In-memory log sink keeping the most recent messages for the failure dump.
+ *
+ * Messages are stored as compact binary records (level, domain, pid and the
+ * rendered text) in a fixed-size byte ring; the "(program:pid) domain-LEVEL:"
+ * header is only formatted when the ring is actually dumped after a failure.
+ * Successful runs therefore pay one vsnprintf per message and nothing else,
+ * which matters for stress tests emitting millions of suppressed debug lines.
+ */
+#define LOG_RING_BYTES (64 << 10)
+
+struct log_record {
+	uint16_t len;		/* length of the message text */
+	uint8_t level;
+	uint8_t continuation;	/* no header when rendered */
+	int32_t pid;
+	char domain[12];	/* possibly truncated, '\0' terminated */
+};
+
 static struct {
-	char *entries[256];
-	uint8_t start, end;
+	char data[LOG_RING_BYTES];
+	size_t start, end;	/* free-running byte offsets */
 } log_buffer;
 static pthread_mutex_t log_buffer_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+static const char *igt_log_level_str[] = {
+	"DEBUG",
+	"INFO",
+	"WARNING",
+	"CRITICAL",
+	"NONE"
+};
+
 const char *igt_test_name(void)
 {
 	return command_str;
 }
 
-static void _igt_log_buffer_append(char *line)
+static void log_ring_copy_in(size_t pos, const void *src, size_t len)
 {
+	size_t off = pos % LOG_RING_BYTES;
+	size_t first = LOG_RING_BYTES - off < len ? LOG_RING_BYTES - off : len;
+
+	memcpy(log_buffer.data + off, src, first);
+	memcpy(log_buffer.data, (const char *)src + first, len - first);
+}
+
+static void log_ring_copy_out(size_t pos, void *dst, size_t len)
+{
+	size_t off = pos % LOG_RING_BYTES;
+	size_t first = LOG_RING_BYTES - off < len ? LOG_RING_BYTES - off : len;
+
+	memcpy(dst, log_buffer.data + off, first);
+	memcpy((char *)dst + first, log_buffer.data, len - first);
+}
+
+static void _igt_log_buffer_append(enum igt_log_level level,
+				   const char *domain, bool continuation,
+				   const char *text)
+{
+	struct log_record rec = {
+		.level = level,
+		.continuation = continuation,
+		.pid = getpid(),
+	};
+	size_t len = strlen(text);
+	size_t need;
+
+	/* A record must fit in the ring on its own, or the drop-oldest
+	 * loop below would run off the end of an empty ring. Truncating
+	 * a once-in-a-blue-moon oversized message beats growing the ring
+	 * for it. */
+	if (len > LOG_RING_BYTES - sizeof(rec))
+		len = LOG_RING_BYTES - sizeof(rec);
+	rec.len = len;
+
+	if (domain) {
+		strncpy(rec.domain, domain, sizeof(rec.domain) - 1);
+		rec.domain[sizeof(rec.domain) - 1] = '\0';
+	}
+
+	need = sizeof(rec) + len;
+
 	pthread_mutex_lock(&log_buffer_mutex);
 
-	free(log_buffer.entries[log_buffer.end]);
-	log_buffer.entries[log_buffer.end] = line;
-	log_buffer.end++;
-	if (log_buffer.end == log_buffer.start)
-		log_buffer.start++;
+	/* drop the oldest records until the new one fits */
+	while (LOG_RING_BYTES - (log_buffer.end - log_buffer.start) < need) {
+		struct log_record old;
+
+		log_ring_copy_out(log_buffer.start, &old, sizeof(old));
+		log_buffer.start += sizeof(old) + old.len;
+	}
+
+	log_ring_copy_in(log_buffer.end, &rec, sizeof(rec));
+	log_ring_copy_in(log_buffer.end + sizeof(rec), text, len);
+	log_buffer.end += need;
 
 	pthread_mutex_unlock(&log_buffer_mutex);
 }
@@ -298,9 +738,34 @@ static void _igt_log_buffer_reset(void)
 	pthread_mutex_unlock(&log_buffer_mutex);
 }
 
+/* renders one record like the live output path, caller frees */
+static char *log_record_render(const struct log_record *rec, const char *text)
+{
+	const char *program_name;
+	char *line;
+	int ret;
+
+#ifdef __GLIBC__
+	program_name = program_invocation_short_name;
+#else
+	program_name = command_str;
+#endif
+
+	if (rec->continuation)
+		ret = asprintf(&line, "%.*s", rec->len, text);
+	else
+		ret = asprintf(&line, "(%s:%d) %s%s%s: %.*s", program_name,
+			       rec->pid, rec->domain,
+			       rec->domain[0] ? "-" : "",
+			       igt_log_level_str[rec->level],
+			       rec->len, text);
+
+	return ret == -1 ? NULL : line;
+}
+
 static void _igt_log_buffer_dump(void)
 {
-	uint8_t i;
+	size_t i;
 
 	if (in_subtest)
 		fprintf(stderr, "Subtest %s failed.\n", in_subtest);
@@ -316,11 +781,26 @@ static void _igt_log_buffer_dump(void)
 	fprintf(stderr, "**** DEBUG ****\n");
 
 	i = log_buffer.start;
-	do {
-		char *last_line = log_buffer.entries[i];
-		fprintf(stderr, "%s", last_line);
-		i++;
-	} while (i != log_buffer.start && i != log_buffer.end);
+	while (i != log_buffer.end) {
+		struct log_record rec;
+		char *text, *line;
+
+		log_ring_copy_out(i, &rec, sizeof(rec));
+
+		text = malloc(rec.len);
+		if (text) {
+			log_ring_copy_out(i + sizeof(rec), text, rec.len);
+
+			line = log_record_render(&rec, text);
+			if (line) {
+				fprintf(stderr, "%s", line);
+				free(line);
+			}
+			free(text);
+		}
+
+		i += sizeof(rec) + rec.len;
+	}
 
 	/* reset the buffer */
 	log_buffer.start = log_buffer.end = 0;
@@ -340,15 +820,34 @@ static void _igt_log_buffer_dump(void)
  */
 void igt_log_buffer_inspect(igt_buffer_log_handler_t check, void *data)
 {
-	uint8_t i;
+	size_t i;
 	pthread_mutex_lock(&log_buffer_mutex);
 
 	i = log_buffer.start;
-	do {
-		if (check(log_buffer.entries[i], data))
+	while (i != log_buffer.end) {
+		struct log_record rec;
+		char *text, *line;
+		bool done = false;
+
+		log_ring_copy_out(i, &rec, sizeof(rec));
+
+		text = malloc(rec.len);
+		if (text) {
+			log_ring_copy_out(i + sizeof(rec), text, rec.len);
+
+			line = log_record_render(&rec, text);
+			if (line) {
+				done = check(line, data);
+				free(line);
+			}
+			free(text);
+		}
+
+		if (done)
 			break;
-		i++;
-	} while (i != log_buffer.start && i != log_buffer.end);
+
+		i += sizeof(rec) + rec.len;
+	}
 
 	pthread_mutex_unlock(&log_buffer_mutex);
 }
@@ -447,6 +946,8 @@ bool __igt_fixture(void)
 	if (skip_subtests_henceforth)
 		return false;
 
+	common_env_prepare();
+
 	in_fixture = true;
 	return true;
 }
@@ -574,6 +1075,7 @@ static void print_usage(const char *help_str, bool output_on_stderr)
 		   "  --run-subtest <pattern>\n"
 		   "  --debug[=log-domain]\n"
 		   "  --interactive-debug[=domain]\n"
+		   "  --parallel <workers>\n"
 		   "  --help-description\n"
 		   "  --help\n");
 	if (help_str)
@@ -593,6 +1095,32 @@ static void oom_adjust_for_doom(void)
 
 }
 
+/*
+ * Preparing the test environment touches the console, /proc and sysfs and is
+ * by far the most expensive part of binary startup. It is constructed lazily
+ * on the first fixture or subtest that actually executes, so that no-op
+ * invocations (--list-subtests, --help, a --run-subtest pattern matching
+ * nothing) don't pay for it.
+ */
+static void common_env_prepare(void)
+{
+	static bool env_prepared;
+
+	if (env_prepared || list_subtests)
+		return;
+	env_prepared = true;
+
+	kick_fbcon(false);
+	kmsg(KERN_INFO "[IGT] %s: executing\n", command_str);
+	print_version();
+
+	oom_adjust_for_doom();
+	low_mem_killer_disable(true);
+
+	/* install exit handler, to ensure we clean up */
+	igt_install_exit_handler(common_exit_handler);
+}
+
 static int common_init(int *argc, char **argv,
 		       const char *extra_short_opts,
 		       const struct option *extra_long_opts,
@@ -607,6 +1135,7 @@ static int common_init(int *argc, char **argv,
 		{"help-description", 0, 0, OPT_DESCRIPTION},
 		{"debug", optional_argument, 0, OPT_DEBUG},
 		{"interactive-debug", optional_argument, 0, OPT_INTERACTIVE_DEBUG},
+		{"parallel", 1, 0, OPT_PARALLEL},
 		{"help", 0, 0, OPT_HELP},
 		{0, 0, 0, 0}
 	};
@@ -718,6 +1247,15 @@ static int common_init(int *argc, char **argv,
 			if (!list_subtests)
 				run_single_subtest = strdup(optarg);
 			break;
+		case OPT_PARALLEL:
+			parallel_workers = atoi(optarg);
+			if (parallel_workers < 1) {
+				igt_warn("Invalid number of parallel workers: %s\n",
+					 optarg);
+				ret = -2;
+				goto out;
+			}
+			break;
 		case OPT_DESCRIPTION:
 			print_test_description();
 			ret = -1;
@@ -757,16 +1295,17 @@ out:
 		exit(ret == -1 ? 0 : IGT_EXIT_INVALID);
 
 	if (!list_subtests) {
-		kick_fbcon(false);
-		kmsg(KERN_INFO "[IGT] %s: executing\n", command_str);
-		print_version();
+		journal_open();
 
-		oom_adjust_for_doom();
-		low_mem_killer_disable(true);
-	}
+		/* subtest binaries prepare lazily on first fixture/subtest */
+		if (!test_with_subtests)
+			common_env_prepare();
+	} else if (subtest_index_build_path()) {
+		if (subtest_index_replay())
+			exit(IGT_EXIT_SUCCESS);
 
-	/* install exit handler, to ensure we clean up */
-	igt_install_exit_handler(common_exit_handler);
+		subtest_index_record();
+	}
 
 	if (!test_with_subtests)
 		gettime(&subtest_time);
@@ -842,6 +1381,119 @@ void igt_simple_init_parse_opts(int *argc, char **argv,
 		    extra_opt_handler, handler_data);
 }
 
+static bool skipped_one = false;
+static bool succeeded_one = false;
+static bool failed_one = false;
+
+/*
+ * Collect the result of one finished parallel subtest worker. Results are
+ * folded into the same accounting igt_exit() uses for the serial path, so the
+ * overall exit code is identical no matter how the subtests were scheduled.
+ */
+static void parallel_reap_one(void)
+{
+	int status = -1;
+	pid_t pid;
+	int c;
+
+	/* Helper processes forked in enclosing fixtures (the hang detector
+	 * and friends) are our children too, and a blanket wait() would
+	 * steal their exit status from igt_wait_helper(). Only ever reap
+	 * the pids of our own workers.
+	 */
+	for (;;) {
+		for (c = 0; c < num_parallel_subtests; c++) {
+			pid = waitpid(parallel_subtests[c].pid, &status,
+				      WNOHANG);
+			igt_assert(pid != -1);
+			if (pid == parallel_subtests[c].pid)
+				goto reaped;
+		}
+		usleep(1000);
+	}
+reaped:
+
+	if (WIFEXITED(status) && WEXITSTATUS(status) == IGT_EXIT_SUCCESS) {
+		succeeded_one = true;
+		journal_record(parallel_subtests[c].name, "SUCCESS");
+	} else if (WIFEXITED(status) && WEXITSTATUS(status) == IGT_EXIT_SKIP) {
+		skipped_one = true;
+		journal_record(parallel_subtests[c].name, "SKIP");
+	} else {
+		/* The worker only prints a result line on a clean exit. */
+		if (WIFSIGNALED(status))
+			printf("%sSubtest %s: CRASH (signal %i)%s\n",
+			       (!__igt_plain_output) ? "\x1b[1m" : "",
+			       parallel_subtests[c].name, WTERMSIG(status),
+			       (!__igt_plain_output) ? "\x1b[0m" : "");
+
+		journal_record(parallel_subtests[c].name,
+			       WIFSIGNALED(status) ? "CRASH" : "FAIL");
+
+		if (!failed_one)
+			igt_exitcode = WIFEXITED(status) ?
+				WEXITSTATUS(status) : IGT_EXIT_FAILURE;
+		failed_one = true;
+	}
+
+	free(parallel_subtests[c].name);
+	parallel_subtests[c] = parallel_subtests[--num_parallel_subtests];
+}
+
+static void parallel_reap_all(void)
+{
+	while (num_parallel_subtests)
+		parallel_reap_one();
+}
+
+/*
+ * Fork off one subtest into a worker slot, blocking while all @parallel_workers
+ * slots are busy. Returns true in the child, which then runs the subtest block
+ * and reports its result through the exit code, and false in the parent.
+ */
+static bool parallel_fork_subtest(const char *subtest_name)
+{
+	pid_t pid;
+
+	if (num_parallel_subtests >= parallel_workers)
+		parallel_reap_one();
+
+	if (num_parallel_subtests >= parallel_subtests_sz) {
+		parallel_subtests_sz = parallel_subtests_sz ?
+			parallel_subtests_sz * 2 : 4;
+		parallel_subtests = realloc(parallel_subtests,
+					    sizeof(*parallel_subtests) *
+					    parallel_subtests_sz);
+		igt_assert(parallel_subtests);
+	}
+
+	/* ensure any buffers are flushed before fork */
+	fflush(NULL);
+
+	switch (pid = fork()) {
+	case -1:
+		igt_assert(0);
+	case 0:
+		in_parallel_child = true;
+		exit_handler_count = 0;
+		reset_helper_process_list();
+		oom_adjust_for_doom();
+
+		/* this worker only accounts for its own subtest */
+		skipped_one = succeeded_one = failed_one = false;
+		igt_exitcode = IGT_EXIT_SUCCESS;
+
+		return true;
+	default:
+		parallel_subtests[num_parallel_subtests].pid = pid;
+		parallel_subtests[num_parallel_subtests].name =
+			strdup(subtest_name);
+		num_parallel_subtests++;
+
+		return false;
+	}
+}
+
 /*
  * Note: Testcases which use these helpers MUST NOT output anything to stdout
  * outside of places protected by igt_run_subtest checks - the piglit
@@ -866,11 +1518,22 @@ bool __igt_run_subtest(const char *subtest_name)
 
 	if (list_subtests) {
 		printf("%s\n", subtest_name);
+		if (subtest_index_file)
+			fprintf(subtest_index_file, "%s\n", subtest_name);
 		return false;
 	}
 
 	if (run_single_subtest) {
-		if (uwildmat(subtest_name, run_single_subtest) == 0)
+		/* Compile the expression once instead of re-parsing it for
+		 * every subtest in the binary.
+		 */
+		static struct igt_matcher *matcher;
+
+		if (!matcher)
+			matcher = igt_matcher_compile(run_single_subtest);
+
+		if (matcher ? !igt_matcher_match(matcher, subtest_name)
+			    : uwildmat(subtest_name, run_single_subtest) == 0)
 			return false;
 		else
 			run_single_subtest_found = true;
@@ -884,6 +1547,11 @@ bool __igt_run_subtest(const char *subtest_name)
 		return false;
 	}
 
+	common_env_prepare();
+
+	if (parallel_workers > 1 && !parallel_fork_subtest(subtest_name))
+		return false;
+
 	kmsg(KERN_INFO "[IGT] %s: starting subtest %s\n", command_str, subtest_name);
 	igt_debug("Starting subtest: %s\n", subtest_name);
 
@@ -925,10 +1593,6 @@ void __igt_subtest_group_restore(int save)
 	skip_subtests_henceforth = save;
 }
 
-static bool skipped_one = false;
-static bool succeeded_one = false;
-static bool failed_one = false;
-
 static void exit_subtest(const char *) __attribute__((noreturn));
 static void exit_subtest(const char *result)
 {
@@ -941,7 +1605,26 @@ static void exit_subtest(const char *result)
 	       (!__igt_plain_output) ? "\x1b[0m" : "");
 	fflush(stdout);
 
+	/* parallel workers are journalled by the parent when reaped */
+	if (!in_parallel_child)
+		journal_record(in_subtest, result);
+
 	in_subtest = NULL;
+
+	/*
+	 * Parallel workers report their result through the exit code and are
+	 * reaped by the scheduler in the parent, they must not return to the
+	 * subtest enumeration loop.
+	 */
+	if (in_parallel_child) {
+		if (strcmp(result, "SUCCESS") == 0)
+			exit(IGT_EXIT_SUCCESS);
+		else if (strcmp(result, "SKIP") == 0)
+			exit(IGT_EXIT_SKIP);
+		else
+			exit(igt_exitcode);
+	}
+
 	siglongjmp(igt_subtest_jmpbuf, 1);
 }
 
@@ -1345,13 +2028,18 @@ void igt_exit(void)
 {
 	igt_exit_called = true;
 
+	if (!in_parallel_child)
+		parallel_reap_all();
+
 	if (run_single_subtest && !run_single_subtest_found) {
 		igt_warn("Unknown subtest: %s\n", run_single_subtest);
 		exit(IGT_EXIT_INVALID);
 	}
 
-	if (igt_only_list_subtests())
+	if (igt_only_list_subtests()) {
+		subtest_index_commit();
 		exit(IGT_EXIT_SUCCESS);
+	}
 
 	/* Calling this without calling one of the above is a failure */
 	assert(!test_with_subtests ||
@@ -1396,8 +2084,12 @@ void igt_exit(void)
 
 		printf("%s (%.3fs)\n",
 		       result, time_elapsed(&subtest_time, &now));
+
+		journal_record(command_str, result);
 	}
 
+	journal_close();
+
 	exit(igt_exitcode);
 }
 
@@ -1535,6 +2227,227 @@ void igt_stop_helper(struct igt_helper_process *proc)
 	assert(helper_was_alive(proc, status));
 }
 
+/* worker pool support code */
+struct igt_worker_task {
+	igt_worker_fn_t fn;
+	uint64_t arg;
+};
+
+static void __attribute__((noreturn)) worker_loop(int task_fd, int done_fd)
+{
+	struct igt_worker_task task;
+	ssize_t ret;
+
+	for (;;) {
+		ret = read(task_fd, &task, sizeof(task));
+		if (ret == 0)
+			exit(0);
+
+		igt_assert(ret == sizeof(task));
+
+		task.fn(task.arg);
+
+		igt_assert(write(done_fd, "", 1) == 1);
+	}
+}
+
+/**
+ * igt_worker_pool_init:
+ * @pool: worker pool to initialize
+ * @nr_workers: number of workers to fork, 0 for one per online cpu
+ *
+ * Forks a persistent pool of worker processes which pick up tasks submitted
+ * with igt_worker_pool_submit(). Unlike igt_fork(), which creates and reaps a
+ * fresh child for every parallel section, the workers survive across task
+ * batches, so tight loops dispatching thousands of small parallel jobs avoid
+ * the per-iteration fork+exit cost.
+ *
+ * Tasks are plain function pointers with a 64 bit argument; since the workers
+ * are forked from the submitting process the pointers stay valid in the
+ * children. Worker failures (igt_assert() and friends) are propagated like
+ * igt_fork() children when the pool is drained.
+ */
+void igt_worker_pool_init(struct igt_worker_pool *pool, int nr_workers)
+{
+	int task_pipe[2];
+	int done_pipe[2];
+	int i;
+
+	assert(!test_with_subtests || in_subtest);
+	assert(!test_child);
+
+	if (nr_workers <= 0)
+		nr_workers = sysconf(_SC_NPROCESSORS_ONLN);
+	igt_assert(nr_workers > 0);
+
+	/* keep task records atomic wrt. concurrent readers */
+	igt_assert(sizeof(struct igt_worker_task) <= PIPE_BUF);
+
+	igt_assert(pipe(task_pipe) == 0);
+	igt_assert(pipe(done_pipe) == 0);
+
+	pool->nr_workers = nr_workers;
+	pool->pending = 0;
+	pool->pids = calloc(nr_workers, sizeof(*pool->pids));
+	igt_assert(pool->pids);
+
+	/* ensure any buffers are flushed before fork */
+	fflush(NULL);
+
+	for (i = 0; i < nr_workers; i++) {
+		switch (pool->pids[i] = fork()) {
+		case -1:
+			igt_assert(0);
+		case 0:
+			close(task_pipe[1]);
+			close(done_pipe[0]);
+
+			test_child = true;
+			exit_handler_count = 0;
+			reset_helper_process_list();
+			oom_adjust_for_doom();
+
+			worker_loop(task_pipe[0], done_pipe[1]);
+		}
+	}
+
+	close(task_pipe[0]);
+	close(done_pipe[1]);
+	pool->task_fd = task_pipe[1];
+	pool->done_fd = done_pipe[0];
+}
+
+/**
+ * igt_worker_pool_submit:
+ * @pool: worker pool
+ * @fn: task function to run in a worker
+ * @arg: argument passed to @fn
+ *
+ * Queues one task on the pool. The task is picked up by the first idle
+ * worker; submission only blocks when the task queue is full.
+ */
+void igt_worker_pool_submit(struct igt_worker_pool *pool,
+			    igt_worker_fn_t fn, uint64_t arg)
+{
+	struct igt_worker_task task = { .fn = fn, .arg = arg };
+
+	igt_assert(write(pool->task_fd, &task, sizeof(task)) == sizeof(task));
+	pool->pending++;
+}
+
+static int worker_pool_reap(struct igt_worker_pool *pool)
+{
+	int err = 0;
+	int i;
+
+	for (i = 0; i < pool->nr_workers; i++) {
+		int status;
+
+		if (pool->pids[i] == -1)
+			continue;
+
+		status = __waitpid(pool->pids[i]);
+		pool->pids[i] = -1;
+
+		if (err)
+			continue;
+
+		if (WIFEXITED(status) && WEXITSTATUS(status))
+			err = WEXITSTATUS(status);
+		else if (WIFSIGNALED(status))
+			err = 128 + WTERMSIG(status);
+	}
+
+	return err;
+}
+
+/**
+ * igt_worker_pool_barrier:
+ * @pool: worker pool
+ *
+ * Blocks until every task submitted so far has been completed. If a worker
+ * died instead of completing its task the test fails with the worker's exit
+ * code, like igt_waitchildren().
+ */
+void igt_worker_pool_barrier(struct igt_worker_pool *pool)
+{
+	while (pool->pending) {
+		struct pollfd pfd = { .fd = pool->done_fd, .events = POLLIN };
+		char buf[64];
+		ssize_t ret;
+		int i;
+
+		/* A dead worker is invisible on the done pipe while its
+		 * siblings keep the write end open, so waiting for EOF
+		 * alone would deadlock on a single crash. Poll the pids
+		 * alongside and fail as soon as any worker exits.
+		 */
+		for (i = 0; i < pool->nr_workers; i++) {
+			int status, err;
+
+			if (pool->pids[i] == -1)
+				continue;
+			if (waitpid(pool->pids[i], &status, WNOHANG) !=
+			    pool->pids[i])
+				continue;
+
+			pool->pids[i] = -1;
+			err = WIFEXITED(status) ? WEXITSTATUS(status) :
+				128 + WTERMSIG(status);
+
+			/* EOF on the task pipe lets the survivors exit;
+			 * reap them so the test doesn't leave orphans. */
+			close(pool->task_fd);
+			worker_pool_reap(pool);
+			close(pool->done_fd);
+			igt_fail(err ?: IGT_EXIT_FAILURE);
+		}
+
+		if (poll(&pfd, 1, 100) <= 0)
+			continue;
+
+		ret = read(pool->done_fd, buf,
+			   pool->pending < sizeof(buf) ?
+			   pool->pending : sizeof(buf));
+		if (ret > 0) {
+			pool->pending -= ret;
+			continue;
+		}
+
+		/* EOF: all workers are gone, at least one died on a task */
+		close(pool->task_fd);
+		close(pool->done_fd);
+		igt_fail(worker_pool_reap(pool) ?: IGT_EXIT_FAILURE);
+	}
+}
+
+/**
+ * igt_worker_pool_fini:
+ * @pool: worker pool
+ *
+ * Drains outstanding tasks, terminates the workers and propagates their exit
+ * status. Must be called before leaving the subtest which initialized the
+ * pool.
+ */
+void igt_worker_pool_fini(struct igt_worker_pool *pool)
+{
+	int err;
+
+	igt_worker_pool_barrier(pool);
+
+	/* EOF on the task pipe makes the workers exit cleanly */
+	close(pool->task_fd);
+	err = worker_pool_reap(pool);
+	close(pool->done_fd);
+
+	free(pool->pids);
+	pool->pids = NULL;
+	pool->nr_workers = 0;
+
+	if (err)
+		igt_fail(err);
+}
+
 static void children_exit_handler(int sig)
 {
 	int status;
@@ -1560,6 +2473,23 @@ bool __igt_fork(void)
 		test_children = realloc(test_children,
 					sizeof(pid_t)*test_children_sz);
 		igt_assert(test_children);
+
+		child_log_rings = realloc(child_log_rings,
+					  sizeof(*child_log_rings) *
+					  test_children_sz);
+		igt_assert(child_log_rings);
+	}
+
+	child_log_rings[num_test_children] =
+		mmap(NULL, sizeof(struct child_log_ring),
+		     PROT_READ | PROT_WRITE,
+		     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (child_log_rings[num_test_children] == MAP_FAILED) {
+		/* no ring, the child just logs directly */
+		child_log_rings[num_test_children] = NULL;
+	} else {
+		child_log_rings[num_test_children]->head = 0;
+		child_log_rings[num_test_children]->tail = 0;
 	}
 
 	/* ensure any buffers are flushed before fork */
@@ -1570,6 +2500,7 @@ bool __igt_fork(void)
 		igt_assert(0);
 	case 0:
 		test_child = true;
+		my_log_ring = child_log_rings[num_test_children - 1];
 		exit_handler_count = 0;
 		reset_helper_process_list();
 		oom_adjust_for_doom();
@@ -1602,9 +2533,13 @@ void igt_child_done(pid_t pid)
 
 	igt_assert(found >= 0);
 
+	child_ring_reap(found);
+
 	num_test_children--;
-	for (i = found; i < num_test_children; i++)
+	for (i = found; i < num_test_children; i++) {
 		test_children[i] = test_children[i + 1];
+		child_log_rings[i] = child_log_rings[i + 1];
+	}
 }
 
 /**
@@ -1643,6 +2578,8 @@ void igt_waitchildren(void)
 		if (c == num_test_children)
 			continue;
 
+		child_ring_reap(c);
+
 		if (err == 0 && status != 0) {
 			if (WIFEXITED(status)) {
 				printf("child %i failed with exit status %i\n",
@@ -1970,16 +2907,11 @@ void igt_log(const char *domain, enum igt_log_level level, const char *format, .
 void igt_vlog(const char *domain, enum igt_log_level level, const char *format, va_list args)
 {
 	FILE *file;
-	char *line, *formatted_line;
+	char *line, *formatted_line = NULL;
+	const char *output;
 	const char *program_name;
-	const char *igt_log_level_str[] = {
-		"DEBUG",
-		"INFO",
-		"WARNING",
-		"CRITICAL",
-		"NONE"
-	};
 	static bool line_continuation = false;
+	bool continuation;
 
 	assert(format);
 
@@ -1995,20 +2927,14 @@ void igt_vlog(const char *domain, enum igt_log_level level, const char *format,
 	if (vasprintf(&line, format, args) == -1)
 		return;
 
-	if (line_continuation) {
-		formatted_line = strdup(line);
-		if (!formatted_line)
-			goto out;
-	} else if (asprintf(&formatted_line, "(%s:%d) %s%s%s: %s", program_name,
-		     getpid(), (domain) ? domain : "", (domain) ? "-" : "",
-		     igt_log_level_str[level], line) == -1) {
-		goto out;
-	}
-
+	continuation = line_continuation;
 	line_continuation = line[strlen(line) - 1] != '\n';
 
-	/* append log buffer */
-	_igt_log_buffer_append(formatted_line);
+	/*
+	 * Append a binary record to the log buffer; the header is only
+	 * rendered if the buffer gets dumped after a failure.
+	 */
+	_igt_log_buffer_append(level, domain, continuation, line);
 
 	/* check print log level */
 	if (igt_log_level > level)
@@ -2024,6 +2950,24 @@ void igt_vlog(const char *domain, enum igt_log_level level, const char *format,
 			goto out;
 	}
 
+	/* prepend all except information messages with process, domain and log
+	 * level information */
+	if (level != IGT_LOG_INFO && !continuation) {
+		if (asprintf(&formatted_line, "(%s:%d) %s%s%s: %s",
+			     program_name, getpid(),
+			     (domain) ? domain : "", (domain) ? "-" : "",
+			     igt_log_level_str[level], line) == -1)
+			goto out;
+		output = formatted_line;
+	} else {
+		output = line;
+	}
+
+	/* forked children batch their output through a shared-memory ring */
+	if (test_child && my_log_ring &&
+	    child_ring_put(my_log_ring, level, output))
+		goto out;
+
 	/* use stderr for warning messages and above */
 	if (level >= IGT_LOG_WARN) {
 		file = stderr;
@@ -2032,15 +2976,10 @@ void igt_vlog(const char *domain, enum igt_log_level level, const char *format,
 	else
 		file = stdout;
 
-	/* prepend all except information messages with process, domain and log
-	 * level information */
-	if (level != IGT_LOG_INFO)
-		fwrite(formatted_line, sizeof(char), strlen(formatted_line),
-		       file);
-	else
-		fwrite(line, sizeof(char), strlen(line), file);
+	fwrite(output, sizeof(char), strlen(output), file);
 
 out:
+	free(formatted_line);
 	free(line);
 }
 
@@ -2056,6 +2995,92 @@ static void __attribute__((noreturn)) igt_alarm_handler(int signal)
 	igt_fail(IGT_EXIT_FAILURE);
 }
 
+#ifdef __linux__
+/*
+ * timerfd-based watchdog, an alternative timeout engine selected with
+ * IGT_TIMEOUT_ENGINE=timerfd.
+ *
+ * Timing is enforced by a dedicated thread sleeping in epoll_wait() on a
+ * timerfd instead of by SIGALRM delivery to the main thread. That keeps the
+ * timeout machinery entirely off the test's hot path: no signal handler is
+ * installed, so ioctl-heavy benchmark loops see no syscall restarts from the
+ * timeout and the signal-helper children from igt_aux can't race with the
+ * alarm. Arming and disarming is a single timerfd_settime().
+ */
+static int watchdog_timer_fd = -1;
+static int watchdog_epoll_fd = -1;
+static pid_t watchdog_owner;
+
+static void *watchdog_loop(void *arg)
+{
+	struct epoll_event ev;
+	uint64_t expirations;
+
+	for (;;) {
+		if (epoll_wait(watchdog_epoll_fd, &ev, 1, -1) < 1)
+			continue;
+
+		if (read(watchdog_timer_fd, &expirations,
+			 sizeof(expirations)) != sizeof(expirations))
+			continue;
+
+		if (timeout_op)
+			igt_info("Timed out: %s\n", timeout_op);
+		else
+			igt_info("Timed out\n");
+
+		/* exit with failure status, running the exit handlers */
+		exit(IGT_EXIT_FAILURE);
+	}
+
+	return NULL;
+}
+
+static bool watchdog_set_timeout(unsigned int seconds)
+{
+	struct itimerspec its = {
+		.it_value.tv_sec = seconds,
+	};
+	const char *env;
+
+	env = getenv("IGT_TIMEOUT_ENGINE");
+	if (!env || strcmp(env, "timerfd"))
+		return false;
+
+	/* (re-)arm lazily, also after a fork killed our thread */
+	if (watchdog_timer_fd == -1 || watchdog_owner != getpid()) {
+		struct epoll_event ev = { .events = EPOLLIN };
+		pthread_t thread;
+
+		watchdog_timer_fd = timerfd_create(CLOCK_MONOTONIC,
+						   TFD_CLOEXEC);
+		if (watchdog_timer_fd == -1)
+			return false;
+
+		watchdog_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+		if (watchdog_epoll_fd == -1 ||
+		    epoll_ctl(watchdog_epoll_fd, EPOLL_CTL_ADD,
+			      watchdog_timer_fd, &ev) ||
+		    pthread_create(&thread, NULL, watchdog_loop, NULL)) {
+			close(watchdog_timer_fd);
+			if (watchdog_epoll_fd != -1)
+				close(watchdog_epoll_fd);
+			watchdog_timer_fd = watchdog_epoll_fd = -1;
+			return false;
+		}
+
+		watchdog_owner = getpid();
+	}
+
+	return timerfd_settime(watchdog_timer_fd, 0, &its, NULL) == 0;
+}
+#else
+static bool watchdog_set_timeout(unsigned int seconds)
+{
+	return false;
+}
+#endif
+
 /**
  * igt_set_timeout:
  * @seconds: number of seconds before timeout
@@ -2069,18 +3094,25 @@ static void __attribute__((noreturn)) igt_alarm_handler(int signal)
  * Any previous timer is cancelled and no timeout is scheduled if @seconds is
  * zero. But for clarity the timeout set with this function should be cleared
  * with igt_reset_timeout().
+ *
+ * With IGT_TIMEOUT_ENGINE=timerfd in the environment the timeout is enforced
+ * by a timerfd watchdog thread instead of SIGALRM, which keeps signal
+ * delivery and syscall restarts out of the test's hot path.
  */
 void igt_set_timeout(unsigned int seconds,
 		     const char *op)
 {
 	struct sigaction sa;
 
+	timeout_op = op;
+
+	if (watchdog_set_timeout(seconds))
+		return;
+
 	sa.sa_handler = igt_alarm_handler;
 	sigemptyset(&sa.sa_mask);
 	sa.sa_flags = 0;
 
-	timeout_op = op;
-
 	if (seconds == 0)
 		sigaction(SIGALRM, NULL, NULL);
 	else
@@ -733,6 +733,37 @@ bool __igt_fork_helper(struct igt_helper_process *proc);
 int igt_wait_helper(struct igt_helper_process *proc);
 void igt_stop_helper(struct igt_helper_process *proc);
 
+/**
+ * igt_worker_fn_t:
+ * @arg: per-task argument passed to igt_worker_pool_submit()
+ *
+ * Task function executed by a worker of an #igt_worker_pool.
+ */
+typedef void (*igt_worker_fn_t)(uint64_t arg);
+
+/**
+ * igt_worker_pool:
+ * @nr_workers: number of worker processes in the pool
+ *
+ * Tracking structure for a persistent pool of forked worker processes, see
+ * igt_worker_pool_init(). All other fields are internal.
+ */
+struct igt_worker_pool {
+	int nr_workers;
+
+	/*< private >*/
+	pid_t *pids;
+	int task_fd;
+	int done_fd;
+	unsigned long pending;
+};
+
+void igt_worker_pool_init(struct igt_worker_pool *pool, int nr_workers);
+void igt_worker_pool_submit(struct igt_worker_pool *pool,
+			    igt_worker_fn_t fn, uint64_t arg);
+void igt_worker_pool_barrier(struct igt_worker_pool *pool);
+void igt_worker_pool_fini(struct igt_worker_pool *pool);
+
 /* exit handler code */
 
 /**
@@ -32,6 +32,7 @@
 #include <limits.h>
 #include <string.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <unistd.h>
 #include <i915_drm.h>
 
@@ -138,6 +139,8 @@ const char *igt_debugfs_mount(void)
  */
 int igt_debugfs_dir(int device)
 {
+	static dev_t cached_rdev;
+	static char cached_path[200];
 	struct stat st;
 	const char *debugfs_root;
 	char path[200];
@@ -153,6 +156,14 @@ int igt_debugfs_dir(int device)
 		return -1;
 	}
 
+	/*
+	 * The mount discovery and the minor matching dance below only depend
+	 * on the device node, so remember the resolved directory and reopen
+	 * it directly when the same device comes around again.
+	 */
+	if (cached_path[0] && cached_rdev == st.st_rdev)
+		return open(cached_path, O_RDONLY);
+
 	debugfs_root = igt_debugfs_mount();
 
 	idx = minor(st.st_rdev);
@@ -191,6 +202,10 @@ int igt_debugfs_dir(int device)
 
 	snprintf(path, sizeof(path), "%s/dri/%d", debugfs_root, idx);
 	igt_debug("Opening debugfs directory '%s'\n", path);
+
+	cached_rdev = st.st_rdev;
+	strcpy(cached_path, path);
+
 	return open(path, O_RDONLY);
 }
 
@@ -220,27 +235,104 @@ int igt_debugfs_open(int device, const char *filename, int mode)
 	return ret;
 }
 
+/*
+ * Hot polling loops (wait-for-idle, drop-caches) re-read the same few debugfs
+ * files thousands of times, and an open/read/close triple per poll is mostly
+ * syscall overhead. Keep the last few read-only fds open and re-read them
+ * with pread() at offset zero, which makes the kernel regenerate the
+ * contents just like a fresh open would. pread() leaves the file offset
+ * alone, so the cached fds stay safe across igt_fork().
+ */
+#define DEBUGFS_FD_CACHE_SIZE 8
+
+struct debugfs_cached_file {
+	dev_t rdev;
+	char filename[128];
+	int mode;
+	int fd;
+};
+
+static struct debugfs_cached_file debugfs_fd_cache[DEBUGFS_FD_CACHE_SIZE];
+static int debugfs_fd_cache_next;
+
+static int debugfs_cached_open(int device, const char *filename, int mode)
+{
+	struct debugfs_cached_file *c;
+	struct stat st;
+	int i, fd;
+
+	if (fstat(device, &st) || !S_ISCHR(st.st_mode))
+		return -1;
+
+	for (i = 0; i < DEBUGFS_FD_CACHE_SIZE; i++) {
+		c = &debugfs_fd_cache[i];
+		if (c->fd > 0 && c->rdev == st.st_rdev && c->mode == mode &&
+		    strcmp(c->filename, filename) == 0)
+			return c->fd;
+	}
+
+	fd = igt_debugfs_open(device, filename, mode);
+	if (fd < 0 || strlen(filename) >= sizeof(c->filename))
+		return fd;
+
+	c = &debugfs_fd_cache[debugfs_fd_cache_next++ % DEBUGFS_FD_CACHE_SIZE];
+	if (c->fd > 0)
+		close(c->fd);
+
+	c->rdev = st.st_rdev;
+	strcpy(c->filename, filename);
+	c->mode = mode;
+	c->fd = fd;
+
+	return fd;
+}
+
 /**
- * __igt_debugfs_read:
+ * igt_debugfs_pread:
+ * @device: fd of the device
  * @filename: file name
  * @buf: buffer where the contents will be stored, allocated by the caller
  * @buf_size: size of the buffer
  *
- * This function opens the debugfs file, reads it, stores the content in the
- * provided buffer, then closes the file. Users should make sure that the buffer
- * provided is big enough to fit the whole file, plus one byte.
+ * Reads a debugfs file through the per-process fd cache: the first read of a
+ * file opens it and keeps the fd around, later reads of the same file cost a
+ * single pread() syscall. The content is always zero-terminated. Only useful
+ * for files which regenerate their content on every read, which is true for
+ * all debugfs interfaces this library polls.
+ *
+ * Returns: The number of bytes read, or -1 if the file could not be opened.
  */
-void __igt_debugfs_read(int fd, const char *filename, char *buf, int buf_size)
+int igt_debugfs_pread(int device, const char *filename, char *buf, int buf_size)
 {
-	int dir;
-	int len;
+	int fd, len;
 
-	dir = igt_debugfs_dir(fd);
-	len = igt_sysfs_read(dir, filename, buf, buf_size - 1);
+	fd = debugfs_cached_open(device, filename, O_RDONLY);
+	if (fd < 0)
+		return -1;
+
+	len = pread(fd, buf, buf_size - 1, 0);
 	if (len < 0)
 		len = 0;
 	buf[len] = '\0';
-	close(dir);
+
+	return len;
+}
+
+/**
+ * __igt_debugfs_read:
+ * @filename: file name
+ * @buf: buffer where the contents will be stored, allocated by the caller
+ * @buf_size: size of the buffer
+ *
+ * This function reads the debugfs file and stores the content in the provided
+ * buffer. The open fd is kept in a per-process cache, so polling the same
+ * file repeatedly costs one syscall per read. Users should make sure that the
+ * buffer provided is big enough to fit the whole file, plus one byte.
+ */
+void __igt_debugfs_read(int fd, const char *filename, char *buf, int buf_size)
+{
+	if (igt_debugfs_pread(fd, filename, buf, buf_size) < 0)
+		buf[0] = '\0';
 }
 
 /**
@@ -300,6 +392,60 @@ void igt_assert_crc_equal(const igt_crc_t *a, const igt_crc_t *b)
 		igt_assert_eq_u32(a->crc[i], b->crc[i]);
 }
 
+#define BITS_PER_LONG (sizeof(long) * 8)
+
+static bool crc_equal(const igt_crc_t *a, const igt_crc_t *b)
+{
+	return a->n_words == b->n_words &&
+		memcmp(a->crc, b->crc, a->n_words * sizeof(uint32_t)) == 0;
+}
+
+/**
+ * igt_crc_array_compare:
+ * @a: first array of pipe CRC values
+ * @b: second array of pipe CRC values
+ * @n_crcs: number of entries in both arrays
+ * @mismatch: bitmap of %IGT_CRC_BITMAP_LONGS() longs to fill with one bit per
+ * mismatching index, or NULL
+ * @early_exit: stop at the first mismatch
+ *
+ * Compares two arrays of CRC values entry by entry, using flat word compares
+ * instead of per-entry asserts so that post-processing thousands of collected
+ * frames against a reference set stays cheap. With @early_exit the comparison
+ * stops at the first mismatch, which is enough when the caller only needs a
+ * pass/fail answer.
+ *
+ * Like igt_assert_crc_equal() this can only tell matching and mismatching
+ * CRCs apart, the values themselves are opaque.
+ *
+ * Returns: The number of mismatching entries found, at most 1 with
+ * @early_exit.
+ */
+int igt_crc_array_compare(const igt_crc_t *a, const igt_crc_t *b, int n_crcs,
+			  unsigned long *mismatch, bool early_exit)
+{
+	int i, n_mismatches = 0;
+
+	if (mismatch)
+		memset(mismatch, 0,
+		       IGT_CRC_BITMAP_LONGS(n_crcs) * sizeof(unsigned long));
+
+	for (i = 0; i < n_crcs; i++) {
+		if (crc_equal(&a[i], &b[i]))
+			continue;
+
+		if (mismatch)
+			mismatch[i / BITS_PER_LONG] |=
+				1UL << (i % BITS_PER_LONG);
+
+		n_mismatches++;
+		if (early_exit)
+			break;
+	}
+
+	return n_mismatches;
+}
+
 /**
  * igt_crc_to_string:
  * @crc: pipe CRC value to print
@@ -927,6 +1073,335 @@ void igt_pipe_crc_collect_crc(igt_pipe_crc_t *pipe_crc, igt_crc_t *out_crc)
 	crc_sanity_checks(out_crc);
 }
 
+/*
+ * Streaming CRC capture
+ */
+
+#define CRC_RING_SIZE 1024
+#define CRC_BLOCK_SIZE 8192
+
+struct _igt_crc_stream {
+	igt_pipe_crc_t *pipe_crc;
+
+	/* block reader, holds at most one partial line between pumps */
+	char buf[CRC_BLOCK_SIZE];
+	size_t len;
+
+	/* single-producer/single-consumer ring, indices wrap modulo size */
+	uint32_t head;
+	uint32_t tail;
+	igt_crc_t ring[CRC_RING_SIZE];
+};
+
+/**
+ * igt_crc_stream_new:
+ * @pipe_crc: pipe CRC object to capture from
+ *
+ * This sets up a streaming reader on top of @pipe_crc. Instead of reading and
+ * parsing one line per syscall like igt_pipe_crc_get_crcs(), the stream reads
+ * large blocks from the CRC file, parses them in place and queues the results
+ * in a lock-free ring, keeping the per-frame overhead out of the measured
+ * loop. One thread may call igt_crc_stream_pump() while another concurrently
+ * drains CRCs with igt_crc_stream_get().
+ *
+ * The caller keeps ownership of @pipe_crc and must keep it alive (and
+ * started) for the lifetime of the stream.
+ *
+ * Returns: A new streaming CRC reader.
+ */
+igt_crc_stream_t *igt_crc_stream_new(igt_pipe_crc_t *pipe_crc)
+{
+	igt_crc_stream_t *stream;
+
+	stream = calloc(1, sizeof(*stream));
+	igt_assert(stream);
+	stream->pipe_crc = pipe_crc;
+
+	return stream;
+}
+
+/**
+ * igt_crc_stream_pump:
+ * @stream: streaming CRC reader
+ *
+ * Reads one block from the underlying CRC file and parses all complete lines
+ * into the ring. This is the producer side and must only be called from one
+ * thread at a time. With a blocking pipe CRC object this waits for at least
+ * one new CRC to arrive; with a nonblocking one it returns immediately when
+ * nothing is pending.
+ *
+ * Returns: The number of CRC entries added to the ring.
+ */
+int igt_crc_stream_pump(igt_crc_stream_t *stream)
+{
+	igt_pipe_crc_t *pipe_crc = stream->pipe_crc;
+	uint32_t tail = __atomic_load_n(&stream->tail, __ATOMIC_ACQUIRE);
+	uint32_t head = stream->head;
+	ssize_t bytes_read;
+	char *line, *end;
+	int n = 0;
+
+	bytes_read = read(pipe_crc->crc_fd, stream->buf + stream->len,
+			  sizeof(stream->buf) - stream->len - 1);
+	if (bytes_read < 0) {
+		igt_assert(errno == EAGAIN || errno == EINTR);
+		bytes_read = 0;
+	}
+	stream->len += bytes_read;
+	stream->buf[stream->len] = '\0';
+
+	/*
+	 * pipe_crc_init_from_string() stops at the '\n' for the generic ABI
+	 * and at the field count for the legacy one, so we can parse straight
+	 * out of the block buffer without carving out per-line copies.
+	 */
+	line = stream->buf;
+	while (head - tail < CRC_RING_SIZE &&
+	       (end = memchr(line, '\n',
+			     stream->len - (line - stream->buf)))) {
+		igt_crc_t *crc = &stream->ring[head % CRC_RING_SIZE];
+
+		if (pipe_crc_init_from_string(pipe_crc, crc, line)) {
+			head++;
+			n++;
+		}
+		line = end + 1;
+	}
+
+	/* keep a partial line, or lines stalled on a full ring, for later */
+	stream->len -= line - stream->buf;
+	memmove(stream->buf, line, stream->len);
+
+	__atomic_store_n(&stream->head, head, __ATOMIC_RELEASE);
+
+	return n;
+}
+
+/**
+ * igt_crc_stream_get:
+ * @stream: streaming CRC reader
+ * @out: buffer for the next CRC value
+ *
+ * Pops the oldest queued CRC from the ring. This is the consumer side and may
+ * run concurrently with igt_crc_stream_pump() from another thread; no locks
+ * are taken.
+ *
+ * Returns: True if a CRC was returned, false if the ring was empty.
+ */
+bool igt_crc_stream_get(igt_crc_stream_t *stream, igt_crc_t *out)
+{
+	uint32_t head = __atomic_load_n(&stream->head, __ATOMIC_ACQUIRE);
+	uint32_t tail = stream->tail;
+
+	if (tail == head)
+		return false;
+
+	*out = stream->ring[tail % CRC_RING_SIZE];
+	__atomic_store_n(&stream->tail, tail + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+/**
+ * igt_crc_stream_pending:
+ * @stream: streaming CRC reader
+ *
+ * Returns: The number of CRC entries currently queued in the ring.
+ */
+unsigned int igt_crc_stream_pending(igt_crc_stream_t *stream)
+{
+	return __atomic_load_n(&stream->head, __ATOMIC_ACQUIRE) -
+	       __atomic_load_n(&stream->tail, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * igt_crc_stream_free:
+ * @stream: streaming CRC reader
+ *
+ * Frees all resources associated with @stream. The underlying pipe CRC
+ * object is left untouched.
+ */
+void igt_crc_stream_free(igt_crc_stream_t *stream)
+{
+	free(stream);
+}
+
+/*
+ * Background CRC collection
+ */
+
+#define CRC_FRAME_TABLE_SIZE 2048
+
+struct _igt_crc_collector {
+	igt_pipe_crc_t *pipe_crc;
+	igt_crc_stream_t *stream;
+
+	pthread_t thread;
+	bool stop;
+
+	/* frame table, entries keyed by frame number modulo the table size */
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	uint32_t last_frame;
+	bool have_frame;
+	bool valid[CRC_FRAME_TABLE_SIZE];
+	igt_crc_t frames[CRC_FRAME_TABLE_SIZE];
+};
+
+static void *crc_collector_thread(void *arg)
+{
+	igt_crc_collector_t *collector = arg;
+	igt_crc_t crc;
+
+	while (!__atomic_load_n(&collector->stop, __ATOMIC_ACQUIRE)) {
+		if (!igt_crc_stream_pump(collector->stream)) {
+			usleep(500);
+			continue;
+		}
+
+		pthread_mutex_lock(&collector->lock);
+		while (igt_crc_stream_get(collector->stream, &crc)) {
+			unsigned int slot;
+
+			if (!crc.has_valid_frame)
+				continue;
+
+			slot = crc.frame % CRC_FRAME_TABLE_SIZE;
+			collector->frames[slot] = crc;
+			collector->valid[slot] = true;
+			collector->last_frame = crc.frame;
+			collector->have_frame = true;
+		}
+		pthread_cond_broadcast(&collector->cond);
+		pthread_mutex_unlock(&collector->lock);
+	}
+
+	return NULL;
+}
+
+/**
+ * igt_crc_collector_start:
+ * @pipe_crc: pipe CRC object to collect from
+ *
+ * This spawns a background thread which continuously drains @pipe_crc into a
+ * frame-number-indexed table, so the test can do its drawing work concurrently
+ * and look the results up afterwards with igt_crc_collector_get_frame()
+ * instead of blocking in igt_pipe_crc_collect_crc() once per frame.
+ *
+ * @pipe_crc must have been created with igt_pipe_crc_new_nonblock() and
+ * started with igt_pipe_crc_start() already; the caller keeps ownership and
+ * must stop the collector with igt_crc_collector_stop() before freeing it.
+ *
+ * Returns: A new CRC collector.
+ */
+igt_crc_collector_t *igt_crc_collector_start(igt_pipe_crc_t *pipe_crc)
+{
+	igt_crc_collector_t *collector;
+
+	/* a blocking read would stall the thread beyond the stop request */
+	igt_assert(pipe_crc->flags & O_NONBLOCK);
+
+	collector = calloc(1, sizeof(*collector));
+	igt_assert(collector);
+
+	collector->pipe_crc = pipe_crc;
+	collector->stream = igt_crc_stream_new(pipe_crc);
+	pthread_mutex_init(&collector->lock, NULL);
+	pthread_cond_init(&collector->cond, NULL);
+
+	igt_assert_eq(pthread_create(&collector->thread, NULL,
+				     crc_collector_thread, collector), 0);
+
+	return collector;
+}
+
+/**
+ * igt_crc_collector_get_frame:
+ * @collector: CRC collector
+ * @frame: frame number to look up
+ * @out: buffer for the CRC value
+ * @wait: block until the frame has been captured
+ *
+ * Looks up the CRC captured for @frame. With @wait the call blocks until the
+ * collector thread has seen @frame go by; without it the call returns
+ * immediately. The table keeps the last %CRC_FRAME_TABLE_SIZE frames, so
+ * lookups must not fall further behind the capture than that.
+ *
+ * Returns: True if the CRC for @frame was found, false if it was skipped by
+ * the hardware or already overwritten in the table.
+ */
+bool igt_crc_collector_get_frame(igt_crc_collector_t *collector,
+				 uint32_t frame, igt_crc_t *out, bool wait)
+{
+	unsigned int slot = frame % CRC_FRAME_TABLE_SIZE;
+	bool found = false;
+
+	pthread_mutex_lock(&collector->lock);
+	for (;;) {
+		if (collector->valid[slot] &&
+		    collector->frames[slot].frame == frame) {
+			*out = collector->frames[slot];
+			found = true;
+			break;
+		}
+
+		/* CRCs arrive in order: once a later frame has been seen the
+		 * one asked for is not going to show up any more. */
+		if (collector->have_frame &&
+		    (int32_t)(collector->last_frame - frame) >= 0)
+			break;
+
+		if (!wait)
+			break;
+
+		pthread_cond_wait(&collector->cond, &collector->lock);
+	}
+	pthread_mutex_unlock(&collector->lock);
+
+	return found;
+}
+
+/**
+ * igt_crc_collector_latest:
+ * @collector: CRC collector
+ * @frame: buffer for the frame number
+ *
+ * Reports the most recent frame number the collector thread has seen go by.
+ * This is the anchor for scheduling a deferred check: content drawn now is
+ * guaranteed to be part of the scanout a couple of frames later.
+ *
+ * Returns: True if a frame has been captured yet, false otherwise.
+ */
+bool igt_crc_collector_latest(igt_crc_collector_t *collector, uint32_t *frame)
+{
+	bool have_frame;
+
+	pthread_mutex_lock(&collector->lock);
+	have_frame = collector->have_frame;
+	*frame = collector->last_frame;
+	pthread_mutex_unlock(&collector->lock);
+
+	return have_frame;
+}
+
+/**
+ * igt_crc_collector_stop:
+ * @collector: CRC collector
+ *
+ * Stops the collector thread and frees all resources associated with
+ * @collector. The underlying pipe CRC object is left untouched.
+ */
+void igt_crc_collector_stop(igt_crc_collector_t *collector)
+{
+	__atomic_store_n(&collector->stop, true, __ATOMIC_RELEASE);
+	pthread_join(collector->thread, NULL);
+
+	igt_crc_stream_free(collector->stream);
+	pthread_cond_destroy(&collector->cond);
+	pthread_mutex_destroy(&collector->lock);
+	free(collector);
+}
+
 /*
  * Drop caches
  */
@@ -966,14 +1441,30 @@ void igt_drop_caches_set(int drm_fd, uint64_t val)
 
 	sprintf(data, "0x%" PRIx64, val);
 
-	fd = igt_debugfs_open(drm_fd, "i915_gem_drop_caches", O_WRONLY);
+	fd = debugfs_cached_open(drm_fd, "i915_gem_drop_caches", O_WRONLY);
 
 	igt_assert(fd >= 0);
 	do {
-		nbytes = write(fd, data, strlen(data) + 1);
+		nbytes = pwrite(fd, data, strlen(data) + 1, 0);
 	} while (nbytes == -1 && (errno == EINTR || errno == EAGAIN));
 	igt_assert(nbytes == strlen(data) + 1);
-	close(fd);
+}
+
+/**
+ * igt_quiesce_gpu:
+ * @drm_fd: open i915 drm file descriptor
+ *
+ * Brings the GPU to a quiescent state with a single syscall: one write to
+ * the cached drop-caches fd requesting %DROP_RETIRE, %DROP_ACTIVE and
+ * %DROP_FREED. The %DROP_ACTIVE write sleeps inside the kernel until all
+ * outstanding requests have completed, so unlike a gem_quiescent_gpu() /
+ * igt_drop_caches_set() pair there is no nop batch submission, no repeated
+ * debugfs open and no userspace polling. This makes it cheap enough to run
+ * in front of every measured iteration of a benchmark loop.
+ */
+void igt_quiesce_gpu(int drm_fd)
+{
+	igt_drop_caches_set(drm_fd, DROP_RETIRE | DROP_ACTIVE | DROP_FREED);
 }
 
 /*
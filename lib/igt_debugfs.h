@@ -36,6 +36,7 @@ const char *igt_debugfs_mount(void);
 int igt_debugfs_dir(int device);
 
 int igt_debugfs_open(int fd, const char *filename, int mode);
+int igt_debugfs_pread(int fd, const char *filename, char *buf, int buf_size);
 void __igt_debugfs_read(int fd, const char *filename, char *buf, int buf_size);
 bool igt_debugfs_search(int fd, const char *filename, const char *substring);
 
@@ -114,6 +115,19 @@ enum intel_pipe_crc_source {
 };
 
 void igt_assert_crc_equal(const igt_crc_t *a, const igt_crc_t *b);
+
+/**
+ * IGT_CRC_BITMAP_LONGS:
+ * @n_crcs: number of CRC entries to cover
+ *
+ * Number of unsigned longs needed for the mismatch bitmap of
+ * igt_crc_array_compare().
+ */
+#define IGT_CRC_BITMAP_LONGS(n_crcs) \
+	(((n_crcs) + 8 * sizeof(unsigned long) - 1) / (8 * sizeof(unsigned long)))
+
+int igt_crc_array_compare(const igt_crc_t *a, const igt_crc_t *b, int n_crcs,
+			  unsigned long *mismatch, bool early_exit);
 char *igt_crc_to_string(igt_crc_t *crc);
 
 void igt_require_pipe_crc(int fd);
@@ -129,6 +143,37 @@ int igt_pipe_crc_get_crcs(igt_pipe_crc_t *pipe_crc, int n_crcs,
 			  igt_crc_t **out_crcs);
 void igt_pipe_crc_collect_crc(igt_pipe_crc_t *pipe_crc, igt_crc_t *out_crc);
 
+/**
+ * igt_crc_stream_t:
+ *
+ * Streaming CRC reader on top of an #igt_pipe_crc_t, set up with
+ * igt_crc_stream_new(). Reads debugfs CRC data in large blocks, parses it in
+ * place and queues the results in a lock-free single-producer/single-consumer
+ * ring.
+ */
+typedef struct _igt_crc_stream igt_crc_stream_t;
+
+igt_crc_stream_t *igt_crc_stream_new(igt_pipe_crc_t *pipe_crc);
+int igt_crc_stream_pump(igt_crc_stream_t *stream);
+bool igt_crc_stream_get(igt_crc_stream_t *stream, igt_crc_t *out);
+unsigned int igt_crc_stream_pending(igt_crc_stream_t *stream);
+void igt_crc_stream_free(igt_crc_stream_t *stream);
+
+/**
+ * igt_crc_collector_t:
+ *
+ * Background CRC collector, set up with igt_crc_collector_start(). A thread
+ * continuously drains a nonblocking #igt_pipe_crc_t into a frame-indexed
+ * table for later lookup with igt_crc_collector_get_frame().
+ */
+typedef struct _igt_crc_collector igt_crc_collector_t;
+
+igt_crc_collector_t *igt_crc_collector_start(igt_pipe_crc_t *pipe_crc);
+bool igt_crc_collector_get_frame(igt_crc_collector_t *collector,
+				 uint32_t frame, igt_crc_t *out, bool wait);
+bool igt_crc_collector_latest(igt_crc_collector_t *collector, uint32_t *frame);
+void igt_crc_collector_stop(igt_crc_collector_t *collector);
+
 void igt_hpd_storm_set_threshold(int fd, unsigned int threshold);
 void igt_hpd_storm_reset(int fd);
 bool igt_hpd_storm_detected(int fd);
@@ -190,6 +235,7 @@ void igt_require_hpd_storm_ctl(int fd);
 
 bool igt_drop_caches_has(int fd, uint64_t val);
 void igt_drop_caches_set(int fd, uint64_t val);
+void igt_quiesce_gpu(int fd);
 
 /*
  * Prefault control
@@ -24,6 +24,12 @@
  *	Boris Brezillon <boris.brezillon@free-electrons.com>
  */
 
+#include <dirent.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
 #include <xf86drm.h>
 
 #include "drmtest.h"
@@ -44,3 +50,124 @@ igt_dev_t *igt_dev_from_fd(int fd)
 
 	return dev;
 }
+
+/*
+ * Resolving where a DRM fd sits in the device tree means a realpath()
+ * through /sys/dev/char plus a directory scan and a couple of readlinks.
+ * That's cheap once, but test setup paths do it over and over for the same
+ * device, so the snapshots are cached per chardev. The cache must be
+ * dropped when devices can have moved, see igt_dev_forget_topology().
+ */
+#define TOPOLOGY_CACHE_SIZE 8
+
+static igt_dev_topology_t topology_cache[TOPOLOGY_CACHE_SIZE];
+static unsigned int topology_count;
+
+static bool dev_read_topology(dev_t rdev, igt_dev_topology_t *t)
+{
+	char path[PATH_MAX], node[PATH_MAX];
+	struct dirent *ent;
+	char *name;
+	ssize_t len;
+	DIR *dir;
+	int idx;
+
+	memset(t, 0, sizeof(*t));
+	t->rdev = rdev;
+	t->card_idx = -1;
+	t->render_idx = -1;
+
+	snprintf(path, sizeof(path), "/sys/dev/char/%d:%d",
+		 major(rdev), minor(rdev));
+	if (!realpath(path, node))
+		return false;
+
+	/* node is .../<device>/drm/<card%d or renderD%d>; its parent lists
+	 * all the nodes the device exposes. */
+	name = strrchr(node, '/');
+	if (!name)
+		return false;
+	*name = '\0';
+
+	dir = opendir(node);
+	if (!dir)
+		return false;
+
+	while ((ent = readdir(dir))) {
+		if (sscanf(ent->d_name, "card%d", &idx) == 1)
+			t->card_idx = idx;
+		else if (sscanf(ent->d_name, "renderD%d", &idx) == 1)
+			t->render_idx = idx;
+	}
+	closedir(dir);
+
+	/* The drm class dir hangs off the physical device. */
+	name = strrchr(node, '/');
+	if (!name || strcmp(name, "/drm") != 0)
+		return false;
+	*name = '\0';
+
+	name = strrchr(node, '/');
+	if (!name)
+		return false;
+	strncpy(t->pci_slot, name + 1, sizeof(t->pci_slot) - 1);
+
+	strncat(node, "/driver", sizeof(node) - strlen(node) - 1);
+	len = readlink(node, path, sizeof(path) - 1);
+	if (len > 0) {
+		path[len] = '\0';
+		name = strrchr(path, '/');
+		strncpy(t->driver, name ? name + 1 : path,
+			sizeof(t->driver) - 1);
+	}
+
+	return true;
+}
+
+/**
+ * igt_dev_get_topology:
+ * @fd: fd of a DRM device node
+ * @topology: filled with the device's topology snapshot
+ *
+ * Reports which primary and render node indices belong to the device behind
+ * @fd, which PCI slot it occupies and which driver is bound to it. The
+ * sysfs crawl only happens the first time a device is seen; subsequent
+ * lookups are served from a process-wide cache.
+ *
+ * Returns: true on success, false if @fd is not a DRM chardev or sysfs
+ * doesn't know about it.
+ */
+bool igt_dev_get_topology(int fd, igt_dev_topology_t *topology)
+{
+	struct stat st;
+	unsigned int i;
+
+	if (fstat(fd, &st) || !S_ISCHR(st.st_mode))
+		return false;
+
+	for (i = 0; i < topology_count; i++) {
+		if (topology_cache[i].rdev == st.st_rdev) {
+			*topology = topology_cache[i];
+			return true;
+		}
+	}
+
+	if (!dev_read_topology(st.st_rdev, topology))
+		return false;
+
+	if (topology_count < TOPOLOGY_CACHE_SIZE)
+		topology_cache[topology_count++] = *topology;
+
+	return true;
+}
+
+/**
+ * igt_dev_forget_topology:
+ *
+ * Drops all cached topology snapshots. Call after anything that can move
+ * device nodes around, such as unloading or reloading a DRM driver.
+ */
+void igt_dev_forget_topology(void)
+{
+	topology_count = 0;
+}
@@ -27,12 +27,37 @@
 #ifndef __IGT_DEV_H__
 #define __IGT_DEV_H__
 
+#include <stdbool.h>
 #include <stdint.h>
+#include <sys/types.h>
 
 typedef struct igt_dev {
 	int fd;
 } igt_dev_t;
 
+/**
+ * igt_dev_topology:
+ * @card_idx: index of the primary node (/dev/dri/card%d), -1 if absent
+ * @render_idx: index of the render node (/dev/dri/renderD%d), -1 if absent
+ * @pci_slot: PCI slot name (e.g. "0000:00:02.0"), empty for non-PCI devices
+ * @driver: name of the kernel driver bound to the device
+ *
+ * Snapshot of where a DRM device sits in the device tree, see
+ * igt_dev_get_topology().
+ */
+typedef struct igt_dev_topology {
+	/*< private >*/
+	dev_t rdev;
+	/*< public >*/
+	int card_idx;
+	int render_idx;
+	char pci_slot[16];
+	char driver[32];
+} igt_dev_topology_t;
+
 igt_dev_t *igt_dev_from_fd(int fd);
 
+bool igt_dev_get_topology(int fd, igt_dev_topology_t *topology);
+void igt_dev_forget_topology(void);
+
 #endif /* __IGT_DEV_H__ */
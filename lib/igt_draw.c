@@ -22,6 +22,8 @@
  *
  */
 
+#include <inttypes.h>
+#include <stdio.h>
 #include <sys/mman.h>
 
 #include "igt_draw.h"
@@ -48,13 +50,6 @@
  * and tests/kms_draw_crc.c.
  */
 
-/* Some internal data structures to avoid having to pass tons of parameters
- * around everything. */
-struct cmd_data {
-	drm_intel_bufmgr *bufmgr;
-	drm_intel_context *context;
-};
-
 struct buf_data {
 	uint32_t handle;
 	uint32_t size;
@@ -91,6 +86,8 @@ const char *igt_draw_get_method_name(enum igt_draw_method method)
 		return "blt";
 	case IGT_DRAW_RENDER:
 		return "render";
+	case IGT_DRAW_AUTO:
+		return "auto";
 	default:
 		igt_assert(false);
 	}
@@ -407,25 +404,55 @@ static void draw_rect_pwrite(int fd, struct buf_data *buf,
 	}
 }
 
-static void draw_rect_blt(int fd, struct cmd_data *cmd_data,
+/*
+ * Wrapping a gem handle in a libdrm bo costs a flink round-trip and querying
+ * the tiling is another ioctl, so the drawing context caches both for the
+ * last target buffer, which is what the tests hammer in a loop.
+ */
+static drm_intel_bo *draw_ctx_get_bo(struct igt_draw_ctx *ctx,
+				     struct buf_data *buf)
+{
+	if (ctx->bo && ctx->handle == buf->handle)
+		return ctx->bo;
+
+	if (ctx->bo)
+		drm_intel_bo_unreference(ctx->bo);
+
+	ctx->bo = gem_handle_to_libdrm_bo(ctx->bufmgr, ctx->fd, "",
+					  buf->handle);
+	igt_assert(ctx->bo);
+	ctx->handle = buf->handle;
+
+	igt_require(gem_get_tiling(ctx->fd, buf->handle, &ctx->tiling,
+				   &ctx->swizzle));
+
+	return ctx->bo;
+}
+
+static struct intel_batchbuffer *draw_ctx_get_batch(struct igt_draw_ctx *ctx)
+{
+	if (!ctx->batch) {
+		ctx->batch = intel_batchbuffer_alloc(ctx->bufmgr,
+						intel_get_drm_devid(ctx->fd));
+		igt_assert(ctx->batch);
+	}
+
+	return ctx->batch;
+}
+
+static void draw_rect_blt(struct igt_draw_ctx *ctx,
 			  struct buf_data *buf, struct rect *rect,
 			  uint32_t color)
 {
 	drm_intel_bo *dst;
 	struct intel_batchbuffer *batch;
 	int blt_cmd_len, blt_cmd_tiling, blt_cmd_depth;
-	uint32_t devid = intel_get_drm_devid(fd);
-	int gen = intel_gen(devid);
-	uint32_t tiling, swizzle;
+	int gen;
 	int pitch;
 
-	igt_require(gem_get_tiling(fd, buf->handle, &tiling, &swizzle));
-
-	dst = gem_handle_to_libdrm_bo(cmd_data->bufmgr, fd, "", buf->handle);
-	igt_assert(dst);
-
-	batch = intel_batchbuffer_alloc(cmd_data->bufmgr, devid);
-	igt_assert(batch);
+	dst = draw_ctx_get_bo(ctx, buf);
+	batch = draw_ctx_get_batch(ctx);
+	gen = batch->gen;
 
 	switch (buf->bpp) {
 	case 8:
@@ -442,8 +469,8 @@ static void draw_rect_blt(int fd, struct cmd_data *cmd_data,
 	}
 
 	blt_cmd_len = (gen >= 8) ?  0x5 : 0x4;
-	blt_cmd_tiling = (tiling) ? XY_COLOR_BLT_TILED : 0;
-	pitch = (tiling) ? buf->stride / 4 : buf->stride;
+	blt_cmd_tiling = (ctx->tiling) ? XY_COLOR_BLT_TILED : 0;
+	pitch = (ctx->tiling) ? buf->stride / 4 : buf->stride;
 
 	BEGIN_BATCH(6, 1);
 	OUT_BATCH(XY_COLOR_BLT_CMD_NOLEN | XY_COLOR_BLT_WRITE_ALPHA |
@@ -455,20 +482,20 @@ static void draw_rect_blt(int fd, struct cmd_data *cmd_data,
 	OUT_BATCH(color);
 	ADVANCE_BATCH();
 
-	intel_batchbuffer_flush(batch);
-	intel_batchbuffer_free(batch);
+	/* Deliberately not flushed: consecutive blits coalesce into a single
+	 * batch submission, either when the batch fills up, when the drawing
+	 * method changes or on igt_draw_ctx_flush(). */
 }
 
-static void draw_rect_render(int fd, struct cmd_data *cmd_data,
+static void draw_rect_render(struct igt_draw_ctx *ctx,
 			     struct buf_data *buf, struct rect *rect,
 			     uint32_t color)
 {
 	drm_intel_bo *src, *dst;
-	uint32_t devid = intel_get_drm_devid(fd);
-	igt_render_copyfunc_t rendercopy = igt_get_render_copyfunc(devid);
+	igt_render_copyfunc_t rendercopy =
+		igt_get_render_copyfunc(intel_get_drm_devid(ctx->fd));
 	struct igt_buf src_buf, dst_buf;
 	struct intel_batchbuffer *batch;
-	uint32_t tiling, swizzle;
 	struct buf_data tmp;
 	int pixel_size = buf->bpp / 8;
 	unsigned adjusted_w, adjusted_dst_x;
@@ -483,20 +510,18 @@ static void draw_rect_render(int fd, struct cmd_data *cmd_data,
 		    rect->w % (32 / buf->bpp) != 0 ||
 		    rect->h % (32 / buf->bpp) != 0);
 
-	igt_require(gem_get_tiling(fd, buf->handle, &tiling, &swizzle));
+	dst = draw_ctx_get_bo(ctx, buf);
 
 	/* We create a temporary buffer and copy from it using rendercopy. */
 	tmp.size = rect->w * rect->h * pixel_size;
-	tmp.handle = gem_create(fd, tmp.size);
+	tmp.handle = gem_create(ctx->fd, tmp.size);
 	tmp.stride = rect->w * pixel_size;
 	tmp.bpp = buf->bpp;
-	draw_rect_mmap_cpu(fd, &tmp, &(struct rect){0, 0, rect->w, rect->h},
-			   color);
+	draw_rect_mmap_cpu(ctx->fd, &tmp,
+			   &(struct rect){0, 0, rect->w, rect->h}, color);
 
-	src = gem_handle_to_libdrm_bo(cmd_data->bufmgr, fd, "", tmp.handle);
+	src = gem_handle_to_libdrm_bo(ctx->bufmgr, ctx->fd, "", tmp.handle);
 	igt_assert(src);
-	dst = gem_handle_to_libdrm_bo(cmd_data->bufmgr, fd, "", buf->handle);
-	igt_assert(dst);
 
 	src_buf.bo = src;
 	src_buf.stride = tmp.stride;
@@ -504,11 +529,10 @@ static void draw_rect_render(int fd, struct cmd_data *cmd_data,
 	src_buf.size = tmp.size;
 	dst_buf.bo = dst;
 	dst_buf.stride = buf->stride;
-	dst_buf.tiling = tiling;
+	dst_buf.tiling = ctx->tiling;
 	dst_buf.size = buf->size;
 
-	batch = intel_batchbuffer_alloc(cmd_data->bufmgr, devid);
-	igt_assert(batch);
+	batch = draw_ctx_get_batch(ctx);
 
 	switch (buf->bpp) {
 	case 16:
@@ -520,11 +544,230 @@ static void draw_rect_render(int fd, struct cmd_data *cmd_data,
 		igt_assert(false);
 	}
 
-	rendercopy(batch, cmd_data->context, &src_buf, 0, 0, adjusted_w,
+	rendercopy(batch, ctx->context, &src_buf, 0, 0, adjusted_w,
 		   rect->h, &dst_buf, adjusted_dst_x, rect->y);
 
-	intel_batchbuffer_free(batch);
-	gem_close(fd, tmp.handle);
+	drm_intel_bo_unreference(src);
+	gem_close(ctx->fd, tmp.handle);
+}
+
+/*
+ * IGT_DRAW_AUTO support. Which method is fastest depends on the platform
+ * (LLC vs not, WC availability, aperture pressure), on the target's tiling
+ * and on how much data is written, so instead of maintaining per-platform
+ * tables we micro-benchmark every applicable method on a scratch buffer the
+ * first time a given (tiling, size class) combination is requested and
+ * remember the winner. Winners are also appended to a cache file keyed by
+ * PCI device id, so only the first run on a machine pays for the benchmark.
+ */
+#define AUTO_TILING_COUNT	3 /* none, X, Y */
+#define AUTO_CLASS_COUNT	3 /* <= 256KiB, <= 4MiB, bigger */
+
+#define AUTO_CACHE_FILE		"/var/tmp/igt-draw-methods"
+
+/* Stores method + 1 so that zero means "not measured yet". */
+static int auto_method[AUTO_TILING_COUNT][AUTO_CLASS_COUNT];
+static bool auto_cache_loaded;
+
+static int auto_tiling_index(uint32_t tiling)
+{
+	switch (tiling) {
+	case I915_TILING_NONE:
+		return 0;
+	case I915_TILING_X:
+		return 1;
+	case I915_TILING_Y:
+		return 2;
+	default:
+		igt_assert(false);
+	}
+}
+
+static int auto_size_class(uint32_t size)
+{
+	if (size <= 256 * 1024)
+		return 0;
+	if (size <= 4 * 1024 * 1024)
+		return 1;
+	return 2;
+}
+
+static void auto_cache_load(uint32_t devid)
+{
+	unsigned int id, tiling, class, method;
+	FILE *file;
+
+	if (auto_cache_loaded)
+		return;
+	auto_cache_loaded = true;
+
+	file = fopen(AUTO_CACHE_FILE, "r");
+	if (!file)
+		return;
+
+	while (fscanf(file, "%x %u %u %u", &id, &tiling, &class,
+		      &method) == 4) {
+		if (id != devid || tiling >= AUTO_TILING_COUNT ||
+		    class >= AUTO_CLASS_COUNT ||
+		    method >= IGT_DRAW_METHOD_COUNT)
+			continue;
+		auto_method[tiling][class] = method + 1;
+	}
+
+	fclose(file);
+}
+
+static void auto_cache_store(uint32_t devid, int tiling, int class,
+			     enum igt_draw_method method)
+{
+	FILE *file;
+
+	file = fopen(AUTO_CACHE_FILE, "a");
+	if (!file)
+		return;
+
+	fprintf(file, "%x %u %u %u\n", devid, tiling, class, method);
+	fclose(file);
+}
+
+static bool auto_swizzle_ok(uint32_t swizzle)
+{
+	switch (swizzle) {
+	case I915_BIT_6_SWIZZLE_NONE:
+	case I915_BIT_6_SWIZZLE_9:
+	case I915_BIT_6_SWIZZLE_9_10:
+	case I915_BIT_6_SWIZZLE_9_11:
+	case I915_BIT_6_SWIZZLE_9_10_11:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* Only consider methods that can draw on the given tiling without skipping:
+ * the CPU detiling paths only know X tiling on gen5+ with a swizzle they can
+ * compute, while GTT (through the fence) and the GPU rings handle anything. */
+static bool auto_method_ok(struct igt_draw_ctx *ctx,
+			   enum igt_draw_method method,
+			   uint32_t tiling, uint32_t swizzle)
+{
+	int gen = intel_gen(intel_get_drm_devid(ctx->fd));
+	bool cpu_tiling_ok = tiling == I915_TILING_NONE ||
+			     (tiling == I915_TILING_X && gen >= 5 &&
+			      auto_swizzle_ok(swizzle));
+
+	switch (method) {
+	case IGT_DRAW_MMAP_CPU:
+	case IGT_DRAW_PWRITE:
+		return cpu_tiling_ok;
+	case IGT_DRAW_MMAP_WC:
+		return cpu_tiling_ok && gem_mmap__has_wc(ctx->fd);
+	case IGT_DRAW_MMAP_GTT:
+		return true;
+	case IGT_DRAW_BLT:
+		return ctx->bufmgr != NULL;
+	case IGT_DRAW_RENDER:
+		return ctx->bufmgr != NULL &&
+		       igt_get_render_copyfunc(intel_get_drm_devid(ctx->fd));
+	default:
+		return false;
+	}
+}
+
+static enum igt_draw_method auto_benchmark(struct igt_draw_ctx *ctx,
+					   uint32_t tiling, int class)
+{
+	static const uint32_t heights[AUTO_CLASS_COUNT] = { 32, 512, 4096 };
+	enum igt_draw_method method, best = IGT_DRAW_MMAP_GTT;
+	uint64_t best_time = -1;
+	uint32_t swizzle = I915_BIT_6_SWIZZLE_NONE;
+	struct buf_data scratch;
+
+	scratch.stride = 2048;
+	scratch.size = scratch.stride * heights[class];
+	scratch.bpp = 32;
+	scratch.handle = gem_create(ctx->fd, scratch.size);
+	if (tiling != I915_TILING_NONE) {
+		uint32_t real_tiling;
+
+		gem_set_tiling(ctx->fd, scratch.handle, tiling,
+			       scratch.stride);
+		igt_require(gem_get_tiling(ctx->fd, scratch.handle,
+					   &real_tiling, &swizzle));
+	}
+
+	for (method = 0; method < IGT_DRAW_METHOD_COUNT; method++) {
+		uint64_t elapsed = -1;
+		int rep;
+
+		if (!auto_method_ok(ctx, method, tiling, swizzle))
+			continue;
+
+		/* One warm-up draw to populate mappings and caches, then the
+		 * best of three so scheduler noise doesn't pick a loser. The
+		 * gem_sync() makes sure the GPU methods are timed to
+		 * completion and not just to submission. */
+		for (rep = 0; rep < 4; rep++) {
+			struct timespec start = {};
+			uint64_t nsec;
+
+			igt_nsec_elapsed(&start);
+			igt_draw_ctx_rect(ctx, scratch.handle, scratch.size,
+					  scratch.stride, method, 0, 0,
+					  scratch.stride / 4, heights[class],
+					  0xFF00FF00, scratch.bpp);
+			igt_draw_ctx_flush(ctx);
+			gem_sync(ctx->fd, scratch.handle);
+			nsec = igt_nsec_elapsed(&start);
+
+			if (rep > 0 && nsec < elapsed)
+				elapsed = nsec;
+		}
+
+		igt_debug("auto draw: %s took %"PRIu64"ns\n",
+			  igt_draw_get_method_name(method), elapsed);
+
+		if (elapsed < best_time) {
+			best_time = elapsed;
+			best = method;
+		}
+	}
+
+	/* Drop the cached wrapping of the scratch bo before closing the
+	 * handle: gem handles are recycled, so a later target could otherwise
+	 * alias the stale cache entry. */
+	if (ctx->bo) {
+		drm_intel_bo_unreference(ctx->bo);
+		ctx->bo = NULL;
+		ctx->handle = 0;
+	}
+	gem_close(ctx->fd, scratch.handle);
+
+	igt_debug("auto draw: picked %s for tiling %d size class %d\n",
+		  igt_draw_get_method_name(best), auto_tiling_index(tiling),
+		  class);
+
+	return best;
+}
+
+static enum igt_draw_method auto_select_method(struct igt_draw_ctx *ctx,
+					       struct buf_data *buf)
+{
+	uint32_t devid = intel_get_drm_devid(ctx->fd);
+	uint32_t tiling, swizzle;
+	int t, class;
+
+	igt_require(gem_get_tiling(ctx->fd, buf->handle, &tiling, &swizzle));
+	t = auto_tiling_index(tiling);
+	class = auto_size_class(buf->size);
+
+	auto_cache_load(devid);
+	if (!auto_method[t][class]) {
+		auto_method[t][class] = auto_benchmark(ctx, tiling, class) + 1;
+		auto_cache_store(devid, t, class, auto_method[t][class] - 1);
+	}
+
+	return auto_method[t][class] - 1;
 }
 
 /**
@@ -552,10 +795,103 @@ void igt_draw_rect(int fd, drm_intel_bufmgr *bufmgr, drm_intel_context *context,
 		   enum igt_draw_method method, int rect_x, int rect_y,
 		   int rect_w, int rect_h, uint32_t color, int bpp)
 {
-	struct cmd_data cmd_data = {
-		.bufmgr = bufmgr,
-		.context = context,
-	};
+	struct igt_draw_ctx ctx;
+
+	igt_draw_ctx_init(&ctx, fd, bufmgr, context);
+	igt_draw_ctx_rect(&ctx, buf_handle, buf_size, buf_stride, method,
+			  rect_x, rect_y, rect_w, rect_h, color, bpp);
+	igt_draw_ctx_fini(&ctx);
+}
+
+/**
+ * igt_draw_ctx_init:
+ * @ctx: the drawing context
+ * @fd: the DRM file descriptor
+ * @bufmgr: the libdrm bufmgr, only required for IGT_DRAW_BLT and
+ *          IGT_DRAW_RENDER
+ * @context: the context, can be NULL if you don't want to think about it
+ *
+ * Initializes a drawing context. Compared to plain igt_draw_rect() calls, a
+ * drawing context keeps the batchbuffer, the libdrm bo of the last target
+ * buffer and its tiling information alive across igt_draw_ctx_rect() calls,
+ * and coalesces consecutive IGT_DRAW_BLT rectangles into a single batch
+ * submission. @bufmgr and @context stay owned by the caller and must outlive
+ * the drawing context.
+ */
+void igt_draw_ctx_init(struct igt_draw_ctx *ctx, int fd,
+		       drm_intel_bufmgr *bufmgr, drm_intel_context *context)
+{
+	memset(ctx, 0, sizeof(*ctx));
+
+	ctx->fd = fd;
+	ctx->bufmgr = bufmgr;
+	ctx->context = context;
+}
+
+/**
+ * igt_draw_ctx_flush:
+ * @ctx: the drawing context
+ *
+ * Submits any blt rectangles still queued in the drawing context's batch.
+ * Call this before the target buffer contents are consumed, e.g. before
+ * computing a CRC or reading the buffer with the CPU.
+ */
+void igt_draw_ctx_flush(struct igt_draw_ctx *ctx)
+{
+	if (ctx->batch && ctx->batch->ptr != ctx->batch->buffer)
+		intel_batchbuffer_flush(ctx->batch);
+}
+
+/**
+ * igt_draw_ctx_fini:
+ * @ctx: the drawing context
+ *
+ * Flushes and releases all resources held by the drawing context. The bufmgr
+ * and context passed to igt_draw_ctx_init() are left untouched.
+ */
+void igt_draw_ctx_fini(struct igt_draw_ctx *ctx)
+{
+	igt_draw_ctx_flush(ctx);
+
+	if (ctx->batch)
+		intel_batchbuffer_free(ctx->batch);
+	if (ctx->bo)
+		drm_intel_bo_unreference(ctx->bo);
+
+	ctx->batch = NULL;
+	ctx->bo = NULL;
+	ctx->handle = 0;
+}
+
+/**
+ * igt_draw_ctx_rect:
+ * @ctx: the drawing context
+ * @buf_handle: the handle of the buffer where you're going to draw to
+ * @buf_size: the size of the buffer
+ * @buf_stride: the stride of the buffer
+ * @method: method you're going to use to write to the buffer
+ * @rect_x: horizontal position on the buffer where your rectangle starts
+ * @rect_y: vertical position on the buffer where your rectangle starts
+ * @rect_w: width of the rectangle
+ * @rect_h: height of the rectangle
+ * @color: color of the rectangle
+ * @bpp: bits per pixel
+ *
+ * Draws a colored rectangle like igt_draw_rect(), but reusing the state kept
+ * in the drawing context. Consecutive IGT_DRAW_BLT calls are queued in one
+ * batch and only submitted when the batch fills up, the method changes or
+ * igt_draw_ctx_flush() is called.
+ *
+ * Passing IGT_DRAW_AUTO as @method measures every method applicable to the
+ * target's tiling and size class on first use and then keeps dispatching to
+ * the fastest one. The winners are cached per device in /var/tmp, so the
+ * measurement overhead is only paid once per machine.
+ */
+void igt_draw_ctx_rect(struct igt_draw_ctx *ctx, uint32_t buf_handle,
+		       uint32_t buf_size, uint32_t buf_stride,
+		       enum igt_draw_method method, int rect_x, int rect_y,
+		       int rect_w, int rect_h, uint32_t color, int bpp)
+{
 	struct buf_data buf = {
 		.handle = buf_handle,
 		.size = buf_size,
@@ -569,24 +905,32 @@ void igt_draw_rect(int fd, drm_intel_bufmgr *bufmgr, drm_intel_context *context,
 		.h = rect_h,
 	};
 
+	if (method == IGT_DRAW_AUTO)
+		method = auto_select_method(ctx, &buf);
+
+	/* Only consecutive blits can share a batch, everything else has to
+	 * observe the results of what was queued before it. */
+	if (method != IGT_DRAW_BLT)
+		igt_draw_ctx_flush(ctx);
+
 	switch (method) {
 	case IGT_DRAW_MMAP_CPU:
-		draw_rect_mmap_cpu(fd, &buf, &rect, color);
+		draw_rect_mmap_cpu(ctx->fd, &buf, &rect, color);
 		break;
 	case IGT_DRAW_MMAP_GTT:
-		draw_rect_mmap_gtt(fd, &buf, &rect, color);
+		draw_rect_mmap_gtt(ctx->fd, &buf, &rect, color);
 		break;
 	case IGT_DRAW_MMAP_WC:
-		draw_rect_mmap_wc(fd, &buf, &rect, color);
+		draw_rect_mmap_wc(ctx->fd, &buf, &rect, color);
 		break;
 	case IGT_DRAW_PWRITE:
-		draw_rect_pwrite(fd, &buf, &rect, color);
+		draw_rect_pwrite(ctx->fd, &buf, &rect, color);
 		break;
 	case IGT_DRAW_BLT:
-		draw_rect_blt(fd, &cmd_data, &buf, &rect, color);
+		draw_rect_blt(ctx, &buf, &rect, color);
 		break;
 	case IGT_DRAW_RENDER:
-		draw_rect_render(fd, &cmd_data, &buf, &rect, color);
+		draw_rect_render(ctx, &buf, &rect, color);
 		break;
 	default:
 		igt_assert(false);
@@ -594,6 +938,29 @@ void igt_draw_rect(int fd, drm_intel_bufmgr *bufmgr, drm_intel_context *context,
 	}
 }
 
+/**
+ * igt_draw_ctx_rect_fb:
+ * @ctx: the drawing context
+ * @fb: framebuffer
+ * @method: method you're going to use to write to the buffer
+ * @rect_x: horizontal position on the buffer where your rectangle starts
+ * @rect_y: vertical position on the buffer where your rectangle starts
+ * @rect_w: width of the rectangle
+ * @rect_h: height of the rectangle
+ * @color: color of the rectangle
+ *
+ * This is exactly the same as igt_draw_ctx_rect, but you can pass an igt_fb
+ * instead of manually providing its details. See igt_draw_ctx_rect.
+ */
+void igt_draw_ctx_rect_fb(struct igt_draw_ctx *ctx, struct igt_fb *fb,
+			  enum igt_draw_method method, int rect_x, int rect_y,
+			  int rect_w, int rect_h, uint32_t color)
+{
+	igt_draw_ctx_rect(ctx, fb->gem_handle, fb->size, fb->stride, method,
+			  rect_x, rect_y, rect_w, rect_h, color,
+			  igt_drm_format_to_bpp(fb->drm_format));
+}
+
 /**
  * igt_draw_rect_fb:
  * @fd: the DRM file descriptor
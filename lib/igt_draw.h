@@ -37,6 +37,8 @@
  * @IGT_DRAW_BLT: draw using the BLT ring.
  * @IGT_DRAW_RENDER: draw using the render ring.
  * @IGT_DRAW_METHOD_COUNT: useful for iterating through everything.
+ * @IGT_DRAW_AUTO: pick whichever real method measures fastest for the
+ *                 target's tiling and size, see igt_draw_ctx_rect().
  */
 enum igt_draw_method {
 	IGT_DRAW_MMAP_CPU,
@@ -46,10 +48,50 @@ enum igt_draw_method {
 	IGT_DRAW_BLT,
 	IGT_DRAW_RENDER,
 	IGT_DRAW_METHOD_COUNT,
+
+	/* Deliberately after IGT_DRAW_METHOD_COUNT so the "for each method"
+	 * subtest enumeration loops don't pick it up. */
+	IGT_DRAW_AUTO = IGT_DRAW_METHOD_COUNT,
+};
+
+/**
+ * igt_draw_ctx:
+ * @fd: the DRM file descriptor
+ * @bufmgr: the libdrm bufmgr, owned by the caller
+ * @context: the context, owned by the caller and possibly NULL
+ *
+ * A retained drawing context for igt_draw_ctx_rect(). It keeps the
+ * batchbuffer and the libdrm bo wrapping of the last target buffer alive
+ * across calls, see igt_draw_ctx_init().
+ */
+struct igt_draw_ctx {
+	int fd;
+	drm_intel_bufmgr *bufmgr;
+	drm_intel_context *context;
+	/*< private >*/
+	struct intel_batchbuffer *batch;
+	drm_intel_bo *bo;
+	uint32_t handle;
+	uint32_t tiling;
+	uint32_t swizzle;
 };
 
 const char *igt_draw_get_method_name(enum igt_draw_method method);
 
+void igt_draw_ctx_init(struct igt_draw_ctx *ctx, int fd,
+		       drm_intel_bufmgr *bufmgr, drm_intel_context *context);
+void igt_draw_ctx_flush(struct igt_draw_ctx *ctx);
+void igt_draw_ctx_fini(struct igt_draw_ctx *ctx);
+
+void igt_draw_ctx_rect(struct igt_draw_ctx *ctx, uint32_t buf_handle,
+		       uint32_t buf_size, uint32_t buf_stride,
+		       enum igt_draw_method method, int rect_x, int rect_y,
+		       int rect_w, int rect_h, uint32_t color, int bpp);
+
+void igt_draw_ctx_rect_fb(struct igt_draw_ctx *ctx, struct igt_fb *fb,
+			  enum igt_draw_method method, int rect_x, int rect_y,
+			  int rect_w, int rect_h, uint32_t color);
+
 void igt_draw_rect(int fd, drm_intel_bufmgr *bufmgr, drm_intel_context *context,
 		   uint32_t buf_handle, uint32_t buf_size, uint32_t buf_stride,
 		   enum igt_draw_method method, int rect_x, int rect_y,
@@ -89,12 +89,18 @@ static void emit_recursive_batch(igt_spin_t *spin,
 	memset(obj, 0, sizeof(obj));
 	memset(relocs, 0, sizeof(relocs));
 
-	obj[BATCH].handle = gem_create(fd, BATCH_SIZE);
-	batch = __gem_mmap__wc(fd, obj[BATCH].handle,
-			       0, BATCH_SIZE, PROT_WRITE);
-	if (!batch)
-		batch = __gem_mmap__gtt(fd, obj[BATCH].handle,
-				       	BATCH_SIZE, PROT_WRITE);
+	if (spin->handle) {
+		/* respinning a pooled batch, bo and mapping already live */
+		obj[BATCH].handle = spin->handle;
+		batch = spin->batch;
+	} else {
+		obj[BATCH].handle = gem_create(fd, BATCH_SIZE);
+		batch = __gem_mmap__wc(fd, obj[BATCH].handle,
+				       0, BATCH_SIZE, PROT_WRITE);
+		if (!batch)
+			batch = __gem_mmap__gtt(fd, obj[BATCH].handle,
+						BATCH_SIZE, PROT_WRITE);
+	}
 	gem_set_domain(fd, obj[BATCH].handle,
 			I915_GEM_DOMAIN_GTT, I915_GEM_DOMAIN_GTT);
 	execbuf.buffer_count++;
@@ -272,3 +278,119 @@ void igt_terminate_spin_batches(void)
 	igt_list_for_each(iter, &spin_list, link)
 		igt_spin_batch_end(iter);
 }
+
+/*
+ * Pool of parked spinners, keyed by (fd, engine). Scheduler tests create and
+ * free spinners in loops tighter than the spinner setup cost; parking keeps
+ * the bo and its mapping alive so reacquisition only rewrites the spin words
+ * and resubmits.
+ */
+#define SPIN_POOL_SIZE 16
+
+static struct {
+	int fd;
+	int engine;
+	igt_spin_t *spin;
+} spin_pool[SPIN_POOL_SIZE];
+
+/**
+ * igt_spin_batch_get:
+ * @fd: open i915 drm file descriptor
+ * @engine: Ring to execute batch OR'd with execbuf flags. If value is less
+ *          than 0, execute on all available rings.
+ *
+ * Like igt_spin_batch_new() without a dependency, but drawing from the pool
+ * filled by igt_spin_batch_put(): a parked spinner for the same fd and engine
+ * is restarted in place, paying only the resubmission instead of buffer
+ * allocation, mapping and fault-in. Use this in tight create/free loops where
+ * spinner setup cost would swamp the measurement.
+ *
+ * Returns:
+ * Structure with helper internal state for igt_spin_batch_put() or
+ * igt_spin_batch_free().
+ */
+igt_spin_t *
+igt_spin_batch_get(int fd, int engine)
+{
+	int i;
+
+	for (i = 0; i < SPIN_POOL_SIZE; i++) {
+		igt_spin_t *spin = spin_pool[i].spin;
+
+		if (!spin || spin_pool[i].fd != fd ||
+		    spin_pool[i].engine != engine)
+			continue;
+
+		spin_pool[i].spin = NULL;
+
+		emit_recursive_batch(spin, fd, engine, 0);
+		igt_assert(gem_bo_busy(fd, spin->handle));
+		igt_list_add(&spin->link, &spin_list);
+
+		return spin;
+	}
+
+	return igt_spin_batch_new(fd, engine, 0);
+}
+
+/**
+ * igt_spin_batch_put:
+ * @fd: open i915 drm file descriptor
+ * @engine: engine @spin was acquired for
+ * @spin: spin batch state from igt_spin_batch_get()
+ *
+ * Ends @spin and parks it in the pool for reuse by a later
+ * igt_spin_batch_get() on the same fd and engine. If the pool is full the
+ * spinner is freed instead.
+ */
+void igt_spin_batch_put(int fd, int engine, igt_spin_t *spin)
+{
+	int i;
+
+	if (!spin)
+		return;
+
+	igt_list_del(&spin->link);
+
+	if (spin->timer) {
+		timer_delete(spin->timer);
+		spin->timer = 0;
+	}
+
+	igt_spin_batch_end(spin);
+
+	for (i = 0; i < SPIN_POOL_SIZE; i++) {
+		if (spin_pool[i].spin)
+			continue;
+
+		spin_pool[i].fd = fd;
+		spin_pool[i].engine = engine;
+		spin_pool[i].spin = spin;
+		return;
+	}
+
+	igt_list_add(&spin->link, &spin_list);
+	igt_spin_batch_free(fd, spin);
+}
+
+/**
+ * igt_spin_batch_pool_purge:
+ *
+ * Frees all parked spinners. Call this before closing a drm file descriptor
+ * whose spinners may still sit in the pool.
+ */
+void igt_spin_batch_pool_purge(void)
+{
+	int i;
+
+	for (i = 0; i < SPIN_POOL_SIZE; i++) {
+		igt_spin_t *spin = spin_pool[i].spin;
+
+		if (!spin)
+			continue;
+
+		spin_pool[i].spin = NULL;
+		igt_list_add(&spin->link, &spin_list);
+		igt_spin_batch_free(spin_pool[i].fd, spin);
+	}
+}
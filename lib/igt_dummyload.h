@@ -43,6 +43,10 @@ void igt_spin_batch_set_timeout(igt_spin_t *spin, int64_t ns);
 void igt_spin_batch_end(igt_spin_t *spin);
 void igt_spin_batch_free(int fd, igt_spin_t *spin);
 
+igt_spin_t *igt_spin_batch_get(int fd, int engine);
+void igt_spin_batch_put(int fd, int engine, igt_spin_t *spin);
+void igt_spin_batch_pool_purge(void);
+
 void igt_terminate_spin_batches(void);
 
 #endif /* __IGT_DUMMYLOAD_H__ */
@@ -0,0 +1,125 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __IGT_EWMA_H__
+#define __IGT_EWMA_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Exponentially weighted moving average (EWMA)
+ *
+ * This implements a fixed-precision EWMA algorithm, with both the
+ * precision and fall-off coefficient determined at compile-time
+ * and built into the generated helper functions.
+ *
+ * The first argument to the macro is the name that will be used
+ * for the struct and helper functions.
+ *
+ * The second argument, the precision, expresses how many bits are
+ * used for the fractional part of the fixed-precision values.
+ *
+ * The third argument, the weight reciprocal, determines how the
+ * new values will be weighed vs. the old state, new values will
+ * get weight 1/weight_rcp and old values 1-1/weight_rcp. Note
+ * that this parameter must be a power of two for efficiency.
+ */
+
+#define IGT_EWMA_BUG_ON(expr) ((void)sizeof(char[1 - 2 * !!(expr)]))
+
+#define DECLARE_EWMA(T, name, _precision, _weight_rcp)			\
+	struct ewma_##name {						\
+		T internal;					\
+	};								\
+	static inline void ewma_##name##_init(struct ewma_##name *e)	\
+	{								\
+		IGT_EWMA_BUG_ON(!__builtin_constant_p(_precision));	\
+		IGT_EWMA_BUG_ON(!__builtin_constant_p(_weight_rcp));	\
+		/*							\
+		 * Even if you want to feed it just 0/1 you should have	\
+		 * some bits for the non-fractional part...		\
+		 */							\
+		IGT_EWMA_BUG_ON((_precision) > 30);			\
+		IGT_EWMA_BUG_ON((_weight_rcp) & ((_weight_rcp) - 1));	\
+		e->internal = 0;					\
+	}								\
+	static inline T							\
+	ewma_##name##_read(struct ewma_##name *e)			\
+	{								\
+		return e->internal >> (_precision);			\
+	}								\
+	static inline void ewma_##name##_add(struct ewma_##name *e,	\
+					     T val)			\
+	{								\
+		const T weight_rcp = __builtin_ctzll(_weight_rcp);	\
+		const T precision = _precision;				\
+		T internal = e->internal;				\
+									\
+		e->internal = internal ?				\
+			(((internal << weight_rcp) - internal) +	\
+				(val << precision)) >> weight_rcp :	\
+			(val << precision);				\
+	}
+
+/**
+ * igt_ewma:
+ *
+ * Time-decayed moving average for irregularly spaced samples. Where
+ * DECLARE_EWMA() gives every sample the same weight regardless of when
+ * it arrived, here the weight of the accumulated state follows the time
+ * actually elapsed, so sparse and bursty samplers decay consistently.
+ * Needs to be initialized with igt_ewma_init().
+ */
+struct igt_ewma {
+	/*< private >*/
+	double tau;
+	double value;
+	double last;
+	bool primed;
+};
+
+void igt_ewma_init(struct igt_ewma *e, double tau);
+void igt_ewma_add(struct igt_ewma *e, double time, double value);
+double igt_ewma_read(const struct igt_ewma *e);
+
+/**
+ * igt_ewma_rate:
+ *
+ * Events-per-time-unit estimator built on #igt_ewma: feed it event
+ * counts as they happen and read back a rate smoothed over the window
+ * given at init time, decaying towards zero while no events arrive.
+ * Needs to be initialized with igt_ewma_rate_init().
+ */
+struct igt_ewma_rate {
+	/*< private >*/
+	struct igt_ewma avg;
+	double pending;
+};
+
+void igt_ewma_rate_init(struct igt_ewma_rate *r, double window, double time);
+void igt_ewma_rate_add(struct igt_ewma_rate *r, double time, uint64_t count);
+double igt_ewma_rate_read(const struct igt_ewma_rate *r, double time);
+
+#endif /* __IGT_EWMA_H__ */
@@ -28,12 +28,16 @@
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <math.h>
+#include <sys/mman.h>
 
 #include "drmtest.h"
 #include "igt_fb.h"
 #include "igt_kms.h"
+#include "igt_vgem.h"
 #include "ioctl_wrappers.h"
+#include "intel_batchbuffer.h"
 #include "intel_chipset.h"
+#include "igt_x86.h"
 
 /**
  * SECTION:igt_fb
@@ -77,6 +81,8 @@ static struct format_desc_struct {
 static void igt_get_fb_tile_size(int fd, uint64_t tiling, int fb_bpp,
 				 unsigned *width_ret, unsigned *height_ret)
 {
+	uint32_t devid;
+
 	switch (tiling) {
 	case LOCAL_DRM_FORMAT_MOD_NONE:
 		*width_ret = 64;
@@ -94,10 +100,11 @@ static void igt_get_fb_tile_size(int fd, uint64_t tiling, int fb_bpp,
 		break;
 	case LOCAL_I915_FORMAT_MOD_Y_TILED:
 		igt_require_intel(fd);
-		if (intel_gen(intel_get_drm_devid(fd)) == 2) {
+		devid = intel_get_drm_devid(fd);
+		if (intel_gen(devid) == 2) {
 			*width_ret = 128;
 			*height_ret = 16;
-		} else if (IS_915(intel_get_drm_devid(fd))) {
+		} else if (IS_915(devid)) {
 			*width_ret = 512;
 			*height_ret = 8;
 		} else {
@@ -206,6 +213,98 @@ uint64_t igt_fb_mod_to_tiling(uint64_t modifier)
 	}
 }
 
+/*
+ * Opt-in framebuffer recycling cache.
+ *
+ * Flip-loop tests create and destroy thousands of identical framebuffers;
+ * with the cache enabled igt_remove_fb() parks the framebuffer (gem bo and
+ * drm fb id included) instead of destroying it and igt_create_fb() hands it
+ * back on the next request with matching geometry, format and tiling,
+ * skipping both the bo allocation and the addfb ioctl in steady state.
+ */
+#define FB_CACHE_SIZE 32
+
+static struct igt_fb fb_cache[FB_CACHE_SIZE];
+static int fb_cache_entries;
+static bool fb_cache_active;
+
+static void fb_cache_destroy_entry(struct igt_fb *fb)
+{
+	do_or_die(drmModeRmFB(fb->fd, fb->fb_id));
+	gem_close(fb->fd, fb->gem_handle);
+}
+
+static bool fb_cache_get(int fd, int width, int height, uint32_t format,
+			 uint64_t tiling, struct igt_fb *fb)
+{
+	int i;
+
+	if (!fb_cache_active)
+		return false;
+
+	for (i = 0; i < fb_cache_entries; i++) {
+		struct igt_fb *entry = &fb_cache[i];
+
+		if (entry->fd != fd ||
+		    entry->width != width ||
+		    entry->height != height ||
+		    entry->drm_format != format ||
+		    entry->tiling != tiling)
+			continue;
+
+		*fb = *entry;
+		fb_cache[i] = fb_cache[--fb_cache_entries];
+
+		return true;
+	}
+
+	return false;
+}
+
+static bool fb_cache_put(struct igt_fb *fb)
+{
+	if (!fb_cache_active || fb->is_prime ||
+	    fb_cache_entries >= FB_CACHE_SIZE)
+		return false;
+
+	fb_cache[fb_cache_entries++] = *fb;
+
+	return true;
+}
+
+/**
+ * igt_fb_cache_enable:
+ *
+ * Enables the framebuffer recycling cache: subsequent igt_remove_fb() calls
+ * park the framebuffer for reuse and igt_create_fb() with matching
+ * parameters returns it without touching the kernel.
+ *
+ * Note that recycled framebuffers keep their previous contents instead of
+ * being cleared to black, so only enable the cache in loops which repaint
+ * the full framebuffer anyway.
+ */
+void igt_fb_cache_enable(void)
+{
+	fb_cache_active = true;
+}
+
+/**
+ * igt_fb_cache_disable:
+ *
+ * Disables the framebuffer recycling cache and destroys all parked
+ * framebuffers.
+ */
+void igt_fb_cache_disable(void)
+{
+	int i;
+
+	for (i = 0; i < fb_cache_entries; i++)
+		fb_cache_destroy_entry(&fb_cache[i]);
+
+	fb_cache_entries = 0;
+	fb_cache_active = false;
+}
+
 /* helpers to create nice-looking framebuffers */
 static int create_bo_for_fb(int fd, int width, int height, uint32_t format,
 			    uint64_t tiling, unsigned size, unsigned stride,
@@ -319,6 +418,10 @@ igt_create_fb_with_bo_size(int fd, int width, int height,
 
 	memset(fb, 0, sizeof(*fb));
 
+	if (!bo_size && !bo_stride &&
+	    fb_cache_get(fd, width, height, format, tiling, fb))
+		return fb->fb_id;
+
 	igt_debug("%s(width=%d, height=%d, format=0x%x, tiling=0x%"PRIx64", size=%d)\n",
 		  __func__, width, height, format, tiling, bo_size);
 	fb->gem_handle = create_bo_for_fb(fd, width, height, format, tiling,
@@ -429,6 +532,109 @@ unsigned int igt_create_color_fb(int fd, int width, int height,
 	return fb_id;
 }
 
+/*
+ * Rasterizing the test pattern with cairo and pushing it through a GTT
+ * mapping costs tens of milliseconds on a 4k framebuffer. On hardware with a
+ * rendercopy implementation we therefore keep a small cache of linear
+ * template framebuffers which hold the pattern, rendered through cairo
+ * exactly once per size/format, and copy them into new pattern framebuffers
+ * on the GPU.
+ */
+#define PATTERN_TEMPLATE_CACHE_SIZE 4
+static struct igt_fb pattern_templates[PATTERN_TEMPLATE_CACHE_SIZE];
+static int num_pattern_templates;
+
+static struct igt_fb *get_pattern_template(int fd, int width, int height,
+					   uint32_t format)
+{
+	struct igt_fb *tmpl;
+	cairo_t *cr;
+	int i;
+
+	for (i = 0; i < num_pattern_templates; i++) {
+		tmpl = &pattern_templates[i];
+
+		if (tmpl->fd == fd && tmpl->width == width &&
+		    tmpl->height == height && tmpl->drm_format == format)
+			return tmpl;
+	}
+
+	if (num_pattern_templates == PATTERN_TEMPLATE_CACHE_SIZE) {
+		tmpl = &pattern_templates[--num_pattern_templates];
+		igt_remove_fb(tmpl->fd, tmpl);
+	}
+
+	tmpl = &pattern_templates[num_pattern_templates];
+	igt_assert(igt_create_fb(fd, width, height, format,
+				 LOCAL_DRM_FORMAT_MOD_NONE, tmpl));
+
+	cr = igt_get_cairo_ctx(fd, tmpl);
+	igt_paint_test_pattern(cr, width, height);
+	igt_assert(cairo_status(cr) == 0);
+	cairo_destroy(cr);
+
+	num_pattern_templates++;
+
+	return tmpl;
+}
+
+static bool render_pattern_fb(int fd, struct igt_fb *fb)
+{
+	igt_render_copyfunc_t rendercopy;
+	struct igt_buf src_buf = {}, dst_buf = {};
+	struct intel_batchbuffer *batch;
+	drm_intel_bufmgr *bufmgr;
+	drm_intel_bo *src, *dst;
+	struct igt_fb *tmpl;
+	uint32_t devid;
+
+	if (fb->is_dumb || !is_i915_device(fd))
+		return false;
+
+	/* rendercopy only handles full 32bpp pixels */
+	if (igt_drm_format_to_bpp(fb->drm_format) != 32)
+		return false;
+
+	devid = intel_get_drm_devid(fd);
+	rendercopy = igt_get_render_copyfunc(devid);
+	if (!rendercopy)
+		return false;
+
+	tmpl = get_pattern_template(fd, fb->width, fb->height, fb->drm_format);
+
+	bufmgr = drm_intel_bufmgr_gem_init(fd, 4096);
+	igt_assert(bufmgr);
+
+	src = gem_handle_to_libdrm_bo(bufmgr, fd, "pattern template",
+				      tmpl->gem_handle);
+	igt_assert(src);
+	dst = gem_handle_to_libdrm_bo(bufmgr, fd, "pattern fb",
+				      fb->gem_handle);
+	igt_assert(dst);
+
+	src_buf.bo = src;
+	src_buf.stride = tmpl->stride;
+	src_buf.tiling = I915_TILING_NONE;
+	src_buf.size = tmpl->size;
+	dst_buf.bo = dst;
+	dst_buf.stride = fb->stride;
+	dst_buf.tiling = igt_fb_mod_to_tiling(fb->tiling);
+	dst_buf.size = fb->size;
+
+	batch = intel_batchbuffer_alloc(bufmgr, devid);
+	igt_assert(batch);
+
+	rendercopy(batch, NULL, &src_buf, 0, 0, fb->width, fb->height,
+		   &dst_buf, 0, 0);
+
+	intel_batchbuffer_free(batch);
+	drm_intel_bo_unreference(src);
+	drm_intel_bo_unreference(dst);
+	drm_intel_bufmgr_destroy(bufmgr);
+
+	return true;
+}
+
 /**
  * igt_create_pattern_fb:
  * @fd: open i915 drm file descriptor
@@ -443,7 +649,9 @@ unsigned int igt_create_color_fb(int fd, int width, int height,
  * object. All metadata is stored in @fb.
  *
  * Compared to igt_create_fb() this function also draws the standard test pattern
- * into the framebuffer.
+ * into the framebuffer. On hardware with a rendercopy implementation the
+ * pattern is copied from a cached template framebuffer on the GPU instead of
+ * being rasterized with cairo for every single framebuffer.
  *
  * Returns:
  * The kms id of the created framebuffer on success or a negative error code on
@@ -459,6 +667,9 @@ unsigned int igt_create_pattern_fb(int fd, int width, int height,
 	fb_id = igt_create_fb(fd, width, height, format, tiling, fb);
 	igt_assert(fb_id);
 
+	if (render_pattern_fb(fd, fb))
+		return fb_id;
+
 	cr = igt_get_cairo_ctx(fd, fb);
 	igt_paint_test_pattern(cr, width, height);
 	igt_assert(cairo_status(cr) == 0);
@@ -555,6 +766,75 @@ unsigned int igt_create_image_fb(int fd, int width, int height,
 	return fb_id;
 }
 
+/**
+ * igt_create_vgem_fb:
+ * @fd: open drm file descriptor of the KMS device
+ * @vgem_fd: open vgem drm file descriptor
+ * @width: width of the framebuffer in pixel
+ * @height: height of the framebuffer in pixel
+ * @format: drm fourcc pixel format code
+ * @fb: pointer to an #igt_fb structure
+ * @ptr_ret: returns the WC mapping of the backing storage
+ *
+ * This allocates a linear buffer on the vgem device, maps it write-combining
+ * exactly once and imports it on the KMS device as a framebuffer through
+ * dmabuf. The mapping stays valid for the whole lifetime of the framebuffer,
+ * so CPU-rendered content can be streamed directly to the scanout buffer
+ * without the usual duplicate buffer and copy through a GTT map. The caller
+ * is responsible for munmap()ing the pointer after removing the fb.
+ *
+ * Returns:
+ * The kms id of the created framebuffer.
+ */
+unsigned int igt_create_vgem_fb(int fd, int vgem_fd, int width, int height,
+				uint32_t format, struct igt_fb *fb /* out */,
+				void **ptr_ret)
+{
+	struct vgem_bo bo;
+	uint32_t handles[4], pitches[4], offsets[4];
+	uint32_t fb_id;
+	int dmabuf;
+
+	memset(fb, 0, sizeof(*fb));
+
+	bo.width = width;
+	bo.height = height;
+	bo.bpp = igt_drm_format_to_bpp(format);
+	vgem_create(vgem_fd, &bo);
+
+	*ptr_ret = vgem_mmap(vgem_fd, &bo, PROT_READ | PROT_WRITE);
+
+	dmabuf = prime_handle_to_fd(vgem_fd, bo.handle);
+	fb->gem_handle = prime_fd_to_handle(fd, dmabuf);
+	close(dmabuf);
+
+	/* the dmabuf keeps the backing storage alive */
+	gem_close(vgem_fd, bo.handle);
+
+	memset(handles, 0, sizeof(handles));
+	memset(pitches, 0, sizeof(pitches));
+	memset(offsets, 0, sizeof(offsets));
+
+	handles[0] = fb->gem_handle;
+	pitches[0] = bo.pitch;
+
+	do_or_die(drmModeAddFB2(fd, width, height, format,
+				handles, pitches, offsets,
+				&fb_id, 0));
+
+	fb->fb_id = fb_id;
+	fb->fd = fd;
+	fb->is_prime = true;
+	fb->drm_format = format;
+	fb->width = width;
+	fb->height = height;
+	fb->stride = bo.pitch;
+	fb->tiling = LOCAL_DRM_FORMAT_MOD_NONE;
+	fb->size = bo.size;
+
+	return fb_id;
+}
+
 struct box {
 	int x, y, width, height;
 };
@@ -835,6 +1115,21 @@ static cairo_surface_t *get_cairo_surface(int fd, struct igt_fb *fb)
 			       I915_GEM_DOMAIN_CPU);
 
 	igt_assert(cairo_surface_status(fb->cairo_surface) == CAIRO_STATUS_SUCCESS);
+
+	/*
+	 * A directly mapped bo picks the pixels up as they are drawn, so the
+	 * framebuffer can hold on to its surface until igt_remove_fb() and
+	 * repeated drawing on the same fb skips the map/unmap and surface
+	 * setup. Y/Yf tiled fbs draw through a linear shadow buffer that is
+	 * only blitted back when the surface is torn down, and dumb buffers
+	 * need a dirtyfb afterwards, so those keep the surface-per-use
+	 * lifetime as their flush point.
+	 */
+	if (!fb->is_dumb &&
+	    fb->tiling != LOCAL_I915_FORMAT_MOD_Y_TILED &&
+	    fb->tiling != LOCAL_I915_FORMAT_MOD_Yf_TILED)
+		cairo_surface_reference(fb->cairo_surface);
+
 	return fb->cairo_surface;
 }
 
@@ -848,6 +1143,10 @@ static cairo_surface_t *get_cairo_surface(int fd, struct igt_fb *fb)
  * cairo_destroy(). This also sets a default font for drawing text on
  * framebuffers.
  *
+ * For linear and X tiled framebuffers the surface and the mapping behind it
+ * are retained on @fb until igt_remove_fb(), so drawing on the same fb every
+ * frame does not pay for the surface setup again.
+ *
  * Returns:
  * The created cairo drawing context.
  */
@@ -889,6 +1188,43 @@ void igt_write_fb_to_png(int fd, struct igt_fb *fb, const char *filename)
 	igt_assert(status == CAIRO_STATUS_SUCCESS);
 }
 
+/**
+ * igt_fb_get_crc32:
+ * @fd: open i915 drm file descriptor
+ * @fb: pointer to an #igt_fb structure
+ *
+ * Computes a CRC32 checksum over the visible contents of @fb. The
+ * framebuffer is read through a GTT mapping, so tiled layouts are
+ * detiled by the fence and iteration is simply row by row; the stride
+ * padding is skipped, making the checksum independent of the tiling
+ * mode and stride the buffer happens to use. The reads are streamed
+ * (see igt_crc32_from_wc()), so a multi-MiB surface is summed at
+ * memory bandwidth without flushing the test's working set out of the
+ * LLC.
+ *
+ * Returns:
+ * The CRC32 of the framebuffer contents.
+ */
+uint32_t igt_fb_get_crc32(int fd, struct igt_fb *fb)
+{
+	unsigned int row_bytes =
+		fb->width * igt_drm_format_to_bpp(fb->drm_format) / 8;
+	uint32_t crc = 0;
+	const char *ptr;
+	int y;
+
+	ptr = gem_mmap__gtt(fd, fb->gem_handle, fb->size, PROT_READ);
+	gem_set_domain(fd, fb->gem_handle, I915_GEM_DOMAIN_GTT, 0);
+
+	for (y = 0; y < fb->height; y++)
+		crc = igt_crc32_from_wc(crc, ptr + y * fb->stride,
+					row_bytes);
+
+	gem_munmap((void *)ptr, fb->size);
+
+	return crc;
+}
+
 /**
  * igt_remove_fb:
  * @fd: open i915 drm file descriptor
@@ -901,6 +1237,11 @@ void igt_write_fb_to_png(int fd, struct igt_fb *fb, const char *filename)
 void igt_remove_fb(int fd, struct igt_fb *fb)
 {
 	cairo_surface_destroy(fb->cairo_surface);
+	fb->cairo_surface = NULL;
+
+	if (fb_cache_put(fb))
+		return;
+
 	do_or_die(drmModeRmFB(fd, fb->fb_id));
 	gem_close(fd, fb->gem_handle);
 }
@@ -43,6 +43,7 @@
  * @fd: DRM device fd this framebuffer is created on
  * @gem_handle: GEM handler of the underlying backing storage
  * @is_dumb: Whether this framebuffer was allocated using the dumb buffer API
+ * @is_prime: Whether the backing storage was imported through dmabuf
  * @drm_format: DRM FOURCC code
  * @width: width in pixels
  * @height: height in pixels
@@ -59,6 +60,7 @@ typedef struct igt_fb {
 	int fd;
 	uint32_t gem_handle;
 	bool is_dumb;
+	bool is_prime;
 	uint32_t drm_format;
 	int width;
 	int height;
@@ -95,7 +97,13 @@ unsigned int igt_create_image_fb(int drm_fd,  int width, int height,
 				 struct igt_fb *fb /* out */);
 unsigned int igt_create_stereo_fb(int drm_fd, drmModeModeInfo *mode,
 				  uint32_t format, uint64_t tiling);
+unsigned int igt_create_vgem_fb(int fd, int vgem_fd, int width, int height,
+				uint32_t format, struct igt_fb *fb /* out */,
+				void **ptr_ret);
 void igt_remove_fb(int fd, struct igt_fb *fb);
+uint32_t igt_fb_get_crc32(int fd, struct igt_fb *fb);
+void igt_fb_cache_enable(void);
+void igt_fb_cache_disable(void);
 int igt_dirty_fb(int fd, struct igt_fb *fb);
 
 int igt_create_bo_with_dimensions(int fd, int width, int height, uint32_t format,
@@ -0,0 +1,213 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "igt_core.h"
+#include "igt_gpu_clock.h"
+#include "intel_io.h"
+
+/**
+ * SECTION:igt_gpu_clock
+ * @short_description: GPU/CPU clock correlation
+ * @title: GPU clock
+ * @include: igt.h
+ *
+ * Latency measurements that only timestamp on the CPU side cannot tell how
+ * long a batch sat in the queue apart from how long it ran. These helpers
+ * sample an engine command streamer TIMESTAMP register through the register
+ * mapping set up by intel_register_access_init() and maintain a correlation
+ * with CLOCK_MONOTONIC, so a GPU timestamp written by the hardware (e.g.
+ * via MI_STORE_REGISTER_MEM at the start of a batch) can be placed on the
+ * CPU timeline and compared against the submission time.
+ *
+ * The pairing of the two clocks is done by bracketing a register read with
+ * two CPU clock reads and keeping the tightest bracket, giving
+ * sub-microsecond correlation error. Re-syncing with igt_gpu_clock_sync()
+ * additionally measures the drift between the two clocks over the elapsed
+ * interval, which igt_gpu_clock_to_cpu_ns() compensates for.
+ */
+
+#define NSEC_PER_SEC 1000000000ULL
+
+/* The command streamer timestamp counters tick at 12.5MHz, i.e. 80ns. */
+#define TIMESTAMP_TICK_NS 80.0
+
+/**
+ * igt_gpu_clock_cpu_now_ns:
+ *
+ * Returns: The current CLOCK_MONOTONIC time in nanoseconds, for stamping
+ * events on the CPU side of the correlation.
+ */
+uint64_t igt_gpu_clock_cpu_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/**
+ * igt_gpu_clock_read:
+ * @clock: GPU clock
+ *
+ * Samples the TIMESTAMP register and extends the 32bit counter to 64bit by
+ * tracking wraparounds. The extension only works if the clock is read at
+ * least once per counter period (about 5 minutes at 80ns per tick).
+ *
+ * Returns: The current engine timestamp in ticks.
+ */
+uint64_t igt_gpu_clock_read(igt_gpu_clock_t *clock)
+{
+	uint32_t raw = *clock->reg;
+
+	if (raw < clock->last_raw)
+		clock->base_ticks += 1ULL << 32;
+	clock->last_raw = raw;
+
+	return clock->base_ticks | raw;
+}
+
+/**
+ * igt_gpu_clock_extend:
+ * @clock: GPU clock
+ * @raw: raw 32bit timestamp, e.g. written by MI_STORE_REGISTER_MEM
+ *
+ * Extends a raw timestamp captured by the hardware to 64bit, by picking the
+ * counter period closest to the current value of the clock. The sample must
+ * have been taken within half a counter period of now.
+ *
+ * Returns: The extended timestamp in ticks.
+ */
+uint64_t igt_gpu_clock_extend(igt_gpu_clock_t *clock, uint32_t raw)
+{
+	uint64_t now = igt_gpu_clock_read(clock);
+	uint64_t ticks = (now & ~(uint64_t)0xffffffff) | raw;
+
+	if (ticks > now + (1ULL << 31))
+		ticks -= 1ULL << 32;
+	else if (ticks + (1ULL << 31) < now)
+		ticks += 1ULL << 32;
+
+	return ticks;
+}
+
+/**
+ * igt_gpu_clock_sync:
+ * @clock: GPU clock
+ *
+ * Takes a paired sample of the GPU and CPU clocks to anchor the
+ * correlation, and updates the drift estimate from how far the previous
+ * anchor's prediction was off over the elapsed interval.
+ */
+void igt_gpu_clock_sync(igt_gpu_clock_t *clock)
+{
+	uint64_t best = ~0ULL;
+	uint64_t cpu = 0, ticks = 0;
+
+	/* The register read dominates the bracket; retrying a few times and
+	 * keeping the tightest pairing trims scheduling noise.
+	 */
+	for (int i = 0; i < 8; i++) {
+		uint64_t cpu0, cpu1, t;
+
+		cpu0 = igt_gpu_clock_cpu_now_ns();
+		t = igt_gpu_clock_read(clock);
+		cpu1 = igt_gpu_clock_cpu_now_ns();
+
+		if (cpu1 - cpu0 < best) {
+			best = cpu1 - cpu0;
+			cpu = cpu0 + (cpu1 - cpu0) / 2;
+			ticks = t;
+		}
+	}
+
+	if (clock->have_sync && ticks > clock->sync_gpu_ticks) {
+		double gpu_ns = (ticks - clock->sync_gpu_ticks) *
+			clock->tick_ns;
+		double cpu_ns = cpu - clock->sync_cpu_ns;
+
+		clock->drift_ppm = (cpu_ns - gpu_ns) * 1e6 / gpu_ns;
+	}
+
+	clock->sync_cpu_ns = cpu;
+	clock->sync_gpu_ticks = ticks;
+	clock->have_sync = true;
+}
+
+/**
+ * igt_gpu_clock_to_cpu_ns:
+ * @clock: GPU clock
+ * @ticks: extended GPU timestamp
+ *
+ * Places a GPU timestamp on the CPU CLOCK_MONOTONIC timeline, using the
+ * last sync anchor and compensating for the measured drift.
+ *
+ * Returns: The estimated CLOCK_MONOTONIC time of @ticks, in nanoseconds.
+ */
+uint64_t igt_gpu_clock_to_cpu_ns(igt_gpu_clock_t *clock, uint64_t ticks)
+{
+	double gpu_ns = (int64_t)(ticks - clock->sync_gpu_ticks) *
+		clock->tick_ns;
+
+	gpu_ns *= 1.0 + clock->drift_ppm / 1e6;
+
+	return clock->sync_cpu_ns + (int64_t)gpu_ns;
+}
+
+/**
+ * igt_gpu_clock_drift_ppm:
+ * @clock: GPU clock
+ *
+ * Returns: The drift of the GPU clock against CLOCK_MONOTONIC measured by
+ * the last igt_gpu_clock_sync(), in parts per million. Zero until two syncs
+ * have been taken.
+ */
+double igt_gpu_clock_drift_ppm(const igt_gpu_clock_t *clock)
+{
+	return clock->drift_ppm;
+}
+
+/**
+ * igt_gpu_clock_init:
+ * @clock: GPU clock to initialize
+ * @reg: TIMESTAMP register offset, e.g. %RCS_TIMESTAMP
+ *
+ * Initializes @clock on an engine timestamp register and takes the first
+ * correlation anchor. The register mapping must already have been set up
+ * with intel_register_access_init() or intel_mmio_use_pci_bar().
+ */
+void igt_gpu_clock_init(igt_gpu_clock_t *clock, uint32_t reg)
+{
+	igt_assert(igt_global_mmio);
+
+	memset(clock, 0, sizeof(*clock));
+	clock->reg = (volatile uint32_t *)
+		((volatile char *)igt_global_mmio + reg);
+	clock->tick_ns = TIMESTAMP_TICK_NS;
+	clock->last_raw = *clock->reg;
+
+	igt_gpu_clock_sync(clock);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef IGT_GPU_CLOCK_H
+#define IGT_GPU_CLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Engine command streamer TIMESTAMP registers, mmio base + 0x358. */
+#define RCS_TIMESTAMP	(0x2000 + 0x358)
+#define BCS_TIMESTAMP	(0x22000 + 0x358)
+#define VCS_TIMESTAMP	(0x12000 + 0x358)
+#define VECS_TIMESTAMP	(0x1a000 + 0x358)
+
+/**
+ * igt_gpu_clock_t:
+ *
+ * Correlation between an engine TIMESTAMP register and the CPU
+ * CLOCK_MONOTONIC clock, set up with igt_gpu_clock_init(). All members are
+ * private.
+ */
+typedef struct igt_gpu_clock {
+	volatile uint32_t *reg;
+	double tick_ns;
+
+	/* 32 -> 64 bit extension of the timestamp counter */
+	uint32_t last_raw;
+	uint64_t base_ticks;
+
+	/* correlation anchor and drift, updated by igt_gpu_clock_sync() */
+	bool have_sync;
+	uint64_t sync_cpu_ns;
+	uint64_t sync_gpu_ticks;
+	double drift_ppm;
+} igt_gpu_clock_t;
+
+void igt_gpu_clock_init(igt_gpu_clock_t *clock, uint32_t reg);
+uint64_t igt_gpu_clock_read(igt_gpu_clock_t *clock);
+uint64_t igt_gpu_clock_extend(igt_gpu_clock_t *clock, uint32_t raw);
+void igt_gpu_clock_sync(igt_gpu_clock_t *clock);
+uint64_t igt_gpu_clock_to_cpu_ns(igt_gpu_clock_t *clock, uint64_t ticks);
+double igt_gpu_clock_drift_ppm(const igt_gpu_clock_t *clock);
+uint64_t igt_gpu_clock_cpu_now_ns(void);
+
+#endif /* IGT_GPU_CLOCK_H */
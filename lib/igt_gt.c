@@ -357,6 +357,93 @@ void igt_post_hang_ring(int fd, igt_hang_t arg)
 	}
 }
 
+struct local_drm_i915_reset_stats {
+	__u32 ctx_id;
+	__u32 flags;
+	__u32 reset_count;
+	__u32 batch_active;
+	__u32 batch_pending;
+	__u32 pad;
+};
+#define LOCAL_IOCTL_I915_GET_RESET_STATS \
+	DRM_IOWR(DRM_COMMAND_BASE + 0x32, struct local_drm_i915_reset_stats)
+
+/**
+ * igt_reset_epoch:
+ * @fd: open i915 drm file descriptor
+ *
+ * Returns the global reset counter, i.e. how many GPU resets the device
+ * has been through. Sampling it before provoking a hang and comparing
+ * afterwards tells whether (and how many times) the kernel actually
+ * reset the GPU, without parsing debugfs or waiting out fixed settle
+ * times. Reports 0 if the kernel lacks the reset-stats query.
+ */
+unsigned int igt_reset_epoch(int fd)
+{
+	struct local_drm_i915_reset_stats rs;
+
+	memset(&rs, 0, sizeof(rs));
+	if (ioctl(fd, LOCAL_IOCTL_I915_GET_RESET_STATS, &rs))
+		return 0;
+
+	return rs.reset_count;
+}
+
+/**
+ * igt_hang_queue_init:
+ * @q: the hang queue
+ * @fd: open i915 drm file descriptor
+ *
+ * Prepares @q for a batch of hangs and records the current reset epoch
+ * so igt_hang_queue_wait() can report how many resets the batch cost.
+ */
+void igt_hang_queue_init(igt_hang_queue_t *q, int fd)
+{
+	memset(q, 0, sizeof(*q));
+	q->epoch = igt_reset_epoch(fd);
+}
+
+/**
+ * igt_hang_queue_add:
+ * @q: the hang queue
+ * @fd: open i915 drm file descriptor
+ * @ring: execbuf ring flag
+ *
+ * Injects a hanging batch into @ring without waiting for it, so hangs
+ * queued on several engines are all pending before the first hangcheck
+ * fires and their detection periods overlap rather than accumulate.
+ */
+void igt_hang_queue_add(igt_hang_queue_t *q, int fd, int ring)
+{
+	igt_assert(q->count < IGT_MAX_QUEUED_HANGS);
+	q->hangs[q->count++] = igt_hang_ring(fd, ring);
+}
+
+/**
+ * igt_hang_queue_wait:
+ * @q: the hang queue
+ * @fd: open i915 drm file descriptor
+ *
+ * Waits until every queued hang has been reset and its engine recovered.
+ * The waits block in the kernel on the hanging batches themselves, so no
+ * settle time is spent beyond the recovery; once the first batch is
+ * cleared the remainder are usually already idle. The queue is emptied
+ * and can be reused after another igt_hang_queue_init().
+ *
+ * Returns:
+ * The number of resets observed since igt_hang_queue_init().
+ */
+unsigned int igt_hang_queue_wait(igt_hang_queue_t *q, int fd)
+{
+	int i;
+
+	for (i = 0; i < q->count; i++)
+		igt_post_hang_ring(fd, q->hangs[i]);
+	q->count = 0;
+
+	return igt_reset_epoch(fd) - q->epoch;
+}
+
 /**
  * igt_force_gpu_reset:
  *
@@ -454,6 +541,90 @@ int igt_open_forcewake_handle(int fd)
 	return igt_debugfs_open(fd, "i915_forcewake_user", O_WRONLY);
 }
 
+/*
+ * Holding the debugfs forcewake file keeps the GT out of RC6, so tools
+ * that grab it independently and sit on it skew every power measurement
+ * running alongside.  The manager below shares one handle per process
+ * behind a refcount, so nested users don't stack debugfs references,
+ * and it keeps an account of how long and how often the GT was kept
+ * awake so that can be audited afterwards.
+ */
+static struct {
+	int fd;
+	int refcount;
+	struct timespec opened;
+	uint64_t held_ns;
+	unsigned long acquisitions;
+} forcewake = { .fd = -1 };
+
+/**
+ * igt_forcewake_get:
+ * @fd: open i915 drm file descriptor
+ *
+ * Takes a reference on the process-wide forcewake handle, opening it on
+ * the first acquisition. Pair each call with igt_forcewake_put() and
+ * keep the window as small as possible: the GT cannot enter RC6 while
+ * any reference is held.
+ *
+ * Returns:
+ * 0 on success, -1 if the forcewake handle could not be opened.
+ */
+int igt_forcewake_get(int fd)
+{
+	if (forcewake.refcount == 0) {
+		forcewake.fd = igt_open_forcewake_handle(fd);
+		if (forcewake.fd == -1)
+			return -1;
+
+		memset(&forcewake.opened, 0, sizeof(forcewake.opened));
+		igt_nsec_elapsed(&forcewake.opened);
+		forcewake.acquisitions++;
+	}
+
+	forcewake.refcount++;
+	return 0;
+}
+
+/**
+ * igt_forcewake_put:
+ *
+ * Drops a reference taken with igt_forcewake_get(), releasing the
+ * forcewake handle and crediting the held time to the statistics when
+ * the last reference goes away.
+ */
+void igt_forcewake_put(void)
+{
+	igt_assert(forcewake.refcount > 0);
+
+	if (--forcewake.refcount == 0) {
+		forcewake.held_ns += igt_nsec_elapsed(&forcewake.opened);
+		close(forcewake.fd);
+		forcewake.fd = -1;
+	}
+}
+
+/**
+ * igt_forcewake_stats:
+ * @acquisitions: pointer to store the number of wake windows, may be NULL
+ * @held_ns: pointer to store the total held time in nanoseconds, may be NULL
+ *
+ * Reports how often and for how long this process has kept the GT awake
+ * through igt_forcewake_get(). A window still open at the time of the
+ * call is included in the total.
+ */
+void igt_forcewake_stats(unsigned long *acquisitions, uint64_t *held_ns)
+{
+	uint64_t total = forcewake.held_ns;
+
+	if (forcewake.refcount > 0)
+		total += igt_nsec_elapsed(&forcewake.opened);
+
+	if (acquisitions)
+		*acquisitions = forcewake.acquisitions;
+	if (held_ns)
+		*held_ns = total;
+}
+
 #if defined(__x86_64__) || defined(__i386__)
 static unsigned int clflush_size;
 
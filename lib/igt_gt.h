@@ -51,6 +51,19 @@ igt_hang_t igt_hang_ctx(int fd,
 igt_hang_t igt_hang_ring(int fd, int ring);
 void igt_post_hang_ring(int fd, igt_hang_t arg);
 
+unsigned int igt_reset_epoch(int fd);
+
+#define IGT_MAX_QUEUED_HANGS 8
+typedef struct igt_hang_queue {
+	igt_hang_t hangs[IGT_MAX_QUEUED_HANGS];
+	int count;
+	unsigned int epoch;
+} igt_hang_queue_t;
+
+void igt_hang_queue_init(igt_hang_queue_t *q, int fd);
+void igt_hang_queue_add(igt_hang_queue_t *q, int fd, int ring);
+unsigned int igt_hang_queue_wait(igt_hang_queue_t *q, int fd);
+
 void igt_force_gpu_reset(int fd);
 
 void igt_fork_hang_helper(void);
@@ -58,6 +71,10 @@ void igt_stop_hang_helper(void);
 
 int igt_open_forcewake_handle(int fd);
 
+int igt_forcewake_get(int fd);
+void igt_forcewake_put(void);
+void igt_forcewake_stats(unsigned long *acquisitions, uint64_t *held_ns);
+
 int igt_setup_clflush(void);
 void igt_clflush_range(void *addr, int size);
 
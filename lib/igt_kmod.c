@@ -23,6 +23,7 @@
 
 #include "igt.h"
 #include "igt_core.h"
+#include "igt_dev.h"
 #include "igt_sysfs.h"
 #include "igt_kmod.h"
 
@@ -240,6 +241,95 @@ igt_kmod_list_loaded(void)
 	kmod_module_unref_list(list);
 }
 
+/*
+ * Unbinding the console and the audio controller completes asynchronously
+ * in the kernel, so a module can still report -EBUSY for a short while
+ * after the unbind was issued. Instead of sleeping a worst-case settle
+ * time before each removal, retry the removal itself at a short interval
+ * until it succeeds or the module is genuinely stuck.
+ */
+static int kmod_unload_poll(const char *mod_name, unsigned int flags,
+			    unsigned int timeout_ms)
+{
+	struct kmod_ctx *ctx = kmod_ctx();
+	struct kmod_module *kmod;
+	unsigned int waited_ms = 0;
+	int err;
+
+	err = kmod_module_new_from_name(ctx, mod_name, &kmod);
+	if (err < 0) {
+		igt_debug("Could not use module %s (%s)\n", mod_name,
+			  strerror(-err));
+		return err;
+	}
+
+	for (;;) {
+		err = kmod_module_remove_module(kmod, flags);
+		if ((err != -EBUSY && err != -EAGAIN) ||
+		    waited_ms >= timeout_ms)
+			break;
+
+		usleep(10 * 1000);
+		waited_ms += 10;
+	}
+
+	if (err < 0)
+		igt_debug("Could not remove module %s (%s)\n", mod_name,
+			  strerror(-err));
+
+	kmod_module_unref(kmod);
+	return err;
+}
+
+/* Wait for a freshly loaded module to finish initializing by polling its
+ * sysfs initstate, bailing out after @timeout_ms. */
+static bool kmod_wait_initstate(const char *mod_name, unsigned int timeout_ms)
+{
+	unsigned int waited_ms = 0;
+	char path[128], buf[32];
+
+	snprintf(path, sizeof(path), "/sys/module/%s/initstate", mod_name);
+
+	for (;;) {
+		int fd, len;
+
+		fd = open(path, O_RDONLY);
+		if (fd >= 0) {
+			len = read(fd, buf, sizeof(buf) - 1);
+			close(fd);
+
+			if (len > 0) {
+				buf[len] = '\0';
+				if (strncmp(buf, "live", 4) == 0)
+					return true;
+			}
+		}
+
+		if (waited_ms >= timeout_ms)
+			return false;
+
+		usleep(10 * 1000);
+		waited_ms += 10;
+	}
+}
+
+/* The i915 stack in removal order: leaves first, with how long each module
+ * is given to shake off its last users and what a stuck removal means for
+ * the reload cycle (0 = best effort, keep going). */
+static const struct i915_unload_step {
+	const char *name;
+	unsigned int timeout_ms;
+	int fail_exit;
+	const char *lsof_path;
+} i915_unload_steps[] = {
+	{ "snd_hda_intel", 2000, IGT_EXIT_FAILURE, "/dev/snd" },
+	{ "intel_ips", 500, 0, NULL }, /* gen5 */
+	{ "i915", 2000, IGT_EXIT_SKIP, "/dev/dri" },
+	{ "intel-gtt", 500, 0, NULL },
+	{ "drm_kms_helper", 500, 0, NULL },
+	{ "drm", 500, 0, NULL },
+};
+
 /**
  * igt_i915_driver_load:
  * @opts: options to pass to i915 driver
@@ -253,13 +343,21 @@ igt_i915_driver_load(const char *opts)
 	if (opts)
 		igt_info("Reloading i915 with %s\n\n", opts);
 
+	/* minors may move around across a reload */
+	drm_forget_cached_devices();
+	igt_dev_forget_topology();
+
 	if (igt_kmod_load("i915", opts)) {
 		igt_warn("Could not load i915\n");
 		return IGT_EXIT_FAILURE;
 	}
 
+	if (!kmod_wait_initstate("i915", 2000))
+		igt_warn("i915 not live after loading\n");
+
 	kick_fbcon(true);
 	igt_kmod_load("snd_hda_intel", NULL);
+	kmod_wait_initstate("snd_hda_intel", 500);
 
 	return IGT_EXIT_SUCCESS;
 }
@@ -273,42 +371,37 @@ igt_i915_driver_load(const char *opts)
 int
 igt_i915_driver_unload(void)
 {
-	/* unbind vt */
+	int i;
+
+	/* Issue the console and audio unbinds together up front: their
+	 * teardown proceeds in the kernel while the leaf modules are being
+	 * removed, instead of serializing one settle time after the other. */
 	kick_fbcon(false);
 
 	if (igt_kmod_is_loaded("snd_hda_intel")) {
 		igt_terminate_process(SIGTERM, "alsactl");
-
-		/* unbind snd_hda_intel */
 		kick_snd_hda_intel();
-
-		if (igt_kmod_unload("snd_hda_intel", 0)) {
-			igt_warn("Could not unload snd_hda_intel\n");
-			igt_kmod_list_loaded();
-			igt_lsof("/dev/snd");
-			return IGT_EXIT_FAILURE;
-		}
 	}
 
-	/* gen5 */
-	if (igt_kmod_is_loaded("intel_ips"))
-		igt_kmod_unload("intel_ips", 0);
+	drm_forget_cached_devices();
+	igt_dev_forget_topology();
 
-	if (igt_kmod_is_loaded("i915")) {
-		if (igt_kmod_unload("i915", 0)) {
-			igt_warn("Could not unload i915\n");
+	for (i = 0; i < ARRAY_SIZE(i915_unload_steps); i++) {
+		const struct i915_unload_step *step = &i915_unload_steps[i];
+
+		if (!igt_kmod_is_loaded(step->name))
+			continue;
+
+		if (kmod_unload_poll(step->name, 0, step->timeout_ms) &&
+		    step->fail_exit) {
+			igt_warn("Could not unload %s\n", step->name);
 			igt_kmod_list_loaded();
-			igt_lsof("/dev/dri");
-			return IGT_EXIT_SKIP;
+			if (step->lsof_path)
+				igt_lsof(step->lsof_path);
+			return step->fail_exit;
 		}
 	}
 
-	if (igt_kmod_is_loaded("intel-gtt"))
-		igt_kmod_unload("intel-gtt", 0);
-
-	igt_kmod_unload("drm_kms_helper", 0);
-	igt_kmod_unload("drm", 0);
-
 	if (igt_kmod_is_loaded("i915")) {
 		igt_warn("i915.ko still loaded!\n");
 		return IGT_EXIT_FAILURE;
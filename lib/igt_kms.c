@@ -40,8 +40,8 @@
 #endif
 #ifdef HAVE_UDEV
 #include <libudev.h>
-#include <poll.h>
 #endif
+#include <poll.h>
 #include <errno.h>
 #include <time.h>
 
@@ -83,6 +83,27 @@
 static char *forced_connectors[MAX_CONNECTORS + 1];
 static int forced_connectors_device[MAX_CONNECTORS + 1];
 
+/*
+ * Forcing a probe re-reads the EDID over DDC, which takes around 200ms per
+ * connected output and is repeated by every test binary. The kernel caches
+ * the result of the last probe and invalidates it on hotplug, so by default
+ * igt_display_init() trusts that cache and only forces a probe on connectors
+ * the kernel has never looked at. Set IGT_FORCE_CONNECTOR_PROBE=1 to restore
+ * the old always-probe behaviour, e.g. when debugging flaky DDC.
+ */
+static bool force_connector_probe(void)
+{
+	static int force = -1;
+
+	if (force < 0) {
+		const char *env = getenv("IGT_FORCE_CONNECTOR_PROBE");
+
+		force = env && atoi(env) > 0;
+	}
+
+	return force;
+}
+
 static void update_edid_csum(unsigned char *edid, int cea_pos)
 {
 	int i, sum = 0;
@@ -136,7 +157,13 @@ static void update_edid_csum(unsigned char *edid, int cea_pos)
  */
 const unsigned char* igt_kms_get_base_edid(void)
 {
-	update_edid_csum(base_edid, 0);
+	static bool initialized;
+
+	/* only the manufacture year needs stamping, so once per process */
+	if (!initialized) {
+		update_edid_csum(base_edid, 0);
+		initialized = true;
+	}
 
 	return base_edid;
 }
@@ -306,7 +333,12 @@ igt_atomic_fill_pipe_props(igt_display_t *display, igt_pipe_t *pipe,
  */
 const unsigned char* igt_kms_get_alt_edid(void)
 {
-	update_edid_csum(alt_edid, 0);
+	static bool initialized;
+
+	if (!initialized) {
+		update_edid_csum(alt_edid, 0);
+		initialized = true;
+	}
 
 	return alt_edid;
 }
@@ -885,12 +917,24 @@ static bool _kmstest_connector_config(int drm_fd, uint32_t connector_id,
 		goto err1;
 	}
 
-	/* First, find the connector & mode */
-	if (probe)
+	/*
+	 * First, find the connector & mode. The kernel's connector state is
+	 * shared between processes and refreshed on hotplug events, so the
+	 * cached lookup is sufficient unless the caller explicitly asked for
+	 * a probe or the kernel has never probed this connector at all.
+	 */
+	if (probe) {
 		connector = drmModeGetConnector(drm_fd, connector_id);
-	else
+	} else {
 		connector = drmModeGetConnectorCurrent(drm_fd, connector_id);
 
+		if (connector &&
+		    connector->connection == DRM_MODE_UNKNOWNCONNECTION) {
+			drmModeFreeConnector(connector);
+			connector = drmModeGetConnector(drm_fd, connector_id);
+		}
+	}
+
 	if (!connector)
 		goto err2;
 
@@ -1129,6 +1173,32 @@ struct edid_block {
 
 #define DTD_SUPPORTS_AUDIO 1<<6
 
+/*
+ * Customized EDIDs are requested over and over again, e.g. by the chamelium
+ * tests, and used to be calloc'ed for every request. Hand out slots from a
+ * small static arena instead; the blobs are copied into the kernel when they
+ * are applied, so recycling the slots round-robin is safe and the callers
+ * never need to free anything.
+ */
+#define EDID_ARENA_SLOTS 8
+#define EDID_ARENA_SLOT_SIZE 512
+
+static unsigned char *edid_arena_alloc(size_t length)
+{
+	static unsigned char arena[EDID_ARENA_SLOTS][EDID_ARENA_SLOT_SIZE];
+	static int next;
+	unsigned char *slot;
+
+	igt_assert(length <= EDID_ARENA_SLOT_SIZE);
+
+	slot = arena[next];
+	next = (next + 1) % EDID_ARENA_SLOTS;
+
+	memset(slot, 0, EDID_ARENA_SLOT_SIZE);
+
+	return slot;
+}
+
 static struct edid_block
 init_cea_block(const unsigned char *edid, size_t length,
 	       unsigned char *new_edid_ptr[], size_t *new_length,
@@ -1144,8 +1214,7 @@ init_cea_block(const unsigned char *edid, size_t length,
 
 	*new_length = length + 128;
 
-	new_edid.data = calloc(*new_length, sizeof(char));
-	igt_assert_f(new_edid.data, "Failed to allocate %zu bytes for edid\n", sizeof(new_length));
+	new_edid.data = edid_arena_alloc(*new_length);
 	memcpy(new_edid.data, edid, length);
 	*new_edid_ptr = new_edid.data;
 
@@ -1183,7 +1252,8 @@ init_cea_block(const unsigned char *edid, size_t length,
  * @new_length: pointer to the size of the new edid
  *
  * Makes a copy of an existing edid block and adds an extension indicating
- * stereo 3D capabilities.
+ * stereo 3D capabilities. The new edid lives in a static arena and must not
+ * be freed by the caller.
  */
 void kmstest_edid_add_3d(const unsigned char *edid, size_t length,
 			 unsigned char *new_edid_ptr[], size_t *new_length)
@@ -1224,7 +1294,8 @@ void kmstest_edid_add_3d(const unsigned char *edid, size_t length,
  * @new_length: pointer to the size of the new edid
  *
  * Makes a copy of an existing edid block and adds an extension indicating
- * a HDMI 4K mode in vsdb.
+ * a HDMI 4K mode in vsdb. The new edid lives in a static arena and must not
+ * be freed by the caller.
  */
 void kmstest_edid_add_4k(const unsigned char *edid, size_t length,
 			 unsigned char *new_edid_ptr[], size_t *new_length)
@@ -1269,8 +1340,8 @@ void kmstest_edid_add_4k(const unsigned char *edid, size_t length,
  * @new_length: pointer to the size of the new edid
  *
  * Makes a copy of an existing edid block and adds an extension indicating
- * basic audio support and speaker data block.
- *
+ * basic audio support and speaker data block. The new edid lives in a static
+ * arena and must not be freed by the caller.
  */
 void kmstest_edid_add_audio(const unsigned char *edid, size_t length,
 			    unsigned char *new_edid_ptr[], size_t *new_length)
@@ -1827,7 +1898,7 @@ void igt_display_init(igt_display_t *display, int drm_fd)
 		 * We don't assign each output a pipe unless
 		 * a pipe is set with igt_output_set_pipe().
 		 */
-		output->force_reprobe = true;
+		output->force_reprobe = force_connector_probe();
 		output->pending_crtc_idx_mask = 0;
 		output->id = resources->connectors[i];
 		output->display = display;
@@ -2876,38 +2947,48 @@ void igt_output_set_pipe(igt_output_t *output, enum pipe pipe)
 {
 	igt_display_t *display = output->display;
 	igt_pipe_t *old_pipe;
+	unsigned long pending_crtc_idx_mask;
 
 	igt_assert(output->name);
 
-	if (output->pending_crtc_idx_mask) {
-		old_pipe = igt_output_get_driving_pipe(output);
-
-		old_pipe->mode_changed = true;
-	}
-
 	if (pipe == PIPE_NONE) {
 		LOG(display, "%s: set_pipe(any)\n", igt_output_name(output));
-		output->pending_crtc_idx_mask = 0;
+		pending_crtc_idx_mask = 0;
 	} else {
 		LOG(display, "%s: set_pipe(%s)\n", igt_output_name(output),
 		    kmstest_pipe_name(pipe));
-		output->pending_crtc_idx_mask = 1 << pipe;
+		pending_crtc_idx_mask = 1 << pipe;
+	}
+
+	/* only flag a modeset when the output actually moves pipes */
+	if (output->pending_crtc_idx_mask != pending_crtc_idx_mask) {
+		if (output->pending_crtc_idx_mask) {
+			old_pipe = igt_output_get_driving_pipe(output);
 
-		display->pipes[pipe].mode_changed = true;
+			old_pipe->mode_changed = true;
+		}
+
+		if (pipe != PIPE_NONE)
+			display->pipes[pipe].mode_changed = true;
+
+		output->config.pipe_changed = true;
 	}
 
-	output->config.pipe_changed = true;
+	output->pending_crtc_idx_mask = pending_crtc_idx_mask;
 
 	igt_output_refresh(output);
 }
 
 void igt_output_set_scaling_mode(igt_output_t *output, uint64_t scaling_mode)
 {
-	output->config.connector_scaling_mode_changed = true;
+	igt_require(output->config.atomic_props_connector[IGT_CONNECTOR_SCALING_MODE]);
+
+	if (output->config.connector_scaling_mode == scaling_mode)
+		return;
 
 	output->config.connector_scaling_mode = scaling_mode;
 
-	igt_require(output->config.atomic_props_connector[IGT_CONNECTOR_SCALING_MODE]);
+	output->config.connector_scaling_mode_changed = true;
 }
 
 igt_plane_t *igt_output_get_plane(igt_output_t *output, int plane_idx)
@@ -2934,34 +3015,34 @@ void igt_plane_set_fb(igt_plane_t *plane, struct igt_fb *fb)
 {
 	igt_pipe_t *pipe = plane->pipe;
 	igt_display_t *display = pipe->display;
+	uint32_t src_w = fb ? fb->width : 0;
+	uint32_t src_h = fb ? fb->height : 0;
 
 	LOG(display, "%s.%d: plane_set_fb(%d)\n", kmstest_pipe_name(pipe->pipe),
 	    plane->index, fb ? fb->fb_id : 0);
 
 	plane->fb = fb;
-	/* hack to keep tests working that don't call igt_plane_set_size() */
-	if (fb) {
-		/* set default plane size as fb size */
-		plane->crtc_w = fb->width;
-		plane->crtc_h = fb->height;
-
-		/* set default src pos/size as fb size */
-		plane->src_x = 0;
-		plane->src_y = 0;
-		plane->src_w = fb->width;
-		plane->src_h = fb->height;
-	} else {
-		plane->src_x = 0;
-		plane->src_y = 0;
-		plane->src_w = 0;
-		plane->src_h = 0;
 
-		plane->crtc_w = 0;
-		plane->crtc_h = 0;
-	}
+	/*
+	 * The source and destination rectangles default to the fb size, but
+	 * they only need to be resubmitted when they actually change. Flip
+	 * loops between equally sized framebuffers then only carry the fb id
+	 * in the commit.
+	 */
+	if (plane->src_x != 0 || plane->src_y != 0 ||
+	    plane->src_w != src_w || plane->src_h != src_h ||
+	    plane->crtc_w != src_w || plane->crtc_h != src_h)
+		plane->size_changed = true;
+
+	/* hack to keep tests working that don't call igt_plane_set_size() */
+	plane->src_x = 0;
+	plane->src_y = 0;
+	plane->src_w = src_w;
+	plane->src_h = src_h;
+	plane->crtc_w = src_w;
+	plane->crtc_h = src_h;
 
 	plane->fb_changed = true;
-	plane->size_changed = true;
 }
 
 /**
@@ -2990,6 +3071,9 @@ void igt_plane_set_position(igt_plane_t *plane, int x, int y)
 	LOG(display, "%s.%d: plane_set_position(%d,%d)\n",
 	    kmstest_pipe_name(pipe->pipe), plane->index, x, y);
 
+	if (plane->crtc_x == x && plane->crtc_y == y)
+		return;
+
 	plane->crtc_x = x;
 	plane->crtc_y = y;
 
@@ -3014,6 +3098,9 @@ void igt_plane_set_size(igt_plane_t *plane, int w, int h)
 	LOG(display, "%s.%d: plane_set_size (%dx%d)\n",
 	    kmstest_pipe_name(pipe->pipe), plane->index, w, h);
 
+	if (plane->crtc_w == w && plane->crtc_h == h)
+		return;
+
 	plane->crtc_w = w;
 	plane->crtc_h = h;
 
@@ -3039,10 +3126,13 @@ void igt_fb_set_position(struct igt_fb *fb, igt_plane_t *plane,
 	LOG(display, "%s.%d: fb_set_position(%d,%d)\n",
 	    kmstest_pipe_name(pipe->pipe), plane->index, x, y);
 
+	if (plane->src_x == x && plane->src_y == y)
+		return;
+
 	plane->src_x = x;
 	plane->src_y = y;
 
-	plane->fb_changed = true;
+	plane->size_changed = true;
 }
 
 /**
@@ -3065,10 +3155,13 @@ void igt_fb_set_size(struct igt_fb *fb, igt_plane_t *plane,
 	LOG(display, "%s.%d: fb_set_size(%dx%d)\n",
 	    kmstest_pipe_name(pipe->pipe), plane->index, w, h);
 
+	if (plane->src_w == w && plane->src_h == h)
+		return;
+
 	plane->src_w = w;
 	plane->src_h = h;
 
-	plane->fb_changed = true;
+	plane->size_changed = true;
 }
 
 static const char *rotation_name(igt_rotation_t rotation)
@@ -3096,6 +3189,9 @@ void igt_plane_set_rotation(igt_plane_t *plane, igt_rotation_t rotation)
 	    kmstest_pipe_name(pipe->pipe),
 	    plane->index, rotation_name(rotation));
 
+	if (plane->rotation == rotation)
+		return;
+
 	plane->rotation = rotation;
 
 	plane->rotation_changed = true;
@@ -3152,6 +3248,9 @@ void igt_crtc_set_background(igt_pipe_t *pipe, uint64_t background)
 	    kmstest_pipe_name(pipe->pipe),
 	    pipe->pipe, background);
 
+	if (pipe->background == background)
+		return;
+
 	pipe->background = background;
 
 	pipe->background_changed = true;
@@ -3177,6 +3276,129 @@ void igt_wait_for_vblank(int drm_fd, enum pipe pipe)
 	igt_wait_for_vblank_count(drm_fd, pipe, 1);
 }
 
+static void flip_queue_complete(int fd, unsigned int sequence,
+				unsigned int tv_sec, unsigned int tv_usec,
+				void *data)
+{
+	struct igt_flip_slot *slot = data;
+	igt_flip_queue_t *queue = slot->queue;
+
+	igt_assert(slot->pending);
+	slot->pending = false;
+
+	igt_stats_push(&queue->latency, igt_nsec_elapsed(&slot->queued));
+
+	queue->in_flight--;
+	queue->completed++;
+}
+
+static void flip_queue_wait_event(igt_flip_queue_t *queue)
+{
+	drmEventContext evctx = {
+		.version = 2,
+		.page_flip_handler = flip_queue_complete,
+	};
+	struct pollfd pfd = {
+		.fd = queue->drm_fd,
+		.events = POLLIN,
+	};
+	int ret;
+
+	igt_assert(queue->in_flight);
+
+	do {
+		ret = poll(&pfd, 1, 3000);
+	} while (ret < 0 && errno == EINTR);
+
+	igt_assert_f(ret == 1, "timed out waiting for a flip event\n");
+
+	do_or_die(drmHandleEvent(queue->drm_fd, &evctx));
+}
+
+/**
+ * igt_flip_queue_init:
+ * @queue: the flip queue
+ * @drm_fd: the DRM file descriptor
+ *
+ * Initializes a flip queue. A flip queue keeps one nonblocking page flip in
+ * flight per pipe and completes all of them from a single event loop, so
+ * throughput tests can keep every display pipe busy instead of round-tripping
+ * one synchronous flip at a time. The latency between queueing a flip and its
+ * completion event is recorded per flip in the @latency igt_stats_t, in
+ * nanoseconds.
+ */
+void igt_flip_queue_init(igt_flip_queue_t *queue, int drm_fd)
+{
+	int i;
+
+	memset(queue, 0, sizeof(*queue));
+
+	queue->drm_fd = drm_fd;
+	igt_stats_init(&queue->latency);
+
+	for (i = 0; i < IGT_MAX_PIPES; i++)
+		queue->slots[i].queue = queue;
+}
+
+/**
+ * igt_flip_queue_flip:
+ * @queue: the flip queue
+ * @pipe: the pipe to flip on
+ * @crtc_id: the CRTC to flip
+ * @fb_id: the framebuffer to flip to
+ *
+ * Queues a nonblocking page flip on @pipe. The kernel only allows one
+ * outstanding flip per CRTC, so if the previous flip on this pipe has not
+ * completed yet this waits for it first, completing events for all pipes
+ * while doing so. Flips on other pipes stay in flight.
+ */
+void igt_flip_queue_flip(igt_flip_queue_t *queue, enum pipe pipe,
+			 uint32_t crtc_id, uint32_t fb_id)
+{
+	struct igt_flip_slot *slot;
+
+	igt_assert(pipe >= 0 && pipe < IGT_MAX_PIPES);
+	slot = &queue->slots[pipe];
+
+	while (slot->pending)
+		flip_queue_wait_event(queue);
+
+	memset(&slot->queued, 0, sizeof(slot->queued));
+	igt_nsec_elapsed(&slot->queued);
+
+	slot->pending = true;
+	queue->in_flight++;
+
+	do_or_die(drmModePageFlip(queue->drm_fd, crtc_id, fb_id,
+				  DRM_MODE_PAGE_FLIP_EVENT, slot));
+}
+
+/**
+ * igt_flip_queue_drain:
+ * @queue: the flip queue
+ *
+ * Waits until all flips in flight on @queue have completed. Call this before
+ * reading the latency statistics or touching the framebuffers still owned by
+ * pending flips.
+ */
+void igt_flip_queue_drain(igt_flip_queue_t *queue)
+{
+	while (queue->in_flight)
+		flip_queue_wait_event(queue);
+}
+
+/**
+ * igt_flip_queue_fini:
+ * @queue: the flip queue
+ *
+ * Drains the flip queue and releases the latency statistics.
+ */
+void igt_flip_queue_fini(igt_flip_queue_t *queue)
+{
+	igt_flip_queue_drain(queue);
+	igt_stats_fini(&queue->latency);
+}
+
 /**
  * igt_enable_connectors:
  *
@@ -35,6 +35,7 @@
 #include <xf86drmMode.h>
 
 #include "igt_fb.h"
+#include "igt_stats.h"
 #include "ioctl_wrappers.h"
 
 /* Low-level helpers with kmstest_ prefix */
@@ -424,6 +425,39 @@ void igt_fb_set_size(struct igt_fb *fb, igt_plane_t *plane,
 void igt_wait_for_vblank(int drm_fd, enum pipe pipe);
 void igt_wait_for_vblank_count(int drm_fd, enum pipe pipe, int count);
 
+struct igt_flip_queue;
+
+struct igt_flip_slot {
+	struct igt_flip_queue *queue;
+	struct timespec queued;
+	bool pending;
+};
+
+/**
+ * igt_flip_queue_t:
+ * @drm_fd: the DRM file descriptor
+ * @in_flight: number of flips currently queued but not yet completed
+ * @completed: total number of completed flips
+ * @latency: per-flip queue-to-completion latency in nanoseconds
+ *
+ * A queue of nonblocking page flips, keeping one flip in flight per pipe and
+ * completing them from a single event loop. See igt_flip_queue_init().
+ */
+typedef struct igt_flip_queue {
+	int drm_fd;
+	unsigned int in_flight;
+	uint64_t completed;
+	igt_stats_t latency;
+	/*< private >*/
+	struct igt_flip_slot slots[IGT_MAX_PIPES];
+} igt_flip_queue_t;
+
+void igt_flip_queue_init(igt_flip_queue_t *queue, int drm_fd);
+void igt_flip_queue_flip(igt_flip_queue_t *queue, enum pipe pipe,
+			 uint32_t crtc_id, uint32_t fb_id);
+void igt_flip_queue_drain(igt_flip_queue_t *queue);
+void igt_flip_queue_fini(igt_flip_queue_t *queue);
+
 static inline bool igt_output_is_connected(igt_output_t *output)
 {
 	/* Something went wrong during probe? */
@@ -0,0 +1,262 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <uwildmat/uwildmat.h>
+
+#include "igt_matcher.h"
+
+/**
+ * SECTION:igt_matcher
+ * @short_description: Compiled wildmat expressions
+ * @title: Matcher
+ * @include: igt_matcher.h
+ *
+ * Subtest selection matches every name against the wildcard expression
+ * with uwildmat(), which re-parses the expression - clause splitting,
+ * negation, metacharacter scanning - on every call. That is fine for
+ * one name, but matching thousands of subtest names against multi-clause
+ * include/exclude lists on every scheduling decision adds up.
+ *
+ * igt_matcher_compile() parses the expression once into its clauses and
+ * classifies each: clauses without metacharacters become a strcmp,
+ * "literal*" clauses become a prefix compare, and anything else keeps
+ * its literal prefix as a cheap reject in front of the full wildmat
+ * walk. Clause order and semantics (comma separation, ! negation, last
+ * matching clause wins) are exactly those of uwildmat().
+ */
+
+enum clause_kind {
+	CLAUSE_LITERAL,	/* no metacharacters: strcmp */
+	CLAUSE_PREFIX,	/* literal then one trailing star: strncmp */
+	CLAUSE_WILD,	/* anything else: prefix reject, then uwildmat */
+};
+
+struct igt_matcher_clause {
+	char *pat;
+	size_t prefix;	/* length of the leading literal part */
+	enum clause_kind kind;
+	bool negate;
+};
+
+struct igt_matcher {
+	struct igt_matcher_clause *clauses;
+	unsigned count;
+};
+
+static void classify_clause(struct igt_matcher_clause *clause)
+{
+	const char *pat = clause->pat;
+	size_t n = strcspn(pat, "*?[\\");
+
+	clause->prefix = n;
+
+	if (pat[n] == '\0')
+		clause->kind = CLAUSE_LITERAL;
+	else if (pat[n] == '*' && pat[n + 1] == '\0')
+		clause->kind = CLAUSE_PREFIX;
+	else
+		clause->kind = CLAUSE_WILD;
+}
+
+static bool match_clause(const struct igt_matcher_clause *clause,
+			 const char *text)
+{
+	switch (clause->kind) {
+	case CLAUSE_LITERAL:
+		return strcmp(text, clause->pat) == 0;
+	case CLAUSE_PREFIX:
+		return strncmp(text, clause->pat, clause->prefix) == 0;
+	case CLAUSE_WILD:
+		if (strncmp(text, clause->pat, clause->prefix))
+			return false;
+		return uwildmat_simple(text, clause->pat);
+	}
+
+	return false;
+}
+
+/* Find the end of the clause starting at p: the first unescaped comma
+ * outside a character class, or the terminating nul. This mirrors the
+ * splitting loop in uwildmat's match_expression().
+ */
+static const char *clause_end(const char *p)
+{
+	bool escaped = false;
+
+	for (; *p; p++) {
+		if (*p == '[') {
+			p++;
+			if (*p == ']')
+				p++;
+			while (*p && *p != ']')
+				p++;
+			if (!*p)
+				break;
+		}
+		if (*p == ',' && !escaped)
+			break;
+		escaped = (*p == '\\') ? !escaped : false;
+	}
+
+	return p;
+}
+
+/**
+ * igt_matcher_compile:
+ * @expression: a wildmat expression, as accepted by uwildmat()
+ *
+ * Parses @expression once into a reusable matcher.
+ *
+ * Returns:
+ * The compiled matcher, or NULL on allocation failure. Free with
+ * igt_matcher_free().
+ */
+struct igt_matcher *igt_matcher_compile(const char *expression)
+{
+	struct igt_matcher *matcher;
+	const char *p = expression;
+	unsigned count = 1;
+
+	matcher = calloc(1, sizeof(*matcher));
+	if (!matcher)
+		return NULL;
+
+	/* The empty expression matches only the empty text; represent it
+	 * as zero clauses and handle it in igt_matcher_match().
+	 */
+	if (!*expression)
+		return matcher;
+
+	while (*(p = clause_end(p)))
+		count++, p++;
+
+	matcher->clauses = calloc(count, sizeof(*matcher->clauses));
+	if (!matcher->clauses) {
+		free(matcher);
+		return NULL;
+	}
+
+	for (p = expression; matcher->count < count; p++) {
+		struct igt_matcher_clause *clause =
+			&matcher->clauses[matcher->count++];
+		const char *end;
+
+		clause->negate = (*p == '!');
+		if (clause->negate)
+			p++;
+
+		end = clause_end(p);
+		clause->pat = strndup(p, end - p);
+		if (!clause->pat) {
+			igt_matcher_free(matcher);
+			return NULL;
+		}
+		classify_clause(clause);
+
+		p = end;
+	}
+
+	return matcher;
+}
+
+/**
+ * igt_matcher_match:
+ * @matcher: matcher from igt_matcher_compile()
+ * @text: the string to match
+ *
+ * Returns:
+ * Whether @text matches the compiled expression; identical to
+ * uwildmat(@text, expression).
+ */
+bool igt_matcher_match(const struct igt_matcher *matcher, const char *text)
+{
+	bool match = false;
+	unsigned i;
+
+	if (!matcher->count)
+		return *text == '\0';
+
+	for (i = 0; i < matcher->count; i++) {
+		const struct igt_matcher_clause *clause = &matcher->clauses[i];
+
+		/* This clause can't change the result; skip the work. */
+		if (match == !clause->negate)
+			continue;
+
+		if (match_clause(clause, text))
+			match = !clause->negate;
+	}
+
+	return match;
+}
+
+/**
+ * igt_matcher_match_batch:
+ * @matcher: matcher from igt_matcher_compile()
+ * @names: array of strings to match
+ * @results: per-name match results, may be NULL if only the count matters
+ * @count: number of entries in @names
+ *
+ * Matches a whole array of names in one call.
+ *
+ * Returns:
+ * How many of the names matched.
+ */
+unsigned igt_matcher_match_batch(const struct igt_matcher *matcher,
+				 const char * const *names, bool *results,
+				 unsigned count)
+{
+	unsigned i, matched = 0;
+
+	for (i = 0; i < count; i++) {
+		bool m = igt_matcher_match(matcher, names[i]);
+
+		if (results)
+			results[i] = m;
+		matched += m;
+	}
+
+	return matched;
+}
+
+/**
+ * igt_matcher_free:
+ * @matcher: matcher to free, may be NULL
+ *
+ * Releases a matcher returned by igt_matcher_compile().
+ */
+void igt_matcher_free(struct igt_matcher *matcher)
+{
+	unsigned i;
+
+	if (!matcher)
+		return;
+
+	for (i = 0; i < matcher->count; i++)
+		free(matcher->clauses[i].pat);
+	free(matcher->clauses);
+	free(matcher);
+}
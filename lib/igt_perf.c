@@ -0,0 +1,371 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+
+#include "igt_perf.h"
+
+/**
+ * SECTION:igt_perf
+ * @short_description: i915 perf PMU wrapper
+ * @title: perf
+ * @include: igt_perf.h
+ *
+ * The i915 PMU exposes counters (per-engine busy/wait/sema times, GT
+ * frequency, RC6 residency, interrupts, ...) through the kernel perf
+ * interface. This library wraps the event enumeration and the
+ * perf_event_open() plumbing so that tests and tools do not each have
+ * to reinvent them, and provides counter groups: all events of a group
+ * are read atomically with a single read() of the group leader, so a
+ * sample is one syscall however many counters it covers, and the
+ * counters within it are mutually consistent.
+ *
+ * Counters are sampled by delta: call igt_perf_group_sample() at each
+ * observation point, then igt_perf_group_delta() returns how much each
+ * counter advanced since the previous sample, with the elapsed time
+ * over the same interval from igt_perf_group_elapsed().
+ */
+
+#define I915_PMU_SYSFS "/sys/bus/event_source/devices/i915"
+
+static int
+perf_event_open(struct perf_event_attr *attr,
+		pid_t pid, int cpu, int group_fd, unsigned long flags)
+{
+#ifndef __NR_perf_event_open
+#if defined(__i386__)
+#define __NR_perf_event_open 336
+#elif defined(__x86_64__)
+#define __NR_perf_event_open 298
+#else
+#define __NR_perf_event_open 0
+#endif
+#endif
+	attr->size = sizeof(*attr);
+	return syscall(__NR_perf_event_open, attr, pid, cpu, group_fd, flags);
+}
+
+/**
+ * igt_perf_type_id:
+ *
+ * Returns: the dynamic perf event type of the i915 PMU, or 0 if the
+ * running kernel does not expose one.
+ */
+uint64_t igt_perf_type_id(void)
+{
+	char buf[64];
+	ssize_t ret;
+	int fd;
+
+	fd = open(I915_PMU_SYSFS "/type", O_RDONLY);
+	if (fd < 0)
+		return 0;
+
+	ret = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (ret < 1)
+		return 0;
+
+	buf[ret] = '\0';
+	return strtoull(buf, NULL, 0);
+}
+
+/**
+ * igt_perf_open:
+ * @config: the i915 PMU counter to open
+ * @group_fd: group leader fd, or -1 to start a new group
+ *
+ * Opens a single i915 PMU counter. Passing -1 for @group_fd makes the
+ * counter a group leader whose read() returns all group members in one
+ * atomic sample; pass the leader's fd to add further counters to it.
+ *
+ * Returns: the event fd, or -1 with errno set on failure.
+ */
+int igt_perf_open(uint64_t config, int group_fd)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+
+	attr.type = igt_perf_type_id();
+	if (attr.type == 0) {
+		errno = ENOENT;
+		return -1;
+	}
+	attr.config = config;
+
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED;
+	if (group_fd == -1)
+		attr.read_format |= PERF_FORMAT_GROUP;
+
+	return perf_event_open(&attr, -1, 0, group_fd, 0);
+}
+
+/**
+ * igt_perf_event_config:
+ * @event: name of the event, as listed under
+ *	   /sys/bus/event_source/devices/i915/events/
+ * @config: pointer to receive the counter config
+ *
+ * Resolves an event name to its config value through sysfs, so callers
+ * are insulated from the kernel's config encoding.
+ *
+ * Returns: 0 on success, -1 with errno set if the event is unknown.
+ */
+int igt_perf_event_config(const char *event, uint64_t *config)
+{
+	char buf[256];
+	char *s;
+	ssize_t ret;
+	int fd;
+
+	snprintf(buf, sizeof(buf), I915_PMU_SYSFS "/events/%s", event);
+	fd = open(buf, O_RDONLY);
+	if (fd < 0)
+		return -1;
+
+	ret = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (ret < 1) {
+		errno = EINVAL;
+		return -1;
+	}
+	buf[ret] = '\0';
+
+	s = strstr(buf, "config=");
+	if (s)
+		s += strlen("config=");
+	else if ((s = strstr(buf, "event=")))
+		s += strlen("event=");
+	else {
+		errno = EINVAL;
+		return -1;
+	}
+
+	*config = strtoull(s, NULL, 0);
+	return 0;
+}
+
+/**
+ * igt_perf_enumerate:
+ * @names: pointer to receive the allocated array of event names
+ *
+ * Lists the counters the running kernel's i915 PMU exposes, sorted
+ * alphabetically. The array and each name are malloced; the caller
+ * frees them.
+ *
+ * Returns: the number of events, or -1 with errno set on failure.
+ */
+int igt_perf_enumerate(char ***names)
+{
+	struct dirent **entries;
+	char **events;
+	int num, count;
+
+	num = scandir(I915_PMU_SYSFS "/events", &entries, NULL, alphasort);
+	if (num < 0)
+		return -1;
+
+	events = malloc(num * sizeof(*events));
+	count = 0;
+	for (int n = 0; n < num; n++) {
+		/* skip ".", ".." and the foo.unit/foo.scale annotations */
+		if (!strchr(entries[n]->d_name, '.'))
+			events[count++] = strdup(entries[n]->d_name);
+		free(entries[n]);
+	}
+	free(entries);
+
+	*names = events;
+	return count;
+}
+
+/**
+ * igt_perf_group_new:
+ *
+ * Allocates an empty counter group.
+ *
+ * Returns: the new group, to be filled with igt_perf_group_add().
+ */
+struct igt_perf_group *igt_perf_group_new(void)
+{
+	struct igt_perf_group *group;
+
+	group = calloc(1, sizeof(*group));
+	if (group)
+		group->fd = -1;
+
+	return group;
+}
+
+/**
+ * igt_perf_group_add_config:
+ * @group: the counter group
+ * @name: label for the counter, kept for the caller's convenience
+ * @config: the i915 PMU counter to open
+ *
+ * Adds a counter to the group by raw config value. The first counter
+ * added becomes the group leader.
+ *
+ * Returns: the index of the counter within the group (for use with
+ * igt_perf_group_delta()), or -1 with errno set on failure.
+ */
+int igt_perf_group_add_config(struct igt_perf_group *group,
+			      const char *name, uint64_t config)
+{
+	struct igt_perf_event *events;
+	int fd;
+
+	fd = igt_perf_open(config, group->fd);
+	if (fd < 0)
+		return -1;
+
+	events = realloc(group->events,
+			 (group->num_events + 1) * sizeof(*events));
+	if (!events) {
+		close(fd);
+		errno = ENOMEM;
+		return -1;
+	}
+	group->events = events;
+
+	if (group->fd == -1)
+		group->fd = fd;
+
+	events[group->num_events].name = strdup(name);
+	events[group->num_events].config = config;
+	events[group->num_events].fd = fd;
+	memset(events[group->num_events].sample, 0,
+	       sizeof(events[group->num_events].sample));
+
+	return group->num_events++;
+}
+
+/**
+ * igt_perf_group_add:
+ * @group: the counter group
+ * @event: name of the event, as reported by igt_perf_enumerate()
+ *
+ * Adds a counter to the group by event name.
+ *
+ * Returns: the index of the counter within the group, or -1 with errno
+ * set on failure.
+ */
+int igt_perf_group_add(struct igt_perf_group *group, const char *event)
+{
+	uint64_t config;
+
+	if (igt_perf_event_config(event, &config))
+		return -1;
+
+	return igt_perf_group_add_config(group, event, config);
+}
+
+/**
+ * igt_perf_group_sample:
+ * @group: the counter group
+ *
+ * Takes one atomic sample of every counter in the group, with a single
+ * read() of the group leader.
+ *
+ * Returns: 0 on success, -1 with errno set on failure.
+ */
+int igt_perf_group_sample(struct igt_perf_group *group)
+{
+	uint64_t data[2 + group->num_events], *sample;
+	int idx = group->num_samples & 1;
+	ssize_t len;
+
+	len = read(group->fd, data, sizeof(data));
+	if (len < 0)
+		return -1;
+
+	/* data: { nr, time_enabled, value[nr] } */
+	sample = data + 1;
+	group->time[idx] = *sample++;
+	for (int n = 0; n < group->num_events; n++)
+		group->events[n].sample[idx] = sample[n];
+
+	group->num_samples++;
+	return 0;
+}
+
+/**
+ * igt_perf_group_delta:
+ * @group: the counter group
+ * @event: index of the counter, as returned by igt_perf_group_add()
+ *
+ * Returns: how much the counter advanced between the last two samples,
+ * or 0 before two samples have been taken.
+ */
+uint64_t igt_perf_group_delta(const struct igt_perf_group *group, int event)
+{
+	const struct igt_perf_event *e = &group->events[event];
+
+	if (group->num_samples < 2)
+		return 0;
+
+	return e->sample[(group->num_samples - 1) & 1] -
+	       e->sample[group->num_samples & 1];
+}
+
+/**
+ * igt_perf_group_elapsed:
+ * @group: the counter group
+ *
+ * Returns: the time in nanoseconds the counters were enabled between
+ * the last two samples, the natural denominator for the deltas, or 0
+ * before two samples have been taken.
+ */
+uint64_t igt_perf_group_elapsed(const struct igt_perf_group *group)
+{
+	if (group->num_samples < 2)
+		return 0;
+
+	return group->time[(group->num_samples - 1) & 1] -
+	       group->time[group->num_samples & 1];
+}
+
+/**
+ * igt_perf_group_free:
+ * @group: the counter group
+ *
+ * Closes every counter in the group and releases it.
+ */
+void igt_perf_group_free(struct igt_perf_group *group)
+{
+	for (int n = 0; n < group->num_events; n++) {
+		close(group->events[n].fd);
+		free(group->events[n].name);
+	}
+	free(group->events);
+	free(group);
+}
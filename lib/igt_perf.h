@@ -0,0 +1,59 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef IGT_PERF_H
+#define IGT_PERF_H
+
+#include <stdint.h>
+
+struct igt_perf_event {
+	char *name;
+	uint64_t config;
+	int fd;
+	uint64_t sample[2];
+};
+
+struct igt_perf_group {
+	int fd;
+	int num_events;
+	int num_samples;
+	uint64_t time[2];
+	struct igt_perf_event *events;
+};
+
+uint64_t igt_perf_type_id(void);
+int igt_perf_open(uint64_t config, int group_fd);
+
+int igt_perf_event_config(const char *event, uint64_t *config);
+int igt_perf_enumerate(char ***names);
+
+struct igt_perf_group *igt_perf_group_new(void);
+int igt_perf_group_add(struct igt_perf_group *group, const char *event);
+int igt_perf_group_add_config(struct igt_perf_group *group,
+			      const char *name, uint64_t config);
+int igt_perf_group_sample(struct igt_perf_group *group);
+uint64_t igt_perf_group_delta(const struct igt_perf_group *group, int event);
+uint64_t igt_perf_group_elapsed(const struct igt_perf_group *group);
+void igt_perf_group_free(struct igt_perf_group *group);
+
+#endif /* IGT_PERF_H */
@@ -0,0 +1,367 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "igt_core.h"
+#include "igt_perf_oa.h"
+
+/**
+ * SECTION:igt_perf_oa
+ * @short_description: i915-perf OA stream consumer
+ * @title: Perf OA
+ * @include: igt.h
+ *
+ * Helpers for consuming an i915-perf OA metrics stream. The report format
+ * layout tables in #igt_oa_formats describe where each counter class lives
+ * within a report, and #igt_oa_reader_t parses the stream zero-copy: records
+ * are returned by reference into the reader's buffer instead of being copied
+ * out one by one, which matters at high sampling frequencies where the
+ * kernel can deliver hundreds of thousands of reports per second.
+ *
+ * On top of the raw record iterator, igt_oa_subscribe() and
+ * igt_oa_reader_read_deltas() provide a subscription interface delivering
+ * the delta of selected counters between consecutive sample reports.
+ */
+
+/* The largest buffer the OA unit supports is 16MB, so with the smallest
+ * report format a single read() can return at most this many records. Sizing
+ * the reader's buffer for the worst case means each refill can scrape all
+ * pending records in one go.
+ */
+#define MAX_OA_BUFFER_SIZE (16 * 1024 * 1024)
+
+#define MAX_OA_SUBSCRIPTIONS 64
+
+const struct igt_oa_format igt_oa_formats[I915_OA_FORMAT_MAX] = {
+	[I915_OA_FORMAT_A13] = {
+		"A13", .size = 64,
+		.a_off = 12, .n_a = 13 },
+	[I915_OA_FORMAT_A29] = {
+		"A29", .size = 128,
+		.a_off = 12, .n_a = 29 },
+	[I915_OA_FORMAT_A13_B8_C8] = {
+		"A13_B8_C8", .size = 128,
+		.a_off = 12, .n_a = 13,
+		.b_off = 64, .n_b = 8,
+		.c_off = 96, .n_c = 8 },
+	[I915_OA_FORMAT_A45_B8_C8] = {
+		"A45_B8_C8", .size = 256,
+		.a_off = 12,  .n_a = 45,
+		.b_off = 192, .n_b = 8,
+		.c_off = 224, .n_c = 8 },
+	[I915_OA_FORMAT_B4_C8] = {
+		"B4_C8", .size = 64,
+		.b_off = 16, .n_b = 4,
+		.c_off = 32, .n_c = 8 },
+	[I915_OA_FORMAT_B4_C8_A16] = {
+		"B4_C8_A16", .size = 128,
+		.b_off = 16, .n_b = 4,
+		.c_off = 32, .n_c = 8,
+		.a_off = 60, .n_a = 16, .first_a = 29 },
+	[I915_OA_FORMAT_C4_B8] = {
+		"C4_B8", .size = 64,
+		.c_off = 16, .n_c = 4,
+		.b_off = 28, .n_b = 8 },
+};
+
+struct _igt_oa_reader {
+	int stream_fd;
+	int format_id;
+	const struct igt_oa_format *format;
+
+	uint8_t *buf;
+	size_t buf_size;
+	size_t len;    /* valid bytes in buf */
+	size_t offset; /* parse cursor within buf */
+
+	struct {
+		enum igt_oa_counter_class counter_class;
+		int index;
+	} subs[MAX_OA_SUBSCRIPTIONS];
+	int n_subs;
+
+	/* Previous sample report, needed to carry delta computation across a
+	 * buffer refill. This is the only per-refill copy the reader makes.
+	 */
+	bool have_last;
+	uint32_t last[256 / sizeof(uint32_t)];
+};
+
+/**
+ * igt_oa_format_info:
+ * @format_id: one of the uapi I915_OA_FORMAT values
+ *
+ * Returns: The layout description of the given report format.
+ */
+const struct igt_oa_format *igt_oa_format_info(int format_id)
+{
+	igt_assert(format_id > 0 && format_id < I915_OA_FORMAT_MAX);
+	igt_assert(igt_oa_formats[format_id].name);
+
+	return &igt_oa_formats[format_id];
+}
+
+/**
+ * igt_oa_reader_new:
+ * @stream_fd: fd of an opened i915-perf stream sampling OA reports
+ * @format_id: the OA report format the stream was opened with
+ *
+ * Creates a reader for @stream_fd. The reader's buffer is sized so that a
+ * single refill can hold every report the OA unit can have buffered, which
+ * lets callers reliably discard a full batch when a report is lost.
+ *
+ * Returns: The new reader.
+ */
+igt_oa_reader_t *igt_oa_reader_new(int stream_fd, int format_id)
+{
+	igt_oa_reader_t *reader;
+
+	reader = calloc(1, sizeof(*reader));
+	igt_assert(reader);
+
+	reader->stream_fd = stream_fd;
+	reader->format_id = format_id;
+	reader->format = igt_oa_format_info(format_id);
+
+	reader->buf_size = (MAX_OA_BUFFER_SIZE / reader->format->size) *
+		(sizeof(struct drm_i915_perf_record_header) +
+		 reader->format->size);
+	reader->buf = malloc(reader->buf_size);
+	igt_assert(reader->buf);
+
+	return reader;
+}
+
+static bool oa_reader_refill(igt_oa_reader_t *reader)
+{
+	ssize_t len;
+
+	while ((len = read(reader->stream_fd, reader->buf,
+			   reader->buf_size)) < 0 && errno == EINTR)
+		;
+
+	if (len < 0) {
+		igt_assert_eq(errno, EAGAIN);
+		return false;
+	}
+
+	igt_assert(len > 0);
+
+	reader->len = len;
+	reader->offset = 0;
+
+	return true;
+}
+
+/**
+ * igt_oa_reader_next:
+ * @reader: OA stream reader
+ *
+ * Advances to the next record, refilling the buffer from the stream fd when
+ * the current batch is exhausted. The returned header (and the report behind
+ * it, see igt_oa_record_report()) points into the reader's buffer and stays
+ * valid until the next refill.
+ *
+ * Returns: The next record, or NULL if the stream is non-blocking and no
+ * data is available.
+ */
+const struct drm_i915_perf_record_header *
+igt_oa_reader_next(igt_oa_reader_t *reader)
+{
+	const struct drm_i915_perf_record_header *header;
+
+	if (reader->offset >= reader->len && !oa_reader_refill(reader))
+		return NULL;
+
+	header = (void *)(reader->buf + reader->offset);
+
+	igt_assert(header->size >= sizeof(*header));
+	igt_assert(reader->offset + header->size <= reader->len);
+
+	reader->offset += header->size;
+
+	return header;
+}
+
+/**
+ * igt_oa_reader_flush:
+ * @reader: OA stream reader
+ *
+ * Discards the remainder of the current batch, so the next
+ * igt_oa_reader_next() call reads fresh data from the stream. Useful after a
+ * _REPORT_LOST notification, when the position of the blip within the
+ * already-read records is unknown.
+ */
+void igt_oa_reader_flush(igt_oa_reader_t *reader)
+{
+	reader->offset = reader->len;
+	reader->have_last = false;
+}
+
+/**
+ * igt_oa_subscribe:
+ * @reader: OA stream reader
+ * @counter_class: which counter class to subscribe to
+ * @index: logical counter index within the class
+ *
+ * Subscribes to a counter, whose delta between consecutive sample reports
+ * will be delivered by igt_oa_reader_read_deltas(). The counter must exist
+ * in the reader's report format.
+ *
+ * Returns: The position of the counter in the callback's delta array.
+ */
+int igt_oa_subscribe(igt_oa_reader_t *reader,
+		     enum igt_oa_counter_class counter_class, int index)
+{
+	const struct igt_oa_format *format = reader->format;
+
+	switch (counter_class) {
+	case IGT_OA_COUNTER_A:
+		igt_assert(index >= format->first_a &&
+			   index < format->first_a + format->n_a);
+		break;
+	case IGT_OA_COUNTER_B:
+		igt_assert(index >= 0 && index < format->n_b);
+		break;
+	case IGT_OA_COUNTER_C:
+		igt_assert(index >= 0 && index < format->n_c);
+		break;
+	}
+
+	igt_assert(reader->n_subs < MAX_OA_SUBSCRIPTIONS);
+
+	reader->subs[reader->n_subs].counter_class = counter_class;
+	reader->subs[reader->n_subs].index = index;
+
+	return reader->n_subs++;
+}
+
+static uint32_t oa_counter_value(const igt_oa_reader_t *reader,
+				 const uint32_t *report, int sub)
+{
+	const struct igt_oa_format *format = reader->format;
+	int index = reader->subs[sub].index;
+	int off;
+
+	switch (reader->subs[sub].counter_class) {
+	case IGT_OA_COUNTER_A:
+		off = format->a_off + (index - format->first_a) * 4;
+		break;
+	case IGT_OA_COUNTER_B:
+		off = format->b_off + index * 4;
+		break;
+	case IGT_OA_COUNTER_C:
+		off = format->c_off + index * 4;
+		break;
+	default:
+		igt_assert(!"reached");
+	}
+
+	return *(const uint32_t *)((const uint8_t *)report + off);
+}
+
+/**
+ * igt_oa_reader_read_deltas:
+ * @reader: OA stream reader
+ * @fn: callback receiving the counter deltas
+ * @user_data: passed through to @fn
+ *
+ * Processes all records of one batch, invoking @fn with the subscribed
+ * counter deltas for each consecutive pair of sample reports. A lost report
+ * notification resets the pairing, since the blip makes the delta across it
+ * meaningless. Counter wraparound is handled by the 32bit arithmetic.
+ *
+ * Returns: The number of delta sets delivered, which may be zero if the
+ * stream is non-blocking and no data was available.
+ */
+int igt_oa_reader_read_deltas(igt_oa_reader_t *reader,
+			      igt_oa_delta_fn fn, void *user_data)
+{
+	const struct drm_i915_perf_record_header *header;
+	const uint32_t *last = reader->have_last ? reader->last : NULL;
+	uint32_t deltas[MAX_OA_SUBSCRIPTIONS];
+	int n = 0;
+
+	if (reader->offset >= reader->len && !oa_reader_refill(reader))
+		return 0;
+
+	while (reader->offset < reader->len) {
+		const uint32_t *report;
+
+		header = (void *)(reader->buf + reader->offset);
+
+		igt_assert(header->size >= sizeof(*header));
+		igt_assert(reader->offset + header->size <= reader->len);
+
+		reader->offset += header->size;
+
+		if (header->type != DRM_I915_PERF_RECORD_SAMPLE) {
+			igt_debug("OA reader: %s, restarting delta pairing\n",
+				  header->type == DRM_I915_PERF_RECORD_OA_REPORT_LOST ?
+				  "report lost" : "buffer lost");
+			last = NULL;
+			continue;
+		}
+
+		report = igt_oa_record_report(header);
+
+		if (last) {
+			for (int i = 0; i < reader->n_subs; i++)
+				deltas[i] = oa_counter_value(reader, report, i) -
+					oa_counter_value(reader, last, i);
+
+			fn(report[1] - last[1], deltas, reader->n_subs,
+			   user_data);
+			n++;
+		}
+
+		last = report;
+	}
+
+	/* Carry the final report across the refill boundary. */
+	if (last) {
+		memcpy(reader->last, last, reader->format->size);
+		reader->have_last = true;
+	} else {
+		reader->have_last = false;
+	}
+
+	return n;
+}
+
+/**
+ * igt_oa_reader_free:
+ * @reader: OA stream reader
+ *
+ * Frees the reader. The stream fd itself is owned by the caller and is left
+ * open.
+ */
+void igt_oa_reader_free(igt_oa_reader_t *reader)
+{
+	free(reader->buf);
+	free(reader);
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef IGT_PERF_OA_H
+#define IGT_PERF_OA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <i915_drm.h>
+
+/* Temporarily copy i915-perf uapi here to avoid a dependency on libdrm's
+ * i915_drm.h copy being updated with the i915-perf interface before the
+ * users of this library can land in i-g-t.
+ *
+ * TODO: remove this once the interface lands in libdrm
+ */
+#ifndef DRM_I915_PERF_OPEN
+#define DRM_I915_PERF_OPEN		0x36
+#define DRM_IOCTL_I915_PERF_OPEN	DRM_IOW(DRM_COMMAND_BASE + DRM_I915_PERF_OPEN, struct drm_i915_perf_open_param)
+
+enum drm_i915_oa_format {
+       I915_OA_FORMAT_A13 = 1,
+       I915_OA_FORMAT_A29,
+       I915_OA_FORMAT_A13_B8_C8,
+       I915_OA_FORMAT_B4_C8,
+       I915_OA_FORMAT_A45_B8_C8,
+       I915_OA_FORMAT_B4_C8_A16,
+       I915_OA_FORMAT_C4_B8,
+
+       I915_OA_FORMAT_MAX /* non-ABI */
+};
+
+enum drm_i915_perf_property_id {
+       DRM_I915_PERF_PROP_CTX_HANDLE = 1,
+       DRM_I915_PERF_PROP_SAMPLE_OA,
+       DRM_I915_PERF_PROP_OA_METRICS_SET,
+       DRM_I915_PERF_PROP_OA_FORMAT,
+       DRM_I915_PERF_PROP_OA_EXPONENT,
+
+       DRM_I915_PERF_PROP_MAX /* non-ABI */
+};
+
+struct drm_i915_perf_open_param {
+       __u32 flags;
+#define I915_PERF_FLAG_FD_CLOEXEC	(1<<0)
+#define I915_PERF_FLAG_FD_NONBLOCK	(1<<1)
+#define I915_PERF_FLAG_DISABLED		(1<<2)
+
+       __u32 num_properties;
+       __u64 properties_ptr;
+};
+
+#define I915_PERF_IOCTL_ENABLE _IO('i', 0x0)
+#define I915_PERF_IOCTL_DISABLE	_IO('i', 0x1)
+
+struct drm_i915_perf_record_header {
+       __u32 type;
+       __u16 pad;
+       __u16 size;
+};
+
+enum drm_i915_perf_record_type {
+       DRM_I915_PERF_RECORD_SAMPLE = 1,
+       DRM_I915_PERF_RECORD_OA_REPORT_LOST = 2,
+       DRM_I915_PERF_RECORD_OA_BUFFER_LOST = 3,
+
+       DRM_I915_PERF_RECORD_MAX /* non-ABI */
+};
+#endif /* !DRM_I915_PERF_OPEN */
+
+/**
+ * igt_oa_format:
+ * @name: human readable name matching the uapi enumerant
+ * @size: report size in bytes
+ * @a_off: byte offset of the first stored A counter
+ * @n_a: number of stored A counters
+ * @first_a: logical index of the first stored A counter
+ * @b_off: byte offset of the B counters
+ * @n_b: number of B counters
+ * @c_off: byte offset of the C counters
+ * @n_c: number of C counters
+ *
+ * Layout of one OA report format. Formats not supported by a given
+ * generation have a NULL @name.
+ */
+struct igt_oa_format {
+	const char *name;
+	size_t size;
+	int a_off; /* bytes */
+	int n_a;
+	int first_a;
+	int b_off;
+	int n_b;
+	int c_off;
+	int n_c;
+};
+
+extern const struct igt_oa_format igt_oa_formats[I915_OA_FORMAT_MAX];
+
+const struct igt_oa_format *igt_oa_format_info(int format_id);
+
+/**
+ * igt_oa_reader_t:
+ *
+ * Zero-copy reader for an i915-perf OA stream, set up with
+ * igt_oa_reader_new(). Records are parsed in place in the reader's buffer
+ * and returned by reference, so consuming a high sample rate stream doesn't
+ * involve copying every report.
+ */
+typedef struct _igt_oa_reader igt_oa_reader_t;
+
+/**
+ * igt_oa_counter_class:
+ * @IGT_OA_COUNTER_A: aggregating counters
+ * @IGT_OA_COUNTER_B: boolean counters
+ * @IGT_OA_COUNTER_C: custom counters
+ *
+ * The three counter classes an OA report may contain, for use with
+ * igt_oa_subscribe().
+ */
+enum igt_oa_counter_class {
+	IGT_OA_COUNTER_A,
+	IGT_OA_COUNTER_B,
+	IGT_OA_COUNTER_C,
+};
+
+/**
+ * igt_oa_delta_fn:
+ * @timestamp_delta: raw timestamp delta between the two reports
+ * @deltas: one delta per subscribed counter, in subscription order
+ * @n_deltas: number of entries in @deltas
+ * @user_data: user pointer passed to igt_oa_reader_read_deltas()
+ *
+ * Callback invoked for each consecutive pair of sample reports.
+ */
+typedef void (*igt_oa_delta_fn)(uint32_t timestamp_delta,
+				const uint32_t *deltas, int n_deltas,
+				void *user_data);
+
+igt_oa_reader_t *igt_oa_reader_new(int stream_fd, int format_id);
+const struct drm_i915_perf_record_header *
+igt_oa_reader_next(igt_oa_reader_t *reader);
+void igt_oa_reader_flush(igt_oa_reader_t *reader);
+int igt_oa_subscribe(igt_oa_reader_t *reader,
+		     enum igt_oa_counter_class counter_class, int index);
+int igt_oa_reader_read_deltas(igt_oa_reader_t *reader,
+			      igt_oa_delta_fn fn, void *user_data);
+void igt_oa_reader_free(igt_oa_reader_t *reader);
+
+/**
+ * igt_oa_record_report:
+ * @header: record header returned by igt_oa_reader_next()
+ *
+ * Returns: The OA report payload following a sample record header.
+ */
+static inline const uint32_t *
+igt_oa_record_report(const struct drm_i915_perf_record_header *header)
+{
+	return (const uint32_t *)(header + 1);
+}
+
+#endif /* IGT_PERF_OA_H */
@@ -26,6 +26,7 @@
  *
  */
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <limits.h>
 #include <stdlib.h>
@@ -37,6 +38,7 @@
 #include "drmtest.h"
 #include "igt_pm.h"
 #include "igt_aux.h"
+#include "igt_sysfs.h"
 
 /**
  * SECTION:igt_pm
@@ -323,6 +325,154 @@ enum igt_runtime_pm_status igt_get_runtime_pm_status(void)
 	return IGT_RUNTIME_PM_STATUS_UNKNOWN;
 }
 
+struct igt_pm_sampler {
+	int fds[3];
+	unsigned int interval_us;
+	unsigned int capacity;
+
+	pthread_t thread;
+	bool stop;
+
+	struct timespec start;
+	uint64_t total;
+	struct igt_pm_sample *samples;
+};
+
+static void *pm_sampler_thread(void *arg)
+{
+	igt_pm_sampler_t *sampler = arg;
+
+	while (!__atomic_load_n(&sampler->stop, __ATOMIC_ACQUIRE)) {
+		struct igt_pm_sample *s =
+			&sampler->samples[sampler->total % sampler->capacity];
+		uint64_t values[3];
+
+		s->time_ns = igt_nsec_elapsed(&sampler->start);
+		igt_sysfs_attr_snapshot_u64(sampler->fds, values, 3);
+		s->cur_freq_mhz = values[0];
+		s->act_freq_mhz = values[1];
+		s->rc6_residency_ms = values[2];
+
+		sampler->total++;
+
+		usleep(sampler->interval_us);
+	}
+
+	return NULL;
+}
+
+/**
+ * igt_pm_sampler_start:
+ * @drm_fd: fd to drm device
+ * @interval_us: time between two samples in microseconds
+ * @capacity: number of samples to keep, older samples are overwritten
+ *
+ * Starts a thread which periodically snapshots gt_cur_freq_mhz,
+ * gt_act_freq_mhz and the RC6 residency counter through persistent sysfs fds
+ * into a preallocated ring. One pread() per attribute and sample keeps the
+ * perturbation of the measured workload minimal, while the recorded
+ * timestamps let tests correlate performance dips with frequency transitions
+ * after the fact.
+ *
+ * Skips the test if the frequency interfaces are not available. RC6
+ * residency is reported as 0 when unsupported.
+ *
+ * Returns: A new sampler, to be stopped with igt_pm_sampler_stop() and
+ * released with igt_pm_sampler_free().
+ */
+igt_pm_sampler_t *igt_pm_sampler_start(int drm_fd, unsigned int interval_us,
+				       unsigned int capacity)
+{
+	igt_pm_sampler_t *sampler;
+	int dir;
+
+	sampler = calloc(1, sizeof(*sampler));
+	igt_assert(sampler);
+
+	dir = igt_sysfs_open(drm_fd, NULL);
+	igt_assert(dir >= 0);
+
+	sampler->fds[0] = igt_sysfs_open_attr(dir, "gt_cur_freq_mhz",
+					      O_RDONLY);
+	sampler->fds[1] = igt_sysfs_open_attr(dir, "gt_act_freq_mhz",
+					      O_RDONLY);
+	sampler->fds[2] = igt_sysfs_open_attr(dir, "power/rc6_residency_ms",
+					      O_RDONLY);
+	close(dir);
+
+	igt_require(sampler->fds[0] >= 0 && sampler->fds[1] >= 0);
+
+	sampler->interval_us = interval_us;
+	sampler->capacity = capacity;
+	sampler->samples = calloc(capacity, sizeof(*sampler->samples));
+	igt_assert(sampler->samples);
+
+	igt_nsec_elapsed(&sampler->start);
+
+	igt_assert_eq(pthread_create(&sampler->thread, NULL,
+				     pm_sampler_thread, sampler), 0);
+
+	return sampler;
+}
+
+/**
+ * igt_pm_sampler_stop:
+ * @sampler: sampler from igt_pm_sampler_start()
+ * @samples: pointer to store the recorded samples, owned by the sampler
+ *
+ * Stops the sampling thread and linearizes the ring, so @samples points at
+ * the recorded samples in capture order, oldest first.
+ *
+ * Returns: The number of samples recorded, at most the ring capacity.
+ */
+unsigned int igt_pm_sampler_stop(igt_pm_sampler_t *sampler,
+				 const struct igt_pm_sample **samples)
+{
+	__atomic_store_n(&sampler->stop, true, __ATOMIC_RELEASE);
+	pthread_join(sampler->thread, NULL);
+
+	if (sampler->total > sampler->capacity) {
+		unsigned int head = sampler->total % sampler->capacity;
+		struct igt_pm_sample *tmp;
+
+		tmp = malloc(sampler->capacity * sizeof(*tmp));
+		igt_assert(tmp);
+
+		memcpy(tmp, sampler->samples + head,
+		       (sampler->capacity - head) * sizeof(*tmp));
+		memcpy(tmp + sampler->capacity - head, sampler->samples,
+		       head * sizeof(*tmp));
+		memcpy(sampler->samples, tmp,
+		       sampler->capacity * sizeof(*tmp));
+
+		free(tmp);
+	}
+
+	*samples = sampler->samples;
+
+	return sampler->total < sampler->capacity ?
+		sampler->total : sampler->capacity;
+}
+
+/**
+ * igt_pm_sampler_free:
+ * @sampler: sampler from igt_pm_sampler_start()
+ *
+ * Releases the sysfs fds, the sample ring and the sampler itself. The
+ * sampling thread must have been stopped with igt_pm_sampler_stop() already.
+ */
+void igt_pm_sampler_free(igt_pm_sampler_t *sampler)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(sampler->fds); i++)
+		if (sampler->fds[i] >= 0)
+			close(sampler->fds[i]);
+
+	free(sampler->samples);
+	free(sampler);
+}
+
 /**
  * igt_wait_for_pm_status:
  * @status: desired runtime PM status
@@ -50,4 +50,35 @@ bool igt_setup_runtime_pm(void);
 enum igt_runtime_pm_status igt_get_runtime_pm_status(void);
 bool igt_wait_for_pm_status(enum igt_runtime_pm_status status);
 
+/**
+ * igt_pm_sample:
+ * @time_ns: time of the sample relative to igt_pm_sampler_start()
+ * @cur_freq_mhz: requested GT frequency in MHz
+ * @act_freq_mhz: actual GT frequency in MHz
+ * @rc6_residency_ms: cumulative RC6 residency in ms, 0 if unsupported
+ *
+ * One snapshot of the frequency and residency counters, recorded by the
+ * background sampler.
+ */
+struct igt_pm_sample {
+	uint64_t time_ns;
+	uint32_t cur_freq_mhz;
+	uint32_t act_freq_mhz;
+	uint64_t rc6_residency_ms;
+};
+
+/**
+ * igt_pm_sampler_t:
+ *
+ * Background frequency/RC6 sampler, set up with igt_pm_sampler_start(). A
+ * thread snapshots the counters at a fixed rate into a preallocated ring.
+ */
+typedef struct igt_pm_sampler igt_pm_sampler_t;
+
+igt_pm_sampler_t *igt_pm_sampler_start(int drm_fd, unsigned int interval_us,
+				       unsigned int capacity);
+unsigned int igt_pm_sampler_stop(igt_pm_sampler_t *sampler,
+				 const struct igt_pm_sample **samples);
+void igt_pm_sampler_free(igt_pm_sampler_t *sampler);
+
 #endif /* IGT_PM_H */
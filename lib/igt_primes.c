@@ -128,8 +128,11 @@ static unsigned long mark_multiples(unsigned long x,
 	unsigned long m;
 
 	m = 2*x;
-	if (m < start)
-		m = (start / x + 1) * x;
+	if (m < start) {
+		m = (start / x) * x;
+		if (m < start)
+			m += x;
+	}
 
 	while (m < end) {
 		clear_bit(m, primes);
@@ -139,40 +142,108 @@ static unsigned long mark_multiples(unsigned long x,
 	return x;
 }
 
-unsigned long igt_next_prime_number(unsigned long x)
+/* The sieve bitmap (bit n set => n is prime) is kept for the life of
+ * the process and only ever extended.  Growing it is a segmented
+ * extension rather than a rebuild: the region below the old size is
+ * already final, so only multiples falling inside the new segment get
+ * marked, using the primes the bitmap itself supplies.
+ */
+static unsigned long *primes;
+static unsigned long primes_sz;
+
+static bool grow_sieve(unsigned long limit)
 {
-	static unsigned long *primes;
-	static unsigned long last, last_sz;
+	unsigned long sz, y;
+	unsigned long *nprimes;
 
+	if (limit < primes_sz)
+		return true;
+
+	sz = round_up(limit + 1, BITS_PER_LONG);
+	if (primes_sz && sz < 2*primes_sz && 2*primes_sz > primes_sz)
+		sz = 2*primes_sz;
+
+	nprimes = realloc(primes, sz / BITS_PER_CHAR);
+	if (!nprimes)
+		return false;
+
+	memset(nprimes + primes_sz / BITS_PER_LONG,
+	       0xff, (sz - primes_sz) / BITS_PER_CHAR);
+	if (!primes_sz) {
+		clear_bit(0, nprimes);
+		clear_bit(1, nprimes);
+	}
+
+	/* Any composite below sz has a factor not above its square
+	 * root, so walking the candidates up to sqrt(sz) and marking
+	 * their multiples inside the new segment completes the sieve.
+	 */
+	for (y = 2UL; y*y < sz; y = find_next_bit(nprimes, sz, y + 1))
+		mark_multiples(y, nprimes, primes_sz, sz);
+
+	primes = nprimes;
+	primes_sz = sz;
+	return true;
+}
+
+unsigned long igt_next_prime_number(unsigned long x)
+{
 	if (x == 0)
 		return 1; /* a white lie for for_each_prime_number() */
 	if (x == 1)
 		return 2;
 
-	if (x >= last) {
-		unsigned long sz, y;
-		unsigned long *nprimes;
-
-		sz = x*x;
-		if (sz < x)
+	/* Bertrand guarantees a prime in (x, 2x), so with the sieve
+	 * covering 2x the search below cannot run off the bitmap.
+	 */
+	if (2*x >= primes_sz) {
+		if (2*x < x || !grow_sieve(2*x))
 			return slow_next_prime_number(x);
+	}
 
-		sz = round_up(sz, BITS_PER_LONG);
-		nprimes = realloc(primes, sz / sizeof(long));
-		if (!nprimes)
-			return slow_next_prime_number(x);
+	return find_next_bit(primes, primes_sz, x + 1);
+}
 
-		/* Where memory permits, track the primes using the
-		 * Sieve of Eratosthenes.
-		 */
-		memset(nprimes + last_sz / BITS_PER_LONG,
-		       0xff, (sz - last_sz) / sizeof(long));
-		for (y = 2UL; y < sz; y = find_next_bit(nprimes, sz, y + 1))
-			last = mark_multiples(y, nprimes, last_sz, sz);
+/**
+ * igt_primes_iter_init:
+ * @iter: the iterator to initialize
+ * @start: iteration yields primes strictly above this value
+ * @limit: iteration stops after the last prime not above this value
+ *
+ * Sets up @iter and extends the prime sieve to cover @limit up front,
+ * so every subsequent igt_primes_iter_next() is a plain walk of the
+ * cached bitmap with no sieving on the way.
+ */
+void igt_primes_iter_init(struct igt_primes_iter *iter,
+			  unsigned long start, unsigned long limit)
+{
+	iter->prime = start;
+	iter->limit = limit;
 
-		primes = nprimes;
-		last_sz = sz;
-	}
+	/* If this fails, igt_next_prime_number() falls back to trial
+	 * division per step; the iteration stays correct, just slower.
+	 */
+	grow_sieve(limit);
+}
 
-	return find_next_bit(primes, last, x + 1);
+/**
+ * igt_primes_iter_next:
+ * @iter: the iterator
+ *
+ * Returns:
+ * The next prime in the iteration, or 0 once the limit is passed.
+ */
+unsigned long igt_primes_iter_next(struct igt_primes_iter *iter)
+{
+	unsigned long x;
+
+	if (iter->prime >= iter->limit)
+		return 0;
+
+	x = igt_next_prime_number(iter->prime);
+	if (x > iter->limit)
+		return 0;
+
+	iter->prime = x;
+	return x;
 }
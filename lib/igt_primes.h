@@ -30,4 +30,18 @@ unsigned long igt_next_prime_number(unsigned long x);
 	for (unsigned long prime = 0, count__ = (count);		\
 	     count__-- && (prime = igt_next_prime_number(prime)); )
 
+/* iteration over a known range, pre-sieved once at init */
+struct igt_primes_iter {
+	unsigned long prime;
+	unsigned long limit;
+};
+
+void igt_primes_iter_init(struct igt_primes_iter *iter,
+			  unsigned long start, unsigned long limit);
+unsigned long igt_primes_iter_next(struct igt_primes_iter *iter);
+
+#define for_each_prime_in_range(prime, iter, start, limit)		\
+	for (igt_primes_iter_init(iter, (start), (limit));		\
+	     (prime = igt_primes_iter_next(iter)); )
+
 #endif /* IGT_PRIMES_H */
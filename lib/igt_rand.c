@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "igt_rand.h"
 
 static uint32_t global = 0x12345678;
@@ -20,3 +22,41 @@ uint32_t hars_petruska_f54_1_random_unsafe(void)
 {
 	return hars_petruska_f54_1_random(&global);
 }
+
+/*
+ * Filling buffers a dword at a time through the generator above
+ * serializes on the state update, which hurts once tests start
+ * randomizing gigabyte-scale working sets. The fill below is
+ * counter-based instead: each dword is the murmur3 finalizer applied
+ * to the seed plus a Weyl increment of its own index, so there is no
+ * loop-carried dependency and the compiler can vectorize it across as
+ * many lanes as the target offers. The stream is fully determined by
+ * the seed, so a verification pass can regenerate it with the same
+ * call.
+ */
+static inline uint32_t mix32(uint32_t x)
+{
+	x ^= x >> 16;
+	x *= 0x85ebca6b;
+	x ^= x >> 13;
+	x *= 0xc2b2ae35;
+	x ^= x >> 16;
+
+	return x;
+}
+
+void igt_rand_fill(uint32_t seed, void *dst, unsigned long len)
+{
+	uint32_t *out = dst;
+	unsigned long count = len / sizeof(*out);
+	unsigned long i;
+
+	for (i = 0; i < count; i++)
+		out[i] = mix32(seed + i * 0x9e3779b9);
+
+	if (len & 3) {
+		uint32_t last = mix32(seed + count * 0x9e3779b9);
+
+		memcpy(&out[count], &last, len & 3);
+	}
+}
@@ -31,6 +31,8 @@ uint32_t hars_petruska_f54_1_random(uint32_t *state);
 uint32_t hars_petruska_f54_1_random_seed(uint32_t seed);
 uint32_t hars_petruska_f54_1_random_unsafe(void);
 
+void igt_rand_fill(uint32_t seed, void *dst, unsigned long len);
+
 static inline void hars_petruska_f54_1_random_perturb(uint32_t xor)
 {
 	uint32_t seed = hars_petruska_f54_1_random_seed(0) ^ xor;
@@ -27,7 +27,9 @@
 #include <string.h>
 
 #include "igt_core.h"
+#include "igt_ewma.h"
 #include "igt_stats.h"
+#include "igt_x86.h"
 
 #define U64_MAX         ((uint64_t)~0ULL)
 
@@ -137,6 +139,37 @@ void igt_stats_init_with_size(igt_stats_t *stats, unsigned int capacity)
 	stats->range[1] = -HUGE_VAL;
 }
 
+/**
+ * igt_stats_init_streaming:
+ * @stats: An #igt_stats_t instance
+ *
+ * Like igt_stats_init(), but instead of storing every pushed value the
+ * samples are folded into an #igt_histogram and running moments as they
+ * arrive: both the memory footprint and the cost of a push stay constant
+ * however many samples are pushed, so long-running monitors and soak
+ * tests can keep percentile reporting over hundreds of millions of
+ * samples. Minimum, maximum, mean and variance remain exact; medians,
+ * quartiles and percentiles are estimates accurate to
+ * 1/%IGT_HISTOGRAM_SUB_COUNT of the value.
+ *
+ * Streaming mode only accepts integer samples (igt_stats_push_float()
+ * asserts).
+ *
+ * igt_stats_fini() must be called once finished with @stats.
+ */
+void igt_stats_init_streaming(igt_stats_t *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+	stats->is_streaming = true;
+	stats->min = U64_MAX;
+	stats->max = 0;
+
+	stats->histogram = malloc(sizeof(*stats->histogram));
+	igt_assert(stats->histogram);
+	igt_histogram_init(stats->histogram);
+}
+
 /**
  * igt_stats_fini:
  * @stats: An #igt_stats_t instance
@@ -147,6 +180,7 @@ void igt_stats_fini(igt_stats_t *stats)
 {
 	free(stats->values_u64);
 	free(stats->sorted_u64);
+	free(stats->histogram);
 }
 
 
@@ -207,6 +241,24 @@ void igt_stats_set_population(igt_stats_t *stats, bool full_population)
  */
 void igt_stats_push(igt_stats_t *stats, uint64_t value)
 {
+	if (stats->is_streaming) {
+		double delta = (double)value - stats->mean;
+
+		igt_histogram_add(stats->histogram, value);
+
+		/* Welford's update, same as igt_mean_add() */
+		stats->n_values++;
+		stats->mean += delta / stats->n_values;
+		stats->stream_m2 += delta * ((double)value - stats->mean);
+		stats->mean_variance_valid = false;
+
+		if (value < stats->min)
+			stats->min = value;
+		if (value > stats->max)
+			stats->max = value;
+		return;
+	}
+
 	if (stats->is_float) {
 		igt_stats_push_float(stats, value);
 		return;
@@ -235,6 +287,9 @@ void igt_stats_push(igt_stats_t *stats, uint64_t value)
  */
 void igt_stats_push_float(igt_stats_t *stats, double value)
 {
+	/* the streaming histogram bins integers */
+	igt_assert(!stats->is_streaming);
+
 	igt_stats_ensure_capacity(stats, 1);
 
 	if (!stats->is_float) {
@@ -257,6 +312,44 @@ void igt_stats_push_float(igt_stats_t *stats, double value)
 		stats->range[1] = value;
 }
 
+static void igt_stats_knuth_mean_variance(igt_stats_t *stats);
+
+/*
+ * Chan et al.'s pairwise update of the running moments: fold a block of
+ * @n_b values with mean @mean_b and sum of squared deviations @m2_b
+ * into @stats, without revisiting the individual samples of either
+ * side. @stats->n_values is still the count before the block.
+ */
+static void igt_stats_merge_moments(igt_stats_t *stats, uint64_t n_b,
+				    double mean_b, double m2_b)
+{
+	uint64_t n_a = stats->n_values;
+	uint64_t n = n_a + n_b;
+	double delta, m2_a;
+
+	if (!n_b)
+		return;
+
+	if (!n_a) {
+		stats->mean = mean_b;
+		stats->stream_m2 = m2_b;
+		return;
+	}
+
+	if (stats->is_streaming) {
+		m2_a = stats->stream_m2;
+	} else {
+		igt_stats_knuth_mean_variance(stats);
+		m2_a = stats->variance *
+		       (n_a > 1 && !stats->is_population ? n_a - 1 : n_a);
+	}
+
+	delta = mean_b - stats->mean;
+	stats->mean += delta * n_b / n;
+	stats->stream_m2 = m2_a + m2_b +
+			   delta * delta * ((double)n_a * n_b / n);
+}
+
 /**
  * igt_stats_push_array:
  * @stats: An #igt_stats_t instance
@@ -264,16 +357,97 @@ void igt_stats_push_float(igt_stats_t *stats, double value)
  * @n_values: The number of data points to add
  *
  * Adds an array of values to the @stats dataset.
+ *
+ * Unlike looping igt_stats_push(), the summary of the incoming array is
+ * computed in a single vectorized pass and folded into the running
+ * state once, so ingesting a large capture afterwards runs at memory
+ * bandwidth rather than being limited by the per-value bookkeeping.
  */
 void igt_stats_push_array(igt_stats_t *stats,
 			  const uint64_t *values, unsigned int n_values)
 {
+	struct igt_u64_moments m;
 	unsigned int i;
+	double m2;
+
+	if (stats->is_float) {
+		for (i = 0; i < n_values; i++)
+			igt_stats_push_float(stats, values[i]);
+		return;
+	}
 
-	igt_stats_ensure_capacity(stats, n_values);
+	if (!n_values)
+		return;
+
+	igt_u64_moments(values, n_values, &m);
+	/* rounding may leave the one-pass m2 marginally negative */
+	m2 = m.sumsq - m.sum * (m.sum / n_values);
+	if (m2 < 0.)
+		m2 = 0.;
+	igt_stats_merge_moments(stats, n_values, m.sum / n_values, m2);
+
+	if (stats->is_streaming) {
+		for (i = 0; i < n_values; i++)
+			igt_histogram_add(stats->histogram, values[i]);
+	} else {
+		igt_stats_ensure_capacity(stats, n_values);
+		memcpy(stats->values_u64 + stats->n_values, values,
+		       n_values * sizeof(*values));
+		stats->sorted_array_valid = false;
+	}
+
+	stats->n_values += n_values;
+	if (m.min < stats->min)
+		stats->min = m.min;
+	if (m.max > stats->max)
+		stats->max = m.max;
+
+	if (stats->n_values > 1 && !stats->is_population)
+		stats->variance = stats->stream_m2 / (stats->n_values - 1);
+	else
+		stats->variance = stats->stream_m2 / stats->n_values;
+	stats->mean_variance_valid = true;
+}
+
+/**
+ * igt_stats_merge:
+ * @dst: An #igt_stats_t instance to merge into
+ * @src: An #igt_stats_t instance to merge from
+ *
+ * Folds every sample accumulated in @src into @dst, so independent
+ * #igt_stats_t filled in parallel (one per thread or per child) can be
+ * combined for reporting. @src is left untouched.
+ *
+ * Merging two streaming instances (see igt_stats_init_streaming())
+ * combines their summaries directly; a streaming @src cannot be merged
+ * into a non-streaming @dst as the individual samples no longer exist.
+ */
+void igt_stats_merge(igt_stats_t *dst, const igt_stats_t *src)
+{
+	unsigned int i;
+
+	if (src->is_streaming) {
+		igt_assert(dst->is_streaming);
+
+		igt_stats_merge_moments(dst, src->n_values,
+					src->mean, src->stream_m2);
+		igt_histogram_merge(dst->histogram, src->histogram);
+		dst->n_values += src->n_values;
+		if (src->min < dst->min)
+			dst->min = src->min;
+		if (src->max > dst->max)
+			dst->max = src->max;
+		dst->mean_variance_valid = false;
+		return;
+	}
+
+	if (src->is_float) {
+		for (i = 0; i < src->n_values; i++)
+			igt_stats_push_float(dst, src->values_f[i]);
+		return;
+	}
 
-	for (i = 0; i < n_values; i++)
-		igt_stats_push(stats, values[i]);
+	igt_stats_push_array(dst, src->values_u64, src->n_values);
 }
 
 /**
@@ -436,6 +610,19 @@ void igt_stats_get_quartiles(igt_stats_t *stats,
 		return;
 	}
 
+	if (stats->is_streaming) {
+		if (q1)
+			*q1 = igt_histogram_get_percentile(stats->histogram,
+							   25.);
+		if (q2)
+			*q2 = igt_histogram_get_percentile(stats->histogram,
+							   50.);
+		if (q3)
+			*q3 = igt_histogram_get_percentile(stats->histogram,
+							   75.);
+		return;
+	}
+
 	ret = igt_stats_get_median_internal(stats, 0, stats->n_values,
 					    &lower_end, &upper_start);
 	if (q2)
@@ -475,10 +662,49 @@ double igt_stats_get_iqr(igt_stats_t *stats)
  */
 double igt_stats_get_median(igt_stats_t *stats)
 {
+	if (stats->is_streaming)
+		return igt_histogram_get_percentile(stats->histogram, 50.);
+
 	return igt_stats_get_median_internal(stats, 0, stats->n_values,
 					     NULL, NULL);
 }
 
+/**
+ * igt_stats_get_percentile:
+ * @stats: An #igt_stats_t instance
+ * @percentile: Percentile to retrieve, between 0 and 100
+ *
+ * Retrieves the @percentile-th
+ * [percentile](https://en.wikipedia.org/wiki/Percentile) of the @stats
+ * dataset, linearly interpolating between the two closest ranks.
+ */
+double igt_stats_get_percentile(igt_stats_t *stats, double percentile)
+{
+	unsigned int lower;
+	double rank, frac;
+
+	igt_assert(percentile >= 0. && percentile <= 100.);
+
+	if (!stats->n_values)
+		return 0.;
+
+	if (stats->is_streaming)
+		return igt_histogram_get_percentile(stats->histogram,
+						    percentile);
+
+	igt_stats_ensure_sorted_values(stats);
+
+	rank = percentile / 100. * (stats->n_values - 1);
+	lower = rank;
+	frac = rank - lower;
+
+	if (lower + 1 >= stats->n_values)
+		return sorted_value(stats, stats->n_values - 1);
+
+	return sorted_value(stats, lower) * (1. - frac) +
+	       sorted_value(stats, lower + 1) * frac;
+}
+
 /*
  * Algorithm popularised by Knuth in:
  *
@@ -495,6 +721,17 @@ static void igt_stats_knuth_mean_variance(igt_stats_t *stats)
 	if (stats->mean_variance_valid)
 		return;
 
+	/* In streaming mode the mean and m2 are accumulated at push time. */
+	if (stats->is_streaming) {
+		if (stats->n_values > 1 && !stats->is_population)
+			stats->variance = stats->stream_m2 /
+					  (stats->n_values - 1);
+		else if (stats->n_values)
+			stats->variance = stats->stream_m2 / stats->n_values;
+		stats->mean_variance_valid = true;
+		return;
+	}
+
 	for (i = 0; i < stats->n_values; i++) {
 		double delta = unsorted_value(stats, i) - mean;
 
@@ -563,11 +800,16 @@ double igt_stats_get_std_deviation(igt_stats_t *stats)
  *
  * It's useful to hide outliers in measurements (due to cold cache etc).
  */
+static double histogram_get_iqm(const struct igt_histogram *h);
+
 double igt_stats_get_iqm(igt_stats_t *stats)
 {
 	unsigned int q1, q3, i;
 	double mean;
 
+	if (stats->is_streaming)
+		return histogram_get_iqm(stats->histogram);
+
 	igt_stats_ensure_sorted_values(stats);
 
 	q1 = (stats->n_values + 3) / 4;
@@ -660,3 +902,467 @@ double igt_mean_get_variance(struct igt_mean *m)
 	return m->sq / m->count;
 }
 
+/**
+ * igt_ewma_init:
+ * @e: tracking structure
+ * @tau: decay time constant, in the same unit as the timestamps
+ *
+ * Initializes or resets @e. A sample's influence falls to 1/e of its
+ * initial weight after @tau has elapsed.
+ */
+void igt_ewma_init(struct igt_ewma *e, double tau)
+{
+	memset(e, 0, sizeof(*e));
+	e->tau = tau;
+}
+
+/**
+ * igt_ewma_add:
+ * @e: tracking structure
+ * @time: timestamp of the sample
+ * @value: sample
+ *
+ * Folds @value into the moving average. The previous state is weighed
+ * by how long ago it was last updated, so the decay is the same
+ * whether the samples arrive regularly or in bursts.
+ */
+void igt_ewma_add(struct igt_ewma *e, double time, double value)
+{
+	if (e->primed) {
+		double a = exp(-(time - e->last) / e->tau);
+
+		e->value = a * e->value + (1. - a) * value;
+	} else {
+		e->value = value;
+		e->primed = true;
+	}
+	e->last = time;
+}
+
+/**
+ * igt_ewma_read:
+ * @e: tracking structure
+ *
+ * Current value of the moving average.
+ */
+double igt_ewma_read(const struct igt_ewma *e)
+{
+	return e->value;
+}
+
+/**
+ * igt_ewma_rate_init:
+ * @r: tracking structure
+ * @window: smoothing window, in the same unit as the timestamps
+ * @time: current timestamp
+ *
+ * Initializes or resets @r; events added later are measured against
+ * @time.
+ */
+void igt_ewma_rate_init(struct igt_ewma_rate *r, double window, double time)
+{
+	igt_ewma_init(&r->avg, window);
+	r->avg.last = time;
+	r->pending = 0.;
+}
+
+/**
+ * igt_ewma_rate_add:
+ * @r: tracking structure
+ * @time: current timestamp
+ * @count: number of events since the last call
+ *
+ * Accounts @count new events. Events reported with no time elapsed
+ * accumulate and are folded in once the clock advances.
+ */
+void igt_ewma_rate_add(struct igt_ewma_rate *r, double time, uint64_t count)
+{
+	double dt = time - r->avg.last;
+
+	r->pending += count;
+	if (dt <= 0.)
+		return;
+
+	igt_ewma_add(&r->avg, time, r->pending / dt);
+	r->pending = 0.;
+}
+
+/**
+ * igt_ewma_rate_read:
+ * @r: tracking structure
+ * @time: current timestamp
+ *
+ * Event rate as of @time. Silence since the last event decays the
+ * estimate towards zero rather than holding the last rate forever.
+ */
+double igt_ewma_rate_read(const struct igt_ewma_rate *r, double time)
+{
+	double dt = time - r->avg.last;
+
+	if (!r->avg.primed)
+		return 0.;
+	if (dt <= 0.)
+		return r->avg.value;
+
+	return exp(-dt / r->avg.tau) * r->avg.value;
+}
+
+/* Map a value to its log-linear bin: values below IGT_HISTOGRAM_SUB_COUNT
+ * get a bin each, and every power-of-two range above that is split into
+ * IGT_HISTOGRAM_SUB_COUNT equal bins, bounding the quantization error to
+ * 1/IGT_HISTOGRAM_SUB_COUNT of the value.
+ */
+static unsigned int histogram_bin(uint64_t value)
+{
+	unsigned int msb, group;
+
+	if (value < IGT_HISTOGRAM_SUB_COUNT)
+		return value;
+
+	msb = 63 - __builtin_clzll(value);
+	group = msb - IGT_HISTOGRAM_SUB_BITS + 1;
+
+	return group * IGT_HISTOGRAM_SUB_COUNT +
+	       ((value >> (msb - IGT_HISTOGRAM_SUB_BITS)) &
+		(IGT_HISTOGRAM_SUB_COUNT - 1));
+}
+
+static void histogram_bin_range(unsigned int bin,
+				uint64_t *lo, uint64_t *width)
+{
+	unsigned int group = bin / IGT_HISTOGRAM_SUB_COUNT;
+	unsigned int sub = bin % IGT_HISTOGRAM_SUB_COUNT;
+
+	if (group == 0) {
+		*lo = sub;
+		*width = 1;
+	} else {
+		*lo = (uint64_t)(IGT_HISTOGRAM_SUB_COUNT + sub) << (group - 1);
+		*width = 1ULL << (group - 1);
+	}
+}
+
+/**
+ * igt_histogram_init:
+ * @h: the histogram
+ *
+ * Initializes or resets @h.
+ */
+void igt_histogram_init(struct igt_histogram *h)
+{
+	memset(h, 0, sizeof(*h));
+}
+
+/**
+ * igt_histogram_add:
+ * @h: the histogram
+ * @value: sample to accumulate
+ *
+ * Counts @value into its bin. Constant time, no allocation, so it is safe
+ * to call from tight measurement loops.
+ */
+void igt_histogram_add(struct igt_histogram *h, uint64_t value)
+{
+	h->bins[histogram_bin(value)]++;
+	if (!h->count || value < h->min)
+		h->min = value;
+	if (!h->count || value > h->max)
+		h->max = value;
+	h->sum += value;
+	h->count++;
+}
+
+/**
+ * igt_histogram_get_mean:
+ * @h: the histogram
+ *
+ * Computes the exact mean of the accumulated samples (the sum is tracked
+ * alongside the bins).
+ */
+double igt_histogram_get_mean(const struct igt_histogram *h)
+{
+	return h->count ? h->sum / h->count : 0.0;
+}
+
+/**
+ * igt_histogram_get_percentile:
+ * @h: the histogram
+ * @percentile: Percentile to retrieve, between 0 and 100
+ *
+ * Estimates the @percentile-th percentile of the accumulated samples,
+ * interpolating linearly within the bin the rank falls into. The result is
+ * exact for values below %IGT_HISTOGRAM_SUB_COUNT and accurate to
+ * 1/%IGT_HISTOGRAM_SUB_COUNT of the value above that.
+ */
+double igt_histogram_get_percentile(const struct igt_histogram *h,
+				    double percentile)
+{
+	double target = percentile / 100.0 * h->count;
+	uint64_t seen = 0;
+	unsigned int bin;
+
+	if (!h->count)
+		return 0.0;
+
+	for (bin = 0; bin < IGT_HISTOGRAM_BINS; bin++) {
+		uint64_t lo, width;
+		double value;
+
+		if (!h->bins[bin])
+			continue;
+
+		if (seen + h->bins[bin] < target) {
+			seen += h->bins[bin];
+			continue;
+		}
+
+		histogram_bin_range(bin, &lo, &width);
+		value = lo + width * (target - seen) / h->bins[bin];
+
+		/* The extreme bins are wider than the observed extremes */
+		if (value < h->min)
+			value = h->min;
+		if (value > h->max)
+			value = h->max;
+
+		return value;
+	}
+
+	return h->max;
+}
+
+/**
+ * igt_histogram_merge:
+ * @h: the histogram merged into
+ * @other: the histogram merged from
+ *
+ * Adds every sample accumulated in @other to @h. The bins are aligned
+ * by construction, so merging loses no more precision than pushing the
+ * samples into @h directly would have.
+ */
+void igt_histogram_merge(struct igt_histogram *h,
+			 const struct igt_histogram *other)
+{
+	unsigned int bin;
+
+	if (!other->count)
+		return;
+
+	if (!h->count || other->min < h->min)
+		h->min = other->min;
+	if (!h->count || other->max > h->max)
+		h->max = other->max;
+	h->sum += other->sum;
+	h->count += other->count;
+
+	for (bin = 0; bin < IGT_HISTOGRAM_BINS; bin++)
+		h->bins[bin] += other->bins[bin];
+}
+
+/* Interquartile mean over the bins: each bin contributes its midpoint,
+ * weighted by how much of it falls between the 25% and 75% ranks.
+ */
+static double histogram_get_iqm(const struct igt_histogram *h)
+{
+	double lo_rank = .25 * h->count, hi_rank = .75 * h->count;
+	double seen = 0., weight = 0., mean = 0.;
+	unsigned int bin;
+
+	for (bin = 0; bin < IGT_HISTOGRAM_BINS && seen < hi_rank; bin++) {
+		uint64_t lo, width;
+		double take, mid;
+
+		if (!h->bins[bin])
+			continue;
+
+		take = fmin(seen + h->bins[bin], hi_rank) -
+		       fmax(seen, lo_rank);
+		seen += h->bins[bin];
+		if (take <= 0.)
+			continue;
+
+		histogram_bin_range(bin, &lo, &width);
+		mid = lo + width / 2.;
+		if (mid < h->min)
+			mid = h->min;
+		if (mid > h->max)
+			mid = h->max;
+
+		weight += take;
+		mean += take * (mid - mean) / weight;
+	}
+
+	return mean;
+}
+
+/* xorshift64*; fixed seed so runs are reproducible. */
+static uint64_t reservoir_random(struct igt_reservoir *r)
+{
+	uint64_t x = r->state;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	r->state = x;
+
+	return x * 0x2545f4914f6cdd1dull;
+}
+
+/**
+ * igt_reservoir_init:
+ * @r: the reservoir
+ * @size: number of samples to retain
+ *
+ * Initializes @r to retain at most @size samples.
+ * igt_reservoir_fini() must be called once finished with @r.
+ */
+void igt_reservoir_init(struct igt_reservoir *r, unsigned int size)
+{
+	memset(r, 0, sizeof(*r));
+
+	r->size = size;
+	r->state = 0x853c49e6748fea9bull;
+	r->values = malloc(size * sizeof(*r->values));
+	igt_assert(r->values);
+}
+
+/**
+ * igt_reservoir_fini:
+ * @r: the reservoir
+ *
+ * Frees resources allocated in igt_reservoir_init().
+ */
+void igt_reservoir_fini(struct igt_reservoir *r)
+{
+	free(r->values);
+}
+
+/**
+ * igt_reservoir_add:
+ * @r: the reservoir
+ * @value: sample to offer
+ *
+ * Offers @value to the reservoir. Vitter's algorithm R: the i-th sample
+ * replaces a random retained one with probability size/i, which keeps
+ * every sample seen so far equally likely to be retained. Constant time
+ * and no allocation, so safe in tight measurement loops.
+ */
+void igt_reservoir_add(struct igt_reservoir *r, uint64_t value)
+{
+	uint64_t slot;
+
+	r->count++;
+	if (r->n_values < r->size) {
+		r->values[r->n_values++] = value;
+		return;
+	}
+
+	/* the modulo bias is 2^-64 per sample, far below the noise */
+	slot = reservoir_random(r) % r->count;
+	if (slot < r->size)
+		r->values[slot] = value;
+}
+
+/**
+ * igt_reservoir_to_stats:
+ * @r: the reservoir
+ * @stats: An #igt_stats_t instance to fill
+ *
+ * Pushes the retained samples into @stats (in bulk, see
+ * igt_stats_push_array()) for analysis. Quantiles and moments computed
+ * from them estimate those of the full stream.
+ */
+void igt_reservoir_to_stats(const struct igt_reservoir *r, igt_stats_t *stats)
+{
+	igt_stats_push_array(stats, r->values, r->n_values);
+}
+
+/**
+ * igt_reservoir_strata_init:
+ * @s: the stratified reservoir
+ * @n_buckets: number of time buckets
+ * @size: number of samples to retain per bucket
+ * @start: timestamp the first bucket begins at
+ * @length: time covered by each bucket, in the same unit as @start
+ *
+ * Initializes @s to cover [@start, @start + @n_buckets * @length) with
+ * one #igt_reservoir per bucket. igt_reservoir_strata_fini() must be
+ * called once finished with @s.
+ */
+void igt_reservoir_strata_init(struct igt_reservoir_strata *s,
+			       unsigned int n_buckets, unsigned int size,
+			       double start, double length)
+{
+	unsigned int n;
+
+	s->n_buckets = n_buckets;
+	s->start = start;
+	s->length = length;
+	s->buckets = malloc(n_buckets * sizeof(*s->buckets));
+	igt_assert(s->buckets);
+
+	for (n = 0; n < n_buckets; n++) {
+		igt_reservoir_init(&s->buckets[n], size);
+		/* decorrelate the buckets' random sequences */
+		s->buckets[n].state ^= n * 0x9e3779b97f4a7c15ull;
+	}
+}
+
+/**
+ * igt_reservoir_strata_fini:
+ * @s: the stratified reservoir
+ *
+ * Frees resources allocated in igt_reservoir_strata_init().
+ */
+void igt_reservoir_strata_fini(struct igt_reservoir_strata *s)
+{
+	unsigned int n;
+
+	for (n = 0; n < s->n_buckets; n++)
+		igt_reservoir_fini(&s->buckets[n]);
+	free(s->buckets);
+}
+
+/**
+ * igt_reservoir_strata_add:
+ * @s: the stratified reservoir
+ * @time: timestamp of the sample
+ * @value: sample to offer
+ *
+ * Offers @value to the bucket covering @time. Samples outside the
+ * period given at init time land in the nearest edge bucket, so a run
+ * overshooting its planned duration degrades gracefully rather than
+ * losing samples.
+ */
+void igt_reservoir_strata_add(struct igt_reservoir_strata *s,
+			      double time, uint64_t value)
+{
+	double bucket = (time - s->start) / s->length;
+	unsigned int n = 0;
+
+	if (bucket > 0)
+		n = bucket;
+	if (n >= s->n_buckets)
+		n = s->n_buckets - 1;
+
+	igt_reservoir_add(&s->buckets[n], value);
+}
+
+/**
+ * igt_reservoir_strata_to_stats:
+ * @s: the stratified reservoir
+ * @stats: An #igt_stats_t instance to fill
+ *
+ * Pushes the retained samples of every bucket into @stats. Each bucket
+ * contributes at most its reservoir size, so a quiet period weighs the
+ * same as a busy one instead of being drowned out by it.
+ */
+void igt_reservoir_strata_to_stats(const struct igt_reservoir_strata *s,
+				   igt_stats_t *stats)
+{
+	unsigned int n;
+
+	for (n = 0; n < s->n_buckets; n++)
+		igt_reservoir_to_stats(&s->buckets[n], stats);
+}
+
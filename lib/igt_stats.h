@@ -49,6 +49,7 @@ typedef struct {
 	unsigned int is_population  : 1;
 	unsigned int mean_variance_valid : 1;
 	unsigned int sorted_array_valid : 1;
+	unsigned int is_streaming : 1;
 
 	uint64_t min, max;
 	double range[2];
@@ -58,10 +59,14 @@ typedef struct {
 		uint64_t *sorted_u64;
 		double *sorted_f;
 	};
+
+	struct igt_histogram *histogram;
+	double stream_m2;
 } igt_stats_t;
 
 void igt_stats_init(igt_stats_t *stats);
 void igt_stats_init_with_size(igt_stats_t *stats, unsigned int capacity);
+void igt_stats_init_streaming(igt_stats_t *stats);
 void igt_stats_fini(igt_stats_t *stats);
 bool igt_stats_is_population(igt_stats_t *stats);
 void igt_stats_set_population(igt_stats_t *stats, bool full_population);
@@ -69,6 +74,7 @@ void igt_stats_push(igt_stats_t *stats, uint64_t value);
 void igt_stats_push_float(igt_stats_t *stats, double value);
 void igt_stats_push_array(igt_stats_t *stats,
 			  const uint64_t *values, unsigned int n_values);
+void igt_stats_merge(igt_stats_t *dst, const igt_stats_t *src);
 uint64_t igt_stats_get_min(igt_stats_t *stats);
 uint64_t igt_stats_get_max(igt_stats_t *stats);
 uint64_t igt_stats_get_range(igt_stats_t *stats);
@@ -79,6 +85,7 @@ double igt_stats_get_iqm(igt_stats_t *stats);
 double igt_stats_get_mean(igt_stats_t *stats);
 double igt_stats_get_trimean(igt_stats_t *stats);
 double igt_stats_get_median(igt_stats_t *stats);
+double igt_stats_get_percentile(igt_stats_t *stats, double percentile);
 double igt_stats_get_variance(igt_stats_t *stats);
 double igt_stats_get_std_deviation(igt_stats_t *stats);
 
@@ -100,4 +107,82 @@ void igt_mean_add(struct igt_mean *m, double v);
 double igt_mean_get(struct igt_mean *m);
 double igt_mean_get_variance(struct igt_mean *m);
 
+#define IGT_HISTOGRAM_SUB_BITS	5
+#define IGT_HISTOGRAM_SUB_COUNT	(1 << IGT_HISTOGRAM_SUB_BITS)
+#define IGT_HISTOGRAM_BINS	((64 - IGT_HISTOGRAM_SUB_BITS + 1) * \
+				 IGT_HISTOGRAM_SUB_COUNT)
+
+/**
+ * struct igt_histogram:
+ *
+ * Bounded-memory sample accumulator. Unlike #igt_stats_t, which stores
+ * every pushed value, samples are counted into log-linear bins, so
+ * arbitrarily long runs use a fixed amount of memory at the cost of
+ * percentiles being quantized to 1/%IGT_HISTOGRAM_SUB_COUNT of the value.
+ * Needs to be initialized with igt_histogram_init().
+ */
+struct igt_histogram {
+	/*< private >*/
+	uint64_t count;
+	uint64_t min, max;
+	double sum;
+	uint64_t bins[IGT_HISTOGRAM_BINS];
+};
+
+void igt_histogram_init(struct igt_histogram *h);
+void igt_histogram_add(struct igt_histogram *h, uint64_t value);
+void igt_histogram_merge(struct igt_histogram *h,
+			 const struct igt_histogram *other);
+double igt_histogram_get_mean(const struct igt_histogram *h);
+double igt_histogram_get_percentile(const struct igt_histogram *h,
+				    double percentile);
+
+/**
+ * struct igt_reservoir:
+ *
+ * Fixed-size uniform sample of an unbounded stream: after any number of
+ * igt_reservoir_add() calls, the retained values are a uniformly random
+ * subset of everything pushed so far, so a multi-day capture can be
+ * summarised from a few kilobytes without any bias towards the start or
+ * the end of the run. Needs to be initialized with igt_reservoir_init().
+ */
+struct igt_reservoir {
+	/*< private >*/
+	unsigned int size, n_values;
+	uint64_t count;
+	uint64_t state;
+	uint64_t *values;
+};
+
+void igt_reservoir_init(struct igt_reservoir *r, unsigned int size);
+void igt_reservoir_fini(struct igt_reservoir *r);
+void igt_reservoir_add(struct igt_reservoir *r, uint64_t value);
+void igt_reservoir_to_stats(const struct igt_reservoir *r,
+			    igt_stats_t *stats);
+
+/**
+ * struct igt_reservoir_strata:
+ *
+ * An array of #igt_reservoir stratified by time: the capture period is
+ * split into equal buckets each owning a reservoir, so a quiet hour is
+ * represented as well as a busy one and phase changes over a long run
+ * stay visible in the sample. Needs to be initialized with
+ * igt_reservoir_strata_init().
+ */
+struct igt_reservoir_strata {
+	/*< private >*/
+	unsigned int n_buckets;
+	double start, length;
+	struct igt_reservoir *buckets;
+};
+
+void igt_reservoir_strata_init(struct igt_reservoir_strata *s,
+			       unsigned int n_buckets, unsigned int size,
+			       double start, double length);
+void igt_reservoir_strata_fini(struct igt_reservoir_strata *s);
+void igt_reservoir_strata_add(struct igt_reservoir_strata *s,
+			      double time, uint64_t value);
+void igt_reservoir_strata_to_stats(const struct igt_reservoir_strata *s,
+				   igt_stats_t *stats);
+
 #endif /* __IGT_STATS_H__ */
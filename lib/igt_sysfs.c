@@ -258,6 +258,127 @@ int igt_sysfs_read(int dir, const char *attr, void *data, int len)
 	return len;
 }
 
+/**
+ * igt_sysfs_open_attr:
+ * @dir: directory for the device from igt_sysfs_open()
+ * @attr: name of the sysfs node to open
+ * @mode: mode bits as used by open()
+ *
+ * Opens a single sysfs attribute for repeated access. The returned fd can be
+ * handed to igt_sysfs_attr_read(), igt_sysfs_attr_get_u64() and
+ * igt_sysfs_attr_set_u64(), which all use pread()/pwrite() at offset zero, so
+ * polling loops pay one syscall per sample instead of an open/read/close
+ * triple. The caller owns the fd and closes it when done.
+ *
+ * Returns:
+ * The attribute fd, or -1 on failure.
+ */
+int igt_sysfs_open_attr(int dir, const char *attr, int mode)
+{
+	return openat(dir, attr, mode);
+}
+
+/**
+ * igt_sysfs_attr_read:
+ * @fd: attribute fd from igt_sysfs_open_attr()
+ * @buf: buffer where the contents will be stored, allocated by the caller
+ * @len: size of the buffer
+ *
+ * Re-reads the attribute from the start with pread(), which makes the kernel
+ * regenerate the content just like a fresh open would. The result is always
+ * zero-terminated.
+ *
+ * Returns:
+ * The number of bytes read, or -1 on failure.
+ */
+int igt_sysfs_attr_read(int fd, char *buf, int len)
+{
+	int ret;
+
+	do {
+		ret = pread(fd, buf, len - 1, 0);
+	} while (ret < 0 && (errno == EINTR || errno == EAGAIN));
+
+	buf[ret < 0 ? 0 : ret] = '\0';
+
+	return ret;
+}
+
+/**
+ * igt_sysfs_attr_get_u64:
+ * @fd: attribute fd from igt_sysfs_open_attr()
+ *
+ * Re-reads the attribute and parses it as an unsigned integer on the stack,
+ * without any heap allocation or stdio machinery.
+ *
+ * Returns:
+ * The value read, or 0 on failure.
+ */
+uint64_t igt_sysfs_attr_get_u64(int fd)
+{
+	char buf[64];
+
+	if (igt_sysfs_attr_read(fd, buf, sizeof(buf)) <= 0)
+		return 0;
+
+	return strtoull(buf, NULL, 0);
+}
+
+/**
+ * igt_sysfs_attr_set_u64:
+ * @fd: attribute fd from igt_sysfs_open_attr()
+ * @value: value to set
+ *
+ * Writes an unsigned integer to the attribute through pwrite() on the kept
+ * open fd.
+ *
+ * Returns:
+ * True if successfully written.
+ */
+bool igt_sysfs_attr_set_u64(int fd, uint64_t value)
+{
+	char buf[24];
+	int len, ret;
+
+	len = snprintf(buf, sizeof(buf), "%" PRIu64, value);
+
+	do {
+		ret = pwrite(fd, buf, len, 0);
+	} while (ret < 0 && (errno == EINTR || errno == EAGAIN));
+
+	return ret == len;
+}
+
+/**
+ * igt_sysfs_attr_snapshot_u64:
+ * @fds: array of attribute fds from igt_sysfs_open_attr()
+ * @values: array to store the values read, allocated by the caller
+ * @count: number of attributes in both arrays
+ *
+ * Reads a set of attributes in one pass, so the samples of related counters
+ * (e.g. current frequency and residency) are taken as close together in time
+ * as the interface allows. Attributes which fail to read report 0.
+ *
+ * Returns:
+ * The number of attributes read successfully.
+ */
+int igt_sysfs_attr_snapshot_u64(const int *fds, uint64_t *values, int count)
+{
+	char buf[64];
+	int i, n = 0;
+
+	for (i = 0; i < count; i++) {
+		if (igt_sysfs_attr_read(fds[i], buf, sizeof(buf)) > 0) {
+			values[i] = strtoull(buf, NULL, 0);
+			n++;
+		} else {
+			values[i] = 0;
+		}
+	}
+
+	return n;
+}
+
 /**
  * igt_sysfs_set:
  * @dir: directory for the device from igt_sysfs_open()
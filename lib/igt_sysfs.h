@@ -37,6 +37,12 @@ bool igt_sysfs_set_parameter(int device,
 int igt_sysfs_read(int dir, const char *attr, void *data, int len);
 int igt_sysfs_write(int dir, const char *attr, const void *data, int len);
 
+int igt_sysfs_open_attr(int dir, const char *attr, int mode);
+int igt_sysfs_attr_read(int fd, char *buf, int len);
+uint64_t igt_sysfs_attr_get_u64(int fd);
+bool igt_sysfs_attr_set_u64(int fd, uint64_t value);
+int igt_sysfs_attr_snapshot_u64(const int *fds, uint64_t *values, int count);
+
 bool igt_sysfs_set(int dir, const char *attr, const char *value);
 char *igt_sysfs_get(int dir, const char *attr);
 
@@ -0,0 +1,221 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include <i915_drm.h>
+
+#include "igt_core.h"
+#include "igt_x86.h"
+#include "igt_tiling.h"
+
+/**
+ * SECTION:igt_tiling
+ * @short_description: CPU tiled<->linear surface conversion
+ * @title: Tiling
+ * @include: igt.h
+ *
+ * Helpers to convert whole X-tiled surfaces to and from linear layout with
+ * the CPU. The per-byte swizzle loops historically used for this dominate
+ * the runtime of frontbuffer tests on 4K framebuffers; these helpers instead
+ * move the data in 64 byte chunks, which is the granularity below which no
+ * bit6 swizzling ever happens, and dispatch the chunk copy to the widest
+ * vector unit reported by igt_x86_features().
+ */
+
+/* an X tile is 512 bytes wide and 8 rows high */
+#define XTILE_WIDTH 512
+#define XTILE_HEIGHT 8
+#define XTILE_SIZE (XTILE_WIDTH * XTILE_HEIGHT)
+#define XTILE_CHUNK 64
+
+typedef void (*copy_chunk_fn)(void *dst, const void *src);
+
+static void copy_chunk_scalar(void *dst, const void *src)
+{
+	memcpy(dst, src, XTILE_CHUNK);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+
+__attribute__((target("sse2")))
+static void copy_chunk_sse2(void *dst, const void *src)
+{
+	const __m128i *s = src;
+	__m128i *d = dst;
+
+	_mm_storeu_si128(d + 0, _mm_loadu_si128(s + 0));
+	_mm_storeu_si128(d + 1, _mm_loadu_si128(s + 1));
+	_mm_storeu_si128(d + 2, _mm_loadu_si128(s + 2));
+	_mm_storeu_si128(d + 3, _mm_loadu_si128(s + 3));
+}
+
+#include <immintrin.h>
+
+__attribute__((target("avx2")))
+static void copy_chunk_avx2(void *dst, const void *src)
+{
+	const __m256i *s = src;
+	__m256i *d = dst;
+
+	_mm256_storeu_si256(d + 0, _mm256_loadu_si256(s + 0));
+	_mm256_storeu_si256(d + 1, _mm256_loadu_si256(s + 1));
+}
+#endif
+
+static copy_chunk_fn resolve_copy_chunk(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned int features = igt_x86_features();
+
+	if (features & AVX2)
+		return copy_chunk_avx2;
+	if (features & SSE2)
+		return copy_chunk_sse2;
+#endif
+
+	return copy_chunk_scalar;
+}
+
+static copy_chunk_fn igt_copy_chunk(void)
+{
+	static copy_chunk_fn fn;
+
+	if (!fn)
+		fn = resolve_copy_chunk();
+
+	return fn;
+}
+
+#define CHUNK_BIT(num, bit) (((num) >> (bit)) & 1)
+
+/*
+ * bit6 address swizzling only ever mixes in bits 9, 10, 11 and 17, so it is
+ * constant for a full 64 byte chunk and chunks can be copied contiguously.
+ */
+static uint32_t swizzle_chunk_addr(uint32_t addr, unsigned int swizzle)
+{
+	uint32_t bit6;
+
+	switch (swizzle) {
+	case I915_BIT_6_SWIZZLE_NONE:
+		return addr;
+	case I915_BIT_6_SWIZZLE_9:
+		bit6 = CHUNK_BIT(addr, 9);
+		break;
+	case I915_BIT_6_SWIZZLE_9_10:
+		bit6 = CHUNK_BIT(addr, 9) ^ CHUNK_BIT(addr, 10);
+		break;
+	case I915_BIT_6_SWIZZLE_9_11:
+		bit6 = CHUNK_BIT(addr, 9) ^ CHUNK_BIT(addr, 11);
+		break;
+	case I915_BIT_6_SWIZZLE_9_10_11:
+		bit6 = CHUNK_BIT(addr, 9) ^ CHUNK_BIT(addr, 10) ^
+			CHUNK_BIT(addr, 11);
+		break;
+	default:
+		/* If we hit this case, we need to implement support for the
+		 * appropriate swizzling method. */
+		igt_require(false);
+		return addr;
+	}
+
+	return addr ^ (bit6 << 6);
+}
+
+static void convert_x_tiled(void *dst, const void *src,
+			    uint32_t stride, uint32_t height,
+			    unsigned int swizzle, bool to_tiled)
+{
+	copy_chunk_fn copy_chunk = igt_copy_chunk();
+	uint32_t tiles_per_row = stride / XTILE_WIDTH;
+	uint32_t x_tile, y;
+
+	igt_assert(stride % XTILE_WIDTH == 0);
+	igt_assert(height % XTILE_HEIGHT == 0);
+
+	for (y = 0; y < height; y++) {
+		uint32_t tile_row = y / XTILE_HEIGHT;
+		uint32_t tile_line = y % XTILE_HEIGHT;
+		uint32_t linear = y * stride;
+
+		for (x_tile = 0; x_tile < tiles_per_row; x_tile++) {
+			uint32_t tiled = (tile_row * tiles_per_row + x_tile) *
+				XTILE_SIZE + tile_line * XTILE_WIDTH;
+			uint32_t chunk;
+
+			for (chunk = 0; chunk < XTILE_WIDTH;
+			     chunk += XTILE_CHUNK) {
+				uint32_t t = swizzle_chunk_addr(tiled + chunk,
+								swizzle);
+				uint32_t l = linear + x_tile * XTILE_WIDTH +
+					chunk;
+
+				if (to_tiled)
+					copy_chunk((char *)dst + t,
+						   (const char *)src + l);
+				else
+					copy_chunk((char *)dst + l,
+						   (const char *)src + t);
+			}
+		}
+	}
+}
+
+/**
+ * igt_memcpy_linear_to_x_tiled:
+ * @tiled: destination surface in X-tiled layout
+ * @linear: source surface in linear layout
+ * @stride: surface stride in bytes, multiple of 512
+ * @height: surface height in lines, multiple of 8
+ * @swizzle: bit6 swizzle mode of the tiled surface (I915_BIT_6_SWIZZLE_*)
+ *
+ * Converts a whole linear surface into X-tiled layout, e.g. for uploading
+ * CPU-rendered content through a plain CPU or WC map without paying for the
+ * GTT's aperture fencing.
+ */
+void igt_memcpy_linear_to_x_tiled(void *tiled, const void *linear,
+				  uint32_t stride, uint32_t height,
+				  unsigned int swizzle)
+{
+	convert_x_tiled(tiled, linear, stride, height, swizzle, true);
+}
+
+/**
+ * igt_memcpy_x_tiled_to_linear:
+ * @linear: destination surface in linear layout
+ * @tiled: source surface in X-tiled layout
+ * @stride: surface stride in bytes, multiple of 512
+ * @height: surface height in lines, multiple of 8
+ * @swizzle: bit6 swizzle mode of the tiled surface (I915_BIT_6_SWIZZLE_*)
+ *
+ * Converts a whole X-tiled surface into linear layout, the detiling
+ * counterpart of igt_memcpy_linear_to_x_tiled().
+ */
+void igt_memcpy_x_tiled_to_linear(void *linear, const void *tiled,
+				  uint32_t stride, uint32_t height,
+				  unsigned int swizzle)
+{
+	convert_x_tiled(linear, tiled, stride, height, swizzle, false);
+}
@@ -27,6 +27,7 @@
 #include "igt_vgem.h"
 
 #include <sys/mman.h>
+#include <sys/poll.h>
 
 /**
  * SECTION:igt_vgem
@@ -190,3 +191,100 @@ void vgem_fence_signal(int fd, uint32_t fence)
 {
 	igt_assert_eq(__vgem_fence_signal(fd, fence), 0);
 }
+
+void vgem_fence_attach_array(int fd, struct vgem_bo *bo, unsigned count,
+			     unsigned flags, uint32_t *out_fences)
+{
+	struct local_vgem_fence_attach arg;
+	unsigned n;
+
+	for (n = 0; n < count; n++) {
+		memset(&arg, 0, sizeof(arg));
+		arg.handle = bo[n].handle;
+		arg.flags = flags;
+		igt_assert_eq(__vgem_fence_attach(fd, &arg), 0);
+		out_fences[n] = arg.out_fence;
+	}
+}
+
+int __vgem_fence_signal_array(int fd, const uint32_t *fences, unsigned count)
+{
+	struct local_vgem_fence_signal arg;
+	unsigned n;
+	int err = 0;
+
+	/* The uapi only signals one fence per ioctl; keep going on error
+	 * (reporting the first) so one stale fence doesn't leave all the
+	 * following ones unsignalled and their consumers stuck.
+	 */
+	for (n = 0; n < count; n++) {
+		int ret;
+
+		memset(&arg, 0, sizeof(arg));
+		arg.fence = fences[n];
+		ret = ioctl_vgem_fence_signal(fd, &arg);
+		if (ret && !err)
+			err = ret;
+	}
+
+	return err;
+}
+
+void vgem_fence_signal_array(int fd, const uint32_t *fences, unsigned count)
+{
+	igt_assert_eq(__vgem_fence_signal_array(fd, fences, count), 0);
+}
+
+/*
+ * Wait for the fences on an array of exported dma-bufs in one go: all
+ * entries are handed to a single poll(), so however many fences are
+ * outstanding it is one syscall per wakeup rather than one per fence.
+ * Entries that turn ready are parked by negating their fd, which
+ * poll() ignores. Returns how many were ready within the timeout
+ * (milliseconds, -1 to wait forever).
+ */
+int vgem_prime_poll_array(const int *prime_fds, unsigned count,
+			  short events, int timeout)
+{
+	struct pollfd *pfd;
+	unsigned int n, ready;
+	struct timespec tv;
+	int64_t deadline = 0;
+
+	pfd = calloc(count, sizeof(*pfd));
+	igt_assert(pfd);
+
+	for (n = 0; n < count; n++) {
+		pfd[n].fd = prime_fds[n];
+		pfd[n].events = events;
+	}
+
+	if (timeout >= 0) {
+		clock_gettime(CLOCK_MONOTONIC, &tv);
+		deadline = tv.tv_sec * 1000ll + tv.tv_nsec / 1000000 + timeout;
+	}
+
+	for (ready = 0; ready < count; ) {
+		if (poll(pfd, count, timeout) <= 0)
+			break;
+
+		for (n = 0; n < count; n++) {
+			if (pfd[n].fd < 0 || !(pfd[n].revents & events))
+				continue;
+
+			pfd[n].fd = -1 - pfd[n].fd;
+			ready++;
+		}
+
+		if (timeout >= 0) {
+			clock_gettime(CLOCK_MONOTONIC, &tv);
+			timeout = deadline - (tv.tv_sec * 1000ll +
+					      tv.tv_nsec / 1000000);
+			if (timeout < 0)
+				break;
+		}
+	}
+
+	free(pfd);
+	return ready;
+}
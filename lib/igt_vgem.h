@@ -47,4 +47,11 @@ uint32_t vgem_fence_attach(int fd, struct vgem_bo *bo, unsigned flags);
 int __vgem_fence_signal(int fd, uint32_t fence);
 void vgem_fence_signal(int fd, uint32_t fence);
 
+void vgem_fence_attach_array(int fd, struct vgem_bo *bo, unsigned count,
+			     unsigned flags, uint32_t *out_fences);
+int __vgem_fence_signal_array(int fd, const uint32_t *fences, unsigned count);
+void vgem_fence_signal_array(int fd, const uint32_t *fences, unsigned count);
+int vgem_prime_poll_array(const int *prime_fds, unsigned count,
+			  short events, int timeout);
+
 #endif /* IGT_VGEM_H */
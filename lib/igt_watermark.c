@@ -0,0 +1,209 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "igt_watermark.h"
+
+/**
+ * SECTION:igt_watermark
+ * @short_description: Display watermark calculator
+ * @title: Watermark
+ * @include: igt_watermark.h
+ *
+ * The calculation side of display watermarks: given a plane
+ * configuration, compute the watermark value the hardware should be
+ * programmed with, using the same formulas as the kernel. This lets a
+ * display configuration validator pre-screen candidate configurations
+ * offline, and lets tests check programmed registers against expected
+ * values instead of just dumping them.
+ *
+ * The batch entry points evaluate a flat array of configurations in one
+ * call, so sweeping a large configuration space stays in a tight loop
+ * over plain arrays that the compiler can vectorize.
+ */
+
+#define DIV_ROUND_UP(x, y) (((x) + (y) - 1) / (y))
+
+/**
+ * igt_wm_method1:
+ * @pixel_rate: pipe pixel rate in kHz
+ * @cpp: plane bytes per pixel
+ * @latency: memory latency in 0.1 us units
+ *
+ * ILK-style watermark "method 1": FIFO entries needed to cover the
+ * memory latency at the raw pixel rate, in 64 byte cachelines.
+ *
+ * Returns: the watermark value in cachelines
+ */
+uint32_t igt_wm_method1(uint32_t pixel_rate, uint32_t cpp, uint32_t latency)
+{
+	uint64_t ret;
+
+	ret = (uint64_t)pixel_rate * cpp * latency;
+	ret = DIV_ROUND_UP(ret, 64ULL * 10000) + 2;
+
+	return ret;
+}
+
+/**
+ * igt_wm_method2:
+ * @pixel_rate: pipe pixel rate in kHz
+ * @htotal: horizontal total in pixels
+ * @width: horizontal active width of the plane in pixels
+ * @cpp: plane bytes per pixel
+ * @latency: memory latency in 0.1 us units
+ *
+ * ILK-style watermark "method 2": lines fetched during the memory
+ * latency times the plane's bytes per line, in 64 byte cachelines.
+ *
+ * Returns: the watermark value in cachelines
+ */
+uint32_t igt_wm_method2(uint32_t pixel_rate, uint32_t htotal, uint32_t width,
+			uint32_t cpp, uint32_t latency)
+{
+	uint32_t ret;
+
+	ret = (latency * pixel_rate) / (htotal * 10000);
+	ret = (ret + 1) * width * cpp;
+	ret = DIV_ROUND_UP(ret, 64) + 2;
+
+	return ret;
+}
+
+/**
+ * igt_wm_ilk_plane:
+ * @config: plane configuration
+ *
+ * Expected primary/sprite watermark on ILK-style platforms: the smaller
+ * of the two methods, since either one covering the latency is enough.
+ *
+ * Returns: the watermark value in cachelines
+ */
+uint32_t igt_wm_ilk_plane(const struct igt_wm_config *config)
+{
+	uint32_t method1, method2;
+
+	method1 = igt_wm_method1(config->pixel_rate, config->cpp,
+				 config->latency);
+	method2 = igt_wm_method2(config->pixel_rate, config->htotal,
+				 config->width, config->cpp,
+				 config->latency);
+
+	return method1 < method2 ? method1 : method2;
+}
+
+/**
+ * igt_wm_ilk_cursor:
+ * @config: cursor configuration, @width being the cursor size
+ *
+ * Expected cursor watermark on ILK-style platforms. The cursor always
+ * uses method 2 as its FIFO is too small for method 1 to make sense.
+ *
+ * Returns: the watermark value in cachelines
+ */
+uint32_t igt_wm_ilk_cursor(const struct igt_wm_config *config)
+{
+	return igt_wm_method2(config->pixel_rate, config->htotal,
+			      config->width, config->cpp, config->latency);
+}
+
+/**
+ * igt_wm_ilk_fbc:
+ * @config: plane configuration
+ * @pri_val: the primary watermark computed for @config
+ *
+ * Expected FBC watermark on ILK-style platforms, derived from the
+ * primary watermark by converting cachelines back to compressed lines.
+ *
+ * Returns: the FBC watermark value
+ */
+uint32_t igt_wm_ilk_fbc(const struct igt_wm_config *config, uint32_t pri_val)
+{
+	return DIV_ROUND_UP(pri_val * 64, config->width * config->cpp) + 2;
+}
+
+/**
+ * igt_wm_gmch:
+ * @pixel_rate: pipe pixel rate in kHz
+ * @cpp: plane bytes per pixel
+ * @latency_ns: memory latency in nanoseconds
+ * @fifo_size: plane FIFO size in cachelines
+ * @cacheline_size: FIFO cacheline size in bytes
+ * @guard_size: FIFO entries to keep in reserve
+ *
+ * Expected watermark on GMCH platforms (gen2-4, VLV/CHV): the FIFO
+ * entries left over after covering the memory latency at the plane's
+ * consumption rate. The watermark registers hold this free-entry count,
+ * not the fill level.
+ *
+ * Returns: the watermark value in cachelines, or 0 if the FIFO cannot
+ * cover the latency at all
+ */
+uint32_t igt_wm_gmch(uint32_t pixel_rate, uint32_t cpp, uint32_t latency_ns,
+		     uint32_t fifo_size, uint32_t cacheline_size,
+		     uint32_t guard_size)
+{
+	uint64_t entries;
+
+	entries = ((uint64_t)pixel_rate / 1000) * cpp * latency_ns / 1000;
+	entries = DIV_ROUND_UP(entries, cacheline_size) + guard_size;
+
+	if (entries >= fifo_size)
+		return 0;
+
+	return fifo_size - entries;
+}
+
+/**
+ * igt_wm_ilk_plane_batch:
+ * @configs: array of plane configurations
+ * @count: number of configurations
+ * @results: array receiving @count watermark values
+ *
+ * igt_wm_ilk_plane() over a flat array of configurations.
+ */
+void igt_wm_ilk_plane_batch(const struct igt_wm_config *configs,
+			    unsigned int count, uint32_t *results)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+		results[i] = igt_wm_ilk_plane(&configs[i]);
+}
+
+/**
+ * igt_wm_ilk_cursor_batch:
+ * @configs: array of cursor configurations
+ * @count: number of configurations
+ * @results: array receiving @count watermark values
+ *
+ * igt_wm_ilk_cursor() over a flat array of configurations.
+ */
+void igt_wm_ilk_cursor_batch(const struct igt_wm_config *configs,
+			     unsigned int count, uint32_t *results)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+		results[i] = igt_wm_ilk_cursor(&configs[i]);
+}
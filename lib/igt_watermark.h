@@ -0,0 +1,77 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef IGT_WATERMARK_H
+#define IGT_WATERMARK_H
+
+#include <stdint.h>
+
+/*
+ * Register field helpers shared with intel_watermark's register dumper.
+ * The watermark registers pack their fields densely and sometimes split
+ * a value across two registers, hence the two-source variant.
+ */
+#define MASK(size) ((1 << (size)) - 1)
+
+#define REG_DECODE1(x, shift, size) \
+	(((x) >> (shift)) & MASK(size))
+
+#define REG_DECODE2(lo, shift_lo, size_lo, hi, shift_hi, size_hi) \
+	((((lo) >> (shift_lo)) & MASK(size_lo)) | \
+	 ((((hi) >> (shift_hi)) & MASK(size_hi)) << (size_lo)))
+
+/**
+ * igt_wm_config:
+ * @pixel_rate: pipe pixel rate in kHz
+ * @htotal: horizontal total in pixels
+ * @width: horizontal active width of the plane in pixels
+ * @cpp: plane bytes per pixel
+ * @latency: memory latency for the watermark level, in 0.1 us units
+ *
+ * One plane configuration to compute an expected watermark for.
+ */
+struct igt_wm_config {
+	uint32_t pixel_rate;
+	uint32_t htotal;
+	uint32_t width;
+	uint32_t cpp;
+	uint32_t latency;
+};
+
+uint32_t igt_wm_method1(uint32_t pixel_rate, uint32_t cpp, uint32_t latency);
+uint32_t igt_wm_method2(uint32_t pixel_rate, uint32_t htotal, uint32_t width,
+			uint32_t cpp, uint32_t latency);
+uint32_t igt_wm_ilk_plane(const struct igt_wm_config *config);
+uint32_t igt_wm_ilk_cursor(const struct igt_wm_config *config);
+uint32_t igt_wm_ilk_fbc(const struct igt_wm_config *config, uint32_t pri_val);
+uint32_t igt_wm_gmch(uint32_t pixel_rate, uint32_t cpp, uint32_t latency_ns,
+		     uint32_t fifo_size, uint32_t cacheline_size,
+		     uint32_t guard_size);
+
+void igt_wm_ilk_plane_batch(const struct igt_wm_config *configs,
+			    unsigned int count, uint32_t *results);
+void igt_wm_ilk_cursor_batch(const struct igt_wm_config *configs,
+			     unsigned int count, uint32_t *results);
+
+#endif /* IGT_WATERMARK_H */
@@ -38,7 +38,10 @@
 #endif
 
 #include "igt_x86.h"
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #define BASIC_CPUID 0x0
 #define EXTENDED_CPUID 0x80000000
@@ -167,3 +170,418 @@ char *igt_x86_features_to_string(unsigned features, char *line)
 
 	return ret;
 }
+
+/*
+ * CRC32C (Castagnoli, the polynomial the SSE4.2 crc32 instruction
+ * implements), bytewise with a table built on first use. This is the
+ * fallback when the hardware instruction is unavailable and the
+ * reference the hardware paths are checked against.
+ */
+static uint32_t crc32_sw(uint32_t crc, const void *src, unsigned long len)
+{
+	static uint32_t table[256];
+	const uint8_t *p = src;
+
+	if (!table[1]) {
+		int i, j;
+
+		for (i = 0; i < 256; i++) {
+			uint32_t v = i;
+
+			for (j = 0; j < 8; j++)
+				v = (v >> 1) ^ (v & 1 ? 0x82f63b78 : 0);
+			table[i] = v;
+		}
+	}
+
+	while (len--)
+		crc = table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	return crc;
+}
+
+/*
+ * Min/max/sum/sum-of-squares in one pass. The sums accumulate in
+ * doubles so they cannot overflow; this is the fallback when the
+ * vectorized path is unavailable and the reference it is checked
+ * against.
+ */
+static void u64_moments_plain(const uint64_t *values, unsigned long count,
+			      struct igt_u64_moments *m)
+{
+	uint64_t min = -1, max = 0;
+	double sum = 0., sumsq = 0.;
+
+	while (count--) {
+		uint64_t v = *values++;
+		double d = v;
+
+		if (v < min)
+			min = v;
+		if (v > max)
+			max = v;
+		sum += d;
+		sumsq += d * d;
+	}
+
+	m->min = min;
+	m->max = max;
+	m->sum = sum;
+	m->sumsq = sumsq;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+/*
+ * Ordinary loads from a WC mapping are uncached, one cacheline at a time,
+ * and crawl along at a few hundred MB/s. MOVNTDQA fills all the processor's
+ * write-combining buffers in parallel and so streams at memory bandwidth,
+ * but requires 16-byte aligned addresses; the unaligned edges are mopped up
+ * with plain memcpy.
+ */
+__attribute__((target("sse4.1")))
+static void memcpy_from_wc_sse41(void *dst, const void *src, unsigned long len)
+{
+	if ((uintptr_t)src & 15) {
+		unsigned long head = 16 - ((uintptr_t)src & 15);
+
+		if (head > len)
+			head = len;
+		memcpy(dst, src, head);
+		dst = (char *)dst + head;
+		src = (const char *)src + head;
+		len -= head;
+	}
+
+	while (len >= 64) {
+		__m128i *S = (__m128i *)src;
+		__m128i tmp[4];
+
+		tmp[0] = _mm_stream_load_si128(S + 0);
+		tmp[1] = _mm_stream_load_si128(S + 1);
+		tmp[2] = _mm_stream_load_si128(S + 2);
+		tmp[3] = _mm_stream_load_si128(S + 3);
+
+		_mm_storeu_si128((__m128i *)dst + 0, tmp[0]);
+		_mm_storeu_si128((__m128i *)dst + 1, tmp[1]);
+		_mm_storeu_si128((__m128i *)dst + 2, tmp[2]);
+		_mm_storeu_si128((__m128i *)dst + 3, tmp[3]);
+
+		dst = (char *)dst + 64;
+		src = (const char *)src + 64;
+		len -= 64;
+	}
+
+	while (len >= 16) {
+		_mm_storeu_si128(dst,
+				 _mm_stream_load_si128((__m128i *)src));
+
+		dst = (char *)dst + 16;
+		src = (const char *)src + 16;
+		len -= 16;
+	}
+
+	if (len)
+		memcpy(dst, src, len);
+}
+
+/* Streaming stores only need sse2, baseline on x86-64. */
+__attribute__((target("sse2")))
+static void memcpy_to_wc_sse2(void *dst, const void *src, unsigned long len)
+{
+	if ((uintptr_t)dst & 15) {
+		unsigned long head = 16 - ((uintptr_t)dst & 15);
+
+		if (head > len)
+			head = len;
+		memcpy(dst, src, head);
+		dst = (char *)dst + head;
+		src = (const char *)src + head;
+		len -= head;
+	}
+
+	while (len >= 64) {
+		__m128i tmp[4];
+
+		tmp[0] = _mm_loadu_si128((const __m128i *)src + 0);
+		tmp[1] = _mm_loadu_si128((const __m128i *)src + 1);
+		tmp[2] = _mm_loadu_si128((const __m128i *)src + 2);
+		tmp[3] = _mm_loadu_si128((const __m128i *)src + 3);
+
+		_mm_stream_si128((__m128i *)dst + 0, tmp[0]);
+		_mm_stream_si128((__m128i *)dst + 1, tmp[1]);
+		_mm_stream_si128((__m128i *)dst + 2, tmp[2]);
+		_mm_stream_si128((__m128i *)dst + 3, tmp[3]);
+
+		dst = (char *)dst + 64;
+		src = (const char *)src + 64;
+		len -= 64;
+	}
+
+	while (len >= 16) {
+		_mm_stream_si128(dst,
+				 _mm_loadu_si128((const __m128i *)src));
+
+		dst = (char *)dst + 16;
+		src = (const char *)src + 16;
+		len -= 16;
+	}
+
+	if (len)
+		memcpy(dst, src, len);
+
+	_mm_sfence();
+}
+
+static void memcpy_plain(void *dst, const void *src, unsigned long len)
+{
+	memcpy(dst, src, len);
+}
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32_hw(uint32_t crc, const void *src, unsigned long len)
+{
+	const uint8_t *p = src;
+
+#ifdef __x86_64__
+	while (len >= 8) {
+		uint64_t v;
+
+		memcpy(&v, p, 8);
+		crc = _mm_crc32_u64(crc, v);
+		p += 8;
+		len -= 8;
+	}
+#endif
+	while (len >= 4) {
+		uint32_t v;
+
+		memcpy(&v, p, 4);
+		crc = _mm_crc32_u32(crc, v);
+		p += 4;
+		len -= 4;
+	}
+
+	while (len--)
+		crc = _mm_crc32_u8(crc, *p++);
+
+	return crc;
+}
+
+/*
+ * Checksumming straight out of a WC mapping has the same problem as
+ * copying from one: ordinary loads are uncached and crawl. Stream
+ * 64-byte blocks into a cacheable bounce buffer with MOVNTDQA and feed
+ * the hardware CRC from there, so verifying a surface runs at memory
+ * bandwidth without pulling its contents through the LLC.
+ */
+__attribute__((target("sse4.2,sse4.1")))
+static uint32_t crc32_from_wc_sse42(uint32_t crc, const void *src,
+				    unsigned long len)
+{
+	if ((uintptr_t)src & 15) {
+		unsigned long head = 16 - ((uintptr_t)src & 15);
+
+		if (head > len)
+			head = len;
+		crc = crc32_hw(crc, src, head);
+		src = (const char *)src + head;
+		len -= head;
+	}
+
+	while (len >= 64) {
+		__m128i *S = (__m128i *)src;
+		__m128i tmp[4];
+
+		tmp[0] = _mm_stream_load_si128(S + 0);
+		tmp[1] = _mm_stream_load_si128(S + 1);
+		tmp[2] = _mm_stream_load_si128(S + 2);
+		tmp[3] = _mm_stream_load_si128(S + 3);
+
+		crc = crc32_hw(crc, tmp, 64);
+
+		src = (const char *)src + 64;
+		len -= 64;
+	}
+
+	while (len >= 16) {
+		__m128i tmp = _mm_stream_load_si128((__m128i *)src);
+
+		crc = crc32_hw(crc, &tmp, 16);
+
+		src = (const char *)src + 16;
+		len -= 16;
+	}
+
+	if (len)
+		crc = crc32_hw(crc, src, len);
+
+	return crc;
+}
+
+/*
+ * Four lanes of min/max/sum/sum-of-squares at a time. AVX2 has no
+ * unsigned 64-bit compare, so values are biased into the signed domain
+ * for VPCMPGTQ, and no u64-to-double conversion, so the usual exponent
+ * trick substitutes: OR-ing in 2^52's exponent places the integer in
+ * the mantissa of (2^52 + v), and subtracting 2^52 recovers it. The
+ * conversion is only exact below 2^52 (52 days in nanoseconds); bigger
+ * samples bail out to the scalar loop.
+ */
+__attribute__((target("avx2")))
+static bool u64_moments_avx2(const uint64_t *values, unsigned long count,
+			     struct igt_u64_moments *m)
+{
+	const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+	const __m256i expo = _mm256_set1_epi64x(0x4330000000000000ll);
+	const __m256d bias = _mm256_set1_pd(0x1p52);
+	__m256i vmin = _mm256_set1_epi64x(INT64_MAX);
+	__m256i vmax = sign;
+	__m256i large = _mm256_setzero_si256();
+	__m256d vsum = _mm256_setzero_pd();
+	__m256d vsumsq = _mm256_setzero_pd();
+	uint64_t mn[4], mx[4];
+	double sum[4], sumsq[4];
+	unsigned long n;
+	int i;
+
+	for (n = 0; n + 4 <= count; n += 4) {
+		__m256i x = _mm256_loadu_si256((const __m256i *)(values + n));
+		__m256i bx = _mm256_xor_si256(x, sign);
+		__m256d d;
+
+		large = _mm256_or_si256(large, x);
+
+		vmin = _mm256_blendv_epi8(vmin, bx,
+					  _mm256_cmpgt_epi64(vmin, bx));
+		vmax = _mm256_blendv_epi8(vmax, bx,
+					  _mm256_cmpgt_epi64(bx, vmax));
+
+		d = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(x, expo)),
+				  bias);
+		vsum = _mm256_add_pd(vsum, d);
+		vsumsq = _mm256_add_pd(vsumsq, _mm256_mul_pd(d, d));
+	}
+
+	if (!_mm256_testz_si256(large,
+				_mm256_set1_epi64x(~((1ll << 52) - 1))))
+		return false;
+
+	/* the tail, and the min/max/sum identity elements */
+	u64_moments_plain(values + n, count - n, m);
+
+	_mm256_storeu_si256((__m256i *)mn, _mm256_xor_si256(vmin, sign));
+	_mm256_storeu_si256((__m256i *)mx, _mm256_xor_si256(vmax, sign));
+	_mm256_storeu_pd(sum, vsum);
+	_mm256_storeu_pd(sumsq, vsumsq);
+
+	for (i = 0; i < 4; i++) {
+		if (mn[i] < m->min)
+			m->min = mn[i];
+		if (mx[i] > m->max)
+			m->max = mx[i];
+		m->sum += sum[i];
+		m->sumsq += sumsq[i];
+	}
+
+	return true;
+}
+
+void igt_memcpy_from_wc(void *dst, const void *src, unsigned long len)
+{
+	static void (*fn)(void *dst, const void *src, unsigned long len);
+
+	if (!fn) {
+		if (igt_x86_features() & SSE4_1)
+			fn = memcpy_from_wc_sse41;
+		else
+			fn = memcpy_plain;
+	}
+
+	fn(dst, src, len);
+}
+
+void igt_u64_moments(const uint64_t *values, unsigned long count,
+		     struct igt_u64_moments *m)
+{
+	static int have_avx2;
+
+	if (!have_avx2)
+		have_avx2 = igt_x86_features() & AVX2 ? 1 : -1;
+
+	if (have_avx2 < 0 || !u64_moments_avx2(values, count, m))
+		u64_moments_plain(values, count, m);
+}
+
+void igt_memcpy_to_wc(void *dst, const void *src, unsigned long len)
+{
+	static void (*fn)(void *dst, const void *src, unsigned long len);
+
+	if (!fn) {
+		if (igt_x86_features() & SSE2)
+			fn = memcpy_to_wc_sse2;
+		else
+			fn = memcpy_plain;
+	}
+
+	fn(dst, src, len);
+}
+
+uint32_t igt_crc32(uint32_t crc, const void *src, unsigned long len)
+{
+	static uint32_t (*fn)(uint32_t crc, const void *src,
+			      unsigned long len);
+
+	if (!fn) {
+		if (igt_x86_features() & SSE4_2)
+			fn = crc32_hw;
+		else
+			fn = crc32_sw;
+	}
+
+	return fn(crc, src, len);
+}
+
+uint32_t igt_crc32_from_wc(uint32_t crc, const void *src, unsigned long len)
+{
+	static uint32_t (*fn)(uint32_t crc, const void *src,
+			      unsigned long len);
+
+	if (!fn) {
+		if ((igt_x86_features() & (SSE4_1 | SSE4_2)) ==
+		    (SSE4_1 | SSE4_2))
+			fn = crc32_from_wc_sse42;
+		else
+			fn = crc32_sw;
+	}
+
+	return fn(crc, src, len);
+}
+#else
+void igt_memcpy_from_wc(void *dst, const void *src, unsigned long len)
+{
+	memcpy(dst, src, len);
+}
+
+void igt_memcpy_to_wc(void *dst, const void *src, unsigned long len)
+{
+	memcpy(dst, src, len);
+}
+
+uint32_t igt_crc32(uint32_t crc, const void *src, unsigned long len)
+{
+	return crc32_sw(crc, src, len);
+}
+
+uint32_t igt_crc32_from_wc(uint32_t crc, const void *src, unsigned long len)
+{
+	return crc32_sw(crc, src, len);
+}
+
+void igt_u64_moments(const uint64_t *values, unsigned long count,
+		     struct igt_u64_moments *m)
+{
+	u64_moments_plain(values, count, m);
+}
+#endif
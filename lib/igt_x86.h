@@ -30,6 +30,8 @@
 #ifndef IGT_X86_H
 #define IGT_X86_H
 
+#include <stdint.h>
+
 #define MMX	0x1
 #define SSE	0x2
 #define SSE2	0x4
@@ -43,4 +45,22 @@
 unsigned igt_x86_features(void);
 char *igt_x86_features_to_string(unsigned features, char *line);
 
+void igt_memcpy_from_wc(void *dst, const void *src, unsigned long len);
+void igt_memcpy_to_wc(void *dst, const void *src, unsigned long len);
+
+/* CRC32C; the _from_wc variant streams its reads and so doesn't
+ * pollute the cache with the buffer contents. */
+uint32_t igt_crc32(uint32_t crc, const void *src, unsigned long len);
+uint32_t igt_crc32_from_wc(uint32_t crc, const void *src, unsigned long len);
+
+/* Single-pass summary of an array of samples, vectorized when the CPU
+ * allows; what igt_stats folds in when ingesting samples in bulk. */
+struct igt_u64_moments {
+	uint64_t min, max;
+	double sum, sumsq;
+};
+
+void igt_u64_moments(const uint64_t *values, unsigned long count,
+		     struct igt_u64_moments *m);
+
 #endif /* IGT_X86_H */
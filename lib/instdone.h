@@ -36,7 +36,7 @@ struct instdone_bit {
 	const char *name;
 };
 
-extern struct instdone_bit instdone_bits[MAX_INSTDONE_BITS];
+extern const struct instdone_bit *instdone_bits;
 extern int num_instdone_bits;
 
 bool init_instdone_definitions(uint32_t devid);
@@ -29,6 +29,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h> /* ffs() */
 #include <assert.h>
 
 #include "drm.h"
@@ -65,6 +66,80 @@
  * library as a dependency.
  */
 
+/*
+ * Small free list recycling batch and scratch bos, keyed by size. A test
+ * flushing thousands of batches otherwise allocates a fresh 4KiB bo per
+ * flush; pulling an idle bo back out of the pool makes steady-state batch
+ * submission free of gem_create calls. Busy bos stay in the pool rather
+ * than stalling the allocation on them.
+ */
+#define BO_POOL_SIZE 16
+
+static struct {
+	drm_intel_bo *bo;
+	unsigned long size;
+} bo_pool[BO_POOL_SIZE];
+
+/**
+ * intel_bo_pool_alloc:
+ * @bufmgr: libdrm buffer manager
+ * @name: name for the buffer object, used on fresh allocations
+ * @size: size of the buffer object
+ *
+ * Allocates a buffer object through the recycling pool: an idle pooled bo of
+ * the right size is reused, only a miss goes to drm_intel_bo_alloc(). Return
+ * the bo to the pool with intel_bo_pool_put() instead of dropping the last
+ * reference.
+ *
+ * Returns: The allocated buffer object.
+ */
+drm_intel_bo *
+intel_bo_pool_alloc(drm_intel_bufmgr *bufmgr, const char *name,
+		    unsigned long size)
+{
+	int i;
+
+	for (i = 0; i < BO_POOL_SIZE; i++) {
+		drm_intel_bo *bo = bo_pool[i].bo;
+
+		if (!bo || bo->bufmgr != bufmgr || bo_pool[i].size != size)
+			continue;
+
+		if (drm_intel_bo_busy(bo))
+			continue;
+
+		bo_pool[i].bo = NULL;
+		return bo;
+	}
+
+	return drm_intel_bo_alloc(bufmgr, name, size, 4096);
+}
+
+/**
+ * intel_bo_pool_put:
+ * @bo: buffer object from intel_bo_pool_alloc()
+ *
+ * Returns @bo to the recycling pool for reuse by a later
+ * intel_bo_pool_alloc() of the same size. If the pool is full the reference
+ * is dropped instead.
+ */
+void
+intel_bo_pool_put(drm_intel_bo *bo)
+{
+	int i;
+
+	for (i = 0; i < BO_POOL_SIZE; i++) {
+		if (bo_pool[i].bo)
+			continue;
+
+		bo_pool[i].bo = bo;
+		bo_pool[i].size = bo->size;
+		return;
+	}
+
+	drm_intel_bo_unreference(bo);
+}
+
 /**
  * intel_batchbuffer_reset:
  * @batch: batchbuffer object
@@ -74,14 +149,28 @@
 void
 intel_batchbuffer_reset(struct intel_batchbuffer *batch)
 {
-	if (batch->bo != NULL) {
-		drm_intel_bo_unreference(batch->bo);
-		batch->bo = NULL;
+	if (batch->pipelined) {
+		/*
+		 * Rotate between two bos: the next batch is assembled and
+		 * uploaded into one while its predecessor executes out of the
+		 * other. Should the incoming bo still be busy by the time the
+		 * next flush happens, the pwrite in bo_subdata waits for it,
+		 * which is the only throttle needed for reuse.
+		 */
+		drm_intel_bo *next = batch->spare_bo;
+
+		batch->spare_bo = batch->bo;
+		batch->bo = next;
+	} else {
+		if (batch->bo != NULL) {
+			intel_bo_pool_put(batch->bo);
+			batch->bo = NULL;
+		}
+
+		batch->bo = intel_bo_pool_alloc(batch->bufmgr, "batchbuffer",
+						BATCH_SZ);
 	}
 
-	batch->bo = drm_intel_bo_alloc(batch->bufmgr, "batchbuffer",
-				       BATCH_SZ, 4096);
-
 	memset(batch->buffer, 0, sizeof(batch->buffer));
 	batch->ctx = NULL;
 
@@ -121,11 +210,91 @@ intel_batchbuffer_alloc(drm_intel_bufmgr *bufmgr, uint32_t devid)
 void
 intel_batchbuffer_free(struct intel_batchbuffer *batch)
 {
-	drm_intel_bo_unreference(batch->bo);
+	int i;
+
+	for (i = 0; i < BATCH_SOFTPIN_SLOTS && batch->softpin_slots[i].bo; i++)
+		drm_intel_bo_unreference(batch->softpin_slots[i].bo);
+
+	if (batch->spare_bo)
+		intel_bo_pool_put(batch->spare_bo);
+	intel_bo_pool_put(batch->bo);
 	batch->bo = NULL;
 	free(batch);
 }
 
+/* base of the softpin arena; the bottom of the ppgtt is left alone */
+#define SOFTPIN_BASE (1ull << 28)
+#define SOFTPIN_ALIGN (1ull << 16)
+
+/**
+ * intel_batchbuffer_enable_softpin:
+ * @batch: batchbuffer object
+ *
+ * Switches @batch to softpinned (no-reloc) mode: every buffer referenced
+ * through intel_batchbuffer_emit_reloc() gets a fixed gpu address from a
+ * simple bump allocator and is submitted with EXEC_OBJECT_PINNED, so the
+ * kernel has no relocations to process. The pre-computed address emitted
+ * into the batch is the real one, not a presumed one.
+ *
+ * Addresses stay below 4G and are never reused for the lifetime of @batch,
+ * which keeps a reference on every buffer it has pinned. Softpinning
+ * requires full ppgtt and so gen8 and newer.
+ */
+void
+intel_batchbuffer_enable_softpin(struct intel_batchbuffer *batch)
+{
+	igt_assert(batch->gen >= 8);
+
+	batch->softpin = true;
+	if (!batch->softpin_next)
+		batch->softpin_next = SOFTPIN_BASE;
+}
+
+/**
+ * intel_batchbuffer_enable_pipelining:
+ * @batch: batchbuffer object
+ *
+ * Switches @batch to double-buffered submission: each flush rotates to a
+ * second bo so the following batch is assembled and uploaded while its
+ * predecessor still executes, keeping both CPU and GPU busy in emit-bound
+ * loops. The CPU-side staging array needs no twin since bo_subdata snapshots
+ * it during the flush; only reuse of the gem bos has to wait, and that is
+ * handled by the pwrite blocking on a still-busy bo.
+ */
+void
+intel_batchbuffer_enable_pipelining(struct intel_batchbuffer *batch)
+{
+	if (batch->pipelined)
+		return;
+
+	batch->pipelined = true;
+	batch->spare_bo = intel_bo_pool_alloc(batch->bufmgr, "batchbuffer",
+					      BATCH_SZ);
+}
+
+static void softpin_add(struct intel_batchbuffer *batch, drm_intel_bo *bo)
+{
+	uint64_t size;
+	int i;
+
+	for (i = 0; i < BATCH_SOFTPIN_SLOTS && batch->softpin_slots[i].bo; i++)
+		if (batch->softpin_slots[i].bo == bo)
+			return;
+
+	igt_assert_f(i < BATCH_SOFTPIN_SLOTS,
+		     "too many softpinned buffers on one batch\n");
+
+	do_or_die(drm_intel_bo_set_softpin_offset(bo, batch->softpin_next));
+
+	drm_intel_bo_reference(bo);
+	batch->softpin_slots[i].bo = bo;
+	batch->softpin_slots[i].offset = batch->softpin_next;
+
+	size = (bo->size + SOFTPIN_ALIGN - 1) & ~(SOFTPIN_ALIGN - 1);
+	batch->softpin_next += size;
+	igt_assert(batch->softpin_next < (1ull << 32));
+}
+
 #define CMD_POLY_STIPPLE_OFFSET       0x7906
 
 static unsigned int
@@ -270,6 +439,14 @@ intel_batchbuffer_emit_reloc(struct intel_batchbuffer *batch,
 			 batch->ptr, batch->buffer,
 			 (int)(batch->ptr - batch->buffer), BATCH_SZ);
 
+	/*
+	 * Once the target has a softpin offset, libdrm only puts it on the
+	 * validation list instead of growing the relocation table, so the
+	 * execbuf below carries zero relocations.
+	 */
+	if (batch->softpin)
+		softpin_add(batch, buffer);
+
 	if (fenced)
 		ret = drm_intel_bo_emit_reloc_fence(batch->bo, batch->ptr - batch->buffer,
 						    buffer, delta,
@@ -717,6 +894,76 @@ void igt_blitter_fast_copy(struct intel_batchbuffer *batch,
 	intel_batchbuffer_flush(batch);
 }
 
+/*
+ * Dispatch table for the per-gen fill/copy/spin implementations.
+ *
+ * The igt_get_*func() selectors used to walk IS_GEN()/IS_xxx()
+ * predicate chains on every call, and each predicate is an
+ * intel_get_device_info() lookup of its own, which adds up for tests
+ * that select per iteration.  Resolve the device once into a function
+ * table instead; this is also the single place to add further per-gen
+ * specializations.
+ */
+struct igt_device_funcs {
+	igt_render_copyfunc_t render_copy;
+	igt_fillfunc_t media_fill;
+	igt_fillfunc_t gpgpu_fill;
+	igt_media_spinfunc_t media_spin;
+};
+
+static void igt_resolve_device_funcs(const struct intel_device_info *info,
+				     struct igt_device_funcs *funcs)
+{
+	switch (ffs(info->gen)) {
+	case 2:
+		funcs->render_copy = gen2_render_copyfunc;
+		break;
+	case 3:
+		funcs->render_copy = gen3_render_copyfunc;
+		break;
+	case 6:
+		funcs->render_copy = gen6_render_copyfunc;
+		break;
+	case 7:
+		funcs->render_copy = gen7_render_copyfunc;
+		funcs->media_fill = gen7_media_fillfunc;
+		funcs->gpgpu_fill = gen7_gpgpu_fillfunc;
+		break;
+	case 8:
+		funcs->render_copy = gen8_render_copyfunc;
+		if (info->is_broadwell) {
+			funcs->media_fill = gen8_media_fillfunc;
+			funcs->gpgpu_fill = gen8_gpgpu_fillfunc;
+			funcs->media_spin = gen8_media_spinfunc;
+		} else if (info->is_cherryview) {
+			funcs->media_fill = gen8lp_media_fillfunc;
+			funcs->media_spin = gen8lp_media_spinfunc;
+		}
+		break;
+	case 9:
+		funcs->render_copy = gen9_render_copyfunc;
+		funcs->media_fill = gen9_media_fillfunc;
+		funcs->gpgpu_fill = gen9_gpgpu_fillfunc;
+		funcs->media_spin = gen9_media_spinfunc;
+		break;
+	}
+}
+
+static const struct igt_device_funcs *igt_get_device_funcs(int devid)
+{
+	static struct igt_device_funcs cache;
+	static int cached_devid;
+
+	if (cached_devid == devid)
+		return &cache;
+
+	memset(&cache, 0, sizeof(cache));
+	igt_resolve_device_funcs(intel_get_device_info(devid), &cache);
+	cached_devid = devid;
+
+	return &cache;
+}
+
 /**
  * igt_get_render_copyfunc:
  * @devid: pci device id
@@ -729,22 +976,7 @@ void igt_blitter_fast_copy(struct intel_batchbuffer *batch,
  */
 igt_render_copyfunc_t igt_get_render_copyfunc(int devid)
 {
-	igt_render_copyfunc_t copy = NULL;
-
-	if (IS_GEN2(devid))
-		copy = gen2_render_copyfunc;
-	else if (IS_GEN3(devid))
-		copy = gen3_render_copyfunc;
-	else if (IS_GEN6(devid))
-		copy = gen6_render_copyfunc;
-	else if (IS_GEN7(devid))
-		copy = gen7_render_copyfunc;
-	else if (IS_GEN8(devid))
-		copy = gen8_render_copyfunc;
-	else if (IS_GEN9(devid))
-		copy = gen9_render_copyfunc;
-
-	return copy;
+	return igt_get_device_funcs(devid)->render_copy;
 }
 
 /**
@@ -758,18 +990,7 @@ igt_render_copyfunc_t igt_get_render_copyfunc(int devid)
  */
 igt_fillfunc_t igt_get_media_fillfunc(int devid)
 {
-	igt_fillfunc_t fill = NULL;
-
-	if (IS_GEN9(devid))
-		fill = gen9_media_fillfunc;
-	else if (IS_BROADWELL(devid))
-		fill = gen8_media_fillfunc;
-	else if (IS_GEN7(devid))
-		fill = gen7_media_fillfunc;
-	else if (IS_CHERRYVIEW(devid))
-		fill = gen8lp_media_fillfunc;
-
-	return fill;
+	return igt_get_device_funcs(devid)->media_fill;
 }
 
 /**
@@ -783,16 +1004,7 @@ igt_fillfunc_t igt_get_media_fillfunc(int devid)
  */
 igt_fillfunc_t igt_get_gpgpu_fillfunc(int devid)
 {
-	igt_fillfunc_t fill = NULL;
-
-	if (IS_GEN7(devid))
-		fill = gen7_gpgpu_fillfunc;
-	else if (IS_BROADWELL(devid))
-		fill = gen8_gpgpu_fillfunc;
-	else if (IS_GEN9(devid))
-		fill = gen9_gpgpu_fillfunc;
-
-	return fill;
+	return igt_get_device_funcs(devid)->gpgpu_fill;
 }
 
 /**
@@ -806,14 +1018,5 @@ igt_fillfunc_t igt_get_gpgpu_fillfunc(int devid)
  */
 igt_media_spinfunc_t igt_get_media_spinfunc(int devid)
 {
-	igt_media_spinfunc_t spin = NULL;
-
-	if (IS_GEN9(devid))
-		spin = gen9_media_spinfunc;
-	else if (IS_BROADWELL(devid))
-		spin = gen8_media_spinfunc;
-	else if (IS_CHERRYVIEW(devid))
-		spin = gen8lp_media_spinfunc;
-
-	return spin;
+	return igt_get_device_funcs(devid)->media_spin;
 }
@@ -11,6 +11,8 @@
 #define BATCH_SZ 4096
 #define BATCH_RESERVED 16
 
+#define BATCH_SOFTPIN_SLOTS 64
+
 struct intel_batchbuffer {
 	drm_intel_bufmgr *bufmgr;
 	uint32_t devid;
@@ -19,6 +21,16 @@ struct intel_batchbuffer {
 	drm_intel_context *ctx;
 	drm_intel_bo *bo;
 
+	bool pipelined;
+	drm_intel_bo *spare_bo;
+
+	bool softpin;
+	uint64_t softpin_next;
+	struct {
+		drm_intel_bo *bo;
+		uint64_t offset;
+	} softpin_slots[BATCH_SOFTPIN_SLOTS];
+
 	uint8_t buffer[BATCH_SZ];
 	uint8_t *ptr, *end;
 	uint8_t *state;
@@ -27,9 +39,16 @@ struct intel_batchbuffer {
 struct intel_batchbuffer *intel_batchbuffer_alloc(drm_intel_bufmgr *bufmgr,
 						  uint32_t devid);
 
+drm_intel_bo *intel_bo_pool_alloc(drm_intel_bufmgr *bufmgr, const char *name,
+				  unsigned long size);
+void intel_bo_pool_put(drm_intel_bo *bo);
+
 void intel_batchbuffer_set_context(struct intel_batchbuffer *batch,
 				   drm_intel_context *ctx);
 
+void intel_batchbuffer_enable_softpin(struct intel_batchbuffer *batch);
+void intel_batchbuffer_enable_pipelining(struct intel_batchbuffer *batch);
+
 
 void intel_batchbuffer_free(struct intel_batchbuffer *batch);
 
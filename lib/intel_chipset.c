@@ -127,16 +127,28 @@ extern uint16_t __drm_device_id;
 uint32_t
 intel_get_drm_devid(int fd)
 {
-	const char *override;
+	static uint32_t override;
+	static bool override_checked;
 
 	igt_assert(is_i915_device(fd));
 	igt_assert(__drm_device_id);
 
-	override = getenv("INTEL_DEVID_OVERRIDE");
+	/*
+	 * This sits underneath every feature macro and gen check, so only
+	 * consult the environment once instead of on each call.
+	 */
+	if (!override_checked) {
+		const char *env = getenv("INTEL_DEVID_OVERRIDE");
+
+		if (env)
+			override = strtol(env, NULL, 0);
+		override_checked = true;
+	}
+
 	if (override)
-		return strtol(override, NULL, 0);
-	else
-		return __drm_device_id;
+		return override;
+
+	return __drm_device_id;
 }
 
 /**
@@ -1,9 +1,11 @@
 #include "intel_chipset.h"
 #include "i915_pciids.h"
 
+#include <stdlib.h> /* qsort(), bsearch() */
 #include <strings.h> /* ffs() */
 
 #define BIT(x) (1<<(x))
+#define ARRAY_SIZE(arr) (sizeof(arr)/sizeof(arr[0]))
 
 static const struct intel_device_info intel_generic_info = {
 	.gen = 0,
@@ -247,25 +249,54 @@ static const struct pci_id_match intel_device_match[] = {
  * Returns:
  * The associated intel_get_device_info
  */
+struct intel_device_index {
+	uint16_t devid;
+	const struct intel_device_info *info;
+};
+
+static struct intel_device_index device_index[ARRAY_SIZE(intel_device_match)];
+static int device_index_count;
+
+static int device_index_cmp(const void *_a, const void *_b)
+{
+	const struct intel_device_index *a = _a, *b = _b;
+
+	return (int)a->devid - (int)b->devid;
+}
+
+static void build_device_index(void)
+{
+	int i;
+
+	for (i = 0; intel_device_match[i].device_id != PCI_MATCH_ANY; i++) {
+		device_index[i].devid = intel_device_match[i].device_id;
+		device_index[i].info =
+			(void *)intel_device_match[i].match_data;
+	}
+
+	device_index_count = i;
+	qsort(device_index, device_index_count, sizeof(device_index[0]),
+	      device_index_cmp);
+}
+
 const struct intel_device_info *intel_get_device_info(uint16_t devid)
 {
 	static const struct intel_device_info *cache = &intel_generic_info;
 	static uint16_t cached_devid;
-	int i;
+	struct intel_device_index key = { .devid = devid }, *entry;
 
 	if (cached_devid == devid)
-		goto out;
+		return cache;
 
-	/* XXX Presort table and bsearch! */
-	for (i = 0; intel_device_match[i].device_id != PCI_MATCH_ANY; i++) {
-		if (devid == intel_device_match[i].device_id)
-			break;
-	}
+	if (!device_index_count)
+		build_device_index();
+
+	entry = bsearch(&key, device_index, device_index_count,
+			sizeof(device_index[0]), device_index_cmp);
 
 	cached_devid = devid;
-	cache = (void *)intel_device_match[i].match_data;
+	cache = entry ? entry->info : &intel_generic_info;
 
-out:
 	return cache;
 }
 
@@ -35,6 +35,36 @@
 extern void *igt_global_mmio;
 void intel_mmio_use_pci_bar(struct pci_device *pci_dev);
 void intel_mmio_use_dump_file(char *file);
+void intel_mmio_use_shared_file(const char *file);
+
+/* Wire protocol between the intel_forcewaked daemon and the register
+ * tools. A connected client holds one refcounted forcewake lease from
+ * ACQUIRE until RELEASE or disconnect; the ACQUIRE reply carries the fd
+ * of the register window (the PCI resource file) via SCM_RIGHTS, so the
+ * client maps the live window instead of paying its own forcewake
+ * acquire/release round trip.
+ */
+#define INTEL_FORCEWAKED_SOCKET	"/var/run/intel_forcewaked.sock"
+#define INTEL_FORCEWAKED_MAGIC	0x46574c53	/* "FWLS" */
+
+enum intel_forcewaked_cmd {
+	INTEL_FORCEWAKED_ACQUIRE,
+	INTEL_FORCEWAKED_RELEASE,
+};
+
+struct intel_forcewaked_request {
+	uint32_t magic;
+	uint32_t cmd;
+};
+
+struct intel_forcewaked_reply {
+	uint32_t magic;
+	int32_t status;		/* 0 on success, -errno otherwise */
+	uint32_t devid;
+	uint32_t mmio_size;
+};
+
+int intel_mmio_use_forcewake_lease(struct pci_device *pci_dev);
 
 int intel_register_access_init(struct pci_device *pci_dev, int safe, int fd);
 void intel_register_access_fini(void);
@@ -57,6 +87,17 @@ void intel_flisdsi_reg_write(uint32_t reg, uint32_t val);
 uint32_t intel_iosf_sb_read(uint32_t port, uint32_t reg);
 void intel_iosf_sb_write(uint32_t port, uint32_t reg, uint32_t val);
 
+/* batched sideband reads: fill in port/addr, results land in val/ret */
+struct intel_iosf_sb_req {
+	uint32_t port;
+	uint32_t addr;
+	uint32_t val;
+	int ret;
+};
+int intel_iosf_sb_read_batch(struct intel_iosf_sb_req *reqs, int count);
+int intel_iosf_sb_snapshot(uint32_t port, const uint32_t *addrs,
+			   uint32_t *vals, int count);
+
 int intel_punit_read(uint32_t addr, uint32_t *val);
 int intel_punit_write(uint32_t addr, uint32_t val);
 int intel_nc_read(uint32_t addr, uint32_t *val);
@@ -79,6 +120,7 @@ struct intel_register_range {
 
 struct intel_register_map {
 	struct intel_register_range *map;
+	uint32_t count; /* number of ranges, excluding the END sentinel */
 	uint32_t top;
 	uint32_t alignment_mask;
 };
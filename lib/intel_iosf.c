@@ -19,12 +19,41 @@
 /* Private register write, double-word addressing, non-posted */
 #define SB_CRWRDA_NP   0x07
 
+/* Wait for the mailbox to complete the posted transaction.  Most
+ * transactions finish within a couple of register reads, so poll
+ * busily for a while before backing off to usleep(); the back-off
+ * otherwise puts a 1us floor under every sideband access.
+ */
+static int vlv_sideband_wait(const char *what, uint32_t addr)
+{
+	int timeout = 0;
+	int spin;
+
+	for (spin = 0; spin < 100; spin++) {
+		if (!(intel_register_read(VLV_IOSF_DOORBELL_REQ) & IOSF_SB_BUSY))
+			return 0;
+	}
+
+	do {
+		usleep(1);
+		timeout++;
+	} while (intel_register_read(VLV_IOSF_DOORBELL_REQ) & IOSF_SB_BUSY &&
+		 timeout < TIMEOUT_US);
+
+	if (timeout >= TIMEOUT_US) {
+		igt_warn("timeout waiting for pcode %s (%d) to finish\n", what, addr);
+		return -ETIMEDOUT;
+	}
+
+	return 0;
+}
+
 static int vlv_sideband_rw(uint32_t port, uint8_t opcode, uint32_t addr,
 			   uint32_t *val)
 {
-	int timeout = 0;
 	uint32_t cmd, devfn, be, bar;
 	int is_read = (opcode == SB_CRRDDA_NP || opcode == SB_MRD_NP);
+	int ret;
 
 	bar = 0;
 	be = 0xf;
@@ -45,16 +74,9 @@ static int vlv_sideband_rw(uint32_t port, uint8_t opcode, uint32_t addr,
 
 	intel_register_write(VLV_IOSF_DOORBELL_REQ, cmd);
 
-	do {
-		usleep(1);
-		timeout++;
-	} while (intel_register_read(VLV_IOSF_DOORBELL_REQ) & IOSF_SB_BUSY &&
-		 timeout < TIMEOUT_US);
-
-	if (timeout >= TIMEOUT_US) {
-		igt_warn("timeout waiting for pcode %s (%d) to finish\n", is_read ? "read" : "write", addr);
-		return -ETIMEDOUT;
-	}
+	ret = vlv_sideband_wait(is_read ? "read" : "write", addr);
+	if (ret)
+		return ret;
 
 	if (is_read)
 		*val = intel_register_read(VLV_IOSF_DATA);
@@ -187,3 +209,90 @@ void intel_iosf_sb_write(uint32_t port, uint32_t reg, uint32_t val)
 {
 	vlv_sideband_rw(port, SB_CRWRDA_NP, reg, &val);
 }
+
+/**
+ * intel_iosf_sb_read_batch:
+ * @reqs: array of read requests, with port and addr filled in
+ * @count: number of requests
+ *
+ * Drains a whole batch of sideband reads in one go: the mailbox busy
+ * check is done once up front instead of per register, each request
+ * then waits for its own completion (leaving the mailbox idle for the
+ * next) and the data register is only scrubbed after the last one.
+ * This cuts enough per-register overhead that sampling dozens of
+ * punit/cck registers per iteration becomes feasible.
+ *
+ * The per-request result is stored in the val and ret members; a
+ * failed request does not stop the rest of the batch.
+ *
+ * Returns:
+ * 0 when all requests succeeded, otherwise the error code of the first
+ * failed request.
+ */
+int intel_iosf_sb_read_batch(struct intel_iosf_sb_req *reqs, int count)
+{
+	uint32_t cmd;
+	int i, ret = 0;
+
+	if (intel_register_read(VLV_IOSF_DOORBELL_REQ) & IOSF_SB_BUSY) {
+		igt_warn("warning: pcode (read) mailbox access failed\n");
+		return -EAGAIN;
+	}
+
+	for (i = 0; i < count; i++) {
+		cmd = (SB_CRRDDA_NP << IOSF_OPCODE_SHIFT) |
+			(reqs[i].port << IOSF_PORT_SHIFT) |
+			(0xf << IOSF_BYTE_ENABLES_SHIFT);
+
+		intel_register_write(VLV_IOSF_ADDR, reqs[i].addr);
+		intel_register_write(VLV_IOSF_DOORBELL_REQ, cmd);
+
+		reqs[i].ret = vlv_sideband_wait("read", reqs[i].addr);
+		if (reqs[i].ret == 0)
+			reqs[i].val = intel_register_read(VLV_IOSF_DATA);
+		else if (ret == 0)
+			ret = reqs[i].ret;
+	}
+
+	intel_register_write(VLV_IOSF_DATA, 0);
+
+	return ret;
+}
+
+/**
+ * intel_iosf_sb_snapshot:
+ * @port: sideband port (IOSF_PORT_PUNIT, IOSF_PORT_CCK, ...)
+ * @addrs: array of register offsets to read
+ * @vals: array receiving the register values
+ * @count: number of registers
+ *
+ * Convenience wrapper around intel_iosf_sb_read_batch() for taking a
+ * snapshot of several registers of one unit.
+ *
+ * Returns:
+ * 0 when all registers were read, otherwise the error code of the
+ * first failed read.
+ */
+int intel_iosf_sb_snapshot(uint32_t port, const uint32_t *addrs,
+			   uint32_t *vals, int count)
+{
+	struct intel_iosf_sb_req *reqs;
+	int i, ret;
+
+	reqs = calloc(count, sizeof(*reqs));
+	igt_assert(reqs);
+
+	for (i = 0; i < count; i++) {
+		reqs[i].port = port;
+		reqs[i].addr = addrs[i];
+	}
+
+	ret = intel_iosf_sb_read_batch(reqs, count);
+
+	for (i = 0; i < count; i++)
+		vals[i] = reqs[i].val;
+
+	free(reqs);
+
+	return ret;
+}
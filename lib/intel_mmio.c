@@ -40,6 +40,8 @@
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include "intel_io.h"
 #include "igt_core.h"
@@ -79,6 +81,7 @@ static struct _mmio_data {
 	uint32_t i915_devid;
 	struct intel_register_map map;
 	int key;
+	int fd;
 } mmio_data;
 
 /**
@@ -114,6 +117,10 @@ intel_mmio_use_dump_file(char *file)
  *
  * @pci_dev can be obtained from intel_get_pci_device().
  */
+static void *mapped_bar;
+static uint16_t mapped_domain;
+static uint8_t mapped_bus, mapped_dev, mapped_func;
+
 void
 intel_mmio_use_pci_bar(struct pci_device *pci_dev)
 {
@@ -135,6 +142,25 @@ intel_mmio_use_pci_bar(struct pci_device *pci_dev)
 	else
 		mmio_size = 2*1024*1024;
 
+	/* Mapping the BAR involves walking sysfs and an mmap per call;
+	 * tools doing repeated init/fini cycles only need it done once
+	 * per process, so remember the mapping.
+	 */
+	if (igt_global_mmio == NULL &&
+	    mapped_bar && pci_dev->domain == mapped_domain &&
+	    pci_dev->bus == mapped_bus && pci_dev->dev == mapped_dev &&
+	    pci_dev->func == mapped_func) {
+		igt_global_mmio = mapped_bar;
+		return;
+	}
+
+	/* A running intel_forcewaked already holds the wake and hands the
+	 * register window over its socket; prefer that over mapping the
+	 * BAR ourselves so short-lived tools skip the forcewake dance.
+	 */
+	if (intel_mmio_use_forcewake_lease(pci_dev) == 0)
+		return;
+
 	error = pci_device_map_range (pci_dev,
 				      pci_dev->regions[mmio_bar].base_addr,
 				      mmio_size,
@@ -143,14 +169,126 @@ intel_mmio_use_pci_bar(struct pci_device *pci_dev)
 
 	igt_fail_on_f(error != 0,
 		      "Couldn't map MMIO region\n");
+
+	mapped_bar = igt_global_mmio;
+	mapped_domain = pci_dev->domain;
+	mapped_bus = pci_dev->bus;
+	mapped_dev = pci_dev->dev;
+	mapped_func = pci_dev->func;
 }
 
-static void
-release_forcewake_lock(int fd)
+/**
+ * intel_mmio_use_shared_file:
+ * @file: path of the shared register window, e.g. under /dev/shm
+ *
+ * Sets up #igt_global_mmio to point at a shared, writable mapping of
+ * @file, creating it if needed.  Unlike intel_mmio_use_dump_file() the
+ * mapping is MAP_SHARED, so several cooperating tools pointing at the
+ * same file work against one register window: one tool can publish
+ * register snapshots and the others see them without setting up any
+ * hardware access of their own.
+ */
+void
+intel_mmio_use_shared_file(const char *file)
 {
+	int fd;
+
+	fd = open(file, O_RDWR | O_CREAT, 0666);
+	igt_fail_on_f(fd == -1,
+		      "Couldn't open %s\n", file);
+
+	/* large enough for the biggest register BAR we pretend to be */
+	igt_fail_on_f(ftruncate(fd, 2*1024*1024) == -1,
+		      "Couldn't resize %s\n", file);
+
+	igt_global_mmio = mmap(NULL, 2*1024*1024, PROT_READ|PROT_WRITE,
+			       MAP_SHARED, fd, 0);
+	igt_fail_on_f(igt_global_mmio == MAP_FAILED,
+		      "Couldn't mmap %s\n", file);
 	close(fd);
 }
 
+static int fw_lease_fd = -1;
+
+/**
+ * intel_mmio_use_forcewake_lease:
+ * @pci_dev: intel graphics pci device
+ *
+ * Tries to take a forcewake lease from a running intel_forcewaked daemon:
+ * the daemon holds forcewake for as long as the lease (and so this process)
+ * lives and hands back the fd of the register window over the socket, which
+ * gets mapped into #igt_global_mmio. Register reads then need no forcewake
+ * handling of their own, which is what makes back-to-back invocations of
+ * short-lived tools like intel_reg cheap.
+ *
+ * The lease is released by the daemon when the process exits and the
+ * socket closes, so a crashed tool cannot leak the wake.
+ *
+ * Returns:
+ * 0 on success, -1 when no daemon is reachable or the handoff fails.
+ */
+int
+intel_mmio_use_forcewake_lease(struct pci_device *pci_dev)
+{
+	struct intel_forcewaked_request request = {
+		.magic = INTEL_FORCEWAKED_MAGIC,
+		.cmd = INTEL_FORCEWAKED_ACQUIRE,
+	};
+	struct intel_forcewaked_reply reply;
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	char control[CMSG_SPACE(sizeof(int))];
+	struct iovec iov = { .iov_base = &reply, .iov_len = sizeof(reply) };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = control,
+		.msg_controllen = sizeof(control),
+	};
+	struct cmsghdr *cmsg;
+	int sock, mmio_fd = -1;
+	void *ptr;
+
+	if (fw_lease_fd >= 0)	/* already leased by this process */
+		return 0;
+
+	sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0)
+		return -1;
+
+	strncpy(addr.sun_path, INTEL_FORCEWAKED_SOCKET,
+		sizeof(addr.sun_path) - 1);
+	if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    write(sock, &request, sizeof(request)) != sizeof(request) ||
+	    recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) != sizeof(reply))
+		goto err;
+
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+		if (cmsg->cmsg_level == SOL_SOCKET &&
+		    cmsg->cmsg_type == SCM_RIGHTS)
+			memcpy(&mmio_fd, CMSG_DATA(cmsg), sizeof(int));
+
+	if (reply.magic != INTEL_FORCEWAKED_MAGIC || reply.status ||
+	    reply.devid != pci_dev->device_id || mmio_fd < 0)
+		goto err;
+
+	ptr = mmap(NULL, reply.mmio_size, PROT_READ | PROT_WRITE,
+		   MAP_SHARED, mmio_fd, 0);
+	close(mmio_fd);
+	if (ptr == MAP_FAILED)
+		goto err;
+
+	igt_global_mmio = ptr;
+	/* Keeping the socket open is what keeps the lease alive. */
+	fw_lease_fd = sock;
+	return 0;
+
+err:
+	if (mmio_fd >= 0)
+		close(mmio_fd);
+	close(sock);
+	return -1;
+}
+
 /**
  * intel_register_access_init:
  * @pci_dev: intel graphics pci device
@@ -167,16 +305,19 @@ release_forcewake_lock(int fd)
 int
 intel_register_access_init(struct pci_device *pci_dev, int safe, int fd)
 {
-	int ret;
-
 	/* after old API is deprecated, remove this */
 	if (igt_global_mmio == NULL)
 		intel_mmio_use_pci_bar(pci_dev);
 
 	igt_assert(igt_global_mmio != NULL);
 
-	if (mmio_data.inited)
-		return -1;
+	/* The helper is process-wide state; let every user take a
+	 * reference instead of failing the second initialization.
+	 */
+	if (mmio_data.inited) {
+		mmio_data.inited++;
+		return 0;
+	}
 
 	mmio_data.safe = (safe != 0 &&
 			intel_gen(pci_dev->device_id) >= 4) ? true : false;
@@ -184,22 +325,49 @@ intel_register_access_init(struct pci_device *pci_dev, int safe, int fd)
 	if (mmio_data.safe)
 		mmio_data.map = intel_get_register_map(mmio_data.i915_devid);
 
-	/* Find where the forcewake lock is. Forcewake doesn't exist
-	 * gen < 6, but the debugfs should do the right things for us.
+	/* The forcewake lock is only needed once registers are actually
+	 * touched, so it is taken lazily by the first access; tools that
+	 * initialize the helper without reading anything (or init/fini
+	 * repeatedly) no longer pay for the debugfs round trip.
 	 */
-	ret = igt_open_forcewake_handle(fd);
-	if (ret == -1)
-		mmio_data.key = FAKEKEY;
-	else
-		mmio_data.key = ret;
+	mmio_data.fd = fd;
+	mmio_data.key = 0;
 
 	mmio_data.inited++;
 	return 0;
 }
 
+/* Find where the forcewake lock is. Forcewake doesn't exist
+ * gen < 6, but the debugfs should do the right things for us.
+ */
+static void
+intel_register_access_forcewake(void)
+{
+	if (mmio_data.key)
+		return;
+
+	/* Under a daemon lease the wake is held on our behalf for the
+	 * lifetime of the process; there is nothing to take locally.
+	 */
+	if (fw_lease_fd >= 0) {
+		mmio_data.key = 1;
+		return;
+	}
+
+	/* Take the handle through the refcounted manager so we share one
+	 * wake window with any other forcewake user in this process.
+	 */
+	if (igt_forcewake_get(mmio_data.fd) == 0)
+		mmio_data.key = 1;
+	else
+		mmio_data.key = FAKEKEY;
+}
+
 static int
 intel_register_access_needs_wake(void)
 {
+	intel_register_access_forcewake();
+
 	return mmio_data.key != FAKEKEY;
 }
 
@@ -211,6 +379,8 @@ intel_register_access_needs_wake(void)
  */
 int intel_register_access_needs_fakewake(void)
 {
+	intel_register_access_forcewake();
+
 	return mmio_data.key == FAKEKEY;
 }
 
@@ -223,9 +393,12 @@ int intel_register_access_needs_fakewake(void)
 void
 intel_register_access_fini(void)
 {
-	if (mmio_data.key && intel_register_access_needs_wake())
-		release_forcewake_lock(mmio_data.key);
-	mmio_data.inited--;
+	if (--mmio_data.inited)
+		return;
+
+	if (mmio_data.key && mmio_data.key != FAKEKEY && fw_lease_fd < 0)
+		igt_forcewake_put();
+	mmio_data.key = 0;
 }
 
 /**
@@ -250,7 +423,7 @@ intel_register_read(uint32_t reg)
 	igt_assert(mmio_data.inited);
 
 	if (intel_gen(mmio_data.i915_devid) >= 6)
-		igt_assert(mmio_data.key != -1);
+		intel_register_access_forcewake();
 
 	if (!mmio_data.safe)
 		goto read_out;
@@ -290,7 +463,7 @@ intel_register_write(uint32_t reg, uint32_t val)
 	igt_assert(mmio_data.inited);
 
 	if (intel_gen(mmio_data.i915_devid) >= 6)
-		igt_assert(mmio_data.key != -1);
+		intel_register_access_forcewake();
 
 	if (!mmio_data.safe)
 		goto write_out;
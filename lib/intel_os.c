@@ -295,6 +295,85 @@ void intel_require_memory(uint64_t count, uint64_t size, unsigned mode)
 	igt_skip_on_simulation();
 }
 
+static struct igt_helper_process memory_pressure_helper;
+
+#define PRESSURE_CHUNK (256 * 1024)
+
+static void __attribute__((noreturn))
+memory_pressure_process(pid_t pid, uint64_t working_set, uint64_t bandwidth)
+{
+	struct timespec start = {};
+	uint64_t written = 0, offset = 0;
+	unsigned char *ptr, val = 0;
+
+	ptr = mmap(NULL, working_set, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	igt_assert(ptr != MAP_FAILED);
+
+	/*
+	 * Transparent hugepages make the reclaim granularity jump between 4K
+	 * and 2M depending on how khugepaged got on, which is exactly the
+	 * kind of bimodality this engine is meant to remove. Keep the working
+	 * set page granular.
+	 */
+#ifdef MADV_NOHUGEPAGE
+	madvise(ptr, working_set, MADV_NOHUGEPAGE);
+#endif
+
+	igt_nsec_elapsed(&start);
+
+	while (1) {
+		uint64_t target_ns, elapsed_ns;
+
+		memset(ptr + offset, val++, PRESSURE_CHUNK);
+		offset += PRESSURE_CHUNK;
+		if (offset >= working_set)
+			offset = 0;
+		written += PRESSURE_CHUNK;
+
+		/* pace the dirtying rate against the wall clock */
+		target_ns = written * NSEC_PER_SEC / bandwidth;
+		elapsed_ns = igt_nsec_elapsed(&start);
+		if (elapsed_ns < target_ns)
+			usleep((target_ns - elapsed_ns) / 1000);
+
+		if (kill(pid, 0)) /* Parent has died, so must we. */
+			exit(0);
+	}
+}
+
+/**
+ * intel_fork_memory_pressure:
+ * @working_set: size of the memory area to cycle through, in bytes
+ * @bandwidth: rate at which to dirty it, in bytes per second
+ *
+ * Forks a helper process which maps @working_set bytes of anonymous memory
+ * and dirties it round-robin at a fixed @bandwidth. Unlike brute-force
+ * allocation the reclaim pressure this generates is constant over time, so
+ * eviction-path measurements taken against it are repeatable numbers rather
+ * than depending on where in the allocation burst they landed.
+ *
+ * Stop the helper with intel_stop_memory_pressure().
+ */
+void intel_fork_memory_pressure(uint64_t working_set, uint64_t bandwidth)
+{
+	igt_assert(working_set >= PRESSURE_CHUNK);
+	igt_assert(bandwidth);
+
+	igt_fork_helper(&memory_pressure_helper)
+		memory_pressure_process(getppid(), working_set, bandwidth);
+}
+
+/**
+ * intel_stop_memory_pressure:
+ *
+ * Stops the child process spawned with intel_fork_memory_pressure().
+ */
+void intel_stop_memory_pressure(void)
+{
+	igt_stop_helper(&memory_pressure_helper);
+}
+
 void intel_purge_vm_caches(int drm_fd)
 {
 	int fd;
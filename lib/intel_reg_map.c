@@ -34,6 +34,8 @@
 #include "intel_chipset.h"
 #include "igt_core.h"
 
+#define ARRAY_SIZE(arr) (sizeof(arr)/sizeof(arr[0]))
+
 static struct intel_register_range gen_bwcl_register_map[] = {
 	{0x00000000, 0x00000fff, INTEL_RANGE_RW},
 	{0x00001000, 0x00000fff, INTEL_RANGE_RSVD},
@@ -135,12 +137,15 @@ intel_get_register_map(uint32_t devid)
 
 	if (gen >= 6) {
 		map.map = gen6_gt_register_map;
+		map.count = ARRAY_SIZE(gen6_gt_register_map) - 1;
 		map.top = 0x180000;
 	} else if (IS_BROADWATER(devid) || IS_CRESTLINE(devid)) {
 		map.map = gen_bwcl_register_map;
+		map.count = ARRAY_SIZE(gen_bwcl_register_map) - 1;
 		map.top = 0x80000;
 	} else if (gen >= 4) {
 		map.map = gen4_register_map;
+		map.count = ARRAY_SIZE(gen4_register_map) - 1;
 		map.top = 0x80000;
 	} else {
 		igt_fail_on("Gen2/3 Ranges are not supported. Please use ""unsafe access.");
@@ -154,8 +159,15 @@ intel_get_register_map(uint32_t devid)
 struct intel_register_range *
 intel_get_register_range(struct intel_register_map map, uint32_t offset, uint32_t mode)
 {
-	struct intel_register_range *range = map.map;
+	/* Register dumpers classify every single access through here, and
+	 * successive lookups overwhelmingly hit the same range, so remember
+	 * the last hit before falling back to the binary search.  The
+	 * tables are static storage, which makes caching a pointer safe.
+	 */
+	static struct intel_register_range *last_range;
 	uint32_t align = map.alignment_mask;
+	struct intel_register_range *range;
+	int lo, hi;
 
 	if (offset & map.alignment_mask)
 		return NULL;
@@ -163,17 +175,36 @@ intel_get_register_range(struct intel_register_map map, uint32_t offset, uint32_
 	if (offset >= map.top)
 		return NULL;
 
-	while (!(range->flags & INTEL_RANGE_END)) {
-		/*  list is assumed to be in order */
-		if (offset < range->base)
-			break;
-
-		if ( (offset >= range->base) &&
-		     (offset + align) <= (range->base + range->size)) {
-			if ((mode & range->flags) == mode)
-				return range;
-		}
-		range++;
+	if (last_range && last_range >= map.map &&
+	    last_range < map.map + map.count &&
+	    offset >= last_range->base &&
+	    offset + align <= last_range->base + last_range->size &&
+	    (mode & last_range->flags) == mode)
+		return last_range;
+
+	/* The tables are sorted and the ranges don't overlap, so binary
+	 * search for the last range starting at or below the offset; it
+	 * is the only possible match.
+	 */
+	lo = 0;
+	hi = map.count;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+
+		if (map.map[mid].base <= offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == 0)
+		return NULL;
+
+	range = &map.map[lo - 1];
+	if (offset + align <= range->base + range->size &&
+	    (mode & range->flags) == mode) {
+		last_range = range;
+		return range;
 	}
 
 	return NULL;
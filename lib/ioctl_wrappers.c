@@ -54,6 +54,7 @@
 #include "intel_chipset.h"
 #include "intel_io.h"
 #include "igt_debugfs.h"
+#include "igt_x86.h"
 #include "config.h"
 
 #ifdef HAVE_VALGRIND
@@ -336,6 +337,147 @@ void gem_close(int fd, uint32_t handle)
 	do_ioctl(fd, DRM_IOCTL_GEM_CLOSE, &close_bo);
 }
 
+static struct {
+	struct {
+		int fd;
+		uint32_t handle;
+	} *entries;
+	unsigned int count, capacity;
+} close_queue;
+
+/**
+ * gem_close_deferred:
+ * @fd: open i915 drm file descriptor
+ * @handle: gem buffer object handle
+ *
+ * Queues @handle for closing by a later gem_close_flush(). Tests tearing
+ * down very large object populations use this to coalesce the closes into
+ * one tight ioctl loop, keeping the wrapper and bookkeeping cost out of
+ * whatever the surrounding code is measuring.
+ */
+void gem_close_deferred(int fd, uint32_t handle)
+{
+	igt_assert_neq(handle, 0);
+
+	if (close_queue.count == close_queue.capacity) {
+		close_queue.capacity =
+			close_queue.capacity ? 2*close_queue.capacity : 4096;
+		close_queue.entries = realloc(close_queue.entries,
+					      close_queue.capacity *
+					      sizeof(*close_queue.entries));
+		igt_assert(close_queue.entries);
+	}
+
+	close_queue.entries[close_queue.count].fd = fd;
+	close_queue.entries[close_queue.count].handle = handle;
+	close_queue.count++;
+}
+
+/**
+ * gem_close_flush:
+ * @fd: open i915 drm file descriptor, or -1 for all
+ *
+ * Closes every handle queued with gem_close_deferred() on @fd and releases
+ * the queue memory once it is empty.
+ */
+void gem_close_flush(int fd)
+{
+	unsigned int i, kept = 0;
+
+	for (i = 0; i < close_queue.count; i++) {
+		if (fd != -1 && close_queue.entries[i].fd != fd) {
+			close_queue.entries[kept++] = close_queue.entries[i];
+			continue;
+		}
+
+		gem_close(close_queue.entries[i].fd,
+			  close_queue.entries[i].handle);
+	}
+
+	close_queue.count = kept;
+	if (!kept) {
+		free(close_queue.entries);
+		close_queue.entries = NULL;
+		close_queue.capacity = 0;
+	}
+}
+
+/**
+ * gem_recycler_init:
+ * @recycler: handle recycler
+ * @fd: open i915 drm file descriptor
+ * @size: size of the buffer objects managed by @recycler
+ *
+ * Initialises an opt-in handle-recycling allocator: handles released with
+ * gem_recycler_close() go onto a free list and are handed straight back by
+ * the next gem_recycler_create(), so create/close churn loops can separate
+ * the kernel's object allocation cost from the wrapper cost.
+ */
+void gem_recycler_init(struct gem_handle_recycler *recycler,
+		       int fd, uint64_t size)
+{
+	memset(recycler, 0, sizeof(*recycler));
+	recycler->fd = fd;
+	recycler->size = size;
+}
+
+/**
+ * gem_recycler_create:
+ * @recycler: handle recycler
+ *
+ * Allocates a buffer object of the recycler's size, reusing a free-listed
+ * handle when one is available and falling back to gem_create() otherwise.
+ *
+ * Returns: The file-private handle of the buffer object
+ */
+uint32_t gem_recycler_create(struct gem_handle_recycler *recycler)
+{
+	if (recycler->count)
+		return recycler->handles[--recycler->count];
+
+	return gem_create(recycler->fd, recycler->size);
+}
+
+/**
+ * gem_recycler_close:
+ * @recycler: handle recycler
+ * @handle: gem buffer object handle from gem_recycler_create()
+ *
+ * Returns @handle to the recycler's free list for reuse.
+ */
+void gem_recycler_close(struct gem_handle_recycler *recycler, uint32_t handle)
+{
+	igt_assert_neq(handle, 0);
+
+	if (recycler->count == recycler->capacity) {
+		recycler->capacity =
+			recycler->capacity ? 2*recycler->capacity : 1024;
+		recycler->handles = realloc(recycler->handles,
+					    recycler->capacity *
+					    sizeof(*recycler->handles));
+		igt_assert(recycler->handles);
+	}
+
+	recycler->handles[recycler->count++] = handle;
+}
+
+/**
+ * gem_recycler_fini:
+ * @recycler: handle recycler
+ *
+ * Closes all free-listed handles and releases the recycler's memory.
+ */
+void gem_recycler_fini(struct gem_handle_recycler *recycler)
+{
+	while (recycler->count)
+		gem_close_deferred(recycler->fd,
+				   recycler->handles[--recycler->count]);
+	gem_close_flush(recycler->fd);
+
+	free(recycler->handles);
+	memset(recycler, 0, sizeof(*recycler));
+}
+
 int __gem_write(int fd, uint32_t handle, uint64_t offset, const void *buf, uint64_t length)
 {
 	struct drm_i915_gem_pwrite gem_pwrite;
@@ -401,6 +543,35 @@ void gem_read(int fd, uint32_t handle, uint64_t offset, void *buf, uint64_t leng
 	igt_assert_eq(__gem_read(fd, handle, offset, buf, length), 0);
 }
 
+/**
+ * gem_read_from_wc:
+ * @fd: open i915 drm file descriptor
+ * @handle: gem buffer object handle
+ * @offset: offset within the buffer of the subrange
+ * @buf: pointer to the data to read into
+ * @length: size of the subrange
+ *
+ * Like gem_read(), but downloads through a WC mapping using the streaming
+ * copy from igt_memcpy_from_wc(), which runs at memory bandwidth where the
+ * uncached pread path crawls. Use this for bulk readback, e.g. framebuffers
+ * about to be CRC-checked; it falls back to gem_read() when WC mappings are
+ * unavailable.
+ */
+void gem_read_from_wc(int fd, uint32_t handle, uint64_t offset, void *buf, uint64_t length)
+{
+	void *ptr;
+
+	ptr = __gem_mmap__wc(fd, handle, offset, length, PROT_READ);
+	if (!ptr) {
+		gem_read(fd, handle, offset, buf, length);
+		return;
+	}
+
+	gem_set_domain(fd, handle, I915_GEM_DOMAIN_GTT, 0);
+	igt_memcpy_from_wc(buf, ptr, length);
+	gem_munmap(ptr, length);
+}
+
 int __gem_set_domain(int fd, uint32_t handle, uint32_t read, uint32_t write)
 {
 	struct drm_i915_gem_set_domain set_domain;
@@ -657,6 +828,87 @@ void gem_execbuf_wr(int fd, struct drm_i915_gem_execbuffer2 *execbuf)
 	igt_assert_eq(__gem_execbuf_wr(fd, execbuf), 0);
 }
 
+/**
+ * gem_execbuf_builder_init:
+ * @builder: execbuf builder
+ * @fd: open i915 drm file descriptor
+ *
+ * Initialises @builder, a reusable wrapper around the EXECBUFFER2 ioctl that
+ * retains its exec-object table between submissions. Handles are added once
+ * with gem_execbuf_builder_add() and the offsets the kernel writes back stay
+ * in the table, so repeated submissions present already-valid presumed
+ * offsets instead of rebuilding the array from scratch.
+ */
+void gem_execbuf_builder_init(struct gem_execbuf_builder *builder, int fd)
+{
+	memset(builder, 0, sizeof(*builder));
+	builder->fd = fd;
+}
+
+/**
+ * gem_execbuf_builder_add:
+ * @builder: execbuf builder
+ * @handle: gem buffer object handle
+ *
+ * Adds @handle to the exec-object table, or looks up its existing slot so the
+ * caller can patch flags or relocations in place. The batch object must be
+ * added last, matching the EXECBUFFER2 convention.
+ *
+ * Returns: The exec object slot for @handle.
+ */
+struct drm_i915_gem_exec_object2 *
+gem_execbuf_builder_add(struct gem_execbuf_builder *builder, uint32_t handle)
+{
+	struct drm_i915_gem_exec_object2 *obj;
+	unsigned int i;
+
+	for (i = 0; i < builder->count; i++)
+		if (builder->objects[i].handle == handle)
+			return &builder->objects[i];
+
+	if (builder->count == builder->capacity) {
+		builder->capacity = builder->capacity ? 2*builder->capacity : 16;
+		builder->objects = realloc(builder->objects,
+					   builder->capacity *
+					   sizeof(*builder->objects));
+		igt_assert(builder->objects);
+	}
+
+	obj = &builder->objects[builder->count++];
+	memset(obj, 0, sizeof(*obj));
+	obj->handle = handle;
+	return obj;
+}
+
+/**
+ * gem_execbuf_builder_submit:
+ * @builder: execbuf builder
+ *
+ * Submits the current object table. Fields of the embedded execbuf other than
+ * buffers_ptr and buffer_count (ring selection, batch_len, context, ...) are
+ * set by the caller through @builder->execbuf and preserved across calls.
+ */
+void gem_execbuf_builder_submit(struct gem_execbuf_builder *builder)
+{
+	igt_assert(builder->count);
+	builder->execbuf.buffers_ptr = to_user_pointer(builder->objects);
+	builder->execbuf.buffer_count = builder->count;
+	gem_execbuf(builder->fd, &builder->execbuf);
+}
+
+/**
+ * gem_execbuf_builder_fini:
+ * @builder: execbuf builder
+ *
+ * Releases the object table of @builder. The buffer objects themselves belong
+ * to the caller.
+ */
+void gem_execbuf_builder_fini(struct gem_execbuf_builder *builder)
+{
+	free(builder->objects);
+	memset(builder, 0, sizeof(*builder));
+}
+
 /**
  * __gem_mmap__gtt:
  * @fd: open i915 drm file descriptor
@@ -875,6 +1127,177 @@ void *gem_mmap__cpu(int fd, uint32_t handle, uint64_t offset, uint64_t size, uns
 	return ptr;
 }
 
+/*
+ * Cache of whole-object mappings, keyed by (fd, handle, type). Mappings are
+ * kept alive at refcount zero so loops that repeatedly map and unmap the same
+ * bo reuse the live, fault-warmed mapping instead of paying the mmap ioctl
+ * and the fault storm on every iteration; gem_mmap_cache_purge() drops the
+ * idle ones.
+ */
+#define MMAP_CACHE_SIZE 64
+
+enum mmap_cache_type {
+	MMAP_CACHE_GTT,
+	MMAP_CACHE_CPU,
+	MMAP_CACHE_WC,
+};
+
+static struct mmap_cache_entry {
+	int fd;
+	uint32_t handle;
+	enum mmap_cache_type type;
+	uint64_t size;
+	unsigned prot;
+	void *ptr;
+	int refcount;
+} mmap_cache[MMAP_CACHE_SIZE];
+
+static void *mmap_cached(int fd, uint32_t handle, enum mmap_cache_type type,
+			 uint64_t size, unsigned prot)
+{
+	struct mmap_cache_entry *entry = NULL;
+	void *ptr;
+	int i;
+
+	for (i = 0; i < MMAP_CACHE_SIZE; i++) {
+		struct mmap_cache_entry *e = &mmap_cache[i];
+
+		if (e->ptr &&
+		    e->fd == fd && e->handle == handle && e->type == type &&
+		    e->size == size && (e->prot & prot) == prot) {
+			e->refcount++;
+			return e->ptr;
+		}
+
+		if (!e->ptr && !entry)
+			entry = e;
+	}
+
+	switch (type) {
+	case MMAP_CACHE_GTT:
+		ptr = gem_mmap__gtt(fd, handle, size, prot);
+		break;
+	case MMAP_CACHE_CPU:
+		ptr = gem_mmap__cpu(fd, handle, 0, size, prot);
+		break;
+	case MMAP_CACHE_WC:
+		ptr = gem_mmap__wc(fd, handle, 0, size, prot);
+		break;
+	}
+
+	if (!entry)
+		return ptr;
+
+	entry->fd = fd;
+	entry->handle = handle;
+	entry->type = type;
+	entry->size = size;
+	entry->prot = prot;
+	entry->ptr = ptr;
+	entry->refcount = 1;
+	return ptr;
+}
+
+/**
+ * gem_mmap_cached__gtt:
+ * @fd: open i915 drm file descriptor
+ * @handle: gem buffer object handle
+ * @size: size of the gem buffer
+ * @prot: memory protection bits as used by mmap()
+ *
+ * Like gem_mmap__gtt(), but subsequent calls for the same object return the
+ * cached live mapping instead of creating a new one. Release the mapping with
+ * gem_munmap_cached(); it stays warm in the cache for the next caller until
+ * gem_mmap_cache_purge().
+ *
+ * Returns: A pointer to the memory mapping
+ */
+void *gem_mmap_cached__gtt(int fd, uint32_t handle, uint64_t size, unsigned prot)
+{
+	return mmap_cached(fd, handle, MMAP_CACHE_GTT, size, prot);
+}
+
+/**
+ * gem_mmap_cached__cpu:
+ * @fd: open i915 drm file descriptor
+ * @handle: gem buffer object handle
+ * @size: size of the gem buffer
+ * @prot: memory protection bits as used by mmap()
+ *
+ * Like gem_mmap__cpu() for the whole object, reusing a cached live mapping
+ * when one exists. See gem_mmap_cached__gtt().
+ *
+ * Returns: A pointer to the memory mapping
+ */
+void *gem_mmap_cached__cpu(int fd, uint32_t handle, uint64_t size, unsigned prot)
+{
+	return mmap_cached(fd, handle, MMAP_CACHE_CPU, size, prot);
+}
+
+/**
+ * gem_mmap_cached__wc:
+ * @fd: open i915 drm file descriptor
+ * @handle: gem buffer object handle
+ * @size: size of the gem buffer
+ * @prot: memory protection bits as used by mmap()
+ *
+ * Like gem_mmap__wc() for the whole object, reusing a cached live mapping
+ * when one exists. See gem_mmap_cached__gtt().
+ *
+ * Returns: A pointer to the memory mapping
+ */
+void *gem_mmap_cached__wc(int fd, uint32_t handle, uint64_t size, unsigned prot)
+{
+	return mmap_cached(fd, handle, MMAP_CACHE_WC, size, prot);
+}
+
+/**
+ * gem_munmap_cached:
+ * @ptr: pointer from one of the gem_mmap_cached__* functions
+ * @size: size the mapping was created with
+ *
+ * Drops a reference on a cached mapping. The mapping itself is retained for
+ * reuse; uncached pointers (cache overflow) are unmapped directly.
+ */
+void gem_munmap_cached(void *ptr, uint64_t size)
+{
+	int i;
+
+	for (i = 0; i < MMAP_CACHE_SIZE; i++) {
+		struct mmap_cache_entry *e = &mmap_cache[i];
+
+		if (e->ptr != ptr)
+			continue;
+
+		igt_assert(e->refcount > 0);
+		e->refcount--;
+		return;
+	}
+
+	gem_munmap(ptr, size);
+}
+
+/**
+ * gem_mmap_cache_purge:
+ *
+ * Unmaps all cached mappings that are not currently referenced. Call this
+ * before closing objects whose mappings may still sit in the cache.
+ */
+void gem_mmap_cache_purge(void)
+{
+	int i;
+
+	for (i = 0; i < MMAP_CACHE_SIZE; i++) {
+		struct mmap_cache_entry *e = &mmap_cache[i];
+
+		if (!e->ptr || e->refcount)
+			continue;
+
+		gem_munmap(e->ptr, e->size);
+		e->ptr = NULL;
+	}
+}
+
 /**
  * gem_madvise:
  * @fd: open i915 drm file descriptor
@@ -961,6 +1384,115 @@ void gem_context_destroy(int fd, uint32_t ctx_id)
 	do_ioctl(fd, DRM_IOCTL_I915_GEM_CONTEXT_DESTROY, &destroy);
 }
 
+/**
+ * gem_context_pool_init:
+ * @pool: context pool
+ * @fd: open i915 drm file descriptor
+ *
+ * Initialises a recycling pool of hardware contexts. Contexts released with
+ * gem_context_pool_put() are kept alive and handed back by later
+ * gem_context_pool_get() calls in LRU order, so tests cycling through
+ * thousands of contexts stop round-tripping the kernel for every one.
+ */
+void gem_context_pool_init(struct gem_context_pool *pool, int fd)
+{
+	memset(pool, 0, sizeof(*pool));
+	pool->fd = fd;
+}
+
+/**
+ * gem_context_pool_get:
+ * @pool: context pool
+ *
+ * Acquires a hardware context from the pool, falling back to
+ * gem_context_create() when the free list is empty.
+ *
+ * Returns: The id of the hw context.
+ */
+uint32_t gem_context_pool_get(struct gem_context_pool *pool)
+{
+	if (pool->count)
+		return pool->ctx[--pool->count];
+
+	return gem_context_create(pool->fd);
+}
+
+/**
+ * gem_context_pool_put:
+ * @pool: context pool
+ * @ctx_id: i915 hw context id
+ *
+ * Returns @ctx_id to the pool's free list for reuse.
+ */
+void gem_context_pool_put(struct gem_context_pool *pool, uint32_t ctx_id)
+{
+	igt_assert_neq(ctx_id, 0);
+
+	if (pool->count == pool->capacity) {
+		pool->capacity = pool->capacity ? 2*pool->capacity : 64;
+		pool->ctx = realloc(pool->ctx,
+				    pool->capacity * sizeof(*pool->ctx));
+		igt_assert(pool->ctx);
+	}
+
+	pool->ctx[pool->count++] = ctx_id;
+}
+
+/**
+ * gem_context_pool_prewarm:
+ * @pool: context pool
+ * @count: number of contexts to populate the pool with
+ *
+ * Grows the free list to @count contexts and runs a trivial batch to
+ * completion on each of them. A context's first submission carries the
+ * one-off cost of loading the default hardware state, so pre-warming keeps
+ * that tail out of whatever the caller measures - context-switch benchmarks
+ * then see switching, not creation.
+ */
+void gem_context_pool_prewarm(struct gem_context_pool *pool,
+			      unsigned int count)
+{
+	const uint32_t bbe[2] = { 0xa << 23 /* MI_BATCH_BUFFER_END */, };
+	struct drm_i915_gem_exec_object2 obj;
+	struct drm_i915_gem_execbuffer2 execbuf;
+	unsigned int i;
+
+	while (pool->count < count)
+		gem_context_pool_put(pool, gem_context_create(pool->fd));
+
+	memset(&obj, 0, sizeof(obj));
+	obj.handle = gem_create(pool->fd, 4096);
+	gem_write(pool->fd, obj.handle, 0, bbe, sizeof(bbe));
+
+	memset(&execbuf, 0, sizeof(execbuf));
+	execbuf.buffers_ptr = to_user_pointer(&obj);
+	execbuf.buffer_count = 1;
+
+	for (i = 0; i < pool->count; i++) {
+		execbuf.rsvd1 = pool->ctx[i];
+		gem_execbuf(pool->fd, &execbuf);
+	}
+
+	gem_sync(pool->fd, obj.handle);
+	gem_close(pool->fd, obj.handle);
+}
+
+/**
+ * gem_context_pool_fini:
+ * @pool: context pool
+ *
+ * Destroys all pooled contexts and releases the pool's memory. Contexts
+ * still checked out remain the caller's responsibility.
+ */
+void gem_context_pool_fini(struct gem_context_pool *pool)
+{
+	while (pool->count)
+		gem_context_destroy(pool->fd, pool->ctx[--pool->count]);
+
+	free(pool->ctx);
+	memset(pool, 0, sizeof(*pool));
+}
+
 int __gem_context_get_param(int fd, struct local_i915_gem_context_param *p)
 {
 #define LOCAL_I915_GEM_CONTEXT_GETPARAM       0x34
@@ -1097,6 +1629,74 @@ void gem_userptr(int fd, void *ptr, int size, int read_only, uint32_t flags, uin
 	igt_assert_eq(__gem_userptr(fd, ptr, size, read_only, flags, handle), 0);
 }
 
+/**
+ * gem_userptr_alloc_huge:
+ * @size: desired size of the allocation, rounded up to 2MiB
+ *
+ * Allocates an anonymous region aligned to and sized in 2MiB units and
+ * advises the kernel to back it with transparent hugepages. Where THP is
+ * available, get_pages on a userptr object built on top of such a region
+ * pins the backing store in 2MiB steps instead of walking 4KiB pages.
+ *
+ * Returns the allocation; free it with free() once the handles are closed.
+ */
+void *gem_userptr_alloc_huge(uint64_t size)
+{
+	uint64_t huge_size = 2 << 20;
+	void *ptr;
+
+	size = (size + huge_size - 1) & ~(huge_size - 1);
+	igt_assert(posix_memalign(&ptr, huge_size, size) == 0);
+#ifdef MADV_HUGEPAGE
+	madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+
+	return ptr;
+}
+
+/**
+ * __gem_userptr_batch:
+ * @fd: open i915 drm file descriptor
+ * @ptr: start of the memory region to carve objects from
+ * @size: size of each object
+ * @count: number of objects to create
+ * @flags: userptr flags
+ * @handles: array to store the returned handles in
+ *
+ * Carves @count userptr objects of @size bytes each out of @ptr and pins
+ * every one by moving it to the CPU domain, so on return all the backing
+ * pages are resident rather than faulted in at first use. On error any
+ * handles created so far are closed.
+ */
+int __gem_userptr_batch(int fd, void *ptr, uint64_t size, int count,
+			uint32_t flags, uint32_t *handles)
+{
+	int i, ret;
+
+	for (i = 0; i < count; i++) {
+		ret = __gem_userptr(fd, (char *)ptr + i * size, size, 0,
+				    flags, &handles[i]);
+		if (ret == 0)
+			ret = __gem_set_domain(fd, handles[i],
+					       I915_GEM_DOMAIN_CPU,
+					       I915_GEM_DOMAIN_CPU);
+		if (ret) {
+			while (i--)
+				gem_close(fd, handles[i]);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+void gem_userptr_batch(int fd, void *ptr, uint64_t size, int count,
+		       uint32_t flags, uint32_t *handles)
+{
+	igt_assert_eq(__gem_userptr_batch(fd, ptr, size, count, flags, handles),
+		      0);
+}
+
 /**
  * gem_sw_finish:
  * @fd: open i915 drm file descriptor
@@ -62,9 +62,34 @@ uint32_t gem_get_caching(int fd, uint32_t handle);
 uint32_t gem_flink(int fd, uint32_t handle);
 uint32_t gem_open(int fd, uint32_t name);
 void gem_close(int fd, uint32_t handle);
+void gem_close_deferred(int fd, uint32_t handle);
+void gem_close_flush(int fd);
+
+/**
+ * gem_handle_recycler:
+ * @fd: open i915 drm file descriptor
+ * @size: size of the buffer objects on the free list
+ *
+ * Opt-in free list of same-sized gem handles, for tests whose create/close
+ * churn would otherwise dominate their runtime.
+ */
+struct gem_handle_recycler {
+	int fd;
+	uint64_t size;
+	/*< private >*/
+	uint32_t *handles;
+	unsigned int count, capacity;
+};
+
+void gem_recycler_init(struct gem_handle_recycler *recycler,
+		       int fd, uint64_t size);
+uint32_t gem_recycler_create(struct gem_handle_recycler *recycler);
+void gem_recycler_close(struct gem_handle_recycler *recycler, uint32_t handle);
+void gem_recycler_fini(struct gem_handle_recycler *recycler);
 int __gem_write(int fd, uint32_t handle, uint64_t offset, const void *buf, uint64_t length);
 void gem_write(int fd, uint32_t handle, uint64_t offset,  const void *buf, uint64_t length);
 void gem_read(int fd, uint32_t handle, uint64_t offset, void *buf, uint64_t length);
+void gem_read_from_wc(int fd, uint32_t handle, uint64_t offset, void *buf, uint64_t length);
 int __gem_set_domain(int fd, uint32_t handle, uint32_t read, uint32_t write);
 void gem_set_domain(int fd, uint32_t handle, uint32_t read, uint32_t write);
 int gem_wait(int fd, uint32_t handle, int64_t *timeout_ns);
@@ -79,6 +104,31 @@ int __gem_execbuf_wr(int fd, struct drm_i915_gem_execbuffer2 *execbuf);
 void gem_execbuf(int fd, struct drm_i915_gem_execbuffer2 *execbuf);
 int __gem_execbuf(int fd, struct drm_i915_gem_execbuffer2 *execbuf);
 
+/**
+ * gem_execbuf_builder:
+ * @fd: open i915 drm file descriptor
+ * @execbuf: embedded execbuffer, caller-controlled except for the object table
+ * @objects: exec-object table retained between submissions
+ * @count: number of objects in the table
+ *
+ * Reusable execbuffer whose object table survives across submissions, for
+ * high-frequency submission loops.
+ */
+struct gem_execbuf_builder {
+	int fd;
+	struct drm_i915_gem_execbuffer2 execbuf;
+	struct drm_i915_gem_exec_object2 *objects;
+	unsigned int count;
+	/*< private >*/
+	unsigned int capacity;
+};
+
+void gem_execbuf_builder_init(struct gem_execbuf_builder *builder, int fd);
+struct drm_i915_gem_exec_object2 *
+gem_execbuf_builder_add(struct gem_execbuf_builder *builder, uint32_t handle);
+void gem_execbuf_builder_submit(struct gem_execbuf_builder *builder);
+void gem_execbuf_builder_fini(struct gem_execbuf_builder *builder);
+
 void *gem_mmap__gtt(int fd, uint32_t handle, uint64_t size, unsigned prot);
 void *gem_mmap__cpu(int fd, uint32_t handle, uint64_t offset, uint64_t size, unsigned prot);
 
@@ -93,6 +143,12 @@ void *__gem_mmap__gtt(int fd, uint32_t handle, uint64_t size, unsigned prot);
 void *__gem_mmap__cpu(int fd, uint32_t handle, uint64_t offset, uint64_t size, unsigned prot);
 void *__gem_mmap__wc(int fd, uint32_t handle, uint64_t offset, uint64_t size, unsigned prot);
 
+void *gem_mmap_cached__gtt(int fd, uint32_t handle, uint64_t size, unsigned prot);
+void *gem_mmap_cached__cpu(int fd, uint32_t handle, uint64_t size, unsigned prot);
+void *gem_mmap_cached__wc(int fd, uint32_t handle, uint64_t size, unsigned prot);
+void gem_munmap_cached(void *ptr, uint64_t size);
+void gem_mmap_cache_purge(void);
+
 int gem_munmap(void *ptr, uint64_t size);
 
 /**
@@ -121,6 +177,27 @@ int gem_madvise(int fd, uint32_t handle, int state);
 uint32_t gem_context_create(int fd);
 void gem_context_destroy(int fd, uint32_t ctx_id);
 int __gem_context_destroy(int fd, uint32_t ctx_id);
+
+/**
+ * gem_context_pool:
+ * @fd: open i915 drm file descriptor
+ *
+ * Recycling pool of hardware contexts, for tests that would otherwise pay a
+ * create/destroy ioctl round trip per context.
+ */
+struct gem_context_pool {
+	int fd;
+	/*< private >*/
+	uint32_t *ctx;
+	unsigned int count, capacity;
+};
+
+void gem_context_pool_init(struct gem_context_pool *pool, int fd);
+uint32_t gem_context_pool_get(struct gem_context_pool *pool);
+void gem_context_pool_put(struct gem_context_pool *pool, uint32_t ctx_id);
+void gem_context_pool_prewarm(struct gem_context_pool *pool,
+			      unsigned int count);
+void gem_context_pool_fini(struct gem_context_pool *pool);
 struct local_i915_gem_context_param {
 	uint32_t context;
 	uint32_t size;
@@ -151,6 +228,11 @@ struct local_i915_gem_userptr {
 };
 void gem_userptr(int fd, void *ptr, int size, int read_only, uint32_t flags, uint32_t *handle);
 int __gem_userptr(int fd, void *ptr, int size, int read_only, uint32_t flags, uint32_t *handle);
+void *gem_userptr_alloc_huge(uint64_t size);
+void gem_userptr_batch(int fd, void *ptr, uint64_t size, int count,
+		       uint32_t flags, uint32_t *handles);
+int __gem_userptr_batch(int fd, void *ptr, uint64_t size, int count,
+			uint32_t flags, uint32_t *handles);
 
 void gem_sw_finish(int fd, uint32_t handle);
 
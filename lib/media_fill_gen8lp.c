@@ -2,12 +2,19 @@
 #include <i915_drm.h>
 
 #include "media_fill.h"
+#include "fill_state_cache.h"
 #include "gen8_media.h"
 #include "intel_reg.h"
 #include "drmtest.h"
 
 #include <assert.h>
 
+static struct fill_state_cache state_cache;
+
+/* Batch offset of the most recently emitted surface state, so the
+ * cached-state path knows what to patch on later fills.
+ */
+static uint32_t last_surface_offset;
 
 static const uint32_t media_kernel[][4] = {
 	{ 0x00400001, 0x20202288, 0x00000020, 0x00000000 },
@@ -132,9 +139,44 @@ gen8_fill_surface_state(struct intel_batchbuffer *batch,
 	ss->ss7.shader_chanel_select_b = 6;
 	ss->ss7.shader_chanel_select_a = 7;
 
+	last_surface_offset = offset;
+
 	return offset;
 }
 
+/*
+ * Patch the destination-dependent fields of a cached surface state and
+ * re-emit its relocation for the new batch bo.
+ */
+static void
+gen8_patch_surface_state(struct intel_batchbuffer *batch,
+			 struct igt_buf *buf, uint32_t offset)
+{
+	struct gen8_surface_state *ss =
+		(struct gen8_surface_state *)&batch->buffer[offset];
+	int ret;
+
+	if (buf->tiling == I915_TILING_X)
+		ss->ss0.tiled_mode = 2;
+	else if (buf->tiling == I915_TILING_Y)
+		ss->ss0.tiled_mode = 3;
+	else
+		ss->ss0.tiled_mode = 0;
+
+	ss->ss8.base_addr = buf->bo->offset;
+
+	ret = drm_intel_bo_emit_reloc(batch->bo,
+				offset + 8 * 4,
+				buf->bo, 0,
+				I915_GEM_DOMAIN_RENDER,
+				I915_GEM_DOMAIN_RENDER);
+	igt_assert(ret == 0);
+
+	ss->ss2.height = igt_buf_height(buf) - 1;
+	ss->ss2.width  = igt_buf_width(buf) - 1;
+	ss->ss3.pitch  = buf->stride - 1;
+}
+
 static uint32_t
 gen8_fill_binding_table(struct intel_batchbuffer *batch,
 			struct igt_buf *dst)
@@ -340,9 +382,34 @@ gen8lp_media_fillfunc(struct intel_batchbuffer *batch,
 	/* setup states */
 	batch->ptr = &batch->buffer[BATCH_STATE_SPLIT];
 
-	curbe_buffer = gen8_fill_curbe_buffer_data(batch, color);
-	interface_descriptor = gen8_fill_interface_descriptor(batch, dst);
-	igt_assert(batch->ptr < &batch->buffer[4095]);
+	if (!state_cache.valid) {
+		curbe_buffer = gen8_fill_curbe_buffer_data(batch, color);
+		interface_descriptor =
+			gen8_fill_interface_descriptor(batch, dst);
+		igt_assert(batch->ptr < &batch->buffer[4095]);
+
+		state_cache.size = batch_used(batch) - BATCH_STATE_SPLIT;
+		state_cache.curbe_offset = curbe_buffer;
+		state_cache.surface_offset = last_surface_offset;
+		state_cache.idd_offset = interface_descriptor;
+		memcpy(state_cache.state, &batch->buffer[BATCH_STATE_SPLIT],
+		       state_cache.size);
+		state_cache.valid = true;
+	} else {
+		/* Reuse the pre-validated state; only the color and the
+		 * destination surface differ from the build above.
+		 */
+		memcpy(&batch->buffer[BATCH_STATE_SPLIT], state_cache.state,
+		       state_cache.size);
+		batch->ptr += state_cache.size;
+
+		batch->buffer[state_cache.curbe_offset] = color;
+		gen8_patch_surface_state(batch, dst,
+					 state_cache.surface_offset);
+
+		curbe_buffer = state_cache.curbe_offset;
+		interface_descriptor = state_cache.idd_offset;
+	}
 
 	/* media pipeline */
 	batch->ptr = batch->buffer;
@@ -24,10 +24,18 @@
  * 	Jeff McGee <jeff.mcgee@intel.com>
  */
 
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
 #include <intel_bufmgr.h>
 #include <i915_drm.h>
 #include "intel_reg.h"
+#include "intel_chipset.h"
 #include "drmtest.h"
+#include "igt_sysfs.h"
 #include "intel_batchbuffer.h"
 #include "gen8_media.h"
 #include "media_spin.h"
@@ -538,3 +546,183 @@ gen9_media_spinfunc(struct intel_batchbuffer *batch,
 	gen8_render_flush(batch, batch_end);
 	intel_batchbuffer_reset(batch);
 }
+
+/*
+ * Calibration of the spin kernel loop rate.
+ *
+ * The loop count a caller has to pass to the spinfuncs to get a wanted
+ * duration depends on the platform and on the GT frequency, and
+ * hand-tuning it with wall-clock doubling runs wastes a lot of time at
+ * the start of every test run.  Instead measure the rate once against
+ * the render ring timestamp (which ticks at a fixed rate regardless of
+ * CPU scheduling) and remember it on disk per (devid, max frequency),
+ * so only the first run on a given configuration pays for a
+ * measurement at all.
+ */
+
+#define SPIN_CALIB_CACHE_FILE "/var/tmp/.igt-media-spin-calib"
+
+struct local_drm_i915_reg_read {
+	__u64 offset;
+	__u64 val; /* Return value */
+};
+
+#define REG_READ_IOCTL DRM_IOWR(DRM_COMMAND_BASE + 0x31, struct local_drm_i915_reg_read)
+
+#define RENDER_RING_TIMESTAMP 0x2358
+
+static int
+spin_timestamp_query(int fd, uint64_t *val)
+{
+	static int has_proper_timestamp = -1;
+	struct local_drm_i915_reg_read reg_read;
+
+	if (has_proper_timestamp < 0) {
+		reg_read.offset = RENDER_RING_TIMESTAMP | 1;
+		has_proper_timestamp =
+			drmIoctl(fd, REG_READ_IOCTL, &reg_read) == 0;
+	}
+
+	reg_read.offset = RENDER_RING_TIMESTAMP;
+	if (has_proper_timestamp)
+		reg_read.offset |= 1;
+
+	if (drmIoctl(fd, REG_READ_IOCTL, &reg_read))
+		return -errno;
+
+	/* Without the corrected read the valid bits land in the upper
+	 * dword on 64-bit kernels; see tests/gem_reg_read.c. */
+	if (!has_proper_timestamp) {
+		struct utsname uts;
+
+		if (uname(&uts) == 0 && strcmp(uts.machine, "x86_64") == 0)
+			reg_read.val >>= 32;
+	}
+
+	*val = reg_read.val;
+	return 0;
+}
+
+static bool
+spin_calib_lookup(uint32_t devid, uint32_t freq, uint32_t *spins_per_msec)
+{
+	uint32_t d, f, s;
+	bool found = false;
+	FILE *file;
+
+	file = fopen(SPIN_CALIB_CACHE_FILE, "r");
+	if (!file)
+		return false;
+
+	while (fscanf(file, "%x %u %u", &d, &f, &s) == 3) {
+		if (d == devid && f == freq) {
+			*spins_per_msec = s;
+			found = true;
+			break;
+		}
+	}
+
+	fclose(file);
+	return found;
+}
+
+static void
+spin_calib_store(uint32_t devid, uint32_t freq, uint32_t spins_per_msec)
+{
+	FILE *file;
+
+	/* Best effort; an unwritable cache only costs recalibration. */
+	file = fopen(SPIN_CALIB_CACHE_FILE, "a");
+	if (!file)
+		return;
+
+	fprintf(file, "%x %u %u\n", devid, freq, spins_per_msec);
+	fclose(file);
+}
+
+static double
+spin_elapsed_msecs(int fd, struct intel_batchbuffer *batch,
+		   struct igt_buf *dst, igt_media_spinfunc_t spinfunc,
+		   uint32_t spins, int gen)
+{
+	struct timespec start, end;
+	uint64_t ts_start, ts_end;
+	bool gpu_clock;
+	double msecs;
+	int ret;
+
+	gpu_clock = spin_timestamp_query(fd, &ts_start) == 0;
+	if (!gpu_clock)
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+	spinfunc(batch, dst, spins);
+
+	/* mapping the target blocks until the spin kernel has finished */
+	ret = drm_intel_bo_map(dst->bo, 0);
+	igt_assert_eq(ret, 0);
+	drm_intel_bo_unmap(dst->bo);
+
+	if (gpu_clock) {
+		igt_assert_eq(spin_timestamp_query(fd, &ts_end), 0);
+		/* The command streamer timestamp ticks at 12.5MHz up to
+		 * gen8 and at 12MHz on gen9. */
+		msecs = (double)(ts_end - ts_start) *
+			(gen >= 9 ? 1e3 / 12e6 : 1e3 / 12.5e6);
+	} else {
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		msecs = (end.tv_sec - start.tv_sec) * 1e3 +
+			(end.tv_nsec - start.tv_nsec) * 1e-6;
+	}
+
+	igt_assert(msecs > 0.0);
+
+	return msecs;
+}
+
+uint32_t
+media_spin_calibrate(int fd, struct intel_batchbuffer *batch,
+		     struct igt_buf *dst)
+{
+	igt_media_spinfunc_t spinfunc;
+	uint32_t devid, freq, spins, spins_per_msec;
+	double msecs;
+	int gen, dir;
+
+	devid = batch->devid;
+	gen = intel_gen(devid);
+
+	/* The spin executes flat out, so key the cache on the maximum GT
+	 * frequency rather than whatever the GPU idles at right now. */
+	freq = 0;
+	dir = igt_sysfs_open(fd, NULL);
+	if (dir >= 0) {
+		freq = igt_sysfs_get_u32(dir, "gt_max_freq_mhz");
+		close(dir);
+	}
+
+	if (freq && spin_calib_lookup(devid, freq, &spins_per_msec))
+		return spins_per_msec;
+
+	spinfunc = igt_get_media_spinfunc(devid);
+	igt_assert(spinfunc);
+
+	/* Probe the rate with a short spin (which also warms the GPU up
+	 * to its busy frequency), then refine with a ~20ms one so the
+	 * measurement dwarfs submission overhead. */
+	spins = 1 << 20;
+	msecs = spin_elapsed_msecs(fd, batch, dst, spinfunc, spins, gen);
+	while (msecs < 1.0 && spins < 1u << 30) {
+		spins <<= 3;
+		msecs = spin_elapsed_msecs(fd, batch, dst, spinfunc,
+					   spins, gen);
+	}
+
+	spins = spins * 20.0 / msecs;
+	msecs = spin_elapsed_msecs(fd, batch, dst, spinfunc, spins, gen);
+	spins_per_msec = spins / msecs;
+
+	if (freq)
+		spin_calib_store(devid, freq, spins_per_msec);
+
+	return spins_per_msec;
+}
@@ -36,4 +36,14 @@ void gen8lp_media_spinfunc(struct intel_batchbuffer *batch,
 void gen9_media_spinfunc(struct intel_batchbuffer *batch,
 			 struct igt_buf *dst, uint32_t spins);
 
+/*
+ * Measure how many spin kernel loops execute per millisecond, so
+ * callers can convert a wanted duration into a spinfunc loop count.
+ * Calibrates against the render ring timestamp on first use and caches
+ * the result on disk per (devid, max GT frequency), so later runs skip
+ * the measurement entirely.
+ */
+uint32_t media_spin_calibrate(int fd, struct intel_batchbuffer *batch,
+			      struct igt_buf *dst);
+
 #endif /* MEDIA_SPIN_H */
@@ -152,6 +152,21 @@ void sw_sync_timeline_inc(int fd, uint32_t count)
 	do_ioctl(fd, INT_SYNC_IOC_INC, &count);
 }
 
+/*
+ * Creates count fences with consecutive seqnos, starting at first_seqno,
+ * into the caller-supplied array. The kernel interface only creates one
+ * fence per ioctl, but batching here keeps the per-fence cost down to that
+ * single ioctl; one sw_sync_timeline_inc(count) later signals the lot.
+ */
+void sw_sync_timeline_create_fence_array(int fd, uint32_t first_seqno,
+					 int *fences, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		fences[i] = sw_sync_timeline_create_fence(fd, first_seqno + i);
+}
+
 int sync_fence_merge(int fd1, int fd2)
 {
 	struct local_sync_merge_data data = { .fd2 = fd2};
@@ -185,6 +200,41 @@ int sync_fence_wait(int fd, int timeout)
 	} while (1);
 }
 
+/* Collapses an array of fences into one merged sync_file fd. */
+int sync_fence_merge_array(const int *fences, int count)
+{
+	int merged, i;
+
+	igt_assert(count > 0);
+
+	merged = dup(fences[0]);
+	igt_assert(merged >= 0);
+
+	for (i = 1; i < count; i++) {
+		int tmp = sync_fence_merge(merged, fences[i]);
+
+		igt_assert(tmp >= 0);
+		close(merged);
+		merged = tmp;
+	}
+
+	return merged;
+}
+
+/*
+ * Waits for all fences in the array with a single poll on their merged
+ * sync_file, rather than serializing one wait per fence; the caller wakes
+ * exactly once, when the last fence signals.
+ */
+int sync_fence_wait_array(const int *fences, int count, int timeout)
+{
+	int merged = sync_fence_merge_array(fences, count);
+	int ret = sync_fence_wait(merged, timeout);
+
+	close(merged);
+	return ret;
+}
+
 int sync_fence_count(int fd)
 {
 	struct local_sync_file_info info = {};
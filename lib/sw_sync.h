@@ -38,9 +38,13 @@ void sw_sync_timeline_inc(int timeline, uint32_t count);
 
 int __sw_sync_timeline_create_fence(int timeline, uint32_t seqno);
 int sw_sync_timeline_create_fence(int timeline, uint32_t seqno);
+void sw_sync_timeline_create_fence_array(int timeline, uint32_t first_seqno,
+					 int *fences, int count);
 
 int sync_fence_merge(int fence1, int fence2);
+int sync_fence_merge_array(const int *fences, int count);
 int sync_fence_wait(int fence, int timeout);
+int sync_fence_wait_array(const int *fences, int count, int timeout);
 int sync_fence_status(int fence);
 int sync_fence_count(int fence);
 int sync_fence_count_status(int fence, int status);
@@ -0,0 +1,99 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#include <uwildmat/uwildmat.h>
+
+#include "igt_core.h"
+#include "igt_matcher.h"
+
+#define ARRAY_SIZE(arr) (sizeof(arr)/sizeof(arr[0]))
+
+/* One expression of each clause kind the compiler distinguishes, plus
+ * the corner cases of the expression grammar.
+ */
+static const char * const expressions[] = {
+	"*", "", "basic", "basic-*", "!basic-*", "*,!basic-*",
+	"basic-*,!basic-flip,other", "a?c", "a[bc]d", "x\\*y",
+	"*-crc-*", "foo,bar,baz", "!*", "a,", "[a,b]c", "a\\,b",
+	"basic-[0-9]*", "*flip*,!*suspend*",
+};
+
+static const char * const names[] = {
+	"", "basic", "basic-flip", "basic-plain", "other", "abc", "axc",
+	"abd", "acd", "aed", "x*y", "xzy", "test-crc-pipe-a", "foo", "baz",
+	"a", "a,b", "ac", "bc", "cc", "basic-42-foo", "flip-suspend",
+	"big-flip", "quiet",
+};
+
+/* The compiled matcher must agree with uwildmat() on everything. */
+static void test_against_uwildmat(void)
+{
+	int e, n;
+
+	for (e = 0; e < ARRAY_SIZE(expressions); e++) {
+		struct igt_matcher *matcher =
+			igt_matcher_compile(expressions[e]);
+
+		igt_assert(matcher);
+
+		for (n = 0; n < ARRAY_SIZE(names); n++)
+			igt_assert_eq(igt_matcher_match(matcher, names[n]),
+				      uwildmat(names[n], expressions[e]));
+
+		igt_matcher_free(matcher);
+	}
+}
+
+static void test_batch(void)
+{
+	struct igt_matcher *matcher = igt_matcher_compile("basic-*,!*flip*");
+	bool results[ARRAY_SIZE(names)];
+	unsigned matched, n, total;
+
+	igt_assert(matcher);
+
+	matched = igt_matcher_match_batch(matcher, names, results,
+					  ARRAY_SIZE(names));
+
+	total = 0;
+	for (n = 0; n < ARRAY_SIZE(names); n++) {
+		igt_assert_eq(results[n],
+			      igt_matcher_match(matcher, names[n]));
+		total += results[n];
+	}
+	igt_assert_eq(matched, total);
+
+	/* NULL results must still count */
+	igt_assert_eq(igt_matcher_match_batch(matcher, names, NULL,
+					      ARRAY_SIZE(names)),
+		      matched);
+
+	igt_matcher_free(matcher);
+}
+
+igt_simple_main
+{
+	test_against_uwildmat();
+	test_batch();
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "igt_core.h"
+#include "igt_perf_oa.h"
+
+/* The reader only reads from an fd, so a pipe filled with hand-built
+ * records stands in for a real i915-perf stream.
+ */
+static int write_fd = -1;
+
+static void write_sample(int format_id, uint32_t timestamp, uint32_t a0)
+{
+	const struct igt_oa_format *format = igt_oa_format_info(format_id);
+	struct drm_i915_perf_record_header header = {
+		.type = DRM_I915_PERF_RECORD_SAMPLE,
+		.size = sizeof(header) + format->size,
+	};
+	uint32_t report[256 / sizeof(uint32_t)] = {};
+
+	report[1] = timestamp;
+	report[format->a_off / 4] = a0;
+
+	igt_assert_eq(write(write_fd, &header, sizeof(header)),
+		      sizeof(header));
+	igt_assert_eq(write(write_fd, report, format->size), format->size);
+}
+
+static void write_report_lost(void)
+{
+	struct drm_i915_perf_record_header header = {
+		.type = DRM_I915_PERF_RECORD_OA_REPORT_LOST,
+		.size = sizeof(header),
+	};
+
+	igt_assert_eq(write(write_fd, &header, sizeof(header)),
+		      sizeof(header));
+}
+
+static void test_iterate(void)
+{
+	const struct drm_i915_perf_record_header *header;
+	igt_oa_reader_t *reader;
+	int fds[2];
+
+	igt_assert_eq(pipe(fds), 0);
+	write_fd = fds[1];
+
+	for (int i = 0; i < 4; i++)
+		write_sample(I915_OA_FORMAT_A13, 1000 + i, 0);
+
+	reader = igt_oa_reader_new(fds[0], I915_OA_FORMAT_A13);
+
+	for (int i = 0; i < 4; i++) {
+		header = igt_oa_reader_next(reader);
+		igt_assert(header);
+		igt_assert_eq(header->type, DRM_I915_PERF_RECORD_SAMPLE);
+		igt_assert_eq(igt_oa_record_report(header)[1], 1000 + i);
+	}
+
+	/* Flushing discards whatever is left of the current batch. */
+	write_sample(I915_OA_FORMAT_A13, 2000, 0);
+	write_sample(I915_OA_FORMAT_A13, 2001, 0);
+	header = igt_oa_reader_next(reader);
+	igt_assert(header);
+	igt_assert_eq(igt_oa_record_report(header)[1], 2000);
+	igt_oa_reader_flush(reader);
+
+	write_sample(I915_OA_FORMAT_A13, 3000, 0);
+	header = igt_oa_reader_next(reader);
+	igt_assert(header);
+	igt_assert_eq(igt_oa_record_report(header)[1], 3000);
+
+	igt_oa_reader_free(reader);
+	close(fds[0]);
+	close(fds[1]);
+}
+
+struct delta_log {
+	uint32_t timestamp_deltas[16];
+	uint32_t a0_deltas[16];
+	int n;
+};
+
+static void log_deltas(uint32_t timestamp_delta, const uint32_t *deltas,
+		       int n_deltas, void *user_data)
+{
+	struct delta_log *log = user_data;
+
+	igt_assert_eq(n_deltas, 1);
+	log->timestamp_deltas[log->n] = timestamp_delta;
+	log->a0_deltas[log->n] = deltas[0];
+	log->n++;
+}
+
+static void test_deltas(void)
+{
+	struct delta_log log = {};
+	igt_oa_reader_t *reader;
+	int fds[2];
+
+	igt_assert_eq(pipe(fds), 0);
+	write_fd = fds[1];
+
+	reader = igt_oa_reader_new(fds[0], I915_OA_FORMAT_A45_B8_C8);
+	igt_assert_eq(igt_oa_subscribe(reader, IGT_OA_COUNTER_A, 0), 0);
+
+	/* The counter wraps between the last two samples: 32bit arithmetic
+	 * must still give the right delta.
+	 */
+	write_sample(I915_OA_FORMAT_A45_B8_C8, 100, 10);
+	write_sample(I915_OA_FORMAT_A45_B8_C8, 150, 40);
+	write_sample(I915_OA_FORMAT_A45_B8_C8, 225, 0xfffffff0);
+	write_sample(I915_OA_FORMAT_A45_B8_C8, 300, 0x10);
+
+	igt_assert_eq(igt_oa_reader_read_deltas(reader, log_deltas, &log), 3);
+	igt_assert_eq(log.timestamp_deltas[0], 50);
+	igt_assert_eq(log.a0_deltas[0], 30);
+	igt_assert_eq(log.a0_deltas[1], 0xfffffff0 - 40);
+	igt_assert_eq(log.timestamp_deltas[2], 75);
+	igt_assert_eq(log.a0_deltas[2], 0x20);
+
+	/* The pairing carries across separate reads... */
+	write_sample(I915_OA_FORMAT_A45_B8_C8, 400, 0x20);
+	igt_assert_eq(igt_oa_reader_read_deltas(reader, log_deltas, &log), 1);
+	igt_assert_eq(log.timestamp_deltas[3], 100);
+	igt_assert_eq(log.a0_deltas[3], 0x10);
+
+	/* ...but not across a lost report notification. */
+	write_report_lost();
+	write_sample(I915_OA_FORMAT_A45_B8_C8, 500, 0x30);
+	write_sample(I915_OA_FORMAT_A45_B8_C8, 550, 0x45);
+	igt_assert_eq(igt_oa_reader_read_deltas(reader, log_deltas, &log), 1);
+	igt_assert_eq(log.timestamp_deltas[4], 50);
+	igt_assert_eq(log.a0_deltas[4], 0x15);
+
+	igt_oa_reader_free(reader);
+	close(fds[0]);
+	close(fds[1]);
+}
+
+igt_simple_main
+{
+	test_iterate();
+	test_deltas();
+}
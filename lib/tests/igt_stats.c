@@ -23,6 +23,7 @@
  */
 
 #include "igt_core.h"
+#include "igt_ewma.h"
 #include "igt_stats.h"
 
 #define ARRAY_SIZE(arr) (sizeof(arr)/sizeof(arr[0]))
@@ -228,6 +229,268 @@ static void test_reallocation(void)
 	igt_stats_fini(&stats);
 }
 
+static void test_histogram(void)
+{
+	struct igt_histogram h;
+	unsigned int i;
+
+	/* Values below IGT_HISTOGRAM_SUB_COUNT have a bin each, so small
+	 * distributions come back exactly.
+	 */
+	igt_histogram_init(&h);
+	for (i = 0; i < 1000; i++)
+		igt_histogram_add(&h, i % 20);
+
+	igt_assert_eq(h.min, 0);
+	igt_assert_eq(h.max, 19);
+	igt_assert_eq_double(igt_histogram_get_mean(&h), 9.5);
+	igt_assert_eq_double(igt_histogram_get_percentile(&h, 50.0), 10.0);
+
+	/* Percentiles of large values are quantized, but by no more than
+	 * 1/IGT_HISTOGRAM_SUB_COUNT of the value.
+	 */
+	igt_histogram_init(&h);
+	for (i = 1; i <= 100000; i++)
+		igt_histogram_add(&h, i);
+
+	for (i = 10; i <= 90; i += 10) {
+		double exact = i / 100.0 * 100000;
+		double est = igt_histogram_get_percentile(&h, i);
+
+		igt_assert(fabs(est - exact) <=
+			   exact / IGT_HISTOGRAM_SUB_COUNT);
+	}
+
+	/* A lone outlier must not disturb the median, and the extremes are
+	 * tracked exactly rather than through the bins.
+	 */
+	igt_histogram_init(&h);
+	for (i = 0; i < 999; i++)
+		igt_histogram_add(&h, 1000);
+	igt_histogram_add(&h, 1ULL << 40);
+
+	igt_assert(fabs(igt_histogram_get_percentile(&h, 50.0) - 1000) <=
+		   1000.0 / IGT_HISTOGRAM_SUB_COUNT);
+	igt_assert_eq_u64(h.max, 1ULL << 40);
+	igt_assert(igt_histogram_get_percentile(&h, 100.0) == h.max);
+
+	/* Empty histogram */
+	igt_histogram_init(&h);
+	igt_assert_eq_double(igt_histogram_get_percentile(&h, 50.0), 0.0);
+	igt_assert_eq_double(igt_histogram_get_mean(&h), 0.0);
+}
+
+static void test_reservoir(void)
+{
+	struct igt_reservoir r;
+	struct igt_reservoir_strata s;
+	igt_stats_t stats;
+	unsigned int i;
+
+	/* A stream smaller than the reservoir is retained verbatim. */
+	igt_reservoir_init(&r, 100);
+	for (i = 0; i < 50; i++)
+		igt_reservoir_add(&r, i);
+	igt_assert_eq(r.n_values, 50);
+	igt_stats_init(&stats);
+	igt_reservoir_to_stats(&r, &stats);
+	igt_assert_eq_double(igt_stats_get_mean(&stats), 24.5);
+	igt_stats_fini(&stats);
+	igt_reservoir_fini(&r);
+
+	/* A larger stream yields a fixed-size sample whose mean tracks
+	 * the stream's (to within sampling noise; the generator is
+	 * seeded, so this is deterministic).
+	 */
+	igt_reservoir_init(&r, 100);
+	for (i = 0; i < 10000; i++)
+		igt_reservoir_add(&r, i);
+	igt_assert_eq(r.n_values, 100);
+	igt_assert_eq_u64(r.count, 10000);
+	igt_stats_init(&stats);
+	igt_reservoir_to_stats(&r, &stats);
+	igt_assert(igt_stats_get_max(&stats) < 10000);
+	igt_assert(fabs(igt_stats_get_mean(&stats) - 4999.5) < 1000.);
+	igt_stats_fini(&stats);
+	igt_reservoir_fini(&r);
+
+	/* Stratification: each bucket only samples its own period, and
+	 * both periods weigh equally in the combined stats however many
+	 * samples each produced.
+	 */
+	igt_reservoir_strata_init(&s, 2, 100, 0., 10.);
+	for (i = 0; i < 1000; i++)
+		igt_reservoir_strata_add(&s, i * 20. / 1000, i < 500 ? 100 : 1000);
+	igt_assert_eq_u64(s.buckets[0].count, 500);
+	igt_assert_eq_u64(s.buckets[1].count, 500);
+	igt_stats_init(&stats);
+	igt_reservoir_strata_to_stats(&s, &stats);
+	igt_assert_eq(stats.n_values, 200);
+	igt_assert_eq_double(igt_stats_get_mean(&stats), 550.);
+	igt_stats_fini(&stats);
+	igt_reservoir_strata_fini(&s);
+}
+
+static void test_ewma(void)
+{
+	struct igt_ewma e;
+	struct igt_ewma_rate r;
+	unsigned int i;
+
+	/* A constant signal is reproduced exactly whatever the spacing. */
+	igt_ewma_init(&e, 2.);
+	for (i = 0; i < 10; i++)
+		igt_ewma_add(&e, i * i * 0.1, 42.);
+	igt_assert_eq_double(igt_ewma_read(&e), 42.);
+
+	/* One time constant later, 1/e of a step remains. */
+	igt_ewma_init(&e, 2.);
+	igt_ewma_add(&e, 0., 1.);
+	igt_ewma_add(&e, 2., 0.);
+	igt_assert(fabs(igt_ewma_read(&e) - exp(-1.)) < 1e-9);
+
+	/* A steady event stream reads back as its rate, and silence
+	 * decays the estimate instead of holding it forever.
+	 */
+	igt_ewma_rate_init(&r, 1., 0.);
+	for (i = 1; i <= 100; i++)
+		igt_ewma_rate_add(&r, i * 0.01, 5);
+	igt_assert(fabs(igt_ewma_rate_read(&r, 1.) - 500.) < 1e-6);
+	igt_assert(igt_ewma_rate_read(&r, 11.) < 500. * exp(-9.));
+}
+
+static void test_push_array_bulk(void)
+{
+	igt_stats_t bulk, scalar;
+	uint64_t values[1027], huge[3] = { 3, 1ULL << 60, 7 };
+	unsigned int i;
+
+	/* The vectorized bulk path must agree with per-value pushes. */
+	for (i = 0; i < ARRAY_SIZE(values); i++)
+		values[i] = (i * 2654435761ul) % 100000;
+
+	igt_stats_init(&bulk);
+	igt_stats_init(&scalar);
+
+	igt_stats_push_array(&bulk, values, ARRAY_SIZE(values));
+	for (i = 0; i < ARRAY_SIZE(values); i++)
+		igt_stats_push(&scalar, values[i]);
+
+	igt_assert_eq_u64(igt_stats_get_min(&bulk),
+			  igt_stats_get_min(&scalar));
+	igt_assert_eq_u64(igt_stats_get_max(&bulk),
+			  igt_stats_get_max(&scalar));
+	igt_assert(fabs(igt_stats_get_mean(&bulk) -
+			igt_stats_get_mean(&scalar)) < 1e-6);
+	igt_assert(fabs(igt_stats_get_variance(&bulk) -
+			igt_stats_get_variance(&scalar)) <=
+		   1e-9 * igt_stats_get_variance(&scalar));
+	igt_assert_eq_double(igt_stats_get_median(&bulk),
+			     igt_stats_get_median(&scalar));
+
+	igt_stats_fini(&bulk);
+	igt_stats_fini(&scalar);
+
+	/* Samples too big for the vector lanes take the scalar path. */
+	igt_stats_init(&bulk);
+	igt_stats_push_array(&bulk, huge, ARRAY_SIZE(huge));
+	igt_assert_eq_u64(igt_stats_get_min(&bulk), 3);
+	igt_assert_eq_u64(igt_stats_get_max(&bulk), 1ULL << 60);
+	igt_stats_fini(&bulk);
+}
+
+static void test_merge(void)
+{
+	static const uint64_t s1[] =
+		{ 47, 49, 6, 7, 15, 36, 39, 40, 41, 42, 43 };
+	igt_stats_t a, b;
+	unsigned int i;
+	double q1, q2, q3;
+
+	/* Merging two halves must behave as pushing into one instance
+	 * (same expectations as test_quartiles()).
+	 */
+	igt_stats_init(&a);
+	igt_stats_init(&b);
+	igt_stats_push_array(&a, s1, 5);
+	igt_stats_push_array(&b, s1 + 5, ARRAY_SIZE(s1) - 5);
+
+	igt_stats_merge(&a, &b);
+
+	igt_assert_eq(a.n_values, ARRAY_SIZE(s1));
+	igt_stats_get_quartiles(&a, &q1, &q2, &q3);
+	igt_assert_eq_double(q1, 25.5);
+	igt_assert_eq_double(q2, 40);
+	igt_assert_eq_double(q3, 42.5);
+
+	igt_stats_fini(&a);
+	igt_stats_fini(&b);
+
+	/* Streaming instances merge their summaries directly. */
+	igt_stats_init_streaming(&a);
+	igt_stats_init_streaming(&b);
+	for (i = 1; i <= 50000; i++)
+		igt_stats_push(&a, i);
+	for (i = 50001; i <= 100000; i++)
+		igt_stats_push(&b, i);
+
+	igt_stats_merge(&a, &b);
+
+	igt_assert_eq_u64(a.n_values, 100000);
+	igt_assert_eq_u64(igt_stats_get_min(&a), 1);
+	igt_assert_eq_u64(igt_stats_get_max(&a), 100000);
+	igt_assert(fabs(igt_stats_get_mean(&a) - 50000.5) < 1e-6);
+	igt_assert(fabs(igt_stats_get_median(&a) - 50000) <=
+		   50000.0 / IGT_HISTOGRAM_SUB_COUNT);
+
+	igt_stats_fini(&a);
+	igt_stats_fini(&b);
+}
+
+static void test_streaming(void)
+{
+	igt_stats_t stats, exact;
+	unsigned int i;
+
+	/* The streaming mode must answer through the same getters as the
+	 * exact mode, with min/max/mean/variance exact and quantiles off
+	 * by no more than the histogram quantization.
+	 */
+	igt_stats_init_streaming(&stats);
+	igt_stats_init(&exact);
+
+	for (i = 1; i <= 100000; i++) {
+		igt_stats_push(&stats, i);
+		igt_stats_push(&exact, i);
+	}
+
+	igt_assert_eq_u64(stats.n_values, 100000);
+	igt_assert(!stats.values_u64);
+
+	igt_assert_eq_u64(igt_stats_get_min(&stats), 1);
+	igt_assert_eq_u64(igt_stats_get_max(&stats), 100000);
+	igt_assert_eq_double(igt_stats_get_mean(&stats),
+			     igt_stats_get_mean(&exact));
+	igt_assert(fabs(igt_stats_get_variance(&stats) -
+			igt_stats_get_variance(&exact)) <=
+		   1e-6 * igt_stats_get_variance(&exact));
+
+	for (i = 10; i <= 90; i += 10) {
+		double ref = igt_stats_get_percentile(&exact, i);
+		double est = igt_stats_get_percentile(&stats, i);
+
+		igt_assert(fabs(est - ref) <= ref / IGT_HISTOGRAM_SUB_COUNT);
+	}
+	igt_assert(fabs(igt_stats_get_median(&stats) - 50000) <=
+		   50000.0 / IGT_HISTOGRAM_SUB_COUNT);
+	igt_assert(fabs(igt_stats_get_iqm(&stats) -
+			igt_stats_get_iqm(&exact)) <=
+		   igt_stats_get_iqm(&exact) / IGT_HISTOGRAM_SUB_COUNT);
+
+	igt_stats_fini(&stats);
+	igt_stats_fini(&exact);
+}
+
 igt_simple_main
 {
 	test_init_zero();
@@ -240,4 +503,10 @@ igt_simple_main
 	test_invalidate_mean();
 	test_std_deviation();
 	test_reallocation();
+	test_histogram();
+	test_streaming();
+	test_push_array_bulk();
+	test_merge();
+	test_ewma();
+	test_reservoir();
 }
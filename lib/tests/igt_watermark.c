@@ -0,0 +1,113 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#include "igt_core.h"
+#include "igt_watermark.h"
+
+static void test_methods(void)
+{
+	/*
+	 * 1080p@60 (148.5 MHz), 4 bytes per pixel, 5 us latency:
+	 * method 1 covers 148500 * 4 * 50 / 640000 cachelines + 2.
+	 */
+	igt_assert_eq(igt_wm_method1(148500, 4, 50), 49);
+
+	/*
+	 * Same mode via method 2: 50 * 148500 / (2200 * 10000) = 0 full
+	 * lines, so one line of 1920 * 4 bytes + 2 cachelines.
+	 */
+	igt_assert_eq(igt_wm_method2(148500, 2200, 1920, 4, 50), 122);
+}
+
+static void test_ilk_plane(void)
+{
+	struct igt_wm_config config = {
+		.pixel_rate = 148500,
+		.htotal = 2200,
+		.width = 1920,
+		.cpp = 4,
+		.latency = 50,
+	};
+
+	/* Method 1 is the smaller of the two here and must win. */
+	igt_assert_eq(igt_wm_ilk_plane(&config), 49);
+
+	/* For a narrow plane the per-line cost drops and method 2 wins. */
+	config.width = 256;
+	igt_assert_eq(igt_wm_ilk_plane(&config), 18);
+
+	/* The cursor always uses method 2. */
+	config.width = 64;
+	igt_assert_eq(igt_wm_ilk_cursor(&config),
+		      igt_wm_method2(config.pixel_rate, config.htotal,
+				     config.width, config.cpp,
+				     config.latency));
+}
+
+static void test_gmch(void)
+{
+	/*
+	 * 148 MHz * 4 cpp * 200 us is over 100 KiB in flight, far more
+	 * than a 512 entry FIFO can hold, so the FIFO is exhausted.
+	 */
+	igt_assert_eq(igt_wm_gmch(148500, 4, 200000, 512, 64, 2), 0);
+
+	/* 25 MHz * 2 cpp * 100 us = 5000 bytes = 79 lines + 2 guard. */
+	igt_assert_eq(igt_wm_gmch(25175, 2, 100000, 512, 64, 2), 512 - 81);
+
+	/* Zero latency still reserves the guard entries. */
+	igt_assert_eq(igt_wm_gmch(148500, 4, 0, 512, 64, 2), 510);
+}
+
+static void test_batch(void)
+{
+	struct igt_wm_config configs[256];
+	uint32_t results[256];
+	unsigned int i;
+
+	/* The batch path must agree with the scalar path exactly. */
+	for (i = 0; i < 256; i++) {
+		configs[i].pixel_rate = 25175 + i * 1000;
+		configs[i].htotal = 2200;
+		configs[i].width = 1920;
+		configs[i].cpp = 4;
+		configs[i].latency = 10 + i;
+	}
+
+	igt_wm_ilk_plane_batch(configs, 256, results);
+	for (i = 0; i < 256; i++)
+		igt_assert_eq(results[i], igt_wm_ilk_plane(&configs[i]));
+
+	igt_wm_ilk_cursor_batch(configs, 256, results);
+	for (i = 0; i < 256; i++)
+		igt_assert_eq(results[i], igt_wm_ilk_cursor(&configs[i]));
+}
+
+igt_simple_main
+{
+	test_methods();
+	test_ilk_plane();
+	test_gmch();
+	test_batch();
+}
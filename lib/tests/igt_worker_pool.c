@@ -0,0 +1,126 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Testcase: Worker pool task completion and failure propagation.
+ *
+ * 1. A batch of tasks runs to completion and the barrier returns.
+ * 2. A single worker crashing mid-task fails the test instead of
+ *    deadlocking the barrier while its siblings stay alive.
+ */
+
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <sys/types.h>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "drmtest.h"
+#include "igt_core.h"
+
+/*
+ * We need to hide assert from the cocci igt test refactor spatch.
+ *
+ * IMPORTANT: Test infrastructure tests are the only valid places where using
+ * assert is allowed.
+ */
+#define internal_assert assert
+
+static bool crash_one;
+char test[] = "test";
+char *argv_run[] = { test };
+
+static void task(uint64_t arg)
+{
+	usleep(1000);
+}
+
+static void crashing_task(uint64_t arg)
+{
+	/* Only one worker dies; its siblings keep the done pipe open. */
+	if (arg == 0)
+		raise(SIGSEGV);
+	else
+		usleep(10000);
+}
+
+static int do_fork(void)
+{
+	int pid, status;
+	int argc;
+
+	switch (pid = fork()) {
+	case -1:
+		internal_assert(0);
+	case 0:
+		argc = 1;
+		igt_simple_init(argc, argv_run);
+
+		{
+			struct igt_worker_pool pool;
+			int i;
+
+			igt_worker_pool_init(&pool, 4);
+			for (i = 0; i < 16; i++) {
+				if (crash_one)
+					igt_worker_pool_submit(&pool,
+							       crashing_task,
+							       i);
+				else
+					igt_worker_pool_submit(&pool, task, i);
+			}
+			igt_worker_pool_barrier(&pool);
+			igt_worker_pool_fini(&pool);
+		}
+
+		igt_exit();
+	default:
+		while (waitpid(pid, &status, 0) == -1 &&
+		       errno == EINTR)
+			;
+
+		if(WIFSIGNALED(status))
+			return WTERMSIG(status) + 128;
+
+		return WEXITSTATUS(status);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	/* A clean batch completes and the test passes */
+	crash_one = false;
+	igt_info("Clean batch.\n");
+	fflush(stdout);
+	internal_assert(do_fork() == IGT_EXIT_SUCCESS);
+
+	/* One crashed worker fails the test rather than hanging it */
+	crash_one = true;
+	igt_info("Crashing worker.\n");
+	fflush(stdout);
+	internal_assert(do_fork() == 128 + SIGSEGV);
+
+	return 0;
+}
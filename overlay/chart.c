@@ -22,6 +22,7 @@
  *
  */
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
@@ -175,10 +176,12 @@ void chart_draw(struct chart *chart, cairo_t *cr)
 
 	cairo_save(cr);
 
-	cairo_translate(cr, chart->x, chart->y + chart->h);
-	cairo_scale(cr,
-		    chart->w / (double)(chart->num_samples-1),
-		    -chart->h / (chart->range[1] - chart->range[0]));
+	/* Never rasterise outside our own rectangle; with several charts
+	 * stacked in one quadrant this bounds the damage each draw can do
+	 * and lets cairo reject clipped-out geometry early.
+	 */
+	cairo_rectangle(cr, chart->x, chart->y, chart->w, chart->h);
+	cairo_clip(cr);
 
 	x = 0;
 	max = chart->current_sample;
@@ -189,6 +192,54 @@ void chart_draw(struct chart *chart, cairo_t *cr)
 		i = 0;
 		x = chart->num_samples - max;
 	}
+
+	if (max > 2*chart->w && chart->w > 1) {
+		/* More than two samples per pixel cannot add detail, only
+		 * path-construction cost, and with long histories that cost
+		 * dwarfs the samplers. Decimate to one min/max pair per
+		 * pixel column: unlike averaging, the spikes we are
+		 * normally hunting for survive.
+		 */
+		const int columns = chart->w;
+
+		cairo_translate(cr, chart->x, chart->y + chart->h);
+		cairo_scale(cr,
+			    chart->w / (double)(columns-1),
+			    -chart->h / (chart->range[1] - chart->range[0]));
+		cairo_translate(cr, x * (double)columns / chart->num_samples,
+				-chart->range[0]);
+
+		cairo_new_path(cr);
+		if (chart->mode != CHART_STROKE)
+			cairo_move_to(cr, 0, 0);
+		for (n = 0; n < columns; n++) {
+			int s0 = i + (int)((uint64_t)n * max / columns);
+			int s1 = i + (int)((uint64_t)(n + 1) * max / columns);
+			double lo, hi, v;
+
+			lo = hi = value_at(chart, s0);
+			while (++s0 < s1) {
+				v = value_at(chart, s0);
+				if (v < lo)
+					lo = v;
+				else if (v > hi)
+					hi = v;
+			}
+
+			cairo_line_to(cr, n, hi);
+			if (lo != hi)
+				cairo_line_to(cr, n, lo);
+		}
+		if (chart->mode != CHART_STROKE)
+			cairo_line_to(cr, n-1, 0);
+
+		goto render;
+	}
+
+	cairo_translate(cr, chart->x, chart->y + chart->h);
+	cairo_scale(cr,
+		    chart->w / (double)(chart->num_samples-1),
+		    -chart->h / (chart->range[1] - chart->range[0]));
 	cairo_translate(cr, x, -chart->range[0]);
 
 	cairo_new_path(cr);
@@ -211,6 +262,8 @@ void chart_draw(struct chart *chart, cairo_t *cr)
 	if (chart->mode != CHART_STROKE)
 		cairo_line_to(cr, n-1, 0);
 
+render:
+
 	cairo_identity_matrix(cr);
 	cairo_set_line_width(cr, chart->stroke_width);
 	switch (chart->mode) {
@@ -35,6 +35,16 @@
 #include "debugfs.h"
 #include "perf.h"
 
+/* One total is not enough to attribute an interrupt storm; we want to
+ * see which source is storming. Each i915 line in /proc/interrupts
+ * (one per MSI vector, so per-engine user interrupts and the display
+ * vector appear separately where the platform splits them) becomes a
+ * source with its own rate. Both files are kept open across samples
+ * and reread with a single pread() each, so sampling them at 10Hz
+ * costs two system calls, not a walk of the path lookup and
+ * open/close machinery every time.
+ */
+
 static int perf_open(void)
 {
 	struct perf_event_attr attr;
@@ -49,85 +59,154 @@ static int perf_open(void)
 	return perf_event_open(&attr, -1, 0, -1, 0);
 }
 
-static long long debugfs_read(void)
+static int buffer_read(struct gem_interrupts *irqs, int fd)
 {
-	char buf[8192], *b;
-	int fd, len;
+	int len;
 
-	sprintf(buf, "%s/i915_gem_interrupt", debugfs_dri_path);
-	fd = open(buf, 0);
-	if (fd < 0)
-		return -1;
+	for (;;) {
+		len = pread(fd, irqs->buf, irqs->buf_size-1, 0);
+		if (len < 0)
+			return -errno;
 
-	len = read(fd, buf, sizeof(buf)-1);
-	close(fd);
+		if ((size_t)len < irqs->buf_size - 1)
+			break;
+
+		/* out of room; double up and reread */
+		free(irqs->buf);
+		irqs->buf_size *= 2;
+		irqs->buf = malloc(irqs->buf_size);
+		if (irqs->buf == NULL) {
+			irqs->buf_size = 0;
+			return -ENOMEM;
+		}
+	}
+
+	irqs->buf[len] = '\0';
+	return len;
+}
 
-	if (len < 0)
+static long long debugfs_read(struct gem_interrupts *irqs)
+{
+	char *b;
+
+	if (irqs->debugfs_fd < 0)
 		return -1;
 
-	buf[len] = '\0';
+	if (buffer_read(irqs, irqs->debugfs_fd) < 0)
+		return -1;
 
-	b = strstr(buf, "Interrupts received:");
+	b = strstr(irqs->buf, "Interrupts received:");
 	if (b == NULL)
 		return -1;
 
 	return strtoull(b + sizeof("Interrupts received:"), 0, 0);
 }
 
-static long long procfs_read(void)
+static struct gem_interrupts_source *
+source_lookup(struct gem_interrupts *irqs, const char *name)
 {
-	char buf[8192], *b;
-	int fd, len;
-	unsigned long long val;
+	int n;
 
-/* 44:         51      42446          0          0   PCI-MSI-edge      i915*/
-	fd = open("/proc/interrupts", 0);
-	if (fd < 0)
-		return -1;
+	for (n = 0; n < irqs->num_sources; n++)
+		if (strcmp(irqs->source[n].name, name) == 0)
+			return &irqs->source[n];
 
-	len = read(fd, buf, sizeof(buf)-1);
-	close(fd);
+	if (n == GEM_INTERRUPTS_MAX_SOURCES)
+		return NULL;
 
-	if (len < 0)
-		return -1;
+	memset(&irqs->source[n], 0, sizeof(irqs->source[n]));
+	strncpy(irqs->source[n].name, name,
+		sizeof(irqs->source[n].name)-1);
+	irqs->num_sources = n + 1;
 
-	buf[len] = '\0';
+	return &irqs->source[n];
+}
 
-	b = strstr(buf, "i915");
-	if (b == NULL)
+static long long procfs_read(struct gem_interrupts *irqs)
+{
+	long long total = -1;
+	char *line, *next;
+
+/* 44:         51      42446          0          0   PCI-MSI-edge      i915*/
+	if (irqs->proc_fd < 0)
 		return -1;
-	while (*--b != ':')
-		;
-
-	val = 0;
-	do {
-		while (isspace(*++b))
-			;
-		if (!isdigit(*b))
-			break;
 
-		val += strtoull(b, &b, 0);
-	} while(1);
+	if (buffer_read(irqs, irqs->proc_fd) < 0)
+		return -1;
 
-	return val;
+	for (line = irqs->buf; line; line = next) {
+		struct gem_interrupts_source *source;
+		unsigned long long val;
+		char *b, *end;
+
+		next = strchr(line, '\n');
+		if (next)
+			*next++ = '\0';
+
+		if (strstr(line, "i915") == NULL)
+			continue;
+
+		b = strchr(line, ':');
+		if (b == NULL)
+			continue;
+
+		/* sum the per-cpu columns */
+		val = 0;
+		do {
+			while (isspace(*++b))
+				;
+			if (!isdigit(*b))
+				break;
+
+			val += strtoull(b, &b, 0);
+		} while (1);
+
+		if (total < 0)
+			total = 0;
+		total += val;
+
+		/* name the source after the action, i.e. the last token */
+		end = line + strlen(line);
+		while (end > line && isspace(end[-1]))
+			*--end = '\0';
+		b = strrchr(line, ' ');
+		source = source_lookup(irqs, b ? b + 1 : line);
+		if (source)
+			source->count = val;
+	}
+
+	return total;
 }
 
-static long long interrupts_read(void)
+static long long interrupts_read(struct gem_interrupts *irqs)
 {
 	long long val;
 
-	val = debugfs_read();
+	/* procfs also refreshes the per-source counts */
+	val = procfs_read(irqs);
 	if (val < 0)
-		val = procfs_read();
+		val = debugfs_read(irqs);
 	return val;
 }
 
 int gem_interrupts_init(struct gem_interrupts *irqs)
 {
+	char buf[1024];
+
 	memset(irqs, 0, sizeof(*irqs));
 
+	irqs->buf_size = 8192;
+	irqs->buf = malloc(irqs->buf_size);
+	if (irqs->buf == NULL)
+		return irqs->error = ENOMEM;
+
+	irqs->proc_fd = open("/proc/interrupts", 0);
+
+	sprintf(buf, "%s/i915_gem_interrupt", debugfs_dri_path);
+	irqs->debugfs_fd = open(buf, 0);
+
 	irqs->fd = perf_open();
-	if (irqs->fd < 0 && interrupts_read() < 0)
+	if (irqs->fd < 0 && interrupts_read(irqs) < 0)
 		irqs->error = ENODEV;
 
 	return irqs->error;
@@ -136,14 +215,14 @@ int gem_interrupts_init(struct gem_interrupts *irqs)
 int gem_interrupts_update(struct gem_interrupts *irqs)
 {
 	uint64_t val;
-	int update;
+	int n, update;
 
 	if (irqs->error)
 		return irqs->error;
 
 	if (irqs->fd < 0) {
 		long long ret;
-		ret = interrupts_read();
+		ret = interrupts_read(irqs);
 		if (ret < 0)
 			return irqs->error = ENODEV;
 		else
@@ -151,6 +230,16 @@ int gem_interrupts_update(struct gem_interrupts *irqs)
 	} else {
 		if (read(irqs->fd, &val, sizeof(val)) < 0)
 			return irqs->error = errno;
+
+		/* the total comes from perf, the breakdown from procfs */
+		procfs_read(irqs);
+	}
+
+	for (n = 0; n < irqs->num_sources; n++) {
+		struct gem_interrupts_source *source = &irqs->source[n];
+
+		source->delta = source->count - source->last_count;
+		source->last_count = source->count;
 	}
 
 	update = irqs->last_count == 0;
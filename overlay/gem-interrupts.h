@@ -27,10 +27,24 @@
 
 #include <stdint.h>
 
+#define GEM_INTERRUPTS_MAX_SOURCES 8
+
 struct gem_interrupts {
 	long unsigned last_count, count, delta;
+
+	/* one entry per /proc/interrupts line claimed by i915 */
+	struct gem_interrupts_source {
+		char name[32];
+		long unsigned last_count, count, delta;
+	} source[GEM_INTERRUPTS_MAX_SOURCES];
+	int num_sources;
+
 	int error;
 	int fd;
+	int proc_fd;
+	int debugfs_fd;
+	char *buf;
+	size_t buf_size;
 };
 
 int gem_interrupts_init(struct gem_interrupts *irqs);
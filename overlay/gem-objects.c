@@ -46,28 +46,63 @@
  *	Xorg: 35 objects, 16347136 bytes (0 active, 12103680 inactive, 0 unbound)
  */
 
+/* Sampling this file at 10Hz must not itself become a workload: the fd
+ * is opened once and reread with a single pread(), the line buffer is
+ * reused (and only grows when the client list outgrows it), and client
+ * entries are recycled through a free pool, so steady-state sampling
+ * performs no allocations and a single system call.
+ */
+
+static int gem_objects_read(struct gem_objects *obj)
+{
+	int len;
+
+	for (;;) {
+		len = pread(obj->fd, obj->buf+1, obj->buf_size-2, 0);
+		if (len < 0)
+			return -errno;
+
+		if ((size_t)len < obj->buf_size - 2)
+			break;
+
+		/* out of room; double up and reread */
+		free(obj->buf);
+		obj->buf_size *= 2;
+		obj->buf = malloc(obj->buf_size);
+		if (obj->buf == NULL) {
+			obj->buf_size = 0;
+			return -ENOMEM;
+		}
+	}
+
+	/* Add sentinel values for the string searches */
+	obj->buf[0] = '\n';
+	obj->buf[len+1] = '\0';
+
+	return len;
+}
+
 int gem_objects_init(struct gem_objects *obj)
 {
-	char buf[8192], *b;
-	int fd, len;
+	char filename[1024];
+	char *b;
 
 	memset(obj, 0, sizeof(*obj));
 
-	sprintf(buf, "%s/i915_gem_objects", debugfs_dri_path);
-	fd = open(buf, 0);
-	if (fd < 0)
+	sprintf(filename, "%s/i915_gem_objects", debugfs_dri_path);
+	obj->fd = open(filename, 0);
+	if (obj->fd < 0)
 		return errno;
-	len = read(fd, buf+1, sizeof(buf)-2);
-	close(fd);
 
-	if (len < 0)
-		return EIO;
+	obj->buf_size = 8192;
+	obj->buf = malloc(obj->buf_size);
+	if (obj->buf == NULL)
+		return ENOMEM;
 
-	/* Add sentinel values for the string searches */
-	buf[0] = '\n';
-	buf[len+1] = '\0';
+	if (gem_objects_read(obj) < 0)
+		return EIO;
 
-	b = strstr(buf, "gtt total");
+	b = strstr(obj->buf, "gtt total");
 	if (b == NULL)
 		return EIO;
 
@@ -93,35 +128,47 @@ static void insert_sorted(struct gem_objects *obj,
 	*prev = comm;
 }
 
-int gem_objects_update(struct gem_objects *obj)
+static struct gem_objects_comm *
+lookup_comm(struct gem_objects *obj, struct gem_objects_comm **list,
+	    const char *name)
 {
-	char buf[8192], *b;
-	struct gem_objects_comm *comm;
-	struct gem_objects_comm *freed;
-	int fd, len, ret;
-
-	freed = obj->comm;
-	obj->comm = NULL;
+	struct gem_objects_comm *comm, **prev;
 
-	sprintf(buf, "%s/i915_gem_objects", debugfs_dri_path);
-	fd = open(buf, 0);
-	if (fd < 0) {
-		ret = errno;
-		goto done;
+	/* a returning client keeps its history for the deltas */
+	for (prev = list; (comm = *prev) != NULL; prev = &comm->next) {
+		if (strcmp(comm->name, name) == 0) {
+			*prev = comm->next;
+			return comm;
+		}
 	}
-	len = read(fd, buf, sizeof(buf)-1);
-	close(fd);
 
-	if (len < 0) {
-		ret = EIO;
-		goto done;
-	}
+	comm = obj->pool;
+	if (comm)
+		obj->pool = comm->next;
+	else
+		comm = malloc(sizeof(*comm));
+	if (comm == NULL)
+		return NULL;
+
+	memset(comm, 0, sizeof(*comm));
+	strcpy(comm->name, name);
+	return comm;
+}
 
-	buf[len] = '\0';
-	while (buf[--len] == '\n')
-		buf[len] = '\0';
+int gem_objects_update(struct gem_objects *obj)
+{
+	struct gem_objects_comm *comm, *list;
+	char *b;
+	int len;
 
-	b = buf;
+	len = gem_objects_read(obj);
+	if (len < 0)
+		return -len;
+
+	b = obj->buf + 1;
+	b[len] = '\0';
+	while (b[--len] == '\n')
+		b[len] = '\0';
 
 	sscanf(b, "%lu objects, %lu bytes",
 	       &obj->total_count, &obj->total_bytes);
@@ -130,7 +177,9 @@ int gem_objects_update(struct gem_objects *obj)
 	sscanf(b, "%*d [%*d] objects, %lu [%lu] bytes in gtt",
 	       &obj->total_gtt, &obj->total_aperture);
 
-	ret = 0;
+	list = obj->comm;
+	obj->comm = NULL;
+
 	b = strchr(b, ':');
 	if (b == NULL)
 		goto done;
@@ -140,16 +189,9 @@ int gem_objects_update(struct gem_objects *obj)
 	b++;
 
 	do {
+		long unsigned count, bytes;
 		char *eol, *colon;
 
-		comm = freed;
-		if (comm)
-			freed = comm->next;
-		else
-			comm = malloc(sizeof(*comm));
-		if (comm == NULL)
-			break;
-
 		/* Xorg: 35 objects, 16347136 bytes (0 active, 12103680 inactive, 0 unbound) */
 		eol = strchr(b, '\n');
 		if (eol) {
@@ -159,22 +201,35 @@ int gem_objects_update(struct gem_objects *obj)
 		}
 
 		colon = strchr(b, ':');
-		memcpy(comm->name, b, colon-b+1);
-		comm->name[colon-b+1] = '\0';
+		if (colon == NULL)
+			break;
+		colon[1] = '\0';
 
-		sscanf(colon + 1, "%lu objects, %lu bytes",
-		       &comm->count, &comm->bytes);
+		comm = lookup_comm(obj, &list, b);
+		if (comm == NULL)
+			break;
+
+		count = bytes = 0;
+		sscanf(colon + 2, "%lu objects, %lu bytes",
+		       &count, &bytes);
+
+		comm->count_delta = count - comm->count;
+		comm->bytes_delta = bytes - comm->bytes;
+		comm->count = count;
+		comm->bytes = bytes;
 
 		insert_sorted(obj, comm);
 		b = eol;
 	} while (b != NULL);
 
 done:
-	while (freed) {
-		comm = freed;
-		freed = comm->next;
-		free(comm);
+	/* vanished clients return to the pool for reuse */
+	while (list) {
+		comm = list;
+		list = comm->next;
+		comm->next = obj->pool;
+		obj->pool = comm;
 	}
 
-	return ret;
+	return 0;
 }
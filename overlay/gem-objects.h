@@ -31,12 +31,18 @@ struct gem_objects {
 	long unsigned total_bytes, total_count;
 	long unsigned total_gtt, total_aperture;
 	long unsigned max_gtt, max_aperture;
+	int fd;
+	char *buf;
+	size_t buf_size;
 	struct gem_objects_comm {
 		struct gem_objects_comm *next;
 		char name[256];
 		long unsigned bytes;
 		long unsigned count;
+		long bytes_delta;
+		long count_delta;
 	} *comm;
+	struct gem_objects_comm *pool;
 };
 
 int gem_objects_init(struct gem_objects *obj);
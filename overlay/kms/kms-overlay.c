@@ -25,6 +25,7 @@
 #include <sys/types.h>
 #include <sys/mman.h>
 #include <cairo.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -61,6 +62,14 @@ struct kms_overlay {
 	int x, y;
 	int visible;
 
+	bool atomic;
+	uint32_t plane;
+	struct {
+		uint32_t fb_id, crtc_id;
+		uint32_t crtc_x, crtc_y, crtc_w, crtc_h;
+		uint32_t src_x, src_y, src_w, src_h;
+	} prop;
+
 	void *mem;
 	int size;
 };
@@ -112,6 +121,171 @@ static int detach_from_crtc(int fd, int crtc)
 	return drmIoctl(fd, DRM_IOCTL_MODE_SETPLANE, &s) == 0;
 }
 
+/*
+ * Legacy SETPLANE serializes with whatever commit the compositor has in
+ * flight, so presenting the overlay can block inside the kernel and stall
+ * the very workload being observed. Where the kernel speaks atomic we
+ * instead queue a NONBLOCK commit: if the display is busy the commit
+ * returns -EBUSY and we simply present a frame later, never waiting.
+ */
+#ifdef DRM_CLIENT_CAP_ATOMIC
+
+static uint32_t lookup_prop(int fd, uint32_t obj, uint32_t obj_type,
+			    const char *name)
+{
+	drmModeObjectPropertiesPtr props;
+	uint32_t id = 0;
+	int i;
+
+	props = drmModeObjectGetProperties(fd, obj, obj_type);
+	if (props == NULL)
+		return 0;
+
+	for (i = 0; i < props->count_props && id == 0; i++) {
+		drmModePropertyPtr prop;
+
+		prop = drmModeGetProperty(fd, props->props[i]);
+		if (prop == NULL)
+			continue;
+
+		if (strcmp(prop->name, name) == 0)
+			id = prop->prop_id;
+
+		drmModeFreeProperty(prop);
+	}
+	drmModeFreeObjectProperties(props);
+
+	return id;
+}
+
+static uint32_t find_overlay_plane(int fd, int crtc_id)
+{
+	drmModePlaneResPtr res;
+	drmModeResPtr kmode;
+	uint32_t plane = 0;
+	int crtc_index = -1;
+	int i;
+
+	kmode = drmModeGetResources(fd);
+	if (kmode == NULL)
+		return 0;
+
+	for (i = 0; i < kmode->count_crtcs; i++)
+		if (kmode->crtcs[i] == crtc_id)
+			crtc_index = i;
+	drmModeFreeResources(kmode);
+
+	if (crtc_index < 0)
+		return 0;
+
+	res = drmModeGetPlaneResources(fd);
+	if (res == NULL)
+		return 0;
+
+	for (i = 0; i < res->count_planes && plane == 0; i++) {
+		drmModePlanePtr p;
+
+		p = drmModeGetPlane(fd, res->planes[i]);
+		if (p == NULL)
+			continue;
+
+		/* an idle overlay plane (type == 0) usable on our crtc */
+		if (p->possible_crtcs & (1 << crtc_index) &&
+		    p->crtc_id == 0 && p->fb_id == 0)
+			plane = p->plane_id;
+
+		drmModeFreePlane(p);
+	}
+	drmModeFreePlaneResources(res);
+
+	return plane;
+}
+
+static bool kms_atomic_init(struct kms_overlay *priv)
+{
+	if (drmSetClientCap(priv->fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1) ||
+	    drmSetClientCap(priv->fd, DRM_CLIENT_CAP_ATOMIC, 1))
+		return false;
+
+	priv->plane = find_overlay_plane(priv->fd, priv->crtc);
+	if (priv->plane == 0)
+		return false;
+
+	priv->prop.fb_id = lookup_prop(priv->fd, priv->plane,
+				       DRM_MODE_OBJECT_PLANE, "FB_ID");
+	priv->prop.crtc_id = lookup_prop(priv->fd, priv->plane,
+					 DRM_MODE_OBJECT_PLANE, "CRTC_ID");
+	priv->prop.crtc_x = lookup_prop(priv->fd, priv->plane,
+					DRM_MODE_OBJECT_PLANE, "CRTC_X");
+	priv->prop.crtc_y = lookup_prop(priv->fd, priv->plane,
+					DRM_MODE_OBJECT_PLANE, "CRTC_Y");
+	priv->prop.crtc_w = lookup_prop(priv->fd, priv->plane,
+					DRM_MODE_OBJECT_PLANE, "CRTC_W");
+	priv->prop.crtc_h = lookup_prop(priv->fd, priv->plane,
+					DRM_MODE_OBJECT_PLANE, "CRTC_H");
+	priv->prop.src_x = lookup_prop(priv->fd, priv->plane,
+				       DRM_MODE_OBJECT_PLANE, "SRC_X");
+	priv->prop.src_y = lookup_prop(priv->fd, priv->plane,
+				       DRM_MODE_OBJECT_PLANE, "SRC_Y");
+	priv->prop.src_w = lookup_prop(priv->fd, priv->plane,
+				       DRM_MODE_OBJECT_PLANE, "SRC_W");
+	priv->prop.src_h = lookup_prop(priv->fd, priv->plane,
+				       DRM_MODE_OBJECT_PLANE, "SRC_H");
+
+	return priv->prop.fb_id && priv->prop.crtc_id &&
+	       priv->prop.crtc_x && priv->prop.crtc_y &&
+	       priv->prop.crtc_w && priv->prop.crtc_h &&
+	       priv->prop.src_x && priv->prop.src_y &&
+	       priv->prop.src_w && priv->prop.src_h;
+}
+
+static int commit_atomic(struct kms_overlay *priv, bool attach)
+{
+	drmModeAtomicReqPtr req;
+	int ret;
+
+	req = drmModeAtomicAlloc();
+	if (req == NULL)
+		return -ENOMEM;
+
+	drmModeAtomicAddProperty(req, priv->plane, priv->prop.fb_id,
+				 attach ? priv->image.name : 0);
+	drmModeAtomicAddProperty(req, priv->plane, priv->prop.crtc_id,
+				 attach ? priv->crtc : 0);
+	drmModeAtomicAddProperty(req, priv->plane, priv->prop.crtc_x, priv->x);
+	drmModeAtomicAddProperty(req, priv->plane, priv->prop.crtc_y, priv->y);
+	drmModeAtomicAddProperty(req, priv->plane, priv->prop.crtc_w,
+				 priv->image.width);
+	drmModeAtomicAddProperty(req, priv->plane, priv->prop.crtc_h,
+				 priv->image.height);
+	drmModeAtomicAddProperty(req, priv->plane, priv->prop.src_x, 0);
+	drmModeAtomicAddProperty(req, priv->plane, priv->prop.src_y, 0);
+	drmModeAtomicAddProperty(req, priv->plane, priv->prop.src_w,
+				 priv->image.width << 16);
+	drmModeAtomicAddProperty(req, priv->plane, priv->prop.src_h,
+				 priv->image.height << 16);
+
+	ret = drmModeAtomicCommit(priv->fd, req, DRM_MODE_ATOMIC_NONBLOCK,
+				  NULL);
+	drmModeAtomicFree(req);
+
+	return ret;
+}
+
+#else
+
+static bool kms_atomic_init(struct kms_overlay *priv)
+{
+	return false;
+}
+
+static int commit_atomic(struct kms_overlay *priv, bool attach)
+{
+	return -ENODEV;
+}
+
+#endif /* DRM_CLIENT_CAP_ATOMIC */
+
 static void kms_overlay_show(struct overlay *overlay)
 {
 	struct kms_overlay *priv = to_kms_overlay(overlay);
@@ -119,7 +293,18 @@ static void kms_overlay_show(struct overlay *overlay)
 	memcpy(priv->image.map, priv->mem, priv->size);
 
 	if (!priv->visible) {
-		attach_to_crtc(priv->fd, priv->crtc, priv->x, priv->y, &priv->image);
+		if (priv->atomic) {
+			int ret = commit_atomic(priv, true);
+
+			if (ret == -EBUSY)
+				return; /* display busy, retry next sample */
+			if (ret)
+				priv->atomic = false;
+		}
+
+		if (!priv->atomic)
+			attach_to_crtc(priv->fd, priv->crtc, priv->x, priv->y,
+				       &priv->image);
 		priv->visible = true;
 	}
 }
@@ -129,7 +314,8 @@ static void kms_overlay_hide(struct overlay *overlay)
 	struct kms_overlay *priv = to_kms_overlay(overlay);
 
 	if (priv->visible) {
-		detach_from_crtc(priv->fd, priv->crtc);
+		if (!priv->atomic || commit_atomic(priv, false))
+			detach_from_crtc(priv->fd, priv->crtc);
 		priv->visible = false;
 	}
 }
@@ -259,6 +445,8 @@ kms_overlay_create(struct config *config, int *width, int *height)
 	if (priv->crtc == 0)
 		goto err_fd;
 
+	priv->atomic = kms_atomic_init(priv);
+
 	priv->image.format = DRM_FORMAT_XRGB8888;
 	priv->image.width = ALIGN(*width, 4);
 	priv->image.height = ALIGN(*height, 2);
@@ -36,6 +36,8 @@
 #include <getopt.h>
 #include <time.h>
 #include <locale.h>
+#include <netdb.h>
+#include <sys/socket.h>
 
 #include "overlay.h"
 #include "chart.h"
@@ -49,6 +51,8 @@
 #include "gpu-perf.h"
 #include "power.h"
 #include "rc6.h"
+#include "sample-sources.h"
+#include "sample-stream.h"
 
 #define is_power_of_two(x)  (((x) & ((x)-1)) == 0)
 
@@ -699,7 +703,14 @@ static void show_gpu_freq(struct overlay_context *ctx, struct overlay_gpu_freq *
 	}
 
 	if (has_power) {
-		sprintf(buf, "Power: %llumW", (long long unsigned)gf->power.power_mW);
+		len = sprintf(buf, "Power: %llumW",
+			      (long long unsigned)gf->power.power_mW);
+		if (rapl_has_domain(&gf->power.rapl, RAPL_PKG))
+			len += sprintf(buf + len, ", pkg: %llumW",
+				       (long long unsigned)gf->power.rapl.domain[RAPL_PKG].power_mW);
+		if (rapl_has_domain(&gf->power.rapl, RAPL_CORES))
+			sprintf(buf + len, ", cores: %llumW",
+				(long long unsigned)gf->power.rapl.domain[RAPL_CORES].power_mW);
 		cairo_set_source_rgba(ctx->cr, 1, 1, 1, 1);
 		cairo_move_to(ctx->cr, PAD, y);
 		cairo_show_text(ctx->cr, buf);
@@ -707,7 +718,21 @@ static void show_gpu_freq(struct overlay_context *ctx, struct overlay_gpu_freq *
 	}
 
 	if (has_irqs) {
-		sprintf(buf, "Interrupts: %llu", (long long unsigned)gf->irqs.delta);
+		len = sprintf(buf, "Interrupts: %llu",
+			      (long long unsigned)gf->irqs.delta);
+		if (gf->irqs.num_sources > 1) {
+			int n;
+
+			for (n = 0; n < gf->irqs.num_sources; n++) {
+				if (len > (int)sizeof(buf) - 48)
+					break;
+				len += sprintf(buf + len, "%s %.10s: %lu",
+					       n ? "," : " (",
+					       gf->irqs.source[n].name,
+					       gf->irqs.source[n].delta);
+			}
+			sprintf(buf + len, ")");
+		}
 		cairo_set_source_rgba(ctx->cr, 1, 1, 1, 1);
 		cairo_move_to(ctx->cr, PAD, y);
 		cairo_show_text(ctx->cr, buf);
@@ -742,7 +767,7 @@ static void show_gem_objects(struct overlay_context *ctx, struct overlay_gem_obj
 	struct gem_objects_comm *comm;
 	char buf[160];
 	cairo_pattern_t *linear;
-	int x, y, y1, y2;
+	int x, y, y1, y2, len;
 
 	if (go->error == 0)
 		go->error = gem_objects_update(&go->gem_objects);
@@ -795,8 +820,10 @@ static void show_gem_objects(struct overlay_context *ctx, struct overlay_gem_obj
 		if ((comm->bytes >> 20) == 0)
 			break;
 
-		sprintf(buf, "%s %ldMB, %ld objects",
-			comm->name, comm->bytes >> 20, comm->count);
+		len = sprintf(buf, "%s %ldMB, %ld objects",
+			      comm->name, comm->bytes >> 20, comm->count);
+		if (comm->bytes_delta)
+			sprintf(buf + len, " (%+ldKB)", comm->bytes_delta >> 10);
 		cairo_move_to(ctx->cr, x, y);
 		cairo_show_text(ctx->cr, buf);
 		y += 12;
@@ -832,6 +859,361 @@ static void overlay_snapshot(struct overlay_context *ctx)
 	cairo_surface_write_to_png(ctx->surface, buf);
 }
 
+/* Headless trace recorder: run the samplers but write the records into
+ * an mmapped on-disk ring instead of drawing them, for post-mortem
+ * analysis. The file is sized up front and old samples are overwritten
+ * once it fills, so a recorder left running for days cannot eat the
+ * disk; the head counter is bumped only after its record is complete,
+ * so a trace interrupted by a crash decodes cleanly up to the final
+ * sample. Use intel-gpu-trace-decode to convert the result to CSV.
+ */
+static int record_loop(struct config *config, const char *filename,
+		       int daemonize)
+{
+	struct sample_sources sources;
+	struct sample_trace_header *th;
+	struct sample_stream_record *records;
+	const char *value;
+	uint64_t size = 16 << 20;
+	uint32_t capacity;
+	int period = get_sample_period(config);
+	int fd;
+
+	value = config_get_value(config, "trace", "size");
+	if (value && atoi(value) > 0)
+		size = (uint64_t)atoi(value) << 20;
+
+	capacity = (size - sizeof(*th)) / sizeof(*records);
+	if (capacity == 0)
+		return EINVAL;
+
+	fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "Unable to create trace '%s': %s\n",
+			filename, strerror(errno));
+		return errno;
+	}
+
+	size = sizeof(*th) + (uint64_t)capacity * sizeof(*records);
+	if (ftruncate(fd, size)) {
+		close(fd);
+		return ENOSPC;
+	}
+
+	th = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (th == MAP_FAILED)
+		return ENOMEM;
+
+	records = (struct sample_stream_record *)(th + 1);
+
+	if (daemonize && daemon(0, 0))
+		return EINVAL;
+
+	debugfs_init();
+	sample_sources_init(&sources);
+
+	th->magic = SAMPLE_TRACE_MAGIC;
+	th->version = SAMPLE_TRACE_VERSION;
+	th->record_size = sizeof(*records);
+	th->capacity = capacity;
+	th->head = 0;
+	sample_sources_header(&sources, period, &th->stream);
+
+	for (;;) {
+		sample_sources_record(&sources, &records[th->head % capacity]);
+		th->head++;
+		usleep(period);
+	}
+}
+
+/* Receiving renderer for the intel-gpu-sampler stream: the headless
+ * sampler runs on the DUT and we draw its charts here, so a single
+ * workstation can watch a rack of targets without any of them needing
+ * a display.
+ */
+
+struct overlay_remote {
+	int fd;
+	struct sample_stream_header header;
+	struct chart busy[SAMPLE_STREAM_MAX_RINGS];
+	struct chart wait[SAMPLE_STREAM_MAX_RINGS];
+	struct chart cpu;
+	struct chart power;
+	double power_max;
+};
+
+static int remote_connect(const char *spec)
+{
+	struct addrinfo hints, *result, *rp;
+	char *host, *port;
+	int fd = -1;
+
+	host = strdup(spec);
+	port = strrchr(host, ':');
+	if (port == NULL) {
+		free(host);
+		return -1;
+	}
+	*port++ = '\0';
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	if (getaddrinfo(host, port, &hints, &result)) {
+		free(host);
+		return -1;
+	}
+
+	for (rp = result; rp; rp = rp->ai_next) {
+		fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+		if (fd < 0)
+			continue;
+
+		if (connect(fd, rp->ai_addr, rp->ai_addrlen) == 0)
+			break;
+
+		close(fd);
+		fd = -1;
+	}
+
+	freeaddrinfo(result);
+	free(host);
+	return fd;
+}
+
+static int read_all(int fd, void *buf, size_t len)
+{
+	uint8_t *ptr = buf;
+
+	while (len) {
+		ssize_t ret = read(fd, ptr, len);
+		if (ret <= 0)
+			return -1;
+
+		ptr += ret;
+		len -= ret;
+	}
+
+	return 0;
+}
+
+static int remote_init(struct overlay_context *ctx,
+		       struct overlay_remote *remote,
+		       const char *spec)
+{
+	const double rgba[][4] = {
+		{ 1, 0.25, 0.25, 1 },
+		{ 0.25, 1, 0.25, 1 },
+		{ 0.25, 0.25, 1, 1 },
+		{ 1, 1, 1, 1 },
+	};
+	int n;
+
+	remote->fd = remote_connect(spec);
+	if (remote->fd < 0) {
+		fprintf(stderr, "Unable to connect to '%s'\n", spec);
+		return -1;
+	}
+
+	if (read_all(remote->fd, &remote->header, sizeof(remote->header)) ||
+	    remote->header.magic != SAMPLE_STREAM_MAGIC ||
+	    remote->header.version != SAMPLE_STREAM_VERSION ||
+	    remote->header.num_rings > SAMPLE_STREAM_MAX_RINGS) {
+		fprintf(stderr, "'%s' is not an intel-gpu-sampler\n", spec);
+		close(remote->fd);
+		return -1;
+	}
+
+	chart_init(&remote->cpu, "CPU", 120);
+	chart_set_position(&remote->cpu, PAD, PAD);
+	chart_set_size(&remote->cpu, ctx->width/2 - SIZE_PAD, ctx->height - 2*PAD);
+	chart_set_stroke_rgba(&remote->cpu, 0.75, 0.25, 0.75, 1.);
+	chart_set_mode(&remote->cpu, CHART_STROKE);
+	chart_set_range(&remote->cpu, 0, 100);
+
+	for (n = 0; n < remote->header.num_rings; n++) {
+		chart_init(&remote->busy[n], remote->header.ring_names[n], 120);
+		chart_set_position(&remote->busy[n], PAD, PAD);
+		chart_set_size(&remote->busy[n], ctx->width/2 - SIZE_PAD, ctx->height - 2*PAD);
+		chart_set_stroke_rgba(&remote->busy[n],
+				      rgba[n % 4][0], rgba[n % 4][1],
+				      rgba[n % 4][2], rgba[n % 4][3]);
+		chart_set_mode(&remote->busy[n], CHART_STROKE);
+		chart_set_range(&remote->busy[n], 0, 100);
+
+		chart_init(&remote->wait[n], remote->header.ring_names[n], 120);
+		chart_set_position(&remote->wait[n], PAD, PAD);
+		chart_set_size(&remote->wait[n], ctx->width/2 - SIZE_PAD, ctx->height - 2*PAD);
+		chart_set_fill_rgba(&remote->wait[n],
+				    rgba[n % 4][0], rgba[n % 4][1],
+				    rgba[n % 4][2], rgba[n % 4][3] * 0.70);
+		chart_set_mode(&remote->wait[n], CHART_FILL);
+		chart_set_range(&remote->wait[n], 0, 100);
+	}
+
+	chart_init(&remote->power, "power", 120);
+	chart_set_position(&remote->power, ctx->width/2 + HALF_PAD, PAD);
+	chart_set_size(&remote->power, ctx->width/2 - SIZE_PAD, ctx->height - 2*PAD);
+	chart_set_stroke_rgba(&remote->power, 0.45, 0.55, 0.45, 1.);
+	chart_set_mode(&remote->power, CHART_STROKE);
+	remote->power_max = 0;
+
+	return 0;
+}
+
+static void show_remote(struct overlay_context *ctx,
+			struct overlay_remote *remote,
+			const struct sample_stream_record *record)
+{
+	char buf[160];
+	int n, x, y, len;
+
+	cairo_rectangle(ctx->cr, PAD-.5, PAD-.5,
+			ctx->width/2-SIZE_PAD+1, ctx->height-2*PAD+1);
+	cairo_rectangle(ctx->cr, ctx->width/2+HALF_PAD-.5, PAD-.5,
+			ctx->width/2-SIZE_PAD+1, ctx->height-2*PAD+1);
+	cairo_set_source_rgb(ctx->cr, .15, .15, .15);
+	cairo_set_line_width(ctx->cr, 1);
+	cairo_stroke(ctx->cr);
+
+	for (n = 0; n < remote->header.num_rings; n++) {
+		chart_add_sample(&remote->wait[n],
+				 record->wait[n] + record->sema[n]);
+		chart_draw(&remote->wait[n], ctx->cr);
+	}
+	for (n = 0; n < remote->header.num_rings; n++) {
+		chart_add_sample(&remote->busy[n], record->busy[n]);
+		chart_draw(&remote->busy[n], ctx->cr);
+	}
+	chart_add_sample(&remote->cpu, record->cpu_busy);
+	chart_draw(&remote->cpu, ctx->cr);
+
+	if (record->power_mW > remote->power_max)
+		remote->power_max = record->power_mW;
+	chart_add_sample(&remote->power, record->power_mW);
+	chart_set_range(&remote->power, 0, remote->power_max);
+	chart_draw(&remote->power, ctx->cr);
+
+	y = PAD + 12 - 2;
+	cairo_set_source_rgba(ctx->cr, 0.75, 0.25, 0.75, 1.);
+	cairo_move_to(ctx->cr, PAD, y);
+	sprintf(buf, "CPU: %3d%% busy", record->cpu_busy);
+	cairo_show_text(ctx->cr, buf);
+	y += 14;
+
+	for (n = 0; n < remote->header.num_rings; n++) {
+		struct chart *c = &remote->busy[n];
+
+		len = sprintf(buf, "%s: %3d%% busy",
+			      remote->header.ring_names[n], record->busy[n]);
+		if (record->wait[n])
+			len += sprintf(buf + len, ", %d%% wait", record->wait[n]);
+		if (record->sema[n])
+			len += sprintf(buf + len, ", %d%% sema", record->sema[n]);
+
+		cairo_set_source_rgba(ctx->cr,
+				      c->stroke_rgb[0],
+				      c->stroke_rgb[1],
+				      c->stroke_rgb[2],
+				      c->stroke_rgb[3]);
+		cairo_move_to(ctx->cr, PAD, y);
+		cairo_show_text(ctx->cr, buf);
+		y += 14;
+	}
+
+	x = ctx->width/2 + HALF_PAD;
+	y = PAD + 12 - 2;
+	cairo_set_source_rgba(ctx->cr, 1, 1, 1, 1);
+
+	if (record->freq_current) {
+		len = sprintf(buf, "Frequency: %dMHz", record->freq_current);
+		if (record->freq_request)
+			sprintf(buf + len, " (requested %dMHz)",
+				record->freq_request);
+		cairo_move_to(ctx->cr, x, y);
+		cairo_show_text(ctx->cr, buf);
+		y += 14;
+	}
+
+	sprintf(buf, "RC6: %d%%", record->rc6);
+	cairo_move_to(ctx->cr, x, y);
+	cairo_show_text(ctx->cr, buf);
+	y += 14;
+
+	if (record->power_mW) {
+		sprintf(buf, "Power: %umW", record->power_mW);
+		cairo_move_to(ctx->cr, x, y);
+		cairo_show_text(ctx->cr, buf);
+		y += 14;
+	}
+
+	sprintf(buf, "Interrupts: %u", record->irqs);
+	cairo_move_to(ctx->cr, x, y);
+	cairo_show_text(ctx->cr, buf);
+	y += 14;
+
+	if (record->flips) {
+		sprintf(buf, "Flips: %u", record->flips);
+		cairo_move_to(ctx->cr, x, y);
+		cairo_show_text(ctx->cr, buf);
+		y += 14;
+	}
+
+	if (record->ctx_switches) {
+		sprintf(buf, "Contexts: %u", record->ctx_switches);
+		cairo_move_to(ctx->cr, x, y);
+		cairo_show_text(ctx->cr, buf);
+		y += 14;
+	}
+}
+
+static int remote_loop(struct overlay_context *ctx, const char *spec)
+{
+	struct overlay_remote remote;
+
+	if (remote_init(ctx, &remote, spec))
+		return ENXIO;
+
+	for (;;) {
+		struct sample_stream_record record;
+		cairo_text_extents_t extents;
+
+		if (read_all(remote.fd, &record, sizeof(record))) {
+			fprintf(stderr, "Connection to '%s' lost\n", spec);
+			close(remote.fd);
+			return ECONNRESET;
+		}
+
+		ctx->time = time(NULL);
+
+		ctx->cr = cairo_create(ctx->surface);
+		cairo_set_operator(ctx->cr, CAIRO_OPERATOR_CLEAR);
+		cairo_paint(ctx->cr);
+		cairo_set_operator(ctx->cr, CAIRO_OPERATOR_OVER);
+
+		show_remote(ctx, &remote, &record);
+
+		cairo_set_source_rgb(ctx->cr, .5, .5, .5);
+		cairo_set_font_size(ctx->cr, PAD-2);
+		cairo_text_extents(ctx->cr, remote.header.hostname, &extents);
+		cairo_move_to(ctx->cr,
+			      (ctx->width-extents.width)/2.,
+			      1+extents.height);
+		cairo_show_text(ctx->cr, remote.header.hostname);
+
+		cairo_destroy(ctx->cr);
+
+		overlay_show(ctx->surface);
+
+		if (take_snapshot) {
+			overlay_snapshot(ctx);
+			take_snapshot = 0;
+		}
+	}
+}
+
 static void usage(const char *progname)
 {
 	printf("intel-gpu-overlay -- realtime display of GPU statistics\n");
@@ -840,6 +1222,8 @@ static void usage(const char *progname)
 	printf("\t--geometry|-G <width>x<height>+<x-offset>+<y-offset>\tExact window placement and size\n");
 	printf("\t--position|-P (top|middle|bottom)-(left|centre|right)\tPlace the window in a particular corner\n");
 	printf("\t--size|-S <width>x<height> | <scale>%%\t\t\tWindow size\n");
+	printf("\t--remote|-r <host>:<port>\t\t\t\tRender the sample stream from a remote intel-gpu-sampler\n");
+	printf("\t--record|-o <filename>\t\t\t\t\tRecord samples to a bounded binary trace instead of rendering\n");
 	printf("\t--help|-h\t\t\t\t\t\tThis help message\n");
 }
 
@@ -850,6 +1234,8 @@ int main(int argc, char **argv)
 		{"geometry", 1, 0, 'G'},
 		{"position", 1, 0, 'P'},
 		{"size", 1, 0, 'S'},
+		{"remote", 1, 0, 'r'},
+		{"record", 1, 0, 'o'},
 		{"help", 0, 0, 'h'},
 		{NULL, 0, 0, 0,}
 	};
@@ -863,11 +1249,17 @@ int main(int argc, char **argv)
 	config_init(&config);
 
 	opterr = 0;
-	while ((i = getopt_long(argc, argv, "c:G:fhn?", long_options, &index)) != -1) {
+	while ((i = getopt_long(argc, argv, "c:G:r:o:fhn?", long_options, &index)) != -1) {
 		switch (i) {
 		case 'c':
 			config_parse_string(&config, optarg);
 			break;
+		case 'r':
+			config_set_value(&config, "network", "remote", optarg);
+			break;
+		case 'o':
+			config_set_value(&config, "trace", "file", optarg);
+			break;
 		case 'G':
 			config_set_value(&config, "window", "geometry", optarg);
 			break;
@@ -896,6 +1288,14 @@ int main(int argc, char **argv)
 		return 0;
 	}
 
+	{
+		const char *trace;
+
+		trace = config_get_value(&config, "trace", "file");
+		if (trace)
+			return record_loop(&config, trace, daemonize);
+	}
+
 	ctx.width = 640;
 	ctx.height = 236;
 	ctx.surface = NULL;
@@ -916,6 +1316,14 @@ int main(int argc, char **argv)
 
 	signal(SIGUSR1, signal_snapshot);
 
+	{
+		const char *remote;
+
+		remote = config_get_value(&config, "network", "remote");
+		if (remote)
+			return remote_loop(&ctx, remote);
+	}
+
 	debugfs_init();
 
 	init_gpu_top(&ctx, &ctx.gpu_top);
@@ -33,10 +33,9 @@
 
 #include "perf.h"
 #include "power.h"
+#include "rapl.h"
 #include "debugfs.h"
 
-/* XXX Is this exposed through RAPL? */
-
 static int perf_open(void)
 {
 	struct perf_event_attr attr;
@@ -59,6 +58,12 @@ int power_init(struct power *power)
 
 	memset(power, 0, sizeof(*power));
 
+	/* The RAPL planes tell us how the package budget splits between
+	 * the CPU cores and the GPU, and also stand in for the primary
+	 * reading on machines without the i915 energy counter.
+	 */
+	rapl_init(&power->rapl);
+
 	power->fd = perf_open();
 	if (power->fd != -1)
 		return 0;
@@ -66,19 +71,27 @@ int power_init(struct power *power)
 	sprintf(buf, "%s/i915_energy_uJ", debugfs_dri_path);
 	fd = open(buf, 0);
 	if (fd < 0)
-		return power->error = errno;
+		goto try_rapl;
 
 	len = read(fd, buf, sizeof(buf));
 	close(fd);
 
 	if (len < 0)
-		return power->error = errno;
+		goto try_rapl;
 
 	buf[len] = '\0';
 	if (strtoull(buf, 0, 0) == 0)
-		return power->error = EINVAL;
+		goto try_rapl;
 
 	return 0;
+
+try_rapl:
+	if (rapl_has_domain(&power->rapl, RAPL_GPU)) {
+		power->use_rapl_gpu = 1;
+		return 0;
+	}
+
+	return power->error = errno ?: EINVAL;
 }
 
 static uint64_t file_to_u64(const char *name)
@@ -121,6 +134,19 @@ int power_update(struct power *power)
 	if (power->error)
 		return power->error;
 
+	rapl_update(&power->rapl);
+
+	if (power->use_rapl_gpu) {
+		if (power->rapl.error)
+			return power->error = power->rapl.error;
+		if (!power->rapl.new_sample)
+			return EAGAIN;
+
+		power->power_mW = power->rapl.domain[RAPL_GPU].power_mW;
+		power->new_sample = 1;
+		return 0;
+	}
+
 	if (power->fd != -1) {
 		uint64_t data[2];
 		int len;
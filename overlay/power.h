@@ -27,13 +27,18 @@
 
 #include <stdint.h>
 
+#include "rapl.h"
+
 struct power {
 	struct power_stat {
 		uint64_t energy;
 		uint64_t timestamp;
 	} stat[2];
 
+	struct rapl rapl;
+
 	int fd;
+	int use_rapl_gpu;
 	int error;
 	int count;
 	int new_sample;
@@ -0,0 +1,234 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <errno.h>
+
+#include "perf.h"
+#include "rapl.h"
+
+/* RAPL splits the package energy counter into planes: pkg is the whole
+ * socket, cores (pp0) the CPU side, gpu (pp1) the uncore graphics.
+ * pkg - cores - gpu therefore isolates what the GPU costs beyond its
+ * own plane (LLC, memory controller). We prefer the perf "power" pmu,
+ * which scales the MSRs for us and timestamps each read; on kernels
+ * without it we fall back to the powercap energy_uj files.
+ */
+
+static const char *domain_names[RAPL_MAX] = {
+	[RAPL_PKG] = "pkg",
+	[RAPL_CORES] = "cores",
+	[RAPL_GPU] = "gpu",
+	[RAPL_RAM] = "ram",
+};
+
+const char *rapl_domain_name(enum rapl_domain d)
+{
+	return domain_names[d];
+}
+
+static int file_to_buf(const char *filename, char *buf, int size)
+{
+	int fd, len;
+
+	fd = open(filename, 0);
+	if (fd < 0)
+		return -1;
+
+	len = read(fd, buf, size - 1);
+	close(fd);
+
+	if (len < 0)
+		return -1;
+
+	buf[len] = '\0';
+	return len;
+}
+
+static uint64_t rapl_type_id(void)
+{
+	char buf[1024];
+
+	if (file_to_buf("/sys/bus/event_source/devices/power/type",
+			buf, sizeof(buf)) < 0)
+		return 0;
+
+	return strtoull(buf, 0, 0);
+}
+
+static int perf_open(uint64_t type, enum rapl_domain d, double *scale)
+{
+	struct perf_event_attr attr;
+	char buf[1024];
+	char *s;
+
+	sprintf(buf, "/sys/bus/event_source/devices/power/events/energy-%s",
+		d == RAPL_PKG ? "pkg" : domain_names[d]);
+	if (file_to_buf(buf, buf, sizeof(buf)) < 0)
+		return -1;
+
+	s = strstr(buf, "event=");
+	if (s == NULL)
+		return -1;
+
+	memset(&attr, 0, sizeof (attr));
+	attr.type = type;
+	attr.config = strtoull(s + sizeof("event=") - 1, 0, 0);
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED;
+
+	sprintf(buf, "/sys/bus/event_source/devices/power/events/energy-%s.scale",
+		d == RAPL_PKG ? "pkg" : domain_names[d]);
+	if (file_to_buf(buf, buf, sizeof(buf)) < 0)
+		return -1;
+	*scale = strtod(buf, 0);
+
+	/* The RAPL counters are per-socket, not per-task */
+	return perf_event_open(&attr, -1, 0, -1, 0);
+}
+
+static int powercap_open(enum rapl_domain d, double *scale)
+{
+	const char *name;
+	char buf[1024];
+	int n;
+
+	switch (d) {
+	case RAPL_CORES: name = "core"; break;
+	case RAPL_GPU: name = "uncore"; break;
+	case RAPL_RAM: name = "dram"; break;
+	default: name = NULL; break;
+	}
+
+	if (name == NULL) {
+		sprintf(buf, "/sys/class/powercap/intel-rapl:0/energy_uj");
+	} else {
+		for (n = 0; ; n++) {
+			sprintf(buf, "/sys/class/powercap/intel-rapl:0:%d/name", n);
+			if (file_to_buf(buf, buf, sizeof(buf)) < 0)
+				return -1;
+			if (strncmp(buf, name, strlen(name)) == 0)
+				break;
+		}
+		sprintf(buf, "/sys/class/powercap/intel-rapl:0:%d/energy_uj", n);
+	}
+
+	*scale = 1e-6; /* energy_uj is pre-scaled to microJoules */
+	return open(buf, 0);
+}
+
+int rapl_init(struct rapl *rapl)
+{
+	uint64_t type;
+	int d, num_domains;
+
+	memset(rapl, 0, sizeof(*rapl));
+
+	type = rapl_type_id();
+	rapl->use_perf = type != 0;
+
+	num_domains = 0;
+	for (d = 0; d < RAPL_MAX; d++) {
+		struct rapl_energy *e = &rapl->domain[d];
+
+		if (rapl->use_perf)
+			e->fd = perf_open(type, d, &e->scale);
+		else
+			e->fd = powercap_open(d, &e->scale);
+		num_domains += e->fd != -1;
+	}
+
+	if (num_domains == 0)
+		return rapl->error = ENOENT;
+
+	return 0;
+}
+
+static uint64_t clock_ms_to_u64(void)
+{
+	struct timespec tv;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &tv) < 0)
+		return 0;
+
+	return (uint64_t)tv.tv_sec * 1000 + tv.tv_nsec / 1000000;
+}
+
+int rapl_update(struct rapl *rapl)
+{
+	int d;
+
+	if (rapl->error)
+		return rapl->error;
+
+	for (d = 0; d < RAPL_MAX; d++) {
+		struct rapl_energy *e = &rapl->domain[d];
+		struct rapl_stat *s = &e->stat[rapl->count&1];
+		struct rapl_stat *o = &e->stat[(rapl->count+1)&1];
+		uint64_t d_time;
+
+		if (e->fd == -1)
+			continue;
+
+		if (rapl->use_perf) {
+			uint64_t data[2];
+
+			if (read(e->fd, data, sizeof(data)) < 0)
+				return rapl->error = errno;
+
+			s->energy = data[0];
+			s->timestamp = data[1] / (1000*1000);
+		} else {
+			char buf[64];
+			int len;
+
+			len = pread(e->fd, buf, sizeof(buf)-1, 0);
+			if (len < 0)
+				return rapl->error = errno;
+
+			buf[len] = '\0';
+			s->energy = strtoull(buf, 0, 0);
+			s->timestamp = clock_ms_to_u64();
+		}
+
+		if (rapl->count == 0)
+			continue;
+
+		d_time = s->timestamp - o->timestamp;
+		if (d_time)
+			e->power_mW = (s->energy - o->energy) * e->scale
+				* 1e6 / d_time;
+	}
+
+	if (rapl->count++ == 0)
+		return EAGAIN;
+
+	rapl->new_sample = 1;
+	return 0;
+}
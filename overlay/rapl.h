@@ -0,0 +1,66 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#ifndef RAPL_H
+#define RAPL_H
+
+#include <stdint.h>
+
+enum rapl_domain {
+	RAPL_PKG = 0,
+	RAPL_CORES,
+	RAPL_GPU,	/* the uncore graphics plane */
+	RAPL_RAM,
+	RAPL_MAX
+};
+
+struct rapl {
+	struct rapl_energy {
+		int fd;
+		double scale;	/* Joules per counter increment */
+		struct rapl_stat {
+			uint64_t energy;	/* raw counter */
+			uint64_t timestamp;	/* ms */
+		} stat[2];
+
+		uint64_t power_mW;
+	} domain[RAPL_MAX];
+
+	int use_perf;
+	int error;
+	int count;
+	int new_sample;
+};
+
+const char *rapl_domain_name(enum rapl_domain d);
+
+int rapl_init(struct rapl *rapl);
+int rapl_update(struct rapl *rapl);
+
+static inline int rapl_has_domain(const struct rapl *rapl, enum rapl_domain d)
+{
+	return rapl->error == 0 && rapl->domain[d].fd != -1;
+}
+
+#endif /* RAPL_H */
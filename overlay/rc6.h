@@ -50,4 +50,28 @@ struct rc6 {
 int rc6_init(struct rc6 *rc6);
 int rc6_update(struct rc6 *rc6);
 
+#define RC6_WINDOW_MAX_EXIT_BUCKETS 16
+
+struct rc6_window {
+	struct rc6 rc6;
+
+	uint64_t interval_ms;
+
+	/* ring of per-window combined residency, in percent */
+	uint8_t *samples;
+	int num_samples;
+	uint64_t head;
+
+	/* distribution of contiguous out-of-rc6 spells, log2(ms) buckets */
+	uint64_t exits[RC6_WINDOW_MAX_EXIT_BUCKETS];
+	uint64_t num_exits;
+	uint64_t exit_ms; /* the spell currently open, if any */
+};
+
+int rc6_window_init(struct rc6_window *rw,
+		    uint64_t interval_ms, int num_samples);
+int rc6_window_sample(struct rc6_window *rw);
+uint8_t rc6_window_residency(const struct rc6_window *rw, uint64_t n);
+void rc6_window_fini(struct rc6_window *rw);
+
 #endif /* RC6_H */
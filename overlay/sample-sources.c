@@ -0,0 +1,113 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "sample-sources.h"
+
+void sample_sources_init(struct sample_sources *ss)
+{
+	memset(ss, 0, sizeof(*ss));
+
+	cpu_top_init(&ss->cpu_top);
+	gpu_top_init(&ss->gpu_top);
+	gpu_perf_init(&ss->gpu_perf, 0);
+	gpu_freq_init(&ss->gpu_freq);
+	power_init(&ss->power);
+	rc6_init(&ss->rc6);
+	gem_interrupts_init(&ss->irqs);
+}
+
+void sample_sources_header(struct sample_sources *ss, int period,
+			   struct sample_stream_header *header)
+{
+	int n;
+
+	memset(header, 0, sizeof(*header));
+	header->magic = SAMPLE_STREAM_MAGIC;
+	header->version = SAMPLE_STREAM_VERSION;
+	header->sample_period_us = period;
+	header->num_rings = ss->gpu_top.num_rings;
+	gethostname(header->hostname, sizeof(header->hostname)-1);
+	for (n = 0; n < ss->gpu_top.num_rings; n++)
+		strncpy(header->ring_names[n], ss->gpu_top.ring[n].name,
+			sizeof(header->ring_names[n])-1);
+}
+
+void sample_sources_record(struct sample_sources *ss,
+			   struct sample_stream_record *record)
+{
+	struct timespec ts;
+	uint32_t sum;
+	int n;
+
+	memset(record, 0, sizeof(*record));
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	record->timestamp_ns = ts.tv_sec * (uint64_t)1000000000 + ts.tv_nsec;
+
+	gpu_top_update(&ss->gpu_top);
+	for (n = 0; n < ss->gpu_top.num_rings; n++) {
+		record->busy[n] = ss->gpu_top.ring[n].u.u.busy;
+		record->wait[n] = ss->gpu_top.ring[n].u.u.wait;
+		record->sema[n] = ss->gpu_top.ring[n].u.u.sema;
+	}
+
+	if (cpu_top_update(&ss->cpu_top) == 0)
+		record->cpu_busy = ss->cpu_top.busy;
+
+	if (gpu_freq_update(&ss->gpu_freq) == 0) {
+		record->freq_current = ss->gpu_freq.current;
+		record->freq_request = ss->gpu_freq.request;
+	}
+
+	if (rc6_update(&ss->rc6) == 0)
+		record->rc6 = ss->rc6.rc6_combined;
+
+	if (power_update(&ss->power) == 0)
+		record->power_mW = ss->power.power_mW;
+
+	if (gem_interrupts_update(&ss->irqs) == 0)
+		record->irqs = ss->irqs.delta;
+
+	/* Per-process tracepoint data is variable length; stream only the
+	 * aggregate counts and leave the per-client breakdown to the
+	 * local tools.
+	 */
+	gpu_perf_update(&ss->gpu_perf);
+	sum = 0;
+	for (n = 0; n < MAX_RINGS; n++)
+		sum += ss->gpu_perf.flip_complete[n];
+	memset(ss->gpu_perf.flip_complete, 0, sizeof(ss->gpu_perf.flip_complete));
+	record->flips = sum;
+
+	sum = 0;
+	for (n = 0; n < MAX_RINGS; n++)
+		sum += ss->gpu_perf.ctx_switch[n];
+	memset(ss->gpu_perf.ctx_switch, 0, sizeof(ss->gpu_perf.ctx_switch));
+	record->ctx_switches = sum;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#ifndef SAMPLE_SOURCES_H
+#define SAMPLE_SOURCES_H
+
+#include "cpu-top.h"
+#include "gem-interrupts.h"
+#include "gpu-freq.h"
+#include "gpu-top.h"
+#include "gpu-perf.h"
+#include "power.h"
+#include "rc6.h"
+#include "sample-stream.h"
+
+/* The full set of overlay samplers, driven as one unit and emitting the
+ * flat sample-stream records; shared between the TCP sampler and the
+ * headless trace recorder. The caller is expected to have run
+ * debugfs_init() first.
+ */
+
+struct sample_sources {
+	struct gpu_top gpu_top;
+	struct gpu_perf gpu_perf;
+	struct gpu_freq gpu_freq;
+	struct power power;
+	struct rc6 rc6;
+	struct gem_interrupts irqs;
+	struct cpu_top cpu_top;
+};
+
+void sample_sources_init(struct sample_sources *ss);
+void sample_sources_header(struct sample_sources *ss, int period,
+			   struct sample_stream_header *header);
+void sample_sources_record(struct sample_sources *ss,
+			   struct sample_stream_record *record);
+
+#endif /* SAMPLE_SOURCES_H */
@@ -0,0 +1,89 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#ifndef SAMPLE_STREAM_H
+#define SAMPLE_STREAM_H
+
+#include <stdint.h>
+
+/* Wire format spoken between intel-gpu-sampler (running on the DUT) and
+ * the receiving renderer (intel-gpu-overlay --remote). One fixed-size
+ * header on connect, then one fixed-size record per sample interval;
+ * everything is little-endian as both ends are x86. The record is kept
+ * under 100 bytes so that streaming at the default 2Hz costs the target
+ * nothing measurable.
+ */
+
+#define SAMPLE_STREAM_MAGIC 0x49474f53 /* "SOGI" */
+#define SAMPLE_STREAM_VERSION 1
+
+#define SAMPLE_STREAM_MAX_RINGS 16
+
+struct sample_stream_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t sample_period_us;
+	uint32_t num_rings;
+	char hostname[64];
+	char ring_names[SAMPLE_STREAM_MAX_RINGS][8];
+} __attribute__((packed));
+
+struct sample_stream_record {
+	uint64_t timestamp_ns;
+
+	uint8_t busy[SAMPLE_STREAM_MAX_RINGS];
+	uint8_t wait[SAMPLE_STREAM_MAX_RINGS];
+	uint8_t sema[SAMPLE_STREAM_MAX_RINGS];
+
+	uint8_t cpu_busy;
+	uint8_t rc6;
+	uint16_t freq_current;
+	uint16_t freq_request;
+	uint16_t pad;
+
+	uint32_t power_mW;
+	uint32_t irqs;
+	uint32_t flips;
+	uint32_t ctx_switches;
+} __attribute__((packed));
+
+/* On-disk trace: the same records, appended into an mmapped ring of
+ * bounded size so a recorder can run for days. head counts records
+ * ever written and is updated after the record itself, so a trace cut
+ * short by a crash is still valid up to the last complete sample.
+ */
+
+#define SAMPLE_TRACE_MAGIC 0x49474f54 /* "TOGI" */
+#define SAMPLE_TRACE_VERSION 1
+
+struct sample_trace_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t record_size;
+	uint32_t capacity; /* ring size, in records */
+	uint64_t head;
+	struct sample_stream_header stream;
+} __attribute__((packed));
+
+#endif /* SAMPLE_STREAM_H */
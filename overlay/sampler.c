@@ -0,0 +1,175 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+/*
+ * intel-gpu-sampler - the sampling half of intel-gpu-overlay, headless
+ *
+ * Runs the overlay's samplers (gpu-top, gpu-perf, gpu-freq, power, rc6,
+ * gem-interrupts, cpu-top) on a DUT with no display attached and
+ * streams one compact binary record per interval over TCP, so the
+ * charts can be drawn on a workstation elsewhere (intel-gpu-overlay
+ * --remote host:port). No cairo, no window system: the per-sample cost
+ * on the target is the sampler reads plus one small write per
+ * connected viewer.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "debugfs.h"
+#include "sample-sources.h"
+#include "sample-stream.h"
+
+#define DEFAULT_PORT 8736
+#define DEFAULT_PERIOD 500000
+
+#define MAX_CLIENTS 16
+
+static int listen_on(int port)
+{
+	struct sockaddr_in addr;
+	int fd, one = 1;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = INADDR_ANY;
+	addr.sin_port = htons(port);
+
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	    listen(fd, 4) < 0) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static void usage(const char *progname)
+{
+	printf("intel-gpu-sampler -- stream GPU statistics over TCP\n");
+	printf("Usage: %s [options]\n", progname);
+	printf("\t-p <port>\tport to listen on (default %d)\n", DEFAULT_PORT);
+	printf("\t-t <period>\tsample period in microseconds (default %d)\n",
+	       DEFAULT_PERIOD);
+	printf("\t-f\t\tstay in foreground\n");
+	printf("\t-h\t\tthis help message\n");
+}
+
+int main(int argc, char **argv)
+{
+	struct sample_stream_header header;
+	struct sample_sources sources;
+	int client[MAX_CLIENTS];
+	int nr_clients = 0;
+	int port = DEFAULT_PORT;
+	int period = DEFAULT_PERIOD;
+	int daemonize = 1;
+	int fd, i;
+
+	while ((i = getopt(argc, argv, "p:t:fh")) != -1) {
+		switch (i) {
+		case 'p':
+			port = atoi(optarg);
+			break;
+		case 't':
+			period = atoi(optarg);
+			if (period < 1000) {
+				fprintf(stderr, "sample period must be at least 1000us\n");
+				return EINVAL;
+			}
+			break;
+		case 'f':
+			daemonize = 0;
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		}
+	}
+
+	fd = listen_on(port);
+	if (fd < 0) {
+		fprintf(stderr, "Unable to listen on port %d: %s\n",
+			port, strerror(errno));
+		return ENXIO;
+	}
+
+	if (daemonize && daemon(0, 0))
+		return EINVAL;
+
+	signal(SIGPIPE, SIG_IGN);
+
+	debugfs_init();
+
+	sample_sources_init(&sources);
+	sample_sources_header(&sources, period, &header);
+
+	for (;;) {
+		struct sample_stream_record record;
+		struct pollfd pfd = { .fd = fd, .events = POLLIN };
+
+		if (poll(&pfd, 1, period / 1000) > 0) {
+			int new_fd = accept(fd, NULL, NULL);
+
+			if (new_fd >= 0 && nr_clients < MAX_CLIENTS &&
+			    write(new_fd, &header, sizeof(header)) == sizeof(header)) {
+				int one = 1;
+				setsockopt(new_fd, IPPROTO_TCP, TCP_NODELAY,
+					   &one, sizeof(one));
+				client[nr_clients++] = new_fd;
+			} else if (new_fd >= 0)
+				close(new_fd);
+		}
+
+		sample_sources_record(&sources, &record);
+
+		for (i = 0; i < nr_clients; ) {
+			if (write(client[i], &record, sizeof(record)) != sizeof(record)) {
+				close(client[i]);
+				client[i] = client[--nr_clients];
+			} else
+				i++;
+		}
+	}
+
+	return 0;
+}
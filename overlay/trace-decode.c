@@ -0,0 +1,110 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+/*
+ * intel-gpu-trace-decode - convert a recorded sample trace to CSV
+ *
+ * Reads the mmap-appended binary ring written by intel-gpu-overlay
+ * --record and prints the retained samples in chronological order, one
+ * CSV row per sample, oldest first. Works on truncated traces: anything
+ * up to the last complete record is decoded.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "sample-stream.h"
+
+int main(int argc, char **argv)
+{
+	const struct sample_trace_header *th;
+	const struct sample_stream_record *records;
+	struct stat st;
+	uint64_t start, i;
+	uint32_t n;
+	int fd;
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <trace>\n", argv[0]);
+		return EINVAL;
+	}
+
+	fd = open(argv[1], O_RDONLY);
+	if (fd < 0 || fstat(fd, &st)) {
+		fprintf(stderr, "Unable to open trace '%s': %s\n",
+			argv[1], strerror(errno));
+		return errno;
+	}
+
+	th = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (th == MAP_FAILED)
+		return ENOMEM;
+
+	if (st.st_size < sizeof(*th) ||
+	    th->magic != SAMPLE_TRACE_MAGIC ||
+	    th->version != SAMPLE_TRACE_VERSION ||
+	    th->record_size != sizeof(*records) ||
+	    th->stream.num_rings > SAMPLE_STREAM_MAX_RINGS) {
+		fprintf(stderr, "'%s' is not a sample trace\n", argv[1]);
+		return EINVAL;
+	}
+
+	records = (const struct sample_stream_record *)(th + 1);
+
+	printf("# host: %s, sample period: %uus\n",
+	       th->stream.hostname, th->stream.sample_period_us);
+
+	printf("timestamp-ns,cpu-busy");
+	for (n = 0; n < th->stream.num_rings; n++)
+		printf(",%s-busy,%s-wait,%s-sema",
+		       th->stream.ring_names[n],
+		       th->stream.ring_names[n],
+		       th->stream.ring_names[n]);
+	printf(",freq-mhz,freq-req-mhz,rc6,power-mW,irqs,flips,ctx-switches\n");
+
+	start = th->head > th->capacity ? th->head - th->capacity : 0;
+	for (i = start; i < th->head; i++) {
+		const struct sample_stream_record *r =
+			&records[i % th->capacity];
+
+		printf("%" PRIu64 ",%u", r->timestamp_ns, r->cpu_busy);
+		for (n = 0; n < th->stream.num_rings; n++)
+			printf(",%u,%u,%u",
+			       r->busy[n], r->wait[n], r->sema[n]);
+		printf(",%u,%u,%u,%u,%u,%u,%u\n",
+		       r->freq_current, r->freq_request, r->rc6,
+		       r->power_mW, r->irqs, r->flips, r->ctx_switches);
+	}
+
+	return 0;
+}
@@ -41,6 +41,9 @@ struct x11_window {
 	Window win;
 	int width, height;
 	int visible;
+
+	unsigned char *shadow;
+	int stride;
 };
 
 static inline struct x11_window *to_x11_window(struct overlay *o)
@@ -53,13 +56,67 @@ static int noop(Display *dpy, XErrorEvent *event)
 	return 0;
 }
 
+/*
+ * Most sample ticks only advance a couple of charts by a pixel or two, so
+ * pushing the whole surface through cairo and the X transport every tick
+ * is mostly wasted work. When the back surface is an image surface we keep
+ * a shadow copy of the last presented frame and narrow each repaint to the
+ * band of scanlines that actually changed, skipping the frame entirely
+ * when nothing did.
+ */
+static int x11_window_damage(struct x11_window *priv, int *y0, int *y1)
+{
+	unsigned char *data;
+	int top = -1, bottom = -1, y;
+
+	cairo_surface_flush(priv->base.surface);
+	data = cairo_image_surface_get_data(priv->base.surface);
+
+	for (y = 0; y < priv->height; y++) {
+		if (memcmp(data + y * priv->stride,
+			   priv->shadow + y * priv->stride, priv->stride)) {
+			top = y;
+			break;
+		}
+	}
+	if (top == -1)
+		return 0;
+
+	for (y = priv->height - 1; y > top; y--) {
+		if (memcmp(data + y * priv->stride,
+			   priv->shadow + y * priv->stride, priv->stride)) {
+			bottom = y;
+			break;
+		}
+	}
+	if (bottom == -1)
+		bottom = top;
+
+	memcpy(priv->shadow + top * priv->stride,
+	       data + top * priv->stride,
+	       (bottom - top + 1) * priv->stride);
+
+	*y0 = top;
+	*y1 = bottom + 1;
+	return 1;
+}
+
 static void x11_window_show(struct overlay *overlay)
 {
 	struct x11_window *priv = to_x11_window(overlay);
+	int y0 = 0, y1 = priv->height;
 	cairo_t *cr;
 
+	if (priv->shadow && !x11_window_damage(priv, &y0, &y1) &&
+	    priv->visible)
+		return;
+
 	cr = cairo_create(priv->front);
 	cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+	if (priv->shadow) {
+		cairo_rectangle(cr, 0, y0, priv->width, y1 - y0);
+		cairo_clip(cr);
+	}
 	cairo_set_source_surface(cr, priv->base.surface, 0, 0);
 	cairo_paint(cr);
 	cairo_destroy(cr);
@@ -90,6 +147,7 @@ static void x11_window_destroy(void *data)
 	cairo_surface_destroy(priv->front);
 	XDestroyWindow(priv->dpy, priv->win);
 	XCloseDisplay(priv->dpy);
+	free(priv->shadow);
 	free(priv);
 }
 
@@ -152,6 +210,17 @@ x11_window_create(struct config *config, int *width, int *height)
 	priv->base.show = x11_window_show;
 	priv->base.hide = x11_window_hide;
 
+	/* Damage tracking needs CPU access to the pixels, so it is only
+	 * available with the image surface ("prefer-image") backing. */
+	priv->shadow = NULL;
+	priv->stride = 0;
+	if (cairo_surface_get_type(priv->base.surface) ==
+	    CAIRO_SURFACE_TYPE_IMAGE) {
+		priv->stride =
+			cairo_image_surface_get_stride(priv->base.surface);
+		priv->shadow = calloc(h, priv->stride);
+	}
+
 	priv->dpy = dpy;
 	priv->win = win;
 	priv->front = surface;
@@ -195,6 +195,34 @@ static void test_error_state_capture(unsigned ring_id,
 	munmap(batch, 4096);
 }
 
+/* Queue hangs on every engine before waiting on any of them, so the
+ * detection periods overlap and the total recovery time stays in the
+ * region of a single hangcheck cycle however many engines are hung.
+ */
+static void hangcheck_overlap(void)
+{
+	igt_hang_queue_t q;
+	unsigned int resets;
+	unsigned int engine;
+	int queued = 0;
+
+	igt_require_hang_ring(device, 0);
+
+	igt_hang_queue_init(&q, device);
+	for_each_engine(device, engine) {
+		if (engine == 0)
+			continue;
+
+		igt_hang_queue_add(&q, device, engine);
+		queued++;
+	}
+	resets = igt_hang_queue_wait(&q, device);
+
+	igt_info("%d hangs queued back-to-back, recovered with %u reset(s)\n",
+		 queued, resets);
+	igt_assert(resets >= 1);
+}
+
 /* This test covers the case where we end up in an uninitialised area of the
  * ppgtt and keep executing through it. This is particularly relevant if 48b
  * ppgtt is enabled because the ppgtt is massively bigger compared to the 32b
@@ -259,6 +287,9 @@ igt_main
 						 e->full_name);
 	}
 
+	igt_subtest("hangcheck-overlap")
+		hangcheck_overlap();
+
 	igt_subtest("hangcheck-unterminated")
 		hangcheck_unterminated();
 }
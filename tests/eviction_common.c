@@ -322,3 +322,107 @@ static int forking_evictions(int fd, struct igt_eviction_test_ops *ops,
 
 	return 0;
 }
+
+static int parallel_evictions(int fd, struct igt_eviction_test_ops *ops,
+			      uint64_t surface_size)
+{
+	const int num_clients = min(sysconf(_SC_NPROCESSORS_ONLN), 8);
+	const int num_passes = 100;
+	struct client_result {
+		double mean_us;
+		double max_us;
+	} *results;
+	uint64_t working_surfaces, avail;
+	double fastest, slowest;
+	int i;
+
+	/* The forking modes share one set of buffers between the children,
+	 * so they mostly serialise on the same objects. Here each client
+	 * works against its own fd and its own surfaces, and the only
+	 * interaction between them is the kernel's eviction path: together
+	 * the working sets oversubscribe the aperture by half, so every
+	 * client is constantly forcing the others' surfaces out.
+	 */
+	working_surfaces =
+		3 * gem_aperture_size(fd) / 2 / num_clients / surface_size;
+
+	/* Stay within available RAM so we measure eviction, not swapping. */
+	avail = (intel_get_avail_ram_mb() << 20) / 2 / num_clients;
+	if (working_surfaces > avail / surface_size)
+		working_surfaces = avail / surface_size;
+
+	igt_require(working_surfaces > 2);
+	intel_require_memory(num_clients * working_surfaces, surface_size,
+			     CHECK_RAM);
+
+	results = mmap(NULL, 4096, PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
+	igt_assert(results != MAP_FAILED);
+
+	igt_fork(child, num_clients) {
+		int realfd = drm_open_driver(DRIVER_INTEL);
+		igt_stats_t stats;
+		double max_us = 0;
+		uint32_t *bo;
+		uint64_t n;
+		int pass;
+
+		bo = malloc(working_surfaces*sizeof(*bo));
+		igt_assert(bo);
+
+		for (n = 0; n < working_surfaces; n++)
+			bo[n] = ops->create(realfd, surface_size);
+
+		igt_stats_init_with_size(&stats, num_passes);
+
+		for (pass = 0; pass < num_passes; pass++) {
+			struct timespec start = {};
+			double elapsed_us;
+			int ret;
+
+			igt_permute_array(bo, working_surfaces,
+					  exchange_uint32_t);
+
+			/* The eviction work happens while binding the
+			 * execbuffer, so the ioctl duration is the latency
+			 * this client paid for its slice of the aperture.
+			 */
+			igt_nsec_elapsed(&start);
+			ret = ops->copy(realfd, bo[0], bo[1], bo,
+					working_surfaces);
+			elapsed_us = igt_nsec_elapsed(&start) / 1000.;
+			igt_assert_eq(ret, 0);
+
+			igt_stats_push_float(&stats, elapsed_us);
+			if (elapsed_us > max_us)
+				max_us = elapsed_us;
+		}
+
+		results[child].mean_us = igt_stats_get_mean(&stats);
+		results[child].max_us = max_us;
+
+		igt_stats_fini(&stats);
+
+		for (n = 0; n < working_surfaces; n++)
+			ops->close(realfd, bo[n]);
+		free(bo);
+		close(realfd);
+	}
+
+	igt_waitchildren();
+
+	fastest = slowest = results[0].mean_us;
+	for (i = 0; i < num_clients; i++) {
+		igt_info("client %d: mean %.2fus, max %.2fus per pass\n",
+			 i, results[i].mean_us, results[i].max_us);
+		if (results[i].mean_us < fastest)
+			fastest = results[i].mean_us;
+		if (results[i].mean_us > slowest)
+			slowest = results[i].mean_us;
+	}
+	igt_info("eviction fairness (slowest/fastest mean): %.2f\n",
+		 slowest / fastest);
+
+	munmap(results, 4096);
+
+	return 0;
+}
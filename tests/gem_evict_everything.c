@@ -162,6 +162,11 @@ static void test_swapping_evictions(int fd, uint64_t size, uint64_t count)
 	swapping_evictions(fd, &fault_ops, size, count, trash_count);
 }
 
+static void test_parallel_evictions(int fd, uint64_t size)
+{
+	parallel_evictions(fd, &fault_ops, size);
+}
+
 static void test_minor_evictions(int fd, uint64_t size, uint64_t count)
 {
 	minor_evictions(fd, &fault_ops, size, count);
@@ -206,6 +211,9 @@ igt_main
 	igt_subtest("swapping-normal")
 		test_swapping_evictions(fd, size, count);
 
+	igt_subtest("parallel")
+		test_parallel_evictions(fd, size);
+
 	igt_subtest("minor-normal")
 		test_minor_evictions(fd, size, count);
 
@@ -39,6 +39,7 @@
 
 #include "drm.h"
 
+#include "igt_gpu_clock.h"
 #include "igt_sysfs.h"
 #include "igt_vgem.h"
 
@@ -131,7 +132,6 @@ static unsigned int measure_ring_size(int fd)
 	return count;
 }
 
-#define RCS_TIMESTAMP (0x2000 + 0x358)
 static void latency_on_ring(int fd,
 			    unsigned ring, const char *name,
 			    unsigned flags)
@@ -142,14 +142,15 @@ static void latency_on_ring(int fd,
 	struct drm_i915_gem_relocation_entry reloc;
 	struct drm_i915_gem_execbuffer2 execbuf;
 	struct cork c;
-	volatile uint32_t *reg;
+	igt_gpu_clock_t clock;
 	unsigned repeats = ring_size;
-	uint32_t start, end, *map, *results;
+	uint32_t *map, *results;
+	uint64_t start, end, submit_ns, exec_start_ns;
 	uint64_t offset;
 	double gpu_latency;
 	int i, j;
 
-	reg = (volatile uint32_t *)((volatile char *)igt_global_mmio + RCS_TIMESTAMP);
+	igt_gpu_clock_init(&clock, RCS_TIMESTAMP);
 
 	memset(&execbuf, 0, sizeof(execbuf));
 	execbuf.buffers_ptr = to_user_pointer(&obj[1]);
@@ -211,7 +212,8 @@ static void latency_on_ring(int fd,
 		execbuf.buffer_count = 3;
 	}
 
-	start = *reg;
+	submit_ns = igt_gpu_clock_cpu_now_ns();
+	start = igt_gpu_clock_read(&clock);
 	for (j = 0; j < repeats; j++) {
 		uint64_t presumed_offset = reloc.presumed_offset;
 
@@ -223,7 +225,7 @@ static void latency_on_ring(int fd,
 		gem_execbuf(fd, &execbuf);
 		igt_assert(reloc.presumed_offset == presumed_offset);
 	}
-	end = *reg;
+	end = igt_gpu_clock_read(&clock);
 	igt_assert(reloc.presumed_offset == obj[1].offset);
 
 	if (flags & CORK)
@@ -232,6 +234,17 @@ static void latency_on_ring(int fd,
 	gem_set_domain(fd, obj[1].handle, I915_GEM_DOMAIN_GTT, 0);
 	gpu_latency = (results[repeats-1] - results[0]) / (double)(repeats-1);
 
+	/* Re-sync to pick up the drift over the run, then place the first
+	 * batch's timestamp on the CPU timeline: the gap to the submission
+	 * time is how long that batch sat in the queue.
+	 */
+	igt_gpu_clock_sync(&clock);
+	exec_start_ns = igt_gpu_clock_to_cpu_ns(&clock,
+						igt_gpu_clock_extend(&clock,
+								     results[0]));
+	igt_debug("%s: GPU/CPU clock drift: %.2fppm\n",
+		  name, igt_gpu_clock_drift_ppm(&clock));
+
 	gem_set_domain(fd, obj[2].handle,
 		       I915_GEM_DOMAIN_GTT, I915_GEM_DOMAIN_GTT);
 
@@ -261,10 +274,11 @@ static void latency_on_ring(int fd,
 	igt_assert(offset == obj[2].offset);
 
 	gem_set_domain(fd, obj[1].handle, I915_GEM_DOMAIN_GTT, 0);
-	igt_info("%s: dispatch latency: %.2f, execution latency: %.2f (target %.2f)\n",
+	igt_info("%s: dispatch latency: %.2f, execution latency: %.2f (target %.2f), queue time: %.2fus\n",
 		 name,
 		 (end - start) / (double)repeats,
-		 gpu_latency, (results[repeats - 1] - results[0]) / (double)(repeats - 1));
+		 gpu_latency, (results[repeats - 1] - results[0]) / (double)(repeats - 1),
+		 (exec_start_ns - submit_ns) / 1000.);
 
 	munmap(map, 64*1024);
 	munmap(results, 4096);
@@ -25,9 +25,11 @@
 
 #include "igt.h"
 #include "igt_vgem.h"
+#include "sw_sync.h"
 
 #define LOCAL_PARAM_HAS_SCHEDULER 41
 #define LOCAL_CONTEXT_PARAM_PRIORITY 6
+#define LOCAL_EXEC_FENCE_OUT (1 << 17)
 
 #define LO 0
 #define HI 1
@@ -500,6 +502,149 @@ static void wide(int fd, unsigned ring)
 #undef XS
 }
 
+struct spinner {
+	uint32_t handle;
+	uint32_t *batch;
+};
+
+static struct spinner spin_ctx(int fd, uint32_t ctx, unsigned ring)
+{
+	const int gen = intel_gen(intel_get_drm_devid(fd));
+	struct drm_i915_gem_exec_object2 obj;
+	struct drm_i915_gem_relocation_entry reloc;
+	struct drm_i915_gem_execbuffer2 execbuf;
+	struct spinner spin;
+	uint32_t *batch;
+	int i;
+
+	/* A single unbounded batch on one ring for one context; unlike
+	 * make_busy() we keep the handle so the caller can wait for the
+	 * spinner to retire after ending it.
+	 */
+	memset(&obj, 0, sizeof(obj));
+	obj.handle = gem_create(fd, 4096);
+	batch = gem_mmap__wc(fd, obj.handle, 0, 4096, PROT_WRITE);
+	gem_set_domain(fd, obj.handle,
+			I915_GEM_DOMAIN_GTT, I915_GEM_DOMAIN_GTT);
+
+	obj.relocs_ptr = to_user_pointer(&reloc);
+	obj.relocation_count = 1;
+	memset(&reloc, 0, sizeof(reloc));
+
+	reloc.target_handle = obj.handle; /* recurse */
+	reloc.presumed_offset = 0;
+	reloc.offset = sizeof(uint32_t);
+	reloc.delta = 0;
+	reloc.read_domains = I915_GEM_DOMAIN_COMMAND;
+	reloc.write_domain = 0;
+
+	i = 0;
+	batch[i] = MI_BATCH_BUFFER_START;
+	if (gen >= 8) {
+		batch[i] |= 1 << 8 | 1;
+		batch[++i] = 0;
+		batch[++i] = 0;
+	} else if (gen >= 6) {
+		batch[i] |= 1 << 8;
+		batch[++i] = 0;
+	} else {
+		batch[i] |= 2 << 6;
+		batch[++i] = 0;
+		if (gen < 4) {
+			batch[i] |= 1;
+			reloc.delta = 1;
+		}
+	}
+	i++;
+
+	memset(&execbuf, 0, sizeof(execbuf));
+	execbuf.buffers_ptr = to_user_pointer(&obj);
+	execbuf.buffer_count = 1;
+	execbuf.flags = ring;
+	execbuf.rsvd1 = ctx;
+	gem_execbuf(fd, &execbuf);
+
+	spin.handle = obj.handle;
+	spin.batch = batch;
+	return spin;
+}
+
+static void spin_end(int fd, struct spinner *spin)
+{
+	*spin->batch = MI_BATCH_BUFFER_END;
+	gem_sync(fd, spin->handle);
+	munmap(spin->batch, 4096);
+	gem_close(fd, spin->handle);
+}
+
+static void preempt_latency(int fd, unsigned ring, const char *name)
+{
+	const uint32_t bbe = MI_BATCH_BUFFER_END;
+	const int samples = 100;
+	struct drm_i915_gem_exec_object2 obj;
+	struct drm_i915_gem_execbuffer2 execbuf;
+	igt_stats_t stats;
+	uint32_t ctx[2];
+	bool preempted = true;
+
+	ctx[LO] = gem_context_create(fd);
+	ctx_set_priority(fd, ctx[LO], -MAX_PRIO);
+
+	ctx[HI] = gem_context_create(fd);
+	ctx_set_priority(fd, ctx[HI], MAX_PRIO);
+
+	memset(&obj, 0, sizeof(obj));
+	obj.handle = gem_create(fd, 4096);
+	gem_write(fd, obj.handle, 0, &bbe, sizeof(bbe));
+
+	memset(&execbuf, 0, sizeof(execbuf));
+	execbuf.buffers_ptr = to_user_pointer(&obj);
+	execbuf.buffer_count = 1;
+	execbuf.flags = ring | LOCAL_EXEC_FENCE_OUT;
+	execbuf.rsvd1 = ctx[HI];
+
+	igt_stats_init_with_size(&stats, samples);
+
+	/* Occupy the engine with a minimum priority spinner, then time how
+	 * long a maximum priority empty batch takes from submission until
+	 * its out-fence signals. That interval is the price a high priority
+	 * client pays to preempt whatever else is running.
+	 */
+	for (int n = 0; n < samples && preempted; n++) {
+		struct timespec start = {};
+		struct spinner spin;
+		int fence;
+
+		spin = spin_ctx(fd, ctx[LO], ring);
+
+		igt_nsec_elapsed(&start);
+		execbuf.rsvd2 = -1;
+		gem_execbuf_wr(fd, &execbuf);
+		fence = execbuf.rsvd2 >> 32;
+
+		preempted = sync_fence_wait(fence, 1000) == 0;
+		igt_stats_push_float(&stats, igt_nsec_elapsed(&start) * 1e-3);
+
+		close(fence);
+		spin_end(fd, &spin);
+	}
+
+	gem_close(fd, obj.handle);
+	gem_context_destroy(fd, ctx[LO]);
+	gem_context_destroy(fd, ctx[HI]);
+
+	/* The probe only completed because we ended the spinner ourselves */
+	igt_require_f(preempted, "high priority batch made no progress past a spinner\n");
+
+	igt_info("%s: preempt-to-run latency: median %.2fus, 90%% %.2fus, 99%% %.2fus, max %.2fus\n",
+		 name,
+		 igt_stats_get_median(&stats),
+		 igt_stats_get_percentile(&stats, 90),
+		 igt_stats_get_percentile(&stats, 99),
+		 igt_stats_get_percentile(&stats, 100));
+	igt_stats_fini(&stats);
+}
+
 static bool has_scheduler(int fd)
 {
 	drm_i915_getparam_t gp;
@@ -571,6 +716,10 @@ igt_main
 
 				igt_subtest_f("wide-%s", e->name)
 					wide(fd, e->exec_id | e->flags);
+
+				igt_subtest_f("preempt-latency-%s", e->name)
+					preempt_latency(fd, e->exec_id | e->flags,
+							e->name);
 			}
 		}
 	}
@@ -1144,6 +1144,12 @@ static void test_swapping_evictions(int fd, int size, int count)
 	reset_handle_ptr();
 }
 
+static void test_parallel_evictions(int fd, int size)
+{
+	parallel_evictions(fd, &fault_ops, size);
+	reset_handle_ptr();
+}
+
 static void test_minor_evictions(int fd, int size, int count)
 {
 	minor_evictions(fd, &fault_ops, size, count);
@@ -1156,6 +1162,44 @@ static void test_major_evictions(int fd, int size, int count)
 	reset_handle_ptr();
 }
 
+static void test_pin_throughput(int fd)
+{
+	const uint64_t size = 2 << 20; /* one hugepage per object */
+	const int num = 64;
+	uint32_t handles[64];
+	int i, b;
+
+	for (b = 0; b < 2; b++) {
+		struct timespec start = {};
+		uint64_t ns;
+		void *ptr;
+
+		if (b)
+			ptr = gem_userptr_alloc_huge(num * size);
+		else
+			igt_assert(posix_memalign(&ptr, PAGE_SIZE,
+						  num * size) == 0);
+
+		/* Fault the backing store in up front so the timed section
+		 * measures get_pages, not first-touch page allocation.
+		 */
+		memset(ptr, 0x5a, num * size);
+
+		igt_nsec_elapsed(&start);
+		gem_userptr_batch(fd, ptr, size, num, userptr_flags, handles);
+		ns = igt_nsec_elapsed(&start);
+
+		igt_info("%s: created and pinned %dx%"PRIu64"MiB objects in %.2fms (%.1f MiB/s)\n",
+			 b ? "hugepages" : "small pages",
+			 num, size >> 20, ns * 1e-6,
+			 (num * size >> 20) * 1e9 / ns);
+
+		for (i = 0; i < num; i++)
+			gem_close(fd, handles[i]);
+		free(ptr);
+	}
+}
+
 static void test_overlap(int fd, int expected)
 {
 	char *ptr;
@@ -1507,6 +1551,9 @@ int main(int argc, char **argv)
 		igt_subtest("swapping-unsync-normal")
 			test_swapping_evictions(fd, size, count);
 
+		igt_subtest("parallel-unsync")
+			test_parallel_evictions(fd, size);
+
 		igt_subtest("minor-unsync-normal")
 			test_minor_evictions(fd, size, count);
 
@@ -1569,6 +1616,9 @@ int main(int argc, char **argv)
 		igt_subtest("create-destroy-sync")
 			test_create_destroy(fd, 5);
 
+		igt_subtest("pin-throughput")
+			test_pin_throughput(fd);
+
 		igt_subtest("sync-overlap")
 			test_overlap(fd, EINVAL);
 
@@ -1623,6 +1673,9 @@ int main(int argc, char **argv)
 		igt_subtest("swapping-normal-sync")
 			test_swapping_evictions(fd, size, count);
 
+		igt_subtest("parallel-sync")
+			test_parallel_evictions(fd, size);
+
 		igt_subtest("minor-normal-sync")
 			test_minor_evictions(fd, size, count);
 
@@ -114,5 +114,4 @@ igt_simple_main
 	kmstest_force_edid(drm_fd, connector, NULL, 0);
 
 	drmModeFreeConnector(connector);
-	free(edid);
 }
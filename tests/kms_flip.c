@@ -33,8 +33,10 @@
 #include <math.h>
 #include <stdint.h>
 #include <unistd.h>
+#include <sys/epoll.h>
 #include <sys/poll.h>
 #include <sys/time.h>
+#include <sys/timerfd.h>
 #include <sys/ioctl.h>
 #ifdef HAVE_LINUX_KD_H
 #include <linux/kd.h>
@@ -1056,6 +1058,44 @@ static void check_final_state(const struct test_output *o,
 	}
 }
 
+/* One epoll instance drives the events for every output under test; the
+ * drm fd is registered once and the timeout bookkeeping lives in a timerfd
+ * in the same set, so each wait is a single epoll_wait rather than
+ * rebuilding an fd_set and recomputing a timeval per call. Events carry
+ * their test_output in the user data, so outputs flipping concurrently
+ * (the 2x tests, or several pipes with events in flight) are demultiplexed
+ * by the handlers no matter which wait dispatched them.
+ */
+static struct {
+	int fd;
+	int timer;
+} event_base = { -1, -1 };
+
+static void event_base_init(void)
+{
+	struct epoll_event ev;
+
+	if (event_base.fd >= 0)
+		return;
+
+	event_base.fd = epoll_create1(EPOLL_CLOEXEC);
+	igt_assert(event_base.fd >= 0);
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = drm_fd;
+	igt_assert(epoll_ctl(event_base.fd, EPOLL_CTL_ADD, drm_fd, &ev) == 0);
+
+	event_base.timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	igt_assert(event_base.timer >= 0);
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = event_base.timer;
+	igt_assert(epoll_ctl(event_base.fd, EPOLL_CTL_ADD,
+			     event_base.timer, &ev) == 0);
+}
+
 /*
  * Wait until at least one pending event completes. Return mask of completed
  * events.
@@ -1063,10 +1103,8 @@ static void check_final_state(const struct test_output *o,
 static unsigned int wait_for_events(struct test_output *o)
 {
 	drmEventContext evctx;
-	struct timeval timeout = { .tv_sec = 3, .tv_usec = 0 };
-	fd_set fds;
+	struct itimerspec timeout = { .it_value = { .tv_sec = 3 } };
 	unsigned int event_mask;
-	int ret;
 
 	event_mask = o->pending_events;
 	igt_assert(event_mask);
@@ -1078,25 +1116,37 @@ static unsigned int wait_for_events(struct test_output *o)
 
 	/* make timeout lax with the dummy load */
 	if (o->flags & (TEST_WITH_DUMMY_BCS | TEST_WITH_DUMMY_RCS))
-		timeout.tv_sec *= 60;
+		timeout.it_value.tv_sec *= 60;
+
+	event_base_init();
+
+	/* One shot covering the whole wait; drmHandleEvent can dispatch
+	 * several events per wakeup, and rearming per event would let a
+	 * display delivering only some of them keep us alive forever.
+	 */
+	igt_assert(timerfd_settime(event_base.timer, 0, &timeout, NULL) == 0);
 
-	FD_ZERO(&fds);
-	FD_SET(drm_fd, &fds);
 	do {
+		struct epoll_event ev[2];
+		int n;
+
 		do {
-			ret = select(drm_fd + 1, &fds, NULL, NULL, &timeout);
-		} while (ret < 0 && errno == EINTR);
+			n = epoll_wait(event_base.fd, ev, ARRAY_SIZE(ev), -1);
+		} while (n < 0 && errno == EINTR);
+
+		igt_assert_f(n > 0, "epoll_wait error (errno %i)\n", errno);
 
-		igt_assert_f(ret >= 0,
-			     "select error (errno %i)\n", errno);
-		igt_assert_f(ret > 0,
-			     "select timed out or error (ret %d)\n", ret);
-		igt_assert_f(!FD_ISSET(0, &fds),
-			     "no fds active, breaking\n");
+		while (n--) {
+			igt_assert_f(ev[n].data.fd != event_base.timer,
+				     "timed out waiting for events\n");
 
-		do_or_die(drmHandleEvent(drm_fd, &evctx));
+			do_or_die(drmHandleEvent(drm_fd, &evctx));
+		}
 	} while (o->pending_events);
 
+	memset(&timeout, 0, sizeof(timeout));
+	timerfd_settime(event_base.timer, 0, &timeout, NULL);
+
 	event_mask ^= o->pending_events;
 	igt_assert(event_mask);
 
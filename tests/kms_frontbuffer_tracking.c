@@ -248,6 +248,7 @@ struct {
 	bool no_edp;
 	bool small_modes;
 	bool show_hidden;
+	bool pipelined_crc;
 	int step;
 	int only_pipes;
 	int shared_fb_x_offset;
@@ -260,6 +261,7 @@ struct {
 	.no_edp = false,
 	.small_modes = false,
 	.show_hidden= false,
+	.pipelined_crc = false,
 	.step = 0,
 	.only_pipes = PIPE_COUNT,
 	.shared_fb_x_offset = 500,
@@ -769,10 +771,17 @@ static void create_fbs(enum pixel_format format)
 		  LOCAL_I915_FORMAT_MOD_X_TILED, PLANE_SPR, &s->scnd_spr);
 }
 
+static void crc_pipeline_flush(void);
+
 static bool set_mode_for_params(struct modeset_params *params)
 {
 	int rc;
 
+	/* A modeset may restart the frame counter, which would break the
+	 * frame numbers already queued for deferred checking, so resolve
+	 * them while they're still valid. */
+	crc_pipeline_flush();
+
 	rc = drmModeSetCrtc(drm.fd, params->crtc_id, params->fb.fb->fb_id,
 			    params->fb.x, params->fb.y,
 			    &params->connector_id, 1, params->mode);
@@ -1158,6 +1167,8 @@ static void unset_all_crtcs(void)
 {
 	int i, rc;
 
+	crc_pipeline_flush();
+
 	for (i = 0; i < drm.res->count_crtcs; i++) {
 		rc = drmModeSetCrtc(drm.fd, drm.res->crtcs[i], -1, 0, 0, NULL,
 				    0, NULL);
@@ -1236,9 +1247,121 @@ static void print_crc(const char *str, struct both_crcs *crc)
 	free(pipe_str);
 }
 
+/*
+ * With --pipelined-crc the pipe CRC stream stays on for the whole subtest and
+ * a background collector (see igt_crc_collector_start()) drains it into a
+ * frame-indexed table. CRC checks just note "frame N should match this
+ * pattern" and keep going; the actual comparisons happen in a batch when the
+ * queue is flushed, so the test doesn't stop to open/start/read/stop the CRC
+ * interface around every single drawing operation. The queue is flushed
+ * before any modeset (which may restart the frame counter) and on teardown,
+ * so a mismatch can be reported slightly after the operation that caused it:
+ * the assertion message carries the frame number to track it back.
+ */
+#define CRC_PIPELINE_DEPTH 64
+
+struct {
+	igt_crc_collector_t *collector;
+	struct {
+		struct both_crcs *wanted;
+		uint32_t frame;
+	} queue[CRC_PIPELINE_DEPTH];
+	int count;
+} crc_pipeline;
+
+static uint32_t crc_pipeline_next_frame(void)
+{
+	uint32_t frame;
+
+	while (!igt_crc_collector_latest(crc_pipeline.collector, &frame))
+		usleep(1000);
+
+	/* Content drawn now is guaranteed to be part of the scanout two
+	 * frames after the latest one the collector has seen. */
+	return frame + 2;
+}
+
+static void crc_pipeline_flush(void)
+{
+	igt_crc_t crc;
+	int i;
+
+	if (!crc_pipeline.collector)
+		return;
+
+	for (i = 0; i < crc_pipeline.count; i++) {
+		igt_assert_f(igt_crc_collector_get_frame(crc_pipeline.collector,
+						crc_pipeline.queue[i].frame,
+						&crc, true),
+			     "Pipelined CRC for frame %u was lost\n",
+			     crc_pipeline.queue[i].frame);
+		igt_debug("Pipelined CRC check for frame %u\n",
+			  crc_pipeline.queue[i].frame);
+		igt_assert_crc_equal(&crc,
+				     &crc_pipeline.queue[i].wanted->pipe);
+	}
+
+	crc_pipeline.count = 0;
+}
+
+static void crc_pipeline_queue(struct both_crcs *wanted,
+			       bool mandatory_sink_crc)
+{
+	uint32_t frame = crc_pipeline_next_frame();
+
+	if (mandatory_sink_crc) {
+		/* The sink CRC has no frame-indexed backlog: it can only be
+		 * read live, so PSR subtests resolve their checks on the
+		 * spot instead of deferring them. */
+		sink_crc_t sink;
+		igt_crc_t crc;
+
+		igt_assert(igt_crc_collector_get_frame(crc_pipeline.collector,
+						       frame, &crc, true));
+		igt_assert_crc_equal(&crc, &wanted->pipe);
+		get_sink_crc(&sink, true);
+		assert_sink_crc_equal(&sink, &wanted->sink);
+		return;
+	}
+
+	if (crc_pipeline.count == CRC_PIPELINE_DEPTH)
+		crc_pipeline_flush();
+
+	crc_pipeline.queue[crc_pipeline.count].wanted = wanted;
+	crc_pipeline.queue[crc_pipeline.count].frame = frame;
+	crc_pipeline.count++;
+}
+
+static void crc_pipeline_collect_fresh(igt_crc_t *out)
+{
+	uint32_t frame, next;
+	int n;
+
+	/* After a modeset the frame counter may restart, so don't chase a
+	 * precomputed frame number: just watch frames go by until two new
+	 * ones have arrived, which guarantees a complete scanout of the
+	 * current contents. */
+	while (!igt_crc_collector_latest(crc_pipeline.collector, &frame))
+		usleep(1000);
+
+	for (n = 0; n < 2; n++) {
+		while (igt_crc_collector_latest(crc_pipeline.collector,
+						&next) && next == frame)
+			usleep(1000);
+		frame = next;
+	}
+
+	igt_assert(igt_crc_collector_get_frame(crc_pipeline.collector, frame,
+					       out, false));
+}
+
 static void collect_crcs(struct both_crcs *crcs, bool mandatory_sink_crc)
 {
-	igt_pipe_crc_collect_crc(pipe_crc, &crcs->pipe);
+	if (crc_pipeline.collector)
+		crc_pipeline_collect_fresh(&crcs->pipe);
+	else
+		igt_pipe_crc_collect_crc(pipe_crc, &crcs->pipe);
+
 	get_sink_crc(&crcs->sink, mandatory_sink_crc);
 }
 
@@ -1444,7 +1567,15 @@ static void setup_crcs(void)
 	enum pixel_format f;
 	int crtc_idx = kmstest_get_crtc_idx(drm.res, prim_mode_params.crtc_id);
 
-	pipe_crc = igt_pipe_crc_new(drm.fd, crtc_idx, INTEL_PIPE_CRC_SOURCE_AUTO);
+	if (opt.pipelined_crc) {
+		pipe_crc = igt_pipe_crc_new_nonblock(drm.fd, crtc_idx,
+						     INTEL_PIPE_CRC_SOURCE_AUTO);
+		igt_pipe_crc_start(pipe_crc);
+		crc_pipeline.collector = igt_crc_collector_start(pipe_crc);
+	} else {
+		pipe_crc = igt_pipe_crc_new(drm.fd, crtc_idx,
+					    INTEL_PIPE_CRC_SOURCE_AUTO);
+	}
 
 	setup_sink_crc();
 
@@ -1502,6 +1633,13 @@ static void teardown_crcs(void)
 	if (sink_crc.fd != -1)
 		close(sink_crc.fd);
 
+	if (crc_pipeline.collector) {
+		crc_pipeline_flush();
+		igt_crc_collector_stop(crc_pipeline.collector);
+		crc_pipeline.collector = NULL;
+		igt_pipe_crc_stop(pipe_crc);
+	}
+
 	igt_pipe_crc_free(pipe_crc);
 }
 
@@ -1683,10 +1821,15 @@ static int adjust_assertion_flags(const struct test_mode *t, int flags)
 	if (!opt.check_crc || (flags__ & DONT_ASSERT_CRC))		\
 		break;							\
 									\
+	igt_assert(wanted_crc);						\
+	if (crc_pipeline.collector) {					\
+		crc_pipeline_queue(wanted_crc, mandatory_sink_crc);	\
+		break;							\
+	}								\
+									\
 	collect_crcs(&crc_, mandatory_sink_crc);			\
 	print_crc("Calculated CRC:", &crc_);				\
 									\
-	igt_assert(wanted_crc);						\
 	igt_assert_crc_equal(&crc_.pipe, &wanted_crc->pipe);		\
 	if (mandatory_sink_crc)						\
 		assert_sink_crc_equal(&crc_.sink, &wanted_crc->sink);	\
@@ -3252,6 +3395,9 @@ static int opt_handler(int option, int option_index, void *data)
 	case 'i':
 		opt.show_hidden = true;
 		break;
+	case 'p':
+		opt.pipelined_crc = true;
+		break;
 	case 't':
 		opt.step++;
 		break;
@@ -3288,6 +3434,7 @@ const char *help_str =
 "  --no-edp                    Don't use eDP monitors\n"
 "  --use-small-modes           Use smaller resolutions for the modes\n"
 "  --show-hidden               Show hidden subtests\n"
+"  --pipelined-crc             Queue CRC checks and resolve them in batches\n"
 "  --step                      Stop on each step so you can check the screen\n"
 "  --shared-fb-x offset        Use 'offset' as the X offset for the shared FB\n"
 "  --shared-fb-y offset        Use 'offset' as the Y offset for the shared FB\n"
@@ -3426,6 +3573,7 @@ int main(int argc, char *argv[])
 		{ "no-edp",                   0, 0, 'e'},
 		{ "use-small-modes",          0, 0, 'm'},
 		{ "show-hidden",              0, 0, 'i'},
+		{ "pipelined-crc",            0, 0, 'p'},
 		{ "step",                     0, 0, 't'},
 		{ "shared-fb-x",              1, 0, 'x'},
 		{ "shared-fb-y",              1, 0, 'y'},
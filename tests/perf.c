@@ -38,6 +38,7 @@
 #include <math.h>
 
 #include "igt.h"
+#include "igt_perf_oa.h"
 #include "drm.h"
 
 IGT_TEST_DESCRIPTION("Test the i915 perf metrics streaming interface");
@@ -71,107 +72,10 @@ IGT_TEST_DESCRIPTION("Test the i915 perf metrics streaming interface");
 #define PIPE_CONTROL_PPGTT_WRITE	(0 << 2)
 #define PIPE_CONTROL_GLOBAL_GTT_WRITE   (1 << 2)
 
-/* Temporarily copy i915-perf uapi here to avoid a dependency on libdrm's
- * i915_drm.h copy being updated with the i915-perf interface before this
- * test can land in i-g-t.
- *
- * TODO: remove this once the interface lands in libdrm
+/* The i915-perf uapi fallback definitions and the report format layout
+ * tables now live in lib/igt_perf_oa.h, shared with the other OA stream
+ * consumers.
  */
-#ifndef DRM_I915_PERF_OPEN
-#define DRM_I915_PERF_OPEN		0x36
-#define DRM_IOCTL_I915_PERF_OPEN	DRM_IOW(DRM_COMMAND_BASE + DRM_I915_PERF_OPEN, struct drm_i915_perf_open_param)
-
-enum drm_i915_oa_format {
-       I915_OA_FORMAT_A13 = 1,
-       I915_OA_FORMAT_A29,
-       I915_OA_FORMAT_A13_B8_C8,
-       I915_OA_FORMAT_B4_C8,
-       I915_OA_FORMAT_A45_B8_C8,
-       I915_OA_FORMAT_B4_C8_A16,
-       I915_OA_FORMAT_C4_B8,
-
-       I915_OA_FORMAT_MAX /* non-ABI */
-};
-
-enum drm_i915_perf_property_id {
-       DRM_I915_PERF_PROP_CTX_HANDLE = 1,
-       DRM_I915_PERF_PROP_SAMPLE_OA,
-       DRM_I915_PERF_PROP_OA_METRICS_SET,
-       DRM_I915_PERF_PROP_OA_FORMAT,
-       DRM_I915_PERF_PROP_OA_EXPONENT,
-
-       DRM_I915_PERF_PROP_MAX /* non-ABI */
-};
-
-struct drm_i915_perf_open_param {
-       __u32 flags;
-#define I915_PERF_FLAG_FD_CLOEXEC	(1<<0)
-#define I915_PERF_FLAG_FD_NONBLOCK	(1<<1)
-#define I915_PERF_FLAG_DISABLED		(1<<2)
-
-       __u32 num_properties;
-       __u64 properties_ptr;
-};
-
-#define I915_PERF_IOCTL_ENABLE _IO('i', 0x0)
-#define I915_PERF_IOCTL_DISABLE	_IO('i', 0x1)
-
-struct drm_i915_perf_record_header {
-       __u32 type;
-       __u16 pad;
-       __u16 size;
-};
-
-enum drm_i915_perf_record_type {
-       DRM_I915_PERF_RECORD_SAMPLE = 1,
-       DRM_I915_PERF_RECORD_OA_REPORT_LOST = 2,
-       DRM_I915_PERF_RECORD_OA_BUFFER_LOST = 3,
-
-       DRM_I915_PERF_RECORD_MAX /* non-ABI */
-};
-#endif /* !DRM_I915_PERF_OPEN */
-
-static struct {
-	const char *name;
-	size_t size;
-	int a_off; /* bytes */
-	int n_a;
-	int first_a;
-	int b_off;
-	int n_b;
-	int c_off;
-	int n_c;
-} oa_formats[I915_OA_FORMAT_MAX] = {
-	[I915_OA_FORMAT_A13] = {
-		"A13", .size = 64,
-		.a_off = 12, .n_a = 13 },
-	[I915_OA_FORMAT_A29] = {
-		"A29", .size = 128,
-		.a_off = 12, .n_a = 29 },
-	[I915_OA_FORMAT_A13_B8_C8] = {
-		"A13_B8_C8", .size = 128,
-		.a_off = 12, .n_a = 13,
-		.b_off = 64, .n_b = 8,
-		.c_off = 96, .n_c = 8 },
-	[I915_OA_FORMAT_A45_B8_C8] = {
-		"A45_B8_C8", .size = 256,
-		.a_off = 12,  .n_a = 45,
-		.b_off = 192, .n_b = 8,
-		.c_off = 224, .n_c = 8 },
-	[I915_OA_FORMAT_B4_C8] = {
-		"B4_C8", .size = 64,
-		.b_off = 16, .n_b = 4,
-		.c_off = 32, .n_c = 8 },
-	[I915_OA_FORMAT_B4_C8_A16] = {
-		"B4_C8_A16", .size = 128,
-		.b_off = 16, .n_b = 4,
-		.c_off = 32, .n_c = 8,
-		.a_off = 60, .n_a = 16, .first_a = 29 },
-	[I915_OA_FORMAT_C4_B8] = {
-		"C4_B8", .size = 64,
-		.c_off = 16, .n_c = 4,
-		.b_off = 28, .n_b = 8 },
-};
 
 static bool hsw_undefined_a_counters[45] = {
 	[4] = true,
@@ -220,7 +124,7 @@ static int
 lookup_format(int i915_perf_fmt_id)
 {
 	igt_assert(i915_perf_fmt_id < I915_OA_FORMAT_MAX);
-	igt_assert(oa_formats[i915_perf_fmt_id].name);
+	igt_assert(igt_oa_formats[i915_perf_fmt_id].name);
 
 	return i915_perf_fmt_id;
 }
@@ -597,18 +501,16 @@ read_2_oa_reports(int stream_fd,
 		  uint32_t *oa_report1,
 		  bool timer_only)
 {
-	size_t format_size = oa_formats[format_id].size;
+	size_t format_size = igt_oa_formats[format_id].size;
 	size_t sample_size = (sizeof(struct drm_i915_perf_record_header) +
 			      format_size);
 	const struct drm_i915_perf_record_header *header;
 	uint32_t exponent_mask = (1 << (exponent + 1)) - 1;
+	igt_oa_reader_t *reader = igt_oa_reader_new(stream_fd, format_id);
+	int n = 0;
 
-	/* Note: we allocate a large buffer so that each read() iteration
-	 * should scrape *all* pending records.
-	 *
-	 * The largest buffer the OA unit supports is 16MB and the smallest
-	 * OA report format is 64bytes allowing up to 262144 reports to
-	 * be buffered.
+	/* The reader's buffer is sized so that each refill should scrape
+	 * *all* pending records.
 	 *
 	 * Being sure we are fetching all buffered reports allows us to
 	 * potentially throw away / skip all reports whenever we see
@@ -621,98 +523,86 @@ read_2_oa_reports(int stream_fd,
 	 * to indicate that the OA unit may be over taxed if lots of reports
 	 * are being lost.
 	 */
-	int buf_size = 262144 * (64 + sizeof(struct drm_i915_perf_record_header));
-	uint8_t *buf = malloc(buf_size);
-	int n = 0;
+	for (int i = 0; i < 1000000; i++) {
+		const uint32_t *report;
 
-	for (int i = 0; i < 1000; i++) {
-		ssize_t len;
+		header = igt_oa_reader_next(reader);
+		igt_assert(header);
 
-		while ((len = read(stream_fd, buf, buf_size)) < 0 &&
-		       errno == EINTR)
-			;
-
-		igt_assert(len > 0);
-
-		for (size_t offset = 0; offset < len; offset += header->size) {
-			const uint32_t *report;
-
-			header = (void *)(buf + offset);
+		igt_assert_eq(header->pad, 0); /* Reserved */
 
-			igt_assert_eq(header->pad, 0); /* Reserved */
+		/* Currently the only test that should ever expect to
+		 * see a _BUFFER_LOST error is the buffer_fill test,
+		 * otherwise something bad has probably happened...
+		 */
+		igt_assert_neq(header->type, DRM_I915_PERF_RECORD_OA_BUFFER_LOST);
 
-			/* Currently the only test that should ever expect to
-			 * see a _BUFFER_LOST error is the buffer_fill test,
-			 * otherwise something bad has probably happened...
-			 */
-			igt_assert_neq(header->type, DRM_I915_PERF_RECORD_OA_BUFFER_LOST);
+		/* At high sampling frequencies the OA HW might not be
+		 * able to cope with all write requests and will notify
+		 * us that a report was lost. We restart our read of
+		 * two sequential reports due to the timeline blip this
+		 * implies
+		 */
+		if (header->type == DRM_I915_PERF_RECORD_OA_REPORT_LOST) {
+			igt_debug("read restart: OA trigger collision / report lost\n");
+			n = 0;
 
-			/* At high sampling frequencies the OA HW might not be
-			 * able to cope with all write requests and will notify
-			 * us that a report was lost. We restart our read of
-			 * two sequential reports due to the timeline blip this
-			 * implies
+			/* XXX: flush, because we don't know where
+			 * within the series of already read reports
+			 * there could be a blip from the lost report.
 			 */
-			if (header->type == DRM_I915_PERF_RECORD_OA_REPORT_LOST) {
-				igt_debug("read restart: OA trigger collision / report lost\n");
-				n = 0;
+			igt_oa_reader_flush(reader);
+			continue;
+		}
 
-				/* XXX: break, because we don't know where
-				 * within the series of already read reports
-				 * there could be a blip from the lost report.
-				 */
-				break;
-			}
+		/* Currently the only other record type expected is a
+		 * _SAMPLE. Notably this test will need updating if
+		 * i915-perf is extended in the future with additional
+		 * record types.
+		 */
+		igt_assert_eq(header->type, DRM_I915_PERF_RECORD_SAMPLE);
 
-			/* Currently the only other record type expected is a
-			 * _SAMPLE. Notably this test will need updating if
-			 * i915-perf is extended in the future with additional
-			 * record types.
-			 */
-			igt_assert_eq(header->type, DRM_I915_PERF_RECORD_SAMPLE);
+		igt_assert_eq(header->size, sample_size);
 
-			igt_assert_eq(header->size, sample_size);
+		report = igt_oa_record_report(header);
 
-			report = (const void *)(header + 1);
+		igt_debug("read report: reason = %x, timestamp = %x, exponent mask=%x\n",
+			  report[0], report[1], exponent_mask);
 
-			igt_debug("read report: reason = %x, timestamp = %x, exponent mask=%x\n",
-				  report[0], report[1], exponent_mask);
+		/* Don't expect zero for timestamps */
+		igt_assert_neq(report[1], 0);
 
-			/* Don't expect zero for timestamps */
-			igt_assert_neq(report[1], 0);
+		if (timer_only) {
+			/* For Haswell we don't have a documented
+			 * report reason field (though empirically
+			 * report[0] bit 10 does seem to correlate with
+			 * a timer trigger reason) so we instead infer
+			 * which reports are timer triggered by
+			 * checking if the least significant bits are
+			 * zero and the exponent bit is set.
+			 */
+			if ((report[1] & exponent_mask) != (1 << exponent)) {
+				igt_debug("skipping non timer report reason=%x\n",
+					  report[0]);
 
-			if (timer_only) {
-				/* For Haswell we don't have a documented
-				 * report reason field (though empirically
-				 * report[0] bit 10 does seem to correlate with
-				 * a timer trigger reason) so we instead infer
-				 * which reports are timer triggered by
-				 * checking if the least significant bits are
-				 * zero and the exponent bit is set.
+				/* Also assert our hypothesis about the
+				 * reason bit...
 				 */
-				if ((report[1] & exponent_mask) != (1 << exponent)) {
-					igt_debug("skipping non timer report reason=%x\n",
-						  report[0]);
-
-					/* Also assert our hypothesis about the
-					 * reason bit...
-					 */
-					igt_assert_eq(report[0] & (1 << 10), 0);
-					continue;
-				}
+				igt_assert_eq(report[0] & (1 << 10), 0);
+				continue;
 			}
+		}
 
-			if (n++ == 0)
-				memcpy(oa_report0, report, format_size);
-			else {
-				memcpy(oa_report1, report, format_size);
-				free(buf);
-				return;
-			}
+		if (n++ == 0)
+			memcpy(oa_report0, report, format_size);
+		else {
+			memcpy(oa_report1, report, format_size);
+			igt_oa_reader_free(reader);
+			return;
 		}
 	}
 
-	free(buf);
+	igt_oa_reader_free(reader);
 
 	igt_assert(!"reached");
 }
@@ -756,25 +646,25 @@ print_reports(uint32_t *oa_report0, uint32_t *oa_report1, int fmt)
 	/* Not ideal naming here with a0 or a1
 	 * differentiating report0 or 1 not A counter 0 or 1....
 	 */
-	a0 = (uint32_t *)(((uint8_t *)oa_report0) + oa_formats[fmt].a_off);
-	b0 = (uint32_t *)(((uint8_t *)oa_report0) + oa_formats[fmt].b_off);
-	c0 = (uint32_t *)(((uint8_t *)oa_report0) + oa_formats[fmt].c_off);
+	a0 = (uint32_t *)(((uint8_t *)oa_report0) + igt_oa_formats[fmt].a_off);
+	b0 = (uint32_t *)(((uint8_t *)oa_report0) + igt_oa_formats[fmt].b_off);
+	c0 = (uint32_t *)(((uint8_t *)oa_report0) + igt_oa_formats[fmt].c_off);
 
-	a1 = (uint32_t *)(((uint8_t *)oa_report1) + oa_formats[fmt].a_off);
-	b1 = (uint32_t *)(((uint8_t *)oa_report1) + oa_formats[fmt].b_off);
-	c1 = (uint32_t *)(((uint8_t *)oa_report1) + oa_formats[fmt].c_off);
+	a1 = (uint32_t *)(((uint8_t *)oa_report1) + igt_oa_formats[fmt].a_off);
+	b1 = (uint32_t *)(((uint8_t *)oa_report1) + igt_oa_formats[fmt].b_off);
+	c1 = (uint32_t *)(((uint8_t *)oa_report1) + igt_oa_formats[fmt].c_off);
 
 	igt_debug("TIMESTAMP: 1st = %"PRIu32", 2nd = %"PRIu32", delta = %"PRIu32"\n",
 		  oa_report0[1], oa_report1[1], oa_report1[1] - oa_report0[1]);
 
-	if (oa_formats[fmt].n_c) {
+	if (igt_oa_formats[fmt].n_c) {
 		igt_debug("CLOCK: 1st = %"PRIu32", 2nd = %"PRIu32", delta = %"PRIu32"\n",
 			  c0[2], c1[2], c1[2] - c0[2]);
 	} else
 		igt_debug("CLOCK = N/A\n");
 
-	for (int j = oa_formats[fmt].first_a;
-	     j < oa_formats[fmt].n_a;
+	for (int j = igt_oa_formats[fmt].first_a;
+	     j < igt_oa_formats[fmt].n_a;
 	     j++)
 	{
 		uint32_t delta = a1[j] - a0[j];
@@ -786,13 +676,13 @@ print_reports(uint32_t *oa_report0, uint32_t *oa_report1, int fmt)
 			  j, a0[j], a1[j], delta);
 	}
 
-	for (int j = 0; j < oa_formats[fmt].n_b; j++) {
+	for (int j = 0; j < igt_oa_formats[fmt].n_b; j++) {
 		uint32_t delta = b1[j] - b0[j];
 		igt_debug("B%d: 1st = %"PRIu32", 2nd = %"PRIu32", delta = %"PRIu32"\n",
 			  j, b0[j], b1[j], delta);
 	}
 
-	for (int j = 0; j < oa_formats[fmt].n_c; j++) {
+	for (int j = 0; j < igt_oa_formats[fmt].n_c; j++) {
 		uint32_t delta = c1[j] - c0[j];
 		igt_debug("C%d: 1st = %"PRIu32", 2nd = %"PRIu32", delta = %"PRIu32"\n",
 			  j, c0[j], c1[j], delta);
@@ -804,7 +694,7 @@ test_oa_formats(void)
 {
 	int oa_exponent = 13;
 
-	for (int i = 0; i < ARRAY_SIZE(oa_formats); i++) {
+	for (int i = 0; i < ARRAY_SIZE(igt_oa_formats); i++) {
 		uint32_t oa_report0[64];
 		uint32_t oa_report1[64];
 		uint32_t *a0, *b0, *c0;
@@ -813,10 +703,10 @@ test_oa_formats(void)
 		uint32_t clock_delta;
 		uint32_t max_delta;
 
-		if (!oa_formats[i].name) /* sparse, indexed by ID */
+		if (!igt_oa_formats[i].name) /* sparse, indexed by ID */
 			continue;
 
-		igt_debug("Checking OA format %s\n", oa_formats[i].name);
+		igt_debug("Checking OA format %s\n", igt_oa_formats[i].name);
 
 		open_and_read_2_oa_reports(i,
 					   oa_exponent,
@@ -826,13 +716,13 @@ test_oa_formats(void)
 
 		print_reports(oa_report0, oa_report1, i);
 
-		a0 = (uint32_t *)(((uint8_t *)oa_report0) + oa_formats[i].a_off);
-		b0 = (uint32_t *)(((uint8_t *)oa_report0) + oa_formats[i].b_off);
-		c0 = (uint32_t *)(((uint8_t *)oa_report0) + oa_formats[i].c_off);
+		a0 = (uint32_t *)(((uint8_t *)oa_report0) + igt_oa_formats[i].a_off);
+		b0 = (uint32_t *)(((uint8_t *)oa_report0) + igt_oa_formats[i].b_off);
+		c0 = (uint32_t *)(((uint8_t *)oa_report0) + igt_oa_formats[i].c_off);
 
-		a1 = (uint32_t *)(((uint8_t *)oa_report1) + oa_formats[i].a_off);
-		b1 = (uint32_t *)(((uint8_t *)oa_report1) + oa_formats[i].b_off);
-		c1 = (uint32_t *)(((uint8_t *)oa_report1) + oa_formats[i].c_off);
+		a1 = (uint32_t *)(((uint8_t *)oa_report1) + igt_oa_formats[i].a_off);
+		b1 = (uint32_t *)(((uint8_t *)oa_report1) + igt_oa_formats[i].b_off);
+		c1 = (uint32_t *)(((uint8_t *)oa_report1) + igt_oa_formats[i].c_off);
 
 		time_delta = timebase_scale(oa_report1[1] - oa_report0[1]);
 		igt_assert_neq(time_delta, 0);
@@ -841,7 +731,7 @@ test_oa_formats(void)
 		 * basic metric set but it's not included in all of the
 		 * formats.
 		 */
-		if (oa_formats[i].n_c) {
+		if (igt_oa_formats[i].n_c) {
 			uint64_t freq;
 
 			/* The first report might have a clock count of zero
@@ -872,8 +762,8 @@ test_oa_formats(void)
 		 */
 		max_delta = clock_delta * 40;
 
-		for (int j = oa_formats[i].first_a;
-		     j < oa_formats[i].n_a;
+		for (int j = igt_oa_formats[i].first_a;
+		     j < igt_oa_formats[i].n_a;
 		     j++)
 		{
 			uint32_t delta = a1[j] - a0[j];
@@ -885,13 +775,13 @@ test_oa_formats(void)
 			igt_assert(delta <= max_delta);
 		}
 
-		for (int j = 0; j < oa_formats[i].n_b; j++) {
+		for (int j = 0; j < igt_oa_formats[i].n_b; j++) {
 			uint32_t delta = b1[j] - b0[j];
 			igt_debug("B%d: delta = %"PRIu32"\n", j, delta);
 			igt_assert(delta <= max_delta);
 		}
 
-		for (int j = 0; j < oa_formats[i].n_c; j++) {
+		for (int j = 0; j < igt_oa_formats[i].n_c; j++) {
 			uint32_t delta = c1[j] - c0[j];
 			igt_debug("C%d: delta = %"PRIu32"\n", j, delta);
 			igt_assert(delta <= max_delta);
@@ -985,7 +875,7 @@ test_oa_exponents(int gt_freq_mhz)
 			 * open_and_read_2_oa_reports(), the C2 counter is
 			 * configured as the gpu clock counter...
 			 */
-			c_off = oa_formats[I915_OA_FORMAT_A45_B8_C8].c_off;
+			c_off = igt_oa_formats[I915_OA_FORMAT_A45_B8_C8].c_off;
 			igt_assert(c_off);
 			c0 = (uint32_t *)(((uint8_t *)oa_report0) + c_off);
 			c1 = (uint32_t *)(((uint8_t *)oa_report1) + c_off);
@@ -165,6 +165,82 @@ static void measure_residencies(int devid, unsigned int rc6_mask,
 	res->rc6 += res->rc6p;
 }
 
+#define EXIT_LATENCY_WINDOW_MS 5
+#define EXIT_LATENCY_DURATION_MS 2000
+#define EXIT_LATENCY_BUCKETS 16
+
+static unsigned long read_combined_residency(unsigned int rc6_mask)
+{
+	unsigned long ms = 0;
+
+	if (rc6_mask & RC6_ENABLED)
+		ms += read_rc6_residency("rc6");
+	if (rc6_mask & RC6P_ENABLED)
+		ms += read_rc6_residency("rc6p");
+	if (rc6_mask & RC6PP_ENABLED)
+		ms += read_rc6_residency("rc6pp");
+
+	return ms;
+}
+
+/*
+ * A residency delta around one long sleep cannot distinguish 90%
+ * residency from a 2 ms spurious wakeup firing at 50 Hz, and it is the
+ * latter that costs us idle power. Sample the counters at a small
+ * window instead and histogram the length of each contiguous
+ * out-of-rc6 spell; a periodic wakeup then stands out as a spike in
+ * its duration bucket.
+ */
+static void measure_exit_latency(unsigned int rc6_mask)
+{
+	unsigned long exits[EXIT_LATENCY_BUCKETS] = {};
+	unsigned long nr_exits = 0, exit_ms = 0;
+	unsigned long res, prev_res;
+	unsigned long t, prev_t, start;
+	int n;
+
+	prev_t = start = gettime_ms();
+	prev_res = read_combined_residency(rc6_mask);
+
+	while ((t = gettime_ms()) - start < EXIT_LATENCY_DURATION_MS) {
+		unsigned long d_time, busy;
+
+		usleep(EXIT_LATENCY_WINDOW_MS * 1000);
+
+		res = read_combined_residency(rc6_mask);
+		t = gettime_ms();
+
+		d_time = t - prev_t;
+		busy = res - prev_res < d_time ? d_time - (res - prev_res) : 0;
+
+		if (busy) {
+			exit_ms += busy;
+		} else if (exit_ms) {
+			int bucket = 0;
+
+			while (exit_ms >> (bucket + 1) &&
+			       bucket < EXIT_LATENCY_BUCKETS - 1)
+				bucket++;
+
+			exits[bucket]++;
+			nr_exits++;
+			exit_ms = 0;
+		}
+
+		prev_t = t;
+		prev_res = res;
+	}
+
+	igt_info("%lu RC6 exits in %u ms:\n",
+		 nr_exits, EXIT_LATENCY_DURATION_MS);
+	for (n = 0; n < EXIT_LATENCY_BUCKETS; n++) {
+		if (!exits[n])
+			continue;
+		igt_info("  %4d - %4d ms: %lu\n",
+			 1 << n, (2 << n) - 1, exits[n]);
+	}
+}
+
 igt_main
 {
 	unsigned int rc6_mask;
@@ -209,4 +285,10 @@ igt_main
 
 		residency_accuracy(res.rc6pp, res.duration, "rc6pp");
 	}
+
+	igt_subtest("rc6-exit-latency") {
+		igt_skip_on(!(rc6_mask & RC6_ENABLED));
+
+		measure_exit_latency(rc6_mask);
+	}
 }
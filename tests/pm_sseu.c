@@ -48,17 +48,6 @@ struct {
 	uint32_t spins_per_msec;
 } gem;
 
-static double
-to_dt(const struct timespec *start, const struct timespec *end)
-{
-	double dt;
-
-	dt = (end->tv_sec - start->tv_sec) * 1e3;
-	dt += (end->tv_nsec - start->tv_nsec) * 1e-6;
-
-	return dt;
-}
-
 struct status {
 	struct {
 		int slice_total;
@@ -213,42 +202,6 @@ gem_check_spin(uint32_t spins)
 	igt_assert_eq_u32(*data, spins);
 }
 
-static uint32_t
-gem_get_target_spins(double dt)
-{
-	struct timespec tstart, tdone;
-	double prev_dt, cur_dt;
-	uint32_t spins;
-	int i, ret;
-
-	/* Double increments until we bound the target time */
-	prev_dt = 0.0;
-	for (i = 0; i < 32; i++) {
-		spins = 1 << i;
-		clock_gettime(CLOCK_MONOTONIC, &tstart);
-
-		gem.spinfunc(gem.batch, &gem.buf, spins);
-		ret = drm_intel_bo_map(gem.buf.bo, 0);
-		igt_assert_eq(ret, 0);
-		clock_gettime(CLOCK_MONOTONIC, &tdone);
-
-		gem_check_spin(spins);
-		drm_intel_bo_unmap(gem.buf.bo);
-
-		cur_dt = to_dt(&tstart, &tdone);
-		if (cur_dt > dt)
-			break;
-		prev_dt = cur_dt;
-	}
-	igt_assert_neq(i, 32);
-
-	/* Linearly interpolate between i and i-1 to get target increments */
-	spins = 1 << (i-1); /* lower bound spins */
-	spins += spins * (dt - prev_dt)/(cur_dt - prev_dt); /* target spins */
-
-	return spins;
-}
-
 static void
 gem_init(void)
 {
@@ -281,7 +234,8 @@ gem_init(void)
 	igt_assert(gem.buf.bo);
 	gem.init = 4;
 
-	gem.spins_per_msec = gem_get_target_spins(100) / 100;
+	gem.spins_per_msec = media_spin_calibrate(gem.drm_fd, gem.batch,
+						  &gem.buf);
 }
 
 static void
@@ -807,6 +807,156 @@ static void test_sync_expired_merge(void)
 	close(fence_expired);
 }
 
+static void test_alloc_fence_array(void)
+{
+	int fences[64];
+	int timeline;
+	int i;
+
+	timeline = sw_sync_timeline_create();
+	sw_sync_timeline_create_fence_array(timeline, 1, fences, 64);
+
+	/* One increment covering half the batch signals exactly that half */
+	sw_sync_timeline_inc(timeline, 32);
+	igt_assert_f(sync_fence_wait(fences[31], 0) == 0,
+		     "Fence in covered half of batch not signaled\n");
+	igt_assert_f(sync_fence_wait(fences[32], 0) == -ETIME,
+		     "Fence beyond timeline value signaled early\n");
+
+	sw_sync_timeline_inc(timeline, 32);
+	for (i = 0; i < 64; i++) {
+		igt_assert_f(sync_fence_wait(fences[i], 0) == 0,
+			     "Fence %d of batch not signaled\n", i);
+		close(fences[i]);
+	}
+
+	close(timeline);
+}
+
+#define STRESS_CONSUMER_THREADS 4
+#define STRESS_QUEUE_DEPTH 1024 /* power of two */
+#define STRESS_QUEUE_BATCH 64
+#define STRESS_QUEUE_FENCES (1 << 18)
+
+/* Single producer, multiple consumers. Tickets are claimed by cmpxchg on
+ * tail so the hot path never takes a lock; the existing threaded subtests
+ * serialize on a mutex or semaphore and end up measuring our own wrapper
+ * rather than the sync_file code.
+ */
+static struct {
+	int fences[STRESS_QUEUE_DEPTH];
+	uint32_t head;
+	uint32_t tail;
+	bool done;
+} stress_queue;
+
+static void *test_fence_queue_consumer_thread(void *arg)
+{
+	uintptr_t fail = 0;
+
+	for (;;) {
+		uint32_t t = __atomic_load_n(&stress_queue.tail,
+					     __ATOMIC_RELAXED);
+		int fence;
+
+		if (t == __atomic_load_n(&stress_queue.head,
+					 __ATOMIC_ACQUIRE)) {
+			/* Recheck head after done: the producer publishes
+			 * the final fences before setting the flag.
+			 */
+			if (__atomic_load_n(&stress_queue.done,
+					    __ATOMIC_ACQUIRE) &&
+			    t == __atomic_load_n(&stress_queue.head,
+						 __ATOMIC_ACQUIRE))
+				break;
+			continue;
+		}
+
+		/* Read the slot before claiming the ticket; losing the race
+		 * just discards the value and retries, and the release half
+		 * of the cmpxchg keeps the read ahead of the producer's
+		 * licence to reuse the slot.
+		 */
+		fence = stress_queue.fences[t % STRESS_QUEUE_DEPTH];
+		if (!__atomic_compare_exchange_n(&stress_queue.tail, &t, t + 1,
+						 false, __ATOMIC_ACQ_REL,
+						 __ATOMIC_RELAXED))
+			continue;
+
+		if (sync_fence_wait(fence, 1000) < 0)
+			fail = 1;
+		close(fence);
+	}
+
+	return (void *)fail;
+}
+
+static void test_sync_stress_fence_queue(void)
+{
+	pthread_t thread_arr[STRESS_CONSUMER_THREADS];
+	struct timespec start = {};
+	uintptr_t thread_ret = 0;
+	uint32_t seqno = 0;
+	uint64_t ns;
+	int timeline;
+	int i, ret;
+
+	memset(&stress_queue, 0, sizeof(stress_queue));
+	timeline = sw_sync_timeline_create();
+
+	for (i = 0; i < STRESS_CONSUMER_THREADS; i++) {
+		ret = pthread_create(&thread_arr[i], NULL,
+				     test_fence_queue_consumer_thread, NULL);
+		igt_assert_eq(ret, 0);
+	}
+
+	igt_nsec_elapsed(&start);
+
+	while (seqno < STRESS_QUEUE_FENCES) {
+		int batch[STRESS_QUEUE_BATCH];
+
+		sw_sync_timeline_create_fence_array(timeline, seqno + 1,
+						    batch, STRESS_QUEUE_BATCH);
+
+		for (i = 0; i < STRESS_QUEUE_BATCH; i++) {
+			uint32_t h = stress_queue.head;
+
+			/* A claimed ticket counts as consumed: the slot was
+			 * read before the claim became visible.
+			 */
+			while (h - __atomic_load_n(&stress_queue.tail,
+						   __ATOMIC_ACQUIRE) >=
+			       STRESS_QUEUE_DEPTH)
+				;
+
+			stress_queue.fences[h % STRESS_QUEUE_DEPTH] = batch[i];
+			__atomic_store_n(&stress_queue.head, h + 1,
+					 __ATOMIC_RELEASE);
+		}
+
+		/* One ioctl signals the whole batch */
+		sw_sync_timeline_inc(timeline, STRESS_QUEUE_BATCH);
+		seqno += STRESS_QUEUE_BATCH;
+	}
+
+	__atomic_store_n(&stress_queue.done, true, __ATOMIC_RELEASE);
+
+	for (i = 0; i < STRESS_CONSUMER_THREADS; i++) {
+		uintptr_t local_thread_ret;
+		pthread_join(thread_arr[i], (void **)&local_thread_ret);
+		thread_ret |= local_thread_ret;
+	}
+
+	ns = igt_nsec_elapsed(&start);
+	igt_info("%d fences created, signaled and waited through %d consumers in %.1fms (%.2f Mfence/s)\n",
+		 STRESS_QUEUE_FENCES, STRESS_CONSUMER_THREADS,
+		 ns * 1e-6, STRESS_QUEUE_FENCES * 1e3 / ns);
+
+	close(timeline);
+
+	igt_assert_f(thread_ret == 0, "A consumer thread reported failure.\n");
+}
+
 static void test_sync_random_merge(void)
 {
 	int i, size;
@@ -896,6 +1046,9 @@ igt_main
 	igt_subtest("timeline_closed_signaled")
 		test_timeline_closed_signaled();
 
+	igt_subtest("alloc_fence_array")
+		test_alloc_fence_array();
+
 	igt_subtest("alloc_merge_fence")
 		test_alloc_merge_fence();
 
@@ -929,6 +1082,9 @@ igt_main
 	igt_subtest("sync_multi_producer_single_consumer")
 		test_sync_multi_producer_single_consumer();
 
+	igt_subtest("sync_stress_fence_queue")
+		test_sync_stress_fence_queue();
+
 	igt_subtest("sync_expired_merge")
 		test_sync_expired_merge();
 
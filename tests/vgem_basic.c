@@ -221,6 +221,37 @@ static void test_dmabuf_fence(int fd)
 	gem_close(fd, bo.handle);
 }
 
+static void test_dmabuf_fence_batch(int fd)
+{
+	struct vgem_bo bo[64];
+	uint32_t fence[64];
+	int dmabuf[64];
+	int i;
+
+	for (i = 0; i < 64; i++) {
+		bo[i].width = 1024;
+		bo[i].height = 1;
+		bo[i].bpp = 32;
+		vgem_create(fd, &bo[i]);
+		dmabuf[i] = prime_handle_to_fd(fd, bo[i].handle);
+	}
+
+	vgem_fence_attach_array(fd, bo, 64, VGEM_FENCE_WRITE, fence);
+	for (i = 0; i < 64; i++)
+		igt_assert(prime_busy(dmabuf[i], false));
+	igt_assert_eq(vgem_prime_poll_array(dmabuf, 64, POLLIN, 0), 0);
+
+	vgem_fence_signal_array(fd, fence, 64);
+	igt_assert_eq(vgem_prime_poll_array(dmabuf, 64, POLLIN, -1), 64);
+	for (i = 0; i < 64; i++)
+		igt_assert(!prime_busy(dmabuf[i], false));
+
+	for (i = 0; i < 64; i++) {
+		close(dmabuf[i]);
+		gem_close(fd, bo[i].handle);
+	}
+}
+
 static void test_dmabuf_fence_before(int fd)
 {
 	struct vgem_bo bo;
@@ -441,6 +472,8 @@ igt_main
 				test_dmabuf_fence(fd);
 			igt_subtest("dmabuf-fence-before")
 				test_dmabuf_fence_before(fd);
+			igt_subtest("dmabuf-fence-batch")
+				test_dmabuf_fence_batch(fd);
 		}
 	}
 
@@ -38,6 +38,8 @@
 #include <errno.h>
 #include <sys/mman.h>
 #include <dlfcn.h>
+#include <pthread.h>
+#include <zlib.h>
 #include <i915_drm.h>
 
 #include "intel_aub.h"
@@ -56,11 +58,25 @@ static int (*libc_ioctl)(int fd, unsigned long request, ...) = ioctl_init_helper
 static int drm_fd = -1;
 static char *filename = NULL;
 static FILE *files[2] = { NULL, NULL };
+static gzFile gzfile = NULL;
 static int gen = 0;
 static int verbose = 0;
+static int compress_output = 0;
 static bool device_override;
 static uint32_t device;
 
+/* Capture filters: by default every execbuffer and every referenced BO
+ * goes into the trace. Filtered-out batches are executed but not dumped;
+ * BOs over the size limit keep their place in the GTT but their contents
+ * are written as zeroes.
+ */
+static uint32_t filter_ctx = ~0u;
+static int filter_ring = -1;
+static uint64_t max_bo_size = 0;		/* 0 = unlimited */
+static uint64_t batch_first = 0;
+static uint64_t batch_count = ~0ull;
+static uint64_t batch_index = 0;
+
 #define MAX_BO_COUNT 64 * 1024
 
 struct bo {
@@ -140,30 +156,194 @@ align_u64(uint64_t v, uint64_t a)
 }
 
 static void
-dword_out(uint32_t data)
+sync_out(const void *data, size_t size)
 {
+	if (size == 0)
+		return;
+
+	if (gzfile != NULL)
+		fail_if(gzwrite(gzfile, data, size) != (int) size,
+			"Writing to compressed output failed\n");
+
 	for (int i = 0; i < ARRAY_SIZE (files); i++) {
 		if (files[i] == NULL)
 			continue;
 
-		fail_if(fwrite(&data, 1, 4, files[i]) == 0,
+		fail_if(fwrite(data, 1, size, files[i]) == 0,
 			"Writing to output failed\n");
 	}
 }
 
 static void
-data_out(const void *data, size_t size)
+sync_flush(void)
 {
-	if (size == 0)
-		return;
+	if (gzfile != NULL)
+		gzflush(gzfile, Z_SYNC_FLUSH);
 
-	for (int i = 0; i < ARRAY_SIZE (files); i++) {
-		if (files[i] == NULL)
+	for (int i = 0; i < ARRAY_SIZE(files); i++) {
+		if (files[i] != NULL)
+			fflush(files[i]);
+	}
+}
+
+/* The AUB stream used to be written (and compressed, when enabled) from
+ * inside the intercepted execbuffer call, stalling the application for
+ * the disk on every batch. Instead the dump path now memcpys into chunks
+ * and publishes them through a lock-free single-producer ring to a
+ * background thread which owns the output files; a chunk carrying the
+ * barrier flag makes the writer flush the streams, giving the trace a
+ * batch-granular consistency point should the application crash.
+ */
+#define WRITER_CHUNK_SIZE (256 * 1024)
+#define WRITER_RING_DEPTH 64
+
+struct output_chunk {
+	uint32_t len;
+	bool barrier;
+	uint8_t data[WRITER_CHUNK_SIZE];
+};
+
+static struct {
+	struct output_chunk *ring[WRITER_RING_DEPTH];
+	uint32_t head;
+	uint32_t tail;
+	struct output_chunk *current;
+	pthread_t thread;
+	pthread_mutex_t wake_lock;
+	pthread_cond_t wake;
+	bool started;
+	bool exit;
+} writer = {
+	.wake_lock = PTHREAD_MUTEX_INITIALIZER,
+	.wake = PTHREAD_COND_INITIALIZER,
+};
+
+static void *
+writer_thread(void *arg)
+{
+	for (;;) {
+		uint32_t t = writer.tail;
+		struct output_chunk *chunk;
+
+		if (t == __atomic_load_n(&writer.head, __ATOMIC_ACQUIRE)) {
+			pthread_mutex_lock(&writer.wake_lock);
+			while (t == __atomic_load_n(&writer.head,
+						    __ATOMIC_ACQUIRE) &&
+			       !writer.exit)
+				pthread_cond_wait(&writer.wake,
+						  &writer.wake_lock);
+			pthread_mutex_unlock(&writer.wake_lock);
+
+			if (t == __atomic_load_n(&writer.head,
+						 __ATOMIC_ACQUIRE))
+				break;
 			continue;
+		}
 
-		fail_if(fwrite(data, 1, size, files[i]) == 0,
-			"Writing to output failed\n");
+		chunk = writer.ring[t % WRITER_RING_DEPTH];
+		__atomic_store_n(&writer.tail, t + 1, __ATOMIC_RELEASE);
+
+		sync_out(chunk->data, chunk->len);
+		if (chunk->barrier)
+			sync_flush();
+
+		free(chunk);
 	}
+
+	return NULL;
+}
+
+static void
+writer_publish(struct output_chunk *chunk)
+{
+	uint32_t h = writer.head;
+
+	/* If the application outruns the disk someone has to block, and
+	 * the ring bounds how much trace data only exists in memory.
+	 */
+	while (h - __atomic_load_n(&writer.tail, __ATOMIC_ACQUIRE) >=
+	       WRITER_RING_DEPTH)
+		;
+
+	writer.ring[h % WRITER_RING_DEPTH] = chunk;
+	__atomic_store_n(&writer.head, h + 1, __ATOMIC_RELEASE);
+
+	pthread_mutex_lock(&writer.wake_lock);
+	pthread_cond_signal(&writer.wake);
+	pthread_mutex_unlock(&writer.wake_lock);
+}
+
+static struct output_chunk *
+writer_current_chunk(void)
+{
+	if (writer.current == NULL) {
+		writer.current = malloc(sizeof(*writer.current));
+		fail_if(writer.current == NULL, "intel_aubdump: out of memory\n");
+		writer.current->len = 0;
+		writer.current->barrier = false;
+	}
+
+	return writer.current;
+}
+
+static void
+writer_append(const void *data, size_t size)
+{
+	const uint8_t *p = data;
+
+	if (!writer.started) {
+		sync_out(data, size);
+		return;
+	}
+
+	while (size > 0) {
+		struct output_chunk *chunk = writer_current_chunk();
+		size_t n = sizeof(chunk->data) - chunk->len;
+
+		if (n > size)
+			n = size;
+
+		memcpy(chunk->data + chunk->len, p, n);
+		chunk->len += n;
+		p += n;
+		size -= n;
+
+		if (chunk->len == sizeof(chunk->data)) {
+			writer_publish(chunk);
+			writer.current = NULL;
+		}
+	}
+}
+
+static void
+writer_flush(void)
+{
+	struct output_chunk *chunk;
+
+	if (!writer.started) {
+		sync_flush();
+		return;
+	}
+
+	chunk = writer_current_chunk();
+	chunk->barrier = true;
+	writer_publish(chunk);
+	writer.current = NULL;
+}
+
+static void
+dword_out(uint32_t data)
+{
+	writer_append(&data, 4);
+}
+
+static void
+data_out(const void *data, size_t size)
+{
+	if (size == 0)
+		return;
+
+	writer_append(data, size);
 }
 
 static uint32_t
@@ -396,6 +576,64 @@ gem_get_param(int fd, uint32_t param)
 	return value;
 }
 
+static void
+parse_ring_filter(const char *value)
+{
+	static const struct {
+		const char *name;
+		int ring;
+	} rings[] = {
+		{ "render", I915_EXEC_RENDER },
+		{ "bsd", I915_EXEC_BSD },
+		{ "blt", I915_EXEC_BLT },
+		{ "vebox", I915_EXEC_VEBOX },
+	};
+
+	for (int i = 0; i < ARRAY_SIZE(rings); i++) {
+		if (!strcmp(value, rings[i].name)) {
+			filter_ring = rings[i].ring;
+			return;
+		}
+	}
+
+	fail_if(sscanf(value, "%i", &filter_ring) != 1,
+		"intel_aubdump: unknown ring '%s'\n", value);
+}
+
+static void
+parse_batch_window(const char *value)
+{
+	if (sscanf(value, "%"SCNu64":%"SCNu64, &batch_first, &batch_count) == 1)
+		batch_count = ~0ull;
+}
+
+static bool
+should_capture(const struct drm_i915_gem_execbuffer2 *execbuffer2)
+{
+	uint64_t n;
+
+	if (filter_ctx != ~0u &&
+	    (uint32_t) execbuffer2->rsvd1 != filter_ctx)
+		return false;
+
+	if (filter_ring != -1 &&
+	    (execbuffer2->flags & I915_EXEC_RING_MASK) != filter_ring)
+		return false;
+
+	/* The window counts only batches that passed the other filters, so
+	 * "context 2, batches 100:50" means that context's batches.
+	 */
+	n = batch_index++;
+
+	return n >= batch_first && n - batch_first < batch_count;
+}
+
+static bool
+bo_content_filtered(const struct bo *bo, const struct bo *batch_bo)
+{
+	return max_bo_size && bo != batch_bo && bo->size > max_bo_size;
+}
+
 static void
 dump_execbuffer2(int fd, struct drm_i915_gem_execbuffer2 *execbuffer2)
 {
@@ -422,6 +660,7 @@ dump_execbuffer2(int fd, struct drm_i915_gem_execbuffer2 *execbuffer2)
 			       filename, device, gen);
 	}
 
+	batch_bo = get_bo(exec_objects[execbuffer2->buffer_count - 1].handle);
 	for (uint32_t i = 0; i < execbuffer2->buffer_count; i++) {
 		obj = &exec_objects[i];
 		bo = get_bo(obj->handle);
@@ -433,16 +672,31 @@ dump_execbuffer2(int fd, struct drm_i915_gem_execbuffer2 *execbuffer2)
 			offset = align_u32(offset + bo->size + 4095, 4096);
 		}
 
+		/* Filtered BO contents are written as zeroes, so the mmap
+		 * (and the pages it would fault in) can be skipped too.
+		 */
+		if (bo_content_filtered(bo, batch_bo))
+			continue;
+
 		if (bo->map == NULL && bo->size > 0)
 			bo->map = gem_mmap(fd, obj->handle, 0, bo->size);
 		fail_if(bo->map == MAP_FAILED, "intel_aubdump: bo mmap failed\n");
 	}
 
-	batch_bo = get_bo(exec_objects[execbuffer2->buffer_count - 1].handle);
 	for (uint32_t i = 0; i < execbuffer2->buffer_count; i++) {
 		obj = &exec_objects[i];
 		bo = get_bo(obj->handle);
 
+		/* An oversized BO keeps its slot in the GTT so nothing else
+		 * moves, but its contents are dumped as zeroes. The batch
+		 * itself is never filtered, or the trace would be useless.
+		 */
+		if (bo_content_filtered(bo, batch_bo)) {
+			aub_write_trace_block(AUB_TRACE_TYPE_NOTYPE,
+					      NULL, bo->size, bo->offset);
+			continue;
+		}
+
 		if (obj->relocation_count > 0)
 			data = relocate_bo(bo, execbuffer2, obj);
 		else
@@ -463,10 +717,10 @@ dump_execbuffer2(int fd, struct drm_i915_gem_execbuffer2 *execbuffer2)
 	aub_dump_ringbuffer(batch_bo->offset + execbuffer2->batch_start_offset,
 			    offset, ring_flag);
 
-	for (int i = 0; i < ARRAY_SIZE(files); i++) {
-		if (files[i] != NULL)
-			fflush(files[i]);
-	}
+	/* Batch-granular barrier: the writer thread flushes the streams
+	 * once everything up to and including this batch has been written.
+	 */
+	writer_flush();
 }
 
 static void
@@ -556,10 +810,23 @@ maybe_init(void)
 			device_override = true;
 		} else if (!strcmp(key, "file")) {
 			filename = strdup(value);
-			files[0] = fopen(filename, "w+");
-			fail_if(files[0] == NULL,
-				"intel_aubdump: failed to open file '%s'\n",
-				filename);
+		} else if (!strcmp(key, "compress")) {
+			compress_output = 1;
+		} else if (!strcmp(key, "filter-ctx")) {
+			char *end;
+
+			filter_ctx = strtoul(value, &end, 0);
+			fail_if(*value == '\0' || *end != '\0',
+				"intel_aubdump: failed to parse context id '%s'",
+				value);
+		} else if (!strcmp(key, "filter-ring")) {
+			parse_ring_filter(value);
+		} else if (!strcmp(key, "batch-window")) {
+			parse_batch_window(value);
+		} else if (!strcmp(key, "max-bo-size")) {
+			fail_if(sscanf(value, "%"SCNu64, &max_bo_size) != 1,
+				"intel_aubdump: failed to parse size '%s'",
+				value);
 		} else if (!strcmp(key,  "command")) {
 			files[1] = launch_command(value);
 			fail_if(files[1] == NULL,
@@ -574,6 +841,28 @@ maybe_init(void)
 	}
 	fclose(config);
 
+	/* The file is opened once all the options are in, since compression
+	 * changes how (not where) it is written.
+	 */
+	if (filename != NULL) {
+		if (compress_output) {
+			gzfile = gzopen(filename, "w");
+			fail_if(gzfile == NULL,
+				"intel_aubdump: failed to open file '%s'\n",
+				filename);
+		} else {
+			files[0] = fopen(filename, "w+");
+			fail_if(files[0] == NULL,
+				"intel_aubdump: failed to open file '%s'\n",
+				filename);
+		}
+	}
+
+	if (gzfile != NULL || files[0] != NULL || files[1] != NULL)
+		writer.started =
+			pthread_create(&writer.thread, NULL,
+				       writer_thread, NULL) == 0;
+
 	bos = calloc(MAX_BO_COUNT, sizeof(bos[0]));
 	fail_if(bos == NULL, "intel_aubdump: out of memory\n");
 }
@@ -634,7 +923,8 @@ ioctl(int fd, unsigned long request, ...)
 
 		case DRM_IOCTL_I915_GEM_EXECBUFFER2:
 		case DRM_IOCTL_I915_GEM_EXECBUFFER2_WR: {
-			dump_execbuffer2(fd, argp);
+			if (should_capture(argp))
+				dump_execbuffer2(fd, argp);
 			if (device_override)
 				return 0;
 
@@ -735,7 +1025,23 @@ ioctl_init_helper(int fd, unsigned long request, ...)
 static void __attribute__ ((destructor))
 fini(void)
 {
+	if (writer.started) {
+		/* Push out any partial chunk, then let the writer drain
+		 * the ring before the files are closed under it.
+		 */
+		writer_flush();
+
+		pthread_mutex_lock(&writer.wake_lock);
+		writer.exit = true;
+		pthread_cond_signal(&writer.wake);
+		pthread_mutex_unlock(&writer.wake_lock);
+
+		pthread_join(writer.thread, NULL);
+	}
+
 	free(filename);
+	if (gzfile != NULL)
+		gzclose(gzfile);
 	for (int i = 0; i < ARRAY_SIZE(files); i++) {
 		if (files[i] != NULL)
 			fclose(files[i]);
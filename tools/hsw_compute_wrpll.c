@@ -25,6 +25,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "intel_io.h"
 #include "drmtest.h"
@@ -632,17 +633,104 @@ static const struct wrpll_tmds_clock wrpll_tmds_clock_table[] = {
 	{298000000,	2,	21,	19},
 };
 
-int main(void)
+/* Interpolation-free binary search over the sorted table above. Hits
+ * resolve a clock in a handful of compares; anything off-table reports a
+ * miss so the caller can fall back to the exhaustive search.
+ */
+static bool
+wrpll_lookup_rnp(int clock /* in Hz */,
+		 unsigned *r2_out, unsigned *n2_out, unsigned *p_out)
+{
+	int lo = 0, hi = ARRAY_SIZE(wrpll_tmds_clock_table) - 1;
+
+	while (lo <= hi) {
+		int mid = lo + (hi - lo) / 2;
+		const struct wrpll_tmds_clock *e = &wrpll_tmds_clock_table[mid];
+
+		if (e->clock < clock) {
+			lo = mid + 1;
+		} else if (e->clock > clock) {
+			hi = mid - 1;
+		} else {
+			*r2_out = e->r2;
+			*n2_out = e->n2;
+			*p_out = e->p;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void
+wrpll_get_rnp(int clock /* in Hz */,
+	      unsigned *r2_out, unsigned *n2_out, unsigned *p_out)
+{
+	if (!wrpll_lookup_rnp(clock, r2_out, n2_out, p_out))
+		wrpll_compute_rnp(clock, r2_out, n2_out, p_out);
+}
+
+/* Re-emit the table source from the exhaustive search, for when the PLL
+ * constraints or the standard clock list change.
+ */
+static void wrpll_generate_table(void)
+{
+	int i;
+
+	printf("static const struct wrpll_tmds_clock wrpll_tmds_clock_table[] = {\n");
+	for (i = 0; i < ARRAY_SIZE(wrpll_tmds_clock_table); i++) {
+		int clock = wrpll_tmds_clock_table[i].clock;
+		unsigned r2, n2, p;
+
+		wrpll_compute_rnp(clock, &r2, &n2, &p);
+		printf("\t{%d,\t%u,\t%u,\t%u},\n", clock, p, n2, r2);
+	}
+	printf("};\n");
+}
+
+int main(int argc, char *argv[])
 {
 	int i;
 
+	if (argc == 2 && strcmp(argv[1], "-g") == 0) {
+		wrpll_generate_table();
+		return 0;
+	}
+
 	for (i = 0; i < ARRAY_SIZE(wrpll_tmds_clock_table); i++) {
 		const struct wrpll_tmds_clock *ref = &wrpll_tmds_clock_table[i];
 		unsigned r2, n2, p;
 
+		igt_fail_on_f(i &&
+			      wrpll_tmds_clock_table[i - 1].clock >= ref->clock,
+			      "Table not sorted at %u Hz\n", ref->clock);
+
 		wrpll_compute_rnp(ref->clock, &r2, &n2, &p);
 		igt_fail_on_f(ref->r2 != r2 || ref->n2 != n2 || ref->p != p,
 			      "Computed value differs for %"PRId64" Hz:\n""  Reference: (%u,%u,%u)\n""  Computed:  (%u,%u,%u)\n", (int64_t)ref->clock * 1000, ref->r2, ref->n2, ref->p, r2, n2, p);
+
+		igt_fail_on_f(!wrpll_lookup_rnp(ref->clock, &r2, &n2, &p) ||
+			      ref->r2 != r2 || ref->n2 != n2 || ref->p != p,
+			      "Lookup missed or differs for %u Hz\n",
+			      ref->clock);
+	}
+
+	/* Off-table clocks must fall back to the exhaustive search. */
+	for (i = 0; i < ARRAY_SIZE(wrpll_tmds_clock_table) - 1; i++) {
+		int clock = (wrpll_tmds_clock_table[i].clock +
+			     wrpll_tmds_clock_table[i + 1].clock) / 2;
+		unsigned r2, n2, p, ref_r2, ref_n2, ref_p;
+
+		if (clock == wrpll_tmds_clock_table[i].clock)
+			continue;
+
+		igt_fail_on_f(wrpll_lookup_rnp(clock, &r2, &n2, &p),
+			      "Lookup hit for off-table %u Hz\n", clock);
+
+		wrpll_get_rnp(clock, &r2, &n2, &p);
+		wrpll_compute_rnp(clock, &ref_r2, &ref_n2, &ref_p);
+		igt_fail_on_f(r2 != ref_r2 || n2 != ref_n2 || p != ref_p,
+			      "Fallback differs for %u Hz\n", clock);
 	}
 
 	return 0;
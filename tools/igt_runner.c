@@ -0,0 +1,393 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Native parallel test runner.
+ *
+ * Consumes the test lists generated in tests/ (test-list.txt and friends),
+ * schedules the binaries across a configurable number of worker slots with a
+ * per-test timeout and streams the results as they come in. Compared to
+ * driving the suite through piglit this removes the python process-spawn
+ * overhead per test, which dominates the runtime of short tests.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <libgen.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "igt_core.h"
+
+struct test {
+	char *name;
+	const char *result;
+	double elapsed;
+};
+
+struct slot {
+	pid_t pid;
+	int test;		/* index into tests[], -1 when idle */
+	struct timespec start;
+	double deadline;
+};
+
+static struct test *tests;
+static int num_tests;
+
+static struct slot *slots;
+static int num_slots;
+
+static const char *test_root = ".";
+static const char *results_dir;
+static double test_timeout = 600.0;
+static bool list_only;
+
+static int passed, failed, skipped, timed_out;
+
+static double elapsed(const struct timespec *then)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - then->tv_sec) +
+		(now.tv_nsec - then->tv_nsec) * 1e-9;
+}
+
+static void load_test_list(const char *path)
+{
+	char *buf, *tok, *saveptr = NULL;
+	long size;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "Could not open test list %s: %s\n",
+			path, strerror(errno));
+		exit(1);
+	}
+
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	buf = malloc(size + 1);
+	if (!buf || fread(buf, 1, size, f) != size) {
+		fprintf(stderr, "Could not read test list %s\n", path);
+		exit(1);
+	}
+	buf[size] = '\0';
+	fclose(f);
+
+	for (tok = strtok_r(buf, " \t\r\n", &saveptr);
+	     tok;
+	     tok = strtok_r(NULL, " \t\r\n", &saveptr)) {
+		if (!strcmp(tok, "TESTLIST") || !strcmp(tok, "END"))
+			continue;
+
+		tests = realloc(tests, (num_tests + 1) * sizeof(*tests));
+		if (!tests) {
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+		tests[num_tests].name = strdup(tok);
+		tests[num_tests].result = NULL;
+		tests[num_tests].elapsed = 0.0;
+		num_tests++;
+	}
+
+	free(buf);
+}
+
+static int open_test_log(const char *name)
+{
+	char path[4096];
+	int fd;
+
+	if (!results_dir)
+		return open("/dev/null", O_WRONLY);
+
+	snprintf(path, sizeof(path), "%s/%s.log", results_dir, name);
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd == -1)
+		fd = open("/dev/null", O_WRONLY);
+
+	return fd;
+}
+
+static void spawn_test(struct slot *slot, int test)
+{
+	char binary[4096];
+	pid_t pid;
+	int log_fd;
+
+	snprintf(binary, sizeof(binary), "%s/%s",
+		 test_root, tests[test].name);
+
+	log_fd = open_test_log(tests[test].name);
+
+	fflush(NULL);
+	switch (pid = fork()) {
+	case -1:
+		fprintf(stderr, "fork: %s\n", strerror(errno));
+		exit(1);
+	case 0:
+		/* own process group, so a timeout can kill all children */
+		setpgid(0, 0);
+
+		if (log_fd != -1) {
+			dup2(log_fd, STDOUT_FILENO);
+			dup2(log_fd, STDERR_FILENO);
+			close(log_fd);
+		}
+
+		setenv("IGT_PLAIN_OUTPUT", "1", 1);
+		execl(binary, binary, (char *)NULL);
+
+		/* map a missing binary onto the "not run" exit code */
+		exit(IGT_EXIT_INVALID);
+	}
+
+	close(log_fd);
+
+	slot->pid = pid;
+	slot->test = test;
+	slot->deadline = test_timeout;
+	clock_gettime(CLOCK_MONOTONIC, &slot->start);
+}
+
+static void report_result(const struct test *test, int done)
+{
+	printf("[%d/%d] %s: %s (%.3fs)\n",
+	       done, num_tests, test->name, test->result, test->elapsed);
+	fflush(stdout);
+}
+
+static void finish_test(struct slot *slot, int status, int *done)
+{
+	struct test *test = &tests[slot->test];
+
+	test->elapsed = elapsed(&slot->start);
+
+	if (test->result) {
+		/* already marked, e.g. TIMEOUT */
+	} else if (WIFEXITED(status) && WEXITSTATUS(status) == IGT_EXIT_SUCCESS) {
+		test->result = "PASS";
+		passed++;
+	} else if (WIFEXITED(status) && WEXITSTATUS(status) == IGT_EXIT_SKIP) {
+		test->result = "SKIP";
+		skipped++;
+	} else if (WIFEXITED(status) && WEXITSTATUS(status) == IGT_EXIT_TIMEOUT) {
+		test->result = "TIMEOUT";
+		timed_out++;
+	} else if (WIFSIGNALED(status)) {
+		test->result = "CRASH";
+		failed++;
+	} else {
+		test->result = "FAIL";
+		failed++;
+	}
+
+	report_result(test, ++*done);
+
+	slot->pid = -1;
+	slot->test = -1;
+}
+
+static void check_timeouts(void)
+{
+	for (int i = 0; i < num_slots; i++) {
+		struct slot *slot = &slots[i];
+
+		if (slot->pid == -1 || elapsed(&slot->start) < slot->deadline)
+			continue;
+
+		tests[slot->test].result = "TIMEOUT";
+		timed_out++;
+
+		/* kill the whole process group, tests fork helpers */
+		kill(-slot->pid, SIGKILL);
+		kill(slot->pid, SIGKILL);
+	}
+}
+
+static void run_tests(void)
+{
+	int next = 0, done = 0, running = 0;
+
+	slots = calloc(num_slots, sizeof(*slots));
+	for (int i = 0; i < num_slots; i++)
+		slots[i].pid = slots[i].test = -1;
+
+	while (done < num_tests) {
+		int status;
+		pid_t pid;
+
+		while (running < num_slots && next < num_tests) {
+			for (int i = 0; i < num_slots; i++) {
+				if (slots[i].pid == -1) {
+					spawn_test(&slots[i], next++);
+					running++;
+					break;
+				}
+			}
+		}
+
+		pid = waitpid(-1, &status, WNOHANG);
+		if (pid == 0) {
+			check_timeouts();
+			usleep(20000);
+			continue;
+		}
+		if (pid == -1) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		for (int i = 0; i < num_slots; i++) {
+			if (slots[i].pid == pid) {
+				finish_test(&slots[i], status, &done);
+				running--;
+				break;
+			}
+		}
+	}
+}
+
+static void write_summary(void)
+{
+	char path[4096];
+	FILE *f;
+
+	if (!results_dir)
+		return;
+
+	snprintf(path, sizeof(path), "%s/results.txt", results_dir);
+	f = fopen(path, "w");
+	if (!f)
+		return;
+
+	for (int i = 0; i < num_tests; i++)
+		fprintf(f, "%s %s %.3f\n", tests[i].name,
+			tests[i].result ?: "NOTRUN", tests[i].elapsed);
+
+	fclose(f);
+}
+
+static void usage(FILE *out, const char *name)
+{
+	fprintf(out,
+		"Usage: %s [OPTIONS] <test-list.txt>\n"
+		"  -b <dir>      directory containing the test binaries\n"
+		"                (default: directory of the test list)\n"
+		"  -j <workers>  number of tests to run in parallel\n"
+		"                (default: number of online cpus)\n"
+		"  -t <seconds>  per-test timeout (default: 600)\n"
+		"  -o <dir>      store per-test logs and results.txt here\n"
+		"  -l            list the tests and exit\n"
+		"  -h            show this help\n",
+		name);
+}
+
+int main(int argc, char **argv)
+{
+	char *list_copy;
+	int c;
+
+	num_slots = sysconf(_SC_NPROCESSORS_ONLN);
+	test_root = NULL;
+
+	while ((c = getopt(argc, argv, "b:j:t:o:lh")) != -1) {
+		switch (c) {
+		case 'b':
+			test_root = optarg;
+			break;
+		case 'j':
+			num_slots = atoi(optarg);
+			break;
+		case 't':
+			test_timeout = atof(optarg);
+			break;
+		case 'o':
+			results_dir = optarg;
+			break;
+		case 'l':
+			list_only = true;
+			break;
+		case 'h':
+			usage(stdout, argv[0]);
+			return 0;
+		default:
+			usage(stderr, argv[0]);
+			return 1;
+		}
+	}
+
+	if (optind == argc) {
+		usage(stderr, argv[0]);
+		return 1;
+	}
+
+	if (num_slots < 1)
+		num_slots = 1;
+
+	load_test_list(argv[optind]);
+
+	if (!test_root) {
+		list_copy = strdup(argv[optind]);
+		test_root = strdup(dirname(list_copy));
+		free(list_copy);
+	}
+
+	if (list_only) {
+		for (int i = 0; i < num_tests; i++)
+			printf("%s\n", tests[i].name);
+		return 0;
+	}
+
+	if (results_dir && mkdir(results_dir, 0755) && errno != EEXIST) {
+		fprintf(stderr, "Could not create %s: %s\n",
+			results_dir, strerror(errno));
+		return 1;
+	}
+
+	run_tests();
+	write_summary();
+
+	printf("Totals: %d pass, %d skip, %d timeout, %d fail\n",
+	       passed, skipped, timed_out, failed);
+
+	return (failed || timed_out) ? 1 : 0;
+}
@@ -32,6 +32,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <err.h>
+#include <fcntl.h>
 #include <arpa/inet.h>
 #include "intel_io.h"
 #include "intel_reg.h"
@@ -40,6 +41,84 @@
 
 static uint32_t devid;
 
+/*
+ * The decoders below interleave forcewaked MMIO reads with hundreds of
+ * printfs, so a dump takes long enough for the audio state to change under
+ * us mid-dump. Instead of restructuring every decoder, capture the register
+ * values first: the dump function is run twice, once with output thrown away
+ * while every read is appended to a snapshot log, and then again with the
+ * reads replayed from the log. The reads happen back-to-back in the first
+ * pass, and both passes see identical values, so the printed state is
+ * consistent. The log is sequential rather than keyed by offset because
+ * some registers (EDID and DIP data windows) are read repeatedly with
+ * different results.
+ */
+static struct snapshot_reg {
+	uint32_t reg;
+	uint32_t val;
+} *snapshot;
+static int snapshot_count, snapshot_size, snapshot_replay = -1;
+
+static uint32_t snapshot_read(uint32_t reg)
+{
+	if (snapshot_replay >= 0) {
+		if (snapshot_replay < snapshot_count &&
+		    snapshot[snapshot_replay].reg == reg)
+			return snapshot[snapshot_replay++].val;
+		/* decode diverged from capture; shouldn't happen */
+		return INREG(reg);
+	}
+
+	if (snapshot_count == snapshot_size) {
+		snapshot_size = snapshot_size ? snapshot_size * 2 : 1024;
+		snapshot = realloc(snapshot,
+				   snapshot_size * sizeof(*snapshot));
+		if (!snapshot)
+			err(1, "realloc");
+	}
+
+	snapshot[snapshot_count].reg = reg;
+	snapshot[snapshot_count].val = INREG(reg);
+
+	return snapshot[snapshot_count++].val;
+}
+
+static void snapshot_write(uint32_t reg, uint32_t val)
+{
+	/* index register writes were already done during capture */
+	if (snapshot_replay >= 0)
+		return;
+
+	OUTREG(reg, val);
+}
+
+#define INREG(reg)		snapshot_read(reg)
+#define OUTREG(reg, val)	snapshot_write(reg, val)
+
+static void dump_all(void (*dump)(void))
+{
+	int saved, devnull;
+
+	/* Capture pass: reads hit the hardware, output goes to /dev/null. */
+	fflush(stdout);
+	saved = dup(STDOUT_FILENO);
+	devnull = open("/dev/null", O_WRONLY);
+	if (saved < 0 || devnull < 0)
+		err(1, "/dev/null");
+	dup2(devnull, STDOUT_FILENO);
+	close(devnull);
+
+	dump();
+
+	/* Replay pass: decode offline from the snapshot. */
+	fflush(stdout);
+	dup2(saved, STDOUT_FILENO);
+	close(saved);
+
+	snapshot_replay = 0;
+	dump();
+}
+
 static int aud_reg_base = 0;	/* base address of audio registers */
 static int disp_reg_base = 0;	/* base address of display registers */
 
@@ -2478,20 +2557,20 @@ int main(int argc, char **argv)
 
 	printf("%s audio registers:\n\n", intel_get_device_info(devid)->codename);
 	if (IS_VALLEYVIEW(devid)) {
-		dump_ironlake();
+		dump_all(dump_ironlake);
 	} else if (IS_CHERRYVIEW(devid)) {
-		dump_braswell();
+		dump_all(dump_braswell);
 	}  else if (IS_GEN9(devid)
 		|| IS_BROADWELL(devid) || IS_HASWELL(devid)) {
-		dump_hsw_plus();
+		dump_all(dump_hsw_plus);
 	} else if (IS_GEN6(devid) || IS_GEN7(devid)
 		|| getenv("HAS_PCH_SPLIT")) {
 		intel_check_pch();
-		dump_cpt();
+		dump_all(dump_cpt);
 	} else if (IS_GEN5(devid)) {
-		dump_ironlake();
+		dump_all(dump_ironlake);
 	} else if (IS_G4X(devid)) {
-		dump_eaglelake();
+		dump_all(dump_eaglelake);
 	}
 
 	return 0;
@@ -29,6 +29,10 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/timerfd.h>
 
 #include "intel_io.h"
 #include "intel_chipset.h"
@@ -36,25 +40,181 @@
 
 /* XXX PCH only today */
 
+#define NSEC_PER_SEC 1000000000ULL
+
+static uint32_t backlight_max;
+
+static uint32_t get_backlight(void)
+{
+	return INREG(BLC_PWM_CPU_CTL) & BACKLIGHT_DUTY_CYCLE_MASK;
+}
+
+static void set_backlight(uint32_t v)
+{
+	if (v > backlight_max)
+		v = backlight_max;
+	OUTREG(BLC_PWM_CPU_CTL,
+	       (INREG(BLC_PWM_CPU_CTL) &~ BACKLIGHT_DUTY_CYCLE_MASK) | v);
+	(void) INREG(BLC_PWM_CPU_CTL);
+}
+
+enum easing {
+	EASE_LINEAR,
+	EASE_SMOOTH,
+	EASE_CUBIC,
+};
+
+static double ease(enum easing curve, double t)
+{
+	switch (curve) {
+	case EASE_SMOOTH:
+		return t * t * (3.0 - 2.0 * t);
+	case EASE_CUBIC:
+		if (t < 0.5)
+			return 4.0 * t * t * t;
+		t = 2.0 * t - 2.0;
+		return 1.0 + t * t * t / 2.0;
+	case EASE_LINEAR:
+	default:
+		return t;
+	}
+}
+
+static uint64_t gettime_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/*
+ * One process performs the whole ramp: the register mapping stays open
+ * and a timerfd paces the steps, instead of the caller execing us once
+ * per step. The brightness is recomputed from elapsed wall time on each
+ * tick, so coalesced or missed ticks skip straight to the right value
+ * rather than stretching the ramp.
+ */
+static void ramp_backlight(uint32_t from, uint32_t to, unsigned duration_ms,
+			   unsigned step_ms, enum easing curve)
+{
+	struct itimerspec its;
+	uint64_t start, duration_ns;
+	int timer_fd;
+
+	timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (timer_fd < 0) {
+		perror("timerfd_create");
+		exit(1);
+	}
+
+	memset(&its, 0, sizeof(its));
+	its.it_interval.tv_sec = step_ms / 1000;
+	its.it_interval.tv_nsec = (step_ms % 1000) * 1000000;
+	its.it_value = its.it_interval;
+	if (timerfd_settime(timer_fd, 0, &its, NULL) < 0) {
+		perror("timerfd_settime");
+		exit(1);
+	}
+
+	duration_ns = (uint64_t)duration_ms * 1000000;
+	start = gettime_ns();
+
+	set_backlight(from);
+
+	for (;;) {
+		uint64_t expirations, elapsed;
+		double t;
+
+		if (read(timer_fd, &expirations, sizeof(expirations)) < 0)
+			break;
+
+		elapsed = gettime_ns() - start;
+		if (elapsed >= duration_ns)
+			break;
+
+		t = ease(curve, (double)elapsed / duration_ns);
+		set_backlight(from + (int64_t)((double)to - from) * t);
+	}
+
+	set_backlight(to);
+	close(timer_fd);
+}
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [OPTION]... [percent]\n"
+	       "With a bare percentage, set the backlight and exit.\n"
+	       "  -r <percent>   ramp from the current value to <percent>\n"
+	       "  -d <ms>        ramp duration (default 500)\n"
+	       "  -s <ms>        ramp step period (default 16, one 60Hz frame)\n"
+	       "  -e <curve>     easing curve: linear, smooth or cubic\n"
+	       "  -h             print this help\n",
+	       name);
+}
+
 int main(int argc, char** argv)
 {
-	uint32_t current, max;
+	uint32_t current;
+	int ramp_target = -1;
+	unsigned duration_ms = 500;
+	unsigned step_ms = 16;
+	enum easing curve = EASE_LINEAR;
+	int c;
+
+	while ((c = getopt(argc, argv, "r:d:s:e:h")) != -1) {
+		switch (c) {
+		case 'r':
+			ramp_target = atoi(optarg);
+			break;
+		case 'd':
+			duration_ms = atoi(optarg);
+			break;
+		case 's':
+			step_ms = atoi(optarg);
+			if (step_ms == 0)
+				step_ms = 1;
+			break;
+		case 'e':
+			if (strcmp(optarg, "linear") == 0) {
+				curve = EASE_LINEAR;
+			} else if (strcmp(optarg, "smooth") == 0) {
+				curve = EASE_SMOOTH;
+			} else if (strcmp(optarg, "cubic") == 0) {
+				curve = EASE_CUBIC;
+			} else {
+				fprintf(stderr, "unknown easing curve '%s'\n",
+					optarg);
+				return 1;
+			}
+			break;
+		case 'h':
+		default:
+			usage(argv[0]);
+			return c == 'h' ? 0 : 1;
+		}
+	}
 
 	intel_mmio_use_pci_bar(intel_get_pci_device());
 
-	current = INREG(BLC_PWM_CPU_CTL) & BACKLIGHT_DUTY_CYCLE_MASK;
-	max = INREG(BLC_PWM_PCH_CTL2) >> 16;
+	current = get_backlight();
+	backlight_max = INREG(BLC_PWM_PCH_CTL2) >> 16;
 
-	printf ("current backlight value: %d%%\n", current * 100 / max);
+	printf("current backlight value: %d%%\n",
+	       current * 100 / backlight_max);
 
-	if (argc > 1) {
-		uint32_t v = atoi (argv[1]) * max / 100;
-		if (v > max)
-			v = max;
-		OUTREG(BLC_PWM_CPU_CTL,
-		       (INREG(BLC_PWM_CPU_CTL) &~ BACKLIGHT_DUTY_CYCLE_MASK) | v);
-		(void) INREG(BLC_PWM_CPU_CTL);
-		printf ("set backlight to %d%%\n", v * 100 / max);
+	if (ramp_target >= 0) {
+		uint32_t v = ramp_target * backlight_max / 100;
+		if (v > backlight_max)
+			v = backlight_max;
+		ramp_backlight(current, v, duration_ms, step_ms, curve);
+		printf("ramped backlight to %d%%\n", v * 100 / backlight_max);
+	} else if (optind < argc) {
+		uint32_t v = atoi(argv[optind]) * backlight_max / 100;
+		if (v > backlight_max)
+			v = backlight_max;
+		set_backlight(v);
+		printf("set backlight to %d%%\n", v * 100 / backlight_max);
 	}
 
 	return 0;
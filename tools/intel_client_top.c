@@ -0,0 +1,659 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/*
+ * intel_client_top - attribute GPU activity to individual DRM clients
+ *
+ * intel_gpu_top tells you how busy each engine is; this tool tells you
+ * who is keeping it busy. We listen to the i915.ko tracepoints (the
+ * same sampling scheme as overlay/gpu-perf.c): i915_gem_request_add
+ * gives us the submitting pid and engine for every request, and the
+ * wait_begin/wait_end pair gives us how long each client stalled on the
+ * GPU. The kernels this tool targets do not expose per-context busy
+ * counters, so request submission rate plus wait time is the best
+ * per-client attribution available without instrumenting the clients
+ * themselves.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <linux/perf_event.h>
+
+#if defined(__i386__)
+#define rmb()           asm volatile("lock; addl $0,0(%%esp)" ::: "memory")
+#define wmb()           asm volatile("lock; addl $0,0(%%esp)" ::: "memory")
+#endif
+
+#if defined(__x86_64__)
+#define rmb()           asm volatile("lfence" ::: "memory")
+#define wmb()           asm volatile("sfence" ::: "memory")
+#endif
+
+#define N_PAGES 32
+#define MAX_RINGS 16
+
+struct sample_event {
+	struct perf_event_header header;
+	uint32_t pid, tid;
+	uint64_t time;
+	uint64_t id;
+	uint32_t raw_size;
+	uint32_t raw_hdr0;
+	uint32_t raw_hdr1;
+	uint32_t raw[0];
+};
+
+enum {
+	DEVICE = 0,
+	CTX,
+	ENGINE,
+	CTX_SEQNO,
+	GLOBAL_SEQNO
+};
+
+struct client {
+	struct client *next;
+	char name[256];
+	pid_t pid;
+
+	/* accumulated since the last display interval */
+	uint64_t nr_requests[MAX_RINGS];
+	uint64_t total_requests;
+	uint64_t nr_sema;
+	uint64_t wait_time;
+};
+
+struct client_perf {
+	const char *error;
+	int page_size;
+	int nr_cpus;
+	int nr_events;
+	int *fd;
+	void **map;
+	struct client_perf_sample {
+		uint64_t id;
+		int (*func)(struct client_perf *, const void *);
+	} *sample;
+
+	struct client *clients;
+	struct client_wait {
+		struct client_wait *next;
+		struct client *client;
+		uint32_t context;
+		uint32_t seqno;
+		uint64_t time;
+	} *wait[MAX_RINGS];
+};
+
+enum sort_key {
+	SORT_REQUESTS,
+	SORT_WAIT,
+	SORT_SEMA,
+};
+
+enum stream_format {
+	STREAM_NONE,
+	STREAM_JSON,
+	STREAM_CSV,
+};
+
+static uint64_t tracepoint_id(const char *sys, const char *name)
+{
+	const char *tracefs[] = {
+		"/sys/kernel/debug/tracing",
+		"/sys/kernel/tracing",
+		NULL,
+	};
+	char buf[1024];
+	int fd = -1, n;
+
+	for (n = 0; fd < 0 && tracefs[n]; n++) {
+		snprintf(buf, sizeof(buf), "%s/events/%s/%s/id",
+			 tracefs[n], sys, name);
+		fd = open(buf, O_RDONLY);
+	}
+	if (fd < 0)
+		return 0;
+
+	n = read(fd, buf, sizeof(buf)-1);
+	close(fd);
+	if (n < 0)
+		return 0;
+
+	buf[n] = '\0';
+	return strtoull(buf, 0, 0);
+}
+
+static int perf_tracepoint_open(struct client_perf *cp,
+				const char *sys, const char *name,
+				int (*func)(struct client_perf *, const void *))
+{
+	struct perf_event_attr attr;
+	struct client_perf_sample *sample;
+	int n, *fd;
+
+	memset(&attr, 0, sizeof(attr));
+
+	attr.type = PERF_TYPE_TRACEPOINT;
+	attr.config = tracepoint_id(sys, name);
+	if (attr.config == 0)
+		return ENOENT;
+
+	attr.sample_period = 1;
+	attr.sample_type = (PERF_SAMPLE_TIME | PERF_SAMPLE_STREAM_ID | PERF_SAMPLE_TID | PERF_SAMPLE_RAW);
+	attr.read_format = PERF_FORMAT_ID;
+
+	attr.exclude_guest = 1;
+
+	n = cp->nr_cpus * (cp->nr_events+1);
+	fd = realloc(cp->fd, n*sizeof(int));
+	sample = realloc(cp->sample, n*sizeof(*cp->sample));
+	if (fd == NULL || sample == NULL)
+		return ENOMEM;
+	cp->fd = fd;
+	cp->sample = sample;
+
+	fd += cp->nr_events * cp->nr_cpus;
+	sample += cp->nr_events * cp->nr_cpus;
+	for (n = 0; n < cp->nr_cpus; n++) {
+		uint64_t track[2];
+
+		fd[n] = syscall(__NR_perf_event_open, &attr, -1, n, -1, 0);
+		if (fd[n] == -1)
+			return errno;
+
+		/* read back the event to establish id->tracepoint */
+		if (read(fd[n], track, sizeof(track)) < 0)
+			return errno;
+		sample[n].id = track[1];
+		sample[n].func = func;
+	}
+
+	cp->nr_events++;
+	return 0;
+}
+
+static int perf_mmap(struct client_perf *cp)
+{
+	int size = (1 + N_PAGES) * cp->page_size;
+	int *fd, i, j;
+
+	cp->map = malloc(sizeof(void *)*cp->nr_cpus);
+	if (cp->map == NULL)
+		return ENOMEM;
+
+	fd = cp->fd;
+	for (j = 0; j < cp->nr_cpus; j++) {
+		cp->map[j] = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, *fd++, 0);
+		if (cp->map[j] == (void *)-1)
+			goto err;
+	}
+
+	for (i = 1; i < cp->nr_events; i++) {
+		for (j = 0; j < cp->nr_cpus; j++)
+			ioctl(*fd++, PERF_EVENT_IOC_SET_OUTPUT, cp->fd[j]);
+	}
+
+	return 0;
+
+err:
+	while (--j > 0)
+		munmap(cp->map[j], size);
+	free(cp->map);
+	cp->map = NULL;
+	return EINVAL;
+}
+
+static int get_comm(pid_t pid, char *comm, int len)
+{
+	char filename[1024];
+	int fd;
+
+	*comm = '\0';
+	snprintf(filename, sizeof(filename), "/proc/%d/comm", pid);
+
+	fd = open(filename, O_RDONLY);
+	if (fd >= 0) {
+		len = read(fd, comm, len-1);
+		if (len >= 0)
+			comm[len-1] = '\0';
+		close(fd);
+	} else
+		len = -1;
+
+	return len;
+}
+
+static struct client *lookup_client(struct client_perf *cp, pid_t pid)
+{
+	struct client *client;
+
+	if (pid == 0)
+		return NULL;
+
+	for (client = cp->clients; client; client = client->next) {
+		if (client->pid == pid)
+			return client;
+	}
+
+	client = calloc(1, sizeof(*client));
+	if (client == NULL)
+		return NULL;
+
+	if (get_comm(pid, client->name, sizeof(client->name)) < 0)
+		strcpy(client->name, "<unknown>");
+
+	client->pid = pid;
+	client->next = cp->clients;
+	cp->clients = client;
+
+	return client;
+}
+
+static int request_add(struct client_perf *cp, const void *event)
+{
+	const struct sample_event *sample = event;
+	struct client *client;
+
+	client = lookup_client(cp, sample->pid);
+	if (client == NULL)
+		return 0;
+
+	client->nr_requests[sample->raw[ENGINE] & (MAX_RINGS-1)]++;
+	client->total_requests++;
+	return 1;
+}
+
+static int ring_sync(struct client_perf *cp, const void *event)
+{
+	const struct sample_event *sample = event;
+	struct client *client;
+
+	client = lookup_client(cp, sample->pid);
+	if (client == NULL)
+		return 0;
+
+	client->nr_sema++;
+	return 1;
+}
+
+static int wait_begin(struct client_perf *cp, const void *event)
+{
+	const struct sample_event *sample = event;
+	struct client *client;
+	struct client_wait *wait;
+
+	client = lookup_client(cp, sample->pid);
+	if (client == NULL)
+		return 0;
+
+	wait = malloc(sizeof(*wait));
+	if (wait == NULL)
+		return 0;
+
+	/* XXX argument order CTX == ENGINE! */
+
+	wait->client = client;
+	wait->context = sample->raw[ENGINE];
+	wait->seqno = sample->raw[CTX_SEQNO];
+	wait->time = sample->time;
+	wait->next = cp->wait[sample->raw[CTX] & (MAX_RINGS-1)];
+	cp->wait[sample->raw[CTX] & (MAX_RINGS-1)] = wait;
+
+	return 0;
+}
+
+static int wait_end(struct client_perf *cp, const void *event)
+{
+	const struct sample_event *sample = event;
+	struct client_wait *wait, **prev;
+
+	for (prev = &cp->wait[sample->raw[ENGINE] & (MAX_RINGS-1)];
+	     (wait = *prev) != NULL; prev = &wait->next) {
+		if (wait->context != sample->raw[CTX] ||
+		    wait->seqno != sample->raw[CTX_SEQNO])
+			continue;
+
+		wait->client->wait_time += sample->time - wait->time;
+
+		*prev = wait->next;
+		free(wait);
+		return 1;
+	}
+
+	return 0;
+}
+
+static void client_perf_init(struct client_perf *cp)
+{
+	memset(cp, 0, sizeof(*cp));
+	cp->nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	cp->page_size = getpagesize();
+
+	perf_tracepoint_open(cp, "i915", "i915_gem_request_add", request_add);
+	if (perf_tracepoint_open(cp, "i915", "i915_gem_request_wait_begin", wait_begin) == 0)
+		perf_tracepoint_open(cp, "i915", "i915_gem_request_wait_end", wait_end);
+	perf_tracepoint_open(cp, "i915", "i915_gem_ring_sync_to", ring_sync);
+
+	if (cp->nr_events == 0) {
+		cp->error = "i915.ko tracepoints not available";
+		return;
+	}
+
+	if (perf_mmap(cp))
+		cp->error = "failed to mmap perf event buffers";
+}
+
+static int process_sample(struct client_perf *cp, int cpu,
+			  const struct perf_event_header *header)
+{
+	const struct sample_event *sample = (const struct sample_event *)header;
+	int n, update = 0;
+
+	for (n = 0; n < cp->nr_events; n++) {
+		int m = n * cp->nr_cpus + cpu;
+		if (cp->sample[m].id != sample->id)
+			continue;
+
+		update = cp->sample[m].func(cp, sample);
+		break;
+	}
+
+	return update;
+}
+
+static int client_perf_update(struct client_perf *cp)
+{
+	const int size = N_PAGES * cp->page_size;
+	const int mask = size - 1;
+	uint8_t *buffer = NULL;
+	int buffer_size = 0;
+	int n, update = 0;
+
+	if (cp->map == NULL)
+		return 0;
+
+	for (n = 0; n < cp->nr_cpus; n++) {
+		struct perf_event_mmap_page *mmap = cp->map[n];
+		const uint8_t *data;
+		uint64_t head, tail;
+		int wrap = 0;
+
+		tail = mmap->data_tail;
+		head = mmap->data_head;
+		rmb();
+
+		if (head < tail) {
+			wrap = 1;
+			tail &= mask;
+			head &= mask;
+			head += size;
+		}
+
+		data = (uint8_t *)mmap + cp->page_size;
+		while (head - tail >= sizeof(struct perf_event_header)) {
+			const struct perf_event_header *header;
+
+			header = (const struct perf_event_header *)(data + (tail & mask));
+			if (header->size > head - tail)
+				break;
+
+			if ((const uint8_t *)header + header->size > data + size) {
+				int before;
+
+				if (header->size > buffer_size) {
+					uint8_t *b = realloc(buffer, header->size);
+					if (b == NULL)
+						break;
+
+					buffer = b;
+					buffer_size = header->size;
+				}
+
+				before = data + size - (const uint8_t *)header;
+
+				memcpy(buffer, header, before);
+				memcpy(buffer + before, data, header->size - before);
+
+				header = (struct perf_event_header *)buffer;
+			}
+
+			if (header->type == PERF_RECORD_SAMPLE)
+				update += process_sample(cp, n, header);
+			tail += header->size;
+		}
+
+		if (wrap)
+			tail &= mask;
+		mmap->data_tail = tail;
+		wmb();
+	}
+
+	free(buffer);
+	return update;
+}
+
+static enum sort_key sort_key = SORT_REQUESTS;
+
+static int client_cmp(const void *a, const void *b)
+{
+	const struct client *ca = *(const struct client * const *)a;
+	const struct client *cb = *(const struct client * const *)b;
+	uint64_t va, vb;
+
+	switch (sort_key) {
+	default:
+	case SORT_REQUESTS:
+		va = ca->total_requests;
+		vb = cb->total_requests;
+		break;
+	case SORT_WAIT:
+		va = ca->wait_time;
+		vb = cb->wait_time;
+		break;
+	case SORT_SEMA:
+		va = ca->nr_sema;
+		vb = cb->nr_sema;
+		break;
+	}
+
+	if (va < vb)
+		return 1;
+	if (va > vb)
+		return -1;
+	return 0;
+}
+
+static void client_reset(struct client *client)
+{
+	memset(client->nr_requests, 0, sizeof(client->nr_requests));
+	client->total_requests = 0;
+	client->nr_sema = 0;
+	client->wait_time = 0;
+}
+
+static void usage(const char *appname)
+{
+	printf("intel_client_top - per-DRM-client view of Intel GPU activity\n"
+	       "\n"
+	       "usage: %s [parameters]\n"
+	       "\n"
+	       "The following parameters apply:\n"
+	       "[-t <seconds>]       sample interval (default 1)\n"
+	       "[-k requests|wait|sema]  sort key (default requests)\n"
+	       "[-J]                 stream one JSON record per client per interval\n"
+	       "[-c]                 stream one CSV record per client per interval\n"
+	       "[-h]                 show this help screen\n"
+	       "\n",
+	       appname);
+}
+
+int main(int argc, char **argv)
+{
+	enum stream_format stream_format = STREAM_NONE;
+	struct client_perf cp;
+	double interval = 1;
+	double elapsed_time = 0;
+	int print_headers = 1;
+	int interactive = 1;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "t:k:Jch")) != -1) {
+		switch (ch) {
+		case 't': interval = atof(optarg);
+			if (interval <= 0) {
+				fprintf(stderr, "Error: interval must be positive\n");
+				exit(1);
+			}
+			break;
+		case 'k':
+			if (!strcmp(optarg, "requests"))
+				sort_key = SORT_REQUESTS;
+			else if (!strcmp(optarg, "wait"))
+				sort_key = SORT_WAIT;
+			else if (!strcmp(optarg, "sema"))
+				sort_key = SORT_SEMA;
+			else {
+				fprintf(stderr, "Error: unknown sort key '%s'\n", optarg);
+				exit(1);
+			}
+			break;
+		case 'J': stream_format = STREAM_JSON;
+			interactive = 0;
+			break;
+		case 'c': stream_format = STREAM_CSV;
+			interactive = 0;
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			fprintf(stderr, "Invalid flag %c!\n", (char)optopt);
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	client_perf_init(&cp);
+	if (cp.error) {
+		fprintf(stderr, "Error: %s\n", cp.error);
+		exit(1);
+	}
+
+	for (;;) {
+		char clear_screen[] = {0x1b, '[', 'H',
+				       0x1b, '[', 'J',
+				       0x0};
+		struct client **sorted, *client;
+		int n, count;
+
+		usleep(interval * 1000000);
+		elapsed_time += interval;
+
+		client_perf_update(&cp);
+
+		count = 0;
+		for (client = cp.clients; client; client = client->next)
+			count++;
+
+		sorted = malloc(count * sizeof(*sorted));
+		if (sorted == NULL)
+			continue;
+
+		count = 0;
+		for (client = cp.clients; client; client = client->next)
+			sorted[count++] = client;
+		qsort(sorted, count, sizeof(*sorted), client_cmp);
+
+		if (interactive) {
+			printf("%s", clear_screen);
+			printf("%8s %-20s %10s %10s %10s\n",
+			       "PID", "COMM", "requests/s", "sema/s", "wait-ms");
+			for (n = 0; n < count; n++) {
+				client = sorted[n];
+				if (!client->total_requests &&
+				    !client->nr_sema && !client->wait_time)
+					continue;
+				printf("%8d %-20.20s %10.1f %10.1f %10.3f\n",
+				       client->pid, client->name,
+				       client->total_requests / interval,
+				       client->nr_sema / interval,
+				       client->wait_time / 1e6);
+			}
+		} else if (stream_format == STREAM_CSV) {
+			if (print_headers) {
+				printf("time,pid,comm,requests,sema,wait-ns\n");
+				print_headers = 0;
+			}
+			for (n = 0; n < count; n++) {
+				client = sorted[n];
+				if (!client->total_requests &&
+				    !client->nr_sema && !client->wait_time)
+					continue;
+				printf("%.2f,%d,%s,%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+				       elapsed_time, client->pid, client->name,
+				       client->total_requests,
+				       client->nr_sema,
+				       client->wait_time);
+			}
+			fflush(stdout);
+		} else {
+			printf("{ \"time\": %.2f, \"clients\": [", elapsed_time);
+			for (n = 0; n < count; n++) {
+				client = sorted[n];
+				printf("%s { \"pid\": %d, \"comm\": \"%s\", "
+				       "\"requests\": %" PRIu64 ", "
+				       "\"sema\": %" PRIu64 ", "
+				       "\"wait-ns\": %" PRIu64 " }",
+				       n ? "," : "", client->pid, client->name,
+				       client->total_requests,
+				       client->nr_sema,
+				       client->wait_time);
+			}
+			printf(" ] }\n");
+			fflush(stdout);
+		}
+
+		for (n = 0; n < count; n++)
+			client_reset(sorted[n]);
+		free(sorted);
+	}
+
+	return 0;
+}
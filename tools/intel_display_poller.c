@@ -25,6 +25,7 @@
 #include <assert.h>
 #include <fcntl.h>
 #include <getopt.h>
+#include <inttypes.h>
 #include <unistd.h>
 #include <signal.h>
 #include <stdbool.h>
@@ -37,6 +38,7 @@
 #include "igt_debugfs.h"
 #include "drmtest.h"
 #include "igt_aux.h"
+#include "igt_stats.h"
 
 enum test {
 	TEST_INVALID,
@@ -954,15 +956,179 @@ static void __attribute__((noreturn)) usage(const char *name)
 		" -b,--bit <bit>\n"
 		" -l,--line <target scanline/pixel>\n"
 		" -f,--fuzz <target fuzz>\n"
-		" -x,--pixel\n",
+		" -x,--pixel\n"
+		" -d,--duration <seconds> (soak mode: accumulate histograms)\n",
 		name);
 	exit(1);
 }
 
+static void run_test(enum test test, uint32_t devid, int pipe, int bit,
+		     int target_scanline, int target_fuzz,
+		     bool test_pixelcount,
+		     uint32_t *min, uint32_t *max, const int count)
+{
+	switch (test) {
+	case TEST_PIPESTAT:
+		if (test_pixelcount)
+			poll_pixel_pipestat(pipe, bit, min, max, count);
+		else
+			poll_dsl_pipestat(pipe, bit, min, max, count);
+		break;
+	case TEST_IIR_GEN2:
+		assert(!test_pixelcount);
+		poll_dsl_iir_gen2(pipe, bit, min, max, count);
+		break;
+	case TEST_IIR_GEN3:
+		if (test_pixelcount)
+			poll_pixel_iir_gen3(pipe, bit, min, max, count);
+		else
+			poll_dsl_iir_gen3(pipe, bit, min, max, count);
+		break;
+	case TEST_DEIIR:
+		assert(!test_pixelcount);
+		poll_dsl_deiir(devid, pipe, bit, min, max, count);
+		break;
+	case TEST_FRAMECOUNT_GEN3:
+		if (test_pixelcount)
+			poll_pixel_framecount_gen3(pipe, min, max, count);
+		else
+			poll_dsl_framecount_gen3(pipe, min, max, count);
+		break;
+	case TEST_FRAMECOUNT_G4X:
+		assert(!test_pixelcount);
+		poll_dsl_framecount_g4x(pipe, min, max, count);
+		break;
+	case TEST_FLIPCOUNT:
+		assert(!test_pixelcount);
+		poll_dsl_flipcount_g4x(devid, pipe, min, max, count);
+		break;
+	case TEST_PAN:
+		if (test_pixelcount)
+			poll_pixel_pan(devid, pipe, target_scanline, target_fuzz,
+				       min, max, count);
+		else
+			poll_dsl_pan(devid, pipe, target_scanline, target_fuzz,
+				     min, max, count);
+		break;
+	case TEST_FLIP:
+		if (test_pixelcount)
+			poll_pixel_flip(devid, pipe, target_scanline, target_fuzz,
+					min, max, count);
+		else
+			poll_dsl_flip(devid, pipe, target_scanline, target_fuzz,
+				      min, max, count);
+		break;
+	case TEST_SURFLIVE:
+		poll_dsl_surflive(devid, pipe, min, max, count);
+		break;
+	case TEST_WRAP:
+		if (test_pixelcount)
+			poll_pixel_wrap(pipe, min, max, count);
+		else
+			poll_dsl_wrap(pipe, min, max, count);
+		break;
+	case TEST_FIELD:
+		poll_dsl_field(pipe, min, max, count);
+		break;
+	default:
+		assert(0);
+	}
+}
+
+/* Soak mode: histogram of the event window start/end positions, one pair
+ * of histograms per field. Bins, not samples, are stored, so hours-long
+ * runs use the same memory as a short one.
+ */
+static struct igt_histogram soak_min[2], soak_max[2];
+
+#define SOAK_REPORT_PERIOD_NS	(10ULL * NSEC_PER_SEC)
+
+static void soak_collect(uint32_t *min, uint32_t *max, const int count)
+{
+	int f, i;
+
+	for (f = 0; f < 2; f++) {
+		for (i = 0; i < count; i++) {
+			if (min[f*count+i] == 0 && max[f*count+i] == 0)
+				break;
+			igt_histogram_add(&soak_min[f], min[f*count+i]);
+			igt_histogram_add(&soak_max[f], max[f*count+i]);
+		}
+	}
+
+	memset(min, 0, 2 * count * sizeof(min[0]));
+	memset(max, 0, 2 * count * sizeof(max[0]));
+}
+
+static void soak_summary(const char *name, uint64_t elapsed_ns)
+{
+	int f;
+
+	printf("%s: %"PRIu64"s elapsed\n", name, elapsed_ns / NSEC_PER_SEC);
+
+	for (f = 0; f < 2; f++) {
+		struct igt_histogram *lo = &soak_min[f];
+		struct igt_histogram *hi = &soak_max[f];
+
+		if (!lo->count)
+			continue;
+
+		printf("[%d] %"PRIu64" events:"
+		       " min %4"PRIu64"-%4"PRIu64
+		       " p50 %4.0f-%4.0f"
+		       " p90 %4.0f-%4.0f"
+		       " p99 %4.0f-%4.0f"
+		       " max %4"PRIu64"-%4"PRIu64"\n",
+		       f, lo->count,
+		       lo->min, hi->min,
+		       igt_histogram_get_percentile(lo, 50.0),
+		       igt_histogram_get_percentile(hi, 50.0),
+		       igt_histogram_get_percentile(lo, 90.0),
+		       igt_histogram_get_percentile(hi, 90.0),
+		       igt_histogram_get_percentile(lo, 99.0),
+		       igt_histogram_get_percentile(hi, 99.0),
+		       lo->max, hi->max);
+	}
+}
+
+static void run_soak(enum test test, uint32_t devid, int pipe, int bit,
+		     int target_scanline, int target_fuzz,
+		     bool test_pixelcount, int duration,
+		     const char *name,
+		     uint32_t *min, uint32_t *max, const int count)
+{
+	struct timespec start = {}, report = {};
+
+	igt_histogram_init(&soak_min[0]);
+	igt_histogram_init(&soak_min[1]);
+	igt_histogram_init(&soak_max[0]);
+	igt_histogram_init(&soak_max[1]);
+
+	igt_nsec_elapsed(&start);
+	igt_nsec_elapsed(&report);
+
+	while (!quit &&
+	       igt_nsec_elapsed(&start) < duration * (uint64_t)NSEC_PER_SEC) {
+		run_test(test, devid, pipe, bit,
+			 target_scanline, target_fuzz, test_pixelcount,
+			 min, max, count);
+		soak_collect(min, max, count);
+
+		if (igt_nsec_elapsed(&report) >= SOAK_REPORT_PERIOD_NS) {
+			soak_summary(name, igt_nsec_elapsed(&start));
+			memset(&report, 0, sizeof(report));
+			igt_nsec_elapsed(&report);
+		}
+	}
+
+	soak_summary(name, igt_nsec_elapsed(&start));
+}
+
 int main(int argc, char *argv[])
 {
 	int i;
 	int pipe = 0, bit = 0, target_scanline = 0, target_fuzz = 1;
+	int soak_duration = 0;
 	bool test_pixelcount = false;
 	uint32_t devid;
 	int drm_fd;
@@ -980,10 +1146,11 @@ int main(int argc, char *argv[])
 			{ .name = "line", .has_arg = required_argument, },
 			{ .name = "fuzz", .has_arg = required_argument, },
 			{ .name = "pixel", .has_arg = no_argument, },
+			{ .name = "duration", .has_arg = required_argument, },
 			{ },
 		};
 
-		int opt = getopt_long(argc, argv, "t:p:b:l:f:x", long_options, NULL);
+		int opt = getopt_long(argc, argv, "t:p:b:l:f:xd:", long_options, NULL);
 		if (opt == -1)
 			break;
 
@@ -1043,6 +1210,11 @@ int main(int argc, char *argv[])
 		case 'x':
 			test_pixelcount = true;
 			break;
+		case 'd':
+			soak_duration = atoi(optarg);
+			if (soak_duration <= 0)
+				usage(argv[0]);
+			break;
 		}
 	}
 
@@ -1198,78 +1370,22 @@ int main(int argc, char *argv[])
 	signal(SIGINT, sighandler);
 	signal(SIGTERM, sighandler);
 
-	switch (test) {
-	case TEST_PIPESTAT:
-		if (test_pixelcount)
-			poll_pixel_pipestat(pipe, bit, min, max, count);
-		else
-			poll_dsl_pipestat(pipe, bit, min, max, count);
-		break;
-	case TEST_IIR_GEN2:
-		assert(!test_pixelcount);
-		poll_dsl_iir_gen2(pipe, bit, min, max, count);
-		break;
-	case TEST_IIR_GEN3:
-		if (test_pixelcount)
-			poll_pixel_iir_gen3(pipe, bit, min, max, count);
-		else
-			poll_dsl_iir_gen3(pipe, bit, min, max, count);
-		break;
-	case TEST_DEIIR:
-		assert(!test_pixelcount);
-		poll_dsl_deiir(devid, pipe, bit, min, max, count);
-		break;
-	case TEST_FRAMECOUNT_GEN3:
-		if (test_pixelcount)
-			poll_pixel_framecount_gen3(pipe, min, max, count);
-		else
-			poll_dsl_framecount_gen3(pipe, min, max, count);
-		break;
-	case TEST_FRAMECOUNT_G4X:
-		assert(!test_pixelcount);
-		poll_dsl_framecount_g4x(pipe, min, max, count);
-		break;
-	case TEST_FLIPCOUNT:
-		assert(!test_pixelcount);
-		poll_dsl_flipcount_g4x(devid, pipe, min, max, count);
-		break;
-	case TEST_PAN:
-		if (test_pixelcount)
-			poll_pixel_pan(devid, pipe, target_scanline, target_fuzz,
-				       min, max, count);
-		else
-			poll_dsl_pan(devid, pipe, target_scanline, target_fuzz,
-				     min, max, count);
-		break;
-	case TEST_FLIP:
-		if (test_pixelcount)
-			poll_pixel_flip(devid, pipe, target_scanline, target_fuzz,
-					min, max, count);
-		else
-			poll_dsl_flip(devid, pipe, target_scanline, target_fuzz,
-				      min, max, count);
-		break;
-	case TEST_SURFLIVE:
-		poll_dsl_surflive(devid, pipe, min, max, count);
-		break;
-	case TEST_WRAP:
-		if (test_pixelcount)
-			poll_pixel_wrap(pipe, min, max, count);
-		else
-			poll_dsl_wrap(pipe, min, max, count);
-		break;
-	case TEST_FIELD:
-		poll_dsl_field(pipe, min, max, count);
-		break;
-	default:
-		assert(0);
-	}
+	if (soak_duration)
+		run_soak(test, devid, pipe, bit,
+			 target_scanline, target_fuzz, test_pixelcount,
+			 soak_duration,
+			 test_name(test, pipe, bit, test_pixelcount),
+			 min, max, count);
+	else
+		run_test(test, devid, pipe, bit,
+			 target_scanline, target_fuzz, test_pixelcount,
+			 min, max, count);
 
 	intel_register_access_fini();
 
 	close(drm_fd);
 
-	if (quit)
+	if (quit || soak_duration)
 		return 0;
 
 	for (i = 0; i < count; i++) {
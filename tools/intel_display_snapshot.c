@@ -0,0 +1,453 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Atomic display state capture. When a display problem is being chased with
+ * intel_reg, intel_watermark and friends run one after another, the state
+ * has changed by the time the last tool reads its registers. This tool
+ * captures the value of every register in the register spec (the same spec
+ * files intel_reg uses) back-to-back under a single forcewake section into a
+ * self-describing binary blob, and decodes the blob offline later, so one
+ * invocation yields one self-consistent picture.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "igt.h"
+#include "intel_io.h"
+#include "intel_chipset.h"
+
+#include "intel_reg_spec.h"
+
+#define SNAPSHOT_MAGIC		0x49445353	/* "IDSS" */
+#define SNAPSHOT_VERSION	1
+
+struct snapshot_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t devid;
+	uint32_t nregs;
+	uint32_t names_len;
+};
+
+struct snapshot_reg {
+	int32_t port;
+	uint32_t mmio_offset;
+	uint32_t addr;
+	uint32_t value;
+	uint32_t name;		/* offset into string table, -1 for none */
+};
+
+struct config {
+	struct pci_device *pci_dev;
+	uint32_t devid;
+	int drm_fd;
+
+	/* decode registers for all platforms */
+	bool all_platforms;
+
+	/* register spec */
+	char *specfile;
+	struct reg *regs;
+	ssize_t regcount;
+
+	int verbosity;
+};
+
+static int capture_snapshot(struct config *config, const char *filename)
+{
+	struct snapshot_header header = {
+		.magic = SNAPSHOT_MAGIC,
+		.version = SNAPSHOT_VERSION,
+		.devid = config->devid,
+	};
+	struct snapshot_reg *snap;
+	uint32_t name_offset = 0;
+	FILE *file;
+	ssize_t i;
+	int ret;
+
+	snap = calloc(config->regcount, sizeof(*snap));
+	if (!snap) {
+		fprintf(stderr, "Error: %s\n", strerror(ENOMEM));
+		return -1;
+	}
+
+	intel_register_access_init(config->pci_dev, 0, config->drm_fd);
+
+	/*
+	 * The capture itself: nothing but back-to-back MMIO reads under one
+	 * forcewake section. Everything else, including the file I/O, happens
+	 * outside it.
+	 */
+	for (i = 0; i < config->regcount; i++) {
+		const struct reg *reg = &config->regs[i];
+
+		/* Sideband ports need per-register transactions; skip. */
+		if (reg->port_desc.port != PORT_MMIO)
+			continue;
+
+		snap[header.nregs].port = reg->port_desc.port;
+		snap[header.nregs].mmio_offset = reg->mmio_offset;
+		snap[header.nregs].addr = reg->addr;
+		snap[header.nregs].value = INREG(reg->mmio_offset + reg->addr);
+		if (reg->name) {
+			snap[header.nregs].name = name_offset;
+			name_offset += strlen(reg->name) + 1;
+		} else {
+			snap[header.nregs].name = (uint32_t)-1;
+		}
+		header.nregs++;
+	}
+
+	intel_register_access_fini();
+
+	header.names_len = name_offset;
+
+	file = fopen(filename, "w");
+	if (!file) {
+		fprintf(stderr, "Error: fopen '%s': %s\n",
+			filename, strerror(errno));
+		free(snap);
+		return -1;
+	}
+
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(snap, sizeof(*snap), header.nregs, file);
+
+	for (i = 0; i < config->regcount; i++) {
+		if (config->regs[i].port_desc.port == PORT_MMIO &&
+		    config->regs[i].name)
+			fwrite(config->regs[i].name,
+			       strlen(config->regs[i].name) + 1, 1, file);
+	}
+
+	ret = fflush(file) == 0 && !ferror(file) ? 0 : -1;
+	fclose(file);
+	free(snap);
+
+	if (config->verbosity > 0)
+		printf("captured %u registers to %s\n", header.nregs,
+		       filename);
+
+	return ret;
+}
+
+static void decode_reg(struct config *config, const struct reg *reg,
+		       uint32_t val)
+{
+	char tmp[1024];
+
+	intel_reg_spec_decode(tmp, sizeof(tmp), reg, val,
+			      config->all_platforms ? 0 : config->devid);
+
+	if (reg->mmio_offset)
+		printf("%24s (0x%08x:0x%08x): 0x%08x", reg->name ?: "",
+		       reg->mmio_offset, reg->addr, val);
+	else
+		printf("%35s (0x%08x): 0x%08x", reg->name ?: "",
+		       reg->addr, val);
+
+	if (*tmp)
+		printf(" (%s)", tmp);
+	printf("\n");
+}
+
+static int decode_snapshot(struct config *config, const char *filename)
+{
+	struct snapshot_header header;
+	struct snapshot_reg *snap = NULL;
+	char *names = NULL;
+	FILE *file;
+	uint32_t i;
+	int ret = -1;
+
+	file = fopen(filename, "r");
+	if (!file) {
+		fprintf(stderr, "Error: fopen '%s': %s\n",
+			filename, strerror(errno));
+		return -1;
+	}
+
+	if (fread(&header, sizeof(header), 1, file) != 1 ||
+	    header.magic != SNAPSHOT_MAGIC ||
+	    header.version != SNAPSHOT_VERSION) {
+		fprintf(stderr, "Error: '%s' is not a snapshot file\n",
+			filename);
+		goto out;
+	}
+
+	snap = calloc(header.nregs, sizeof(*snap));
+	names = malloc(header.names_len);
+	if (!snap || !names) {
+		fprintf(stderr, "Error: %s\n", strerror(ENOMEM));
+		goto out;
+	}
+
+	if (fread(snap, sizeof(*snap), header.nregs, file) != header.nregs ||
+	    (header.names_len &&
+	     fread(names, header.names_len, 1, file) != 1)) {
+		fprintf(stderr, "Error: truncated snapshot file\n");
+		goto out;
+	}
+
+	/* The blob takes precedence over any devid guessed from hardware. */
+	config->devid = header.devid;
+
+	printf("Display state snapshot: devid 0x%04x, %u registers\n\n",
+	       header.devid, header.nregs);
+
+	for (i = 0; i < header.nregs; i++) {
+		struct reg reg = {};
+
+		if (parse_port_desc(&reg, NULL))
+			break;
+
+		reg.mmio_offset = snap[i].mmio_offset;
+		reg.addr = snap[i].addr;
+		if (snap[i].name != (uint32_t)-1 &&
+		    snap[i].name < header.names_len)
+			reg.name = names + snap[i].name;
+
+		decode_reg(config, &reg, snap[i].value);
+	}
+
+	ret = 0;
+
+out:
+	free(snap);
+	free(names);
+	fclose(file);
+
+	return ret;
+}
+
+/*
+ * Get codename for a gen5+ platform to be used for finding register spec file.
+ */
+static const char *get_codename(uint32_t devid)
+{
+	return intel_get_device_info(devid)->codename;
+}
+
+/*
+ * Get register definitions filename for devid in dir. Return 0 if found,
+ * negative error code otherwise.
+ */
+static int get_reg_spec_file(char *buf, size_t buflen, const char *dir,
+			     uint32_t devid)
+{
+	const char *codename;
+
+	/* First, try file named after devid, e.g. "0412" for Haswell GT2. */
+	snprintf(buf, buflen, "%s/%04x", dir, devid);
+	if (!access(buf, F_OK))
+		return 0;
+
+	/* Second, for gen5+, try file named after codename. */
+	codename = get_codename(devid);
+	if (codename) {
+		snprintf(buf, buflen, "%s/%s", dir, codename);
+		if (!access(buf, F_OK))
+			return 0;
+	}
+
+	/* Third, try file named after gen. */
+	snprintf(buf, buflen, "%s/gen%d", dir, intel_gen(devid));
+	if (!access(buf, F_OK))
+		return 0;
+
+	return -ENOENT;
+}
+
+/*
+ * Read register spec.
+ */
+static int read_reg_spec(struct config *config)
+{
+	char buf[PATH_MAX];
+	const char *path;
+	struct stat st;
+	int r;
+
+	path = config->specfile;
+	if (!path)
+		path = getenv("INTEL_REG_SPEC");
+
+	if (!path)
+		path = PKGDATADIR"/registers";
+
+	r = stat(path, &st);
+	if (r) {
+		fprintf(stderr, "Warning: stat '%s' failed: %s. "
+			"Using builtin register spec.\n",
+			path, strerror(errno));
+		goto builtin;
+	}
+
+	if (S_ISDIR(st.st_mode)) {
+		r = get_reg_spec_file(buf, sizeof(buf), path, config->devid);
+		if (r) {
+			fprintf(stderr, "Warning: register spec not found in "
+				"'%s'. Using builtin register spec.\n", path);
+			goto builtin;
+		}
+		path = buf;
+	}
+
+	config->regcount = intel_reg_spec_file(&config->regs, path);
+	if (config->regcount <= 0) {
+		fprintf(stderr, "Warning: reading '%s' failed. "
+			"Using builtin register spec.\n", path);
+		goto builtin;
+	}
+
+	return config->regcount;
+
+builtin:
+	/* Fallback to builtin register spec. */
+	config->regcount = intel_reg_spec_builtin(&config->regs, config->devid);
+
+	return config->regcount;
+}
+
+enum opt {
+	OPT_UNKNOWN = '?',
+	OPT_END = -1,
+	OPT_SPEC,
+	OPT_ALL,
+	OPT_VERBOSE,
+	OPT_QUIET,
+	OPT_HELP,
+};
+
+static void usage(void)
+{
+	printf("Intel display state snapshot tool\n\n");
+	printf("Usage: intel_display_snapshot [OPTION ...] COMMAND FILE\n\n");
+	printf("COMMAND is one of:\n");
+	printf("  capture       capture registers in one burst into FILE\n");
+	printf("  decode        decode a previously captured FILE\n");
+	printf("\n");
+	printf("OPTIONS:\n");
+	printf(" --spec=PATH    Read register spec from directory or file\n");
+	printf(" --all          Decode registers for all known platforms\n");
+	printf(" --verbose      Increase verbosity\n");
+	printf(" --quiet        Reduce verbosity\n");
+	printf("\n");
+	printf("Environment variables:\n");
+	printf(" INTEL_REG_SPEC Read register spec from directory or file\n");
+}
+
+int main(int argc, char *argv[])
+{
+	struct config config = {};
+	int index;
+	enum opt opt;
+	bool help = false;
+
+	static struct option options[] = {
+		{ "spec",	required_argument,	NULL,	OPT_SPEC },
+		{ "all",	no_argument,		NULL,	OPT_ALL },
+		{ "verbose",	no_argument,		NULL,	OPT_VERBOSE },
+		{ "quiet",	no_argument,		NULL,	OPT_QUIET },
+		{ "help",	no_argument,		NULL,	OPT_HELP },
+		{ 0 }
+	};
+
+	for (opt = 0; opt != OPT_END; ) {
+		opt = getopt_long(argc, argv, "", options, &index);
+
+		switch (opt) {
+		case OPT_SPEC:
+			config.specfile = strdup(optarg);
+			if (!config.specfile) {
+				fprintf(stderr, "strdup: %s\n",
+					strerror(errno));
+				return EXIT_FAILURE;
+			}
+			break;
+		case OPT_ALL:
+			config.all_platforms = true;
+			break;
+		case OPT_VERBOSE:
+			config.verbosity++;
+			break;
+		case OPT_QUIET:
+			config.verbosity--;
+			break;
+		case OPT_HELP:
+			help = true;
+			break;
+		case OPT_END:
+			break;
+		case OPT_UNKNOWN:
+			return EXIT_FAILURE;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	if (help || (argc > 0 && strcmp(argv[0], "help") == 0)) {
+		usage();
+		return EXIT_SUCCESS;
+	}
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: intel_display_snapshot "
+			"[OPTION ...] capture|decode FILE\n");
+		return EXIT_FAILURE;
+	}
+
+	if (strcmp(argv[0], "decode") == 0)
+		return decode_snapshot(&config, argv[1]) ?
+			EXIT_FAILURE : EXIT_SUCCESS;
+
+	if (strcmp(argv[0], "capture") != 0) {
+		fprintf(stderr, "'%s' is not a command\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	config.pci_dev = intel_get_pci_device();
+	config.devid = config.pci_dev->device_id;
+
+	/* Just to make sure we open the right debugfs files */
+	config.drm_fd = __drm_open_driver(DRIVER_INTEL);
+
+	if (read_reg_spec(&config) < 0)
+		return EXIT_FAILURE;
+
+	return capture_snapshot(&config, argv[1]) ?
+		EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -114,8 +114,9 @@
 #include <strings.h>
 #include <unistd.h>
 #include <termios.h>
-#include <sys/poll.h>
+#include <sys/epoll.h>
 #include <sys/time.h>
+#include <sys/timerfd.h>
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -133,6 +134,12 @@
 /* User Input definitions */
 #define HELP_DESCRIPTION 1
 
+/* Debugfs does not support poll on its files, so the test-request flag is
+ * sampled on a timer instead; this is the sampling period, and thereby the
+ * worst-case reaction latency to a test request from the appliance.
+ */
+#define TEST_REQUEST_POLL_PERIOD_NS	(2 * 1000 * 1000)
+
 /* Debugfs file definitions */
 #define INTEL_DP_TEST_TYPE_FILE		"i915_dp_test_type"
 #define INTEL_DP_TEST_ACTIVE_FILE	"i915_dp_test_active"
@@ -897,14 +904,6 @@ static void cleanup_debugfs(void)
 	fclose(test_type_fp);
 }
 
-static void __attribute__((noreturn)) cleanup_and_exit(int ret)
-{
-	cleanup_debugfs();
-	close(drm_fd);
-	igt_info("Compliance testing application exiting\n");
-	exit(ret);
-}
-
 static void cleanup_test(void)
 {
 	video_pattern_flag = false;
@@ -923,8 +922,11 @@ static void read_test_request(void)
 	clear_test_active();
 }
 
-static gboolean test_handler(GIOChannel *source, GIOCondition condition,
-			     gpointer data)
+/* Sample the test-request flag through the cached debugfs file; the file
+ * stays open for the lifetime of the tool, so each poll costs a read, not
+ * an open/close round trip through the vfs.
+ */
+static void check_test_requests(void)
 {
 	unsigned long test_active;
 	int ret;
@@ -933,25 +935,110 @@ static gboolean test_handler(GIOChannel *source, GIOCondition condition,
 
 	ret = fscanf(test_active_fp, "%lx", &test_active);
 	if (ret < 1)
-		return FALSE;
+		return;
 
 	if (test_active)
 		read_test_request();
-	return TRUE;
 }
 
-static gboolean input_event(GIOChannel *source, GIOCondition condition,
-				gpointer data)
+/* Returns false once the user asks to quit */
+static bool input_event(void)
+{
+	char buf[2];
+	ssize_t count;
+
+	count = read(STDIN_FILENO, buf, sizeof(buf));
+	if (count >= 1 && buf[0] == 'q' && (count == 1 || buf[1] == '\n'))
+		return false;
+
+	return true;
+}
+
+static int event_loop_add_fd(int epoll_fd, int fd)
 {
-	gchar buf[2];
-	gsize count;
+	struct epoll_event ev;
 
-	count = read(g_io_channel_unix_get_fd(source), buf, sizeof(buf));
-	if (buf[0] == 'q' && (count == 1 || buf[1] == '\n')) {
-		cleanup_and_exit(0);
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+
+	return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+/*
+ * The single event loop of the tool: uevents from the hotplug monitor,
+ * keypresses on stdin and the test-request sampling timer all arrive
+ * through one epoll instance, so a test request is acted on within the
+ * timer period instead of whenever a blocking read happens to return.
+ */
+static int run_event_loop(void)
+{
+	struct epoll_event events[4];
+	struct itimerspec timer_period = {};
+	int epoll_fd, timer_fd = -1, hotplug_fd, n, i;
+	bool running = true;
+	int ret = -1;
+
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd < 0) {
+		igt_warn("Failed to create epoll instance\n");
+		return -1;
 	}
 
-	return TRUE;
+	timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (timer_fd < 0) {
+		igt_warn("Failed to create test request timer\n");
+		goto out;
+	}
+
+	timer_period.it_interval.tv_nsec = TEST_REQUEST_POLL_PERIOD_NS;
+	timer_period.it_value.tv_nsec = TEST_REQUEST_POLL_PERIOD_NS;
+	if (timerfd_settime(timer_fd, 0, &timer_period, NULL) < 0) {
+		igt_warn("Failed to arm test request timer\n");
+		goto out;
+	}
+
+	hotplug_fd = intel_dp_compliance_hotplug_fd();
+
+	if (event_loop_add_fd(epoll_fd, timer_fd) < 0 ||
+	    event_loop_add_fd(epoll_fd, hotplug_fd) < 0 ||
+	    event_loop_add_fd(epoll_fd, STDIN_FILENO) < 0) {
+		igt_warn("Failed to add fd to the event loop\n");
+		goto out;
+	}
+
+	while (running) {
+		n = epoll_wait(epoll_fd, events, ARRAY_SIZE(events), -1);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			igt_warn("epoll_wait failed: %s\n", strerror(errno));
+			goto out;
+		}
+
+		for (i = 0; i < n; i++) {
+			int fd = events[i].data.fd;
+
+			if (fd == timer_fd) {
+				uint64_t expirations;
+
+				if (read(timer_fd, &expirations,
+					 sizeof(expirations)) > 0)
+					check_test_requests();
+			} else if (fd == hotplug_fd) {
+				intel_dp_compliance_handle_hotplug();
+			} else if (fd == STDIN_FILENO) {
+				running = input_event();
+			}
+		}
+	}
+
+	ret = 0;
+out:
+	if (timer_fd >= 0)
+		close(timer_fd);
+	close(epoll_fd);
+
+	return ret;
 }
 
 static void enter_exec_path(char **argv)
@@ -1002,8 +1089,6 @@ int main(int argc, char **argv)
 {
 	int c;
 	int ret = 0;
-	GIOChannel *stdinchannel, *testactive_channel;
-	GMainLoop *mainloop;
 	bool opt_dump_info = false;
 	struct option long_opts[] = {
 		{"help-description", 0, 0, HELP_DESCRIPTION},
@@ -1053,57 +1138,18 @@ int main(int argc, char **argv)
 		goto out_close;
 	}
 
-	mainloop = g_main_loop_new(NULL, FALSE);
-	if (!mainloop) {
-		igt_warn("Failed to create GMainLoop\n");
-		ret = -1;
-		goto out_close;
-	}
-
 	if (!intel_dp_compliance_setup_hotplug()) {
 		igt_warn("Failed to initialize hotplug support\n");
-		goto out_mainloop;
-	}
-
-	testactive_channel = g_io_channel_unix_new(fileno(test_active_fp));
-	if (!testactive_channel) {
-		igt_warn("Failed to create test_active GIOChannel\n");
-		goto out_close;
-	}
-
-	ret = g_io_add_watch(testactive_channel, G_IO_IN | G_IO_ERR,
-			     test_handler, NULL);
-	if (ret < 0) {
-		igt_warn("Failed to add watch on udev GIOChannel\n");
+		ret = -1;
 		goto out_close;
 	}
 
-	stdinchannel = g_io_channel_unix_new(0);
-	if (!stdinchannel) {
-		igt_warn("Failed to create stdin GIOChannel\n");
-		goto out_hotplug;
-	}
-
-	ret = g_io_add_watch(stdinchannel, G_IO_IN | G_IO_ERR, input_event,
-			     NULL);
-	if (ret < 0) {
-		igt_warn("Failed to add watch on stdin GIOChannel\n");
-		goto out_stdio;
-	}
-
-	ret = 0;
-
 	igt_info("*************DP Compliance Testing using DPR-120*************\n");
 	igt_info("Waiting for test request......\n");
 
-	g_main_loop_run(mainloop);
+	ret = run_event_loop();
 
-out_stdio:
-	g_io_channel_shutdown(stdinchannel, TRUE, NULL);
-out_hotplug:
 	intel_dp_compliance_cleanup_hotplug();
-out_mainloop:
-	g_main_loop_unref(mainloop);
 out_close:
 	cleanup_debugfs();
 	close(drm_fd);
@@ -24,11 +24,13 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include <glib.h>
+#include <stdbool.h>
 
 extern int drm_fd;
 
-gboolean intel_dp_compliance_setup_hotplug(void);
+bool intel_dp_compliance_setup_hotplug(void);
+int intel_dp_compliance_hotplug_fd(void);
+void intel_dp_compliance_handle_hotplug(void);
 void intel_dp_compliance_cleanup_hotplug(void);
 
 /* called by the hotplug code */
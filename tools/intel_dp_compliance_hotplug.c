@@ -33,10 +33,13 @@
 #include <libudev.h>
 static struct udev_monitor *uevent_monitor;
 static struct udev *udev;
-static GIOChannel *udevchannel;
 
-static gboolean hotplug_event(GIOChannel *source, GIOCondition condition,
-			      gpointer data)
+/*
+ * Called from the main event loop whenever the uevent monitor fd becomes
+ * readable. Handles a single queued uevent; the loop polls level-triggered,
+ * so any further queued events simply fire it again.
+ */
+void intel_dp_compliance_handle_hotplug(void)
 {
 	struct udev_device *dev;
 	dev_t udev_devnum;
@@ -45,7 +48,7 @@ static gboolean hotplug_event(GIOChannel *source, GIOCondition condition,
 
 	dev = udev_monitor_receive_device(uevent_monitor);
 	if (!dev)
-		goto out;
+		return;
 
 	udev_devnum = udev_device_get_devnum(dev);
 	fstat(drm_fd, &s);
@@ -57,12 +60,14 @@ static gboolean hotplug_event(GIOChannel *source, GIOCondition condition,
 		update_display(0, false);
 
 	udev_device_unref(dev);
-out:
-	return TRUE;
 }
 
+int intel_dp_compliance_hotplug_fd(void)
+{
+	return udev_monitor_get_fd(uevent_monitor);
+}
 
-gboolean intel_dp_compliance_setup_hotplug(void)
+bool intel_dp_compliance_setup_hotplug(void)
 {
 	int ret;
 
@@ -92,31 +97,15 @@ gboolean intel_dp_compliance_setup_hotplug(void)
 		goto out;
 	}
 
-	udevchannel =
-		g_io_channel_unix_new(udev_monitor_get_fd(uevent_monitor));
-	if (!udevchannel) {
-		igt_warn("Failed to create udev GIOChannel\n");
-		goto out;
-	}
-
-	ret = g_io_add_watch(udevchannel, G_IO_IN | G_IO_ERR, hotplug_event,
-			     udev);
-	if (ret < 0) {
-		igt_warn("Failed to add watch on udev GIOChannel\n");
-		goto out;
-	}
-
-	return TRUE;
+	return true;
 
 out:
 	intel_dp_compliance_cleanup_hotplug();
-	return FALSE;
+	return false;
 }
 
 void intel_dp_compliance_cleanup_hotplug(void)
 {
-	if (udevchannel)
-		g_io_channel_shutdown(udevchannel, TRUE, NULL);
 	if (uevent_monitor)
 		udev_monitor_unref(uevent_monitor);
 	if (udev)
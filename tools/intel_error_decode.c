@@ -47,6 +47,9 @@
 #include <unistd.h>
 #include <inttypes.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <err.h>
 #include <assert.h>
@@ -60,20 +63,20 @@
 #include "drmtest.h"
 
 static uint32_t
-print_head(unsigned int reg)
+print_head(FILE *out, unsigned int reg)
 {
-	printf("    head = 0x%08x, wraps = %d\n", reg & (0x7ffff<<2), reg >> 21);
+	fprintf(out, "    head = 0x%08x, wraps = %d\n", reg & (0x7ffff<<2), reg >> 21);
 	return reg & (0x7ffff<<2);
 }
 
 static uint32_t
-print_ctl(unsigned int reg)
+print_ctl(FILE *out, unsigned int reg)
 {
 	uint32_t ring_length = 	(((reg & (0x1ff << 12)) >> 12) + 1) * 4096;
 
 #define BIT_STR(reg, x, on, off) ((1 << (x)) & reg) ? on : off
 
-	printf("    len=%d%s%s%s\n", ring_length,
+	fprintf(out, "    len=%d%s%s%s\n", ring_length,
 	       BIT_STR(reg, 0, ", enabled", ", disabled"),
 	       BIT_STR(reg, 10, ", semaphore wait ", ""),
 	       BIT_STR(reg, 11, ", rb wait ", "")
@@ -83,16 +86,16 @@ print_ctl(unsigned int reg)
 }
 
 static void
-print_acthd(unsigned int reg, unsigned int ring_length)
+print_acthd(FILE *out, unsigned int reg, unsigned int ring_length)
 {
 	if ((reg & (0x7ffff << 2)) < ring_length)
-		printf("    at ring: 0x%08x\n", reg & (0x7ffff << 2));
+		fprintf(out, "    at ring: 0x%08x\n", reg & (0x7ffff << 2));
 	else
-		printf("    at batch: 0x%08x\n", reg);
+		fprintf(out, "    at batch: 0x%08x\n", reg);
 }
 
 static void
-print_instdone(uint32_t devid, unsigned int instdone, unsigned int instdone1)
+print_instdone(FILE *out, uint32_t devid, unsigned int instdone, unsigned int instdone1)
 {
 	int i;
 	static int once;
@@ -115,12 +118,12 @@ print_instdone(uint32_t devid, unsigned int instdone, unsigned int instdone1)
 		}
 
 		if (busy)
-			printf("    busy: %s\n", instdone_bits[i].name);
+			fprintf(out, "    busy: %s\n", instdone_bits[i].name);
 	}
 }
 
 static void
-print_i830_pgtbl_err(unsigned int reg)
+print_i830_pgtbl_err(FILE *out, unsigned int reg)
 {
 	const char *str;
 
@@ -141,7 +144,7 @@ print_i830_pgtbl_err(unsigned int reg)
 	}
 
 	if (str)
-		printf("    source = %s\n", str);
+		fprintf(out, "    source = %s\n", str);
 
 	switch(reg & 0x7) {
 	case 0x0: str  = "Invalid GTT"; break;
@@ -153,175 +156,175 @@ print_i830_pgtbl_err(unsigned int reg)
 	case 0x6: str = "Invalid Tiling"; break;
 	case 0x7: str = "Host to CAM"; break;
 	}
-	printf("    error = %s\n", str);
+	fprintf(out, "    error = %s\n", str);
 }
 
 static void
-print_i915_pgtbl_err(unsigned int reg)
+print_i915_pgtbl_err(FILE *out, unsigned int reg)
 {
 	if (reg & (1 << 29))
-		printf("    Cursor A: Invalid GTT PTE\n");
+		fprintf(out, "    Cursor A: Invalid GTT PTE\n");
 	if (reg & (1 << 28))
-		printf("    Cursor B: Invalid GTT PTE\n");
+		fprintf(out, "    Cursor B: Invalid GTT PTE\n");
 	if (reg & (1 << 27))
-		printf("    MT: Invalid tiling\n");
+		fprintf(out, "    MT: Invalid tiling\n");
 	if (reg & (1 << 26))
-		printf("    MT: Invalid GTT PTE\n");
+		fprintf(out, "    MT: Invalid GTT PTE\n");
 	if (reg & (1 << 25))
-		printf("    LC: Invalid tiling\n");
+		fprintf(out, "    LC: Invalid tiling\n");
 	if (reg & (1 << 24))
-		printf("    LC: Invalid GTT PTE\n");
+		fprintf(out, "    LC: Invalid GTT PTE\n");
 	if (reg & (1 << 23))
-		printf("    BIN VertexData: Invalid GTT PTE\n");
+		fprintf(out, "    BIN VertexData: Invalid GTT PTE\n");
 	if (reg & (1 << 22))
-		printf("    BIN Instruction: Invalid GTT PTE\n");
+		fprintf(out, "    BIN Instruction: Invalid GTT PTE\n");
 	if (reg & (1 << 21))
-		printf("    CS VertexData: Invalid GTT PTE\n");
+		fprintf(out, "    CS VertexData: Invalid GTT PTE\n");
 	if (reg & (1 << 20))
-		printf("    CS Instruction: Invalid GTT PTE\n");
+		fprintf(out, "    CS Instruction: Invalid GTT PTE\n");
 	if (reg & (1 << 19))
-		printf("    CS: Invalid GTT\n");
+		fprintf(out, "    CS: Invalid GTT\n");
 	if (reg & (1 << 18))
-		printf("    Overlay: Invalid tiling\n");
+		fprintf(out, "    Overlay: Invalid tiling\n");
 	if (reg & (1 << 16))
-		printf("    Overlay: Invalid GTT PTE\n");
+		fprintf(out, "    Overlay: Invalid GTT PTE\n");
 	if (reg & (1 << 14))
-		printf("    Display C: Invalid tiling\n");
+		fprintf(out, "    Display C: Invalid tiling\n");
 	if (reg & (1 << 12))
-		printf("    Display C: Invalid GTT PTE\n");
+		fprintf(out, "    Display C: Invalid GTT PTE\n");
 	if (reg & (1 << 10))
-		printf("    Display B: Invalid tiling\n");
+		fprintf(out, "    Display B: Invalid tiling\n");
 	if (reg & (1 << 8))
-		printf("    Display B: Invalid GTT PTE\n");
+		fprintf(out, "    Display B: Invalid GTT PTE\n");
 	if (reg & (1 << 6))
-		printf("    Display A: Invalid tiling\n");
+		fprintf(out, "    Display A: Invalid tiling\n");
 	if (reg & (1 << 4))
-		printf("    Display A: Invalid GTT PTE\n");
+		fprintf(out, "    Display A: Invalid GTT PTE\n");
 	if (reg & (1 << 1))
-		printf("    Host Invalid PTE data\n");
+		fprintf(out, "    Host Invalid PTE data\n");
 	if (reg & (1 << 0))
-		printf("    Host Invalid GTT PTE\n");
+		fprintf(out, "    Host Invalid GTT PTE\n");
 }
 
 static void
-print_i965_pgtbl_err(unsigned int reg)
+print_i965_pgtbl_err(FILE *out, unsigned int reg)
 {
 	if (reg & (1 << 26))
-		printf("    Invalid Sampler Cache GTT entry\n");
+		fprintf(out, "    Invalid Sampler Cache GTT entry\n");
 	if (reg & (1 << 24))
-		printf("    Invalid Render Cache GTT entry\n");
+		fprintf(out, "    Invalid Render Cache GTT entry\n");
 	if (reg & (1 << 23))
-		printf("    Invalid Instruction/State Cache GTT entry\n");
+		fprintf(out, "    Invalid Instruction/State Cache GTT entry\n");
 	if (reg & (1 << 22))
-		printf("    There is no ROC, this cannot occur!\n");
+		fprintf(out, "    There is no ROC, this cannot occur!\n");
 	if (reg & (1 << 21))
-		printf("    Invalid GTT entry during Vertex Fetch\n");
+		fprintf(out, "    Invalid GTT entry during Vertex Fetch\n");
 	if (reg & (1 << 20))
-		printf("    Invalid GTT entry during Command Fetch\n");
+		fprintf(out, "    Invalid GTT entry during Command Fetch\n");
 	if (reg & (1 << 19))
-		printf("    Invalid GTT entry during CS\n");
+		fprintf(out, "    Invalid GTT entry during CS\n");
 	if (reg & (1 << 18))
-		printf("    Invalid GTT entry during Cursor Fetch\n");
+		fprintf(out, "    Invalid GTT entry during Cursor Fetch\n");
 	if (reg & (1 << 17))
-		printf("    Invalid GTT entry during Overlay Fetch\n");
+		fprintf(out, "    Invalid GTT entry during Overlay Fetch\n");
 	if (reg & (1 << 8))
-		printf("    Invalid GTT entry during Display B Fetch\n");
+		fprintf(out, "    Invalid GTT entry during Display B Fetch\n");
 	if (reg & (1 << 4))
-		printf("    Invalid GTT entry during Display A Fetch\n");
+		fprintf(out, "    Invalid GTT entry during Display A Fetch\n");
 	if (reg & (1 << 1))
-		printf("    Valid PTE references illegal memory\n");
+		fprintf(out, "    Valid PTE references illegal memory\n");
 	if (reg & (1 << 0))
-		printf("    Invalid GTT entry during fetch for host\n");
+		fprintf(out, "    Invalid GTT entry during fetch for host\n");
 }
 
 static void
-print_pgtbl_err(unsigned int reg, unsigned int devid)
+print_pgtbl_err(FILE *out, unsigned int reg, unsigned int devid)
 {
 	if (IS_965(devid)) {
-		return print_i965_pgtbl_err(reg);
+		return print_i965_pgtbl_err(out, reg);
 	} else if (IS_GEN3(devid)) {
-		return print_i915_pgtbl_err(reg);
+		return print_i915_pgtbl_err(out, reg);
 	} else {
-		return print_i830_pgtbl_err(reg);
+		return print_i830_pgtbl_err(out, reg);
 	}
 }
 
-static void print_ivb_error(unsigned int reg, unsigned int devid)
+static void print_ivb_error(FILE *out, unsigned int reg, unsigned int devid)
 {
 	if (reg & (1 << 0))
-		printf("    TLB page fault error (GTT entry not valid)\n");
+		fprintf(out, "    TLB page fault error (GTT entry not valid)\n");
 	if (reg & (1 << 1))
-		printf("    Invalid physical address in RSTRM interface (PAVP)\n");
+		fprintf(out, "    Invalid physical address in RSTRM interface (PAVP)\n");
 	if (reg & (1 << 2))
-		printf("    Invalid page directory entry error\n");
+		fprintf(out, "    Invalid page directory entry error\n");
 	if (reg & (1 << 3))
-		printf("    Invalid physical address in ROSTRM interface (PAVP)\n");
+		fprintf(out, "    Invalid physical address in ROSTRM interface (PAVP)\n");
 	if (reg & (1 << 4))
-		printf("    TLB page VTD translation generated an error\n");
+		fprintf(out, "    TLB page VTD translation generated an error\n");
 	if (reg & (1 << 5))
-		printf("    Invalid physical address in WRITE interface (PAVP)\n");
+		fprintf(out, "    Invalid physical address in WRITE interface (PAVP)\n");
 	if (reg & (1 << 6))
-		printf("    Page directory VTD translation generated error\n");
+		fprintf(out, "    Page directory VTD translation generated error\n");
 	if (reg & (1 << 8))
-		printf("    Cacheline containing a PD was marked as invalid\n");
+		fprintf(out, "    Cacheline containing a PD was marked as invalid\n");
 	if (IS_HASWELL(devid) && (reg >> 10) & 0x1f)
-		printf("    %d pending page faults\n", (reg >> 10) & 0x1f);
+		fprintf(out, "    %d pending page faults\n", (reg >> 10) & 0x1f);
 }
 
-static void print_snb_error(unsigned int reg)
+static void print_snb_error(FILE *out, unsigned int reg)
 {
 	if (reg & (1 << 0))
-		printf("    TLB page fault error (GTT entry not valid)\n");
+		fprintf(out, "    TLB page fault error (GTT entry not valid)\n");
 	if (reg & (1 << 1))
-		printf("    Context page GTT translation generated a fault (GTT entry not valid)\n");
+		fprintf(out, "    Context page GTT translation generated a fault (GTT entry not valid)\n");
 	if (reg & (1 << 2))
-		printf("    Invalid page directory entry error\n");
+		fprintf(out, "    Invalid page directory entry error\n");
 	if (reg & (1 << 3))
-		printf("    HWS page GTT translation generated a page fault (GTT entry not valid)\n");
+		fprintf(out, "    HWS page GTT translation generated a page fault (GTT entry not valid)\n");
 	if (reg & (1 << 4))
-		printf("    TLB page VTD translation generated an error\n");
+		fprintf(out, "    TLB page VTD translation generated an error\n");
 	if (reg & (1 << 5))
-		printf("    Context page VTD translation generated an error\n");
+		fprintf(out, "    Context page VTD translation generated an error\n");
 	if (reg & (1 << 6))
-		printf("    Page directory VTD translation generated error\n");
+		fprintf(out, "    Page directory VTD translation generated error\n");
 	if (reg & (1 << 7))
-		printf("    HWS page VTD translation generated an error\n");
+		fprintf(out, "    HWS page VTD translation generated an error\n");
 	if (reg & (1 << 8))
-		printf("    Cacheline containing a PD was marked as invalid\n");
+		fprintf(out, "    Cacheline containing a PD was marked as invalid\n");
 }
 
-static void print_bdw_error(unsigned int reg, unsigned int devid)
+static void print_bdw_error(FILE *out, unsigned int reg, unsigned int devid)
 {
-	print_ivb_error(reg, devid);
+	print_ivb_error(out, reg, devid);
 
 	if (reg & (1 << 10))
-		printf("    Non WB memory type for Advanced Context\n");
+		fprintf(out, "    Non WB memory type for Advanced Context\n");
 	if (reg & (1 << 11))
-		printf("    PASID not enabled\n");
+		fprintf(out, "    PASID not enabled\n");
 	if (reg & (1 << 12))
-		printf("    PASID boundary violation\n");
+		fprintf(out, "    PASID boundary violation\n");
 	if (reg & (1 << 13))
-		printf("    PASID not valid\n");
+		fprintf(out, "    PASID not valid\n");
 	if (reg & (1 << 14))
-		printf("    PASID was zero for untranslated request\n");
+		fprintf(out, "    PASID was zero for untranslated request\n");
 	if (reg & (1 << 15))
-		printf("    Context was not marked as present when doing DMA\n");
+		fprintf(out, "    Context was not marked as present when doing DMA\n");
 }
 
 static void
-print_error(unsigned int reg, unsigned int devid)
+print_error(FILE *out, unsigned int reg, unsigned int devid)
 {
 	switch (intel_gen(devid)) {
-	case 8: return print_bdw_error(reg, devid);
-	case 7: return print_ivb_error(reg, devid);
-	case 6: return print_snb_error(reg);
+	case 8: return print_bdw_error(out, reg, devid);
+	case 7: return print_ivb_error(out, reg, devid);
+	case 6: return print_snb_error(out, reg);
 	}
 }
 
 static void
-print_snb_fence(unsigned int devid, uint64_t fence)
+print_snb_fence(FILE *out, unsigned int devid, uint64_t fence)
 {
-	printf("    %svalid, %c-tiled, pitch: %i, start: 0x%08x, size: %u\n",
+	fprintf(out, "    %svalid, %c-tiled, pitch: %i, start: 0x%08x, size: %u\n",
 			fence & 1 ? "" : "in",
 			fence & (1<<1) ? 'y' : 'x',
 			(int)(((fence>>32)&0xfff)+1)*128,
@@ -330,9 +333,9 @@ print_snb_fence(unsigned int devid, uint64_t fence)
 }
 
 static void
-print_i965_fence(unsigned int devid, uint64_t fence)
+print_i965_fence(FILE *out, unsigned int devid, uint64_t fence)
 {
-	printf("    %svalid, %c-tiled, pitch: %i, start: 0x%08x, size: %u\n",
+	fprintf(out, "    %svalid, %c-tiled, pitch: %i, start: 0x%08x, size: %u\n",
 			fence & 1 ? "" : "in",
 			fence & (1<<1) ? 'y' : 'x',
 			(int)(((fence>>2)&0x1ff)+1)*128,
@@ -341,7 +344,7 @@ print_i965_fence(unsigned int devid, uint64_t fence)
 }
 
 static void
-print_i915_fence(unsigned int devid, uint64_t fence)
+print_i915_fence(FILE *out, unsigned int devid, uint64_t fence)
 {
 	unsigned tile_width;
 	if ((fence & 12) && !IS_915(devid))
@@ -349,7 +352,7 @@ print_i915_fence(unsigned int devid, uint64_t fence)
 	else
 		tile_width = 512;
 
-	printf("    %svalid, %c-tiled, pitch: %i, start: 0x%08x, size: %i\n",
+	fprintf(out, "    %svalid, %c-tiled, pitch: %i, start: 0x%08x, size: %i\n",
 			fence & 1 ? "" : "in",
 			fence & (1<<12) ? 'y' : 'x',
 			(1<<((fence>>4)&0xf))*tile_width,
@@ -358,9 +361,9 @@ print_i915_fence(unsigned int devid, uint64_t fence)
 }
 
 static void
-print_i830_fence(unsigned int devid, uint64_t fence)
+print_i830_fence(FILE *out, unsigned int devid, uint64_t fence)
 {
-	printf("    %svalid, %c-tiled, pitch: %i, start: 0x%08x, size: %i\n",
+	fprintf(out, "    %svalid, %c-tiled, pitch: %i, start: 0x%08x, size: %i\n",
 			fence & 1 ? "" : "in",
 			fence & (1<<12) ? 'y' : 'x',
 			(1<<((fence>>4)&0xf))*128,
@@ -369,21 +372,21 @@ print_i830_fence(unsigned int devid, uint64_t fence)
 }
 
 static void
-print_fence(unsigned int devid, uint64_t fence)
+print_fence(FILE *out, unsigned int devid, uint64_t fence)
 {
 	if (IS_GEN6(devid) || IS_GEN7(devid)) {
-		return print_snb_fence(devid, fence);
+		return print_snb_fence(out, devid, fence);
 	} else if (IS_GEN4(devid) || IS_GEN5(devid)) {
-		return print_i965_fence(devid, fence);
+		return print_i965_fence(out, devid, fence);
 	} else if (IS_GEN3(devid)) {
-		return print_i915_fence(devid, fence);
+		return print_i915_fence(out, devid, fence);
 	} else {
-		return print_i830_fence(devid, fence);
+		return print_i830_fence(out, devid, fence);
 	}
 }
 
 static void
-print_fault_reg(unsigned devid, uint32_t reg)
+print_fault_reg(FILE *out, unsigned devid, uint32_t reg)
 {
 	const char *gen7_types[] = { "Page",
 				     "Invalid PD",
@@ -402,26 +405,26 @@ print_fault_reg(unsigned devid, uint32_t reg)
 		return;
 
 	if (reg & (1 << 0))
-		printf("    Valid\n");
+		fprintf(out, "    Valid\n");
 	else
 		return;
 
 	if (intel_gen(devid) < 8)
-		printf("    %s Fault (%s)\n", gen7_types[reg >> 1 & 0x3],
+		fprintf(out, "    %s Fault (%s)\n", gen7_types[reg >> 1 & 0x3],
 		       reg & (1 << 11) ? "GGTT" : "PPGTT");
 	else
-		printf("    Invalid %s Fault\n", gen8_types[reg >> 1 & 0x3]);
+		fprintf(out, "    Invalid %s Fault\n", gen8_types[reg >> 1 & 0x3]);
 
 	if (intel_gen(devid) < 8)
-		printf("    Address 0x%08x\n", reg & ~((1 << 12)-1));
+		fprintf(out, "    Address 0x%08x\n", reg & ~((1 << 12)-1));
 	else
-		printf("    Engine %s\n", engine[reg >> 12 & 0x7]);
+		fprintf(out, "    Engine %s\n", engine[reg >> 12 & 0x7]);
 
-	printf("    Source ID %d\n", reg >> 3 & 0xff);
+	fprintf(out, "    Source ID %d\n", reg >> 3 & 0xff);
 }
 
 static void
-print_fault_data(unsigned devid, uint32_t data1, uint32_t data0)
+print_fault_data(FILE *out, unsigned devid, uint32_t data1, uint32_t data0)
 {
 	uint64_t address;
 
@@ -429,42 +432,69 @@ print_fault_data(unsigned devid, uint32_t data1, uint32_t data0)
 		return;
 
 	address = ((uint64_t)(data0) << 12) | ((uint64_t)data1 & 0xf) << 44;
-	printf("    Address 0x%016" PRIx64 " %s\n", address,
+	fprintf(out, "    Address 0x%016" PRIx64 " %s\n", address,
 	       data1 & (1 << 4) ? "GGTT" : "PPGTT");
 }
 
 #define MAX_RINGS 10 /* I really hope this never... */
 
-static void decode(struct drm_intel_decode *ctx,
-		   const char *buffer_name,
-		   const char *ring_name,
-		   uint64_t gtt_offset,
-		   uint32_t head_offset,
-		   uint32_t *data, int *count,
-		   int decode)
+#define MAX_THREADS 8
+
+/* GuC-era error states from multi-tile parts run to tens of megabytes
+ * and nightly CI triages hundreds of them, so the serial
+ * getline-and-decode loop became the bottleneck. The input is now
+ * mapped (or slurped, for pipes and seq_files) and scanned in place;
+ * the scan itself only classifies lines and renders the cheap
+ * register annotations, while each buffer payload becomes a job
+ * decoded by a pool of worker threads into a private memstream. The
+ * jobs are replayed in input order afterwards, so the output is
+ * byte-identical to the serial decode.
+ */
+
+struct job {
+	/* the payload lines, in the mapped input; NULL for plain text */
+	const char *payload, *payload_end;
+	bool ascii85, inflate;
+
+	const char *buffer_name;
+	char *ring_name;
+	uint64_t gtt_offset;
+	uint32_t head_offset;
+	uint32_t acthd;
+	uint32_t devid;
+	int do_decode;
+
+	/* the rendered text, in input order */
+	char *out;
+	size_t out_len;
+};
+
+static struct job **jobs;
+static int num_jobs, jobs_size;
+static int next_job;
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct job *queue_job(void)
 {
-	if (!*count)
-		return;
+	struct job *job;
 
-	printf("%s (%s) at 0x%08x_%08x", buffer_name, ring_name,
-	       (unsigned)(gtt_offset >> 32),
-	       (unsigned)(gtt_offset & 0xffffffff));
-	if (head_offset != -1)
-		printf("; HEAD points to: 0x%08x_%08x",
-		       (unsigned)((head_offset + gtt_offset) >> 32),
-		       (unsigned)((head_offset + gtt_offset) & 0xffffffff));
-	printf("\n");
-
-	if (decode) {
-		drm_intel_decode_set_batch_pointer(ctx, data, gtt_offset,
-						   *count);
-		drm_intel_decode(ctx);
-	} else {
-		for (int i = 0; i + 4 <= *count; i += 4)
-			printf("[%04x] %08x %08x %08x %08x\n",
-			       4*i, data[i], data[i+1], data[i+2], data[i+3]);
+	if (num_jobs == jobs_size) {
+		jobs_size = jobs_size ? 2*jobs_size : 64;
+		jobs = realloc(jobs, jobs_size * sizeof(*jobs));
+		if (jobs == NULL) {
+			fprintf(stderr, "Out of memory.\n");
+			exit(1);
+		}
+	}
+
+	job = calloc(1, sizeof(*job));
+	if (job == NULL) {
+		fprintf(stderr, "Out of memory.\n");
+		exit(1);
 	}
-	*count = 0;
+
+	jobs[num_jobs++] = job;
+	return job;
 }
 
 static int zlib_inflate(uint32_t **ptr, int len)
@@ -551,42 +581,210 @@ static int ascii85_decode(const char *in, uint32_t **out, bool inflate)
 	return zlib_inflate(out, len);
 }
 
+static void job_decode(struct job *job)
+{
+	uint32_t *data = NULL;
+	int count = 0;
+	FILE *out;
+
+	out = open_memstream(&job->out, &job->out_len);
+	if (out == NULL)
+		return;
+
+	if (job->ascii85) {
+		count = ascii85_decode(job->payload, &data, job->inflate);
+		if (count == 0)
+			fprintf(stderr, "ASCII85 decode failed (%s - %s).\n",
+				job->ring_name, job->buffer_name);
+	} else {
+		const char *b = job->payload;
+		int data_size = 0;
+
+		while (b < job->payload_end) {
+			const char *eol;
+			char *end;
+			uint32_t value;
+
+			strtoul(b, &end, 16); /* offset */
+			b = end;
+			while (*b == ' ')
+				b++;
+			b++; /* ':' */
+			value = strtoul(b, &end, 16);
+
+			if (count == data_size) {
+				data_size = data_size ? data_size * 2 : 1024;
+				data = realloc(data, data_size * sizeof(uint32_t));
+				if (data == NULL) {
+					fprintf(stderr, "Out of memory.\n");
+					exit(1);
+				}
+			}
+			data[count++] = value;
+
+			eol = memchr(end, '\n', job->payload_end - end);
+			b = eol ? eol + 1 : job->payload_end;
+		}
+	}
+
+	if (count) {
+		fprintf(out, "%s (%s) at 0x%08x_%08x",
+			job->buffer_name, job->ring_name,
+			(unsigned)(job->gtt_offset >> 32),
+			(unsigned)(job->gtt_offset & 0xffffffff));
+		if (job->head_offset != -1)
+			fprintf(out, "; HEAD points to: 0x%08x_%08x",
+				(unsigned)((job->head_offset + job->gtt_offset) >> 32),
+				(unsigned)((job->head_offset + job->gtt_offset) & 0xffffffff));
+		fprintf(out, "\n");
+
+		if (job->do_decode) {
+			struct drm_intel_decode *ctx;
+
+			ctx = drm_intel_decode_context_alloc(job->devid);
+			if (ctx) {
+				drm_intel_decode_set_output_file(ctx, out);
+				if (job->acthd != -1)
+					drm_intel_decode_set_head_tail(ctx, job->acthd, 0xffffffff);
+				drm_intel_decode_set_batch_pointer(ctx, data,
+								   job->gtt_offset,
+								   count);
+				drm_intel_decode(ctx);
+				drm_intel_decode_context_free(ctx);
+			}
+		} else {
+			for (int i = 0; i + 4 <= count; i += 4)
+				fprintf(out, "[%04x] %08x %08x %08x %08x\n",
+					4*i, data[i], data[i+1], data[i+2], data[i+3]);
+		}
+	}
+
+	free(data);
+	fclose(out);
+}
+
+static void *job_worker(void *arg)
+{
+	for (;;) {
+		int n;
+
+		pthread_mutex_lock(&job_lock);
+		n = next_job++;
+		pthread_mutex_unlock(&job_lock);
+
+		if (n >= num_jobs)
+			return NULL;
+
+		if (jobs[n]->payload)
+			job_decode(jobs[n]);
+	}
+}
+
+static int is_dword_line(const char *line)
+{
+	const char *b = line;
+	char *end;
+
+	strtoul(b, &end, 16);
+	if (end != line + 8)
+		return 0;
+
+	b = end;
+	while (*b == ' ')
+		b++;
+	if (*b != ':')
+		return 0;
+
+	b++;
+	while (*b == ' ')
+		b++;
+	strtoul(b, &end, 16);
+	return end > b;
+}
+
 static void
-read_data_file(FILE *file)
+read_data_file(const char *buf, size_t size)
 {
-	struct drm_intel_decode *decode_ctx = NULL;
 	uint32_t devid = PCI_CHIP_I855_GM;
-	uint32_t *data = NULL;
 	uint32_t head[MAX_RINGS];
 	int head_idx = 0;
 	int num_rings = 0;
 	long long unsigned fence;
-	int data_size = 0, count = 0, matched;
-	char *line = NULL;
-	size_t line_size;
-	uint32_t offset, value, ring_length = 0;
+	int matched;
+	uint32_t ring_length = 0;
 	uint64_t gtt_offset = 0;
 	uint32_t head_offset = -1;
+	uint32_t acthd = -1;
 	const char *buffer_name = "batch buffer";
 	char *ring_name = NULL;
 	int do_decode = 1;
+	const char *line, *end = buf + size, *next;
+	const char *payload = NULL;
+	pthread_t threads[MAX_THREADS];
+	int n, num_threads;
+	FILE *text = NULL;
+	char tmp[1024];
+
+	for (line = buf; line < end; line = next) {
+		struct job *job;
+		const char *dashes;
+		size_t len;
+
+		next = memchr(line, '\n', end - line);
+		next = next ? next + 1 : end;
+
+		if (*line == ':' || *line == '~') {
+			if (text) {
+				fclose(text);
+				text = NULL;
+			}
+			job = queue_job();
+			job->payload = line + 1;
+			job->payload_end = next;
+			job->ascii85 = true;
+			job->inflate = *line == ':';
+			job->buffer_name = buffer_name;
+			job->ring_name = strdup(ring_name ? ring_name : "none");
+			job->gtt_offset = gtt_offset;
+			job->head_offset = head_offset;
+			job->acthd = acthd;
+			job->devid = devid;
+			job->do_decode = do_decode;
+			continue;
+		}
 
-	while (getline(&line, &line_size, file) > 0) {
-		char *dashes;
-
-		if (line[0] == ':' || line[0] == '~') {
-			count = ascii85_decode(line+1, &data, line[0] == ':');
-			if (count == 0)
-				fprintf(stderr, "ASCII85 decode failed (%s - %s).\n",
-					ring_name, buffer_name);
-			decode(decode_ctx,
-			       buffer_name, ring_name,
-			       gtt_offset, head_offset,
-			       data, &count, do_decode);
+		if (is_dword_line(line)) {
+			if (payload == NULL)
+				payload = line;
 			continue;
 		}
 
-		dashes = strstr(line, "---");
+		/* display reg section is after the ringbuffers, don't mix them */
+		if (payload) {
+			if (text) {
+				fclose(text);
+				text = NULL;
+			}
+			job = queue_job();
+			job->payload = payload;
+			job->payload_end = line;
+			job->buffer_name = buffer_name;
+			job->ring_name = strdup(ring_name ? ring_name : "none");
+			job->gtt_offset = gtt_offset;
+			job->head_offset = head_offset;
+			job->acthd = acthd;
+			job->devid = devid;
+			job->do_decode = do_decode;
+			payload = NULL;
+		}
+
+		len = next - line;
+		if (len > sizeof(tmp) - 1)
+			len = sizeof(tmp) - 1;
+		memcpy(tmp, line, len);
+		tmp[len] = '\0';
+
+		dashes = strstr(tmp, "---");
 		if (dashes) {
 			const struct {
 				const char *match;
@@ -606,14 +804,10 @@ read_data_file(FILE *file)
 			}, *b;
 			char *new_ring_name;
 
-			new_ring_name = malloc(dashes - line);
-			strncpy(new_ring_name, line, dashes - line);
-			new_ring_name[dashes - line - 1] = '\0';
+			new_ring_name = malloc(dashes - tmp);
+			strncpy(new_ring_name, tmp, dashes - tmp);
+			new_ring_name[dashes - tmp - 1] = '\0';
 
-			decode(decode_ctx,
-			       buffer_name, ring_name,
-			       gtt_offset, head_offset,
-			       data, &count, do_decode);
 			gtt_offset = 0;
 			head_offset = -1;
 
@@ -652,102 +846,163 @@ read_data_file(FILE *file)
 			continue;
 		}
 
-		matched = sscanf(line, "%08x : %08x", &offset, &value);
-		if (matched != 2) {
+		{
 			unsigned int reg, reg2;
 
-			/* display reg section is after the ringbuffers, don't mix them */
-			decode(decode_ctx,
-			       buffer_name, ring_name,
-			       gtt_offset, head_offset,
-			       data, &count, do_decode);
+			if (!text) {
+				job = queue_job();
+				text = open_memstream(&job->out, &job->out_len);
+				if (text == NULL) {
+					fprintf(stderr, "Out of memory.\n");
+					exit(1);
+				}
+			}
 
-			printf("%s", line);
+			fprintf(text, "%s", tmp);
 
-			matched = sscanf(line, "PCI ID: 0x%04x\n", &reg);
+			matched = sscanf(tmp, "PCI ID: 0x%04x\n", &reg);
 			if (matched == 0)
-				matched = sscanf(line, " PCI ID: 0x%04x\n", &reg);
+				matched = sscanf(tmp, " PCI ID: 0x%04x\n", &reg);
 			if (matched == 0) {
-				const char *pci_id_start = strstr(line, "PCI ID");
+				const char *pci_id_start = strstr(tmp, "PCI ID");
 				if (pci_id_start)
 					matched = sscanf(pci_id_start, "PCI ID: 0x%04x\n", &reg);
 			}
 			if (matched == 1) {
 				devid = reg;
-				printf("Detected GEN%i chipset\n",
-						intel_gen(devid));
-
-				decode_ctx = drm_intel_decode_context_alloc(devid);
+				fprintf(text, "Detected GEN%i chipset\n",
+					intel_gen(devid));
 			}
 
-			matched = sscanf(line, "  CTL: 0x%08x\n", &reg);
+			matched = sscanf(tmp, "  CTL: 0x%08x\n", &reg);
 			if (matched == 1)
-				ring_length = print_ctl(reg);
+				ring_length = print_ctl(text, reg);
 
-			matched = sscanf(line, "  HEAD: 0x%08x\n", &reg);
+			matched = sscanf(tmp, "  HEAD: 0x%08x\n", &reg);
 			if (matched == 1) {
-				head[num_rings++] = print_head(reg);
+				head[num_rings++] = print_head(text, reg);
 			}
 
-			matched = sscanf(line, "  ACTHD: 0x%08x\n", &reg);
+			matched = sscanf(tmp, "  ACTHD: 0x%08x\n", &reg);
 			if (matched == 1) {
-				print_acthd(reg, ring_length);
-				drm_intel_decode_set_head_tail(decode_ctx, reg, 0xffffffff);
+				print_acthd(text, reg, ring_length);
+				acthd = reg;
 			}
 
-			matched = sscanf(line, "  PGTBL_ER: 0x%08x\n", &reg);
+			matched = sscanf(tmp, "  PGTBL_ER: 0x%08x\n", &reg);
 			if (matched == 1 && reg)
-				print_pgtbl_err(reg, devid);
+				print_pgtbl_err(text, reg, devid);
 
-			matched = sscanf(line, "  ERROR: 0x%08x\n", &reg);
+			matched = sscanf(tmp, "  ERROR: 0x%08x\n", &reg);
 			if (matched == 1 && reg)
-				print_error(reg, devid);
+				print_error(text, reg, devid);
 
-			matched = sscanf(line, "  INSTDONE: 0x%08x\n", &reg);
+			matched = sscanf(tmp, "  INSTDONE: 0x%08x\n", &reg);
 			if (matched == 1)
-				print_instdone(devid, reg, -1);
+				print_instdone(text, devid, reg, -1);
 
-			matched = sscanf(line, "  INSTDONE1: 0x%08x\n", &reg);
+			matched = sscanf(tmp, "  INSTDONE1: 0x%08x\n", &reg);
 			if (matched == 1)
-				print_instdone(devid, -1, reg);
+				print_instdone(text, devid, -1, reg);
 
-			matched = sscanf(line, "  fence[%i] = %Lx\n", &reg, &fence);
+			matched = sscanf(tmp, "  fence[%i] = %Lx\n", &reg, &fence);
 			if (matched == 2)
-				print_fence(devid, fence);
+				print_fence(text, devid, fence);
 
-			matched = sscanf(line, "  FAULT_REG: 0x%08x\n", &reg);
+			matched = sscanf(tmp, "  FAULT_REG: 0x%08x\n", &reg);
 			if (matched == 1 && reg)
-				print_fault_reg(devid, reg);
+				print_fault_reg(text, devid, reg);
 
-			matched = sscanf(line, "  FAULT_TLB_DATA: 0x%08x 0x%08x\n", &reg, &reg2);
+			matched = sscanf(tmp, "  FAULT_TLB_DATA: 0x%08x 0x%08x\n", &reg, &reg2);
 			if (matched == 2)
-				print_fault_data(devid, reg, reg2);
-
-			continue;
+				print_fault_data(text, devid, reg, reg2);
 		}
+	}
 
-		count++;
-
-		if (count > data_size) {
-			data_size = data_size ? data_size * 2 : 1024;
-			data = realloc(data, data_size * sizeof (uint32_t));
-			if (data == NULL) {
-				fprintf(stderr, "Out of memory.\n");
-				exit(1);
-			}
+	if (payload) {
+		struct job *job;
+
+		job = queue_job();
+		job->payload = payload;
+		job->payload_end = end;
+		job->buffer_name = buffer_name;
+		job->ring_name = strdup(ring_name ? ring_name : "none");
+		job->gtt_offset = gtt_offset;
+		job->head_offset = head_offset;
+		job->acthd = acthd;
+		job->devid = devid;
+		job->do_decode = do_decode;
+	}
+	if (text)
+		fclose(text);
+
+	num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (num_threads > MAX_THREADS)
+		num_threads = MAX_THREADS;
+	if (num_threads < 1)
+		num_threads = 1;
+
+	for (n = 0; n < num_threads; n++)
+		if (pthread_create(&threads[n], NULL, job_worker, NULL)) {
+			num_threads = n;
+			break;
 		}
+	if (num_threads == 0)
+		job_worker(NULL);
+	for (n = 0; n < num_threads; n++)
+		pthread_join(threads[n], NULL);
+
+	for (n = 0; n < num_jobs; n++) {
+		if (jobs[n]->out)
+			fwrite(jobs[n]->out, 1, jobs[n]->out_len, stdout);
+		free(jobs[n]->out);
+		free(jobs[n]->ring_name);
+		free(jobs[n]);
+	}
+	free(jobs);
+	free(ring_name);
+}
 
-		data[count-1] = value;
+static const char *read_input(int fd, size_t *size)
+{
+	struct stat st;
+	char *buf;
+	size_t len, allocated;
+	ssize_t ret;
+
+	/* A regular file is mapped and scanned in place; anything else
+	 * (pipes, and the debugfs seq_file itself) is slurped. The map
+	 * relies on the zero fill past EOF for a terminator, so a file
+	 * ending exactly on a page boundary is slurped as well.
+	 */
+	if (fstat(fd, &st) == 0 &&
+	    S_ISREG(st.st_mode) && st.st_size &&
+	    (st.st_size & 4095)) {
+		buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (buf != MAP_FAILED) {
+			*size = st.st_size;
+			return buf;
+		}
 	}
 
-	decode(decode_ctx,
-	       buffer_name, ring_name,
-	       gtt_offset, head_offset,
-	       data, &count, do_decode);
+	allocated = 1 << 20;
+	buf = malloc(allocated);
+	len = 0;
+	while (buf && (ret = read(fd, buf + len, allocated - len - 1)) > 0) {
+		len += ret;
+		if (allocated - len < 2) {
+			allocated *= 2;
+			buf = realloc(buf, allocated);
+		}
+	}
+	if (buf == NULL) {
+		fprintf(stderr, "Out of memory.\n");
+		exit(1);
+	}
 
-	free(data);
-	free(line);
-	free(ring_name);
+	buf[len] = '\0';
+	*size = len;
+	return buf;
 }
 
 static void setup_pager(void)
@@ -777,11 +1032,12 @@ static void setup_pager(void)
 int
 main(int argc, char *argv[])
 {
-	FILE *file;
 	const char *path;
 	char *filename = NULL;
 	struct stat st;
-	int error;
+	const char *buf;
+	size_t size;
+	int fd, error;
 
 	if (argc > 2) {
 		fprintf(stderr,
@@ -821,7 +1077,8 @@ main(int argc, char *argv[])
 				     "\tsudo mount -t debugfs debugfs /sys/kernel/debug\n");
 			}
 		} else {
-			read_data_file(stdin);
+			buf = read_input(0, &size);
+			read_data_file(buf, size);
 			exit(0);
 		}
 	} else {
@@ -839,35 +1096,36 @@ main(int argc, char *argv[])
 
 		ret = asprintf(&filename, "%s/i915_error_state", path);
 		assert(ret > 0);
-		file = fopen(filename, "r");
-		if (!file) {
+		fd = open(filename, O_RDONLY);
+		if (fd < 0) {
 			int minor;
 			for (minor = 0; minor < 64; minor++) {
 				free(filename);
 				ret = asprintf(&filename, "%s/%d/i915_error_state", path, minor);
 				assert(ret > 0);
 
-				file = fopen(filename, "r");
-				if (file)
+				fd = open(filename, O_RDONLY);
+				if (fd >= 0)
 					break;
 			}
 		}
-		if (!file) {
+		if (fd < 0) {
 			fprintf(stderr, "Failed to find i915_error_state beneath %s\n",
 					path);
 			exit (1);
 		}
 	} else {
-		file = fopen(path, "r");
-		if (!file) {
+		fd = open(path, O_RDONLY);
+		if (fd < 0) {
 			fprintf(stderr, "Failed to open %s: %s\n",
 					path, strerror(errno));
 			exit (1);
 		}
 	}
 
-	read_data_file(file);
-	fclose(file);
+	buf = read_input(fd, &size);
+	read_data_file(buf, size);
+	close(fd);
 
 	if (filename != path)
 		free(filename);
@@ -25,15 +25,35 @@
  *
  */
 
+/*
+ * Forcewake lease daemon. The original tool simply held forcewake forever
+ * and looped on sleep(1), and register tools could only coordinate with it
+ * by convention. It now serves refcounted leases over a unix socket: a
+ * client ACQUIRE takes the wake (if not already held), the reply hands the
+ * fd of the register window across with SCM_RIGHTS so the client maps the
+ * live MMIO BAR directly, and the wake is dropped once the last lease is
+ * released or its socket closes. Short-lived tools like intel_reg and
+ * intel_watermark pick the lease up automatically through
+ * intel_mmio_use_forcewake_lease(), so batched reads no longer pay the
+ * forcewake acquire/release latency per invocation, and a crashed client
+ * cannot leak the wake.
+ */
+
 #include <assert.h>
 #include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <string.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <syslog.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <unistd.h>
+#include "igt_gt.h"
 #include "intel_io.h"
 #include "intel_chipset.h"
 #include "drmtest.h"
@@ -48,9 +68,23 @@ bool daemonized;
 			fprintf(stdout, ##__VA_ARGS__); \
 	} while(0)
 
+#define MAX_CLIENTS 32
+
+struct client {
+	int fd;
+	bool leased;
+};
+
+static struct client clients[MAX_CLIENTS];
+static int drm_fd;
+static int mmio_fd;		/* PCI resource file, handed to clients */
+static uint32_t devid, mmio_size;
+static int lease_count;
+static bool wake_held;
+
 static void
 help(char *prog) {
-	printf("%s Prevents the GT from sleeping.\n\n", prog);
+	printf("%s serves refcounted forcewake leases.\n\n", prog);
 	printf("usage: %s [options] \n\n", prog);
 	printf("Options: \n");
 	printf("    -b        Run in background/daemon mode\n");
@@ -58,14 +92,160 @@ help(char *prog) {
 
 static int
 is_alive(void) {
-	/* Read the timestamp, which should *almost* always be !0 */
-	return (intel_register_read(0x2358) != 0);
+	/* Read the timestamp, which should *almost* always be !0. Raw
+	 * INREG, since we only get here while holding the wake ourselves
+	 * and the lazy forcewake in the register helper would pin an
+	 * extra reference for the lifetime of the daemon. */
+	return (INREG(0x2358) != 0);
+}
+
+static void
+wake_get(void)
+{
+	if (wake_held)
+		return;
+	if (igt_forcewake_get(drm_fd))
+		INFO_PRINT("Forcewake lock failed\n");
+	else
+		wake_held = true;
+}
+
+static void
+wake_put(void)
+{
+	if (!wake_held)
+		return;
+	igt_forcewake_put();
+	wake_held = false;
+}
+
+/* Open the resource file of the MMIO BAR; an fd is the one form of the
+ * register window we can pass across a socket for the client to map.
+ */
+static int
+open_mmio_resource(struct pci_device *pci_dev)
+{
+	char path[128];
+	int mmio_bar;
+
+	devid = pci_dev->device_id;
+	mmio_bar = IS_GEN2(devid) ? 1 : 0;
+	mmio_size = intel_gen(devid) < 5 ? 512*1024 : 2*1024*1024;
+
+	snprintf(path, sizeof(path),
+		 "/sys/bus/pci/devices/%04x:%02x:%02x.%d/resource%d",
+		 pci_dev->domain, pci_dev->bus, pci_dev->dev, pci_dev->func,
+		 mmio_bar);
+
+	return open(path, O_RDWR);
+}
+
+static void
+client_close(struct client *client)
+{
+	if (client->leased && --lease_count == 0)
+		wake_put();
+	client->leased = false;
+	close(client->fd);
+	client->fd = -1;
+}
+
+static void
+client_reply(struct client *client, int status, bool pass_fd)
+{
+	struct intel_forcewaked_reply reply = {
+		.magic = INTEL_FORCEWAKED_MAGIC,
+		.status = status,
+		.devid = devid,
+		.mmio_size = mmio_size,
+	};
+	char control[CMSG_SPACE(sizeof(int))] = {};
+	struct iovec iov = { .iov_base = &reply, .iov_len = sizeof(reply) };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+	};
+
+	if (pass_fd) {
+		struct cmsghdr *cmsg;
+
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cmsg), &mmio_fd, sizeof(int));
+	}
+
+	if (sendmsg(client->fd, &msg, MSG_NOSIGNAL) != sizeof(reply))
+		client_close(client);
+}
+
+static void
+client_handle(struct client *client)
+{
+	struct intel_forcewaked_request request;
+	ssize_t len;
+
+	len = read(client->fd, &request, sizeof(request));
+	if (len != sizeof(request) ||
+	    request.magic != INTEL_FORCEWAKED_MAGIC) {
+		client_close(client);
+		return;
+	}
+
+	switch (request.cmd) {
+	case INTEL_FORCEWAKED_ACQUIRE:
+		if (!client->leased) {
+			if (lease_count++ == 0)
+				wake_get();
+			client->leased = true;
+		}
+		client_reply(client, wake_held ? 0 : -EIO, wake_held);
+		break;
+
+	case INTEL_FORCEWAKED_RELEASE:
+		if (client->leased) {
+			client->leased = false;
+			if (--lease_count == 0)
+				wake_put();
+		}
+		client_reply(client, 0, false);
+		break;
+
+	default:
+		client_close(client);
+		break;
+	}
+}
+
+static int
+socket_setup(void)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	int sock;
+
+	sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0)
+		return -1;
+
+	strncpy(addr.sun_path, INTEL_FORCEWAKED_SOCKET,
+		sizeof(addr.sun_path) - 1);
+	unlink(INTEL_FORCEWAKED_SOCKET);
+	if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    listen(sock, 4)) {
+		close(sock);
+		return -1;
+	}
+
+	return sock;
 }
 
 int main(int argc, char *argv[])
 {
-	int drm_fd;
-	int ret;
+	struct pci_device *pci_dev;
+	int sock, ret, i;
 
 	if (argc > 2 || (argc == 2 && !strncmp(argv[1], "-h", 2))) {
 		help(argv[1]);
@@ -84,24 +264,85 @@ int main(int argc, char *argv[])
 	/* Just to make sure we open the right debugfs files */
 	drm_fd = drm_open_driver_master(DRIVER_INTEL);
 
-	ret = intel_register_access_init(intel_get_pci_device(), 1, drm_fd);
-	if (ret) {
-		INFO_PRINT("Couldn't init register access\n");
+	pci_dev = intel_get_pci_device();
+	intel_mmio_use_pci_bar(pci_dev);
+
+	mmio_fd = open_mmio_resource(pci_dev);
+	if (mmio_fd < 0) {
+		INFO_PRINT("Couldn't open the MMIO resource\n");
 		exit(1);
-	} else {
-		INFO_PRINT("Forcewake locked\n");
 	}
-	while(1) {
-		if (!is_alive()) {
-			INFO_PRINT("gpu reset? restarting daemon\n");
-			intel_register_access_fini();
-			ret = intel_register_access_init(intel_get_pci_device(), 1, drm_fd);
-			if (ret)
-				INFO_PRINT("Reg access init fail\n");
+
+	sock = socket_setup();
+	if (sock < 0) {
+		INFO_PRINT("Couldn't listen on " INTEL_FORCEWAKED_SOCKET "\n");
+		exit(1);
+	}
+
+	for (i = 0; i < MAX_CLIENTS; i++)
+		clients[i].fd = -1;
+
+	INFO_PRINT("Serving forcewake leases\n");
+	while (1) {
+		struct pollfd pfd[MAX_CLIENTS + 1];
+		struct client *slot[MAX_CLIENTS];
+		int nfd = 0;
+
+		pfd[nfd].fd = sock;
+		pfd[nfd].events = POLLIN;
+		nfd++;
+
+		for (i = 0; i < MAX_CLIENTS; i++) {
+			if (clients[i].fd < 0)
+				continue;
+			slot[nfd - 1] = &clients[i];
+			pfd[nfd].fd = clients[i].fd;
+			pfd[nfd].events = POLLIN;
+			nfd++;
+		}
+
+		/* Wake up once a second to spot a GPU reset dropping the
+		 * wake behind our back, as the old loop did. */
+		ret = poll(pfd, nfd, 1000);
+		if (ret < 0)
+			break;
+
+		if (ret == 0 && wake_held && !is_alive()) {
+			INFO_PRINT("gpu reset? reacquiring forcewake\n");
+			igt_forcewake_put();
+			wake_held = false;
+			wake_get();
+			continue;
+		}
+
+		if (pfd[0].revents & POLLIN) {
+			int fd = accept(sock, NULL, NULL);
+
+			for (i = 0; fd >= 0 && i < MAX_CLIENTS; i++) {
+				if (clients[i].fd >= 0)
+					continue;
+				clients[i].fd = fd;
+				clients[i].leased = false;
+				fd = -1;
+			}
+			if (fd >= 0)	/* table full */
+				close(fd);
+		}
+
+		for (i = 1; i < nfd; i++) {
+			if (pfd[i].revents & POLLIN)
+				client_handle(slot[i - 1]);
+			else if (pfd[i].revents & (POLLHUP | POLLERR))
+				client_close(slot[i - 1]);
 		}
-		sleep(1);
 	}
-	intel_register_access_fini();
+
+	for (i = 0; i < MAX_CLIENTS; i++)
+		if (clients[i].fd >= 0)
+			client_close(&clients[i]);
+	wake_put();
+	close(sock);
+	unlink(INTEL_FORCEWAKED_SOCKET);
 	close(drm_fd);
 	INFO_PRINT("Forcewake unlock\n");
 
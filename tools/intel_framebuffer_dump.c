@@ -23,29 +23,36 @@
  */
 
 /*
- * Read back all the KMS framebuffers attached to the CRTC and record as PNG.
+ * Read back all the KMS framebuffers attached to the CRTC and record as PNG,
+ * or, in capture mode, record the scanout of every active plane per vblank
+ * into an indexed binary container for offline inspection.
  */
 
 #define _GNU_SOURCE
 #include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/mman.h>
 #include <errno.h>
+#include <err.h>
 #include <xf86drmMode.h>
 #include <i915_drm.h>
 #include <cairo.h>
 
 #include "intel_io.h"
+#include "igt_x86.h"
 #include "drmtest.h"
 
-int main(int argc, char **argv)
+static int dump_png(int fd)
 {
 	drmModeResPtr res;
-	int fd, n;
-
-	fd = drmOpen("i915", NULL);
-	if (fd < 0)
-		return ENOENT;
+	int n;
 
 	res = drmModeGetResources(fd);
 	if (res == NULL)
@@ -77,7 +84,7 @@ int main(int argc, char **argv)
 			struct drm_i915_gem_mmap_gtt mmap_arg;
 			void *ptr;
 
-						mmap_arg.handle = open_arg.handle;
+			mmap_arg.handle = open_arg.handle;
 			if (drmIoctl(fd, DRM_IOCTL_I915_GEM_MMAP_GTT, &mmap_arg) == 0 &&
 			    (ptr = mmap(0, open_arg.size, PROT_READ, MAP_SHARED, fd, mmap_arg.offset)) != (void *)-1) {
 				cairo_surface_t *surface;
@@ -109,3 +116,546 @@ int main(int argc, char **argv)
 
 	return 0;
 }
+
+/* Capture mode. One PNG per second of GTT reads cannot keep up with scanout,
+ * so to catch one-frame corruption we instead snapshot every active plane on
+ * every vblank with the streaming WC copy into a preallocated frame pool, and
+ * hand the filled slots to a background thread which owns the output file.
+ * The writer serialises each frame into an indexed container -- optionally as
+ * a delta against the previous frame, since consecutive scanout frames of a
+ * mostly idle desktop differ in a handful of pages -- and appends a record
+ * index at the end so a decoder can seek straight to frame N.
+ */
+
+#define DUMP_MAGIC	0x44424649 /* "IFBD" */
+#define DUMP_VERSION	1
+
+#define DUMP_FRAME_DELTA	0x1
+
+struct dump_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t n_planes;
+	uint32_t pad;
+	/* followed by n_planes struct dump_plane */
+};
+
+struct dump_plane {
+	uint32_t plane_id;
+	uint32_t width;
+	uint32_t height;
+	uint32_t pitch;
+	uint32_t depth;
+	uint32_t pad;
+	uint64_t size;
+};
+
+struct dump_frame {
+	uint32_t seq;		/* vblank sequence */
+	uint32_t flags;
+	uint64_t ns;		/* vblank timestamp */
+	uint64_t len;		/* payload bytes following this header */
+	/* payload: full frame data, or delta extents */
+};
+
+struct dump_extent {
+	uint64_t offset;
+	uint64_t len;
+	/* followed by len bytes of data */
+};
+
+struct dump_footer {
+	uint64_t index_offset;	/* array of n_frames file offsets */
+	uint32_t n_frames;
+	uint32_t magic;
+};
+
+/* Double buffering means each plane flips between a small set of fbs; we map
+ * each one the first time we see it and keep the mapping for the whole run,
+ * so the steady-state cost per frame is just the WC copy. */
+#define MAX_FBS_PER_PLANE 4
+#define MAX_CAPTURE_PLANES 8
+
+struct capture_fb {
+	uint32_t fb_id;
+	void *ptr;
+	uint64_t size;
+};
+
+struct capture_plane {
+	uint32_t plane_id;
+	uint32_t width, height, pitch, depth;
+	uint64_t size;
+	struct capture_fb fbs[MAX_FBS_PER_PLANE];
+	int n_fbs;
+};
+
+#define CAPTURE_POOL_DEPTH 16
+
+struct capture_slot {
+	uint32_t seq;
+	uint64_t ns;
+	uint8_t *data;		/* all planes, packed back to back */
+};
+
+static struct {
+	struct capture_plane planes[MAX_CAPTURE_PLANES];
+	int n_planes;
+	uint64_t frame_size;
+
+	struct capture_slot pool[CAPTURE_POOL_DEPTH];
+	uint32_t head;
+	uint32_t tail;
+
+	pthread_t thread;
+	pthread_mutex_t wake_lock;
+	pthread_cond_t wake;
+	bool exit;
+
+	FILE *file;
+	bool delta;
+	uint8_t *ref;		/* last frame written, for deltas */
+	bool have_ref;
+	uint64_t *index;
+	uint32_t n_frames, max_frames;
+	uint32_t dropped;
+} capture = {
+	.wake_lock = PTHREAD_MUTEX_INITIALIZER,
+	.wake = PTHREAD_COND_INITIALIZER,
+};
+
+static void *map_fb(int fd, drmModeFBPtr fb, uint64_t *size)
+{
+	struct drm_i915_gem_mmap_gtt mmap_arg;
+	struct drm_gem_open open_arg;
+	struct drm_gem_flink flink;
+	void *ptr = NULL;
+
+	flink.handle = fb->handle;
+	if (drmIoctl(fd, DRM_IOCTL_GEM_FLINK, &flink))
+		return NULL;
+
+	open_arg.name = flink.name;
+	if (drmIoctl(fd, DRM_IOCTL_GEM_OPEN, &open_arg))
+		return NULL;
+
+	mmap_arg.handle = open_arg.handle;
+	if (drmIoctl(fd, DRM_IOCTL_I915_GEM_MMAP_GTT, &mmap_arg) == 0)
+		ptr = mmap(0, open_arg.size, PROT_READ, MAP_SHARED,
+			   fd, mmap_arg.offset);
+
+	/* The mapping keeps the object alive; drop our handle so we don't
+	 * pin the fb beyond the capture. */
+	drmIoctl(fd, DRM_IOCTL_GEM_CLOSE, &open_arg.handle);
+
+	if (ptr == (void *)-1)
+		return NULL;
+
+	*size = open_arg.size;
+	return ptr;
+}
+
+static struct capture_fb *plane_get_fb(int fd, struct capture_plane *p,
+				       uint32_t fb_id)
+{
+	drmModeFBPtr fb;
+	struct capture_fb *cfb;
+	int i;
+
+	for (i = 0; i < p->n_fbs; i++)
+		if (p->fbs[i].fb_id == fb_id)
+			return &p->fbs[i];
+
+	if (p->n_fbs == MAX_FBS_PER_PLANE)
+		return NULL;
+
+	fb = drmModeGetFB(fd, fb_id);
+	if (fb == NULL)
+		return NULL;
+
+	/* The container records one geometry per plane; a mid-capture mode
+	 * change would need a new file, so skip the stray fb instead. */
+	if (fb->width != p->width || fb->height != p->height ||
+	    fb->pitch != p->pitch) {
+		drmModeFreeFB(fb);
+		return NULL;
+	}
+
+	cfb = &p->fbs[p->n_fbs];
+	cfb->fb_id = fb_id;
+	cfb->ptr = map_fb(fd, fb, &cfb->size);
+	drmModeFreeFB(fb);
+	if (cfb->ptr == NULL)
+		return NULL;
+
+	p->n_fbs++;
+	return cfb;
+}
+
+static int capture_discover_planes(int fd)
+{
+	drmModePlaneResPtr plane_res;
+	uint32_t i;
+
+	drmSetClientCap(fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1);
+
+	plane_res = drmModeGetPlaneResources(fd);
+	if (plane_res == NULL)
+		return -1;
+
+	for (i = 0; i < plane_res->count_planes; i++) {
+		struct capture_plane *p;
+		drmModePlanePtr plane;
+		drmModeFBPtr fb;
+
+		if (capture.n_planes == MAX_CAPTURE_PLANES)
+			break;
+
+		plane = drmModeGetPlane(fd, plane_res->planes[i]);
+		if (plane == NULL)
+			continue;
+
+		if (plane->fb_id == 0) {
+			drmModeFreePlane(plane);
+			continue;
+		}
+
+		fb = drmModeGetFB(fd, plane->fb_id);
+		if (fb == NULL) {
+			drmModeFreePlane(plane);
+			continue;
+		}
+
+		p = &capture.planes[capture.n_planes];
+		p->plane_id = plane->plane_id;
+		p->width = fb->width;
+		p->height = fb->height;
+		p->pitch = fb->pitch;
+		p->depth = fb->depth;
+		p->size = (uint64_t)fb->pitch * fb->height;
+		drmModeFreeFB(fb);
+
+		if (plane_get_fb(fd, p, plane->fb_id))
+			capture.n_planes++;
+
+		drmModeFreePlane(plane);
+	}
+
+	drmModeFreePlaneResources(plane_res);
+
+	return capture.n_planes ? 0 : -1;
+}
+
+/* Compare against the previous frame in page-sized blocks and write only the
+ * extents that changed. A frame that changed almost everywhere is written in
+ * full, so the delta path never costs more than a plain dump. */
+#define DELTA_BLOCK 4096
+
+static int64_t write_delta(const uint8_t *data)
+{
+	uint64_t start = ftello(capture.file);
+	uint64_t off = 0, changed = 0;
+
+	while (off < capture.frame_size) {
+		uint64_t len = capture.frame_size - off;
+		struct dump_extent ext;
+
+		if (len > DELTA_BLOCK)
+			len = DELTA_BLOCK;
+
+		if (memcmp(data + off, capture.ref + off, len) == 0) {
+			off += len;
+			continue;
+		}
+
+		/* coalesce runs of dirty blocks into one extent */
+		ext.offset = off;
+		while (off < capture.frame_size &&
+		       memcmp(data + off, capture.ref + off, len) != 0) {
+			off += len;
+			len = capture.frame_size - off;
+			if (len > DELTA_BLOCK)
+				len = DELTA_BLOCK;
+		}
+		ext.len = off - ext.offset;
+		changed += ext.len;
+
+		fwrite(&ext, sizeof(ext), 1, capture.file);
+		fwrite(data + ext.offset, ext.len, 1, capture.file);
+	}
+
+	if (changed > capture.frame_size - capture.frame_size / 4) {
+		fseeko(capture.file, start, SEEK_SET);
+		return -1;
+	}
+
+	return ftello(capture.file) - start;
+}
+
+static void write_frame(const struct capture_slot *slot)
+{
+	struct dump_frame frame = {
+		.seq = slot->seq,
+		.ns = slot->ns,
+	};
+	uint64_t record, len;
+	int64_t delta_len = -1;
+
+	if (capture.n_frames == capture.max_frames) {
+		capture.max_frames = capture.max_frames ? 2*capture.max_frames : 1024;
+		capture.index = realloc(capture.index,
+					capture.max_frames * sizeof(uint64_t));
+		if (capture.index == NULL)
+			err(1, "out of memory");
+	}
+
+	record = ftello(capture.file);
+	fseeko(capture.file, record + sizeof(frame), SEEK_SET);
+
+	if (capture.delta && capture.have_ref)
+		delta_len = write_delta(slot->data);
+	if (delta_len >= 0) {
+		frame.flags |= DUMP_FRAME_DELTA;
+		len = delta_len;
+	} else {
+		fwrite(slot->data, capture.frame_size, 1, capture.file);
+		len = capture.frame_size;
+	}
+	frame.len = len;
+
+	fseeko(capture.file, record, SEEK_SET);
+	fwrite(&frame, sizeof(frame), 1, capture.file);
+	fseeko(capture.file, record + sizeof(frame) + len, SEEK_SET);
+
+	if (capture.delta) {
+		memcpy(capture.ref, slot->data, capture.frame_size);
+		capture.have_ref = true;
+	}
+
+	capture.index[capture.n_frames++] = record;
+}
+
+static void *capture_writer(void *arg)
+{
+	for (;;) {
+		uint32_t t = capture.tail;
+		struct capture_slot *slot;
+
+		if (t == __atomic_load_n(&capture.head, __ATOMIC_ACQUIRE)) {
+			pthread_mutex_lock(&capture.wake_lock);
+			while (t == __atomic_load_n(&capture.head,
+						    __ATOMIC_ACQUIRE) &&
+			       !capture.exit)
+				pthread_cond_wait(&capture.wake,
+						  &capture.wake_lock);
+			pthread_mutex_unlock(&capture.wake_lock);
+
+			if (t == __atomic_load_n(&capture.head,
+						 __ATOMIC_ACQUIRE))
+				break;
+			continue;
+		}
+
+		slot = &capture.pool[t % CAPTURE_POOL_DEPTH];
+		write_frame(slot);
+		__atomic_store_n(&capture.tail, t + 1, __ATOMIC_RELEASE);
+	}
+
+	return NULL;
+}
+
+static void capture_finish(void)
+{
+	struct dump_footer footer = {
+		.n_frames = capture.n_frames,
+		.magic = DUMP_MAGIC,
+	};
+
+	pthread_mutex_lock(&capture.wake_lock);
+	capture.exit = true;
+	pthread_cond_signal(&capture.wake);
+	pthread_mutex_unlock(&capture.wake_lock);
+	pthread_join(capture.thread, NULL);
+
+	footer.index_offset = ftello(capture.file);
+	fwrite(capture.index, sizeof(uint64_t), capture.n_frames,
+	       capture.file);
+	fwrite(&footer, sizeof(footer), 1, capture.file);
+
+	if (fclose(capture.file))
+		err(1, "writing capture file");
+}
+
+static int capture_scanout(int fd, const char *filename,
+			   int seconds, bool delta)
+{
+	struct dump_header header = {
+		.magic = DUMP_MAGIC,
+		.version = DUMP_VERSION,
+	};
+	uint32_t frames, start_seq = 0;
+	int n, i;
+
+	if (capture_discover_planes(fd)) {
+		fprintf(stderr, "no active planes to capture\n");
+		return -1;
+	}
+
+	for (n = 0; n < capture.n_planes; n++)
+		capture.frame_size += capture.planes[n].size;
+
+	for (i = 0; i < CAPTURE_POOL_DEPTH; i++) {
+		capture.pool[i].data = malloc(capture.frame_size);
+		if (capture.pool[i].data == NULL)
+			err(1, "out of memory");
+	}
+
+	capture.delta = delta;
+	if (delta) {
+		capture.ref = malloc(capture.frame_size);
+		if (capture.ref == NULL)
+			err(1, "out of memory");
+	}
+
+	capture.file = fopen(filename, "w");
+	if (capture.file == NULL)
+		err(1, "%s", filename);
+
+	header.n_planes = capture.n_planes;
+	fwrite(&header, sizeof(header), 1, capture.file);
+	for (n = 0; n < capture.n_planes; n++) {
+		struct dump_plane dp = {
+			.plane_id = capture.planes[n].plane_id,
+			.width = capture.planes[n].width,
+			.height = capture.planes[n].height,
+			.pitch = capture.planes[n].pitch,
+			.depth = capture.planes[n].depth,
+			.size = capture.planes[n].size,
+		};
+		fwrite(&dp, sizeof(dp), 1, capture.file);
+	}
+
+	pthread_create(&capture.thread, NULL, capture_writer, NULL);
+
+	/* Nominal bound; we stop on the vblank count so a paused pipe
+	 * doesn't leave us waiting forever on a 60fps estimate. */
+	frames = seconds * 120;
+	while (frames--) {
+		drmVBlank vbl = {
+			.request.type = DRM_VBLANK_RELATIVE,
+			.request.sequence = 1,
+		};
+		struct capture_slot *slot;
+		uint32_t h = capture.head;
+		uint64_t off = 0;
+
+		if (drmWaitVBlank(fd, &vbl))
+			break;
+
+		if (!start_seq)
+			start_seq = vbl.reply.sequence;
+		else if (vbl.reply.sequence - start_seq >= seconds * 60)
+			break;
+
+		/* If the disk falls behind, drop the frame rather than
+		 * stall: a late copy would tear against the next scanout
+		 * anyway, and the index makes the gap visible. */
+		if (h - __atomic_load_n(&capture.tail, __ATOMIC_ACQUIRE) >=
+		    CAPTURE_POOL_DEPTH) {
+			capture.dropped++;
+			continue;
+		}
+
+		slot = &capture.pool[h % CAPTURE_POOL_DEPTH];
+		slot->seq = vbl.reply.sequence;
+		slot->ns = (uint64_t)vbl.reply.tval_sec * 1000000000 +
+			vbl.reply.tval_usec * 1000;
+
+		for (n = 0; n < capture.n_planes; n++) {
+			struct capture_plane *p = &capture.planes[n];
+			drmModePlanePtr plane;
+			struct capture_fb *cfb = NULL;
+
+			plane = drmModeGetPlane(fd, p->plane_id);
+			if (plane) {
+				if (plane->fb_id)
+					cfb = plane_get_fb(fd, p, plane->fb_id);
+				drmModeFreePlane(plane);
+			}
+
+			if (cfb)
+				igt_memcpy_from_wc(slot->data + off,
+						   cfb->ptr, p->size);
+			else
+				memset(slot->data + off, 0, p->size);
+			off += p->size;
+		}
+
+		__atomic_store_n(&capture.head, h + 1, __ATOMIC_RELEASE);
+
+		pthread_mutex_lock(&capture.wake_lock);
+		pthread_cond_signal(&capture.wake);
+		pthread_mutex_unlock(&capture.wake_lock);
+	}
+
+	capture_finish();
+
+	printf("captured %u frames of %d plane%s (%"PRIu64" bytes/frame) to %s",
+	       capture.n_frames, capture.n_planes,
+	       capture.n_planes > 1 ? "s" : "", capture.frame_size, filename);
+	if (capture.dropped)
+		printf(", %u dropped", capture.dropped);
+	printf("\n");
+
+	return 0;
+}
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [OPTION]...\n"
+	       "Dump the scanout framebuffers as fb-ID.png, or record them.\n\n"
+	       "  -c SECONDS   capture every vblank for SECONDS into a binary container\n"
+	       "  -o FILE      capture output file (default: fb.dump)\n"
+	       "  -d           delta-compress frames against their predecessor\n"
+	       "  -h           show this help\n",
+	       name);
+}
+
+int main(int argc, char **argv)
+{
+	const char *filename = "fb.dump";
+	int seconds = 0;
+	bool delta = false;
+	int fd, c, ret;
+
+	while ((c = getopt(argc, argv, "c:o:dh")) != -1) {
+		switch (c) {
+		case 'c':
+			seconds = atoi(optarg);
+			break;
+		case 'o':
+			filename = optarg;
+			break;
+		case 'd':
+			delta = true;
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	fd = drmOpen("i915", NULL);
+	if (fd < 0)
+		return ENOENT;
+
+	if (seconds)
+		ret = capture_scanout(fd, filename, seconds, delta) ? 1 : 0;
+	else
+		ret = dump_png(fd);
+
+	return ret;
+}
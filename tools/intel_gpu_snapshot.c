@@ -0,0 +1,369 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Fast collection core for intel_gpu_abrt. The shell script copies debugfs
+ * and dmesg serially with cp and cat, taking seconds during which the error
+ * state it exists to archive keeps decaying. This tool first opens every
+ * file it intends to read -- the i915 debugfs directory with the error
+ * state queued first, and the module parameters -- then drains them in
+ * parallel from a small thread pool into in-memory buffers alongside one
+ * klogctl() grab of the dmesg ring, and only then serialises everything
+ * into a tar archive. The capture window closes in well under a second;
+ * the disk gets involved after the state is already safe in memory.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <err.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/klog.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SNAPSHOT_THREADS 4
+#define MAX_ENTRIES 256
+
+/* Archive member names as intel_gpu_abrt lays them out, so the script can
+ * extract the snapshot straight into its report directory. */
+#define ARCHIVE_PREFIX "intel_gpu_abrt/"
+
+struct snapshot_entry {
+	char name[100];		/* tar limits us to 100 anyway */
+	int fd;
+	uint8_t *data;
+	size_t len;
+	size_t cap;
+};
+
+static struct snapshot_entry entries[MAX_ENTRIES];
+static int num_entries;
+static unsigned int next_entry;	/* work queue cursor, atomic */
+
+static void entry_append(struct snapshot_entry *e,
+			 const void *data, size_t len)
+{
+	if (e->len + len > e->cap) {
+		e->cap = e->cap ? 2 * e->cap : 64 * 1024;
+		while (e->len + len > e->cap)
+			e->cap *= 2;
+		e->data = realloc(e->data, e->cap);
+		if (e->data == NULL)
+			err(1, "out of memory");
+	}
+
+	memcpy(e->data + e->len, data, len);
+	e->len += len;
+}
+
+static int snapshot_open(int dirfd, const char *file, const char *arcdir)
+{
+	struct snapshot_entry *e;
+	int fd;
+
+	if (num_entries == MAX_ENTRIES)
+		return -1;
+
+	fd = openat(dirfd, file, O_RDONLY | O_NONBLOCK);
+	if (fd < 0)
+		return -1;
+
+	e = &entries[num_entries++];
+	snprintf(e->name, sizeof(e->name), "%s%s/%s",
+		 ARCHIVE_PREFIX, arcdir, file);
+	e->fd = fd;
+
+	return 0;
+}
+
+static void snapshot_open_dir(const char *path, const char *arcdir,
+			      const char *first)
+{
+	struct dirent *dirent;
+	DIR *dir;
+	int dfd;
+
+	dir = opendir(path);
+	if (dir == NULL)
+		return;
+	dfd = dirfd(dir);
+
+	/* The most volatile file gets drained first by the pool. */
+	if (first)
+		snapshot_open(dfd, first, arcdir);
+
+	while ((dirent = readdir(dir))) {
+		struct stat st;
+
+		if (first && strcmp(dirent->d_name, first) == 0)
+			continue;
+		if (fstatat(dfd, dirent->d_name, &st, 0))
+			continue;
+		if (!S_ISREG(st.st_mode))
+			continue;
+
+		snapshot_open(dfd, dirent->d_name, arcdir);
+	}
+
+	closedir(dir);
+}
+
+static void *snapshot_worker(void *arg)
+{
+	for (;;) {
+		unsigned int n =
+			__atomic_fetch_add(&next_entry, 1, __ATOMIC_RELAXED);
+		struct snapshot_entry *e;
+		char buf[64 * 1024];
+		ssize_t len;
+
+		if (n >= (unsigned int)__atomic_load_n(&num_entries,
+						       __ATOMIC_ACQUIRE))
+			break;
+
+		e = &entries[n];
+		if (e->fd < 0)	/* captured inline, nothing to drain */
+			continue;
+		while ((len = read(e->fd, buf, sizeof(buf))) > 0)
+			entry_append(e, buf, len);
+		close(e->fd);
+	}
+
+	return NULL;
+}
+
+static void snapshot_dmesg(void)
+{
+	struct snapshot_entry *e;
+	int len;
+
+	if (num_entries == MAX_ENTRIES)
+		return;
+
+	len = klogctl(10 /* SYSLOG_ACTION_SIZE_BUFFER */, NULL, 0);
+	if (len <= 0)
+		return;
+
+	e = &entries[num_entries];
+	snprintf(e->name, sizeof(e->name), "%sdmesg", ARCHIVE_PREFIX);
+	e->fd = -1;
+	e->data = malloc(len);
+	if (e->data == NULL)
+		err(1, "out of memory");
+
+	len = klogctl(3 /* SYSLOG_ACTION_READ_ALL */, (char *)e->data, len);
+	if (len < 0) {
+		free(e->data);
+		e->data = NULL;
+		return;
+	}
+
+	e->len = len;
+	/* The pool may already be running; publish only once complete. */
+	__atomic_store_n(&num_entries, num_entries + 1, __ATOMIC_RELEASE);
+}
+
+/* Plain ustar, the subset tar(1) has extracted since forever. */
+struct tar_header {
+	char name[100];
+	char mode[8];
+	char uid[8];
+	char gid[8];
+	char size[12];
+	char mtime[12];
+	char chksum[8];
+	char typeflag;
+	char linkname[100];
+	char magic[6];
+	char version[2];
+	char uname[32];
+	char gname[32];
+	char devmajor[8];
+	char devminor[8];
+	char prefix[155];
+	char pad[12];
+};
+
+static void tar_write_entry(FILE *file, const struct snapshot_entry *e,
+			    time_t now)
+{
+	struct tar_header hdr;
+	unsigned int sum = 0;
+	static const char zeros[512];
+	const uint8_t *p;
+
+	memset(&hdr, 0, sizeof(hdr));
+	strncpy(hdr.name, e->name, sizeof(hdr.name) - 1);
+	snprintf(hdr.mode, sizeof(hdr.mode), "%07o", 0644);
+	snprintf(hdr.uid, sizeof(hdr.uid), "%07o", 0);
+	snprintf(hdr.gid, sizeof(hdr.gid), "%07o", 0);
+	snprintf(hdr.size, sizeof(hdr.size), "%011zo", e->len);
+	snprintf(hdr.mtime, sizeof(hdr.mtime), "%011lo", (unsigned long)now);
+	hdr.typeflag = '0';
+	memcpy(hdr.magic, "ustar", 6);
+	memcpy(hdr.version, "00", 2);
+
+	memset(hdr.chksum, ' ', sizeof(hdr.chksum));
+	for (p = (const uint8_t *)&hdr; p < (const uint8_t *)(&hdr + 1); p++)
+		sum += *p;
+	snprintf(hdr.chksum, sizeof(hdr.chksum) - 1, "%06o", sum);
+
+	fwrite(&hdr, sizeof(hdr), 1, file);
+	fwrite(e->data, 1, e->len, file);
+	if (e->len % 512)
+		fwrite(zeros, 1, 512 - e->len % 512, file);
+}
+
+static void tar_write(const char *filename)
+{
+	static const char zeros[1024];
+	time_t now = time(NULL);
+	FILE *file;
+	int n;
+
+	if (strcmp(filename, "-") == 0)
+		file = stdout;
+	else
+		file = fopen(filename, "w");
+	if (file == NULL)
+		err(1, "%s", filename);
+
+	for (n = 0; n < num_entries; n++)
+		tar_write_entry(file, &entries[n], now);
+	fwrite(zeros, 1, sizeof(zeros), file);
+
+	if (file != stdout && fclose(file))
+		err(1, "writing %s", filename);
+}
+
+static uint64_t monotonic_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static const char *find_i915_debugfs(char *path, size_t size)
+{
+	static const char *roots[] = { "/sys/kernel/debug/dri", "/debug/dri" };
+	unsigned int i;
+
+	for (i = 0; i < sizeof(roots) / sizeof(roots[0]); i++) {
+		struct dirent *dirent;
+		DIR *dir;
+
+		dir = opendir(roots[i]);
+		if (dir == NULL)
+			continue;
+
+		while ((dirent = readdir(dir))) {
+			struct stat st;
+
+			snprintf(path, size, "%s/%s/i915_error_state",
+				 roots[i], dirent->d_name);
+			if (stat(path, &st) == 0) {
+				snprintf(path, size, "%s/%s",
+					 roots[i], dirent->d_name);
+				closedir(dir);
+				return path;
+			}
+		}
+
+		closedir(dir);
+	}
+
+	return NULL;
+}
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [-o FILE]\n"
+	       "Snapshot i915 debugfs, module parameters and the dmesg ring "
+	       "into a tar archive.\n\n"
+	       "  -o FILE   output archive (default: intel_gpu_snapshot.tar, "
+	       "- for stdout)\n"
+	       "  -h        show this help\n",
+	       name);
+}
+
+int main(int argc, char **argv)
+{
+	const char *output = "intel_gpu_snapshot.tar";
+	pthread_t threads[SNAPSHOT_THREADS];
+	char debugfs[PATH_MAX];
+	uint64_t start;
+	size_t total = 0;
+	int c, n;
+
+	while ((c = getopt(argc, argv, "o:h")) != -1) {
+		switch (c) {
+		case 'o':
+			output = optarg;
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (find_i915_debugfs(debugfs, sizeof(debugfs)) == NULL)
+		errx(1, "i915 debugfs path not found");
+
+	start = monotonic_ms();
+
+	snapshot_open_dir(debugfs, "debugfs", "i915_error_state");
+	snapshot_open_dir("/sys/module/i915/parameters", "mod_opts", NULL);
+
+	for (n = 0; n < SNAPSHOT_THREADS; n++)
+		pthread_create(&threads[n], NULL, snapshot_worker, NULL);
+
+	snapshot_dmesg();
+
+	for (n = 0; n < SNAPSHOT_THREADS; n++)
+		pthread_join(threads[n], NULL);
+
+	for (n = 0; n < num_entries; n++)
+		total += entries[n].len;
+
+	fprintf(stderr, "captured %d files (%zu KiB) in %" PRIu64 " ms\n",
+		num_entries, total / 1024, monotonic_ms() - start);
+
+	tar_write(output);
+
+	return 0;
+}
@@ -26,20 +26,60 @@
  *
  */
 
-#include <unistd.h>
-#include <signal.h>
+#include <dirent.h>
+#include <inttypes.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
 #include <sys/time.h>
 #include <sys/resource.h>
 #include <sys/wait.h>
 
+#include "igt_perf.h"
 #include "intel_io.h"
 #include "intel_chipset.h"
 #include "intel_reg.h"
 
 #define SAMPLES_PER_SEC             10000
 
+/* Preferred over MMIO ring sampling: the kernel accumulates per-engine
+ * busy times for us, so we neither perturb the workload with forcewake
+ * nor miss batches shorter than our sampling interval.
+ */
+#define MAX_PMU_RINGS 8
+
+#define __I915_PERF_RING(n) (4*n)
+#define I915_PERF_RING_BUSY(n) (__I915_PERF_RING(n) + 0)
+
+static struct pmu_ring {
+	const char *name;
+	int idx;
+} pmu_rings[MAX_PMU_RINGS];
+static struct igt_perf_group *pmu_group;
+static int pmu_num_rings;
+
+/* Whole-system counters still charge the job for everything else that
+ * happens to run alongside it. With -f we instead follow the child's
+ * DRM file descriptors through /proc/<pid>/fdinfo, where the kernel
+ * reports the busy time accumulated by each client on each engine, and
+ * bill only those. The totals are monotonic per client, so we only have
+ * to keep the most recent snapshot of each client we have ever seen;
+ * the price is that an fd closed between two polls keeps the totals of
+ * the last poll, and that only the direct child is followed.
+ */
+#define MAX_FOLLOW_ENGINES 8
+#define MAX_FOLLOW_CLIENTS 64
+
+static struct follow_client {
+	unsigned long id;
+	uint64_t busy[MAX_FOLLOW_ENGINES];
+} follow_clients[MAX_FOLLOW_CLIENTS];
+static char follow_engines[MAX_FOLLOW_ENGINES][16];
+static int follow_num_engines, follow_num_clients;
+
 static volatile int goddo;
 
 static pid_t spawn(char **argv)
@@ -59,54 +99,274 @@ static void sighandler(int sig)
 	goddo = sig;
 }
 
+static int pmu_init(void)
+{
+	const char *names[] = {
+		"render",
+		"blitter",
+		"bitstream",
+		"bitstream2",
+		NULL,
+	};
+	int n;
+
+	pmu_group = igt_perf_group_new();
+	if (!pmu_group)
+		return -1;
+
+	for (n = 0; names[n]; n++) {
+		int idx;
+
+		idx = igt_perf_group_add_config(pmu_group, names[n],
+						I915_PERF_RING_BUSY(n));
+		if (idx < 0)
+			continue;
+
+		pmu_rings[pmu_num_rings].name = names[n];
+		pmu_rings[pmu_num_rings].idx = idx;
+		pmu_num_rings++;
+	}
+
+	if (pmu_num_rings == 0) {
+		igt_perf_group_free(pmu_group);
+		pmu_group = NULL;
+		return -1;
+	}
+
+	return igt_perf_group_sample(pmu_group);
+}
+
+static int follow_engine(const char *name)
+{
+	int n;
+
+	for (n = 0; n < follow_num_engines; n++)
+		if (!strcmp(follow_engines[n], name))
+			return n;
+
+	if (follow_num_engines == MAX_FOLLOW_ENGINES)
+		return -1;
+
+	strncpy(follow_engines[follow_num_engines], name,
+		sizeof(follow_engines[0]) - 1);
+	return follow_num_engines++;
+}
+
+static struct follow_client *follow_client(unsigned long id)
+{
+	int n;
+
+	for (n = 0; n < follow_num_clients; n++)
+		if (follow_clients[n].id == id)
+			return &follow_clients[n];
+
+	if (follow_num_clients == MAX_FOLLOW_CLIENTS)
+		return NULL;
+
+	follow_clients[follow_num_clients].id = id;
+	return &follow_clients[follow_num_clients++];
+}
+
+static void follow_parse_fd(const char *path)
+{
+	uint64_t busy[MAX_FOLLOW_ENGINES];
+	int seen[MAX_FOLLOW_ENGINES];
+	struct follow_client *client;
+	unsigned long id = 0;
+	char line[128];
+	int have_id = 0, n;
+	FILE *file;
+
+	file = fopen(path, "r");
+	if (file == NULL)
+		return;
+
+	memset(seen, 0, sizeof(seen));
+	while (fgets(line, sizeof(line), file)) {
+		char name[16];
+		uint64_t val;
+
+		if (sscanf(line, "drm-client-id: %lu", &id) == 1) {
+			have_id = 1;
+			continue;
+		}
+
+		if (sscanf(line, "drm-engine-%15[^:]: %" SCNu64 " ns",
+			   name, &val) == 2) {
+			n = follow_engine(name);
+			if (n >= 0) {
+				busy[n] = val;
+				seen[n] = 1;
+			}
+		}
+	}
+	fclose(file);
+
+	/* not a DRM fd, or a kernel without per-client accounting */
+	if (!have_id)
+		return;
+
+	client = follow_client(id);
+	if (client == NULL)
+		return;
+
+	for (n = 0; n < follow_num_engines; n++)
+		if (seen[n])
+			client->busy[n] = busy[n];
+}
+
+static void follow_sample(pid_t pid)
+{
+	char path[256];
+	struct dirent *de;
+	DIR *dir;
+
+	snprintf(path, sizeof(path), "/proc/%d/fdinfo", pid);
+	dir = opendir(path);
+	if (dir == NULL)
+		return;
+
+	while ((de = readdir(dir)) != NULL) {
+		if (de->d_name[0] == '.')
+			continue;
+
+		snprintf(path, sizeof(path), "/proc/%d/fdinfo/%s",
+			 pid, de->d_name);
+		follow_parse_fd(path);
+	}
+	closedir(dir);
+}
+
+static uint64_t follow_busy(int engine)
+{
+	uint64_t total = 0;
+	int n;
+
+	for (n = 0; n < follow_num_clients; n++)
+		total += follow_clients[n].busy[engine];
+
+	return total;
+}
+
 int main(int argc, char **argv)
 {
 	pid_t child;
 	uint64_t ring_idle = 0, ring_time = 0;
 	struct timeval start, end;
 	static struct rusage rusage;
+	double elapsed;
+	int follow = 0;
 	int status;
+	int n, c;
 
-	intel_mmio_use_pci_bar(intel_get_pci_device());
+	while ((c = getopt(argc, argv, "+fh")) != -1) {
+		switch (c) {
+		case 'f':
+			follow = 1;
+			break;
+		case 'h':
+		default:
+			fprintf(stderr, "usage: %s [-f] cmd [args...]\n"
+				"\t-f\taccount only work submitted through the child's fds\n",
+				argv[0]);
+			return c == 'h' ? 0 : 1;
+		}
+	}
 
-	if (argc == 1) {
-		fprintf(stderr, "usage: %s cmd [args...]\n", argv[0]);
+	if (optind == argc) {
+		fprintf(stderr, "usage: %s [-f] cmd [args...]\n", argv[0]);
 		return 1;
 	}
 
+	if (!follow && pmu_init())
+		intel_mmio_use_pci_bar(intel_get_pci_device());
+
 	signal(SIGCHLD, sighandler);
 	signal(SIGINT, SIG_IGN);
 	signal(SIGQUIT, SIG_IGN);
 
 	gettimeofday(&start, NULL);
-	child = spawn(argv+1);
+	child = spawn(argv + optind);
 	if (child < 0)
 		return 127;
 
 	while (!goddo) {
-		uint32_t ring_head, ring_tail;
+		if (follow) {
+			follow_sample(child);
+			usleep(1000000 / 100);
+		} else if (pmu_group) {
+			/* the kernel keeps count; just wait for the child */
+			usleep(1000000 / 10);
+		} else {
+			uint32_t ring_head, ring_tail;
 
-		ring_head = INREG(LP_RING + RING_HEAD) & HEAD_ADDR;
-		ring_tail = INREG(LP_RING + RING_TAIL) & TAIL_ADDR;
+			ring_head = INREG(LP_RING + RING_HEAD) & HEAD_ADDR;
+			ring_tail = INREG(LP_RING + RING_TAIL) & TAIL_ADDR;
 
-		if (ring_tail == ring_head)
-			ring_idle++;
-		ring_time++;
+			if (ring_tail == ring_head)
+				ring_idle++;
+			ring_time++;
 
-		usleep(1000000 / SAMPLES_PER_SEC);
+			usleep(1000000 / SAMPLES_PER_SEC);
+		}
 	}
+	if (pmu_group)
+		igt_perf_group_sample(pmu_group);
 	gettimeofday(&end, NULL);
 	timersub(&end, &start, &end);
 
 	waitpid(child, &status, 0);
 
+	elapsed = end.tv_sec + 1e-6 * end.tv_usec;
 	getrusage(RUSAGE_CHILDREN, &rusage);
-	printf("user: %ld.%06lds, sys: %ld.%06lds, elapsed: %ld.%06lds, CPU: %.1f%%, GPU: %.1f%%\n",
+	printf("user: %ld.%06lds, sys: %ld.%06lds, elapsed: %ld.%06lds, CPU: %.1f%%",
 	       rusage.ru_utime.tv_sec, rusage.ru_utime.tv_usec,
 	       rusage.ru_stime.tv_sec, rusage.ru_stime.tv_usec,
 	       end.tv_sec, end.tv_usec,
-	       100*(rusage.ru_utime.tv_sec + 1e-6*rusage.ru_utime.tv_usec + rusage.ru_stime.tv_sec + 1e-6*rusage.ru_stime.tv_usec) / (end.tv_sec + 1e-6*end.tv_usec),
-	       100 - ring_idle * 100. / ring_time);
+	       100*(rusage.ru_utime.tv_sec + 1e-6*rusage.ru_utime.tv_usec + rusage.ru_stime.tv_sec + 1e-6*rusage.ru_stime.tv_usec) / elapsed);
+
+	if (follow) {
+		uint64_t total = 0;
+
+		printf("\n");
+		for (n = 0; n < follow_num_engines; n++) {
+			uint64_t busy = follow_busy(n);
+
+			printf("%12s: %.6fs busy (%.1f%%)\n",
+			       follow_engines[n], 1e-9 * busy,
+			       1e-9 * busy * 100 / elapsed);
+			total += busy;
+		}
+		if (follow_num_engines == 0)
+			printf("no DRM clients seen; does the kernel report per-client engine busyness?\n");
+		else
+			printf("GPU seconds consumed: %.6fs\n", 1e-9 * total);
+	} else if (pmu_group) {
+		double max = 0;
+
+		for (n = 0; n < pmu_num_rings; n++) {
+			double busy;
+
+			busy = igt_perf_group_delta(pmu_group,
+						    pmu_rings[n].idx);
+			if (busy > max)
+				max = busy;
+		}
+		printf(", GPU: %.1f%%\n", 1e-9 * max * 100 / elapsed);
+
+		for (n = 0; n < pmu_num_rings; n++) {
+			uint64_t busy;
+
+			busy = igt_perf_group_delta(pmu_group,
+						    pmu_rings[n].idx);
+			printf("%12s: %.6fs busy (%.1f%%)\n",
+			       pmu_rings[n].name, 1e-9 * busy,
+			       1e-9 * busy * 100 / elapsed);
+		}
+	} else {
+		printf(", GPU: %.1f%%\n",
+		       100 - ring_idle * 100. / ring_time);
+	}
 
 	return WEXITSTATUS(status);
 }
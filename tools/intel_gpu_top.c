@@ -35,19 +35,26 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <err.h>
+#include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/syscall.h>
 #include <sys/time.h>
 #include <sys/wait.h>
 #include <string.h>
+#include <linux/perf_event.h>
 #ifdef HAVE_TERMIOS_H
 #include <termios.h>
 #endif
+#include "igt_perf.h"
 #include "intel_io.h"
 #include "instdone.h"
 #include "intel_reg.h"
 #include "intel_chipset.h"
 #include "drmtest.h"
 
+#include "overlay/debugfs.h"
+#include "overlay/gem-interrupts.h"
+
 #define  FORCEWAKE	    0xA18C
 #define  FORCEWAKE_ACK	    0x130090
 
@@ -59,7 +66,7 @@
 #define HAS_STATS_REGS(devid)		IS_965(devid)
 
 struct top_bit {
-	struct instdone_bit *bit;
+	const struct instdone_bit *bit;
 	int count;
 } top_bits[MAX_NUM_TOP_BITS];
 struct top_bit *top_bits_sorted[MAX_NUM_TOP_BITS];
@@ -311,6 +318,283 @@ print_percentage_bar(float percent, int cur_line_len)
 	printf("%*s", PERCENTAGE_BAR_END - cur_line_len, "");
 }
 
+/* The i915 perf PMU exposes per-ring busy/wait/sema counters that the
+ * kernel accumulates for us, so we can report utilisation without
+ * holding forcewake and hammering the ring registers from userspace
+ * (which perturbs the very workload we are trying to observe, and
+ * keeps the GPU out of its power saving states).  Probe it first and
+ * only fall back to MMIO sampling on old kernels. All the counters
+ * live in one igt_perf group, so a sample is a single read() and the
+ * rings within it are mutually consistent.
+ */
+
+#define MAX_PMU_RINGS 16
+
+#define __I915_PERF_RING(n) (4*n)
+#define I915_PERF_RING_BUSY(n) (__I915_PERF_RING(n) + 0)
+#define I915_PERF_RING_WAIT(n) (__I915_PERF_RING(n) + 1)
+#define I915_PERF_RING_SEMA(n) (__I915_PERF_RING(n) + 2)
+
+struct pmu_top {
+	struct igt_perf_group *group;
+	int num_rings;
+	int have_wait;
+	int have_sema;
+
+	struct pmu_ring {
+		const char *name;
+		int busy_idx, wait_idx, sema_idx;
+		int busy, wait, sema;
+	} ring[MAX_PMU_RINGS];
+};
+
+static int pmu_init(struct pmu_top *pmu)
+{
+	const char *names[] = {
+		"render",
+		"blitter",
+		"bitstream",
+		"bitstream2",
+		NULL,
+	};
+	int n;
+
+	memset(pmu, 0, sizeof(*pmu));
+
+	pmu->group = igt_perf_group_new();
+	if (!pmu->group)
+		return -1;
+
+	pmu->ring[0].busy_idx =
+		igt_perf_group_add_config(pmu->group, "render-busy",
+					  I915_PERF_RING_BUSY(0));
+	if (pmu->ring[0].busy_idx < 0)
+		goto err;
+
+	pmu->ring[0].wait_idx =
+		igt_perf_group_add_config(pmu->group, "render-wait",
+					  I915_PERF_RING_WAIT(0));
+	pmu->have_wait = pmu->ring[0].wait_idx >= 0;
+
+	pmu->ring[0].sema_idx =
+		igt_perf_group_add_config(pmu->group, "render-sema",
+					  I915_PERF_RING_SEMA(0));
+	pmu->have_sema = pmu->ring[0].sema_idx >= 0;
+
+	pmu->ring[0].name = names[0];
+	pmu->num_rings = 1;
+
+	for (n = 1; names[n]; n++) {
+		struct pmu_ring *ring = &pmu->ring[pmu->num_rings];
+
+		ring->busy_idx =
+			igt_perf_group_add_config(pmu->group, names[n],
+						  I915_PERF_RING_BUSY(n));
+		if (ring->busy_idx < 0)
+			continue;
+
+		if (pmu->have_wait) {
+			ring->wait_idx =
+				igt_perf_group_add_config(pmu->group, names[n],
+							  I915_PERF_RING_WAIT(n));
+			if (ring->wait_idx < 0)
+				goto err;
+		}
+
+		if (pmu->have_sema) {
+			ring->sema_idx =
+				igt_perf_group_add_config(pmu->group, names[n],
+							  I915_PERF_RING_SEMA(n));
+			if (ring->sema_idx < 0)
+				goto err;
+		}
+
+		ring->name = names[n];
+		pmu->num_rings++;
+	}
+
+	return 0;
+
+err:
+	igt_perf_group_free(pmu->group);
+	pmu->group = NULL;
+	return -1;
+}
+
+static int pmu_sample(struct pmu_top *pmu)
+{
+	uint64_t d_time;
+	int n;
+
+	if (igt_perf_group_sample(pmu->group))
+		return 0;
+
+	d_time = igt_perf_group_elapsed(pmu->group);
+	if (!d_time)
+		return 0;
+
+	for (n = 0; n < pmu->num_rings; n++) {
+		struct pmu_ring *ring = &pmu->ring[n];
+
+		ring->busy = (100 * igt_perf_group_delta(pmu->group,
+							 ring->busy_idx) +
+			      d_time/2) / d_time;
+		if (pmu->have_wait)
+			ring->wait = (100 * igt_perf_group_delta(pmu->group,
+								 ring->wait_idx) +
+				      d_time/2) / d_time;
+		if (pmu->have_sema)
+			ring->sema = (100 * igt_perf_group_delta(pmu->group,
+								 ring->sema_idx) +
+				      d_time/2) / d_time;
+
+		/* in case of rounding + sampling errors, fudge */
+		if (ring->busy > 100)
+			ring->busy = 100;
+		if (ring->wait > 100)
+			ring->wait = 100;
+		if (ring->sema > 100)
+			ring->sema = 100;
+	}
+
+	return 1;
+}
+
+static void pmu_ring_print(struct pmu_top *pmu, struct pmu_ring *ring)
+{
+	int len;
+
+	len = printf("%25s busy: %3d%%: ", ring->name, ring->busy);
+	print_percentage_bar(ring->busy, len);
+	if (pmu->have_wait)
+		printf("%17s wait: %3d%%", ring->name, ring->wait);
+	if (pmu->have_sema)
+		printf(", sema: %3d%%", ring->sema);
+	printf("\n");
+}
+
+static void pmu_ring_print_header(FILE *out, struct pmu_top *pmu,
+				  struct pmu_ring *ring)
+{
+	fprintf(out, "%.6s%%\t", ring->name);
+	if (pmu->have_wait)
+		fprintf(out, "wait%%\t");
+	if (pmu->have_sema)
+		fprintf(out, "sema%%\t");
+}
+
+static void pmu_ring_log(struct pmu_top *pmu, struct pmu_ring *ring,
+			 FILE *output)
+{
+	fprintf(output, "%3d\t", ring->busy);
+	if (pmu->have_wait)
+		fprintf(output, "%3d\t", ring->wait);
+	if (pmu->have_sema)
+		fprintf(output, "%3d\t", ring->sema);
+}
+
+/* Machine-readable streaming: emit one self-contained record per sample
+ * interval on stdout so the tool can feed plotting and CI scripts
+ * directly, instead of making them scrape the interactive display.
+ * Each record carries the engine busyness, the current GT frequency and
+ * the interrupt rate; a record is assembled with buffered stdio and
+ * flushed once, so readers see whole lines.
+ */
+
+enum stream_format {
+	STREAM_NONE,
+	STREAM_JSON,
+	STREAM_CSV,
+};
+
+static enum stream_format stream_format;
+
+struct stream_engine {
+	const char *name;
+	int busy, wait, sema;
+	int have_wait, have_sema;
+};
+
+static int gt_act_freq(void)
+{
+	FILE *file;
+	int freq = -1;
+
+	file = fopen("/sys/class/drm/card0/gt_act_freq_mhz", "r");
+	if (file) {
+		if (fscanf(file, "%d", &freq) != 1)
+			freq = -1;
+		fclose(file);
+	}
+
+	return freq;
+}
+
+static void stream_sample(double time, int freq,
+			  const struct gem_interrupts *irqs,
+			  const struct stream_engine *engine, int count)
+{
+	static int print_headers = 1;
+	int num_sources = irqs ? irqs->num_sources : 0;
+	int n;
+
+	if (stream_format == STREAM_CSV) {
+		if (print_headers) {
+			/* sources appearing after the header get no column */
+			printf("time,freq-mhz,irqs");
+			for (n = 0; n < num_sources; n++)
+				printf(",irq-%s", irqs->source[n].name);
+			for (n = 0; n < count; n++) {
+				printf(",%s-busy", engine[n].name);
+				if (engine[n].have_wait)
+					printf(",%s-wait", engine[n].name);
+				if (engine[n].have_sema)
+					printf(",%s-sema", engine[n].name);
+			}
+			printf("\n");
+			print_headers = 0;
+		}
+
+		printf("%.2f,%d,%lld", time, freq,
+		       irqs ? (long long)irqs->delta : -1LL);
+		for (n = 0; n < num_sources; n++)
+			printf(",%lu", irqs->source[n].delta);
+		for (n = 0; n < count; n++) {
+			printf(",%d", engine[n].busy);
+			if (engine[n].have_wait)
+				printf(",%d", engine[n].wait);
+			if (engine[n].have_sema)
+				printf(",%d", engine[n].sema);
+		}
+		printf("\n");
+	} else {
+		printf("{ \"time\": %.2f, \"freq-mhz\": %d, \"irqs\": %lld",
+		       time, freq, irqs ? (long long)irqs->delta : -1LL);
+		if (num_sources) {
+			printf(", \"irq-sources\": {");
+			for (n = 0; n < num_sources; n++)
+				printf("%s \"%s\": %lu",
+				       n ? "," : "",
+				       irqs->source[n].name,
+				       irqs->source[n].delta);
+			printf(" }");
+		}
+		printf(", \"engines\": {");
+		for (n = 0; n < count; n++) {
+			printf("%s \"%s\": { \"busy\": %d",
+			       n ? "," : "", engine[n].name, engine[n].busy);
+			if (engine[n].have_wait)
+				printf(", \"wait\": %d", engine[n].wait);
+			if (engine[n].have_sema)
+				printf(", \"sema\": %d", engine[n].sema);
+			printf(" }");
+		}
+		printf(" } }\n");
+	}
+
+	fflush(stdout);
+}
+
 struct ring {
 	const char *name;
 	uint32_t mmio;
@@ -400,6 +684,8 @@ usage(const char *appname)
 			"[-e <command>]       command to profile\n"
 			"[-o <file>]          output statistics to file. If file is '-',"
 			"                     run in batch mode and output statistics to stdio only \n"
+			"[-J]                 stream one JSON record per sample interval to stdout\n"
+			"[-c]                 stream one CSV record per sample interval to stdout\n"
 			"[-h]                 show this help screen\n"
 			"\n",
 			appname,
@@ -426,6 +712,10 @@ int main(int argc, char **argv)
 		.name = "blitter",
 		.mmio = 0x22030,
 	};
+	struct pmu_top pmu;
+	int use_pmu;
+	struct gem_interrupts irqs;
+	int has_irqs = 0;
 	int i, ch;
 	int samples_per_sec = SAMPLES_PER_SEC;
 	FILE *output = NULL;
@@ -437,10 +727,16 @@ int main(int argc, char **argv)
 	int interactive=1;
 
 	/* Parse options? */
-	while ((ch = getopt(argc, argv, "s:o:e:h")) != -1) {
+	while ((ch = getopt(argc, argv, "s:o:e:Jch")) != -1) {
 		switch (ch) {
 		case 'e': cmd = strdup(optarg);
 			break;
+		case 'J': stream_format = STREAM_JSON;
+			interactive = 0;
+			break;
+		case 'c': stream_format = STREAM_CSV;
+			interactive = 0;
+			break;
 		case 's': samples_per_sec = atoi(optarg);
 			if (samples_per_sec < 100) {
 				fprintf(stderr, "Error: samples per second must be >= 100\n");
@@ -473,10 +769,19 @@ int main(int argc, char **argv)
 		}
 	}
 
+	if (stream_format) {
+		debugfs_init();
+		has_irqs = gem_interrupts_init(&irqs) == 0;
+	}
+
+	use_pmu = pmu_init(&pmu) == 0;
+
 	pci_dev = intel_get_pci_device();
 	devid = pci_dev->device_id;
-	intel_mmio_use_pci_bar(pci_dev);
-	init_instdone_definitions(devid);
+	if (!use_pmu) {
+		intel_mmio_use_pci_bar(pci_dev);
+		init_instdone_definitions(devid);
+	}
 
 	/* Do we have a command to run? */
 	if (cmd != NULL) {
@@ -506,6 +811,86 @@ int main(int argc, char **argv)
 		}
 	}
 
+	if (use_pmu) {
+		char clear_screen[] = {0x1b, '[', 'H',
+				       0x1b, '[', 'J',
+				       0x0};
+
+		for (;;) {
+			unsigned long long t1 = gettime();
+
+			usleep(1000000);
+
+			if (!pmu_sample(&pmu))
+				continue;
+
+			elapsed_time += (gettime() - t1) / 1000000.0;
+
+			if (stream_format) {
+				struct stream_engine engine[MAX_PMU_RINGS];
+
+				if (has_irqs) {
+					int err = gem_interrupts_update(&irqs);
+					if (err && err != EAGAIN)
+						has_irqs = 0;
+				}
+
+				for (i = 0; i < pmu.num_rings; i++) {
+					engine[i].name = pmu.ring[i].name;
+					engine[i].busy = pmu.ring[i].busy;
+					engine[i].wait = pmu.ring[i].wait;
+					engine[i].sema = pmu.ring[i].sema;
+					engine[i].have_wait = pmu.have_wait;
+					engine[i].have_sema = pmu.have_sema;
+				}
+
+				stream_sample(elapsed_time, gt_act_freq(),
+					      has_irqs ? &irqs : NULL,
+					      engine, pmu.num_rings);
+			}
+
+			if (interactive) {
+				printf("%s", clear_screen);
+				print_clock_info(pci_dev);
+
+				for (i = 0; i < pmu.num_rings; i++)
+					pmu_ring_print(&pmu, &pmu.ring[i]);
+			}
+
+			if (output) {
+				if (print_headers) {
+					fprintf(output, "# time\t");
+					for (i = 0; i < pmu.num_rings; i++)
+						pmu_ring_print_header(output, &pmu, &pmu.ring[i]);
+					fprintf(output, "\n");
+					print_headers = 0;
+				}
+
+				fprintf(output, "%.2f\t", elapsed_time);
+				for (i = 0; i < pmu.num_rings; i++)
+					pmu_ring_log(&pmu, &pmu.ring[i], output);
+				fprintf(output, "\n");
+				fflush(output);
+			}
+
+			if (child_pid > 0) {
+				int res;
+				if ((res = waitpid(child_pid, &child_stat, WNOHANG)) == -1) {
+					perror("waitpid");
+					exit(1);
+				}
+				if (res == 0)
+					continue;
+				if (WIFEXITED(child_stat))
+					break;
+			}
+		}
+
+		if (output)
+			fclose(output);
+		return 0;
+	}
+
 	for (i = 0; i < num_instdone_bits; i++) {
 		top_bits[i].bit = &instdone_bits[i];
 		top_bits[i].count = 0;
@@ -619,6 +1004,34 @@ int main(int argc, char **argv)
 		t2 = gettime();
 		elapsed_time += (t2 - t1) / 1000000.0;
 
+		if (stream_format) {
+			struct ring *rings[] = {
+				&render_ring, &bsd_ring, &bsd6_ring, &blt_ring,
+			};
+			struct stream_engine engine[4];
+			int count = 0;
+
+			if (has_irqs) {
+				int err = gem_interrupts_update(&irqs);
+				if (err && err != EAGAIN)
+					has_irqs = 0;
+			}
+
+			for (i = 0; i < 4; i++) {
+				if (!rings[i]->size)
+					continue;
+
+				memset(&engine[count], 0, sizeof(engine[count]));
+				engine[count].name = rings[i]->name;
+				engine[count].busy = 100 - 100 * rings[i]->idle / last_samples_per_sec;
+				count++;
+			}
+
+			stream_sample(elapsed_time, gt_act_freq(),
+				      has_irqs ? &irqs : NULL,
+				      engine, count);
+		}
+
 		if (interactive) {
 			printf("%s", clear_screen);
 			print_clock_info(pci_dev);
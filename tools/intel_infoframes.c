@@ -26,10 +26,13 @@
  */
 
 #include <assert.h>
+#include <signal.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <getopt.h>
+#include <unistd.h>
 #include "intel_io.h"
 #include "intel_chipset.h"
 #include "drmtest.h"
@@ -354,6 +357,39 @@ static void load_infoframe(Transcoder transcoder, DipInfoFrame *frame,
 	}
 }
 
+/* Snapshot of everything the dump path decodes for one transcoder: the
+ * DIP control register and the four infoframe buffers. All the register
+ * reads happen in one burst here, so the decode and printing below work
+ * from the copy instead of going back to the hardware per field.
+ */
+struct transcoder_snapshot {
+	uint32_t ctl;
+	DipInfoFrame frame[4];
+};
+
+static const uint32_t dip_enable_bits[4] = {
+	[DIP_AVI]    = DIP_CTL_AVI_ENABLE,
+	[DIP_VENDOR] = DIP_CTL_VENDOR_ENABLE,
+	[DIP_GAMUT]  = DIP_CTL_GAMUT_ENABLE,
+	[DIP_SPD]    = DIP_CTL_SPD_ENABLE,
+};
+
+static void snapshot_transcoder(Transcoder transcoder,
+				struct transcoder_snapshot *snap)
+{
+	DipType type;
+
+	memset(snap, 0, sizeof(*snap));
+	snap->ctl = INREG(get_dip_ctl_reg(transcoder));
+
+	if (!(snap->ctl & DIP_CTL_ENABLE))
+		return;
+
+	for (type = DIP_AVI; type < DIP_INVALID; type++)
+		if (snap->ctl & dip_enable_bits[type])
+			load_infoframe(transcoder, &snap->frame[type], type);
+}
+
 static int infoframe_valid_checksum(DipInfoFrame *frame)
 {
 	int i;
@@ -382,10 +418,8 @@ static void infoframe_fix_checksum(DipInfoFrame *frame)
 	frame->generic.body[0] = 0x100 - csum;
 }
 
-static void dump_port_info(int hdmi_port_index)
+static void dump_port_info(int hdmi_port_index, uint32_t val)
 {
-	Register port = get_hdmi_port(hdmi_port_index);
-	uint32_t val = INREG(port);
 	Transcoder transcoder;
 
 	printf("\nPort %s:\n", hdmi_port_names[hdmi_port_index]);
@@ -430,15 +464,11 @@ static void dump_raw_infoframe(DipInfoFrame *frame)
 	printf("\n");
 }
 
-static void dump_avi_info(Transcoder transcoder)
+static void dump_avi_info(const struct transcoder_snapshot *snap)
 {
-	Register reg = get_dip_ctl_reg(transcoder);
-	uint32_t val;
+	uint32_t val = snap->ctl;
 	DipFrequency freq;
-	DipInfoFrame frame;
-
-	load_infoframe(transcoder, &frame, DIP_AVI);
-	val = INREG(reg);
+	DipInfoFrame frame = snap->frame[DIP_AVI];
 
 	printf("AVI InfoFrame:\n");
 
@@ -529,15 +559,11 @@ static void dump_vendor_hdmi(DipInfoFrame *frame)
 	}
 }
 
-static void dump_vendor_info(Transcoder transcoder)
+static void dump_vendor_info(const struct transcoder_snapshot *snap)
 {
-	Register reg = get_dip_ctl_reg(transcoder);
-	uint32_t val, vendor_id;
+	uint32_t val = snap->ctl, vendor_id;
 	DipFrequency freq;
-	DipInfoFrame frame;
-
-	load_infoframe(transcoder, &frame, DIP_VENDOR);
-	val = INREG(reg);
+	DipInfoFrame frame = snap->frame[DIP_VENDOR];
 
 	printf("Vendor InfoFrame:\n");
 
@@ -564,15 +590,11 @@ static void dump_vendor_info(Transcoder transcoder)
 		printf("Invalid InfoFrame checksum!\n");
 }
 
-static void dump_gamut_info(Transcoder transcoder)
+static void dump_gamut_info(const struct transcoder_snapshot *snap)
 {
-	Register reg = get_dip_ctl_reg(transcoder);
-	uint32_t val;
+	uint32_t val = snap->ctl;
 	DipFrequency freq;
-	DipInfoFrame frame;
-
-	load_infoframe(transcoder, &frame, DIP_GAMUT);
-	val = INREG(reg);
+	DipInfoFrame frame = snap->frame[DIP_GAMUT];
 
 	printf("Gamut InfoFrame:\n");
 
@@ -590,18 +612,14 @@ static void dump_gamut_info(Transcoder transcoder)
 		printf("Invalid InfoFrame checksum!\n");
 }
 
-static void dump_spd_info(Transcoder transcoder)
+static void dump_spd_info(const struct transcoder_snapshot *snap)
 {
-	Register reg = get_dip_ctl_reg(transcoder);
-	uint32_t val;
+	uint32_t val = snap->ctl;
 	DipFrequency freq;
-	DipInfoFrame frame;
+	DipInfoFrame frame = snap->frame[DIP_SPD];
 	char vendor[9];
 	char description[17];
 
-	load_infoframe(transcoder, &frame, DIP_SPD);
-	val = INREG(reg);
-
 	printf("SPD InfoFrame:\n");
 
 	if (gen == 4) {
@@ -632,10 +650,10 @@ static void dump_spd_info(Transcoder transcoder)
 		printf("Invalid InfoFrame checksum!\n");
 }
 
-static void dump_transcoder_info(Transcoder transcoder)
+static void dump_transcoder_info(Transcoder transcoder,
+				 const struct transcoder_snapshot *snap)
 {
-	Register reg = get_dip_ctl_reg(transcoder);
-	uint32_t val = INREG(reg);
+	uint32_t val = snap->ctl;
 
 	if (gen == 4) {
 		printf("\nDIP information:\n");
@@ -660,33 +678,100 @@ static void dump_transcoder_info(Transcoder transcoder)
 	       "enabled" : "disabled");
 
 	if (val & DIP_CTL_AVI_ENABLE)
-		dump_avi_info(transcoder);
+		dump_avi_info(snap);
 	if (val & DIP_CTL_VENDOR_ENABLE)
-		dump_vendor_info(transcoder);
+		dump_vendor_info(snap);
 	if (val & DIP_CTL_GAMUT_ENABLE)
-		dump_gamut_info(transcoder);
+		dump_gamut_info(snap);
 	if (val & DIP_CTL_SPD_ENABLE)
-		dump_spd_info(transcoder);
+		dump_spd_info(snap);
 }
 
-static void dump_all_info(void)
+static void get_port_transcoder_counts(unsigned int *num_ports,
+				       unsigned int *num_transcoders)
 {
-	unsigned int i;
-
 	if (IS_VALLEYVIEW(pci_dev->device_id)) {
-		for (i = 0; i < ARRAY_SIZE(vlv_hdmi_ports); i++)
-			dump_port_info(i);
-		for (i = 0; i < ARRAY_SIZE(vlv_dip_ctl_regs); i++)
-			dump_transcoder_info(i);
+		*num_ports = ARRAY_SIZE(vlv_hdmi_ports);
+		*num_transcoders = ARRAY_SIZE(vlv_dip_ctl_regs);
 	} else if (gen == 4) {
-		for (i = 0; i < ARRAY_SIZE(gen4_hdmi_ports); i++)
-			dump_port_info(i);
-		dump_transcoder_info(0);
+		*num_ports = ARRAY_SIZE(gen4_hdmi_ports);
+		*num_transcoders = 1;
 	} else {
-		for (i = 0; i < ARRAY_SIZE(pch_hdmi_ports); i++)
-			dump_port_info(i);
-		for (i = 0; i < ARRAY_SIZE(pch_dip_ctl_regs); i++)
-			dump_transcoder_info(i);
+		*num_ports = ARRAY_SIZE(pch_hdmi_ports);
+		*num_transcoders = ARRAY_SIZE(pch_dip_ctl_regs);
+	}
+}
+
+static void snapshot_all(uint32_t *port_val, struct transcoder_snapshot *snap,
+			 unsigned int num_ports, unsigned int num_transcoders)
+{
+	unsigned int i;
+
+	for (i = 0; i < num_ports; i++)
+		port_val[i] = INREG(get_hdmi_port(i));
+	for (i = 0; i < num_transcoders; i++)
+		snapshot_transcoder(i, &snap[i]);
+}
+
+static void dump_all_info(void)
+{
+	struct transcoder_snapshot snap[3];
+	uint32_t port_val[3];
+	unsigned int num_ports, num_transcoders, i;
+
+	get_port_transcoder_counts(&num_ports, &num_transcoders);
+	snapshot_all(port_val, snap, num_ports, num_transcoders);
+
+	for (i = 0; i < num_ports; i++)
+		dump_port_info(i, port_val[i]);
+	for (i = 0; i < num_transcoders; i++)
+		dump_transcoder_info(i, &snap[i]);
+}
+
+static volatile bool quit;
+
+static void sighandler(int sig)
+{
+	quit = true;
+}
+
+/* Keep taking snapshots and only decode what changed since the previous
+ * one, so the tool is cheap enough to leave running while poking at the
+ * kernel from elsewhere.
+ */
+static void watch_all_info(int period_ms)
+{
+	struct transcoder_snapshot snap[3], prev[3];
+	uint32_t port_val[3], prev_port[3];
+	unsigned int num_ports, num_transcoders, i;
+	bool first = true;
+
+	get_port_transcoder_counts(&num_ports, &num_transcoders);
+
+	signal(SIGINT, sighandler);
+	signal(SIGTERM, sighandler);
+
+	while (!quit) {
+		snapshot_all(port_val, snap, num_ports, num_transcoders);
+
+		for (i = 0; i < num_ports; i++) {
+			if (!first && port_val[i] == prev_port[i])
+				continue;
+			dump_port_info(i, port_val[i]);
+		}
+
+		for (i = 0; i < num_transcoders; i++) {
+			if (!first && !memcmp(&snap[i], &prev[i],
+					      sizeof(snap[i])))
+				continue;
+			dump_transcoder_info(i, &snap[i]);
+		}
+
+		memcpy(prev_port, port_val, sizeof(prev_port));
+		memcpy(prev, snap, sizeof(prev));
+		first = false;
+
+		usleep(period_ms * 1000);
 	}
 }
 
@@ -993,6 +1078,8 @@ static void print_usage(void)
 printf("Options:\n"
 "  -d, --dump\n"
 "          dump information about all transcoders\n"
+"  -w, --watch [period]\n"
+"          keep dumping, but only what changed, every period ms (^C stops)\n"
 "  -c, --change-fields [fields]\n"
 "          change infoframe fields from selected transcoder\n"
 "  -k, --change-checksum [checksum]\n"
@@ -1087,9 +1174,10 @@ int main(int argc, char *argv[])
 	DipType dip = DIP_INVALID;
 	Register hdmi_port;
 
-	char short_opts[] = "dc:k:q:nNxXp:P:t:f:h";
+	char short_opts[] = "dw:c:k:q:nNxXp:P:t:f:h";
 	struct option long_opts[] = {
 		{ "dump",               no_argument,       NULL, 'd' },
+		{ "watch",              required_argument, NULL, 'w' },
 		{ "change-fields",      required_argument, NULL, 'c' },
 		{ "change-checksum",    required_argument, NULL, 'k' },
 		{ "change-frequency",   required_argument, NULL, 'q' },
@@ -1138,6 +1226,14 @@ int main(int argc, char *argv[])
 		case 'd':
 			dump_all_info();
 			break;
+		case 'w':
+			if (atoi(optarg) <= 0) {
+				printf("Invalid watch period.\n");
+				ret = 1;
+				goto out;
+			}
+			watch_all_info(atoi(optarg));
+			break;
 		case 'c':
 			if (transcoder == TRANSC_INVALID) {
 				printf("Transcoder not selected.\n");
@@ -58,27 +58,16 @@ static inline int num_banks(void) {
 	default: return 2;
 	}
 }
-#define NUM_SUBBANKS 8
 #define BYTES_PER_BANK (128 << 10)
 /* Each row addresses [up to] 4b. This multiplied by the number of subbanks
  * will give the L3 size per bank.
  * TODO: Row size is fixed on IVB, and variable on HSW.*/
 #define MAX_ROW (1<<12)
-#define MAX_BANKS_PER_SLICE 4
-#define NUM_REGS (MAX_BANKS_PER_SLICE * NUM_SUBBANKS)
 #define MAX_SLICES (intel_gt(devid) > 1 ? 2 : 1)
-#define REAL_MAX_SLICES 2
 /* TODO support SLM config */
 #define L3_SIZE ((MAX_ROW * 4) * NUM_SUBBANKS *  num_banks())
 
-struct __attribute__ ((__packed__)) l3_log_register {
-	uint32_t row0_enable	: 1;
-	uint32_t rsvd2		: 4;
-	uint32_t row0		: 11;
-	uint32_t row1_enable	: 1;
-	uint32_t rsvd1		: 4;
-	uint32_t row1		: 11;
-} l3logs[REAL_MAX_SLICES][MAX_BANKS_PER_SLICE][NUM_SUBBANKS];
+static struct l3_log_register l3logs[REAL_MAX_SLICES][MAX_BANKS_PER_SLICE][NUM_SUBBANKS];
 
 static int which_slice = -1;
 #define for_each_slice(__i) \
@@ -118,10 +107,8 @@ static void dumpit(int slice)
 	}
 }
 
-static int disable_rbs(int row, int bank, int sbank, int slice)
+int l3_disable_row(struct l3_log_register *reg, int row)
 {
-	struct l3_log_register *reg = &l3logs[slice][bank][sbank];
-
 	// can't map more than 2 rows
 	if (reg->row0_enable && reg->row1_enable)
 		return -1;
@@ -143,6 +130,11 @@ static int disable_rbs(int row, int bank, int sbank, int slice)
 	return 0;
 }
 
+static int disable_rbs(int row, int bank, int sbank, int slice)
+{
+	return l3_disable_row(&l3logs[slice][bank][sbank], row);
+}
+
 static void enables_rbs(int row, int bank, int sbank, int slice)
 {
 	struct l3_log_register *reg = &l3logs[slice][bank][sbank];
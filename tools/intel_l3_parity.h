@@ -4,11 +4,25 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#define NUM_SUBBANKS 8
+#define MAX_BANKS_PER_SLICE 4
+#define NUM_REGS (MAX_BANKS_PER_SLICE * NUM_SUBBANKS)
+#define REAL_MAX_SLICES 2
+
+struct __attribute__ ((__packed__)) l3_log_register {
+	uint32_t row0_enable	: 1;
+	uint32_t rsvd2		: 4;
+	uint32_t row0		: 11;
+	uint32_t row1_enable	: 1;
+	uint32_t rsvd1		: 4;
+	uint32_t row1		: 11;
+};
+
 struct l3_parity {
 	struct udev *udev;
 	struct udev_monitor *uevent_monitor;
 	int fd;
-	fd_set fdset;
+	int epoll_fd;
 };
 
 struct l3_location {
@@ -18,9 +32,14 @@ struct l3_location {
 	uint8_t subbank;
 };
 
+/* Records the row as disabled in the in-memory log register. Returns non-zero
+ * if the row is already remapped or both remapping entries are in use. */
+int l3_disable_row(struct l3_log_register *reg, int row);
+
 #ifdef HAVE_UDEV
 int l3_uevent_setup(struct l3_parity *par);
-/* Listens (blocks) for an l3 parity event. Returns the location of the error. */
+/* Listens (blocks) for l3 parity events on every GPU, remapping the failing
+ * row in-process as each event arrives. Returns the location of the error. */
 int l3_listen(struct l3_parity *par, bool daemon, struct l3_location *loc);
 #define l3_uevent_teardown(par) {}
 #else
@@ -30,12 +30,14 @@
 #ifndef _GNU_SOURCE
 #define _GNU_SOURCE
 #endif
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <assert.h>
 #include <syslog.h>
+#include <sys/epoll.h>
 #include "i915_drm.h"
 #include "intel_l3_parity.h"
 
@@ -43,12 +45,89 @@
 #define I915_L3_PARITY_UEVENT "L3_PARITY_ERROR"
 #endif
 
+/* Parity errors cluster in bursts, and re-execing intel_l3_parity for each
+ * one pays a fork/exec plus a fresh sysfs open per event. Instead the
+ * listener remediates in-process: for every GPU that reports an error we
+ * keep the l3_parity sysfs fds open and the remap tables cached in memory,
+ * so handling an event is one table update and one pwrite. A single udev
+ * monitor already carries the uevents of every DRM minor, so one epoll-driven
+ * listener covers the whole machine.
+ */
+#define MAX_L3_DEVICES 8
+
+struct l3_device {
+	char syspath[128];
+	int fd[REAL_MAX_SLICES];
+	struct l3_log_register logs[REAL_MAX_SLICES][NUM_REGS];
+};
+
+static struct l3_device l3_devices[MAX_L3_DEVICES];
+static int num_l3_devices;
+
+static struct l3_device *l3_device_get(struct udev_device *udev_dev)
+{
+	const char *paths[REAL_MAX_SLICES] = {
+		"l3_parity", "l3_parity_slice_1"
+	};
+	const char *syspath = udev_device_get_syspath(udev_dev);
+	struct l3_device *dev;
+	char path[256];
+	int i;
+
+	for (i = 0; i < num_l3_devices; i++)
+		if (!strcmp(l3_devices[i].syspath, syspath))
+			return &l3_devices[i];
+
+	if (num_l3_devices == MAX_L3_DEVICES)
+		return NULL;
+
+	dev = &l3_devices[num_l3_devices];
+	strncpy(dev->syspath, syspath, sizeof(dev->syspath) - 1);
+
+	for (i = 0; i < REAL_MAX_SLICES; i++) {
+		snprintf(path, sizeof(path), "%s/%s", syspath, paths[i]);
+		dev->fd[i] = open(path, O_RDWR);
+		if (dev->fd[i] >= 0 &&
+		    pread(dev->fd[i], dev->logs[i],
+			  NUM_REGS * sizeof(uint32_t), 0) < 0) {
+			close(dev->fd[i]);
+			dev->fd[i] = -1;
+		}
+	}
+
+	if (dev->fd[0] < 0)
+		return NULL;
+
+	num_l3_devices++;
+	return dev;
+}
+
+static int l3_remediate(struct l3_device *dev, struct l3_location *loc)
+{
+	struct l3_log_register *reg;
+
+	if (loc->slice >= REAL_MAX_SLICES || dev->fd[loc->slice] < 0 ||
+	    loc->bank >= MAX_BANKS_PER_SLICE || loc->subbank >= NUM_SUBBANKS)
+		return -1;
+
+	reg = &dev->logs[loc->slice][loc->bank * NUM_SUBBANKS + loc->subbank];
+	if (l3_disable_row(reg, loc->row))
+		return -1;
+
+	if (pwrite(dev->fd[loc->slice], dev->logs[loc->slice],
+		   NUM_REGS * sizeof(uint32_t), 0) !=
+	    NUM_REGS * sizeof(uint32_t))
+		return -1;
+
+	return 0;
+}
+
 int l3_uevent_setup(struct l3_parity *par)
 {
 	struct udev *udev;
 	struct udev_monitor *uevent_monitor;
-	fd_set fdset;
-	int fd, ret = -1;
+	struct epoll_event ev = { .events = EPOLLIN };
+	int fd, epoll_fd, ret = -1;
 
 	udev = udev_new();
 	if (!udev) {
@@ -68,12 +147,23 @@ int l3_uevent_setup(struct l3_parity *par)
 		goto err_out;
 
 	fd = udev_monitor_get_fd(uevent_monitor);
-	FD_ZERO(&fdset);
-	FD_SET(fd, &fdset);
+
+	epoll_fd = epoll_create1(0);
+	if (epoll_fd < 0) {
+		ret = -1;
+		goto err_out;
+	}
+
+	ev.data.fd = fd;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+		close(epoll_fd);
+		ret = -1;
+		goto err_out;
+	}
 
 	par->udev = udev;
 	par->fd = fd;
-	par->fdset = fdset;
+	par->epoll_fd = epoll_fd;
 	par->uevent_monitor = uevent_monitor;
 	return 0;
 
@@ -84,41 +174,53 @@ err_out:
 
 int l3_listen(struct l3_parity *par, bool daemon, struct l3_location *loc)
 {
+	struct epoll_event ev;
 	struct udev_device *udev_dev;
 	const char *parity_status;
+	struct l3_device *dev;
 	char *err_msg;
 	int ret;
 
 again:
-	ret = select(par->fd + 1, &par->fdset, NULL, NULL, NULL);
-	/* Number of bits set is returned, must be >= 1 */
+	ret = epoll_wait(par->epoll_fd, &ev, 1, -1);
 	if (ret <= 0) {
 		return ret;
 	}
 
-	assert(FD_ISSET(par->fd, &par->fdset));
+	assert(ev.data.fd == par->fd);
 
 	udev_dev = udev_monitor_receive_device(par->uevent_monitor);
 	if (!udev_dev)
 		return -1;
 
 	parity_status = udev_device_get_property_value(udev_dev, I915_L3_PARITY_UEVENT);
-	if (strncmp(parity_status, "1", 1))
+	if (!parity_status || strncmp(parity_status, "1", 1)) {
+		udev_device_unref(udev_dev);
 		goto again;
+	}
 
 	loc->slice = atoi(udev_device_get_property_value(udev_dev, "SLICE"));
 	loc->row = atoi(udev_device_get_property_value(udev_dev, "ROW"));
 	loc->bank = atoi(udev_device_get_property_value(udev_dev, "BANK"));
 	loc->subbank = atoi(udev_device_get_property_value(udev_dev, "SUBBANK"));
 
+	dev = l3_device_get(udev_dev);
+	ret = dev ? l3_remediate(dev, loc) : -1;
+
 	udev_device_unref(udev_dev);
 
-	assert(asprintf(&err_msg, "Parity error detected on: %d,%d,%d,%d. "
-			"Try to run intel_l3_parity -r %d -b %d -s %d -w %d -d",
-			loc->slice, loc->row, loc->bank, loc->subbank,
-			loc->row, loc->bank, loc->subbank, loc->slice) != -1);
+	if (ret == 0)
+		assert(asprintf(&err_msg, "Parity error detected on: %d,%d,%d,%d. "
+				"Row remapped.",
+				loc->slice, loc->row, loc->bank, loc->subbank) != -1);
+	else
+		assert(asprintf(&err_msg, "Parity error detected on: %d,%d,%d,%d. "
+				"Try to run intel_l3_parity -r %d -b %d -s %d -w %d -d",
+				loc->slice, loc->row, loc->bank, loc->subbank,
+				loc->row, loc->bank, loc->subbank, loc->slice) != -1);
 	if (daemon) {
 		syslog(LOG_INFO, "%s\n", err_msg);
+		free(err_msg);
 		goto again;
 	}
 
@@ -357,27 +357,59 @@ static void decode_asle_ext(const void *buffer)
 	printf("\n");
 }
 
-static void decode_opregion(const uint8_t *opregion, int size)
+/* Offset index over the mailbox sections. Decoding walks this table
+ * instead of open coding each section, and section selection and bounds
+ * checking fall out of the same entries.
+ */
+struct opregion_section {
+	const char *name;
+	uint32_t mbox;
+	uint32_t offset;
+	size_t size;
+	void (*decode)(const void *buffer);
+};
+
+static const struct opregion_section sections[] = {
+	{ "acpi", MBOX_ACPI, OPREGION_ACPI_OFFSET,
+	  sizeof(struct opregion_acpi), decode_acpi },
+	{ "swsci", MBOX_SWSCI, OPREGION_SWSCI_OFFSET,
+	  sizeof(struct opregion_swsci), decode_swsci },
+	{ "asle", MBOX_ASLE, OPREGION_ASLE_OFFSET,
+	  sizeof(struct opregion_asle), decode_asle },
+	{ "vbt", MBOX_VBT, OPREGION_VBT_OFFSET,
+	  sizeof(struct opregion_vbt), decode_vbt },
+	{ "asle_ext", MBOX_ASLE_EXT, OPREGION_ASLE_EXT_OFFSET,
+	  sizeof(struct opregion_asle_ext), decode_asle_ext },
+};
+
+static void decode_opregion(const uint8_t *opregion, int size,
+			    uint32_t select)
 {
 	uint32_t mbox;
+	int i;
 
-	/* XXX: allow decoding up to size */
-	if (OPREGION_ASLE_EXT_OFFSET + sizeof(struct opregion_asle_ext) > size) {
+	if (OPREGION_HEADER_OFFSET + sizeof(struct opregion_header) > size) {
 		fprintf(stderr, "buffer too small\n");
 		return;
 	}
 
 	mbox = decode_header(opregion + OPREGION_HEADER_OFFSET);
-	if (mbox & MBOX_ACPI)
-		decode_acpi(opregion + OPREGION_ACPI_OFFSET);
-	if (mbox & MBOX_SWSCI)
-		decode_swsci(opregion + OPREGION_SWSCI_OFFSET);
-	if (mbox & MBOX_ASLE)
-		decode_asle(opregion + OPREGION_ASLE_OFFSET);
-	if (mbox & MBOX_VBT)
-		decode_vbt(opregion + OPREGION_VBT_OFFSET);
-	if (mbox & MBOX_ASLE_EXT)
-		decode_asle_ext(opregion + OPREGION_ASLE_EXT_OFFSET);
+	mbox &= select;
+
+	for (i = 0; i < ARRAY_SIZE(sections); i++) {
+		const struct opregion_section *section = &sections[i];
+
+		if (!(mbox & section->mbox))
+			continue;
+
+		if (section->offset + section->size > size) {
+			fprintf(stderr, "%s section out of bounds, skipping\n",
+				section->name);
+			continue;
+		}
+
+		section->decode(opregion + section->offset);
+	}
 }
 
 int main(int argc, char *argv[])
@@ -386,29 +418,53 @@ int main(int argc, char *argv[])
 	int fd;
 	struct stat finfo;
 	uint8_t *opregion;
-	int c, option_index = 0;
+	uint32_t select = 0;
+	int c, i, option_index = 0;
 
 	static struct option long_options[] = {
 		{ "file", required_argument, 0, 'f' },
+		{ "section", required_argument, 0, 's' },
 		{ "help", no_argument, 0, 'h' },
 		{ 0 },
 	};
 
-	while ((c = getopt_long(argc, argv, "hf:",
+	while ((c = getopt_long(argc, argv, "hf:s:",
 				long_options, &option_index)) != -1) {
 		switch (c) {
 		case 'h':
-			printf("usage: intel_opregion_decode [-f|--file=<input>]\n");
+			printf("usage: intel_opregion_decode [-f|--file=<input>]"
+			       " [-s|--section=<acpi|swsci|asle|vbt|asle_ext>]...\n");
 			return 0;
 		case 'f':
 			filename = optarg;
 			break;
+		case 's':
+			for (i = 0; i < ARRAY_SIZE(sections); i++) {
+				if (strcmp(optarg, sections[i].name) == 0) {
+					select |= sections[i].mbox;
+					break;
+				}
+			}
+			if (i == ARRAY_SIZE(sections)) {
+				fprintf(stderr, "unknown section \"%s\"\n",
+					optarg);
+				return 1;
+			}
+			break;
 		default:
 			fprintf(stderr, "unkown command options\n");
 			return 1;
 		}
 	}
 
+	if (!select)
+		select = ~0;
+
+	/* One write per image rather than one per line, for sweeps over
+	 * thousands of opregion dumps.
+	 */
+	setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+
 	fd = open(filename, O_RDONLY);
 	if (fd == -1) {
 		printf("Couldn't open \"%s\": %s\n", filename, strerror(errno));
@@ -447,7 +503,7 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	decode_opregion(opregion, finfo.st_size);
+	decode_opregion(opregion, finfo.st_size, select);
 
 	return 0;
 }
@@ -36,19 +36,27 @@
  */
 
 #include <unistd.h>
+#include <dirent.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 #include <err.h>
 #include <sys/ioctl.h>
 
 #include "drm.h"
 #include "i915_drm.h"
 #include "drmtest.h"
+#include "igt_perf_oa.h"
 #include "intel_io.h"
 #include "intel_bufmgr.h"
 #include "intel_batchbuffer.h"
 #include "intel_chipset.h"
+#include "ioctl_wrappers.h"
 
 #define GEN5_COUNTER_COUNT 29
 
@@ -438,6 +446,207 @@ gen7_get_counters(void)
 #define STATS_CHECK_FREQUENCY	100
 #define STATS_REPORT_FREQUENCY	2
 
+/* On kernels with i915-perf we sample through the OA unit instead of
+ * injecting MI_REPORT_PERF_COUNT batches: the hardware writes the reports
+ * into its own buffer at the requested period and we only pay for reading
+ * them back, so the tool no longer competes with the workload for the
+ * render ring and the per-unit B/C counters of the configured metrics set
+ * (EU busy, sampler busy, L3 hits, ...) become available alongside the
+ * aggregating A counters. The MI_REPORT_PERF_COUNT paths above remain the
+ * fallback for kernels or hardware without i915-perf.
+ */
+static volatile sig_atomic_t oa_done;
+
+/* enough for every counter of the richest report format (A45_B8_C8) */
+#define MAX_OA_COUNTERS 64
+
+struct oa_counters {
+	const struct igt_oa_format *format;
+	int n;
+	char names[MAX_OA_COUNTERS][4];
+	uint64_t totals[MAX_OA_COUNTERS];
+	uint64_t timestamp;
+	bool csv;
+};
+
+static void oa_sigint(int sig)
+{
+	oa_done = 1;
+}
+
+static uint64_t oa_lookup_metrics_set(const char *want)
+{
+	struct dirent *de;
+	uint64_t id = 0;
+	char path[256];
+	DIR *dir;
+	FILE *file;
+
+	snprintf(path, sizeof(path), "/sys/class/drm/card%d/metrics",
+		 drm_get_card());
+	dir = opendir(path);
+	if (dir == NULL)
+		return 0;
+
+	while ((de = readdir(dir)) != NULL) {
+		if (de->d_name[0] == '.')
+			continue;
+		if (want && strcmp(de->d_name, want))
+			continue;
+
+		snprintf(path, sizeof(path),
+			 "/sys/class/drm/card%d/metrics/%s/id",
+			 drm_get_card(), de->d_name);
+		file = fopen(path, "r");
+		if (file == NULL)
+			continue;
+		if (fscanf(file, "%" SCNu64, &id) != 1)
+			id = 0;
+		fclose(file);
+		if (id)
+			break;
+	}
+	closedir(dir);
+
+	return id;
+}
+
+static void oa_subscribe_class(igt_oa_reader_t *reader,
+			       struct oa_counters *oa,
+			       enum igt_oa_counter_class counter_class)
+{
+	const char prefix[] = { 'A', 'B', 'C' };
+	int first = 0, count, i;
+
+	switch (counter_class) {
+	case IGT_OA_COUNTER_A:
+		first = oa->format->first_a;
+		count = oa->format->n_a;
+		break;
+	case IGT_OA_COUNTER_B:
+		count = oa->format->n_b;
+		break;
+	default:
+		count = oa->format->n_c;
+		break;
+	}
+
+	for (i = first; i < first + count; i++) {
+		if (oa->n == MAX_OA_COUNTERS)
+			break;
+		igt_oa_subscribe(reader, counter_class, i);
+		snprintf(oa->names[oa->n], sizeof(oa->names[0]), "%c%d",
+			 prefix[counter_class], i);
+		oa->n++;
+	}
+}
+
+static void oa_delta(uint32_t timestamp_delta, const uint32_t *deltas,
+		     int n_deltas, void *user_data)
+{
+	struct oa_counters *oa = user_data;
+	int i;
+
+	if (oa->csv) {
+		printf("%u", timestamp_delta);
+		for (i = 0; i < n_deltas; i++)
+			printf(",%u", deltas[i]);
+		printf("\n");
+		return;
+	}
+
+	oa->timestamp += timestamp_delta;
+	for (i = 0; i < n_deltas; i++)
+		oa->totals[i] += deltas[i];
+}
+
+static void oa_report(struct oa_counters *oa, const char *clear_screen)
+{
+	int i;
+
+	printf("%s", clear_screen);
+	for (i = 0; i < oa->n; i++) {
+		printf("%-3s: %" PRIu64 "\n", oa->names[i], oa->totals[i]);
+		oa->totals[i] = 0;
+	}
+}
+
+static int oa_main(int fd, const char *metrics_set, int format_id,
+		   int exponent, const char *classes, bool csv,
+		   const char *clear_screen)
+{
+	uint64_t properties[] = {
+		DRM_I915_PERF_PROP_SAMPLE_OA, true,
+		DRM_I915_PERF_PROP_OA_METRICS_SET, 0,
+		DRM_I915_PERF_PROP_OA_FORMAT, format_id,
+		DRM_I915_PERF_PROP_OA_EXPONENT, exponent,
+	};
+	struct drm_i915_perf_open_param param = {
+		.flags = I915_PERF_FLAG_FD_CLOEXEC,
+		.num_properties = sizeof(properties) / 16,
+		.properties_ptr = to_user_pointer(properties),
+	};
+	struct oa_counters oa = { .csv = csv };
+	time_t last_report = time(NULL);
+	igt_oa_reader_t *reader;
+	int stream_fd, i;
+
+	properties[3] = oa_lookup_metrics_set(metrics_set);
+	if (properties[3] == 0)
+		return -1;
+
+	oa.format = igt_oa_format_info(format_id);
+	if (oa.format == NULL)
+		return -1;
+
+	stream_fd = ioctl(fd, DRM_IOCTL_I915_PERF_OPEN, &param);
+	if (stream_fd < 0)
+		return -1;
+
+	reader = igt_oa_reader_new(stream_fd, format_id);
+
+	for (i = 0; classes[i]; i++) {
+		switch (classes[i]) {
+		case 'a':
+		case 'A':
+			oa_subscribe_class(reader, &oa, IGT_OA_COUNTER_A);
+			break;
+		case 'b':
+		case 'B':
+			oa_subscribe_class(reader, &oa, IGT_OA_COUNTER_B);
+			break;
+		case 'c':
+		case 'C':
+			oa_subscribe_class(reader, &oa, IGT_OA_COUNTER_C);
+			break;
+		default:
+			errx(1, "unknown counter class '%c'", classes[i]);
+		}
+	}
+
+	if (csv) {
+		printf("timestamp_delta");
+		for (i = 0; i < oa.n; i++)
+			printf(",%s", oa.names[i]);
+		printf("\n");
+	}
+
+	signal(SIGINT, oa_sigint);
+
+	while (!oa_done) {
+		igt_oa_reader_read_deltas(reader, oa_delta, &oa);
+
+		if (!csv && time(NULL) != last_report) {
+			oa_report(&oa, clear_screen);
+			last_report = time(NULL);
+		}
+	}
+
+	igt_oa_reader_free(reader);
+	close(stream_fd);
+	return 0;
+}
+
 int
 main(int argc, char **argv)
 {
@@ -451,12 +660,64 @@ main(int argc, char **argv)
 			       0x1b, '[', 'J',
 			       0x0};
 	bool oacontrol = true;
+	const char *metrics_set = NULL;
+	const char *classes = "a";
+	int format_id = I915_OA_FORMAT_A45_B8_C8;
+	int exponent = 13; /* 1 millisecond */
+	bool csv = false, legacy = false;
 	int fd;
-	int l;
+	int l, c;
+
+	while ((c = getopt(argc, argv, "m:f:e:g:CLh")) != -1) {
+		switch (c) {
+		case 'm':
+			metrics_set = optarg;
+			break;
+		case 'f':
+			for (format_id = 0; format_id < I915_OA_FORMAT_MAX; format_id++)
+				if (igt_oa_formats[format_id].name &&
+				    !strcmp(igt_oa_formats[format_id].name, optarg))
+					break;
+			if (format_id == I915_OA_FORMAT_MAX)
+				errx(1, "unknown OA format '%s'", optarg);
+			break;
+		case 'e':
+			exponent = atoi(optarg);
+			break;
+		case 'g':
+			classes = optarg;
+			break;
+		case 'C':
+			csv = true;
+			break;
+		case 'L':
+			legacy = true;
+			break;
+		case 'h':
+		default:
+			fprintf(stderr, "usage: %s [options]\n"
+				"\t-m <uuid>\tOA metrics set (default: first available)\n"
+				"\t-f <format>\tOA report format (default: A45_B8_C8)\n"
+				"\t-e <exponent>\tOA timer period exponent (default: 13)\n"
+				"\t-g <classes>\tcounter classes to report, e.g. abc (default: a)\n"
+				"\t-C\t\tstream counter deltas as CSV on stdout\n"
+				"\t-L\t\tforce the legacy MI_REPORT_PERF_COUNT path\n",
+				argv[0]);
+			return c == 'h' ? 0 : 1;
+		}
+	}
 
 	fd = drm_open_driver(DRIVER_INTEL);
 	devid = intel_get_drm_devid(fd);
 
+	if (!legacy &&
+	    oa_main(fd, metrics_set, format_id, exponent, classes, csv,
+		    clear_screen) == 0)
+		return 0;
+
+	if (csv)
+		errx(1, "CSV streaming needs the i915-perf OA interface");
+
 	bufmgr = drm_intel_bufmgr_gem_init(fd, 4096);
 	drm_intel_bufmgr_gem_enable_reuse(bufmgr);
 	batch = intel_batchbuffer_alloc(bufmgr, devid);
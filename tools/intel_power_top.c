@@ -0,0 +1,172 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/*
+ * intel_power_top - log the RAPL power breakdown alongside the GPU
+ *
+ * Perf-per-watt work needs to know where the watts go: the i915 energy
+ * counter (or the RAPL gpu plane) gives the GPU itself, while the
+ * package and cores planes show what the driver is costing us on the
+ * CPU side. This reuses the overlay's power/rapl samplers so both
+ * tools report identical numbers.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <inttypes.h>
+
+#include "overlay/debugfs.h"
+#include "overlay/power.h"
+#include "overlay/rapl.h"
+
+enum stream_format {
+	STREAM_NONE,
+	STREAM_JSON,
+	STREAM_CSV,
+};
+
+static void usage(const char *appname)
+{
+	printf("intel_power_top - GPU vs CPU power breakdown from RAPL\n"
+	       "\n"
+	       "usage: %s [parameters]\n"
+	       "\n"
+	       "The following parameters apply:\n"
+	       "[-t <seconds>]       sample interval (default 1)\n"
+	       "[-n <samples>]       stop after this many samples\n"
+	       "[-J]                 stream one JSON record per interval\n"
+	       "[-c]                 stream one CSV record per interval\n"
+	       "[-h]                 show this help screen\n"
+	       "\n",
+	       appname);
+}
+
+int main(int argc, char **argv)
+{
+	enum stream_format stream_format = STREAM_NONE;
+	struct power power;
+	struct rapl *rapl;
+	double interval = 1;
+	double elapsed_time = 0;
+	long num_samples = -1;
+	int print_headers = 1;
+	int ch, d;
+
+	while ((ch = getopt(argc, argv, "t:n:Jch")) != -1) {
+		switch (ch) {
+		case 't': interval = atof(optarg);
+			if (interval <= 0) {
+				fprintf(stderr, "Error: interval must be positive\n");
+				exit(1);
+			}
+			break;
+		case 'n': num_samples = atol(optarg);
+			break;
+		case 'J': stream_format = STREAM_JSON;
+			break;
+		case 'c': stream_format = STREAM_CSV;
+			break;
+		case 'h':
+			usage(argv[0]);
+			exit(0);
+		default:
+			fprintf(stderr, "Invalid flag %c!\n", (char)optopt);
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	debugfs_init();
+
+	if (power_init(&power)) {
+		fprintf(stderr, "Error: no power counters found "
+			"(no i915 energy counter and no RAPL)\n");
+		exit(1);
+	}
+	rapl = &power.rapl;
+
+	/* prime the counters so the first report is a real delta */
+	power_update(&power);
+
+	while (num_samples--) {
+		usleep(interval * 1000000);
+		elapsed_time += interval;
+
+		if (power_update(&power))
+			break;
+
+		if (stream_format == STREAM_CSV) {
+			if (print_headers) {
+				printf("time,gpu-mW");
+				for (d = 0; d < RAPL_MAX; d++)
+					if (rapl_has_domain(rapl, d))
+						printf(",%s-mW",
+						       rapl_domain_name(d));
+				printf("\n");
+			}
+			printf("%.2f,%" PRIu64, elapsed_time, power.power_mW);
+			for (d = 0; d < RAPL_MAX; d++)
+				if (rapl_has_domain(rapl, d))
+					printf(",%" PRIu64,
+					       rapl->domain[d].power_mW);
+			printf("\n");
+		} else if (stream_format == STREAM_JSON) {
+			printf("{ \"time\": %.2f, \"gpu-mW\": %" PRIu64,
+			       elapsed_time, power.power_mW);
+			for (d = 0; d < RAPL_MAX; d++)
+				if (rapl_has_domain(rapl, d))
+					printf(", \"%s-mW\": %" PRIu64,
+					       rapl_domain_name(d),
+					       rapl->domain[d].power_mW);
+			printf(" }\n");
+		} else {
+			if (print_headers) {
+				printf("%10s %10s", "time", "gpu-mW");
+				for (d = 0; d < RAPL_MAX; d++)
+					if (rapl_has_domain(rapl, d))
+						printf(" %10s-mW",
+						       rapl_domain_name(d));
+				printf("\n");
+			}
+			printf("%10.2f %10" PRIu64, elapsed_time, power.power_mW);
+			for (d = 0; d < RAPL_MAX; d++)
+				if (rapl_has_domain(rapl, d))
+					printf(" %13" PRIu64,
+					       rapl->domain[d].power_mW);
+			printf("\n");
+		}
+		print_headers = 0;
+		fflush(stdout);
+	}
+
+	return 0;
+}
@@ -21,6 +21,7 @@
  * SOFTWARE.
  */
 
+#include <ctype.h>
 #include <errno.h>
 #include <getopt.h>
 #include <limits.h>
@@ -72,6 +73,9 @@ struct config {
 	/* spread out bits for convenience */
 	bool binary;
 
+	/* dump: read the registers listed in this file */
+	char *setfile;
+
 	/* register spec */
 	char *specfile;
 	struct reg *regs;
@@ -471,28 +475,123 @@ static int intel_reg_write(struct config *config, int argc, char *argv[])
 	return EXIT_SUCCESS;
 }
 
+/*
+ * Read a register set file, one read command style REGISTER per line. '#'
+ * starts a comment. Returns the number of registers, or negative error code.
+ */
+static ssize_t parse_reg_set(struct config *config, struct reg **regs,
+			     const char *filename)
+{
+	FILE *file;
+	char *line = NULL;
+	size_t linesize = 0, nregs = 0;
+	ssize_t index = 0;
+	int lineno = 0;
+
+	file = fopen(filename, "r");
+	if (!file) {
+		fprintf(stderr, "Error: fopen '%s': %s\n",
+			filename, strerror(errno));
+		return -1;
+	}
+
+	*regs = NULL;
+	while (getline(&line, &linesize, file) != -1) {
+		struct reg reg;
+		char *p, *end;
+
+		lineno++;
+
+		p = strchr(line, '#');
+		if (p)
+			*p = '\0';
+
+		p = line;
+		while (*p && isspace(*p))
+			p++;
+
+		end = p + strlen(p);
+		while (end > p && isspace(end[-1]))
+			*--end = '\0';
+
+		if (!*p)
+			continue;
+
+		if (parse_reg(config, &reg, p)) {
+			fprintf(stderr, "Error: %s:%d: '%s'\n",
+				filename, lineno, p);
+			intel_reg_spec_free(*regs, index);
+			index = -1;
+			goto out;
+		}
+
+		if (!*regs || index >= nregs) {
+			nregs = *regs ? nregs * 2 : 64;
+			*regs = recalloc(*regs, nregs, sizeof(**regs));
+		}
+
+		(*regs)[index++] = reg;
+	}
+
+out:
+	free(line);
+	fclose(file);
+
+	return index;
+}
+
 static int intel_reg_dump(struct config *config, int argc, char *argv[])
 {
-	struct reg *reg;
+	struct reg *regs = config->regs;
+	ssize_t regcount = config->regcount;
+	uint32_t *vals;
+	bool *valid;
 	int i;
 
+	if (config->setfile) {
+		regcount = parse_reg_set(config, &regs, config->setfile);
+		if (regcount < 0)
+			return EXIT_FAILURE;
+	}
+
+	vals = calloc(regcount, sizeof(*vals));
+	valid = calloc(regcount, sizeof(*valid));
+	if (!vals || !valid) {
+		fprintf(stderr, "Error: %s\n", strerror(ENOMEM));
+		return EXIT_FAILURE;
+	}
+
 	if (config->mmiofile)
 		intel_mmio_use_dump_file(config->mmiofile);
 	else
 		intel_register_access_init(config->pci_dev, 0, config->drm_fd);
 
-	for (i = 0; i < config->regcount; i++) {
-		reg = &config->regs[i];
-
+	/*
+	 * Capture all values back-to-back under a single forcewake section,
+	 * with the decode to stdout deferred until after it's dropped. The
+	 * snapshot is as close to atomic as MMIO reads allow, instead of
+	 * changing under us while earlier registers are being printed.
+	 */
+	for (i = 0; i < regcount; i++) {
 		/* can't dump sideband with mmiofile */
-		if (config->mmiofile && reg->port_desc.port != PORT_MMIO)
+		if (config->mmiofile && regs[i].port_desc.port != PORT_MMIO)
 			continue;
 
-		dump_register(config, &config->regs[i]);
+		valid[i] = read_register(config, &regs[i], &vals[i]) == 0;
 	}
 
 	intel_register_access_fini();
 
+	for (i = 0; i < regcount; i++) {
+		if (valid[i])
+			dump_decode(config, &regs[i], vals[i]);
+	}
+
+	if (regs != config->regs)
+		intel_reg_spec_free(regs, regcount);
+	free(vals);
+	free(valid);
+
 	return EXIT_SUCCESS;
 }
 
@@ -518,6 +617,388 @@ static int intel_reg_snapshot(struct config *config, int argc, char *argv[])
 	return EXIT_SUCCESS;
 }
 
+/*
+ * Binary register snapshots, for offline comparison. Text dumps are what
+ * everyone ends up diffing during bring-up, which breaks whenever the
+ * formatting or decode changes and costs seconds of text processing per
+ * comparison. The save command serializes the batched capture instead:
+ * fixed-size records sorted by port and offset, so two snapshots can be
+ * compared with a single O(n) merge-walk and only the registers that
+ * actually changed need decoding.
+ */
+#define SNAPSHOT_MAGIC 0x53474552 /* "REGS" */
+#define SNAPSHOT_VERSION 1
+
+struct snapshot_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t devid;
+	uint32_t count;
+};
+
+struct snapshot_reg {
+	uint32_t port;
+	uint32_t addr;
+	uint32_t val;
+};
+
+static int snapshot_reg_cmp(const void *_a, const void *_b)
+{
+	const struct snapshot_reg *a = _a, *b = _b;
+
+	if (a->port != b->port)
+		return (int32_t)a->port < (int32_t)b->port ? -1 : 1;
+	if (a->addr != b->addr)
+		return a->addr < b->addr ? -1 : 1;
+	return 0;
+}
+
+static int intel_reg_save(struct config *config, int argc, char *argv[])
+{
+	struct reg *regs = config->regs;
+	ssize_t regcount = config->regcount;
+	struct snapshot_header hdr;
+	struct snapshot_reg *recs;
+	uint32_t *vals;
+	bool *valid;
+	FILE *file;
+	int i, n;
+
+	if (argc != 2) {
+		fprintf(stderr, "save: output file required\n");
+		return EXIT_FAILURE;
+	}
+
+	if (config->setfile) {
+		regcount = parse_reg_set(config, &regs, config->setfile);
+		if (regcount < 0)
+			return EXIT_FAILURE;
+	}
+
+	vals = calloc(regcount, sizeof(*vals));
+	valid = calloc(regcount, sizeof(*valid));
+	recs = calloc(regcount, sizeof(*recs));
+	if (!vals || !valid || !recs) {
+		fprintf(stderr, "Error: %s\n", strerror(ENOMEM));
+		return EXIT_FAILURE;
+	}
+
+	if (config->mmiofile)
+		intel_mmio_use_dump_file(config->mmiofile);
+	else
+		intel_register_access_init(config->pci_dev, 0, config->drm_fd);
+
+	/* Batched capture under one forcewake section, as in dump. */
+	for (i = 0; i < regcount; i++) {
+		if (config->mmiofile && regs[i].port_desc.port != PORT_MMIO)
+			continue;
+
+		valid[i] = read_register(config, &regs[i], &vals[i]) == 0;
+	}
+
+	intel_register_access_fini();
+
+	n = 0;
+	for (i = 0; i < regcount; i++) {
+		if (!valid[i])
+			continue;
+		recs[n].port = regs[i].port_desc.port;
+		recs[n].addr = regs[i].mmio_offset + regs[i].addr;
+		recs[n].val = vals[i];
+		n++;
+	}
+
+	qsort(recs, n, sizeof(*recs), snapshot_reg_cmp);
+
+	/* Drop spec aliases of the same register. */
+	for (i = 1; i < n; i++) {
+		if (snapshot_reg_cmp(&recs[i - 1], &recs[i]) == 0) {
+			memmove(&recs[i], &recs[i + 1],
+				(n - i - 1) * sizeof(*recs));
+			n--;
+			i--;
+		}
+	}
+
+	hdr.magic = SNAPSHOT_MAGIC;
+	hdr.version = SNAPSHOT_VERSION;
+	hdr.devid = config->devid;
+	hdr.count = n;
+
+	file = fopen(argv[1], "w");
+	if (!file) {
+		fprintf(stderr, "Error: fopen '%s': %s\n",
+			argv[1], strerror(errno));
+		return EXIT_FAILURE;
+	}
+	if (fwrite(&hdr, sizeof(hdr), 1, file) != 1 ||
+	    fwrite(recs, sizeof(*recs), n, file) != n) {
+		fprintf(stderr, "Error writing snapshot: %s\n",
+			strerror(errno));
+		fclose(file);
+		return EXIT_FAILURE;
+	}
+	fclose(file);
+
+	if (config->verbosity > 0)
+		printf("saved %d registers; compare with intel_reg diff\n", n);
+
+	if (regs != config->regs)
+		intel_reg_spec_free(regs, regcount);
+	free(vals);
+	free(valid);
+	free(recs);
+
+	return EXIT_SUCCESS;
+}
+
+static ssize_t snapshot_read(const char *filename,
+			     struct snapshot_header *hdr,
+			     struct snapshot_reg **recs)
+{
+	FILE *file;
+
+	file = fopen(filename, "r");
+	if (!file) {
+		fprintf(stderr, "Error: fopen '%s': %s\n",
+			filename, strerror(errno));
+		return -1;
+	}
+
+	if (fread(hdr, sizeof(*hdr), 1, file) != 1 ||
+	    hdr->magic != SNAPSHOT_MAGIC ||
+	    hdr->version != SNAPSHOT_VERSION) {
+		fprintf(stderr, "Error: '%s' is not a register snapshot\n",
+			filename);
+		fclose(file);
+		return -1;
+	}
+
+	*recs = calloc(hdr->count, sizeof(**recs));
+	if (!*recs ||
+	    fread(*recs, sizeof(**recs), hdr->count, file) != hdr->count) {
+		fprintf(stderr, "Error: '%s' is truncated\n", filename);
+		free(*recs);
+		fclose(file);
+		return -1;
+	}
+
+	fclose(file);
+	return hdr->count;
+}
+
+static void snapshot_print(struct config *config, char prefix,
+			   const struct snapshot_reg *rec)
+{
+	struct reg *reg = NULL;
+	int i;
+
+	for (i = 0; i < config->regcount; i++) {
+		struct reg *r = &config->regs[i];
+
+		if (r->port_desc.port == rec->port &&
+		    r->addr + r->mmio_offset == rec->addr) {
+			reg = r;
+			break;
+		}
+	}
+
+	printf("%c", prefix);
+	if (reg) {
+		dump_decode(config, reg, rec->val);
+	} else if (rec->port == PORT_MMIO) {
+		printf("%35s (0x%08x): 0x%08x\n", "", rec->addr, rec->val);
+	} else {
+		printf("%24s (0x%02x:0x%08x): 0x%08x\n", "",
+		       rec->port, rec->addr, rec->val);
+	}
+}
+
+static int intel_reg_diff(struct config *config, int argc, char *argv[])
+{
+	struct snapshot_header ha, hb;
+	struct snapshot_reg *a = NULL, *b = NULL;
+	ssize_t na, nb;
+	int i = 0, j = 0, changed = 0;
+
+	if (argc != 3) {
+		fprintf(stderr, "diff: two snapshot files required\n");
+		return EXIT_FAILURE;
+	}
+
+	na = snapshot_read(argv[1], &ha, &a);
+	if (na < 0)
+		return EXIT_FAILURE;
+	nb = snapshot_read(argv[2], &hb, &b);
+	if (nb < 0) {
+		free(a);
+		return EXIT_FAILURE;
+	}
+
+	if (ha.devid != hb.devid)
+		fprintf(stderr, "Warning: comparing snapshots of different "
+			"devices (0x%04x vs 0x%04x)\n", ha.devid, hb.devid);
+
+	/* Decode against the captured device, not the local one. */
+	config->devid = ha.devid;
+
+	while (i < na || j < nb) {
+		int cmp;
+
+		if (i == na)
+			cmp = 1;
+		else if (j == nb)
+			cmp = -1;
+		else
+			cmp = snapshot_reg_cmp(&a[i], &b[j]);
+
+		if (cmp < 0) {
+			snapshot_print(config, '-', &a[i++]);
+			changed++;
+		} else if (cmp > 0) {
+			snapshot_print(config, '+', &b[j++]);
+			changed++;
+		} else {
+			if (a[i].val != b[j].val) {
+				snapshot_print(config, '-', &a[i]);
+				snapshot_print(config, '+', &b[j]);
+				changed++;
+			}
+			i++;
+			j++;
+		}
+	}
+
+	if (config->verbosity > 0)
+		printf("%d registers differ\n", changed);
+
+	free(a);
+	free(b);
+
+	/* Like diff(1): success means no differences. */
+	return changed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*
+ * Change-triggered capture, for transient state that a shell loop around
+ * 'read' always misses. The register set is polled as fast as the BAR
+ * mapping allows - each sample is just a handful of uncached reads, so the
+ * loop turns over in microseconds - into a ring of recent snapshots. When
+ * the trigger register matches under its mask, the ring is dumped with
+ * relative timestamps: the history leading up to the event, at a time
+ * resolution no sysfs or shell based capture can approach.
+ */
+#define WATCH_RING 64
+
+static int intel_reg_watch(struct config *config, int argc, char *argv[])
+{
+	struct reg trigger;
+	struct reg *regs = NULL;
+	ssize_t regcount = 0;
+	uint32_t mask, value;
+	uint32_t *ring, *prev = NULL;
+	uint64_t *stamps;
+	struct timespec ts;
+	int head = 0, filled = 0;
+	char *endp;
+	int i, n;
+
+	if (argc != 4) {
+		fprintf(stderr, "watch: REGISTER MASK VALUE required\n");
+		return EXIT_FAILURE;
+	}
+
+	if (config->mmiofile) {
+		fprintf(stderr, "watch: needs live hardware, not --mmio\n");
+		return EXIT_FAILURE;
+	}
+
+	if (parse_reg(config, &trigger, argv[1]))
+		return EXIT_FAILURE;
+
+	mask = strtoul(argv[2], &endp, 16);
+	if (endp == argv[2] || *endp) {
+		fprintf(stderr, "watch: invalid mask '%s'\n", argv[2]);
+		return EXIT_FAILURE;
+	}
+	value = strtoul(argv[3], &endp, 16);
+	if (endp == argv[3] || *endp) {
+		fprintf(stderr, "watch: invalid value '%s'\n", argv[3]);
+		return EXIT_FAILURE;
+	}
+
+	if (config->setfile) {
+		regcount = parse_reg_set(config, &regs, config->setfile);
+		if (regcount < 0)
+			return EXIT_FAILURE;
+	}
+
+	/* The trigger register is always the last one of each snapshot. */
+	regs = recalloc(regs, regcount + 1, sizeof(*regs));
+	regs[regcount++] = trigger;
+
+	ring = calloc(WATCH_RING * regcount, sizeof(*ring));
+	stamps = calloc(WATCH_RING, sizeof(*stamps));
+	if (!ring || !stamps) {
+		fprintf(stderr, "Error: %s\n", strerror(ENOMEM));
+		return EXIT_FAILURE;
+	}
+
+	intel_register_access_init(config->pci_dev, 0, config->drm_fd);
+
+	for (;;) {
+		uint32_t *snap = &ring[head * regcount];
+
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		stamps[head] = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+		for (i = 0; i < regcount; i++)
+			if (read_register(config, &regs[i], &snap[i]))
+				snap[i] = 0;
+
+		head = (head + 1) % WATCH_RING;
+		if (filled < WATCH_RING)
+			filled++;
+
+		if ((snap[regcount - 1] & mask) == (value & mask))
+			break;
+	}
+
+	intel_register_access_fini();
+
+	/* Dump oldest to newest, timestamped relative to the trigger; only
+	 * print registers whose value changed since the previous sample. */
+	for (n = 0; n < filled; n++) {
+		int slot = (head - filled + n + WATCH_RING) % WATCH_RING;
+		uint32_t *snap = &ring[slot * regcount];
+		int last = (head - 1 + WATCH_RING) % WATCH_RING;
+		double dt = ((int64_t)(stamps[slot] - stamps[last])) / 1000.0;
+
+		for (i = 0; i < regcount; i++) {
+			if (prev && prev[i] == snap[i])
+				continue;
+
+			if (regs[i].name)
+				printf("%+12.1fus %s (0x%08x): 0x%08x\n", dt,
+				       regs[i].name,
+				       regs[i].mmio_offset + regs[i].addr,
+				       snap[i]);
+			else
+				printf("%+12.1fus (0x%08x): 0x%08x\n", dt,
+				       regs[i].mmio_offset + regs[i].addr,
+				       snap[i]);
+		}
+
+		prev = snap;
+	}
+
+	free(ring);
+	free(stamps);
+	intel_reg_spec_free(regs, regcount);
+
+	return EXIT_SUCCESS;
+}
+
 /* XXX: add support for reading and re-decoding a previously done dump */
 static int intel_reg_decode(struct config *config, int argc, char *argv[])
 {
@@ -554,6 +1035,26 @@ static int intel_reg_decode(struct config *config, int argc, char *argv[])
 	return EXIT_SUCCESS;
 }
 
+static int intel_reg_compile(struct config *config, int argc, char *argv[])
+{
+	if (argc != 2) {
+		fprintf(stderr, "compile: output file required\n");
+		return EXIT_FAILURE;
+	}
+
+	if (intel_reg_spec_write_cache(config->regs, config->regcount,
+				       argv[1]) < 0) {
+		fprintf(stderr, "compile: writing '%s' failed\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	if (config->verbosity > 0)
+		printf("compiled %zd registers; use with --spec=%s\n",
+		       config->regcount, argv[1]);
+
+	return EXIT_SUCCESS;
+}
+
 static int intel_reg_list(struct config *config, int argc, char *argv[])
 {
 	int i;
@@ -590,7 +1091,8 @@ static const struct command commands[] = {
 	{
 		.name = "dump",
 		.function = intel_reg_dump,
-		.description = "dump all known registers",
+		.synopsis = "[--set=FILE]",
+		.description = "dump all known registers, or the set listed in FILE",
 	},
 	{
 		.name = "decode",
@@ -603,6 +1105,30 @@ static const struct command commands[] = {
 		.function = intel_reg_snapshot,
 		.description = "create a snapshot of the MMIO bar to stdout",
 	},
+	{
+		.name = "save",
+		.function = intel_reg_save,
+		.synopsis = "[--set=FILE] FILE",
+		.description = "save a binary snapshot of the register values to FILE",
+	},
+	{
+		.name = "diff",
+		.function = intel_reg_diff,
+		.synopsis = "FILE FILE",
+		.description = "print the registers that changed between two saved snapshots",
+	},
+	{
+		.name = "watch",
+		.function = intel_reg_watch,
+		.synopsis = "[--set=FILE] REGISTER MASK VALUE",
+		.description = "poll registers until REGISTER matches VALUE under MASK, then dump the recent history",
+	},
+	{
+		.name = "compile",
+		.function = intel_reg_compile,
+		.synopsis = "FILE",
+		.description = "compile loaded register spec into a binary cache",
+	},
 	{
 		.name = "list",
 		.function = intel_reg_list,
@@ -639,7 +1165,8 @@ static int intel_reg_help(struct config *config, int argc, char *argv[])
 
 	printf("\n");
 	printf("OPTIONS common to most COMMANDS:\n");
-	printf(" --spec=PATH    Read register spec from directory or file\n");
+	printf(" --spec=PATH    Read register spec from directory or file,\n");
+	printf("                either text or a compiled binary cache\n");
 	printf(" --mmio=FILE    Use an MMIO snapshot\n");
 	printf(" --devid=DEVID  Specify PCI device ID for --mmio=FILE\n");
 	printf(" --all          Decode registers for all known platforms\n");
@@ -756,6 +1283,7 @@ enum opt {
 	OPT_DEVID,
 	OPT_COUNT,
 	OPT_POST,
+	OPT_SET,
 	OPT_ALL,
 	OPT_BINARY,
 	OPT_SPEC,
@@ -788,6 +1316,8 @@ int main(int argc, char *argv[])
 		{ "count",	required_argument,	NULL,	OPT_COUNT },
 		/* options specific to write */
 		{ "post",	no_argument,		NULL,	OPT_POST },
+		/* options specific to dump */
+		{ "set",	required_argument,	NULL,	OPT_SET },
 		/* options specific to read, dump and decode */
 		{ "all",	no_argument,		NULL,	OPT_ALL },
 		{ "binary",	no_argument,		NULL,	OPT_BINARY },
@@ -823,6 +1353,14 @@ int main(int argc, char *argv[])
 		case OPT_POST:
 			config.post = true;
 			break;
+		case OPT_SET:
+			config.setfile = strdup(optarg);
+			if (!config.setfile) {
+				fprintf(stderr, "strdup: %s\n",
+					strerror(errno));
+				return EXIT_FAILURE;
+			}
+			break;
 		case OPT_SPEC:
 			config.specfile = strdup(optarg);
 			if (!config.specfile) {
@@ -23,12 +23,16 @@
 
 #include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <regex.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "intel_reg_spec.h"
 
@@ -321,13 +325,211 @@ out:
 }
 
 /*
- * Get register definitions from file.
+ * Binary spec cache. Scripted register captures invoke intel_reg hundreds of
+ * times per run, and the regex based text parser dominates each invocation.
+ * The cache is the parsed spec flattened into an array of fixed size records
+ * sorted by address, followed by a string table, so loading it is one mmap
+ * and one allocation pass. intel_reg_spec_file() recognizes the cache by
+ * magic, making --spec=FILE transparently accept either format.
+ */
+#define SPEC_CACHE_MAGIC	0x49524743	/* "IRGC" */
+#define SPEC_CACHE_VERSION	1
+
+struct spec_cache_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t nregs;
+	uint32_t names_len;
+};
+
+struct spec_cache_reg {
+	int32_t port;
+	uint32_t mmio_offset;
+	uint32_t addr;
+	uint32_t name;		/* offset into string table, -1 for none */
+};
+
+static const struct port_desc *find_port_desc(enum port_addr port)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(port_descs); i++) {
+		if (port_descs[i].port == port)
+			return &port_descs[i];
+	}
+
+	return NULL;
+}
+
+static int spec_cache_reg_cmp(const void *a, const void *b)
+{
+	const struct reg *ra = a, *rb = b;
+
+	if (ra->port_desc.port != rb->port_desc.port)
+		return ra->port_desc.port < rb->port_desc.port ? -1 : 1;
+
+	if (ra->mmio_offset + ra->addr != rb->mmio_offset + rb->addr)
+		return ra->mmio_offset + ra->addr <
+			rb->mmio_offset + rb->addr ? -1 : 1;
+
+	return 0;
+}
+
+/*
+ * Write register definitions out as a binary spec cache. Returns the number
+ * of registers written, or negative error code.
+ */
+ssize_t intel_reg_spec_write_cache(const struct reg *regs, size_t n,
+				   const char *filename)
+{
+	struct spec_cache_header header = {
+		.magic = SPEC_CACHE_MAGIC,
+		.version = SPEC_CACHE_VERSION,
+		.nregs = n,
+	};
+	uint32_t name_offset = 0;
+	struct reg *sorted;
+	FILE *file;
+	ssize_t ret = -1;
+	size_t i;
+
+	sorted = malloc(n * sizeof(*sorted));
+	if (!sorted) {
+		fprintf(stderr, "Error: %s\n", strerror(ENOMEM));
+		return -1;
+	}
+	memcpy(sorted, regs, n * sizeof(*sorted));
+	qsort(sorted, n, sizeof(*sorted), spec_cache_reg_cmp);
+
+	for (i = 0; i < n; i++) {
+		if (sorted[i].name)
+			header.names_len += strlen(sorted[i].name) + 1;
+	}
+
+	file = fopen(filename, "w");
+	if (!file) {
+		fprintf(stderr, "Error: fopen '%s': %s\n",
+			filename, strerror(errno));
+		goto out;
+	}
+
+	fwrite(&header, sizeof(header), 1, file);
+
+	for (i = 0; i < n; i++) {
+		struct spec_cache_reg creg = {
+			.port = sorted[i].port_desc.port,
+			.mmio_offset = sorted[i].mmio_offset,
+			.addr = sorted[i].addr,
+			.name = (uint32_t)-1,
+		};
+
+		if (sorted[i].name) {
+			creg.name = name_offset;
+			name_offset += strlen(sorted[i].name) + 1;
+		}
+
+		fwrite(&creg, sizeof(creg), 1, file);
+	}
+
+	for (i = 0; i < n; i++) {
+		if (sorted[i].name)
+			fwrite(sorted[i].name, strlen(sorted[i].name) + 1,
+			       1, file);
+	}
+
+	ret = fflush(file) == 0 && !ferror(file) ? n : -1;
+	fclose(file);
+out:
+	free(sorted);
+
+	return ret;
+}
+
+static ssize_t read_cache_file(struct reg **regs, int fd, size_t size)
+{
+	const struct spec_cache_header *header;
+	const struct spec_cache_reg *creg;
+	const char *names;
+	struct reg *r;
+	ssize_t ret = -1;
+	uint32_t i;
+	void *map;
+
+	map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "Error: mmap: %s\n", strerror(errno));
+		return -1;
+	}
+
+	header = map;
+	if (header->version != SPEC_CACHE_VERSION ||
+	    size < sizeof(*header) +
+	    (size_t)header->nregs * sizeof(*creg) + header->names_len) {
+		fprintf(stderr, "Error: invalid register spec cache\n");
+		goto out;
+	}
+
+	creg = (const struct spec_cache_reg *)(header + 1);
+	names = (const char *)(creg + header->nregs);
+
+	r = calloc(header->nregs, sizeof(*r));
+	if (!r) {
+		fprintf(stderr, "Error: %s\n", strerror(ENOMEM));
+		goto out;
+	}
+
+	for (i = 0; i < header->nregs; i++) {
+		const struct port_desc *desc = find_port_desc(creg[i].port);
+
+		if (!desc || (creg[i].name != (uint32_t)-1 &&
+			      creg[i].name >= header->names_len)) {
+			fprintf(stderr, "Error: invalid register spec cache\n");
+			intel_reg_spec_free(r, i);
+			goto out;
+		}
+
+		r[i].port_desc = *desc;
+		r[i].mmio_offset = creg[i].mmio_offset;
+		r[i].addr = creg[i].addr;
+		if (creg[i].name != (uint32_t)-1)
+			r[i].name = strdup(names + creg[i].name);
+	}
+
+	*regs = r;
+	ret = header->nregs;
+
+out:
+	munmap(map, size);
+
+	return ret;
+}
+
+/*
+ * Get register definitions from file, either a text spec or a compiled
+ * binary cache.
  */
 ssize_t intel_reg_spec_file(struct reg **regs, const char *file)
 {
 	size_t nregs = 0;
+	uint32_t magic = 0;
+	struct stat st;
+	int fd;
+
 	*regs = NULL;
 
+	fd = open(file, O_RDONLY);
+	if (fd >= 0) {
+		if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+		    st.st_size >= sizeof(struct spec_cache_header) &&
+		    read(fd, &magic, sizeof(magic)) == sizeof(magic) &&
+		    magic == SPEC_CACHE_MAGIC) {
+			ssize_t ret = read_cache_file(regs, fd, st.st_size);
+			close(fd);
+			return ret;
+		}
+		close(fd);
+	}
+
 	return parse_file(regs, &nregs, 0, file);
 }
 
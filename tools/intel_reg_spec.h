@@ -70,6 +70,8 @@ static inline void *recalloc(void *ptr, size_t nmemb, size_t size)
 int parse_port_desc(struct reg *reg, const char *s);
 ssize_t intel_reg_spec_builtin(struct reg **regs, uint32_t devid);
 ssize_t intel_reg_spec_file(struct reg **regs, const char *filename);
+ssize_t intel_reg_spec_write_cache(const struct reg *regs, size_t n,
+				   const char *filename);
 void intel_reg_spec_free(struct reg *regs, size_t n);
 int intel_reg_spec_decode(char *buf, size_t bufsize, const struct reg *reg,
 			  uint32_t val, uint32_t devid);
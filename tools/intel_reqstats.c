@@ -0,0 +1,384 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Summarise request scheduling latencies from an i915 ftrace log.
+ *
+ * The request lifecycle tracepoints (i915_gem_request_add, _submit,
+ * _in, _out) are matched up by their ring/ctx/seqno key into one record
+ * per request, and the delays between the stages - how long a request
+ * queued before the driver submitted it, how long it sat submitted
+ * before the hardware picked it up, and how long it ran - are fed into
+ * igt_stats and reported per engine. The input is the text of the
+ * 'trace' file (what scripts/trace.pl consumes), mmapped and scanned
+ * natively, so a minute of traced stress workload summarises in
+ * seconds rather than the tens of minutes the Perl parser takes.
+ */
+
+#define _GNU_SOURCE /* for memmem */
+
+#include <unistd.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "igt_stats.h"
+
+#define MAX_RINGS 8
+
+enum stage {
+	STAGE_QUEUE,
+	STAGE_SUBMIT,
+	STAGE_IN,
+	STAGE_OUT,
+};
+
+struct request {
+	uint32_t ring, ctx, seqno;
+	uint64_t time[4];
+	bool seen[4];
+};
+
+/* Open-addressed table of in-flight requests; completed requests are
+ * folded into the statistics and their slots reused.
+ */
+static struct request *requests;
+static unsigned int num_requests, size_requests;
+
+struct ring_stats {
+	igt_stats_t submit;	/* add -> submit */
+	igt_stats_t execute;	/* submit -> in */
+	igt_stats_t duration;	/* in -> out */
+	igt_stats_t latency;	/* add -> out */
+	uint64_t count;
+};
+
+static struct ring_stats stats[MAX_RINGS];
+static uint64_t incomplete;
+
+static uint64_t
+request_hash(uint32_t ring, uint32_t ctx, uint32_t seqno)
+{
+	uint64_t h = (uint64_t)ctx << 32 | seqno;
+
+	h ^= (uint64_t)ring << 56;
+	h *= 0x9e3779b97f4a7c15ull;
+	return h;
+}
+
+static struct request *
+request_lookup(uint32_t ring, uint32_t ctx, uint32_t seqno, bool create);
+
+static void
+requests_grow(void)
+{
+	struct request *old = requests;
+	unsigned int old_size = size_requests;
+
+	size_requests = old_size ? 2*old_size : 1024;
+	requests = calloc(size_requests, sizeof(*requests));
+	if (!requests) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	num_requests = 0;
+	for (unsigned int n = 0; n < old_size; n++) {
+		struct request *r = &old[n];
+
+		if (r->seqno)
+			*request_lookup(r->ring, r->ctx, r->seqno, true) = *r;
+	}
+	free(old);
+}
+
+static struct request *
+request_lookup(uint32_t ring, uint32_t ctx, uint32_t seqno, bool create)
+{
+	uint64_t h;
+
+	if (create && 4*num_requests >= 3*size_requests)
+		requests_grow();
+
+	h = request_hash(ring, ctx, seqno);
+	for (unsigned int n = 0; n < size_requests; n++) {
+		struct request *r = &requests[(h + n) & (size_requests - 1)];
+
+		if (!r->seqno) {
+			if (!create)
+				return NULL;
+
+			r->ring = ring;
+			r->ctx = ctx;
+			r->seqno = seqno;
+			num_requests++;
+			return r;
+		}
+
+		if (r->ring == ring && r->ctx == ctx && r->seqno == seqno)
+			return r;
+	}
+
+	return NULL;
+}
+
+static void
+request_complete(struct request *r)
+{
+	struct ring_stats *s = &stats[r->ring % MAX_RINGS];
+
+	/* Requests already in flight when tracing started are missing
+	 * their early stages; count them rather than skew the stats.
+	 */
+	if (!r->seen[STAGE_QUEUE] || !r->seen[STAGE_SUBMIT] ||
+	    !r->seen[STAGE_IN]) {
+		incomplete++;
+	} else {
+		igt_stats_push(&s->submit,
+			       r->time[STAGE_SUBMIT] - r->time[STAGE_QUEUE]);
+		igt_stats_push(&s->execute,
+			       r->time[STAGE_IN] - r->time[STAGE_SUBMIT]);
+		igt_stats_push(&s->duration,
+			       r->time[STAGE_OUT] - r->time[STAGE_IN]);
+		igt_stats_push(&s->latency,
+			       r->time[STAGE_OUT] - r->time[STAGE_QUEUE]);
+	}
+	s->count++;
+
+	memset(r, 0, sizeof(*r));
+	num_requests--;
+}
+
+/* First "seconds.microseconds:" on the line, same as trace.pl accepts;
+ * returns the timestamp in microseconds or 0 if the line has none.
+ */
+static uint64_t
+parse_timestamp(const char *line, const char *end)
+{
+	while (line < end) {
+		const char *s = line;
+		uint64_t sec = 0, usec = 0;
+		int digits = 0;
+
+		while (s < end && *s >= '0' && *s <= '9')
+			sec = 10*sec + *s++ - '0', digits++;
+
+		if (digits && s + 1 < end && *s == '.') {
+			int frac = 0;
+
+			for (s++; s < end && *s >= '0' && *s <= '9'; s++)
+				usec = 10*usec + *s - '0', frac++;
+
+			if (frac == 6 && s < end && *s == ':')
+				return sec * 1000000 + usec;
+		}
+
+		line = s + 1;
+	}
+
+	return 0;
+}
+
+/* "key=<number>" somewhere in [s, end); the tracepoint print format is
+ * stable enough that this beats a regex by a couple of orders of
+ * magnitude.
+ */
+static bool
+parse_field(const char *s, const char *end, const char *key, uint32_t *out)
+{
+	size_t len = strlen(key);
+
+	while ((s = memmem(s, end - s, key, len))) {
+		s += len;
+		if (s < end && *s == '=') {
+			uint32_t v = 0;
+
+			for (s++; s < end && *s >= '0' && *s <= '9'; s++)
+				v = 10*v + *s - '0';
+			*out = v;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void
+process_event(enum stage stage, uint64_t ts,
+	      const char *s, const char *end)
+{
+	uint32_t ring, ctx, seqno;
+	struct request *r;
+
+	if (!parse_field(s, end, "ring", &ring) ||
+	    !parse_field(s, end, "ctx", &ctx) ||
+	    !parse_field(s, end, "seqno", &seqno))
+		return;
+
+	r = request_lookup(ring, ctx, seqno, true);
+	if (!r)
+		return;
+
+	r->time[stage] = ts;
+	r->seen[stage] = true;
+
+	if (stage == STAGE_OUT)
+		request_complete(r);
+}
+
+static const struct event {
+	const char *name;
+	enum stage stage;
+} events[] = {
+	/* names include the colon so _in never matches _into etc. */
+	{ "i915_gem_request_add:", STAGE_QUEUE },
+	{ "i915_gem_request_queue:", STAGE_QUEUE },
+	{ "i915_gem_request_submit:", STAGE_SUBMIT },
+	{ "i915_gem_request_in:", STAGE_IN },
+	{ "i915_gem_request_out:", STAGE_OUT },
+	{ NULL, },
+};
+
+static int
+process_file(const char *filename)
+{
+	const char *ptr, *end, *line;
+	struct stat st;
+	int fd;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+		return -1;
+	}
+
+	ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (ptr == MAP_FAILED) {
+		fprintf(stderr, "%s: mmap failed\n", filename);
+		return -1;
+	}
+	madvise((void *)ptr, st.st_size, MADV_SEQUENTIAL);
+	end = ptr + st.st_size;
+
+	for (line = ptr; line < end; ) {
+		const char *eol, *match;
+
+		eol = memchr(line, '\n', end - line);
+		if (!eol)
+			eol = end;
+
+		match = memmem(line, eol - line,
+			       "i915_gem_request_", 17);
+		if (match) {
+			for (const struct event *e = events; e->name; e++) {
+				size_t len = strlen(e->name);
+
+				if (match + len <= eol &&
+				    !memcmp(match, e->name, len)) {
+					uint64_t ts;
+
+					ts = parse_timestamp(line, match);
+					if (ts)
+						process_event(e->stage, ts,
+							      match + len,
+							      eol);
+					break;
+				}
+			}
+		}
+
+		line = eol + 1;
+	}
+
+	munmap((void *)ptr, st.st_size);
+	return 0;
+}
+
+static void
+print_stats(const char *name, igt_stats_t *s)
+{
+	if (!s->n_values)
+		return;
+
+	printf("  %-14s %8"PRIu64" %8.1f %8.1f %8.1f %8.1f %8"PRIu64"\n",
+	       name,
+	       igt_stats_get_min(s),
+	       igt_stats_get_mean(s),
+	       igt_stats_get_median(s),
+	       igt_stats_get_percentile(s, 90),
+	       igt_stats_get_percentile(s, 99),
+	       igt_stats_get_max(s));
+}
+
+int main(int argc, char **argv)
+{
+	int ret = 0;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: intel_reqstats trace-file...\n");
+		return 1;
+	}
+
+	for (int n = 0; n < MAX_RINGS; n++) {
+		igt_stats_init(&stats[n].submit);
+		igt_stats_init(&stats[n].execute);
+		igt_stats_init(&stats[n].duration);
+		igt_stats_init(&stats[n].latency);
+	}
+
+	for (int n = 1; n < argc; n++)
+		if (process_file(argv[n]))
+			ret = 1;
+
+	for (int n = 0; n < MAX_RINGS; n++) {
+		struct ring_stats *s = &stats[n];
+
+		if (!s->count)
+			continue;
+
+		printf("ring%d: %"PRIu64" requests\n", n, s->count);
+		printf("  %-14s %8s %8s %8s %8s %8s %8s\n",
+		       "(us)", "min", "mean", "median", "90%", "99%", "max");
+		print_stats("submit-delay", &s->submit);
+		print_stats("execute-delay", &s->execute);
+		print_stats("duration", &s->duration);
+		print_stats("latency", &s->latency);
+	}
+
+	if (incomplete)
+		printf("%"PRIu64" requests with incomplete lifecycles (in flight over a trace edge)\n",
+		       incomplete);
+	if (num_requests)
+		printf("%u requests still in flight at the end of the trace\n",
+		       num_requests);
+
+	return ret;
+}
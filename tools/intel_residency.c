@@ -25,14 +25,17 @@
  */
 
 #include <sys/time.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 #include <signal.h>
 #include <time.h>
 #include <getopt.h>
 #include "igt.h"
+#include "igt_sysfs.h"
 
 #define IA32_TIME_STAMP_COUNTER		0x10
 
@@ -71,10 +74,43 @@ const uint32_t res_msr_addrs[] = {
 };
 
 int msr_fd;
+int rc6_fd = -1;
 
 uint32_t deepest_pc_state;
+int deepest_pc_i;
 uint64_t idle_res;
 
+/* One measurement tick: every counter we track, read back-to-back so the
+ * samples are as coherent as the interfaces allow.
+ */
+struct residency_snapshot {
+	uint64_t tsc;
+	uint64_t ns;
+	uint64_t pc[NUM_PC_STATES];
+	uint64_t rc6_ms;
+};
+
+/* The measurement windows used to be paced by SIGALRM and a serial
+ * start-read/sleep/end-read pair per data point, which made the stability
+ * checks the dominant cost of a run. A timerfd ticks every
+ * SAMPLE_INTERVAL_MS instead, each tick takes one batched snapshot, and
+ * the per-tick residency deltas feed fixed-memory histograms: stability
+ * is visible after a handful of ticks rather than after repeating whole
+ * multi-second windows, and each result comes with its spread.
+ */
+#define SAMPLE_INTERVAL_MS 100
+
+struct {
+	int fd;
+	bool sampling;
+	unsigned int ticks, total_ticks;
+	struct residency_snapshot prev;
+	struct igt_histogram pc[NUM_PC_STATES];
+	struct igt_histogram rc6;
+} sampler = {
+	.fd = -1,
+};
+
 #define MAX_CONNECTORS 32
 #define MAX_PLANES 32
 struct {
@@ -298,28 +334,129 @@ static void setup_vblank_interval(void)
 	printf("Interval between vblanks:\t%dus\n", vblank_interval_us);
 }
 
-bool alarm_received;
-static void alarm_handler(int signal)
+static void take_snapshot(struct residency_snapshot *snap)
 {
-	alarm_received = true;
+	struct timespec ts;
+	int pc_i;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	snap->ns = (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+	snap->tsc = msr_read(IA32_TIME_STAMP_COUNTER);
+	for (pc_i = 0; pc_i < NUM_PC_STATES; pc_i++)
+		snap->pc[pc_i] = msr_read(res_msr_addrs[pc_i]);
+
+	if (rc6_fd >= 0)
+		igt_sysfs_attr_snapshot_u64(&rc6_fd, &snap->rc6_ms, 1);
 }
 
-static void setup_alarm(void)
+/* Residencies are accumulated in basis points (1/100th of a percent) so
+ * the log-linear histogram bins don't quantize away the interesting
+ * differences near 0% and 100%. */
+static void sampler_accumulate(const struct residency_snapshot *snap)
 {
-	struct sigaction sa;
+	uint64_t d_tsc = snap->tsc - sampler.prev.tsc;
+	uint64_t d_ns = snap->ns - sampler.prev.ns;
+	int pc_i;
 
-	sa.sa_handler = alarm_handler;
-	sigemptyset(&sa.sa_mask);
-	sa.sa_flags = 0;
-	sigaction(SIGALRM, &sa, NULL);
+	for (pc_i = 0; pc_i < NUM_PC_STATES; pc_i++)
+		igt_histogram_add(&sampler.pc[pc_i],
+				  (snap->pc[pc_i] - sampler.prev.pc[pc_i]) *
+				  10000 / d_tsc);
+
+	if (rc6_fd >= 0)
+		igt_histogram_add(&sampler.rc6,
+				  (snap->rc6_ms - sampler.prev.rc6_ms) *
+				  1000000 * 10000 / d_ns);
+
+	sampler.prev = *snap;
 }
 
-static void set_alarm(time_t sec, suseconds_t usec)
+static void sampler_arm(time_t value_sec, long value_ms, long interval_ms)
 {
-	struct itimerval timerval = {{0, 0}, {sec, usec}};
+	struct itimerspec its = {
+		.it_value = { value_sec, value_ms * 1000000 },
+		.it_interval = { 0, interval_ms * 1000000 },
+	};
 
-	alarm_received = false;
-	igt_assert(setitimer(ITIMER_REAL, &timerval, NULL) == 0);
+	igt_assert(timerfd_settime(sampler.fd, 0, &its, NULL) == 0);
+}
+
+static void set_alarm(time_t sec, long msec)
+{
+	sampler.sampling = false;
+	sampler.ticks = 0;
+	sampler.total_ticks = 1;
+	sampler_arm(sec, msec, 0);
+}
+
+static void sampler_start(time_t sec)
+{
+	int pc_i;
+
+	for (pc_i = 0; pc_i < NUM_PC_STATES; pc_i++)
+		igt_histogram_init(&sampler.pc[pc_i]);
+	igt_histogram_init(&sampler.rc6);
+
+	sampler.sampling = true;
+	sampler.ticks = 0;
+	sampler.total_ticks = sec * 1000 / SAMPLE_INTERVAL_MS;
+	take_snapshot(&sampler.prev);
+	sampler_arm(0, SAMPLE_INTERVAL_MS, SAMPLE_INTERVAL_MS);
+}
+
+/* Polled by the workload callbacks between operations; each elapsed timer
+ * tick takes one batched snapshot, so the counters are sampled on
+ * schedule without signals interrupting the workload. A tick that the
+ * workload overruns just yields one wider delta. */
+static bool alarm_expired(void)
+{
+	struct residency_snapshot snap;
+	uint64_t expirations;
+
+	if (read(sampler.fd, &expirations, sizeof(expirations)) < 0)
+		return false;
+
+	if (sampler.sampling) {
+		take_snapshot(&snap);
+		sampler_accumulate(&snap);
+	}
+
+	sampler.ticks += expirations;
+	return sampler.ticks >= sampler.total_ticks;
+}
+
+static void alarm_wait(void)
+{
+	struct pollfd pfd = { .fd = sampler.fd, .events = POLLIN };
+
+	while (!alarm_expired())
+		poll(&pfd, 1, -1);
+}
+
+static void setup_sampler(void)
+{
+	int dir, idx;
+
+	sampler.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+	igt_assert(sampler.fd >= 0);
+
+	dir = igt_sysfs_open(drm.fd, &idx);
+	if (dir >= 0) {
+		rc6_fd = igt_sysfs_open_attr(dir, "power/rc6_residency_ms",
+					     O_RDONLY);
+		close(dir);
+	}
+	if (rc6_fd < 0)
+		fprintf(stderr, "RC6 residency not available, "
+			"reporting package C states only\n");
+}
+
+static void teardown_sampler(void)
+{
+	if (rc6_fd >= 0)
+		close(rc6_fd);
+	close(sampler.fd);
 }
 
 static void unset_mode(void)
@@ -376,26 +513,34 @@ static void page_flip(void)
 	back_fb = tmp_fb;
 }
 
+/* Idleness is decided per tick instead of per serial 500ms window: three
+ * consecutive ticks at the idle residency and we can start measuring. */
 static void wait_until_idle(void)
 {
-	uint64_t tsc, pc, res;
-
-	do {
-		set_alarm(0, 500 * 1000);
-
-		tsc = msr_read(IA32_TIME_STAMP_COUNTER);
-		pc = msr_read(deepest_pc_state);
+	struct residency_snapshot prev, cur;
+	uint64_t res = 0;
+	int stable = 0;
 
-		while (!alarm_received)
-			pause();
+	take_snapshot(&prev);
+	sampler.sampling = false;
+	sampler.ticks = 0;
+	sampler.total_ticks = 1;
+	sampler_arm(0, SAMPLE_INTERVAL_MS, SAMPLE_INTERVAL_MS);
 
-		pc = msr_read(deepest_pc_state) - pc;
-		tsc = msr_read(IA32_TIME_STAMP_COUNTER) - tsc;
+	do {
+		alarm_wait();
+		sampler.ticks = 0;
 
-		res = pc * 100 / tsc;
+		take_snapshot(&cur);
+		res = (cur.pc[deepest_pc_i] - prev.pc[deepest_pc_i]) * 100 /
+		      (cur.tsc - prev.tsc);
+		prev = cur;
 
-		/*printf("res:%02"PRIu64"\n", res);*/
-	} while (res < idle_res && idle_res - res > 3);
+		if (res >= idle_res || idle_res - res <= 3)
+			stable++;
+		else
+			stable = 0;
+	} while (stable < 3);
 
 	if (res > idle_res && res - idle_res > 3)
 		fprintf(stderr, "The calculated idle residency may be too low "
@@ -404,58 +549,58 @@ static void wait_until_idle(void)
 
 static uint64_t do_measurement(void (*callback)(void *ptr), void *ptr)
 {
-	uint64_t tsc, pc;
-
 	wait_until_idle();
 
 	set_alarm(opts.res_warm_time, 0);
 	callback(ptr);
 
-	set_alarm(opts.res_calc_time, 0);
-
-	tsc = msr_read(IA32_TIME_STAMP_COUNTER);
-	pc = msr_read(deepest_pc_state);
-
+	sampler_start(opts.res_calc_time);
 	callback(ptr);
 
-	pc = msr_read(deepest_pc_state) - pc;
-	tsc = msr_read(IA32_TIME_STAMP_COUNTER) - tsc;
-
-	return pc * 100 / tsc;
+	return (uint64_t)
+		(igt_histogram_get_mean(&sampler.pc[deepest_pc_i]) / 100);
 }
 
+/* The deepest reachable state and its idle residency are found from
+ * per-tick deltas of all the counters in one pass, so this converges in
+ * a second or two of ticks instead of repeating serial warm+calc windows
+ * until three of them in a row stop improving. */
 static void setup_idle(void)
 {
-	uint64_t tsc, pc[NUM_PC_STATES], res, best_res;
-	int pc_i, best_pc_i = 0, retries, consecutive_not_best;
-
-	for (retries = 0; ; retries++) {
-
-		set_alarm(opts.res_warm_time, 0);
-		while (!alarm_received)
-			pause();
-
-		set_alarm(opts.res_calc_time, 0);
-
-		tsc = msr_read(IA32_TIME_STAMP_COUNTER);
-		for (pc_i = best_pc_i; pc_i < NUM_PC_STATES; pc_i++)
-			pc[pc_i] = msr_read(res_msr_addrs[pc_i]);
-
-		while (!alarm_received)
-			pause();
-
-		for (pc_i = best_pc_i; pc_i < NUM_PC_STATES; pc_i++)
-			pc[pc_i] = msr_read(res_msr_addrs[pc_i]) - pc[pc_i];
-		tsc = msr_read(IA32_TIME_STAMP_COUNTER) - tsc;
-
-		for (pc_i = NUM_PC_STATES -1; pc_i >= best_pc_i; pc_i--)
-			if (pc[pc_i] != 0)
+	struct residency_snapshot prev, cur;
+	uint64_t res, best_res = 0;
+	int pc_i, best_pc_i = -1, ticks, consecutive_not_best = 0;
+
+	sampler.sampling = false;
+	sampler.total_ticks = 1;
+	sampler_arm(0, SAMPLE_INTERVAL_MS, SAMPLE_INTERVAL_MS);
+
+	/* one interval of warm-up before the first delta */
+	sampler.ticks = 0;
+	alarm_wait();
+	take_snapshot(&prev);
+
+	for (ticks = 0; ; ticks++) {
+		sampler.ticks = 0;
+		alarm_wait();
+		take_snapshot(&cur);
+
+		for (pc_i = NUM_PC_STATES - 1; pc_i >= 0; pc_i--)
+			if (cur.pc[pc_i] != prev.pc[pc_i])
 				break;
-		igt_require_f(pc_i >= 0, "We're not reaching any PC states!\n");
 
-		res = pc[pc_i] * 100 / tsc;
+		if (pc_i < 0) {
+			igt_require_f(ticks < 100,
+				      "We're not reaching any PC states!\n");
+			prev = cur;
+			continue;
+		}
+
+		res = (cur.pc[pc_i] - prev.pc[pc_i]) * 100 /
+		      (cur.tsc - prev.tsc);
+		prev = cur;
 
-		if (retries == 0 || pc_i > best_pc_i || res > best_res) {
+		if (pc_i > best_pc_i || res > best_res) {
 			best_pc_i = pc_i;
 			best_res = res;
 			consecutive_not_best = 0;
@@ -467,9 +612,10 @@ static void setup_idle(void)
 	}
 
 	deepest_pc_state = res_msr_addrs[best_pc_i];
+	deepest_pc_i = best_pc_i;
 	idle_res = best_res;
 
-	printf("Stable idle residency retries:\t%d\n", retries);
+	printf("Stable idle residency ticks:\t%d\n", ticks);
 	printf("Deepest PC state reached when idle:\t%s\n",
 	       res_msr_names[best_pc_i]);
 	printf("Idle residency for this state:\t%02"PRIu64"%%\n", idle_res);
@@ -477,8 +623,15 @@ static void setup_idle(void)
 
 static void print_result(int ops, int vblanks, uint64_t res)
 {
-	printf("- %02d ops every %02d vblanks:\t%02"PRIu64"%%\n",
-	       ops, vblanks, res);
+	printf("- %02d ops every %02d vblanks:\t%02"PRIu64"%% "
+	       "(p5 %.1f%% p95 %.1f%%",
+	       ops, vblanks, res,
+	       igt_histogram_get_percentile(&sampler.pc[deepest_pc_i], 5) / 100.,
+	       igt_histogram_get_percentile(&sampler.pc[deepest_pc_i], 95) / 100.);
+	if (rc6_fd >= 0)
+		printf(", RC6 %.1f%%",
+		       igt_histogram_get_mean(&sampler.rc6) / 100.);
+	printf(")\n");
 	fflush(stdout);
 }
 
@@ -490,7 +643,7 @@ static void page_flip_cb(void *ptr)
 {
 	struct page_flip_data *data = ptr;
 
-	while (!alarm_received) {
+	while (!alarm_expired()) {
 		page_flip();
 		wait_vblanks(data->n_vblanks);
 	}
@@ -526,13 +679,10 @@ static void draw_cb(void *ptr)
 	req.tv_sec = 0;
 	req.tv_nsec = vblank_interval_us * 1000 / data->ops_per_vblank;
 
-	for (i = 0; !alarm_received; i++) {
+	for (i = 0; !alarm_expired(); i++) {
 		for (ops = 0; ops < data->ops_per_vblank; ops++) {
 			draw_rect(front_fb, data->method, i << 8);
 
-			/* The code that stops the callbacks relies on SIGALRM,
-			 * so we have to use nanosleep since it doesn't use
-			 * signals. */
 			if (data->ops_per_vblank > 1)
 				nanosleep(&req, NULL);
 		}
@@ -576,7 +726,7 @@ static void draw_and_flip_cb(void *ptr)
 	struct draw_data *data = ptr;
 	int i, ops;
 
-	for (i = 0; !alarm_received; i++) {
+	for (i = 0; !alarm_expired(); i++) {
 		for (ops = 0; ops < data->ops_per_vblank; ops++)
 			draw_rect(back_fb, data->method, i << 8);
 
@@ -689,7 +839,7 @@ int main(int argc, char *argv[])
 	setup_drm();
 	setup_modeset();
 	setup_vblank_interval();
-	setup_alarm();
+	setup_sampler();
 
 	printf("Test name:\t%s\n", opts.test_name);
 
@@ -708,6 +858,7 @@ int main(int argc, char *argv[])
 		draw_and_flip_test();
 
 	teardown_modeset();
+	teardown_sampler();
 	teardown_drm();
 	teardown_msr();
 	return 0;
@@ -70,6 +70,11 @@ struct context {
 	int panel_type;
 	bool dump_all_panel_types;
 	bool hexdump;
+	bool json;
+
+	/* single pass index over the BDB blocks, by block id */
+	struct bdb_block blocks[256];
+	bool block_present[256];
 };
 
 /* Get BDB block size given a pointer to Block ID. */
@@ -82,49 +87,60 @@ static uint32_t _get_blocksize(const uint8_t *block_base)
 		return *((const uint16_t *)(block_base + 1));
 }
 
-static struct bdb_block *find_section(struct context *context, int section_id)
+/*
+ * Walk the BDB once, recording the location of every block by id. All
+ * subsequent lookups are index hits, instead of re-walking the whole BDB per
+ * block queried (and the "blocks present" scan alone queries all 256 ids).
+ */
+static void index_blocks(struct context *context)
 {
-	const struct bdb_header *bdb = context->bdb;
-	int length = context->size;
-	struct bdb_block *block;
-	const uint8_t *base = (const uint8_t *)bdb;
-	int index = 0;
+	const uint8_t *base = (const uint8_t *)context->bdb;
 	uint32_t total, current_size;
 	unsigned char current_id;
+	int index = 0;
 
 	/* skip to first section */
-	index += bdb->header_size;
-	total = bdb->bdb_size;
-	if (total > length)
-		total = length;
-
-	block = malloc(sizeof(*block));
-	if (!block) {
-		fprintf(stderr, "out of memory\n");
-		exit(EXIT_FAILURE);
-	}
+	index += context->bdb->header_size;
+	total = context->bdb->bdb_size;
+	if (total > context->size)
+		total = context->size;
 
-	/* walk the sections looking for section_id */
 	while (index + 3 < total) {
 		current_id = *(base + index);
 		current_size = _get_blocksize(base + index);
 		index += 3;
 
 		if (index + current_size > total)
-			return NULL;
+			break;
 
-		if (current_id == section_id) {
-			block->id = current_id;
-			block->size = current_size;
-			block->data = base + index;
-			return block;
+		/* the first instance of a block id wins */
+		if (!context->block_present[current_id]) {
+			context->blocks[current_id].id = current_id;
+			context->blocks[current_id].size = current_size;
+			context->blocks[current_id].data = base + index;
+			context->block_present[current_id] = true;
 		}
 
 		index += current_size;
 	}
+}
 
-	free(block);
-	return NULL;
+static struct bdb_block *find_section(struct context *context, int section_id)
+{
+	struct bdb_block *block;
+
+	if (!context->block_present[section_id])
+		return NULL;
+
+	block = malloc(sizeof(*block));
+	if (!block) {
+		fprintf(stderr, "out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	*block = context->blocks[section_id];
+
+	return block;
 }
 
 static void dump_general_features(struct context *context,
@@ -1592,6 +1608,105 @@ static void hex_dump_block(const struct bdb_block *block)
 	hex_dump(block->data, block->size);
 }
 
+static const char *block_name(uint8_t id)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(dumpers); i++) {
+		if (dumpers[i].id == id)
+			return dumpers[i].name;
+	}
+
+	return NULL;
+}
+
+static void json_print_string(const char *str, size_t len)
+{
+	size_t i;
+
+	putchar('"');
+	for (i = 0; i < len; i++) {
+		char c = str[i];
+
+		if (c == '"' || c == '\\')
+			printf("\\%c", c);
+		else if (c >= 0x20 && c < 0x7f)
+			putchar(c);
+		else
+			printf("\\u%04x", (unsigned char)c);
+	}
+	putchar('"');
+}
+
+/*
+ * Emit the headers and the block index as JSON: per block id, name, offset
+ * from the BDB header and raw payload. The textual decoders stay the
+ * human-facing format; this gives corpus-auditing scripts a stable
+ * machine-readable form for locating and extracting blocks without scraping
+ * the text output.
+ */
+static void dump_blocks_json(struct context *context, int block_number)
+{
+	const struct vbt_header *vbt = context->vbt;
+	const struct bdb_header *bdb = context->bdb;
+	bool first = true;
+	int i;
+
+	printf("{\n");
+	printf("  \"vbt\": {\n");
+	printf("    \"signature\": ");
+	json_print_string(vbt->signature, sizeof(vbt->signature));
+	printf(",\n");
+	printf("    \"version\": %d,\n", vbt->version);
+	printf("    \"header_size\": %u,\n", vbt->header_size);
+	printf("    \"vbt_size\": %u,\n", vbt->vbt_size);
+	printf("    \"checksum\": %u,\n", vbt->vbt_checksum);
+	printf("    \"bdb_offset\": %u\n", vbt->bdb_offset);
+	printf("  },\n");
+	printf("  \"bdb\": {\n");
+	printf("    \"signature\": ");
+	json_print_string(bdb->signature, sizeof(bdb->signature));
+	printf(",\n");
+	printf("    \"version\": %d,\n", bdb->version);
+	printf("    \"header_size\": %u,\n", bdb->header_size);
+	printf("    \"bdb_size\": %u\n", bdb->bdb_size);
+	printf("  },\n");
+	printf("  \"blocks\": [");
+
+	for (i = 0; i < 256; i++) {
+		const struct bdb_block *block = &context->blocks[i];
+		const uint8_t *data = block->data;
+		const char *name;
+		uint32_t j;
+
+		if (!context->block_present[i])
+			continue;
+		if (block_number != -1 && i != block_number)
+			continue;
+
+		printf("%s\n    {\n", first ? "" : ",");
+		first = false;
+
+		printf("      \"id\": %d,\n", i);
+		name = block_name(i);
+		if (name) {
+			printf("      \"name\": ");
+			json_print_string(name, strlen(name));
+			printf(",\n");
+		}
+		printf("      \"offset\": %zu,\n",
+		       (size_t)(data - (const uint8_t *)bdb));
+		printf("      \"size\": %u,\n", block->size);
+		printf("      \"data\": \"");
+		for (j = 0; j < block->size; j++)
+			printf("%02x", data[j]);
+		printf("\"\n");
+		printf("    }");
+	}
+
+	printf("%s  ]\n}\n", first ? "" : "\n");
+}
+
 static bool dump_section(struct context *context, int section_id)
 {
 	struct dumper *dumper = NULL;
@@ -1687,6 +1802,7 @@ enum opt {
 	OPT_ALL_PANELS,
 	OPT_HEXDUMP,
 	OPT_BLOCK,
+	OPT_JSON,
 	OPT_USAGE,
 };
 
@@ -1699,6 +1815,7 @@ static void usage(const char *toolname)
 			" [--all-panels]"
 			" [--hexdump]"
 			" [--block=<block_no>]"
+			" [--json]"
 			" [--help]\n");
 }
 
@@ -1727,6 +1844,7 @@ int main(int argc, char **argv)
 		{ "all-panels",	no_argument,		NULL,	OPT_ALL_PANELS },
 		{ "hexdump",	no_argument,		NULL,	OPT_HEXDUMP },
 		{ "block",	required_argument,	NULL,	OPT_BLOCK },
+		{ "json",	no_argument,		NULL,	OPT_JSON },
 		{ "help",	no_argument,		NULL,	OPT_USAGE },
 		{ 0 }
 	};
@@ -1759,6 +1877,9 @@ int main(int argc, char **argv)
 		case OPT_HEXDUMP:
 			context.hexdump = true;
 			break;
+		case OPT_JSON:
+			context.json = true;
+			break;
 		case OPT_BLOCK:
 			block_number = strtoul(optarg, &endp, 0);
 			if (*endp) {
@@ -1853,6 +1974,8 @@ int main(int argc, char **argv)
 	context.bdb = (const struct bdb_header *)(VBIOS + bdb_off);
 	context.size = size;
 
+	index_blocks(&context);
+
 	if (!context.devid) {
 		const char *devid_string = getenv("DEVICE");
 		if (devid_string)
@@ -1870,7 +1993,14 @@ int main(int argc, char **argv)
 		context.panel_type = 0;
 	}
 
-	if (block_number != -1) {
+	if (context.json) {
+		if (block_number != -1 &&
+		    !context.block_present[block_number]) {
+			fprintf(stderr, "Block %d not found\n", block_number);
+			return EXIT_FAILURE;
+		}
+		dump_blocks_json(&context, block_number);
+	} else if (block_number != -1) {
 		/* dump specific section only */
 		if (!dump_section(&context, block_number)) {
 			fprintf(stderr, "Block %d not found\n", block_number);
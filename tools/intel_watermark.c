@@ -30,6 +30,7 @@
 #include <string.h>
 #include "intel_io.h"
 #include "intel_chipset.h"
+#include "igt_watermark.h"
 #include "drmtest.h"
 
 static uint32_t display_base;
@@ -101,15 +102,6 @@ struct ilk_wm {
 	struct ilk_wm_level lp[3];
 };
 
-#define MASK(size) ((1 << (size)) - 1)
-
-#define REG_DECODE1(x, shift, size) \
-	(((x) >> (shift)) & MASK(size))
-
-#define REG_DECODE2(lo, shift_lo, size_lo, hi, shift_hi, size_hi) \
-	((((lo) >> (shift_lo)) & MASK(size_lo)) | \
-	 ((((hi) >> (shift_hi)) & MASK(size_hi)) << (size_lo)))
-
 static const char pipe_name(int pipe)
 {
 	return 'A' + pipe;
@@ -29,6 +29,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "igt_stats.h"
 
@@ -475,6 +476,104 @@ skip_remaining_dividers:
 	return true;
 }
 
+/*
+ * Same algorithm as skl_ddi_calculate_wrpll2, restructured to score a flat
+ * candidate table precomputed once at startup. The divider lists and
+ * central frequencies never change, so rebuilding them and running the
+ * nested loops with their data dependent branches on every clock is pure
+ * overhead; what remains per candidate is one multiply and the deviation
+ * check. That is what makes sweeping the full pixel clock range cheap
+ * enough for a bring-up sanity check. The deviation itself is a 64-bit
+ * divide, which integer SIMD doesn't provide, so the flat branch-light
+ * loop is as vector friendly as this math gets.
+ */
+struct skl_wrpll_candidate {
+	uint64_t central_freq;
+	unsigned int p;
+};
+
+static struct skl_wrpll_candidate wrpll2_candidates[3 * (35 + 7)];
+static unsigned int wrpll2_n_candidates, wrpll2_even_end;
+
+static void skl_wrpll_candidates_init(void)
+{
+	static const uint64_t dco_central_freq[3] = {8400000000ULL,
+						     9000000000ULL,
+						     9600000000ULL};
+	static const int even_dividers[] = {  4,  6,  8, 10, 12, 14, 16, 18, 20,
+					     24, 28, 30, 32, 36, 40, 42, 44,
+					     48, 52, 54, 56, 60, 64, 66, 68,
+					     70, 72, 76, 78, 80, 84, 88, 90,
+					     92, 96, 98 };
+	static const int odd_dividers[] = { 3, 5, 7, 9, 15, 21, 35 };
+	static const struct {
+		const int *list;
+		int n_dividers;
+	} dividers[] = {
+		{ even_dividers, ARRAY_SIZE(even_dividers) },
+		{ odd_dividers, ARRAY_SIZE(odd_dividers) },
+	};
+	unsigned int d, dco, i, n = 0;
+
+	/* candidates in the exact order the nested loops visit them */
+	for (d = 0; d < ARRAY_SIZE(dividers); d++) {
+		for (dco = 0; dco < ARRAY_SIZE(dco_central_freq); dco++) {
+			for (i = 0; i < dividers[d].n_dividers; i++) {
+				wrpll2_candidates[n].central_freq =
+					dco_central_freq[dco];
+				wrpll2_candidates[n].p = dividers[d].list[i];
+				n++;
+			}
+		}
+
+		if (d == 0)
+			wrpll2_even_end = n;
+	}
+
+	wrpll2_n_candidates = n;
+}
+
+static bool
+skl_ddi_calculate_wrpll3(int clock /* in Hz */,
+			 struct skl_wrpll_params *wrpll_params)
+{
+	uint64_t afe_clock = clock * 5; /* AFE Clock is 5x Pixel clock */
+	struct skl_wrpll_context ctx;
+	unsigned int p0, p1, p2;
+	unsigned int i;
+
+	skl_wrpll_context_init(&ctx);
+
+	for (i = 0; i < wrpll2_n_candidates; i++) {
+		const struct skl_wrpll_candidate *c = &wrpll2_candidates[i];
+
+		/* a 0 deviation can't be improved, even or odd */
+		if (skl_wrpll_try_divider(&ctx, c->central_freq,
+					  c->p * afe_clock, c->p))
+			break;
+
+		/*
+		 * If a solution is found with an even divider, prefer
+		 * this one.
+		 */
+		if (i == wrpll2_even_end - 1 && ctx.p)
+			break;
+	}
+
+	if (!ctx.p)
+		return false;
+
+	skl_wrpll_get_multipliers(ctx.p, &p0, &p1, &p2);
+
+	/* for this unit test only */
+	wrpll_params->central_freq_hz = ctx.central_freq;
+	wrpll_params->p0 = p0;
+	wrpll_params->p1 = p1;
+	wrpll_params->p2 = p2;
+
+	return true;
+}
+
 static const struct {
 	uint32_t clock; /* in Hz */
 } modes[] = {
@@ -858,6 +957,7 @@ struct test_ops {
 } tests[] = {
 	{ .compute = skl_ddi_calculate_wrpll1 },
 	{ .compute = skl_ddi_calculate_wrpll2 },
+	{ .compute = skl_ddi_calculate_wrpll3 },
 };
 
 static void test_run(struct test_ops *test)
@@ -924,11 +1024,90 @@ static void test_run(struct test_ops *test)
 	igt_stats_fini(&stats);
 }
 
+/*
+ * Sweep every pixel clock in the supported range through both the nested
+ * loop and the flat table variant of algorithm #2, check they agree on
+ * every single clock, and report the timing. Meant to run as part of
+ * bring-up sanity checks, where the old per-mode-list run hid whole bands
+ * of unreachable frequencies.
+ */
+static int sweep_run(int step /* in Hz */)
+{
+	const int min_clock = 19750000, max_clock = 300000000;
+	const unsigned int n = (max_clock - min_clock) / step + 1;
+	struct sweep_result {
+		uint64_t central_freq_hz;
+		unsigned int p;
+	} *results[2];
+	struct test_ops sweep_tests[2] = {
+		{ .compute = skl_ddi_calculate_wrpll2 },
+		{ .compute = skl_ddi_calculate_wrpll3 },
+	};
+	unsigned int failures[2] = {};
+	unsigned int mismatches = 0;
+	unsigned int t, i;
+
+	for (t = 0; t < 2; t++) {
+		struct timespec start, end;
+		double elapsed;
+
+		results[t] = calloc(n, sizeof(*results[t]));
+		assert(results[t]);
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		for (i = 0; i < n; i++) {
+			struct skl_wrpll_params params = {};
+			int clock = min_clock + (uint64_t)i * step;
+
+			if (!sweep_tests[t].compute(clock, &params)) {
+				failures[t]++;
+				continue;
+			}
+
+			results[t][i].central_freq_hz = params.central_freq_hz;
+			results[t][i].p = params.p0 * params.p1 * params.p2;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		elapsed = end.tv_sec - start.tv_sec +
+			(end.tv_nsec - start.tv_nsec) / 1e9;
+
+		printf("algorithm #%d swept %u clocks (step %dHz) in %.3fs, "
+		       "%u without a solution\n",
+		       t + 2, n, step, elapsed, failures[t]);
+	}
+
+	for (i = 0; i < n; i++) {
+		if (results[0][i].p != results[1][i].p ||
+		    results[0][i].central_freq_hz !=
+		    results[1][i].central_freq_hz) {
+			printf("mismatch at %dHz: p %u/%u central %"PRIu64"/%"PRIu64"\n",
+			       min_clock + (int)((uint64_t)i * step),
+			       results[0][i].p, results[1][i].p,
+			       results[0][i].central_freq_hz,
+			       results[1][i].central_freq_hz);
+			mismatches++;
+		}
+	}
+
+	printf("%u mismatches between the two variants\n", mismatches);
+
+	free(results[0]);
+	free(results[1]);
+
+	return mismatches ? 1 : 0;
+}
+
 int main(int argc, char **argv)
 {
 	unsigned int t;
 
 	test_multipliers();
+	skl_wrpll_candidates_init();
+
+	if (argc > 1 && strcmp(argv[1], "--sweep") == 0)
+		return sweep_run(argc > 2 ? atoi(argv[2]) : 25000);
 
 	for (t = 0; t < ARRAY_SIZE(tests); t++) {
 		printf("=== Testing algorithm #%d\n", t + 1);
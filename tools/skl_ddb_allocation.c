@@ -430,6 +430,132 @@ static void skl_ddb_allocate(struct wm_input *in,
 	}
 }
 
+/*
+ * Incremental allocation for what-if sweeps. A pipe's DDB share depends
+ * only on the global config, the set of active pipes and its own
+ * parameters, so when a sweep varies one pipe's planes the other pipes
+ * recompute to the exact same result every scenario. Cache the last
+ * result per pipe, keyed on those inputs, and reuse it when they are
+ * unchanged. The input structs are zero initialized by wm_input_reset()
+ * and only ever field assigned, so comparing them with memcmp is safe.
+ */
+struct skl_ddb_pipe_cache {
+	bool valid;
+	uint8_t active_mask;
+	struct intel_wm_config config;
+	struct skl_pipe_wm_parameters params;
+	struct skl_ddb_entry plane[I915_MAX_PLANES];
+	struct skl_ddb_entry cursor;
+};
+
+static struct skl_ddb_pipe_cache ddb_cache[I915_MAX_PIPES];
+static unsigned long ddb_cache_hits, ddb_cache_misses;
+
+static void skl_ddb_allocate_cached(struct wm_input *in,
+				    struct skl_ddb_allocation *out)
+{
+	struct drm_crtc *crtc;
+	uint8_t active_mask = 0;
+	enum pipe p;
+
+	for_each_pipe(p)
+		if (in->params[p].active)
+			active_mask |= 1 << p;
+
+	for_each_crtc(, crtc) {
+		enum pipe pipe = to_intel_crtc(crtc)->pipe;
+		struct skl_ddb_pipe_cache *cache = &ddb_cache[pipe];
+
+		if (cache->valid &&
+		    cache->active_mask == active_mask &&
+		    memcmp(&cache->config, &in->config,
+			   sizeof(cache->config)) == 0 &&
+		    memcmp(&cache->params, &in->params[pipe],
+			   sizeof(cache->params)) == 0) {
+			memcpy(out->plane[pipe], cache->plane,
+			       sizeof(cache->plane));
+			out->cursor[pipe] = cache->cursor;
+			ddb_cache_hits++;
+			continue;
+		}
+
+		skl_allocate_pipe_ddb(crtc, &in->config, &in->params[pipe],
+				      out);
+
+		cache->valid = true;
+		cache->active_mask = active_mask;
+		cache->config = in->config;
+		cache->params = in->params[pipe];
+		memcpy(cache->plane, out->plane[pipe], sizeof(cache->plane));
+		cache->cursor = out->cursor[pipe];
+		ddb_cache_misses++;
+	}
+}
+
+/*
+ * Batch sweep: pipes B and C run a fixed 1080p config while pipe A's
+ * primary plane walks the whole size space, one scenario per (width,
+ * height) step. Results go to a binary file, one record per scenario:
+ *
+ *   u32 width, u32 height,
+ *   then per pipe: 3 planes + cursor as u16 start, u16 end
+ *
+ * so allocation studies post-process records instead of scraping text.
+ */
+static int sweep_run(const char *filename)
+{
+	static struct skl_ddb_allocation ddb, ref;
+	struct wm_input in;
+	unsigned long scenarios = 0, mismatches = 0;
+	uint32_t width, height;
+	FILE *file;
+
+	file = fopen(filename, "w");
+	if (!file) {
+		perror(filename);
+		return 1;
+	}
+
+	for (width = 640; width <= 3840; width += 16) {
+		for (height = 480; height <= 2160; height += 16) {
+			enum pipe pipe;
+
+			wm_input_reset(&in);
+			wm_enable_plane(&in, PIPE_A, PLANE_1, width, height, 4);
+			wm_enable_plane(&in, PIPE_B, PLANE_1, 1920, 1080, 4);
+			wm_enable_plane(&in, PIPE_C, PLANE_1, 1920, 1080, 4);
+
+			skl_ddb_allocate_cached(&in, &ddb);
+
+			/* spot check the cache against a full recompute */
+			if ((scenarios & 255) == 0) {
+				memset(&ref, 0, sizeof(ref));
+				skl_ddb_allocate(&in, &ref);
+				if (memcmp(&ref, &ddb, sizeof(ref)) != 0)
+					mismatches++;
+			}
+
+			fwrite(&width, sizeof(width), 1, file);
+			fwrite(&height, sizeof(height), 1, file);
+			for_each_pipe(pipe) {
+				fwrite(ddb.plane[pipe],
+				       sizeof(ddb.plane[pipe]), 1, file);
+				fwrite(&ddb.cursor[pipe],
+				       sizeof(ddb.cursor[pipe]), 1, file);
+			}
+
+			scenarios++;
+		}
+	}
+
+	fclose(file);
+
+	printf("%lu scenarios, %lu pipe recomputes, %lu reused, %lu mismatches\n",
+	       scenarios, ddb_cache_misses, ddb_cache_hits, mismatches);
+
+	return mismatches ? 1 : 0;
+}
+
 int main(int argc, char **argv)
 {
 	struct wm_input in;
@@ -437,6 +563,9 @@ int main(int argc, char **argv)
 
 	init_stub();
 
+	if (argc > 2 && strcmp(argv[1], "--sweep") == 0)
+		return sweep_run(argv[2]);
+
 	wm_input_reset(&in);
 	wm_enable_plane(&in, PIPE_A, PLANE_1, 1280, 1024, 4);
 	wm_enable_plane(&in, PIPE_A, PLANE_2,  100,  100, 4);